@@ -0,0 +1,212 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "AsyncCopyQueue.h"
+#include "API/Buffer.h"
+#include "API/Texture.h"
+
+#ifdef FALCOR_LOW_LEVEL_API
+namespace Falcor
+{
+    AsyncCopyQueue::SharedPtr AsyncCopyQueue::create()
+    {
+        SharedPtr pQueue = SharedPtr(new AsyncCopyQueue());
+        pQueue->mpContext = CopyContext::create();
+        if (pQueue->mpContext == nullptr)
+        {
+            logError("AsyncCopyQueue::create() - can't create the copy context");
+            return nullptr;
+        }
+        pQueue->mpFence = pQueue->mpContext->getLowLevelData()->getFence();
+        pQueue->mStatsStart = CpuTimer::getCurrentTimePoint();
+        return pQueue;
+    }
+
+    AsyncCopyQueue::~AsyncCopyQueue()
+    {
+        finish();
+    }
+
+    AsyncCopyQueue::Ticket AsyncCopyQueue::recordUpload(const Resource* pResource, uint64_t stagedBytesBefore)
+    {
+        // Copy-queue resources decay to the common state once the copy executed. Do it explicitly, so that the tracked state matches.
+        mpContext->resourceBarrier(pResource, Resource::State::Common);
+
+        // The context flushes by itself if a batch grows too large. In that case the upload was staged in a new batch.
+        uint64_t stagedBytesAfter = mpContext->getStagingStats().batchBytes;
+        mRecordedBytes += (stagedBytesAfter >= stagedBytesBefore) ? (stagedBytesAfter - stagedBytesBefore) : stagedBytesAfter;
+
+        // The next flush signals this value
+        Ticket ticket = mpFence->getCpuValue() + 1;
+        mPendingResources[pResource] = { ticket, pResource->shared_from_this() };
+        return ticket;
+    }
+
+    AsyncCopyQueue::Ticket AsyncCopyQueue::updateBuffer(const Buffer* pBuffer, const void* pData, size_t offset, size_t size)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        uint64_t stagedBytes = mpContext->getStagingStats().batchBytes;
+        mpContext->updateBuffer(pBuffer, pData, offset, size);
+        return recordUpload(pBuffer, stagedBytes);
+    }
+
+    AsyncCopyQueue::Ticket AsyncCopyQueue::updateTexture(const Texture* pTexture, const void* pData)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        uint64_t stagedBytes = mpContext->getStagingStats().batchBytes;
+        mpContext->updateTexture(pTexture, pData);
+        return recordUpload(pTexture, stagedBytes);
+    }
+
+    AsyncCopyQueue::Ticket AsyncCopyQueue::updateTextureSubresources(const Texture* pTexture, uint32_t firstSubresource, uint32_t subresourceCount, const void* pData)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        uint64_t stagedBytes = mpContext->getStagingStats().batchBytes;
+        mpContext->updateTextureSubresources(pTexture, firstSubresource, subresourceCount, pData);
+        return recordUpload(pTexture, stagedBytes);
+    }
+
+    AsyncCopyQueue::Ticket AsyncCopyQueue::submitLocked()
+    {
+        if (mpContext->hasPendingCommands())
+        {
+            mpContext->flush(false);
+
+            Submission submission;
+            submission.ticket = mpFence->getCpuValue();
+            submission.bytes = mRecordedBytes;
+            submission.submitTime = CpuTimer::getCurrentTimePoint();
+            mSubmissions.push_back(submission);
+
+            mStats.submittedBytes += mRecordedBytes;
+            mStats.submitCount++;
+            mRecordedBytes = 0;
+        }
+        return mpFence->getCpuValue();
+    }
+
+    AsyncCopyQueue::Ticket AsyncCopyQueue::submit()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Ticket ticket = submitLocked();
+        pollCompletions();
+        return ticket;
+    }
+
+    void AsyncCopyQueue::pollCompletions()
+    {
+        uint64_t completedValue = mpFence->getGpuValue();
+        auto now = CpuTimer::getCurrentTimePoint();
+        while (mSubmissions.size() && mSubmissions.front().ticket <= completedValue)
+        {
+            const Submission& submission = mSubmissions.front();
+            float latency = CpuTimer::calcDuration(submission.submitTime, now);
+            mTotalLatency += latency;
+            mStats.maxLatency = std::max(mStats.maxLatency, latency);
+            mStats.completedBytes += submission.bytes;
+            mStats.completedCount++;
+            mSubmissions.pop_front();
+        }
+
+        for (auto it = mPendingResources.begin(); it != mPendingResources.end();)
+        {
+            it = (it->second.ticket <= completedValue) ? mPendingResources.erase(it) : std::next(it);
+        }
+    }
+
+    bool AsyncCopyQueue::isComplete(Ticket ticket)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mpFence->getGpuValue() >= ticket;
+    }
+
+    void AsyncCopyQueue::waitCpu(Ticket ticket)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (ticket > mpFence->getCpuValue())
+        {
+            submitLocked();
+        }
+        mpFence->syncCpu(ticket);
+        pollCompletions();
+    }
+
+    void AsyncCopyQueue::finish()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        submitLocked();
+        if (mpFence->getCpuValue() != 0)
+        {
+            mpFence->syncCpu();
+        }
+        pollCompletions();
+    }
+
+    void AsyncCopyQueue::waitForResource(CopyContext* pCtx, const Resource* pResource)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mPendingResources.find(pResource);
+        if (it == mPendingResources.end())
+        {
+            return;
+        }
+
+        Ticket ticket = it->second.ticket;
+        if (ticket > mpFence->getCpuValue())
+        {
+            // Waiting on a value which is never signaled would hang the other queue
+            submitLocked();
+        }
+
+        if (mpFence->getGpuValue() < ticket)
+        {
+            mpFence->syncGpu(pCtx->getLowLevelData()->getCommandQueue(), ticket);
+        }
+    }
+
+    AsyncCopyQueue::Stats AsyncCopyQueue::getStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        pollCompletions();
+
+        Stats stats = mStats;
+        stats.averageLatency = stats.completedCount ? (mTotalLatency / stats.completedCount) : 0;
+        float seconds = CpuTimer::calcDuration(mStatsStart, CpuTimer::getCurrentTimePoint()) * 1.0e-3f;
+        stats.bandwidth = (seconds > 0) ? float(stats.completedBytes) / (1024.0f * 1024.0f) / seconds : 0;
+        return stats;
+    }
+
+    void AsyncCopyQueue::resetStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats = Stats();
+        mTotalLatency = 0;
+        mStatsStart = CpuTimer::getCurrentTimePoint();
+    }
+}
+#endif // FALCOR_LOW_LEVEL_API
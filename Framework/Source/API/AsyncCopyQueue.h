@@ -0,0 +1,146 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#ifdef FALCOR_LOW_LEVEL_API
+#include <mutex>
+#include <deque>
+#include <unordered_map>
+#include "API/CopyContext.h"
+#include "API/LowLevel/GpuFence.h"
+#include "Utils/CpuTimer.h"
+
+namespace Falcor
+{
+    class Buffer;
+    class Texture;
+
+    /** Uploads resources on a dedicated copy queue, so that large uploads don't serialize with rendering.
+        The queue has its own command list and fence. All functions are thread-safe, so loaders and streaming systems can record uploads from worker threads.\n
+        Each upload returns a ticket, which is the fence value the copy completes with. Other contexts only wait for a copy when they use the resource, either by polling isComplete() before using it, or with waitForResource() which makes the context's queue wait on the GPU.\n
+        Resources are transitioned back to the Common state after the copy, since that's the state copy-queue resources decay to.
+    */
+    class AsyncCopyQueue
+    {
+    public:
+        using SharedPtr = std::shared_ptr<AsyncCopyQueue>;
+        using SharedConstPtr = std::shared_ptr<const AsyncCopyQueue>;
+        using Ticket = uint64_t;
+
+        /** Upload statistics
+        */
+        struct Stats
+        {
+            uint64_t submittedBytes = 0;    ///< Bytes submitted since the last resetStats()
+            uint64_t completedBytes = 0;    ///< Bytes the GPU finished copying since the last resetStats()
+            uint32_t submitCount = 0;       ///< Number of submissions since the last resetStats()
+            uint32_t completedCount = 0;    ///< Number of submissions the GPU finished
+            float averageLatency = 0;       ///< Average time in milliseconds from submit() until the completion was observed
+            float maxLatency = 0;           ///< Longest time in milliseconds from submit() until the completion was observed
+            float bandwidth = 0;            ///< Completed megabytes per second since the last resetStats()
+        };
+
+        /** Create a new queue
+        */
+        static SharedPtr create();
+        ~AsyncCopyQueue();
+
+        /** Record a buffer upload. The buffer must have been created with CpuAccess::None.
+            \return The ticket of the upload
+        */
+        Ticket updateBuffer(const Buffer* pBuffer, const void* pData, size_t offset = 0, size_t size = 0);
+
+        /** Record an upload of all the subresources of a texture
+            \return The ticket of the upload
+        */
+        Ticket updateTexture(const Texture* pTexture, const void* pData);
+
+        /** Record an upload of a range of subresources
+            \return The ticket of the upload
+        */
+        Ticket updateTextureSubresources(const Texture* pTexture, uint32_t firstSubresource, uint32_t subresourceCount, const void* pData);
+
+        /** Submit the recorded uploads. Doesn't wait for the GPU.
+            \return The ticket of the last submitted upload
+        */
+        Ticket submit();
+
+        /** Check if the GPU finished an upload
+        */
+        bool isComplete(Ticket ticket);
+
+        /** Block until the GPU finished an upload. Submits the recorded uploads if needed.
+        */
+        void waitCpu(Ticket ticket);
+
+        /** Submit the recorded uploads and block until the GPU finished all of them
+        */
+        void finish();
+
+        /** Make a context's queue wait for the pending uploads of a resource. The wait happens on the GPU and covers the next commands the context submits. Does nothing if the resource has no pending uploads.
+        */
+        void waitForResource(CopyContext* pCtx, const Resource* pResource);
+
+        /** Get the upload statistics
+        */
+        Stats getStats();
+
+        /** Reset the upload statistics
+        */
+        void resetStats();
+
+    private:
+        AsyncCopyQueue() = default;
+        Ticket recordUpload(const Resource* pResource, uint64_t stagedBytesBefore);
+        Ticket submitLocked();
+        void pollCompletions();
+
+        struct PendingResource
+        {
+            Ticket ticket;
+            Resource::SharedConstPtr pResource;     ///< Keeps the resource alive until the copy completes
+        };
+
+        struct Submission
+        {
+            Ticket ticket;
+            uint64_t bytes;
+            CpuTimer::TimePoint submitTime;
+        };
+
+        std::mutex mMutex;
+        CopyContext::SharedPtr mpContext;
+        GpuFence::SharedPtr mpFence;
+        std::unordered_map<const Resource*, PendingResource> mPendingResources;
+        std::deque<Submission> mSubmissions;
+        uint64_t mRecordedBytes = 0;            ///< Bytes recorded since the last submission
+        Stats mStats;
+        float mTotalLatency = 0;
+        CpuTimer::TimePoint mStatsStart;
+    };
+}
+#endif // FALCOR_LOW_LEVEL_API
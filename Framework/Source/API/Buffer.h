@@ -115,6 +115,10 @@ namespace Falcor
         */
         size_t getSize() const { return mSize; }
 
+        /** Get the CPU access flags the buffer was created with
+        */
+        CpuAccess getCpuAccess() const { return mCpuAccess; }
+
         /** Map the buffer
         */
         void* map(MapType Type) const;
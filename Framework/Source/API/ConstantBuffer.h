@@ -30,6 +30,7 @@
 #include "ProgramReflection.h"
 #include "Texture.h"
 #include "VariablesBuffer.h"
+#include "ParameterBlockLayout.h"
 #include "Graphics/Program.h"
 #include "API/LowLevel/DescriptorHeap.h"
 
@@ -169,6 +170,25 @@ namespace Falcor
             return VariablesBuffer::setTexture(Offset, pTexture, pSampler);
         }
 
+        /** Set a host/device shared struct into the buffer with a single copy.
+        The struct's layout (see ParameterBlockTraits) is validated against the buffer's reflection once per program link. If the variable is missing or its layout doesn't match, a warning is logged once and the call is ignored.
+        \param[in] varName The name of the struct variable in the buffer
+        \param[in] data The data to set
+        \return true if the data was set, otherwise false
+        */
+        template<typename T>
+        bool setParameterBlock(const std::string& varName, const T& data)
+        {
+            const ParameterBlockLayout& layout = ParameterBlockTraits<T>::getLayout();
+            size_t offset = layout.getOffset(mpReflector, varName);
+            if(offset == ParameterBlockLayout::kInvalidOffset)
+            {
+                return false;
+            }
+            setBlob(&data, offset, layout.getSize());
+            return true;
+        }
+
         virtual void uploadToGPU(size_t offset = 0, size_t size = -1) const override;
 
         DescriptorHeap::Entry getCBV() const;
@@ -29,12 +29,14 @@
 #include "API/Resource.h"
 #ifdef FALCOR_LOW_LEVEL_API
 #include "API/LowLevel/LowLevelContextData.h"
+#include "API/LowLevel/StagingPageAllocator.h"
 #endif
 
 namespace Falcor
 {
     class Texture;
     class Buffer;
+    class GpuFence;
 
     class CopyContext : public std::enable_shared_from_this<CopyContext>
     {
@@ -43,13 +45,73 @@ namespace Falcor
         using SharedConstPtr = std::shared_ptr<const CopyContext>;
         ~CopyContext();
 
+        /** A texture readback which doesn't stall the CPU. The copy is submitted when the task is issued, and the data can be read once the GPU executed it.
+        */
+        class ReadTextureTask
+        {
+        public:
+            using SharedPtr = std::shared_ptr<ReadTextureTask>;
+
+            /** Copy a subresource into a new readback buffer. The context is flushed but the function doesn't wait for the GPU.
+            */
+            static SharedPtr create(CopyContext* pCtx, const Texture* pTexture, uint32_t subresourceIndex);
+
+            /** Issue another copy into the same readback buffer, which is reallocated only if the subresource doesn't fit.
+                The data of the previous copy is lost, so call it after reading the data.
+            */
+            void reissue(CopyContext* pCtx, const Texture* pTexture, uint32_t subresourceIndex);
+
+            /** Check if the GPU finished the copy
+            */
+            bool isReady() const;
+
+            /** Block until the GPU finished the copy
+            */
+            void wait() const;
+
+            /** Wait for the copy and return the data with tightly packed rows
+            */
+            std::vector<uint8> getData();
+
+            /** Wait for the copy and write the data into pDst
+                \param[in] dstRowPitch The distance in bytes between rows in pDst. 0 means tightly packed rows.
+            */
+            void readData(void* pDst, uint32_t dstRowPitch = 0);
+
+            /** Get the size in bytes of a tightly packed row
+            */
+            uint32_t getRowSize() const { return mRowSize; }
+
+            /** Get the number of rows, for all the slices
+            */
+            uint32_t getRowCount() const { return mRowCount * mDepth; }
+
+        private:
+            ReadTextureTask() = default;
+
+            std::shared_ptr<Buffer> mpBuffer;
+            std::shared_ptr<GpuFence> mpFence;
+            uint64_t mFenceValue = 0;
+            uint32_t mRowPitch = 0;
+            uint32_t mRowSize = 0;
+            uint32_t mRowCount = 0;
+            uint32_t mDepth = 0;
+        };
+
         static SharedPtr create();
+
+        /** Upload data into a buffer. The data is staged in the context's persistent upload pages, and the copy is recorded into the command list, so many updates are submitted together by the next flush().
+        */
         void updateBuffer(const Buffer* pBuffer, const void* pData, size_t offset = 0, size_t size = 0);
         void updateTexture(const Texture* pTexture, const void* pData);
         void updateTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex, const void* pData);
         void updateTextureSubresources(const Texture* pTexture, uint32_t firstSubresource, uint32_t subresourceCount, const void* pData);
         std::vector<uint8> readTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex);
 
+        /** Start reading a subresource without waiting for the GPU. See ReadTextureTask.
+        */
+        ReadTextureTask::SharedPtr asyncReadTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex);
+
         /** Reset
         */
         void reset();
@@ -79,17 +141,50 @@ namespace Falcor
         */
         void copySubresource(const Resource* pDst, uint32_t dstSubresourceIdx, const Resource* pSrc, uint32_t srcSubresourceIdx);
 
+        /** Copy a range of bytes between buffers created with CpuAccess::None. If the buffers are the same, the ranges must not overlap.
+        */
+        void copyBufferRegion(const Buffer* pDst, uint64_t dstOffset, const Buffer* pSrc, uint64_t srcOffset, uint64_t numBytes);
+
 #ifdef FALCOR_LOW_LEVEL_API
         /** Get the low-level context data
         */
         LowLevelContextData::SharedPtr getLowLevelData() { return mpLowLevelData; }
+
+        /** Get the statistics of the upload pages used by updateBuffer() and updateTextureSubresources()
+        */
+        StagingPageAllocator::Stats getStagingStats() const;
 #endif
+
+        static const uint64_t kStagingPageSize = 4 * 1024 * 1024;       ///< Size of an upload page. Larger uploads get a dedicated page.
+        static const uint64_t kMaxStagingBatchSize = 64 * 1024 * 1024;  ///< The context is flushed before the staged data of a batch grows beyond this size
+        static const uint32_t kMaxFreeStagingPages = 8;                 ///< Number of idle upload pages which are kept for reuse
+
     protected:
         void bindDescriptorHeaps();
         CopyContext() = default;
         bool mCommandsPending = false;
 #ifdef FALCOR_LOW_LEVEL_API
         LowLevelContextData::SharedPtr mpLowLevelData;
+
+        struct StagingData
+        {
+            ResourceHandle pResourceHandle;
+            uint64_t offset = 0;            ///< Offset in bytes from the start of the resource
+            uint8_t* pData = nullptr;
+        };
+
+        /** Allocate upload memory for the commands recorded until the next flush()
+        */
+        StagingData allocateStagingData(uint64_t size, uint64_t alignment);
+
+        struct StagingPage
+        {
+            ResourceHandle pResourceHandle;
+            uint8_t* pData = nullptr;
+        };
+
+        std::vector<StagingPage> mStagingPages;                 ///< Indexed by the page IDs of mpStagingAllocator
+        StagingPageAllocator::SharedPtr mpStagingAllocator;
 #endif
     };
 }
@@ -34,6 +34,8 @@
 
 namespace Falcor
 {
+    ID3D12ResourcePtr createBuffer(Buffer::State initState, size_t size, const D3D12_HEAP_PROPERTIES& heapProps, Buffer::BindFlags bindFlags);
+
     CopyContext::~CopyContext() = default;
 
     CopyContext::SharedPtr CopyContext::create()
@@ -45,6 +47,11 @@ namespace Falcor
 
     void CopyContext::bindDescriptorHeaps()
     {
+        // Copy command lists can't use descriptor heaps
+        if (mpLowLevelData->getCommandList()->GetType() == D3D12_COMMAND_LIST_TYPE_COPY)
+        {
+            return;
+        }
         ID3D12DescriptorHeap* pHeaps[] = { gpDevice->getSamplerDescriptorHeap()->getApiHandle(), gpDevice->getSrvDescriptorHeap()->getApiHandle() };
         mpLowLevelData->getCommandList()->SetDescriptorHeaps(arraysize(pHeaps), pHeaps);
     }
@@ -83,6 +90,12 @@ namespace Falcor
             mpLowLevelData->flush();
             mCommandsPending = false;
             bindDescriptorHeaps();
+
+            // The flush signaled the fence, the upload pages of the batch are reused once the GPU reaches the new value
+            if (mpStagingAllocator)
+            {
+                mpStagingAllocator->submit(mpLowLevelData->getFence()->getCpuValue());
+            }
         }
 
         if (wait)
@@ -91,6 +104,52 @@ namespace Falcor
         }
     }
 
+    CopyContext::StagingData CopyContext::allocateStagingData(uint64_t size, uint64_t alignment)
+    {
+        if (mpStagingAllocator == nullptr)
+        {
+            auto createPage = [this](uint32_t pageID, uint64_t pageSize)
+            {
+                if (pageID >= mStagingPages.size())
+                {
+                    mStagingPages.resize(pageID + 1);
+                }
+                // Upload pages stay mapped for their whole lifetime
+                StagingPage& page = mStagingPages[pageID];
+                page.pResourceHandle = createBuffer(Buffer::State::GenericRead, pageSize, kUploadHeapProps, Buffer::BindFlags::None);
+                D3D12_RANGE readRange = {};
+                d3d_call(page.pResourceHandle->Map(0, &readRange, (void**)&page.pData));
+            };
+            auto releasePage = [this](uint32_t pageID)
+            {
+                mStagingPages[pageID] = StagingPage();
+            };
+            mpStagingAllocator = StagingPageAllocator::create(kStagingPageSize, kMaxFreeStagingPages, createPage, releasePage);
+        }
+
+        // Submit the batch before it holds on to too much memory
+        uint64_t batchSize = mpStagingAllocator->getBatchSize();
+        if ((batchSize != 0) && (batchSize + size > kMaxStagingBatchSize))
+        {
+            flush();
+        }
+
+        mpStagingAllocator->retire(mpLowLevelData->getFence()->getGpuValue());
+        StagingPageAllocator::Allocation allocation = mpStagingAllocator->allocate(size, alignment);
+        const StagingPage& page = mStagingPages[allocation.pageID];
+
+        StagingData data;
+        data.pResourceHandle = page.pResourceHandle;
+        data.offset = allocation.offset;
+        data.pData = page.pData + allocation.offset;
+        return data;
+    }
+
+    StagingPageAllocator::Stats CopyContext::getStagingStats() const
+    {
+        return mpStagingAllocator ? mpStagingAllocator->getStats() : StagingPageAllocator::Stats();
+    }
+
     void CopyContext::updateBuffer(const Buffer* pBuffer, const void* pData, size_t offset, size_t size)
     {
         if (size == 0)
@@ -104,16 +163,13 @@ namespace Falcor
             return;
         }
 
-        mCommandsPending = true;
-        // Allocate a buffer on the upload heap
-        Buffer::SharedPtr pUploadBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::CpuAccess::Write, nullptr);
-        pUploadBuffer->updateData(pData, offset, size);
-        ID3D12ResourcePtr pResource = pUploadBuffer->getApiHandle();
+        // Stage the data in an upload page
+        StagingData staging = allocateStagingData(size, 4);
+        memcpy(staging.pData, pData, size);
 
         resourceBarrier(pBuffer, Resource::State::CopyDest);
-
-        offset = pUploadBuffer->getGpuAddress() - pResource->GetGPUVirtualAddress();
-        mpLowLevelData->getCommandList()->CopyBufferRegion(pBuffer->getApiHandle(), 0, pResource, offset, size);
+        mpLowLevelData->getCommandList()->CopyBufferRegion(pBuffer->getApiHandle(), offset, staging.pResourceHandle, staging.offset, size);
+        mCommandsPending = true;
     }
 
     void CopyContext::updateTextureSubresources(const Texture* pTexture, uint32_t firstSubresource, uint32_t subresourceCount, const void* pData)
@@ -133,14 +189,11 @@ namespace Falcor
         uint64_t size;
         pDevice->GetCopyableFootprints(&texDesc, firstSubresource, subresourceCount, 0, footprint.data(), rowCount.data(), rowSize.data(), &size);
 
-        // Allocate a buffer on the upload heap
-        Buffer::SharedPtr pBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::CpuAccess::Write, nullptr);
-        // Map the buffer
-        uint8_t* pDst = (uint8_t*)pBuffer->map(Buffer::MapType::WriteDiscard);
-        ID3D12ResourcePtr pResource = pBuffer->getApiHandle();
-
-        // Get the offset from the beginning of the resource
-        uint64_t offset = pBuffer->getGpuAddress() - pResource->GetGPUVirtualAddress();
+        // Stage the data in an upload page. The footprint offsets are relative to the staged data.
+        StagingData staging = allocateStagingData(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        uint8_t* pDst = staging.pData;
+        ID3D12ResourcePtr pResource = staging.pResourceHandle;
+        uint64_t offset = staging.offset;
 
         resourceBarrier(pTexture, Resource::State::CopyDest);
 
@@ -164,8 +217,7 @@ namespace Falcor
             D3D12_TEXTURE_COPY_LOCATION srcLoc = { pResource, D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT, footprint[s] };
             mpLowLevelData->getCommandList()->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
         }
-
-        pBuffer->unmap();
+        mCommandsPending = true;
     }
 
     void CopyContext::updateTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex, const void* pData)
@@ -174,7 +226,14 @@ namespace Falcor
         updateTextureSubresources(pTexture, subresourceIndex, 1, pData);
     }
 
-    std::vector<uint8> CopyContext::readTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex)
+    CopyContext::ReadTextureTask::SharedPtr CopyContext::ReadTextureTask::create(CopyContext* pCtx, const Texture* pTexture, uint32_t subresourceIndex)
+    {
+        SharedPtr pTask = SharedPtr(new ReadTextureTask());
+        pTask->reissue(pCtx, pTexture, subresourceIndex);
+        return pTask;
+    }
+
+    void CopyContext::ReadTextureTask::reissue(CopyContext* pCtx, const Texture* pTexture, uint32_t subresourceIndex)
     {
         //Get footprint
         D3D12_RESOURCE_DESC texDesc = pTexture->getApiHandle()->GetDesc();
@@ -185,36 +244,76 @@ namespace Falcor
         ID3D12Device* pDevice = gpDevice->getApiHandle();
         pDevice->GetCopyableFootprints(&texDesc, subresourceIndex, 1, 0, &footprint, &rowCount, &rowSize, &size);
 
-        //Create buffer 
-        Buffer::SharedPtr pBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+        //Create buffer
+        if((mpBuffer == nullptr) || (mpBuffer->getSize() < size))
+        {
+            mpBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+        }
+
+        mRowPitch = footprint.Footprint.RowPitch;
+        mRowSize = footprint.Footprint.Width * getFormatBytesPerBlock(pTexture->getFormat());
+        mRowCount = rowCount;
+        mDepth = footprint.Footprint.Depth;
 
         //Copy from texture to buffer
+        pCtx->resourceBarrier(pTexture, Resource::State::CopySource);
         D3D12_TEXTURE_COPY_LOCATION srcLoc = { pTexture->getApiHandle(), D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX, subresourceIndex };
-        D3D12_TEXTURE_COPY_LOCATION dstLoc = { pBuffer->getApiHandle(), D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT, footprint };
-        RenderContext* pContext = gpDevice->getRenderContext().get();
-        mpLowLevelData->getCommandList()->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
-        pContext->flush(true);
+        D3D12_TEXTURE_COPY_LOCATION dstLoc = { mpBuffer->getApiHandle(), D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT, footprint };
+        pCtx->getLowLevelData()->getCommandList()->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
+        pCtx->setPendingCommands(true);
+
+        // Submit without waiting. Every flush signals the context's fence.
+        pCtx->flush(false);
+        mpFence = pCtx->getLowLevelData()->getFence();
+        mFenceValue = mpFence->getCpuValue();
+    }
 
-        //Get buffer data
-        std::vector<uint8> result;
-		uint32_t actualRowSize = footprint.Footprint.Width * getFormatBytesPerBlock(pTexture->getFormat());
-        result.resize(rowCount * actualRowSize);
-        uint8* pData = reinterpret_cast<uint8*>(pBuffer->map(Buffer::MapType::Read));
+    bool CopyContext::ReadTextureTask::isReady() const
+    {
+        return mpFence->getGpuValue() >= mFenceValue;
+    }
+
+    void CopyContext::ReadTextureTask::wait() const
+    {
+        mpFence->syncCpu(mFenceValue);
+    }
 
-        for(uint32_t z = 0 ; z < footprint.Footprint.Depth ; z++)
+    std::vector<uint8> CopyContext::ReadTextureTask::getData()
+    {
+        std::vector<uint8> result(mRowSize * mRowCount * mDepth);
+        readData(result.data());
+        return result;
+    }
+
+    void CopyContext::ReadTextureTask::readData(void* pDst, uint32_t dstRowPitch)
+    {
+        wait();
+        dstRowPitch = dstRowPitch ? dstRowPitch : mRowSize;
+
+        //Get buffer data
+        const uint8* pData = reinterpret_cast<const uint8*>(mpBuffer->map(Buffer::MapType::Read));
+        for(uint32_t z = 0 ; z < mDepth ; z++)
         {
-            const uint8_t* pSrcZ = pData + z * footprint.Footprint.RowPitch * rowCount;
-            uint8_t* pDstZ = result.data() + z * actualRowSize * rowCount;
-            for (uint32_t y = 0; y < rowCount; y++)
+            const uint8_t* pSrcZ = pData + z * mRowPitch * mRowCount;
+            uint8_t* pDstZ = (uint8_t*)pDst + z * dstRowPitch * mRowCount;
+            for (uint32_t y = 0; y < mRowCount; y++)
             {
-                const uint8_t* pSrc = pSrcZ + y *  footprint.Footprint.RowPitch;
-                uint8_t* pDst = pDstZ + y * actualRowSize;
-                memcpy(pDst, pSrc, actualRowSize);
+                const uint8_t* pSrc = pSrcZ + y * mRowPitch;
+                uint8_t* pDst = pDstZ + y * dstRowPitch;
+                memcpy(pDst, pSrc, mRowSize);
             }
         }
+        mpBuffer->unmap();
+    }
 
-        pBuffer->unmap();
-        return result;
+    CopyContext::ReadTextureTask::SharedPtr CopyContext::asyncReadTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex)
+    {
+        return ReadTextureTask::create(this, pTexture, subresourceIndex);
+    }
+
+    std::vector<uint8> CopyContext::readTextureSubresource(const Texture* pTexture, uint32_t subresourceIndex)
+    {
+        return asyncReadTextureSubresource(pTexture, subresourceIndex)->getData();
     }
 
     void CopyContext::updateTexture(const Texture* pTexture, const void* pData)
@@ -254,6 +353,20 @@ namespace Falcor
         mCommandsPending = true;
     }
 
+    void CopyContext::copyBufferRegion(const Buffer* pDst, uint64_t dstOffset, const Buffer* pSrc, uint64_t srcOffset, uint64_t numBytes)
+    {
+        if((dstOffset + numBytes > pDst->getSize()) || (srcOffset + numBytes > pSrc->getSize()))
+        {
+            logWarning("CopyContext::copyBufferRegion() - the range is out of bounds. Nothing to copy.");
+            return;
+        }
+
+        resourceBarrier(pDst, Resource::State::CopyDest);
+        resourceBarrier(pSrc, Resource::State::CopySource);
+        mpLowLevelData->getCommandList()->CopyBufferRegion(pDst->getApiHandle(), dstOffset, pSrc->getApiHandle(), srcOffset, numBytes);
+        mCommandsPending = true;
+    }
+
     void CopyContext::copySubresource(const Resource* pDst, uint32_t dstSubresourceIdx, const Resource* pSrc, uint32_t srcSubresourceIdx)
     {
         resourceBarrier(pDst, Resource::State::CopyDest);
@@ -220,6 +220,7 @@ namespace Falcor
 
     Device::~Device()
     {
+        mpCopyQueue.reset();
         mpRenderContext->flush(true);
         // Release all the bound resources. Need to do that before deleting the RenderContext
         mpRenderContext->setGraphicsState(nullptr);
@@ -305,6 +306,7 @@ namespace Falcor
 		// Create the swap-chain
         mpRenderContext = RenderContext::create();
         mpResourceAllocator = ResourceAllocator::create(1024 * 1024 * 2, mpRenderContext->getLowLevelData()->getFence());
+        mpCopyQueue = AsyncCopyQueue::create();
         pData->pSwapChain = createSwapChain(pDxgiFactory, mpWindow.get(), mpRenderContext->getLowLevelData()->getCommandQueue(), desc.colorFormat);
 		if(pData->pSwapChain == nullptr)
 		{
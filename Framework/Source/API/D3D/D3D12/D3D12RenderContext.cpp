@@ -233,6 +233,39 @@ namespace Falcor
         drawIndexedInstanced(indexCount, 1, startIndexLocation, baseVertexLocation, 0);
     }
 
+    void RenderContext::drawIndexedIndirect(const Buffer* pArgBuffer, uint64_t argBufferOffset, uint32_t drawCount)
+    {
+        if(drawCount == 0)
+        {
+            return;
+        }
+
+        if(mpDrawIndexedSignature == nullptr)
+        {
+            D3D12_INDIRECT_ARGUMENT_DESC argDesc = {};
+            argDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+            D3D12_COMMAND_SIGNATURE_DESC sigDesc = {};
+            sigDesc.ByteStride = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+            sigDesc.NumArgumentDescs = 1;
+            sigDesc.pArgumentDescs = &argDesc;
+            d3d_call(gpDevice->getApiHandle()->CreateCommandSignature(&sigDesc, nullptr, IID_PPV_ARGS(&mpDrawIndexedSignature)));
+        }
+
+        // Buffers with CPU write access live on the upload heap, which is always readable as indirect arguments
+        if(pArgBuffer->getCpuAccess() != Buffer::CpuAccess::Write)
+        {
+            resourceBarrier(pArgBuffer, Resource::State::IndirectArg);
+        }
+
+        prepareForDraw();
+
+        // Dynamic buffers are sub-allocated, so the API offset is relative to the start of the underlying resource
+        ID3D12Resource* pResource = pArgBuffer->getApiHandle();
+        uint64_t offset = pArgBuffer->getGpuAddress() - pResource->GetGPUVirtualAddress() + argBufferOffset;
+        mpLowLevelData->getCommandList()->ExecuteIndirect(mpDrawIndexedSignature, drawCount, pResource, offset, nullptr, 0);
+    }
+
     void RenderContext::applyProgramVars() {}
     void RenderContext::applyGraphicsState() {}
 }
@@ -49,6 +49,7 @@ namespace Falcor
     MAKE_SMART_COM_PTR(ID3D12ShaderReflection);
     MAKE_SMART_COM_PTR(ID3D12RootSignature);
     MAKE_SMART_COM_PTR(ID3D12QueryHeap);
+    MAKE_SMART_COM_PTR(ID3D12CommandSignature);
     MAKE_SMART_COM_PTR(IUnknown);
     
     using ApiObjectHandle = IUnknownPtr;
@@ -77,6 +78,7 @@ namespace Falcor
     using ShaderHandle = D3D12_SHADER_BYTECODE;
     using ShaderReflectionHandle = ID3D12ShaderReflectionPtr;
     using RootSignatureHandle = ID3D12RootSignaturePtr;
+    using CommandSignatureHandle = ID3D12CommandSignaturePtr;
     using DescriptorHeapHandle = ID3D12DescriptorHeapPtr;
 
     using VaoHandle = void*;
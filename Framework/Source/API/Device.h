@@ -32,6 +32,7 @@
 #include "API/RenderContext.h"
 #include "Api/LowLevel/DescriptorHeap.h"
 #include "API/LowLevel/ResourceAllocator.h"
+#include "API/AsyncCopyQueue.h"
 
 namespace Falcor
 {
@@ -95,6 +96,10 @@ namespace Falcor
 		*/
 		RenderContext::SharedPtr getRenderContext() const { return mpRenderContext; }
 
+        /** Get the device's copy queue. Uploads submitted to it execute in parallel to the render-context's work, see AsyncCopyQueue.
+        */
+        AsyncCopyQueue::SharedPtr getCopyQueue() const { return mpCopyQueue; }
+
 		/** Get the native API handle
 		*/
 		DeviceHandle getApiHandle() { return mApiHandle; }
@@ -138,6 +143,7 @@ namespace Falcor
 		Window::SharedPtr mpWindow;
 		void* mpPrivateData;
 		RenderContext::SharedPtr mpRenderContext;
+        AsyncCopyQueue::SharedPtr mpCopyQueue;
 		bool mVsyncOn;
         size_t mFrameID = 0;
 	};
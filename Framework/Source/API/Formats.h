@@ -120,6 +120,8 @@ namespace Falcor
         BC4Snorm,   // RGTC Signed Red
         BC5Unorm,   // RGTC Unsigned RG
         BC5Snorm,   // RGTC Signed RG
+        BC7Unorm,   // BPTC RGBA
+        BC7UnormSrgb,
     };
     
     /** Falcor format Type
@@ -253,6 +255,8 @@ namespace Falcor
 			return ResourceFormat::BC2Unorm;
 		case ResourceFormat::BC3UnormSrgb:
 			return ResourceFormat::BC3Unorm;
+		case ResourceFormat::BC7UnormSrgb:
+			return ResourceFormat::BC7Unorm;
 		case ResourceFormat::BGRA8UnormSrgb:
 			return ResourceFormat::BGRA8Unorm;
 		case ResourceFormat::BGRX8UnormSrgb:
@@ -279,6 +283,8 @@ namespace Falcor
             return ResourceFormat::BC2UnormSrgb;
         case ResourceFormat::BC3Unorm:
             return ResourceFormat::BC3UnormSrgb;
+        case ResourceFormat::BC7Unorm:
+            return ResourceFormat::BC7UnormSrgb;
         case ResourceFormat::BGRA8Unorm:
             return ResourceFormat::BGRA8UnormSrgb;
         case ResourceFormat::BGRX8Unorm:
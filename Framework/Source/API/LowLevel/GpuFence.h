@@ -61,10 +61,18 @@ namespace Falcor
         */
         void syncGpu(CommandQueueHandle pQueue);
 
+        /** Tell the GPU to wait until the fence reaches a value returned by an earlier gpuSignal() call. The queue can belong to a different context than the one which signals the fence.
+        */
+        void syncGpu(CommandQueueHandle pQueue, uint64_t value);
+
         /** Tell the CPU to wait until the fence reaches the current value
         */
         void syncCpu();
 
+        /** Tell the CPU to wait until the fence reaches a value returned by an earlier gpuSignal() call
+        */
+        void syncCpu(uint64_t value);
+
         /** Insert a signal command into the command queue. This will increase the internal value
         */
         uint64_t gpuSignal(CommandQueueHandle pQueue);
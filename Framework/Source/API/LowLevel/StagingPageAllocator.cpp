@@ -0,0 +1,195 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "StagingPageAllocator.h"
+
+namespace Falcor
+{
+    StagingPageAllocator::SharedPtr StagingPageAllocator::create(uint64_t pageSize, uint32_t maxFreePages, CreatePageFunc createPage, ReleasePageFunc releasePage)
+    {
+        return SharedPtr(new StagingPageAllocator(pageSize, maxFreePages, createPage, releasePage));
+    }
+
+    StagingPageAllocator::StagingPageAllocator(uint64_t pageSize, uint32_t maxFreePages, CreatePageFunc createPage, ReleasePageFunc releasePage) :
+        mPageSize(pageSize), mMaxFreePages(maxFreePages), mCreatePage(createPage), mReleasePage(releasePage)
+    {
+    }
+
+    uint32_t StagingPageAllocator::createPage(uint64_t size, bool dedicated)
+    {
+        uint32_t pageID;
+        if(mFreePageIDs.size())
+        {
+            pageID = mFreePageIDs.back();
+            mFreePageIDs.pop_back();
+        }
+        else
+        {
+            pageID = (uint32_t)mPages.size();
+            mPages.push_back(Page());
+        }
+
+        Page& page = mPages[pageID];
+        page = Page();
+        page.size = size;
+        page.dedicated = dedicated;
+        page.alive = true;
+        mCreatePage(pageID, size);
+        mCreatedPageCount++;
+        return pageID;
+    }
+
+    void StagingPageAllocator::releasePage(uint32_t pageID)
+    {
+        mReleasePage(pageID);
+        mPages[pageID].alive = false;
+        mFreePageIDs.push_back(pageID);
+    }
+
+    void StagingPageAllocator::addToBatch(uint32_t pageID)
+    {
+        Page& page = mPages[pageID];
+        if(page.inBatch == false)
+        {
+            page.inBatch = true;
+            mBatchPages.push_back(pageID);
+        }
+    }
+
+    void StagingPageAllocator::recyclePage(uint32_t pageID)
+    {
+        Page& page = mPages[pageID];
+        if(page.dedicated || (mFreePages.size() >= mMaxFreePages))
+        {
+            releasePage(pageID);
+        }
+        else
+        {
+            page.offset = 0;
+            mFreePages.push_back(pageID);
+        }
+    }
+
+    StagingPageAllocator::Allocation StagingPageAllocator::allocate(uint64_t size, uint64_t alignment)
+    {
+        assert((alignment & (alignment - 1)) == 0);
+        Allocation allocation;
+        mBatchBytes += size;
+
+        if(size > mPageSize)
+        {
+            allocation.pageID = createPage(size, true);
+            mPages[allocation.pageID].offset = size;
+            addToBatch(allocation.pageID);
+            return allocation;
+        }
+
+        uint64_t offset = 0;
+        if(mActivePage != kInvalidPageID)
+        {
+            offset = align_to(alignment, mPages[mActivePage].offset);
+        }
+
+        if((mActivePage == kInvalidPageID) || (offset + size > mPageSize))
+        {
+            // If the current batch used the page, submit() queues it. Otherwise it only waits for the last batch which used it.
+            if((mActivePage != kInvalidPageID) && (mPages[mActivePage].inBatch == false))
+            {
+                mPendingPages.push_back(std::make_pair(mPages[mActivePage].fenceValue, mActivePage));
+            }
+
+            if(mFreePages.size())
+            {
+                mActivePage = mFreePages.back();
+                mFreePages.pop_back();
+            }
+            else
+            {
+                mActivePage = createPage(mPageSize, false);
+            }
+            offset = 0;
+        }
+
+        mPages[mActivePage].offset = offset + size;
+        addToBatch(mActivePage);
+        allocation.pageID = mActivePage;
+        allocation.offset = offset;
+        return allocation;
+    }
+
+    void StagingPageAllocator::submit(uint64_t fenceValue)
+    {
+        for(uint32_t pageID : mBatchPages)
+        {
+            Page& page = mPages[pageID];
+            page.fenceValue = fenceValue;
+            page.inBatch = false;
+
+            // The active page keeps serving the next batches
+            if(pageID != mActivePage)
+            {
+                mPendingPages.push_back(std::make_pair(fenceValue, pageID));
+            }
+        }
+        mBatchPages.clear();
+        mBatchBytes = 0;
+    }
+
+    void StagingPageAllocator::retire(uint64_t completedFenceValue)
+    {
+        while(mPendingPages.size() && (mPendingPages.front().first <= completedFenceValue))
+        {
+            recyclePage(mPendingPages.front().second);
+            mPendingPages.pop_front();
+        }
+
+        // Once the GPU is done with the active page, it can be filled from the start
+        if(mActivePage != kInvalidPageID)
+        {
+            Page& page = mPages[mActivePage];
+            if((page.inBatch == false) && (page.fenceValue <= completedFenceValue))
+            {
+                page.offset = 0;
+            }
+        }
+    }
+
+    StagingPageAllocator::Stats StagingPageAllocator::getStats() const
+    {
+        Stats stats;
+        for(const Page& page : mPages)
+        {
+            stats.pageCount += page.alive ? 1 : 0;
+        }
+        stats.freePageCount = (uint32_t)mFreePages.size();
+        stats.pendingPageCount = (uint32_t)mPendingPages.size();
+        stats.createdPageCount = mCreatedPageCount;
+        stats.batchBytes = mBatchBytes;
+        return stats;
+    }
+}
@@ -0,0 +1,134 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <deque>
+#include <functional>
+
+namespace Falcor
+{
+    /** Suballocates staging memory from persistent pages and recycles the pages by fence value.
+        The class only does the bookkeeping. The owner creates the page resources through the callbacks, records the copies, and reports the fence values, so the logic doesn't depend on the API.
+        The allocator doesn't release the pages which are still alive when it's destroyed, the owner releases their resources.\n
+        Allocations made between 2 submit() calls form a batch. The pages a batch used are recycled once retire() is called with a fence value which reached the batch's value.
+        Allocations larger than the page size get a dedicated page, which is released instead of recycled.
+    */
+    class StagingPageAllocator
+    {
+    public:
+        using SharedPtr = std::shared_ptr<StagingPageAllocator>;
+        using SharedConstPtr = std::shared_ptr<const StagingPageAllocator>;
+
+        using CreatePageFunc = std::function<void(uint32_t pageID, uint64_t size)>;     ///< Create the resource of a page. Page IDs of released pages are reused.
+        using ReleasePageFunc = std::function<void(uint32_t pageID)>;                   ///< Release the resource of a page
+
+        static const uint32_t kInvalidPageID = uint32_t(-1);
+
+        struct Allocation
+        {
+            uint32_t pageID = kInvalidPageID;
+            uint64_t offset = 0;            ///< Offset in bytes from the start of the page
+        };
+
+        struct Stats
+        {
+            uint32_t pageCount = 0;         ///< Number of pages which exist, including dedicated pages
+            uint32_t freePageCount = 0;     ///< Number of pages waiting to be reused
+            uint32_t pendingPageCount = 0;  ///< Number of pages waiting for the GPU
+            uint64_t createdPageCount = 0;  ///< Number of pages created since the allocator was created
+            uint64_t batchBytes = 0;        ///< Bytes allocated since the last submit()
+        };
+
+        /** Create a new allocator
+            \param[in] pageSize The size in bytes of a page
+            \param[in] maxFreePages The number of idle pages to keep for reuse. Pages beyond that are released.
+            \param[in] createPage Called when a page needs to be created
+            \param[in] releasePage Called when a page is released
+        */
+        static SharedPtr create(uint64_t pageSize, uint32_t maxFreePages, CreatePageFunc createPage, ReleasePageFunc releasePage);
+
+        /** Allocate staging memory for the current batch
+            \param[in] alignment Must be a power of 2
+        */
+        Allocation allocate(uint64_t size, uint64_t alignment = 1);
+
+        /** Close the current batch. Its pages can be reused once retire() is called with a value of at least fenceValue.
+            \param[in] fenceValue The value the fence reaches when the GPU finished executing the batch's copies
+        */
+        void submit(uint64_t fenceValue);
+
+        /** Recycle the pages of the batches the GPU finished
+            \param[in] completedFenceValue The last value the fence reached on the GPU
+        */
+        void retire(uint64_t completedFenceValue);
+
+        /** Get the number of bytes allocated since the last submit()
+        */
+        uint64_t getBatchSize() const { return mBatchBytes; }
+
+        /** Get the page size
+        */
+        uint64_t getPageSize() const { return mPageSize; }
+
+        /** Get statistics
+        */
+        Stats getStats() const;
+
+    private:
+        StagingPageAllocator(uint64_t pageSize, uint32_t maxFreePages, CreatePageFunc createPage, ReleasePageFunc releasePage);
+
+        struct Page
+        {
+            uint64_t size = 0;
+            uint64_t offset = 0;        ///< The next free byte
+            uint64_t fenceValue = 0;    ///< The value of the last batch which used the page
+            bool dedicated = false;
+            bool inBatch = false;       ///< True if the current batch allocated from the page
+            bool alive = false;
+        };
+
+        uint32_t createPage(uint64_t size, bool dedicated);
+        void releasePage(uint32_t pageID);
+        void addToBatch(uint32_t pageID);
+        void recyclePage(uint32_t pageID);
+
+        uint64_t mPageSize;
+        uint32_t mMaxFreePages;
+        CreatePageFunc mCreatePage;
+        ReleasePageFunc mReleasePage;
+
+        std::vector<Page> mPages;                                   ///< Indexed by page ID
+        std::vector<uint32_t> mFreePageIDs;                         ///< IDs of released pages
+        std::vector<uint32_t> mFreePages;                           ///< Idle pages
+        std::vector<uint32_t> mBatchPages;                          ///< Pages the current batch allocated from
+        std::deque<std::pair<uint64_t, uint32_t>> mPendingPages;    ///< Pages of submitted batches, with the fence value they wait for. Sorted by fence value.
+        uint32_t mActivePage = kInvalidPageID;
+        uint64_t mBatchBytes = 0;
+        uint64_t mCreatedPageCount = 0;
+    };
+}
@@ -108,9 +108,11 @@ namespace Falcor
         {ResourceFormat::BC4Snorm,                  GL_NONE,                    GL_NONE,            GL_COMPRESSED_SIGNED_RED_RGTC1},
         {ResourceFormat::BC5Unorm,                  GL_NONE,                    GL_NONE,            GL_COMPRESSED_RG_RGTC2},
         {ResourceFormat::BC5Snorm,                  GL_NONE,                    GL_NONE,            GL_COMPRESSED_SIGNED_RG_RGTC2},
+        {ResourceFormat::BC7Unorm,                  GL_NONE,                    GL_NONE,            GL_COMPRESSED_RGBA_BPTC_UNORM},
+        {ResourceFormat::BC7UnormSrgb,              GL_NONE,                    GL_NONE,            GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM},
     };
 
-    static_assert(arraysize(kGlFormatDesc) == (uint32_t)ResourceFormat::BC5Snorm + 1, "gGlFormatDesc[] array size mismatch.");
+    static_assert(arraysize(kGlFormatDesc) == (uint32_t)ResourceFormat::BC7UnormSrgb + 1, "gGlFormatDesc[] array size mismatch.");
 
 
 	const GLenum kGlTextureTarget[] =
@@ -0,0 +1,264 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ParameterBlockLayout.h"
+#include "Data/HostDeviceData.h"
+#include <cstddef>
+
+namespace Falcor
+{
+    void ParameterBlockLayout::addField(const std::string& name, size_t offset, size_t elementSize, ProgramReflection::Variable::Type type, uint32_t arraySize)
+    {
+        Field field;
+        field.name = name;
+        field.offset = offset;
+        field.elementSize = elementSize;
+        field.arraySize = arraySize;
+        field.type = type;
+        mFields.push_back(field);
+        mSize = std::max(mSize, offset + elementSize * std::max(arraySize, 1u));
+    }
+
+    bool ParameterBlockLayout::validate(const ProgramReflection::BufferReflection* pReflector, const std::string& varName, size_t& offset, std::string& log) const
+    {
+        offset = kInvalidOffset;
+        if(mFields.empty())
+        {
+            log += "Layout has no fields.\n";
+            return false;
+        }
+
+        const std::string prefix = varName + ".";
+        bool isConstantBuffer = (pReflector->getType() == ProgramReflection::BufferReflection::Type::Constant);
+
+        // The first field anchors the variable. The other fields are checked relative to it.
+        const ProgramReflection::Variable* pFirst = pReflector->getVariableData(prefix + mFields[0].name, true);
+        if(pFirst == nullptr)
+        {
+            log += "Variable '" + varName + "' not found in buffer '" + pReflector->getName() + "'.\n";
+            return false;
+        }
+        if(pFirst->location < mFields[0].offset)
+        {
+            log += "Field '" + mFields[0].name + "' is at offset " + std::to_string(pFirst->location) + ", before the start of the variable.\n";
+            return false;
+        }
+        size_t baseOffset = pFirst->location - mFields[0].offset;
+
+        bool valid = true;
+        for(const Field& field : mFields)
+        {
+            const ProgramReflection::Variable* pVar = pReflector->getVariableData(prefix + field.name, true);
+            if(pVar == nullptr)
+            {
+                log += "Field '" + field.name + "' not found.\n";
+                valid = false;
+                continue;
+            }
+
+            if(pVar->location != baseOffset + field.offset)
+            {
+                log += "Field '" + field.name + "' is at offset " + std::to_string(pVar->location - baseOffset) + " in the shader, but at offset " + std::to_string(field.offset) + " in C++.\n";
+                valid = false;
+            }
+            if(pVar->type != field.type)
+            {
+                log += "Field '" + field.name + "' is declared as " + to_string(pVar->type) + " in the shader, but as " + to_string(field.type) + " in C++.\n";
+                valid = false;
+            }
+            if(pVar->arraySize != field.arraySize)
+            {
+                log += "Field '" + field.name + "' has array size " + std::to_string(pVar->arraySize) + " in the shader, but " + std::to_string(field.arraySize) + " in C++.\n";
+                valid = false;
+            }
+            else if(field.arraySize > 0)
+            {
+                // Not every API reports the array stride. Constant buffers always place array elements at 16-byte boundaries.
+                bool strideMatch = pVar->arrayStride ? (pVar->arrayStride == field.elementSize) : ((isConstantBuffer == false) || (field.elementSize % 16) == 0);
+                if(strideMatch == false)
+                {
+                    log += "Field '" + field.name + "' has a different array stride in the shader and in C++ (" + std::to_string(field.elementSize) + " bytes).\n";
+                    valid = false;
+                }
+            }
+        }
+
+        if(baseOffset + mSize > pReflector->getRequiredSize())
+        {
+            log += "Variable '" + varName + "' ends at offset " + std::to_string(baseOffset + mSize) + ", after the end of buffer '" + pReflector->getName() + "'.\n";
+            valid = false;
+        }
+
+        if(valid)
+        {
+            offset = baseOffset;
+        }
+        return valid;
+    }
+
+    size_t ParameterBlockLayout::getOffset(const ProgramReflection::BufferReflection::SharedConstPtr& pReflector, const std::string& varName) const
+    {
+        if(pReflector == nullptr)
+        {
+            return kInvalidOffset;
+        }
+
+        auto it = mValidatedBuffers.find(pReflector.get());
+        if(it == mValidatedBuffers.end() || it->second.pReflector.expired())
+        {
+            // A new reflection object. Drop the ones that were released, since their addresses can be reused.
+            for(auto entry = mValidatedBuffers.begin(); entry != mValidatedBuffers.end();)
+            {
+                entry = entry->second.pReflector.expired() ? mValidatedBuffers.erase(entry) : std::next(entry);
+            }
+            ValidatedBuffer validated;
+            validated.pReflector = pReflector;
+            it = mValidatedBuffers.insert(std::make_pair(pReflector.get(), validated)).first;
+        }
+
+        auto& offsets = it->second.offsets;
+        const auto& offsetIt = offsets.find(varName);
+        if(offsetIt != offsets.end())
+        {
+            return offsetIt->second;
+        }
+
+        size_t offset;
+        std::string log;
+        if(validate(pReflector.get(), varName, offset, log) == false)
+        {
+            logWarning("Layout mismatch when setting variable '" + varName + "' into buffer '" + pReflector->getName() + "'. The variable will not be set.\n" + log);
+        }
+        offsets[varName] = offset;
+        return offset;
+    }
+
+#define add_field(struct_, field_) layout.addField<decltype(struct_::field_)>(#field_, offsetof(struct_, field_))
+
+    const ParameterBlockLayout& ParameterBlockTraits<CameraData>::getLayout()
+    {
+        static const ParameterBlockLayout sLayout = []()
+        {
+            ParameterBlockLayout layout;
+            add_field(CameraData, viewMat);
+            add_field(CameraData, projMat);
+            add_field(CameraData, viewProjMat);
+            add_field(CameraData, invViewProj);
+            add_field(CameraData, prevViewProjMat);
+            add_field(CameraData, position);
+            add_field(CameraData, fovY);
+            add_field(CameraData, up);
+            add_field(CameraData, aspectRatio);
+            add_field(CameraData, target);
+            add_field(CameraData, nearZ);
+            add_field(CameraData, cameraU);
+            add_field(CameraData, farZ);
+            add_field(CameraData, cameraV);
+            add_field(CameraData, jitterX);
+            add_field(CameraData, cameraW);
+            add_field(CameraData, jitterY);
+            add_field(CameraData, rightEyeViewMat);
+            add_field(CameraData, rightEyeProjMat);
+            add_field(CameraData, rightEyeViewProjMat);
+            add_field(CameraData, rightEyePrevViewProjMat);
+            return layout;
+        }();
+        return sLayout;
+    }
+
+    const ParameterBlockLayout& ParameterBlockTraits<MaterialData>::getLayout()
+    {
+        static const ParameterBlockLayout sLayout = []()
+        {
+            ParameterBlockLayout layout;
+            // Arrays of structs are reflected per element, so the elements are added one by one
+            for(uint32_t i = 0; i < MatMaxLayers; i++)
+            {
+                const std::string name = "desc.layers[" + std::to_string(i) + "].";
+                size_t offset = offsetof(MaterialData, desc.layers) + i * sizeof(MaterialLayerDesc);
+                layout.addField<uint32_t>(name + "type", offset + offsetof(MaterialLayerDesc, type));
+                layout.addField<uint32_t>(name + "ndf", offset + offsetof(MaterialLayerDesc, ndf));
+                layout.addField<uint32_t>(name + "blending", offset + offsetof(MaterialLayerDesc, blending));
+                layout.addField<uint32_t>(name + "hasTexture", offset + offsetof(MaterialLayerDesc, hasTexture));
+            }
+            add_field(MaterialData, desc.hasAlphaMap);
+            add_field(MaterialData, desc.hasNormalMap);
+            add_field(MaterialData, desc.hasHeightMap);
+            add_field(MaterialData, desc.hasAmbientMap);
+            for(uint32_t i = 0; i < MatNumTypes; i++)
+            {
+                const std::string name = "desc.layerIdByType[" + std::to_string(i) + "].";
+                size_t offset = offsetof(MaterialData, desc.layerIdByType) + i * sizeof(LayerIdxByType);
+                layout.addField<glm::vec3>(name + "pad", offset + offsetof(LayerIdxByType, pad));
+                layout.addField<int32_t>(name + "id", offset + offsetof(LayerIdxByType, id));
+            }
+
+            for(uint32_t i = 0; i < MatMaxLayers; i++)
+            {
+                const std::string name = "values.layers[" + std::to_string(i) + "].";
+                size_t offset = offsetof(MaterialData, values.layers) + i * sizeof(MaterialLayerValues);
+                layout.addField<glm::vec4>(name + "albedo", offset + offsetof(MaterialLayerValues, albedo));
+                layout.addField<glm::vec4>(name + "roughness", offset + offsetof(MaterialLayerValues, roughness));
+                layout.addField<glm::vec4>(name + "extraParam", offset + offsetof(MaterialLayerValues, extraParam));
+                layout.addField<glm::vec3>(name + "pad", offset + offsetof(MaterialLayerValues, pad));
+                layout.addField<float>(name + "pmf", offset + offsetof(MaterialLayerValues, pmf));
+            }
+            add_field(MaterialData, values.height);
+            add_field(MaterialData, values.alphaThreshold);
+            add_field(MaterialData, values.id);
+            return layout;
+        }();
+        return sLayout;
+    }
+
+    const ParameterBlockLayout& ParameterBlockTraits<LightData>::getLayout()
+    {
+        static const ParameterBlockLayout sLayout = []()
+        {
+            ParameterBlockLayout layout;
+            add_field(LightData, worldPos);
+            add_field(LightData, type);
+            add_field(LightData, worldDir);
+            add_field(LightData, openingAngle);
+            add_field(LightData, intensity);
+            add_field(LightData, cosOpeningAngle);
+            add_field(LightData, aabbMin);
+            add_field(LightData, penumbraAngle);
+            add_field(LightData, aabbMax);
+            add_field(LightData, surfaceArea);
+            add_field(LightData, tangent);
+            add_field(LightData, numIndices);
+            add_field(LightData, bitangent);
+            add_field(LightData, pad);
+            add_field(LightData, transMat);
+            return layout;
+        }();
+        return sLayout;
+    }
+#undef add_field
+}
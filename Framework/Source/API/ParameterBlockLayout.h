@@ -0,0 +1,197 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "API/ProgramReflection.h"
+
+namespace Falcor
+{
+    struct CameraData;
+    struct MaterialData;
+    struct LightData;
+
+    /** Maps a C++ type to the reflection type of the matching shader type. Arrays map to their element type.
+        Types without a shader equivalent map to Variable::Type::Unknown.
+    */
+    template<typename T>
+    struct ReflectionType
+    {
+        static const ProgramReflection::Variable::Type kType = ProgramReflection::Variable::Type::Unknown;
+        static const uint32_t kArraySize = 0;
+        using ElementType = T;
+    };
+
+    template<typename T, size_t N>
+    struct ReflectionType<T[N]>
+    {
+        static const ProgramReflection::Variable::Type kType = ReflectionType<T>::kType;
+        static const uint32_t kArraySize = (uint32_t)N;
+        using ElementType = T;
+    };
+
+#define c_to_prog(cType, progType) template<> struct ReflectionType<cType> { static const ProgramReflection::Variable::Type kType = ProgramReflection::Variable::Type::progType; static const uint32_t kArraySize = 0; using ElementType = cType; };
+    c_to_prog(bool, Bool);
+    c_to_prog(glm::bvec2, Bool2);
+    c_to_prog(glm::bvec3, Bool3);
+    c_to_prog(glm::bvec4, Bool4);
+
+    c_to_prog(int32_t, Int);
+    c_to_prog(glm::ivec2, Int2);
+    c_to_prog(glm::ivec3, Int3);
+    c_to_prog(glm::ivec4, Int4);
+
+    c_to_prog(uint32_t, Uint);
+    c_to_prog(glm::uvec2, Uint2);
+    c_to_prog(glm::uvec3, Uint3);
+    c_to_prog(glm::uvec4, Uint4);
+
+    c_to_prog(float, Float);
+    c_to_prog(glm::vec2, Float2);
+    c_to_prog(glm::vec3, Float3);
+    c_to_prog(glm::vec4, Float4);
+
+    c_to_prog(glm::mat2, Float2x2);
+    c_to_prog(glm::mat2x3, Float2x3);
+    c_to_prog(glm::mat2x4, Float2x4);
+
+    c_to_prog(glm::mat3, Float3x3);
+    c_to_prog(glm::mat3x2, Float3x2);
+    c_to_prog(glm::mat3x4, Float3x4);
+
+    c_to_prog(glm::mat4, Float4x4);
+    c_to_prog(glm::mat4x2, Float4x2);
+    c_to_prog(glm::mat4x3, Float4x3);
+
+    c_to_prog(uint64_t, GpuPtr);
+#undef c_to_prog
+
+    /** Layout of a host struct which is shared with shaders, such as the structs in Data/HostDeviceData.h.
+        The layout lists the struct's leaf fields, with their C++ offsets and types. It is declared once per struct (see ParameterBlockTraits), and validated against the reflection of every buffer it's written into.
+        When the C++ and shader layouts match, the struct can be written into the buffer with a single copy, instead of setting each field by name.
+    */
+    class ParameterBlockLayout
+    {
+    public:
+        static const size_t kInvalidOffset = ProgramReflection::kInvalidLocation;
+
+        struct Field
+        {
+            std::string name;                   ///< Name of the field relative to the struct, as reflected. Fields nested in structs or arrays of structs use the full path, for example 'layers[0].albedo'.
+            size_t offset = 0;                  ///< Offset of the field in the C++ struct
+            size_t elementSize = 0;             ///< Size of the field in the C++ struct. For arrays, the size of a single element.
+            uint32_t arraySize = 0;             ///< Array size, or 0 if not an array
+            ProgramReflection::Variable::Type type = ProgramReflection::Variable::Type::Unknown;
+        };
+
+        /** Add a field
+            \param[in] name The field name, relative to the struct
+            \param[in] offset The offset of the field in the C++ struct
+        */
+        template<typename FieldType>
+        void addField(const std::string& name, size_t offset)
+        {
+            static_assert(ReflectionType<FieldType>::kType != ProgramReflection::Variable::Type::Unknown, "Field type has no shader equivalent");
+            addField(name, offset, sizeof(typename ReflectionType<FieldType>::ElementType), ReflectionType<FieldType>::kType, ReflectionType<FieldType>::kArraySize);
+        }
+
+        /** Add a field
+            \param[in] name The field name, relative to the struct
+            \param[in] offset The offset of the field in the C++ struct
+            \param[in] elementSize The size of the field, or of a single element for arrays
+            \param[in] type The type of the field
+            \param[in] arraySize The array size, or 0 if the field is not an array
+        */
+        void addField(const std::string& name, size_t offset, size_t elementSize, ProgramReflection::Variable::Type type, uint32_t arraySize);
+
+        /** Get the fields
+        */
+        const std::vector<Field>& getFields() const { return mFields; }
+
+        /** Get the number of bytes written into a buffer, which is the end of the last field. Data after it in the C++ struct (for example resources) is not part of the layout.
+        */
+        size_t getSize() const { return mSize; }
+
+        /** Validate the layout against a buffer's reflection.
+            Every field must be declared in the buffer at the same offset from the start of the variable as in the C++ struct, with the same type and array size. Arrays in constant buffers must have elements that are multiples of 16 bytes, which is the shader's array stride.
+            \param[in] pReflector The buffer reflection
+            \param[in] varName The name of the struct variable in the buffer
+            \param[out] offset The offset of the variable in the buffer
+            \param[out] log Description of the mismatches, if any
+            \return true if the layout matches
+        */
+        bool validate(const ProgramReflection::BufferReflection* pReflector, const std::string& varName, size_t& offset, std::string& log) const;
+
+        /** Get the offset of a variable in a buffer.
+            The layout is validated the first time it's used with a reflection object, which is created when the program is linked. The result is cached for the lifetime of the reflection object, so later calls don't look up any field names. Mismatches are logged once.
+            \param[in] pReflector The buffer reflection
+            \param[in] varName The name of the struct variable in the buffer
+            \return The offset of the variable, or kInvalidOffset if the variable is missing or doesn't match the layout
+        */
+        size_t getOffset(const ProgramReflection::BufferReflection::SharedConstPtr& pReflector, const std::string& varName) const;
+
+    private:
+        std::vector<Field> mFields;
+        size_t mSize = 0;
+
+        struct ValidatedBuffer
+        {
+            std::weak_ptr<const ProgramReflection::BufferReflection> pReflector;
+            std::unordered_map<std::string, size_t> offsets;
+        };
+        mutable std::unordered_map<const ProgramReflection::BufferReflection*, ValidatedBuffer> mValidatedBuffers;
+    };
+
+    /** Declares the layout of a host/device shared struct. Specialize it with a static getLayout() function for every struct that's written with ConstantBuffer::setParameterBlock().
+    */
+    template<typename DataType>
+    struct ParameterBlockTraits;
+
+    template<>
+    struct ParameterBlockTraits<CameraData>
+    {
+        static const ParameterBlockLayout& getLayout();
+    };
+
+    /** The material's desc and values. The textures and the sampler are not part of the layout.
+    */
+    template<>
+    struct ParameterBlockTraits<MaterialData>
+    {
+        static const ParameterBlockLayout& getLayout();
+    };
+
+    /** All the fields except for the material, which must be the last field
+    */
+    template<>
+    struct ParameterBlockTraits<LightData>
+    {
+        static const ParameterBlockLayout& getLayout();
+    };
+}
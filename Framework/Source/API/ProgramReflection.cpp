@@ -29,6 +29,8 @@
 #include "Framework.h"
 #include "ProgramReflection.h"
 #include "Utils/StringUtils.h"
+#include <algorithm>
+#include <cstring>
 
 namespace Falcor
 {
@@ -38,6 +40,19 @@ namespace Falcor
         return pReflection->init(pProgramVersion, log) ? pReflection : nullptr;
     }
 
+    ProgramReflection::SharedPtr ProgramReflection::create(const BufferData buffers[BufferReflection::kTypeCount], const VariableMap& vertAttr, const VariableMap& fragOut, const ResourceMap& resources)
+    {
+        SharedPtr pReflection = SharedPtr(new ProgramReflection);
+        for(uint32_t i = 0; i < BufferReflection::kTypeCount; i++)
+        {
+            pReflection->mBuffers[i] = buffers[i];
+        }
+        pReflection->mVertAttr = vertAttr;
+        pReflection->mFragOut = fragOut;
+        pReflection->mResources = resources;
+        return pReflection;
+    }
+
     ProgramReflection::BindLocation ProgramReflection::getBufferBinding(const std::string& name) const
     {
         // Names are unique regardless of buffer type. Search in each map
@@ -209,4 +224,406 @@ namespace Falcor
         }
         return pRes;
     }
-}
\ No newline at end of file
+
+    // Blob layout: BlobHeader, BlobBuffer[bufferCount], BlobVariable[variableCount], BlobResource[resourceCount], uint32_t stringOffsets[stringCount], char stringData[stringDataSize].
+    // Every name in the records is an index into the string table. The variables of each buffer are stored contiguously, followed by the vertex attributes and then the fragment outputs.
+    // The resources of each buffer are stored contiguously, followed by the global resources.
+    // The records are made of 4 and 8 byte fields only, so the layout doesn't depend on the compiler's padding rules.
+    static const char kBlobFormatID[4] = { 'F', 'R', 'F', 'L' };
+
+    struct BlobHeader
+    {
+        char formatID[4];
+        uint32_t version;
+        uint32_t blobSize;
+        uint32_t bufferCount;
+        uint32_t variableCount;
+        uint32_t resourceCount;
+        uint32_t vertexAttribCount;
+        uint32_t fragOutCount;
+        uint32_t globalResourceCount;
+        uint32_t stringCount;
+        uint32_t stringDataSize;
+        uint32_t padding;
+    };
+
+    struct BlobBuffer
+    {
+        uint64_t size;
+        uint32_t name;
+        uint32_t type;
+        uint32_t regIndex;
+        uint32_t regSpace;
+        uint32_t shaderAccess;
+        uint32_t shaderMask;
+        uint32_t firstVariable;
+        uint32_t variableCount;
+        uint32_t firstResource;
+        uint32_t resourceCount;
+    };
+
+    struct BlobVariable
+    {
+        uint64_t location;
+        uint32_t name;
+        uint32_t arraySize;
+        uint32_t arrayStride;
+        uint32_t type;
+        uint32_t isRowMajor;
+        uint32_t padding;
+    };
+
+    struct BlobResource
+    {
+        uint32_t name;
+        uint32_t shaderAccess;
+        uint32_t type;
+        uint32_t dims;
+        uint32_t retType;
+        uint32_t regIndex;
+        uint32_t arraySize;
+        uint32_t shaderMask;
+        uint32_t registerSpace;
+    };
+
+    static_assert(sizeof(BlobHeader) == 48, "BlobHeader has unexpected padding");
+    static_assert(sizeof(BlobBuffer) == 48, "BlobBuffer has unexpected padding");
+    static_assert(sizeof(BlobVariable) == 32, "BlobVariable has unexpected padding");
+    static_assert(sizeof(BlobResource) == 36, "BlobResource has unexpected padding");
+
+    class BlobStringTable
+    {
+    public:
+        uint32_t intern(const std::string& str)
+        {
+            const auto& it = mIndices.find(str);
+            if(it != mIndices.end())
+            {
+                return it->second;
+            }
+
+            uint32_t index = (uint32_t)mOffsets.size();
+            mOffsets.push_back((uint32_t)mData.size());
+            mData.insert(mData.end(), str.begin(), str.end());
+            mData.push_back('\0');
+            mIndices[str] = index;
+            return index;
+        }
+
+        const std::vector<uint32_t>& getOffsets() const { return mOffsets; }
+        const std::vector<char>& getData() const { return mData; }
+    private:
+        std::unordered_map<std::string, uint32_t> mIndices;
+        std::vector<uint32_t> mOffsets;
+        std::vector<char> mData;
+    };
+
+    // The variable maps are unordered. Sort the entries by name so that the blob is deterministic.
+    template<typename IteratorType>
+    static std::vector<IteratorType> sortByName(IteratorType begin, IteratorType end)
+    {
+        std::vector<IteratorType> sorted;
+        for(auto it = begin; it != end; it++)
+        {
+            sorted.push_back(it);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const IteratorType& a, const IteratorType& b) { return a->first < b->first; });
+        return sorted;
+    }
+
+    template<typename IteratorType>
+    static void appendVariables(IteratorType begin, IteratorType end, BlobStringTable& strings, std::vector<BlobVariable>& variables)
+    {
+        for(const auto& it : sortByName(begin, end))
+        {
+            const ProgramReflection::Variable& var = it->second;
+            BlobVariable record = {};
+            record.location = var.location;
+            record.name = strings.intern(it->first);
+            record.arraySize = var.arraySize;
+            record.arrayStride = var.arrayStride;
+            record.type = (uint32_t)var.type;
+            record.isRowMajor = var.isRowMajor ? 1 : 0;
+            variables.push_back(record);
+        }
+    }
+
+    template<typename IteratorType>
+    static void appendResources(IteratorType begin, IteratorType end, BlobStringTable& strings, std::vector<BlobResource>& resources)
+    {
+        for(const auto& it : sortByName(begin, end))
+        {
+            const ProgramReflection::Resource& res = it->second;
+            BlobResource record = {};
+            record.name = strings.intern(it->first);
+            record.shaderAccess = (uint32_t)res.shaderAccess;
+            record.type = (uint32_t)res.type;
+            record.dims = (uint32_t)res.dims;
+            record.retType = (uint32_t)res.retType;
+            record.regIndex = res.regIndex;
+            record.arraySize = res.arraySize;
+            record.shaderMask = res.shaderMask;
+            record.registerSpace = res.registerSpace;
+            resources.push_back(record);
+        }
+    }
+
+    template<typename T>
+    static void copySection(std::vector<uint8_t>& blob, size_t& offset, const std::vector<T>& data)
+    {
+        size_t size = data.size() * sizeof(T);
+        if(size)
+        {
+            memcpy(blob.data() + offset, data.data(), size);
+        }
+        offset += size;
+    }
+
+    void ProgramReflection::serialize(std::vector<uint8_t>& blob) const
+    {
+        BlobStringTable strings;
+        std::vector<BlobBuffer> buffers;
+        std::vector<BlobVariable> variables;
+        std::vector<BlobResource> resources;
+
+        for(uint32_t type = 0; type < BufferReflection::kTypeCount; type++)
+        {
+            std::vector<const BufferReflection*> sortedBuffers;
+            for(const auto& it : mBuffers[type].descMap)
+            {
+                sortedBuffers.push_back(it.second.get());
+            }
+            std::sort(sortedBuffers.begin(), sortedBuffers.end(), [](const BufferReflection* pA, const BufferReflection* pB) { return pA->getName() < pB->getName(); });
+
+            for(const BufferReflection* pBuffer : sortedBuffers)
+            {
+                BlobBuffer record = {};
+                record.size = pBuffer->getRequiredSize();
+                record.name = strings.intern(pBuffer->getName());
+                record.type = type;
+                record.regIndex = pBuffer->getRegisterIndex();
+                record.regSpace = pBuffer->getRegisterSpace();
+                record.shaderAccess = (uint32_t)pBuffer->getShaderAccess();
+                record.shaderMask = pBuffer->getShaderMask();
+                record.firstVariable = (uint32_t)variables.size();
+                appendVariables(pBuffer->varBegin(), pBuffer->varEnd(), strings, variables);
+                record.variableCount = (uint32_t)variables.size() - record.firstVariable;
+                record.firstResource = (uint32_t)resources.size();
+                appendResources(pBuffer->resourceBegin(), pBuffer->resourceEnd(), strings, resources);
+                record.resourceCount = (uint32_t)resources.size() - record.firstResource;
+                buffers.push_back(record);
+            }
+        }
+
+        appendVariables(mVertAttr.begin(), mVertAttr.end(), strings, variables);
+        appendVariables(mFragOut.begin(), mFragOut.end(), strings, variables);
+        appendResources(mResources.begin(), mResources.end(), strings, resources);
+
+        BlobHeader header = {};
+        memcpy(header.formatID, kBlobFormatID, sizeof(kBlobFormatID));
+        header.version = kBlobVersion;
+        header.bufferCount = (uint32_t)buffers.size();
+        header.variableCount = (uint32_t)variables.size();
+        header.resourceCount = (uint32_t)resources.size();
+        header.vertexAttribCount = (uint32_t)mVertAttr.size();
+        header.fragOutCount = (uint32_t)mFragOut.size();
+        header.globalResourceCount = (uint32_t)mResources.size();
+        header.stringCount = (uint32_t)strings.getOffsets().size();
+        header.stringDataSize = (uint32_t)strings.getData().size();
+
+        size_t blobSize = sizeof(BlobHeader) + buffers.size() * sizeof(BlobBuffer) + variables.size() * sizeof(BlobVariable) + resources.size() * sizeof(BlobResource);
+        blobSize += strings.getOffsets().size() * sizeof(uint32_t) + strings.getData().size();
+        header.blobSize = (uint32_t)blobSize;
+
+        blob.assign(blobSize, 0);
+        memcpy(blob.data(), &header, sizeof(header));
+        size_t offset = sizeof(header);
+        copySection(blob, offset, buffers);
+        copySection(blob, offset, variables);
+        copySection(blob, offset, resources);
+        copySection(blob, offset, strings.getOffsets());
+        copySection(blob, offset, strings.getData());
+        assert(offset == blobSize);
+    }
+
+    // Reads the sections of a blob. The records are copied out with memcpy, so the blob doesn't need to be aligned.
+    class BlobReader
+    {
+    public:
+        bool init(const void* pData, size_t size)
+        {
+            const uint8_t* pBytes = (const uint8_t*)pData;
+            if(pBytes == nullptr || size < sizeof(BlobHeader))
+            {
+                return false;
+            }
+
+            memcpy(&mHeader, pBytes, sizeof(BlobHeader));
+            if(memcmp(mHeader.formatID, kBlobFormatID, sizeof(kBlobFormatID)) != 0 || mHeader.version != ProgramReflection::kBlobVersion || mHeader.blobSize != size)
+            {
+                return false;
+            }
+
+            // Use 64-bit math, so that corrupt counts can't overflow the offsets
+            uint64_t offset = sizeof(BlobHeader);
+            mpBuffers = pBytes + offset;
+            offset += uint64_t(mHeader.bufferCount) * sizeof(BlobBuffer);
+            mpVariables = pBytes + offset;
+            offset += uint64_t(mHeader.variableCount) * sizeof(BlobVariable);
+            mpResources = pBytes + offset;
+            offset += uint64_t(mHeader.resourceCount) * sizeof(BlobResource);
+            const uint8_t* pOffsets = pBytes + offset;
+            offset += uint64_t(mHeader.stringCount) * sizeof(uint32_t);
+            const char* pStrings = (const char*)(pBytes + offset);
+            offset += mHeader.stringDataSize;
+
+            if(offset != size)
+            {
+                return false;
+            }
+
+            uint64_t globalVariableCount = uint64_t(mHeader.vertexAttribCount) + mHeader.fragOutCount;
+            if(globalVariableCount > mHeader.variableCount || mHeader.globalResourceCount > mHeader.resourceCount)
+            {
+                return false;
+            }
+
+            // Every string is null-terminated, so the table must end with a terminator
+            if(mHeader.stringDataSize > 0 && pStrings[mHeader.stringDataSize - 1] != '\0')
+            {
+                return false;
+            }
+
+            mNames.resize(mHeader.stringCount);
+            for(uint32_t i = 0; i < mHeader.stringCount; i++)
+            {
+                uint32_t stringOffset;
+                memcpy(&stringOffset, pOffsets + i * sizeof(uint32_t), sizeof(uint32_t));
+                if(stringOffset >= mHeader.stringDataSize)
+                {
+                    return false;
+                }
+                mNames[i] = pStrings + stringOffset;
+            }
+            return true;
+        }
+
+        const BlobHeader& getHeader() const { return mHeader; }
+
+        bool getBuffer(uint32_t index, BlobBuffer& buffer) const
+        {
+            memcpy(&buffer, mpBuffers + size_t(index) * sizeof(BlobBuffer), sizeof(BlobBuffer));
+            return buffer.name < mNames.size() && buffer.type < ProgramReflection::BufferReflection::kTypeCount && buffer.shaderAccess <= (uint32_t)ProgramReflection::ShaderAccess::ReadWrite;
+        }
+
+        bool readVariables(uint32_t first, uint32_t count, ProgramReflection::VariableMap& varMap) const
+        {
+            if(uint64_t(first) + count > mHeader.variableCount)
+            {
+                return false;
+            }
+
+            for(uint32_t i = first; i < first + count; i++)
+            {
+                BlobVariable record;
+                memcpy(&record, mpVariables + size_t(i) * sizeof(BlobVariable), sizeof(BlobVariable));
+                if(record.name >= mNames.size() || record.type > (uint32_t)ProgramReflection::Variable::Type::Resource)
+                {
+                    return false;
+                }
+
+                ProgramReflection::Variable& var = varMap[mNames[record.name]];
+                var.location = (size_t)record.location;
+                var.arraySize = record.arraySize;
+                var.arrayStride = record.arrayStride;
+                var.isRowMajor = (record.isRowMajor != 0);
+                var.type = (ProgramReflection::Variable::Type)record.type;
+            }
+            return true;
+        }
+
+        bool readResources(uint32_t first, uint32_t count, ProgramReflection::ResourceMap& resourceMap) const
+        {
+            if(uint64_t(first) + count > mHeader.resourceCount)
+            {
+                return false;
+            }
+
+            for(uint32_t i = first; i < first + count; i++)
+            {
+                BlobResource record;
+                memcpy(&record, mpResources + size_t(i) * sizeof(BlobResource), sizeof(BlobResource));
+                bool valid = record.name < mNames.size();
+                valid = valid && (record.shaderAccess <= (uint32_t)ProgramReflection::ShaderAccess::ReadWrite);
+                valid = valid && (record.type <= (uint32_t)ProgramReflection::Resource::ResourceType::Sampler);
+                valid = valid && (record.dims <= (uint32_t)ProgramReflection::Resource::Dimensions::Buffer);
+                valid = valid && (record.retType <= (uint32_t)ProgramReflection::Resource::ReturnType::Uint);
+                if(valid == false)
+                {
+                    return false;
+                }
+
+                ProgramReflection::Resource& res = resourceMap[mNames[record.name]];
+                res.shaderAccess = (ProgramReflection::ShaderAccess)record.shaderAccess;
+                res.type = (ProgramReflection::Resource::ResourceType)record.type;
+                res.dims = (ProgramReflection::Resource::Dimensions)record.dims;
+                res.retType = (ProgramReflection::Resource::ReturnType)record.retType;
+                res.regIndex = record.regIndex;
+                res.arraySize = record.arraySize;
+                res.shaderMask = record.shaderMask;
+                res.registerSpace = record.registerSpace;
+            }
+            return true;
+        }
+
+        const std::string& getName(uint32_t index) const { return mNames[index]; }
+    private:
+        BlobHeader mHeader;
+        const uint8_t* mpBuffers = nullptr;
+        const uint8_t* mpVariables = nullptr;
+        const uint8_t* mpResources = nullptr;
+        std::vector<std::string> mNames;
+    };
+
+    ProgramReflection::SharedPtr ProgramReflection::createFromBlob(const void* pData, size_t size)
+    {
+        BlobReader reader;
+        if(reader.init(pData, size) == false)
+        {
+            return nullptr;
+        }
+
+        const BlobHeader& header = reader.getHeader();
+        SharedPtr pReflection = SharedPtr(new ProgramReflection);
+        for(uint32_t i = 0; i < header.bufferCount; i++)
+        {
+            BlobBuffer record;
+            VariableMap varMap;
+            ResourceMap resourceMap;
+            bool valid = reader.getBuffer(i, record);
+            valid = valid && reader.readVariables(record.firstVariable, record.variableCount, varMap);
+            valid = valid && reader.readResources(record.firstResource, record.resourceCount, resourceMap);
+            // BufferReflection only supports register space 0
+            valid = valid && (record.regSpace == 0);
+            if(valid == false)
+            {
+                return nullptr;
+            }
+
+            const std::string& name = reader.getName(record.name);
+            BufferData& bufferData = pReflection->mBuffers[record.type];
+            BindLocation bindLocation(record.regIndex, (ShaderAccess)record.shaderAccess);
+            BufferReflection::SharedPtr pBuffer = BufferReflection::create(name, record.regIndex, record.regSpace, (BufferReflection::Type)record.type, (size_t)record.size, varMap, resourceMap, (ShaderAccess)record.shaderAccess);
+            pBuffer->setShaderMask(record.shaderMask);
+            bufferData.nameMap[name] = bindLocation;
+            bufferData.descMap[bindLocation] = pBuffer;
+        }
+
+        uint32_t firstGlobalVariable = header.variableCount - header.vertexAttribCount - header.fragOutCount;
+        uint32_t firstGlobalResource = header.resourceCount - header.globalResourceCount;
+        bool valid = reader.readVariables(firstGlobalVariable, header.vertexAttribCount, pReflection->mVertAttr);
+        valid = valid && reader.readVariables(firstGlobalVariable + header.vertexAttribCount, header.fragOutCount, pReflection->mFragOut);
+        valid = valid && reader.readResources(firstGlobalResource, header.globalResourceCount, pReflection->mResources);
+        return valid ? pReflection : nullptr;
+    }
+}
@@ -28,6 +28,7 @@
 #pragma once
 #include "Framework.h"
 #include <unordered_map>
+#include <vector>
 
 namespace Falcor
 {
@@ -294,6 +295,24 @@ namespace Falcor
         */
         static SharedPtr create(const ProgramVersion* pProgramVersion, std::string& log);
 
+        /** Create a new object from a binary blob written by serialize().
+            The blob is position independent and is only read from, so it can point directly into a memory-mapped file.
+            \param[in] pData The blob
+            \param[in] size The size of the blob in bytes
+            \return A new object, or nullptr if the blob is corrupt or was written by a different version of the format
+        */
+        static SharedPtr createFromBlob(const void* pData, size_t size);
+
+        /** Serialize the reflection data into a compact binary blob.
+            Names are interned into a single string table, and the variables, resources and buffers are stored as flat arrays of fixed-size records which reference the table by index. The output is deterministic, so identical reflection data produces identical blobs.
+            \param[out] blob The blob. Existing content is replaced.
+        */
+        void serialize(std::vector<uint8_t>& blob) const;
+
+        /** Version of the serialized blob format. Blobs written with a different version are rejected by createFromBlob().
+        */
+        static const uint32_t kBlobVersion = 1;
+
         /** Get a buffer binding index
         \param[in] name The buffer name in the program
         \return The bind location of the buffer if it is found, otherwise ProgramVersion#kInvalidLocation
@@ -340,6 +359,15 @@ namespace Falcor
         */
 
         const ResourceMap& getResourceMap() const { return mResources; }
+
+        /** Get the vertex attributes map
+        */
+        const VariableMap& getVertexAttributeMap() const { return mVertAttr; }
+
+        /** Get the fragment shader outputs map
+        */
+        const VariableMap& getFragmentOutputMap() const { return mFragOut; }
+
         /** Helper struct that holds buffer-data
         */
         struct BufferData
@@ -348,6 +376,14 @@ namespace Falcor
             string_2_bindloc_map nameMap;
         };
 
+        /** Create a new object from reflection data that was already gathered
+            \param[in] buffers The buffers, one entry per BufferReflection::Type
+            \param[in] vertAttr The vertex attributes
+            \param[in] fragOut The fragment shader outputs
+            \param[in] resources The global resources
+        */
+        static SharedPtr create(const BufferData buffers[BufferReflection::kTypeCount], const VariableMap& vertAttr, const VariableMap& fragOut, const ResourceMap& resources);
+
     private:
         bool init(const ProgramVersion* pProgVer, std::string& log);
         bool reflectVertexAttributes(const ProgramVersion* pProgVer, std::string& log);       // Input attributes
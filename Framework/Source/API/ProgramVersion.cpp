@@ -28,9 +28,28 @@
 #include "Framework.h"
 #include "API/ProgramVersion.h"
 #include "Graphics/Material/MaterialSystem.h"
+#include "Utils/BinaryFileStream.h"
+#include "Utils/OS.h"
+#include <iomanip>
+#include <sstream>
 
 namespace Falcor
 {
+    static bool gReflectionCacheEnabled = true;
+    static std::string gReflectionCacheDirectory;
+
+    // 64-bit FNV-1a
+    static uint64_t hashBytes(const void* pData, size_t size, uint64_t hash = 14695981039346656037ull)
+    {
+        const uint8_t* pBytes = (const uint8_t*)pData;
+        for(size_t i = 0; i < size; i++)
+        {
+            hash ^= pBytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
     ProgramVersion::ProgramVersion(const Shader::SharedPtr& pVS, const Shader::SharedPtr& pFS, const Shader::SharedPtr& pGS, const Shader::SharedPtr& pHS, const Shader::SharedPtr& pDS, const Shader::SharedPtr& pCS, const std::string& name) : mName(name)
     {
         mpShaders[(uint32_t)ShaderType::Vertex] = pVS;
@@ -61,8 +80,7 @@ namespace Falcor
         {
             return nullptr;
         }
-        pProgram->mpReflector = ProgramReflection::create(pProgram.get(), log);
-        if (pProgram->mpReflector == nullptr)
+        if(pProgram->initReflector(log) == false)
         {
             return nullptr;
         }
@@ -83,14 +101,102 @@ namespace Falcor
         {
             return nullptr;
         }
-        pProgram->mpReflector = ProgramReflection::create(pProgram.get(), log);
-        if (pProgram->mpReflector == nullptr)
+        if (pProgram->initReflector(log) == false)
         {
             return nullptr;
         }
         return pProgram;
     }
 
+    bool ProgramVersion::initReflector(std::string& log)
+    {
+        std::string cacheFilename = gReflectionCacheEnabled ? getReflectionCacheFilename() : std::string();
+        if(cacheFilename.size() && doesFileExist(cacheFilename))
+        {
+            BinaryFileStream stream(cacheFilename, BinaryFileStream::Mode::Read);
+            std::vector<uint8_t> blob(stream.getRemainingStreamSize());
+            stream.read(blob.data(), blob.size());
+            if(stream.isFail() == false)
+            {
+                mpReflector = ProgramReflection::createFromBlob(blob.data(), blob.size());
+            }
+
+            if(mpReflector)
+            {
+                return true;
+            }
+            logWarning("Reflection cache file '" + cacheFilename + "' is corrupt. Reflecting program " + mName + " again.");
+        }
+
+        mpReflector = ProgramReflection::create(this, log);
+        if(mpReflector == nullptr)
+        {
+            return false;
+        }
+
+        if(cacheFilename.size())
+        {
+            if(isDirectoryExists(getReflectionCacheDirectory()) == false)
+            {
+                createDirectory(getReflectionCacheDirectory());
+            }
+            std::vector<uint8_t> blob;
+            mpReflector->serialize(blob);
+            BinaryFileStream stream(cacheFilename, BinaryFileStream::Mode::Write);
+            stream.write(blob.data(), blob.size());
+        }
+        return true;
+    }
+
+    std::string ProgramVersion::getReflectionCacheFilename() const
+    {
+#ifdef FALCOR_D3D
+        // The reflection only depends on the compiled shaders, so hash the bytecode of every stage
+        uint32_t blobVersion = ProgramReflection::kBlobVersion;
+        uint64_t hash = hashBytes(&blobVersion, sizeof(blobVersion));
+        for(uint32_t i = 0; i < kShaderCount; i++)
+        {
+            if(mpShaders[i])
+            {
+                ID3DBlobPtr pBlob = mpShaders[i]->getCodeBlob();
+                hash = hashBytes(&i, sizeof(i), hash);
+                hash = hashBytes(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), hash);
+            }
+        }
+
+        std::stringstream s;
+        s << getReflectionCacheDirectory() << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".refl";
+        return s.str();
+#else
+        // No access to the program binary, so there's nothing to key the cache with
+        return std::string();
+#endif
+    }
+
+    void ProgramVersion::setReflectionCacheEnabled(bool enabled)
+    {
+        gReflectionCacheEnabled = enabled;
+    }
+
+    bool ProgramVersion::isReflectionCacheEnabled()
+    {
+        return gReflectionCacheEnabled;
+    }
+
+    void ProgramVersion::setReflectionCacheDirectory(const std::string& directory)
+    {
+        gReflectionCacheDirectory = directory;
+    }
+
+    const std::string& ProgramVersion::getReflectionCacheDirectory()
+    {
+        if(gReflectionCacheDirectory.empty())
+        {
+            gReflectionCacheDirectory = getExecutableDirectory() + "/ShaderCache";
+        }
+        return gReflectionCacheDirectory;
+    }
+
     ProgramVersion::~ProgramVersion()
     {
         MaterialSystem::removeProgramVersion(this);
@@ -96,6 +96,23 @@ namespace Falcor
         /** Get the reflection object
         */
         ProgramReflection::SharedConstPtr getReflector() const { return mpReflector; }
+
+        /** Enable or disable the reflection cache. When enabled, the reflection data of every new program version is loaded from the cache if it's there, otherwise it's reflected from the shaders and written into the cache. Enabled by default.
+            The cache files are named after a hash of the compiled shaders, so a shader change never picks up stale data.
+        */
+        static void setReflectionCacheEnabled(bool enabled);
+
+        /** Check if the reflection cache is enabled
+        */
+        static bool isReflectionCacheEnabled();
+
+        /** Set the directory the reflection cache is written into. Default is 'ShaderCache' in the executable directory.
+        */
+        static void setReflectionCacheDirectory(const std::string& directory);
+
+        /** Get the directory the reflection cache is written into
+        */
+        static const std::string& getReflectionCacheDirectory();
     private:
         ProgramVersion(const Shader::SharedPtr& pVS,
             const Shader::SharedPtr& pFS,
@@ -106,6 +123,8 @@ namespace Falcor
             const std::string& name = "");
 
         bool apiInit(std::string& log, const std::string& name);
+        bool initReflector(std::string& log);
+        std::string getReflectionCacheFilename() const;
         void deleteApiHandle();
         ProgramHandle mApiHandle = ProgramHandle();
         const std::string mName;
@@ -112,6 +112,13 @@ namespace Falcor
         */
         void drawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndexLocation, int baseVertexLocation, uint32_t startInstanceLocation);
 
+        /** Indexed draw calls which read their arguments from a buffer
+            \param[in] pArgBuffer The buffer holding the arguments. Each draw reads 5 32-bit values, laid out like the drawIndexedInstanced() arguments (see IndirectDrawPacker::DrawArguments).
+            \param[in] argBufferOffset Byte offset of the first draw's arguments
+            \param[in] drawCount Number of draws
+        */
+        void drawIndexedIndirect(const Buffer* pArgBuffer, uint64_t argBufferOffset, uint32_t drawCount);
+
         /** Blits (low-level copy) an SRV into an RTV
             \param[in] pSrc Source view to copy from
             \param[in] pDst Target view to copy to
@@ -157,6 +164,7 @@ namespace Falcor
 
         std::stack<GraphicsState::SharedPtr> mPipelineStateStack;
         std::stack<GraphicsVars::SharedPtr> mpGraphicsVarsStack;
+        CommandSignatureHandle mpDrawIndexedSignature;     ///< Created on the first drawIndexedIndirect() call
 
         struct BlitData
         {
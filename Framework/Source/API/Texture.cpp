@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "API/Texture.h"
 #include "API/Device.h"
+#include "Graphics/TextureCapture.h"
 
 namespace Falcor
 {
@@ -62,4 +63,9 @@ namespace Falcor
         std::vector<uint8> textureData = gpDevice->getRenderContext()->readTextureSubresource(this, subresource);
         Bitmap::saveImage(filename, getWidth(mipLevel), getHeight(mipLevel), format, exportFlags, getFormat(), true, textureData.data());
     }
+
+    void Texture::captureToFileAsync(uint32_t mipLevel, uint32_t arraySlice, const std::string& filename, Bitmap::FileFormat format, Bitmap::ExportFlags exportFlags, const std::function<void(const std::string&, bool)>& callback) const
+    {
+        TextureCapture::instance()->captureToFile(gpDevice->getRenderContext().get(), this, mipLevel, arraySlice, filename, format, exportFlags, callback);
+    }
 }
@@ -27,6 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include <map>
+#include <functional>
 #include "API/Formats.h"
 #include "Resource.h"
 #include "Utils/Bitmap.h"
@@ -172,6 +173,16 @@ namespace Falcor
         */
         void captureToFile(uint32_t mipLevel, uint32_t arraySlice, const std::string& filename, Bitmap::FileFormat format = Bitmap::FileFormat::PngFile, Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None) const;
 
+        /** Capture the texture to an image file without waiting for the GPU. The copy is queued on the render context, and the image is encoded and saved on a worker thread. See TextureCapture.\n
+        \param[in] mipLevel Requested mip-level
+        \param[in] arraySlice Requested array-slice
+        \param[in] filename Name of the image file
+        \param[in] fileFormat Destination image file format (e.g., PNG, PFM, etc.)
+        \param[in] exportFlags Save flags, see Bitmap::ExportFlags
+        \param[in] callback Optional function to call once the file was written. It is called from TextureCapture::update() on the render thread.
+        */
+        void captureToFileAsync(uint32_t mipLevel, uint32_t arraySlice, const std::string& filename, Bitmap::FileFormat format = Bitmap::FileFormat::PngFile, Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None, const std::function<void(const std::string&, bool)>& callback = nullptr) const;
+
         void compress2DTexture();
 		
         /** Generates mipmaps for a specified texture object.
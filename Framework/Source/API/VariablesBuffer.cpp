@@ -32,6 +32,7 @@
 #include "glm/glm.hpp"
 #include "texture.h"
 #include "API/ProgramReflection.h"
+#include "API/ParameterBlockLayout.h"
 #include "API/Device.h"
 
 namespace Falcor
@@ -41,43 +42,13 @@ namespace Falcor
     template<typename VarType>
     ProgramReflection::Variable::Type getReflectionTypeFromCType()
     {
-#define c_to_prog(cType, progType) if(typeid(VarType) == typeid(cType)) return ProgramReflection::Variable::Type::progType;
-        c_to_prog(bool,  Bool);
-        c_to_prog(bvec2, Bool2);
-        c_to_prog(bvec3, Bool3);
-        c_to_prog(bvec4, Bool4);
-
-        c_to_prog(int32_t, Int);
-        c_to_prog(ivec2, Int2);
-        c_to_prog(ivec3, Int3);
-        c_to_prog(ivec4, Int4);
-
-        c_to_prog(uint32_t, Uint);
-        c_to_prog(uvec2, Uint2);
-        c_to_prog(uvec3, Uint3);
-        c_to_prog(uvec4, Uint4);
-
-        c_to_prog(float,     Float);
-        c_to_prog(glm::vec2, Float2);
-        c_to_prog(glm::vec3, Float3);
-        c_to_prog(glm::vec4, Float4);
-
-        c_to_prog(glm::mat2,   Float2x2);
-        c_to_prog(glm::mat2x3, Float2x3);
-        c_to_prog(glm::mat2x4, Float2x4);
-
-        c_to_prog(glm::mat3  , Float3x3);
-        c_to_prog(glm::mat3x2, Float3x2);
-        c_to_prog(glm::mat3x4, Float3x4);
-        
-        c_to_prog(glm::mat4, Float4x4);
-        c_to_prog(glm::mat4x2, Float4x2);
-        c_to_prog(glm::mat4x3, Float4x3);
-
-        c_to_prog(uint64_t, GpuPtr);
-#undef c_to_prog
-        should_not_get_here();
-        return ProgramReflection::Variable::Type::Unknown;
+        // Resolved at compile time. See ReflectionType in ParameterBlockLayout.h.
+        ProgramReflection::Variable::Type type = ReflectionType<VarType>::kType;
+        if(type == ProgramReflection::Variable::Type::Unknown)
+        {
+            should_not_get_here();
+        }
+        return type;
     }
 
     VariablesBuffer::VariablesBuffer(const ProgramReflection::BufferReflection::SharedConstPtr& pReflector, size_t elementSize, size_t elementCount, BindFlags bindFlags, CpuAccess cpuAccess) :
@@ -183,6 +183,8 @@ namespace Falcor
         {
             pProg->removeDefine("HAS_TEXCRD");
             pProg->removeDefine("HAS_COLORS");
+            pProg->removeDefine("COMPACT_VERTICES");
+            pProg->removeDefine("INDIRECT_DRAW");
             for (const auto& l : mpBufferLayouts)
             {
                 if(l)
@@ -197,6 +199,15 @@ namespace Falcor
                         {
                             pProg->addDefine("HAS_COLORS");
                         }
+                        // Quantized positions mean the layout uses the compact vertex format, see VertexCompression.h
+                        if ((l->getElementShaderLocation(i) == VERTEX_POSITION_LOC) && (l->getElementFormat(i) == ResourceFormat::RGBA16Unorm))
+                        {
+                            pProg->addDefine("COMPACT_VERTICES");
+                        }
+                        if (l->getElementShaderLocation(i) == VERTEX_INSTANCE_WORLD_MAT_LOC)
+                        {
+                            pProg->addDefine("INDIRECT_DRAW");
+                        }
                     }
                 }
             }
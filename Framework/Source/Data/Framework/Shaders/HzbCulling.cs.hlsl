@@ -0,0 +1,103 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+/** Tests boxes against a hierarchical-Z pyramid. See HzbCulling, and HzbReference for the CPU version of the test.
+*/
+#include "HostDeviceData.h"
+
+static const float kFltMax = 3.402823466e+38f;
+static const float kDepthBias = 1.0e-6f;    ///< Keeps surfaces which coincide with their box from hiding themselves, when the rasterized depth rounds below the box's depth
+
+cbuffer PerFrameCB : register(b0)
+{
+    HzbCullingParams gParams;
+};
+
+Texture2D<float> gHzb;
+ByteAddressBuffer gBoxes;               ///< World-space min and max corners, 6 floats per box
+RWByteAddressBuffer gVisibility;        ///< One uint per box, 1 if the box might be visible
+
+bool isBoxVisible(float3 boxMin, float3 boxMax)
+{
+    float2 minXY = float2(kFltMax, kFltMax);
+    float2 maxXY = -minXY;
+    float minZ = kFltMax;
+
+    [unroll]
+    for (uint i = 0; i < 8; i++)
+    {
+        float3 corner = float3((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+        float4 clip = mul(gParams.viewProjMat, float4(corner, 1));
+        if ((clip.w <= 1.0e-6f) || (clip.z < 0))
+        {
+            return true;
+        }
+        float3 ndc = clip.xyz / clip.w;
+        minXY = min(minXY, ndc.xy);
+        maxXY = max(maxXY, ndc.xy);
+        minZ = min(minZ, ndc.z);
+    }
+
+    // Boxes outside of the screen are left to frustum culling
+    if ((maxXY.x < -1) || (maxXY.y < -1) || (minXY.x > 1) || (minXY.y > 1))
+    {
+        return true;
+    }
+
+    // Depth pixels covered by the box. Texture rows go down, NDC y goes up.
+    float2 uv0 = saturate(float2(minXY.x, -maxXY.y) * 0.5f + 0.5f);
+    float2 uv1 = saturate(float2(maxXY.x, -minXY.y) * 0.5f + 0.5f);
+    uint2 size = uint2(gParams.depthWidth, gParams.depthHeight);
+    uint2 p0 = min(uint2(uv0 * float2(size)), size - 1);
+    uint2 p1 = min(uint2(uv1 * float2(size)), size - 1);
+
+    // The finest level where the pixels fit in 2x2 texels. Pixel p is in texel p >> (level + 1).
+    uint level = 0;
+    while ((level + 1 < gParams.levelCount) && any(((p1 >> (level + 1)) - (p0 >> (level + 1))) > 1))
+    {
+        level++;
+    }
+
+    uint2 t0 = p0 >> (level + 1);
+    uint2 t1 = p1 >> (level + 1);
+    float maxDepth = max(max(gHzb.Load(int3(t0.x, t0.y, level)), gHzb.Load(int3(t1.x, t0.y, level))), max(gHzb.Load(int3(t0.x, t1.y, level)), gHzb.Load(int3(t1.x, t1.y, level))));
+    return minZ - kDepthBias <= maxDepth;
+}
+
+[numthreads(64, 1, 1)]
+void main(uint3 threadID : SV_DispatchThreadID)
+{
+    uint boxID = threadID.x;
+    if (boxID >= gParams.boxCount)
+    {
+        return;
+    }
+
+    float3 boxMin = asfloat(gBoxes.Load3(boxID * 24));
+    float3 boxMax = asfloat(gBoxes.Load3(boxID * 24 + 12));
+    gVisibility.Store(boxID * 4, isBoxVisible(boxMin, boxMax) ? 1 : 0);
+}
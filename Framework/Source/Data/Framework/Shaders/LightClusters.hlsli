@@ -0,0 +1,101 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#ifndef _FALCOR_LIGHT_CLUSTERS_H_
+#define _FALCOR_LIGHT_CLUSTERS_H_
+
+#include "HostDeviceData.h"
+#include "Shading.h"
+
+/** Clustered light lists, generated by LightClusterer.
+    gLightClusterGrid holds a (offset, count) pair per cluster, the offset is an index into gLightClusterIndices.
+    The light indices reference gLightClusterLights, which holds the lights in the order they were passed to LightClusterer::build().
+*/
+cbuffer LightClustersCB
+{
+    LightClusterParams gLightClusters;
+};
+
+ByteAddressBuffer gLightClusterGrid;
+ByteAddressBuffer gLightClusterIndices;
+StructuredBuffer<LightData> gLightClusterLights;
+
+/** Find the cluster containing a point
+    \param ndcXY The point's NDC coordinates (clipPos.xy / clipPos.w)
+    \param viewDepth The point's positive view-space depth
+*/
+uint getLightClusterIndex(LightClusterParams params, float2 ndcXY, float viewDepth)
+{
+    uint2 tile = uint2(saturate(ndcXY * 0.5f + 0.5f) * float2(params.tilesX, params.tilesY));
+    tile = min(tile, uint2(params.tilesX - 1, params.tilesY - 1));
+    int slice = int((log(viewDepth) - params.logNearZ) * params.logDepthScale);
+    uint z = uint(clamp(slice, 0, int(params.slicesZ) - 1));
+    return (z * params.tilesY + tile.y) * params.tilesX + tile.x;
+}
+
+/** Get the range of a cluster's light list
+    \return (offset, count)
+*/
+uint2 getLightClusterRange(uint clusterIndex)
+{
+    return gLightClusterGrid.Load2(clusterIndex * 8);
+}
+
+/** Get a light index from a cluster's light list
+    \param i The list entry, in [offset, offset + count)
+*/
+uint getLightClusterLightIndex(uint i)
+{
+    return gLightClusterIndices.Load(i * 4);
+}
+
+/** Evaluate a material with all the lights which affect a shading point: the global lights and the lights of the point's cluster.
+    \param shAttr The shading attributes, see prepareShadingAttribs()
+    \param viewProjMat The view-projection matrix of the camera the clusters were built for
+    \param[out] result The shading output. It is initialized by this function.
+*/
+void evalClusteredLights(in const ShadingAttribs shAttr, in const float4x4 viewProjMat, inout ShadingOutput result)
+{
+    result.finalValue = 0;
+    bool first = true;
+
+    for(uint i = 0; i < gLightClusters.globalLightCount; i++)
+    {
+        evalMaterial(shAttr, gLightClusterLights[getLightClusterLightIndex(gLightClusters.globalLightOffset + i)], result, first);
+        first = false;
+    }
+
+    float4 posH = mul(viewProjMat, float4(shAttr.P, 1));
+    uint2 range = getLightClusterRange(getLightClusterIndex(gLightClusters, posH.xy / posH.w, posH.w));
+    for(uint i = range.x; i < range.x + range.y; i++)
+    {
+        evalMaterial(shAttr, gLightClusterLights[getLightClusterLightIndex(i)], result, first);
+        first = false;
+    }
+}
+
+#endif  // _FALCOR_LIGHT_CLUSTERS_H_
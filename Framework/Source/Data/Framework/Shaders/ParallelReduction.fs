@@ -77,7 +77,25 @@ float2 minMaxReduction(float2 posS)
     return range;
 }
 
+#ifdef _MAX_REDUCTION
+/** Farthest depth of a 2x2 block, used to build hierarchical-Z pyramids. Texels past the edge of odd-sized inputs are clamped, so every input texel is covered.
+*/
+float main(float2 texC : TEXCOORD, float4 posS : SV_POSITION) : SV_TARGET0
+{
+    uint2 dim;
+    gInputTex.GetDimensions(dim.x, dim.y);
+    uint2 crd0 = min(uint2(posS.xy) * 2, dim - 1);
+    uint2 crd1 = min(uint2(posS.xy) * 2 + 1, dim - 1);
+
+    float d0 = gInputTex.Load(int3(crd0.x, crd0.y, 0)).r;
+    float d1 = gInputTex.Load(int3(crd1.x, crd0.y, 0)).r;
+    float d2 = gInputTex.Load(int3(crd0.x, crd1.y, 0)).r;
+    float d3 = gInputTex.Load(int3(crd1.x, crd1.y, 0)).r;
+    return max(max(d0, d1), max(d2, d3));
+}
+#else
 float2 main(float2 texC : TEXCOORD, float4 posS : SV_POSITION) : SV_TARGET0
 {
     return minMaxReduction(posS.xy - 0.5f);
 }
+#endif
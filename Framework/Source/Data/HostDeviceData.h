@@ -365,6 +365,34 @@ struct LightData
     MaterialData    material;                                     ///< Emissive material of the geometry mesh
 };
 
+/**
+    Parameters of the clustered light grid. See LightClusterer.
+    Clusters are indexed as (z * tilesY + y) * tilesX + x. Tiles are laid out in NDC, with y pointing up. Depth slices are distributed exponentially between the near and far planes.
+*/
+struct LightClusterParams
+{
+    uint32_t        tilesX             DEFAULTS(16);              ///< Number of horizontal tiles
+    uint32_t        tilesY             DEFAULTS(8);               ///< Number of vertical tiles
+    uint32_t        slicesZ            DEFAULTS(24);              ///< Number of depth slices
+    float           logDepthScale      DEFAULTS(1.f);             ///< slicesZ / log(farZ / nearZ)
+    float           logNearZ           DEFAULTS(0.f);             ///< log(nearZ)
+    uint32_t        globalLightOffset  DEFAULTS(0);               ///< Offset of the global light list in the index buffer. Global lights (directional lights) affect every cluster.
+    uint32_t        globalLightCount   DEFAULTS(0);               ///< Number of global lights
+    uint32_t        pad;
+};
+
+/**
+    Parameters of the hierarchical-Z culling pass. See HzbCulling.
+*/
+struct HzbCullingParams
+{
+    mat4            viewProjMat        DEFAULTS(mat4());          ///< View-projection matrix the HZB's depth buffer was rendered with
+    uint32_t        boxCount           DEFAULTS(0);               ///< Number of boxes to test
+    uint32_t        levelCount         DEFAULTS(0);               ///< Number of HZB levels
+    uint32_t        depthWidth         DEFAULTS(0);               ///< Width of the depth buffer the HZB was built from
+    uint32_t        depthHeight        DEFAULTS(0);               ///< Height of the depth buffer the HZB was built from
+};
+
 /*******************************************************************
                     Shared material routines
 *******************************************************************/
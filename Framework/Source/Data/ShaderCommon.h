@@ -45,6 +45,8 @@ cbuffer InternalPerStaticMeshCB : register(b11)
     mat4 gWorldMat[64];
     uint32_t gDrawId[64]; // Zero-based order/ID of Mesh Instances drawn per SceneRenderer::renderScene call.
     uint32_t gMeshId;
+    vec3 gPosDequantScale;  // Converts quantized positions back to object space when using compact vertices
+    vec3 gPosDequantOffset;
 };
 
 cbuffer InternalPerSkinnedMeshCB : register(b12)
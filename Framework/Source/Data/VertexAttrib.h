@@ -39,6 +39,9 @@
 #define VERTEX_USER_ELEM_COUNT       4
 #define VERTEX_USER0_LOC            (VERTEX_LOCATION_COUNT)
 
+// Per-instance stream added by SceneRenderer's indirect draw mode. Not part of the mesh layouts.
+#define VERTEX_INSTANCE_WORLD_MAT_LOC   (VERTEX_USER0_LOC + VERTEX_USER_ELEM_COUNT)
+
 #define VERTEX_POSITION_NAME 	 	"POSITION"
 #define VERTEX_NORMAL_NAME    	 	"NORMAL"
 #define VERTEX_BITANGENT_NAME     	"BITANGENT"
@@ -46,15 +49,22 @@
 #define VERTEX_BONE_WEIGHT_NAME     "BONE_WEIGHTS"
 #define VERTEX_BONE_ID_NAME         "BONE_IDS"
 #define VERTEX_DIFFUSE_COLOR_NAME   "DIFFUSE_COLOR"
+#define VERTEX_INSTANCE_WORLD_MAT_NAME "INSTANCE_WORLD_MAT"
 
 #ifdef _COMPILE_DEFAULT_VS
 #include "ShaderCommon.h"
 
 struct VS_IN
 {
+#ifdef COMPACT_VERTICES
+    float4 pos         : POSITION;      // Quantized to the mesh bounding-box
+    float2 normal      : NORMAL;        // Octahedral
+    float2 bitangent   : BITANGENT;     // Octahedral
+#else
     float4 pos         : POSITION;
     float3 normal      : NORMAL;
     float3 bitangent   : BITANGENT;
+#endif
 #ifdef HAS_TEXCRD
     float2 texC        : TEXCOORD;
 #endif
@@ -64,6 +74,9 @@ struct VS_IN
 #ifdef _VERTEX_BLENDING
     float4 boneWeights : BONE_WEIGHTS;
     uint4  boneIds     : BONE_IDS;
+#endif
+#ifdef INDIRECT_DRAW
+    float4 instanceWorldMat[4] : INSTANCE_WORLD_MAT;   // Columns of the world matrix. Per-instance data is offset by the draw's start instance, SV_INSTANCEID isn't.
 #endif
     uint instanceID : SV_INSTANCEID;
 };
@@ -88,10 +101,51 @@ struct VS_OUT
 #endif
 };
 
+float3 octDecode(float2 e)
+{
+    float3 v = float3(e, 1 - abs(e.x) - abs(e.y));
+    if (v.z < 0)
+    {
+        v.xy = (1 - abs(v.yx)) * (v.xy >= 0 ? 1 : -1);
+    }
+    return normalize(v);
+}
+
+/** Get the object-space vertex attributes, decoding the compact vertex format if needed
+*/
+float4 getVertexPosition(VS_IN vIn)
+{
+#ifdef COMPACT_VERTICES
+    return float4(vIn.pos.xyz * gPosDequantScale + gPosDequantOffset, 1);
+#else
+    return vIn.pos;
+#endif
+}
+
+float3 getVertexNormal(VS_IN vIn)
+{
+#ifdef COMPACT_VERTICES
+    return octDecode(vIn.normal);
+#else
+    return vIn.normal;
+#endif
+}
+
+float3 getVertexBitangent(VS_IN vIn)
+{
+#ifdef COMPACT_VERTICES
+    return octDecode(vIn.bitangent);
+#else
+    return vIn.bitangent;
+#endif
+}
+
 float4x4 getWorldMat(VS_IN vIn)
 {
 #ifdef _VERTEX_BLENDING
     float4x4 worldMat = blendVertices(vIn.boneWeights, vIn.boneIds);
+#elif defined(INDIRECT_DRAW)
+    float4x4 worldMat = transpose(float4x4(vIn.instanceWorldMat[0], vIn.instanceWorldMat[1], vIn.instanceWorldMat[2], vIn.instanceWorldMat[3]));
 #else
     float4x4 worldMat = gWorldMat[vIn.instanceID];
 #endif
@@ -102,7 +156,7 @@ VS_OUT defaultVS(VS_IN vIn)
 {
     VS_OUT vOut;
     float4x4 worldMat = getWorldMat(vIn);
-    float4 posW = mul(worldMat, vIn.pos);
+    float4 posW = mul(worldMat, getVertexPosition(vIn));
     vOut.posW = posW.xyz;
     vOut.posH = mul(gCam.viewProjMat, posW);
 
@@ -118,8 +172,8 @@ VS_OUT defaultVS(VS_IN vIn)
     vOut.colorV = 0;
 #endif
 
-    vOut.normalW = mul((float3x3)worldMat, vIn.normal).xyz;
-    vOut.bitangentW = mul((float3x3)worldMat, vIn.bitangent).xyz;
+    vOut.normalW = mul((float3x3)worldMat, getVertexNormal(vIn)).xyz;
+    vOut.bitangentW = mul((float3x3)worldMat, getVertexBitangent(vIn)).xyz;
     vOut.prevPosH = mul(gCam.prevViewProjMat, posW);
 
 #ifdef _SINGLE_PASS_STEREO
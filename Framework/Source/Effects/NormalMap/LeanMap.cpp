@@ -33,77 +33,29 @@
 
 namespace Falcor
 {
-    Texture::SharedPtr LeanMap::createFromNormalMap(const Falcor::Texture* pNormalMap)
+    Texture::SharedPtr LeanMap::createFromNormalMap(const Falcor::Texture* pNormalMap, LeanMapBaker::Format format, bool useCache, LeanMapBaker::Stats* pStats)
     {
-        uint32_t texW = pNormalMap->getWidth();
-        uint32_t texH = pNormalMap->getHeight();
-
-        std::vector<vec4> leanData;
-
-        leanData.resize(texW * texH);
-
-        uint32_t normalMapDataSize = pNormalMap->getMipLevelDataSize(0);
-        auto normalMapData = gpDevice->getRenderContext()->readTextureSubresource(pNormalMap, 0);
-
-        const float oneBy255 = 1.0f / 255.0f;
-        for(auto y = 0u; y < texH; y++)
+        TextureMipChain leanMap;
+        bool success = false;
+        if(pNormalMap->getSourceFilename().size())
         {
-            for(auto x = 0u; x < texW; x++)
-            {
-                auto texIdx = (x + y * texW);
-                vec3 tn;
-
-                switch(pNormalMap->getFormat())
-                {
-                case ResourceFormat::RGBA8Unorm:
-                {
-                    tn.x = clamp(oneBy255 * (float)(normalMapData[texIdx * 4 + 0]), 0.0f, 1.0f);
-                    tn.y = clamp(oneBy255 * (float)(normalMapData[texIdx * 4 + 1]), 0.0f, 1.0f);
-                    tn.z = clamp(oneBy255 * (float)(normalMapData[texIdx * 4 + 2]), 0.0f, 1.0f);
-                } break;
-                case ResourceFormat::BGRA8Unorm:
-                case ResourceFormat::BGRX8Unorm:
-                {
-                    tn.z = clamp(oneBy255 * (float)(normalMapData[texIdx * 4 + 0]), 0.0f, 1.0f);
-                    tn.y = clamp(oneBy255 * (float)(normalMapData[texIdx * 4 + 1]), 0.0f, 1.0f);
-                    tn.x = clamp(oneBy255 * (float)(normalMapData[texIdx * 4 + 2]), 0.0f, 1.0f);
-                } break;
-                case ResourceFormat::RGBA8UnormSrgb:
-                {
-                    tn.x = clamp(SRGBToLinear(oneBy255 * (float)(normalMapData[texIdx * 4 + 0])), 0.0f, 1.0f);
-                    tn.y = clamp(SRGBToLinear(oneBy255 * (float)(normalMapData[texIdx * 4 + 1])), 0.0f, 1.0f);
-                    tn.z = clamp(SRGBToLinear(oneBy255 * (float)(normalMapData[texIdx * 4 + 2])), 0.0f, 1.0f);
-                } break;
-                case ResourceFormat::BGRA8UnormSrgb:
-                {
-                    tn.z = clamp(SRGBToLinear(oneBy255 * (float)(normalMapData[texIdx * 4 + 0])), 0.0f, 1.0f);
-                    tn.y = clamp(SRGBToLinear(oneBy255 * (float)(normalMapData[texIdx * 4 + 1])), 0.0f, 1.0f);
-                    tn.x = clamp(SRGBToLinear(oneBy255 * (float)(normalMapData[texIdx * 4 + 2])), 0.0f, 1.0f);
-                } break;
-                default: 
-                    logError("Can't generate LEAN map. Unsupported normal map format.");
-                    return nullptr;
-                };
-
-                // Unpack
-                static const float epsilon = 1e-3f;
-                vec3 n = tn * 2.f - vec3(1.f);
-                // And normalize the normal
-                n.z = max(n.z, epsilon);
-                n = normalize(n);
+            success = LeanMapBaker::bakeFile(pNormalMap->getSourceFilename(), isSrgbFormat(pNormalMap->getFormat()), format, useCache, leanMap, pStats);
+        }
 
-                // Write out the first moment (mean) in slope space
-                vec2 b = vec2(n.x, n.y) / max(n.z, epsilon);
-                vec2 m = b*b;
-                leanData[texIdx] = vec4(b.x*0.5f + 0.5f, b.y*0.5f + 0.5f, m.x, m.y);
-            }
+        if(success == false)
+        {
+            auto normalMapData = gpDevice->getRenderContext()->readTextureSubresource(pNormalMap, 0);
+            success = LeanMapBaker::bakeImage(normalMapData.data(), pNormalMap->getWidth(), pNormalMap->getHeight(), pNormalMap->getFormat(), format, leanMap, pStats);
         }
 
-        Texture::SharedPtr pTex = Texture::create2D(texW, texH, ResourceFormat::RGBA32Float, 1, Texture::kMaxPossible, leanData.data());
-        return pTex;
+        if(success == false)
+        {
+            return nullptr;
+        }
+        return Texture::create2D(leanMap.width, leanMap.height, leanMap.format, 1, leanMap.mipCount, leanMap.data.data());
     }
 
-    bool LeanMap::createLeanMap(const Material* pMaterial)
+    bool LeanMap::createLeanMap(const Material* pMaterial, LeanMapBaker::Format format, bool useCache)
     {
         uint32_t materialID = pMaterial->getId();
 
@@ -116,13 +68,18 @@ namespace Falcor
         const Texture* pNormalMap = pMaterial->getNormalMap().get();
         if(pNormalMap)
         {
-            mpLeanMaps[materialID] = createFromNormalMap(pNormalMap);
+            Texture::SharedPtr& pLeanMap = mMapsByNormalMap[pNormalMap];
+            if(pLeanMap == nullptr)
+            {
+                pLeanMap = createFromNormalMap(pNormalMap, format, useCache, &mBakeStats);
+            }
+            mpLeanMaps[materialID] = pLeanMap;
             mShaderArraySize = max(materialID + 1, mShaderArraySize);
         }
         return true;
     }
 
-    LeanMap::UniquePtr LeanMap::create(const Scene* pScene)
+    LeanMap::UniquePtr LeanMap::create(const Scene* pScene, LeanMapBaker::Format format, bool useCache)
     {
         UniquePtr pLeanMaps = UniquePtr(new LeanMap);
 
@@ -130,7 +87,7 @@ namespace Falcor
         for(uint32_t i = 0; i < pScene->getMaterialCount(); i++)
         {
             const Material* pMaterial = pScene->getMaterial(i).get();
-            if(pLeanMaps->createLeanMap(pMaterial) == false)
+            if(pLeanMaps->createLeanMap(pMaterial, format, useCache) == false)
             {
                 return nullptr;
             }
@@ -143,7 +100,7 @@ namespace Falcor
             for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
             {
                 const Material* pMaterial = pModel->getMesh(meshID)->getMaterial().get();
-                if(pLeanMaps->createLeanMap(pMaterial) == false)
+                if(pLeanMaps->createLeanMap(pMaterial, format, useCache) == false)
                 {
                     return nullptr;
                 }
@@ -154,6 +111,10 @@ namespace Falcor
         {
             logWarning("Trying to create SceneLeanMaps for a scene without materials.");
         }
+        else
+        {
+            logInfo(pLeanMaps->mBakeStats.toString());
+        }
 
         return pLeanMaps;
     }
@@ -29,6 +29,7 @@
 #include <map>
 #include <memory>
 #include "API/Texture.h"
+#include "LeanMapBaker.h"
 
 namespace Falcor
 {
@@ -42,17 +43,37 @@ namespace Falcor
     {
     public:
         using UniquePtr = std::unique_ptr<LeanMap>;
-        static UniquePtr create(const Falcor::Scene* pScene);
-        static Falcor::Texture::SharedPtr createFromNormalMap(const Falcor::Texture* pNormalMap);
+
+        /** Create the LEAN maps of every material in a scene. Materials which share a normal map share the LEAN map.
+            \param[in] pScene The scene
+            \param[in] format The texel format of the maps
+            \param[in] useCache Load the maps from the LeanMapBaker cache, and write the ones which are missing
+        */
+        static UniquePtr create(const Falcor::Scene* pScene, LeanMapBaker::Format format = LeanMapBaker::Format::Float16, bool useCache = true);
+
+        /** Create the LEAN map of a normal map.
+            The map is baked on the CPU from the normal map's source file. If the texture wasn't loaded from a file, or the file can't be decoded, the texture is read back from the GPU instead.
+            \param[in] pNormalMap The normal map
+            \param[in] format The texel format of the map
+            \param[in] useCache Load the map from the LeanMapBaker cache, and write it there if it's missing. Only used for maps baked from a file.
+            \param[in,out] pStats Optional statistics to update
+        */
+        static Falcor::Texture::SharedPtr createFromNormalMap(const Falcor::Texture* pNormalMap, LeanMapBaker::Format format = LeanMapBaker::Format::Float16, bool useCache = true, LeanMapBaker::Stats* pStats = nullptr);
 
         Falcor::Texture* getLeanMap(uint32_t sceneMaterialID) { return mpLeanMaps[sceneMaterialID].get(); }
         void setIntoProgramVars(ProgramVars* pVars, const std::string& texName) const;
         void setIntoProgramVars(ProgramVars* pVars, uint32_t texIndex) const;
         uint32_t getRequiredLeanMapShaderArraySize() const { return mShaderArraySize; }
+
+        /** Get the statistics of the bake which created the maps
+        */
+        const LeanMapBaker::Stats& getBakeStats() const { return mBakeStats; }
     private:
         LeanMap() = default;
-        bool createLeanMap(const Falcor::Material* pMaterial);
+        bool createLeanMap(const Falcor::Material* pMaterial, LeanMapBaker::Format format, bool useCache);
         std::map<uint32_t, Falcor::Texture::SharedPtr> mpLeanMaps;
+        std::map<const Falcor::Texture*, Falcor::Texture::SharedPtr> mMapsByNormalMap;
         uint32_t mShaderArraySize = 0;
+        LeanMapBaker::Stats mBakeStats;
     };
 }
\ No newline at end of file
@@ -0,0 +1,398 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "LeanMapBaker.h"
+#include "Data/HostDeviceData.h"
+#include "Utils/Bitmap.h"
+#include "Utils/BlockCompression.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/OS.h"
+#include "Utils/StringUtils.h"
+#include "Utils/ThreadPool.h"
+#include <emmintrin.h>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef FALCOR_GL
+static const bool kTopDown = false;
+#elif defined FALCOR_D3D
+static const bool kTopDown = true;
+#endif
+
+namespace Falcor
+{
+    static std::string gCacheDirectory;
+
+    // Largest finite half-float
+    static const float kHalfMax = 65504.0f;
+
+    /** Location of the normal's components in a source texel. Every component is a byte.
+    */
+    struct SourceLayout
+    {
+        uint32_t stride = 4;                // Bytes per texel
+        uint32_t offset[3] = { 0, 1, 2 };   // Byte offsets of X, Y and Z
+        bool reconstructZ = false;          // Two-channel maps only store X and Y
+    };
+
+    static bool getSourceLayout(ResourceFormat format, SourceLayout& layout)
+    {
+        switch(srgbToLinearFormat(format))
+        {
+        case ResourceFormat::RGBA8Unorm:
+        case ResourceFormat::RGBX8Unorm:
+            layout = SourceLayout();
+            return true;
+        case ResourceFormat::BGRA8Unorm:
+        case ResourceFormat::BGRX8Unorm:
+            layout = SourceLayout();
+            layout.offset[0] = 2;
+            layout.offset[2] = 0;
+            return true;
+        case ResourceFormat::RG8Unorm:
+            layout = SourceLayout();
+            layout.stride = 2;
+            layout.offset[2] = 0;
+            layout.reconstructZ = true;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static __m128 loadComponent(const uint8_t* pTexels, const SourceLayout& layout, uint32_t c, const float* pLut)
+    {
+        const uint8_t* p = pTexels + layout.offset[c];
+        return _mm_set_ps(pLut[p[3 * layout.stride]], pLut[p[2 * layout.stride]], pLut[p[layout.stride]], pLut[p[0]]);
+    }
+
+    /** Convert 4 texels into LEAN moments
+        \param[out] pOut 4 RGBA32Float texels
+    */
+    static void convertTexels(const uint8_t* pTexels, const SourceLayout& layout, const float* pLut, float* pOut)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 epsilon = _mm_set1_ps(1e-3f);
+
+        // Unpack
+        __m128 nx = _mm_sub_ps(_mm_mul_ps(loadComponent(pTexels, layout, 0, pLut), two), one);
+        __m128 ny = _mm_sub_ps(_mm_mul_ps(loadComponent(pTexels, layout, 1, pLut), two), one);
+        __m128 nz;
+        if(layout.reconstructZ)
+        {
+            nz = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_sub_ps(one, _mm_mul_ps(nx, nx)), _mm_mul_ps(ny, ny)), zero));
+        }
+        else
+        {
+            nz = _mm_sub_ps(_mm_mul_ps(loadComponent(pTexels, layout, 2, pLut), two), one);
+        }
+
+        // And normalize the normal
+        nz = _mm_max_ps(nz, epsilon);
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+        nx = _mm_div_ps(nx, length);
+        ny = _mm_div_ps(ny, length);
+        nz = _mm_max_ps(_mm_div_ps(nz, length), epsilon);
+
+        // The first moment (mean) in slope space, and the second moment
+        __m128 bx = _mm_div_ps(nx, nz);
+        __m128 by = _mm_div_ps(ny, nz);
+        __m128 r = _mm_add_ps(_mm_mul_ps(bx, half), half);
+        __m128 g = _mm_add_ps(_mm_mul_ps(by, half), half);
+        __m128 b = _mm_mul_ps(bx, bx);
+        __m128 a = _mm_mul_ps(by, by);
+
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+        _mm_storeu_ps(pOut + 0, r);
+        _mm_storeu_ps(pOut + 4, g);
+        _mm_storeu_ps(pOut + 8, b);
+        _mm_storeu_ps(pOut + 12, a);
+    }
+
+    static void convertRow(const uint8_t* pSrc, uint32_t width, const SourceLayout& layout, const float* pLut, float* pDst)
+    {
+        uint32_t x = 0;
+        for(; x + 4 <= width; x += 4)
+        {
+            convertTexels(pSrc + x * layout.stride, layout, pLut, pDst + x * 4);
+        }
+
+        // Pad the last texels of the row
+        if(x < width)
+        {
+            uint8_t texels[16] = {};
+            float moments[16];
+            memcpy(texels, pSrc + x * layout.stride, (width - x) * layout.stride);
+            convertTexels(texels, layout, pLut, moments);
+            memcpy(pDst + x * 4, moments, (width - x) * 4 * sizeof(float));
+        }
+    }
+
+    /** Convert 4 floats to half-floats, rounding to nearest-even. The values must be in [-kHalfMax, kHalfMax].
+    */
+    static __m128i floatToHalf(__m128 f)
+    {
+        const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+        const __m128i subnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+        const __m128i normalBias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+
+        __m128 sign = _mm_and_ps(f, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+        __m128 absF = _mm_xor_ps(f, sign);
+        __m128i absBits = _mm_castps_si128(absF);
+        __m128i isSubnormal = _mm_cmpgt_epi32(minNormal, absBits);
+
+        // Subnormal results. Adding the magic number makes the FPU do the rounding.
+        __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absF, _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+
+        // Normal results. Rebias the exponent and round the mantissa, ties go to the even value
+        __m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31);
+        __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absBits, normalBias), mantissaOdd), 13);
+
+        __m128i result = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+        // The sign is shifted arithmetically, so that the signed saturation of the caller's pack keeps the bits
+        return _mm_or_si128(result, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+    }
+
+    static void convertToHalf(const float* pSrc, size_t count, uint16_t* pDst)
+    {
+        const __m128 maxValue = _mm_set1_ps(kHalfMax);
+        const __m128 minValue = _mm_set1_ps(-kHalfMax);
+        const uint32_t groupCount = (uint32_t)(count / 4);
+        ThreadPool::instance()->parallelFor(groupCount, 4096, [=](uint32_t begin, uint32_t end)
+        {
+            for(uint32_t i = begin; i < end; i++)
+            {
+                __m128 f = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(pSrc + i * 4), minValue), maxValue);
+                __m128i h = floatToHalf(f);
+                _mm_storel_epi64((__m128i*)(pDst + i * 4), _mm_packs_epi32(h, h));
+            }
+        });
+    }
+
+    // 64-bit FNV-1a
+    static uint64_t hashBytes(const void* pData, size_t size)
+    {
+        const uint8_t* pBytes = (const uint8_t*)pData;
+        uint64_t hash = 14695981039346656037ull;
+        for(size_t i = 0; i < size; i++)
+        {
+            hash ^= pBytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash ^ size;
+    }
+
+    ResourceFormat LeanMapBaker::getResourceFormat(Format format)
+    {
+        return (format == Format::Float16) ? ResourceFormat::RGBA16Float : ResourceFormat::RGBA32Float;
+    }
+
+    bool LeanMapBaker::bakeImage(const void* pData, uint32_t width, uint32_t height, ResourceFormat format, Format dstFormat, TextureMipChain& leanMap, Stats* pStats)
+    {
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+
+        // Block-compressed maps are decoded into RGBA8 first
+        const uint8_t* pTexels = (const uint8_t*)pData;
+        std::vector<uint8_t> decoded;
+        SourceLayout layout;
+        bool supported = false;
+        if(isCompressedFormat(format))
+        {
+            ResourceFormat linearFormat = srgbToLinearFormat(format);
+            if(linearFormat != ResourceFormat::BC4Unorm && BlockCompression::isFormatSupported(linearFormat))
+            {
+                decoded.resize((size_t)width * height * 4);
+                supported = BlockCompression::decompressImage(linearFormat, pTexels, width, height, decoded.data());
+                pTexels = decoded.data();
+                layout.reconstructZ = (linearFormat == ResourceFormat::BC5Unorm);
+            }
+        }
+        else
+        {
+            supported = getSourceLayout(format, layout);
+        }
+
+        if(supported == false)
+        {
+            logError("Can't generate LEAN map. Unsupported normal map format.");
+            if(pStats)
+            {
+                pStats->failedCount++;
+            }
+            return false;
+        }
+
+        float lut[256];
+        for(uint32_t i = 0; i < 256; i++)
+        {
+            float value = (float)i / 255.0f;
+            lut[i] = isSrgbFormat(format) ? clamp(SRGBToLinear(value), 0.0f, 1.0f) : value;
+        }
+
+        std::vector<float> moments((size_t)width * height * 4);
+        ThreadPool::instance()->parallelFor(height, 0, [&](uint32_t begin, uint32_t end)
+        {
+            for(uint32_t y = begin; y < end; y++)
+            {
+                convertRow(pTexels + (size_t)y * width * layout.stride, width, layout, lut, moments.data() + (size_t)y * width * 4);
+            }
+        });
+
+        TextureMipChain chain;
+        generateTextureMipChain(moments.data(), width, height, ResourceFormat::RGBA32Float, 0, chain);
+        if(dstFormat == Format::Float16)
+        {
+            leanMap.width = chain.width;
+            leanMap.height = chain.height;
+            leanMap.mipCount = chain.mipCount;
+            leanMap.format = ResourceFormat::RGBA16Float;
+            leanMap.data.resize(chain.data.size() / 2);
+            convertToHalf((const float*)chain.data.data(), chain.data.size() / sizeof(float), (uint16_t*)leanMap.data.data());
+        }
+        else
+        {
+            leanMap = std::move(chain);
+        }
+
+        if(pStats)
+        {
+            pStats->bakedCount++;
+            pStats->pixelCount += (uint64_t)width * height;
+            pStats->outputBytes += leanMap.data.size();
+            pStats->seconds += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) * 1.0e-3;
+        }
+        return true;
+    }
+
+    bool LeanMapBaker::bakeFile(const std::string& filename, bool isSrgb, Format dstFormat, bool useCache, TextureMipChain& leanMap, Stats* pStats)
+    {
+        std::string fullpath;
+        if(findFileInDataDirectories(filename, fullpath) == false)
+        {
+            logWarning("Can't bake LEAN map. File " + filename + " not found.");
+            if(pStats)
+            {
+                pStats->failedCount++;
+            }
+            return false;
+        }
+
+        std::string cacheFilename = useCache ? getCacheFilename(fullpath, isSrgb, dstFormat) : std::string();
+        if(cacheFilename.size() && doesFileExist(cacheFilename))
+        {
+            if(loadTextureMipChain(cacheFilename, 0, leanMap) && leanMap.format == getResourceFormat(dstFormat))
+            {
+                if(pStats)
+                {
+                    pStats->cachedCount++;
+                    pStats->outputBytes += leanMap.data.size();
+                }
+                return true;
+            }
+            logWarning("LEAN map cache file " + cacheFilename + " is invalid. The map will be baked again.");
+        }
+
+        // Decode the source image rather than a baked version of it, which is lossy
+        bool success = false;
+        if(hasSuffix(fullpath, ".dds", false))
+        {
+            TextureMipChain source;
+            if(loadTextureMipChain(fullpath, 0, source))
+            {
+                ResourceFormat format = isSrgb ? linearToSrgbFormat(source.format) : srgbToLinearFormat(source.format);
+                success = bakeImage(source.data.data(), source.width, source.height, format, dstFormat, leanMap, pStats);
+            }
+        }
+        else
+        {
+            Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(fullpath, kTopDown);
+            if(pBitmap)
+            {
+                ResourceFormat format = isSrgb ? linearToSrgbFormat(pBitmap->getFormat()) : srgbToLinearFormat(pBitmap->getFormat());
+                success = bakeImage(pBitmap->getData(), pBitmap->getWidth(), pBitmap->getHeight(), format, dstFormat, leanMap, pStats);
+            }
+        }
+
+        if(success == false)
+        {
+            return false;
+        }
+
+        if(cacheFilename.size())
+        {
+            if(isDirectoryExists(getCacheDirectory()) == false)
+            {
+                createDirectory(getCacheDirectory());
+            }
+            saveTextureMipChainToDDS(cacheFilename, leanMap);
+        }
+        return true;
+    }
+
+    void LeanMapBaker::setCacheDirectory(const std::string& directory)
+    {
+        gCacheDirectory = directory;
+    }
+
+    const std::string& LeanMapBaker::getCacheDirectory()
+    {
+        if(gCacheDirectory.empty())
+        {
+            gCacheDirectory = getExecutableDirectory() + "/LeanMapCache";
+        }
+        return gCacheDirectory;
+    }
+
+    std::string LeanMapBaker::getCacheFilename(const std::string& fullpath, bool isSrgb, Format dstFormat)
+    {
+        std::ifstream file(fullpath, std::ios::binary);
+        if(file.fail())
+        {
+            return std::string();
+        }
+        std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        std::stringstream s;
+        s << getCacheDirectory() << "/" << std::hex << std::setw(16) << std::setfill('0') << hashBytes(data.data(), data.size());
+        s << std::dec << (isSrgb ? ".srgb" : "") << ((dstFormat == Format::Float16) ? ".f16" : ".f32") << ".v" << kVersion << ".dds";
+        return s.str();
+    }
+
+    std::string LeanMapBaker::Stats::toString() const
+    {
+        std::stringstream s;
+        s << std::fixed << std::setprecision(2);
+        s << "LEAN maps: " << bakedCount << " baked, " << cachedCount << " cached, " << failedCount << " failed. ";
+        s << (double)pixelCount * 1.0e-6 << " MPix in " << seconds << "s, " << (double)outputBytes / (1024 * 1024) << " MB";
+        return s.str();
+    }
+}
@@ -0,0 +1,109 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include "API/Formats.h"
+#include "Graphics/TextureHelper.h"
+
+namespace Falcor
+{
+    /** CPU baker for LEAN maps.
+        Converts a tangent-space normal map into the first and second slope moments (b.x*0.5+0.5, b.y*0.5+0.5, b.x^2, b.y^2) the LEAN shaders expect, and generates the full mip-chain. The moments are linear, so the mips are box-filtered like any other texture.
+        Rows are converted in parallel on the global ThreadPool, 4 texels at a time with SSE. Baked maps can be cached on disk, keyed by a hash of the source file.
+    */
+    class LeanMapBaker
+    {
+    public:
+        static const uint32_t kVersion = 1;
+
+        /** Output format
+        */
+        enum class Format
+        {
+            Float32,    ///< RGBA32Float, 16 bytes per texel
+            Float16,    ///< RGBA16Float, 8 bytes per texel. The moments are clamped to the half-float range.
+        };
+
+        /** Statistics accumulated over bake calls
+        */
+        struct Stats
+        {
+            uint32_t bakedCount = 0;        ///< Number of maps baked from their source data
+            uint32_t cachedCount = 0;       ///< Number of maps loaded from the cache
+            uint32_t failedCount = 0;       ///< Number of maps which couldn't be baked
+            uint64_t pixelCount = 0;        ///< Number of converted texels, not including the mips
+            uint64_t outputBytes = 0;       ///< Size of the baked and cached mip-chains
+            double seconds = 0;             ///< Time spent baking, not including file I/O
+
+            /** Get a one-line summary
+            */
+            std::string toString() const;
+        };
+
+        /** Get the texel format of an output format
+        */
+        static ResourceFormat getResourceFormat(Format format);
+
+        /** Bake a LEAN map from normal map texels
+            \param[in] pData The mip 0 texels, tightly packed
+            \param[in] width The image width
+            \param[in] height The image height
+            \param[in] format The normal map format. Supports 8-bit RGBA, BGRA, RGBX and BGRX (with or without sRGB), RG8 (Z is reconstructed), and BC1, BC3, BC5 and BC7 blocks the BlockCompression decoder can read.
+            \param[in] dstFormat The output format
+            \param[out] leanMap The LEAN map, including the mip-chain
+            \param[in,out] pStats Optional statistics to update
+            \return true on success, false if the format is not supported
+        */
+        static bool bakeImage(const void* pData, uint32_t width, uint32_t height, ResourceFormat format, Format dstFormat, TextureMipChain& leanMap, Stats* pStats = nullptr);
+
+        /** Bake the LEAN map of a normal map file. The source image is decoded directly, so no GPU resources are used.
+            \param[in] filename The normal map file. Loader will look for it in the data directories.
+            \param[in] isSrgb Whether the normal map is interpreted as sRGB data, which is the case if the normal map texture was loaded with an sRGB format
+            \param[in] dstFormat The output format
+            \param[in] useCache Load the map from the cache if it's there, otherwise bake it and write it into the cache
+            \param[out] leanMap The LEAN map, including the mip-chain
+            \param[in,out] pStats Optional statistics to update
+            \return true on success, otherwise false
+        */
+        static bool bakeFile(const std::string& filename, bool isSrgb, Format dstFormat, bool useCache, TextureMipChain& leanMap, Stats* pStats = nullptr);
+
+        /** Set the directory the cached maps are written into. Default is 'LeanMapCache' in the executable directory.
+        */
+        static void setCacheDirectory(const std::string& directory);
+
+        /** Get the directory the cached maps are written into
+        */
+        static const std::string& getCacheDirectory();
+
+        /** Get the cache file of a normal map. The name is built from a hash of the file content, the sRGB flag, the output format and kVersion.
+            \param[in] fullpath The full path of the normal map
+            \return The full path of the cache file, or an empty string if the normal map can't be read
+        */
+        static std::string getCacheFilename(const std::string& fullpath, bool isSrgb, Format dstFormat);
+    };
+}
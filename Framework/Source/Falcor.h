@@ -56,6 +56,7 @@
 #include "API/StructuredBuffer.h"
 #include "API/Texture.h"
 #include "API/ConstantBuffer.h"
+#include "API/ParameterBlockLayout.h"
 #include "API/VAO.h"
 #include "API/VertexLayout.h"
 #include "API/Window.h"
@@ -69,6 +70,8 @@
 #include "API/LowLevel/FencedPool.h"
 #include "API/LowLevel/GpuFence.h"
 #include "API/LowLevel/RootSignature.h"
+#include "API/LowLevel/StagingPageAllocator.h"
+#include "API/AsyncCopyQueue.h"
 #endif //FALCOR_D3D12 || defined FALCOR_VULKAN
 
 // Graphics
@@ -77,7 +80,10 @@
 #include "Graphics/GraphicsState.h"
 #include "Graphics/FullScreenPass.h"
 #include "Graphics/TextureHelper.h"
+#include "Graphics/TextureCapture.h"
+#include "Graphics/TextureBaker.h"
 #include "Graphics/Light.h"
+#include "Graphics/LightClusterer.h"
 #include "Graphics/Program.h"
 #include "Graphics/GraphicsProgram.h"
 #include "Graphics/FboHelper.h"
@@ -89,10 +95,16 @@
 #include "Graphics/Material/BasicMaterial.h"
 #include "Graphics/Material/MaterialSystem.h"
 #include "Graphics/Material/MaterialEditor.h"
+#include "Graphics/Material/TextureStreamer.h"
 
 // Model
 #include "Graphics/Model/Mesh.h"
 #include "Graphics/Model/Model.h"
+#include "Graphics/Model/GeometryArena.h"
+#include "Graphics/Model/MeshDeduplicator.h"
+#include "Graphics/Model/MeshOptimizer.h"
+#include "Graphics/Model/MeshSimplifier.h"
+#include "Graphics/Model/VertexCompression.h"
 #include "Graphics/Model/ModelRenderer.h"
 
 // Scene
@@ -106,6 +118,8 @@
 #include "Utils/Math/FalcorMath.h"
 #include "Utils/Math/CubicSpline.h"
 #include "Utils/Math/ParallelReduction.h"
+#include "Utils/Math/HierarchicalZ.h"
+#include "Utils/Math/HzbReference.h"
 
 // Utils
 #include "Utils/Bitmap.h"
@@ -121,8 +135,11 @@
 #include "Utils/Profiler.h"
 #include "Utils/StringUtils.h"
 #include "Utils/BinaryFileStream.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/BlockCompression.h"
 #include "Utils/Video/VideoEncoder.h"
 #include "Utils/Video/VideoEncoderUI.h"
+#include "Utils/Video/AsyncVideoEncoder.h"
 #include "Utils/Video/VideoDecoder.h"
 
 // VR
@@ -131,6 +148,7 @@
 
 // Effects
 #include "Effects/NormalMap/LeanMap.h"
+#include "Effects/NormalMap/LeanMapBaker.h"
 #include "Effects/Shadows/CSM.h"
 #include "Effects/Utils/GaussianBlur.h"
 #include "Effects/SkyBox/SkyBox.h"
@@ -197,15 +197,8 @@ namespace Falcor
 
     void Camera::setIntoConstantBuffer(ConstantBuffer* pCB, const std::string& varName) const
     {
-        size_t offset = pCB->getVariableOffset(varName + ".viewMat");
-
-        if (offset == ConstantBuffer::kInvalidOffset)
-        {
-            logWarning("Camera::setIntoConstantBuffer() - variable \"" + varName + "\"not found in constant buffer\n");
-            return;
-        }
-
-        setIntoConstantBuffer(pCB, offset);
+        calculateCameraParameters();
+        pCB->setParameterBlock(varName, mData);
     }
 
     void Camera::setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::size_t& offset) const
@@ -38,22 +38,6 @@
 
 namespace Falcor
 {
-    bool checkOffset(size_t cbOffset, size_t cppOffset, const char* field)
-    {
-        if (cbOffset != cppOffset)
-        {
-            logError("Light::LightData::" + std::string(field) + " CB offset mismatch. CB offset is " + std::to_string(cbOffset) + ", C++ data offset is " + std::to_string(cppOffset));
-            return false;
-        }
-        return true;
-    }
-
-#if _LOG_ENABLED
-#define check_offset(_a) {static bool b = true; if(b) {assert(checkOffset(pBuffer->getVariableOffset(varName + "." + #_a) - offset, offsetof(LightData, _a), #_a));} b = false;}
-#else
-#define check_offset(_a)
-#endif
-
     uint32_t Light::sCount = 0;
 
     Light::Light()
@@ -64,27 +48,10 @@ namespace Falcor
 
     void Light::setIntoConstantBuffer(ConstantBuffer* pBuffer, const std::string& varName)
     {
-        static const size_t dataSize = sizeof(LightData) - sizeof(MaterialData);
-        static_assert(dataSize % sizeof(float) * 4 == 0, "LightData size should be a multiple of 16");
         static_assert(sizeof(LightData) - sizeof(MaterialData) == offsetof(LightData, material), "'material' must be the last field in LightData");
 
-        size_t offset = pBuffer->getVariableOffset(varName + ".worldPos");
-        if (offset == ConstantBuffer::kInvalidOffset)
-        {
-            logWarning("AreaLight::setIntoConstantBuffer() - variable \"" + varName + "\"not found in constant buffer\n");
-            return;
-        }
-
-        check_offset(worldDir);
-        check_offset(intensity);
-        check_offset(aabbMin);
-        check_offset(aabbMax);
-        check_offset(transMat);
-        check_offset(numIndices);
-        assert(offset + dataSize <= pBuffer->getSize());
-
         // Set everything except for the material
-        pBuffer->setBlob(&mData, offset, dataSize);
+        pBuffer->setParameterBlock(varName, mData);
         if (mData.type == LightArea)
         {
             assert(0);
@@ -373,6 +340,12 @@ namespace Falcor
             const auto& pMesh = pMeshInstance->getObject();
             assert(pMesh != nullptr);
 
+            if (pMesh->isInGeometryArena())
+            {
+                logWarning("AreaLight::setMeshData() - area lights can't use meshes stored in a geometry arena. Load the model without Model::UseGeometryArena.");
+                return;
+            }
+
             mpMeshInstance = pMeshInstance;
 
             const auto& vao = pMesh->getVao();
@@ -0,0 +1,463 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "LightClusterer.h"
+#include <xmmintrin.h>
+#include <cfloat>
+#include "Graphics/Camera/Camera.h"
+#include "API/ConstantBuffer.h"
+#include "API/ProgramVars.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/Gui.h"
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+namespace Falcor
+{
+    const char* LightClusterer::kConstantBufferName = "LightClustersCB";
+    static const char* kParamsVarName = "gLightClusters";
+    static const char* kGridBufferName = "gLightClusterGrid";
+    static const char* kIndexBufferName = "gLightClusterIndices";
+    static const char* kLightsBufferName = "gLightClusterLights";
+
+    LightClusterer::SharedPtr LightClusterer::create(uint32_t tilesX, uint32_t tilesY, uint32_t slicesZ, uint32_t maxLightsPerCluster)
+    {
+        if (tilesX == 0 || tilesY == 0 || slicesZ == 0 || maxLightsPerCluster == 0)
+        {
+            logError("LightClusterer::create() - grid dimensions and cluster capacity must be larger than 0");
+            return nullptr;
+        }
+        return SharedPtr(new LightClusterer(tilesX, tilesY, slicesZ, maxLightsPerCluster));
+    }
+
+    LightClusterer::LightClusterer(uint32_t tilesX, uint32_t tilesY, uint32_t slicesZ, uint32_t maxLightsPerCluster) : mMaxLightsPerCluster(maxLightsPerCluster)
+    {
+        mParams.tilesX = tilesX;
+        mParams.tilesY = tilesY;
+        mParams.slicesZ = slicesZ;
+        mTileStride = align_to(4, tilesX * tilesY);
+
+        size_t boundsCount = mTileStride * slicesZ;
+        mClusterMinX.resize(boundsCount);
+        mClusterMinY.resize(boundsCount);
+        mClusterMinZ.resize(boundsCount);
+        mClusterMaxX.resize(boundsCount);
+        mClusterMaxY.resize(boundsCount);
+        mClusterMaxZ.resize(boundsCount);
+        mSliceDepth.resize(slicesZ + 1);
+
+        uint32_t clusterCount = getClusterCount();
+        mScratchIndices.resize(clusterCount * mMaxLightsPerCluster);
+        mScratchCounts.resize(clusterCount);
+        mSliceDroppedCount.resize(slicesZ);
+        mGridData.resize(clusterCount * 2);
+    }
+
+    void LightClusterer::updateClusterBounds(const glm::mat4& projMat, float nearZ, float farZ)
+    {
+        if (projMat == mBoundsProjMat && nearZ == mBoundsNearZ && farZ == mBoundsFarZ)
+        {
+            return;
+        }
+        mBoundsProjMat = projMat;
+        mBoundsNearZ = nearZ;
+        mBoundsFarZ = farZ;
+
+        const uint32_t tilesX = mParams.tilesX;
+        const uint32_t tilesY = mParams.tilesY;
+        const uint32_t slicesZ = mParams.slicesZ;
+
+        mParams.logNearZ = logf(nearZ);
+        mParams.logDepthScale = float(slicesZ) / logf(farZ / nearZ);
+        for (uint32_t z = 0; z <= slicesZ; z++)
+        {
+            mSliceDepth[z] = nearZ * powf(farZ / nearZ, float(z) / float(slicesZ));
+        }
+
+        // For a perspective projection, a view-space point at depth d (z = -d) projects to ndc.x = (P[0][0] * x - P[2][0] * d) / d, so x = d * (ndc.x + P[2][0]) / P[0][0]. Same for y.
+        // Including the P[2] terms makes this work with jittered and off-center projections.
+        const float scaleX = 1.0f / projMat[0][0];
+        const float scaleY = 1.0f / projMat[1][1];
+        const float offsetX = projMat[2][0];
+        const float offsetY = projMat[2][1];
+
+        for (uint32_t z = 0; z < slicesZ; z++)
+        {
+            const float d0 = mSliceDepth[z];
+            const float d1 = mSliceDepth[z + 1];
+            for (uint32_t tile = 0; tile < mTileStride; tile++)
+            {
+                const uint32_t i = z * mTileStride + tile;
+                if (tile >= tilesX * tilesY)
+                {
+                    // Padding. An inverted box never intersects anything
+                    mClusterMinX[i] = mClusterMinY[i] = mClusterMinZ[i] = FLT_MAX;
+                    mClusterMaxX[i] = mClusterMaxY[i] = mClusterMaxZ[i] = -FLT_MAX;
+                    continue;
+                }
+
+                const uint32_t x = tile % tilesX;
+                const uint32_t y = tile / tilesX;
+                const float ndcX0 = float(x) / float(tilesX) * 2.0f - 1.0f;
+                const float ndcX1 = float(x + 1) / float(tilesX) * 2.0f - 1.0f;
+                const float ndcY0 = float(y) / float(tilesY) * 2.0f - 1.0f;
+                const float ndcY1 = float(y + 1) / float(tilesY) * 2.0f - 1.0f;
+
+                // The tile's side planes pass through the origin, so the extreme x/y values are found at the near or far depth of the slice
+                float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+                for (float d : {d0, d1})
+                {
+                    for (float ndcX : {ndcX0, ndcX1})
+                    {
+                        float vx = d * (ndcX + offsetX) * scaleX;
+                        minX = min(minX, vx);
+                        maxX = max(maxX, vx);
+                    }
+                    for (float ndcY : {ndcY0, ndcY1})
+                    {
+                        float vy = d * (ndcY + offsetY) * scaleY;
+                        minY = min(minY, vy);
+                        maxY = max(maxY, vy);
+                    }
+                }
+
+                mClusterMinX[i] = minX;
+                mClusterMaxX[i] = maxX;
+                mClusterMinY[i] = minY;
+                mClusterMaxY[i] = maxY;
+                mClusterMinZ[i] = -d1;
+                mClusterMaxZ[i] = -d0;
+            }
+        }
+    }
+
+    bool LightClusterer::calculateLightBounds(const Light* pLight, const glm::mat4& viewMat, LightBounds& bounds) const
+    {
+        const LightData& data = pLight->getData();
+        if (data.type == LightDirectional)
+        {
+            return false;
+        }
+
+        // Point and area lights fall-off with the squared distance (see getLightRadiance() in Lights.h). Find the distance at which the radiance drops below the threshold
+        float maxIntensity = max(data.intensity.x, max(data.intensity.y, data.intensity.z));
+        float range = sqrtf(max(maxIntensity, 0.0f) / (4.0f * float(M_PI) * mInfluenceThreshold));
+
+        glm::vec3 worldCenter = data.worldPos;
+        if (data.type == LightArea)
+        {
+            BoundingBox box = BoundingBox::fromMinMax(data.aabbMin, data.aabbMax).transform(data.transMat);
+            worldCenter = box.center;
+            range += glm::length(box.extent);
+        }
+
+        bounds.center = glm::vec3(viewMat * glm::vec4(worldCenter, 1.0f));
+        bounds.radius = range;
+        return true;
+    }
+
+    void LightClusterer::build(const Camera* pCamera, const std::vector<Light::SharedPtr>& lights)
+    {
+        const glm::mat4& viewMat = pCamera->getViewMatrix();
+        mLightBounds.resize(lights.size());
+        for (size_t i = 0; i < lights.size(); i++)
+        {
+            if (calculateLightBounds(lights[i].get(), viewMat, mLightBounds[i]) == false)
+            {
+                mLightBounds[i].radius = 0;
+            }
+        }
+
+        binLights(pCamera->getProjMatrix(), pCamera->getNearPlane(), pCamera->getFarPlane(), mLightBounds);
+
+        // The global lights are appended to the cluster lists when they are uploaded
+        mLightData.resize(lights.size());
+        for (size_t i = 0; i < lights.size(); i++)
+        {
+            mLightData[i] = lights[i]->getData();
+            if (mLightData[i].type == LightDirectional)
+            {
+                mGlobalLights.push_back((uint32_t)i);
+            }
+        }
+        mParams.globalLightOffset = (uint32_t)mIndexData.size();
+        mParams.globalLightCount = (uint32_t)mGlobalLights.size();
+    }
+
+    void LightClusterer::binSlices(uint32_t firstSlice, uint32_t lastSlice, const std::vector<LightBounds>& lightBounds)
+    {
+        const uint32_t tilesPerSlice = mParams.tilesX * mParams.tilesY;
+
+        for (uint32_t z = firstSlice; z < lastSlice; z++)
+        {
+            const float sliceNear = mSliceDepth[z];
+            const float sliceFar = mSliceDepth[z + 1];
+            uint32_t dropped = 0;
+
+            uint32_t* pCounts = mScratchCounts.data() + z * tilesPerSlice;
+            uint32_t* pIndices = mScratchIndices.data() + z * tilesPerSlice * mMaxLightsPerCluster;
+            memset(pCounts, 0, tilesPerSlice * sizeof(uint32_t));
+
+            const float* pMinX = mClusterMinX.data() + z * mTileStride;
+            const float* pMinY = mClusterMinY.data() + z * mTileStride;
+            const float* pMinZ = mClusterMinZ.data() + z * mTileStride;
+            const float* pMaxX = mClusterMaxX.data() + z * mTileStride;
+            const float* pMaxY = mClusterMaxY.data() + z * mTileStride;
+            const float* pMaxZ = mClusterMaxZ.data() + z * mTileStride;
+
+            for (uint32_t l = 0; l < (uint32_t)lightBounds.size(); l++)
+            {
+                const LightBounds& light = lightBounds[l];
+                const float depth = -light.center.z;
+                if (light.radius <= 0 || depth + light.radius < sliceNear || depth - light.radius > sliceFar)
+                {
+                    continue;
+                }
+
+                const __m128 cx = _mm_set1_ps(light.center.x);
+                const __m128 cy = _mm_set1_ps(light.center.y);
+                const __m128 cz = _mm_set1_ps(light.center.z);
+                const __m128 r2 = _mm_set1_ps(light.radius * light.radius);
+                const __m128 zero = _mm_setzero_ps();
+
+                for (uint32_t tile = 0; tile < mTileStride; tile += 4)
+                {
+                    // Squared distance from the sphere center to the box, for 4 clusters at once
+                    __m128 dx = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(pMinX + tile), cx), _mm_sub_ps(cx, _mm_loadu_ps(pMaxX + tile)));
+                    __m128 dy = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(pMinY + tile), cy), _mm_sub_ps(cy, _mm_loadu_ps(pMaxY + tile)));
+                    __m128 dz = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(pMinZ + tile), cz), _mm_sub_ps(cz, _mm_loadu_ps(pMaxZ + tile)));
+                    dx = _mm_max_ps(dx, zero);
+                    dy = _mm_max_ps(dy, zero);
+                    dz = _mm_max_ps(dz, zero);
+                    __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                    int mask = _mm_movemask_ps(_mm_cmple_ps(dist2, r2));
+
+                    while (mask)
+                    {
+                        uint32_t bit = 0;
+                        while (((mask >> bit) & 1) == 0)
+                        {
+                            bit++;
+                        }
+                        mask &= ~(1 << bit);
+
+                        uint32_t cluster = tile + bit;
+                        uint32_t& count = pCounts[cluster];
+                        if (count < mMaxLightsPerCluster)
+                        {
+                            pIndices[cluster * mMaxLightsPerCluster + count] = l;
+                            count++;
+                        }
+                        else
+                        {
+                            dropped++;
+                        }
+                    }
+                }
+            }
+            mSliceDroppedCount[z] = dropped;
+        }
+    }
+
+    void LightClusterer::compactClusters()
+    {
+        const uint32_t clusterCount = getClusterCount();
+
+        uint32_t offset = 0;
+        uint32_t maxCount = 0;
+        for (uint32_t c = 0; c < clusterCount; c++)
+        {
+            uint32_t count = mScratchCounts[c];
+            mGridData[c * 2] = offset;
+            mGridData[c * 2 + 1] = count;
+            offset += count;
+            maxCount = max(maxCount, count);
+        }
+
+        mIndexData.resize(offset);
+        ThreadPool::instance()->parallelFor(clusterCount, 256, [this](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t c = begin; c < end; c++)
+            {
+                const uint32_t count = mGridData[c * 2 + 1];
+                if (count)
+                {
+                    memcpy(mIndexData.data() + mGridData[c * 2], mScratchIndices.data() + c * mMaxLightsPerCluster, count * sizeof(uint32_t));
+                }
+            }
+        });
+
+        mStats.indexCount = offset;
+        mStats.maxLightsPerCluster = maxCount;
+    }
+
+    void LightClusterer::binLights(const glm::mat4& projMat, float nearZ, float farZ, const std::vector<LightBounds>& lightBounds)
+    {
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+
+        mLightData.clear();
+        mGlobalLights.clear();
+        mParams.globalLightOffset = 0;
+        mParams.globalLightCount = 0;
+        updateClusterBounds(projMat, nearZ, farZ);
+
+        // Slices are independent, so each job owns a range of slices and no synchronization is required
+        ThreadPool::instance()->parallelFor(mParams.slicesZ, 1, [this, &lightBounds](uint32_t begin, uint32_t end)
+        {
+            binSlices(begin, end, lightBounds);
+        });
+
+        compactClusters();
+
+        mStats.lightCount = (uint32_t)lightBounds.size();
+        mStats.droppedIndexCount = 0;
+        for (uint32_t dropped : mSliceDroppedCount)
+        {
+            mStats.droppedIndexCount += dropped;
+        }
+
+        std::vector<bool> isBinned(lightBounds.size(), false);
+        mStats.binnedLightCount = 0;
+        for (uint32_t l : mIndexData)
+        {
+            if (isBinned[l] == false)
+            {
+                isBinned[l] = true;
+                mStats.binnedLightCount++;
+            }
+        }
+
+        if (mStats.droppedIndexCount)
+        {
+            logWarning("LightClusterer::binLights() - " + std::to_string(mStats.droppedIndexCount) + " light indices were dropped. Consider increasing the cluster capacity or the influence threshold.");
+        }
+
+        mStats.binningTime = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        mGpuDirty = true;
+    }
+
+    const uint32_t* LightClusterer::getClusterLights(uint32_t clusterIndex, uint32_t& count) const
+    {
+        assert(clusterIndex < getClusterCount());
+        count = mGridData[clusterIndex * 2 + 1];
+        return count ? mIndexData.data() + mGridData[clusterIndex * 2] : nullptr;
+    }
+
+    void LightClusterer::getClusterBounds(uint32_t clusterIndex, glm::vec3& minPos, glm::vec3& maxPos) const
+    {
+        assert(clusterIndex < getClusterCount());
+        const uint32_t tilesPerSlice = mParams.tilesX * mParams.tilesY;
+        const uint32_t i = (clusterIndex / tilesPerSlice) * mTileStride + (clusterIndex % tilesPerSlice);
+        minPos = glm::vec3(mClusterMinX[i], mClusterMinY[i], mClusterMinZ[i]);
+        maxPos = glm::vec3(mClusterMaxX[i], mClusterMaxY[i], mClusterMaxZ[i]);
+    }
+
+    bool LightClusterer::setIntoProgramVars(ProgramVars* pVars)
+    {
+        const ProgramReflection* pReflector = pVars->getReflection().get();
+        const auto& pLightsReflector = pReflector->getBufferDesc(kLightsBufferName, ProgramReflection::BufferReflection::Type::Structured);
+        if (pReflector->getBufferDesc(kConstantBufferName, ProgramReflection::BufferReflection::Type::Constant) == nullptr || pLightsReflector == nullptr)
+        {
+            return false;
+        }
+
+        if (mGpuDirty)
+        {
+            if (mpGridBuffer == nullptr)
+            {
+                mpGridBuffer = Buffer::create(mGridData.size() * sizeof(uint32_t), Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, mGridData.data());
+            }
+            else
+            {
+                mpGridBuffer->updateData(mGridData.data(), 0, mGridData.size() * sizeof(uint32_t));
+            }
+
+            // Grow the index buffer geometrically to avoid re-creating it every time a light moves
+            size_t indexSize = max<size_t>(mIndexData.size() + mGlobalLights.size(), 1) * sizeof(uint32_t);
+            if (mpIndexBuffer == nullptr || mpIndexBuffer->getSize() < indexSize)
+            {
+                size_t capacity = mpIndexBuffer ? max(indexSize, mpIndexBuffer->getSize() * 2) : indexSize;
+                mpIndexBuffer = Buffer::create(capacity, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, nullptr);
+            }
+            if (mIndexData.empty() == false)
+            {
+                mpIndexBuffer->updateData(mIndexData.data(), 0, mIndexData.size() * sizeof(uint32_t));
+            }
+            if (mGlobalLights.empty() == false)
+            {
+                mpIndexBuffer->updateData(mGlobalLights.data(), mParams.globalLightOffset * sizeof(uint32_t), mGlobalLights.size() * sizeof(uint32_t));
+            }
+
+            size_t lightCount = max<size_t>(mLightData.size(), 1);
+            if (mpLightBuffer == nullptr || mpLightBuffer->getElementCount() < lightCount)
+            {
+                size_t capacity = mpLightBuffer ? max(lightCount, mpLightBuffer->getElementCount() * 2) : lightCount;
+                mpLightBuffer = StructuredBuffer::create(pLightsReflector, capacity, Resource::BindFlags::ShaderResource);
+            }
+            if (mLightData.empty() == false)
+            {
+                mpLightBuffer->setBlob(mLightData.data(), 0, mLightData.size() * sizeof(LightData));
+            }
+            mGpuDirty = false;
+        }
+
+        ConstantBuffer* pCB = pVars->getConstantBuffer(kConstantBufferName).get();
+        size_t offset = pCB->getVariableOffset(std::string(kParamsVarName) + ".tilesX");
+        if (offset == ConstantBuffer::kInvalidOffset)
+        {
+            logWarning("LightClusterer::setIntoProgramVars() - variable \"" + std::string(kParamsVarName) + "\" not found in constant buffer\n");
+            return false;
+        }
+        pCB->setBlob(&mParams, offset, sizeof(mParams));
+
+        pVars->setRawBuffer(kGridBufferName, mpGridBuffer);
+        pVars->setRawBuffer(kIndexBufferName, mpIndexBuffer);
+        pVars->setStructuredBuffer(kLightsBufferName, mpLightBuffer);
+        return true;
+    }
+
+    void LightClusterer::renderUI(Gui* pGui, const char* uiGroup)
+    {
+        if ((uiGroup == nullptr) || pGui->beginGroup(uiGroup))
+        {
+            std::string msg = "Grid: " + std::to_string(mParams.tilesX) + "x" + std::to_string(mParams.tilesY) + "x" + std::to_string(mParams.slicesZ) + "\n";
+            msg += "Lights binned: " + std::to_string(mStats.binnedLightCount) + "/" + std::to_string(mStats.lightCount) + "\n";
+            msg += "Light indices: " + std::to_string(mStats.indexCount) + " (max " + std::to_string(mStats.maxLightsPerCluster) + " per cluster)\n";
+            msg += "Dropped indices: " + std::to_string(mStats.droppedIndexCount) + "\n";
+            msg += "Binning time: " + std::to_string(mStats.binningTime) + " ms";
+            pGui->addText(msg.c_str());
+            pGui->addFloatVar("Influence Threshold", mInfluenceThreshold, 1e-6f, 10.0f, 0.001f);
+
+            if (uiGroup)
+            {
+                pGui->endGroup();
+            }
+        }
+    }
+}
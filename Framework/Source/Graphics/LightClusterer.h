@@ -0,0 +1,192 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "Graphics/Light.h"
+#include "API/Buffer.h"
+#include "API/StructuredBuffer.h"
+#include "Data/HostDeviceData.h"
+
+namespace Falcor
+{
+    class Camera;
+    class ProgramVars;
+    class Gui;
+
+    /** Bins point and area lights into a 3D view-space cluster grid (froxels) for clustered forward shading.
+        The grid is made of screen-space tiles and exponentially distributed depth slices. Each cluster holds a compact list of the lights which affect it, so the shading cost scales with the local light density instead of the total light count.
+        Binning runs on the CPU using the global ThreadPool (one job per group of depth slices) and an SSE sphere-vs-AABB test which processes 4 clusters at a time.
+        To use it in a shader, include 'LightClusters.hlsli' and call evalClusteredLights(), then call setIntoProgramVars() after build(). SceneRenderer does both calls when a clusterer is attached, see SceneRenderer::setLightClusterer().
+    */
+    class LightClusterer
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightClusterer>;
+        using SharedConstPtr = std::shared_ptr<const LightClusterer>;
+
+        static const char* kConstantBufferName;     ///< The constant buffer declared in LightClusters.hlsli
+
+        /** View-space bounding sphere of a light's region of influence
+        */
+        struct LightBounds
+        {
+            glm::vec3 center;
+            float radius = 0;
+        };
+
+        /** Statistics of the last binning operation
+        */
+        struct Stats
+        {
+            uint32_t lightCount = 0;            ///< Number of lights passed to the clusterer
+            uint32_t binnedLightCount = 0;      ///< Number of lights which touched at least one cluster
+            uint32_t indexCount = 0;            ///< Total number of light indices in the cluster lists
+            uint32_t maxLightsPerCluster = 0;   ///< Largest cluster list
+            uint32_t droppedIndexCount = 0;     ///< Number of light indices which didn't fit into a cluster
+            float binningTime = 0;              ///< Time it took to bin the lights, in milliseconds
+        };
+
+        /** Create a new object
+            \param[in] tilesX Number of horizontal screen-space tiles
+            \param[in] tilesY Number of vertical screen-space tiles
+            \param[in] slicesZ Number of depth slices
+            \param[in] maxLightsPerCluster Capacity of a single cluster's light list. Lights which don't fit are dropped and reported in Stats::droppedIndexCount
+        */
+        static SharedPtr create(uint32_t tilesX = 16, uint32_t tilesY = 8, uint32_t slicesZ = 24, uint32_t maxLightsPerCluster = 64);
+
+        /** Set the radiance below which a light is considered to have no effect. This controls the radius of influence of point and area lights, which don't have an explicit range.
+        */
+        void setInfluenceThreshold(float threshold) { mInfluenceThreshold = threshold; }
+
+        /** Get the radiance below which a light is considered to have no effect
+        */
+        float getInfluenceThreshold() const { return mInfluenceThreshold; }
+
+        /** Bin the scene's lights into the clusters of a camera, and copy the light data for the shader. Directional lights affect all pixels, so they are added to the global light list instead of being binned.
+            \param[in] pCamera The camera to build the grid for
+            \param[in] lights The lights. The cluster lists contain indices into this vector.
+        */
+        void build(const Camera* pCamera, const std::vector<Light::SharedPtr>& lights);
+
+        /** Bin view-space light bounds into the clusters. This is the CPU part of build() and doesn't require a GPU, so it can be used for testing and benchmarking.
+            The light data and the global light list of the previous build() are cleared, so the shader sees no lights until the next build().
+            \param[in] projMat The camera's projection matrix
+            \param[in] nearZ Near plane distance
+            \param[in] farZ Far plane distance
+            \param[in] lightBounds View-space bounds of the lights. A radius of 0 means the light shouldn't be binned.
+        */
+        void binLights(const glm::mat4& projMat, float nearZ, float farZ, const std::vector<LightBounds>& lightBounds);
+
+        /** Compute the view-space region of influence of a light
+            \return false if the light affects everything and shouldn't be binned (directional lights)
+        */
+        bool calculateLightBounds(const Light* pLight, const glm::mat4& viewMat, LightBounds& bounds) const;
+
+        /** Upload the cluster data if needed, and bind it to a program which includes 'LightClusters.hlsli'
+            \param[in] pVars The program vars
+            \return false if the program doesn't declare the cluster data, otherwise true
+        */
+        bool setIntoProgramVars(ProgramVars* pVars);
+
+        /** Render the statistics
+        */
+        void renderUI(Gui* pGui, const char* uiGroup = nullptr);
+
+        /** Get the number of clusters in the grid
+        */
+        uint32_t getClusterCount() const { return mParams.tilesX * mParams.tilesY * mParams.slicesZ; }
+
+        /** Get a cluster's index given its grid coordinates
+        */
+        uint32_t getClusterIndex(uint32_t x, uint32_t y, uint32_t z) const { return (z * mParams.tilesY + y) * mParams.tilesX + x; }
+
+        /** Get the light list of a cluster
+            \param[in] clusterIndex The cluster index
+            \param[out] count The number of lights in the cluster
+            \return A pointer to the light indices, or nullptr if the cluster is empty
+        */
+        const uint32_t* getClusterLights(uint32_t clusterIndex, uint32_t& count) const;
+
+        /** Get the view-space bounds of a cluster, exactly as used by the binning. Only valid after a call to build() or binLights().
+        */
+        void getClusterBounds(uint32_t clusterIndex, glm::vec3& minPos, glm::vec3& maxPos) const;
+
+        /** Get the indices of the lights which affect all the clusters, as found by the last build()
+        */
+        const std::vector<uint32_t>& getGlobalLights() const { return mGlobalLights; }
+
+        /** Get the grid parameters, as passed to the shader
+        */
+        const LightClusterParams& getParams() const { return mParams; }
+
+        /** Get statistics of the last build
+        */
+        const Stats& getStats() const { return mStats; }
+
+    private:
+        LightClusterer(uint32_t tilesX, uint32_t tilesY, uint32_t slicesZ, uint32_t maxLightsPerCluster);
+        void updateClusterBounds(const glm::mat4& projMat, float nearZ, float farZ);
+        void binSlices(uint32_t firstSlice, uint32_t lastSlice, const std::vector<LightBounds>& lightBounds);
+        void compactClusters();
+
+        LightClusterParams mParams;
+        uint32_t mMaxLightsPerCluster;
+        uint32_t mTileStride;               ///< Number of tiles in a slice, padded to a multiple of 4 for the SIMD test
+        float mInfluenceThreshold = 0.01f;
+
+        // Cluster AABBs in view space, stored as SoA for SIMD. Indexed by [slice * mTileStride + tile]
+        std::vector<float> mClusterMinX, mClusterMinY, mClusterMinZ;
+        std::vector<float> mClusterMaxX, mClusterMaxY, mClusterMaxZ;
+        std::vector<float> mSliceDepth;     ///< Positive view-space depth of the slice boundaries
+        glm::mat4 mBoundsProjMat;
+        float mBoundsNearZ = 0;
+        float mBoundsFarZ = 0;
+
+        // Binning scratch space. Each cluster owns mMaxLightsPerCluster entries
+        std::vector<uint32_t> mScratchIndices;
+        std::vector<uint32_t> mScratchCounts;
+        std::vector<uint32_t> mSliceDroppedCount;
+        std::vector<LightBounds> mLightBounds;
+
+        // Lights of the last build(), for the shader
+        std::vector<LightData> mLightData;
+        std::vector<uint32_t> mGlobalLights;
+
+        // Compacted lists. mGridData holds a (offset, count) pair per cluster
+        std::vector<uint32_t> mGridData;
+        std::vector<uint32_t> mIndexData;
+
+        Buffer::SharedPtr mpGridBuffer;
+        Buffer::SharedPtr mpIndexBuffer;
+        StructuredBuffer::SharedPtr mpLightBuffer;
+        bool mGpuDirty = true;
+
+        Stats mStats;
+    };
+}
@@ -298,12 +298,6 @@ namespace Falcor
         }
     }
 
-#if _LOG_ENABLED
-#define check_offset(_a) assert(pCB->getVariableOffset(std::string(varName) + "." + #_a) == (offsetof(MaterialData, _a) + offset))
-#else
-#define check_offset(_a)
-#endif
-
     void Material::setIntoProgramVars(ProgramVars* pVars, ConstantBuffer* pCB, const char varName[]) const
     {
         // OPTME:
@@ -315,23 +309,11 @@ namespace Falcor
 
         // First set the desc and the values
         finalize();
-        static const size_t dataSize = sizeof(MaterialDesc) + sizeof(MaterialValues);
-        static_assert(dataSize % sizeof(glm::vec4) == 0, "Material::MaterialData size should be a multiple of 16");
-
-        size_t offset = pCB->getVariableOffset(std::string(varName) + ".desc.layers[0].type");
-
-        if(offset == ConstantBuffer::kInvalidOffset)
+        if(pCB->setParameterBlock(varName, mData) == false)
         {
-            logError(std::string("Material::setIntoConstantBuffer() - variable \"") + varName + "\"not found in constant buffer\n");
             return;
         }
 
-        check_offset(values.layers[0].albedo);
-        check_offset(values.id);
-        assert(offset + dataSize <= pCB->getSize());
-
-        pCB->setBlob(&mData, offset, dataSize);
-
 #ifdef FALCOR_GL
 #pragma error Fix material texture bindings for OpenGL
 #endif
@@ -375,6 +357,30 @@ namespace Falcor
         }
     }
 
+    void Material::getTextures(std::vector<Texture::SharedPtr>& textures) const
+    {
+        const Texture::SharedPtr* pTextures = (Texture::SharedPtr*)&mData.textures;
+        for(uint32_t i = 0; i < kTexCount; i++)
+        {
+            if(pTextures[i])
+            {
+                textures.push_back(pTextures[i]);
+            }
+        }
+    }
+
+    void Material::replaceTexture(const Texture* pOld, const Texture::SharedPtr& pNew) const
+    {
+        Texture::SharedPtr* pTextures = (Texture::SharedPtr*)&mData.textures;
+        for(uint32_t i = 0; i < kTexCount; i++)
+        {
+            if(pTextures[i].get() == pOld)
+            {
+                pTextures[i] = pNew;
+            }
+        }
+    }
+
     void Material::setLayerTexture(uint32_t layerId, const Texture::SharedPtr& pTexture)
     {
         mData.textures.layers[layerId] = pTexture;
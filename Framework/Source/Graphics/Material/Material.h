@@ -288,6 +288,14 @@ namespace Falcor
         */
         void evictTextures() const;
 
+        /** Get all the non-null textures the material references. A texture used by several slots is reported once per slot.
+        */
+        void getTextures(std::vector<Texture::SharedPtr>& textures) const;
+
+        /** Replace a texture in every slot that references it. Used by the texture streamer to swap between mip-chains of the same texture, so the material desc doesn't change.
+        */
+        void replaceTexture(const Texture* pOld, const Texture::SharedPtr& pNew) const;
+
         /** Comparison operator
         */
         bool operator==(const Material& other) const;
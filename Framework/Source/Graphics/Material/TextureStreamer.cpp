@@ -0,0 +1,535 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <mutex>
+#include <cfloat>
+#include "Graphics/Scene/Scene.h"
+#include "Graphics/Camera/Camera.h"
+#include "API/Device.h"
+#include "API/RenderContext.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/Gui.h"
+
+namespace Falcor
+{
+    static const uint32_t kMinResidentSize = 64;    ///< Textures are never trimmed below this resolution
+    static const uint32_t kInvalidEntry = (uint32_t)-1;
+
+    struct RegisteredSource
+    {
+        std::weak_ptr<Texture> pTexture;
+        TextureStreamer::Source source;
+    };
+
+    static std::mutex sSourceMutex;
+    static std::unordered_map<const Texture*, RegisteredSource> sRegisteredSources;
+
+    static TextureStreamer::Source findTextureSource(const Texture::SharedPtr& pTexture)
+    {
+        {
+            std::lock_guard<std::mutex> lock(sSourceMutex);
+            auto it = sRegisteredSources.find(pTexture.get());
+            // The address may have been reused by a different texture
+            if(it != sRegisteredSources.end() && it->second.pTexture.lock() == pTexture)
+            {
+                return it->second.source;
+            }
+        }
+
+        std::string filename = pTexture->getSourceFilename();
+        if(filename.size())
+        {
+            return [filename](uint32_t firstMip, TextureMipChain& chain) { return loadTextureMipChain(filename, firstMip, chain); };
+        }
+        return nullptr;
+    }
+
+    void TextureStreamer::registerTextureSource(const Texture::SharedPtr& pTexture, const Source& source)
+    {
+        std::lock_guard<std::mutex> lock(sSourceMutex);
+        for(auto it = sRegisteredSources.begin(); it != sRegisteredSources.end();)
+        {
+            it = it->second.pTexture.expired() ? sRegisteredSources.erase(it) : std::next(it);
+        }
+        sRegisteredSources[pTexture.get()] = { pTexture, source };
+    }
+
+    TextureStreamer::SharedPtr TextureStreamer::create(uint64_t budgetInBytes)
+    {
+        return SharedPtr(new TextureStreamer(budgetInBytes));
+    }
+
+    TextureStreamer::TextureStreamer(uint64_t budgetInBytes) : mBudget(budgetInBytes)
+    {
+        mpCopyQueue = gpDevice ? gpDevice->getCopyQueue() : nullptr;
+    }
+
+    TextureStreamer::~TextureStreamer()
+    {
+        // The jobs own their data, but don't leave them running after the streamer is gone
+        for(auto& entry : mTextures)
+        {
+            if(entry.loading && entry.pendingLoad.valid())
+            {
+                entry.pendingLoad.wait();
+            }
+        }
+    }
+
+    uint64_t TextureStreamer::getChainSize(const TextureEntry& entry, uint32_t firstMip) const
+    {
+        uint64_t size = 0;
+        for(uint32_t mip = firstMip; mip < entry.mipCount; mip++)
+        {
+            size += getTextureMipSize(entry.width, entry.height, entry.format, mip);
+        }
+        return size;
+    }
+
+    void TextureStreamer::addScene(const Scene* pScene)
+    {
+        for(uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = pScene->getModel(modelID).get();
+            for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                const Material::SharedPtr& pMaterial = pModel->getMesh(meshID)->getMaterial();
+                if(pMaterial)
+                {
+                    addMaterial(pMaterial);
+                }
+            }
+        }
+    }
+
+    void TextureStreamer::addMaterial(const Material::SharedPtr& pMaterial)
+    {
+        if(mMaterialTextures.find(pMaterial.get()) != mMaterialTextures.end())
+        {
+            return;
+        }
+
+        std::vector<Texture::SharedPtr> textures;
+        pMaterial->getTextures(textures);
+        std::vector<uint32_t>& indices = mMaterialTextures[pMaterial.get()];
+
+        for(const auto& pTexture : textures)
+        {
+            uint32_t index;
+            auto it = mTextureIndex.find(pTexture.get());
+            if(it == mTextureIndex.end())
+            {
+                index = (uint32_t)mTextures.size();
+                mTextureIndex[pTexture.get()] = index;
+                mTextures.emplace_back();
+
+                TextureEntry& entry = mTextures.back();
+                entry.pTexture = pTexture;
+                entry.width = pTexture->getWidth();
+                entry.height = pTexture->getHeight();
+                entry.mipCount = pTexture->getMipCount();
+                entry.format = pTexture->getFormat();
+                entry.source = findTextureSource(pTexture);
+
+                // Find the coarsest level we'd trim to. Block-compressed textures must keep block-aligned dimensions so that the GPU copies line up
+                const uint32_t widthRatio = getFormatWidthCompressionRatio(entry.format);
+                const uint32_t heightRatio = getFormatHeightCompressionRatio(entry.format);
+                while(entry.tailMip + 1 < entry.mipCount)
+                {
+                    uint32_t w = entry.width >> (entry.tailMip + 1);
+                    uint32_t h = entry.height >> (entry.tailMip + 1);
+                    if(max(w, h) < kMinResidentSize || (w % widthRatio) != 0 || (h % heightRatio) != 0)
+                    {
+                        break;
+                    }
+                    entry.tailMip++;
+                }
+
+                entry.streamable = entry.source && (pTexture->getType() == Texture::Type::Texture2D) && (pTexture->getArraySize() == 1) && (entry.tailMip > 0);
+                mResidentBytes += getChainSize(entry, 0);
+            }
+            else
+            {
+                index = it->second;
+            }
+
+            TextureEntry& entry = mTextures[index];
+            if(std::find(entry.materials.begin(), entry.materials.end(), pMaterial) == entry.materials.end())
+            {
+                entry.materials.push_back(pMaterial);
+            }
+            if(std::find(indices.begin(), indices.end(), index) == indices.end())
+            {
+                indices.push_back(index);
+            }
+        }
+    }
+
+    void TextureStreamer::clear()
+    {
+        flush();
+        mTextures.clear();
+        mTextureIndex.clear();
+        mMaterialTextures.clear();
+        mResidentBytes = 0;
+        mPendingBytes = 0;
+        mStats = Stats();
+    }
+
+    float TextureStreamer::calculateScreenSize(const BoundingBox& box, const Camera* pCamera, uint32_t viewportHeight)
+    {
+        float radius = glm::length(box.extent);
+        float distance = glm::length(box.center - pCamera->getPosition());
+        if(distance <= radius)
+        {
+            return FLT_MAX;
+        }
+
+        // Projected diameter of the bounding sphere. projMat[1][1] is 1/tan(fovY/2)
+        return (radius / distance) * pCamera->getProjMatrix()[1][1] * (float)viewportHeight;
+    }
+
+    void TextureStreamer::requestMaterial(const Material* pMaterial, float screenSize)
+    {
+        auto it = mMaterialTextures.find(pMaterial);
+        if(it == mMaterialTextures.end())
+        {
+            return;
+        }
+
+        screenSize = max(screenSize, 1.0f);
+        for(uint32_t index : it->second)
+        {
+            TextureEntry& entry = mTextures[index];
+
+            // Assume the UVs cover the texture about once across the object
+            float texels = (float)max(entry.width, entry.height);
+            int32_t mip = (int32_t)floor(log2(texels / screenSize)) + mMipBias;
+            uint32_t wantedMip = (uint32_t)clamp(mip, 0, (int32_t)entry.tailMip);
+
+            if(entry.lastUsedFrame != mFrameIndex)
+            {
+                entry.lastUsedFrame = mFrameIndex;
+                entry.wantedMip = wantedMip;
+            }
+            else
+            {
+                entry.wantedMip = min(entry.wantedMip, wantedMip);
+            }
+        }
+    }
+
+    void TextureStreamer::bindTexture(TextureEntry& entry, const Texture::SharedPtr& pTexture, uint32_t residentMip)
+    {
+        uint32_t index = mTextureIndex[entry.pTexture.get()];
+        mTextureIndex.erase(entry.pTexture.get());
+        mTextureIndex[pTexture.get()] = index;
+
+        for(const auto& pMaterial : entry.materials)
+        {
+            pMaterial->replaceTexture(entry.pTexture.get(), pTexture);
+        }
+
+        pTexture->setSourceFilename(entry.pTexture->getSourceFilename());
+        mResidentBytes = mResidentBytes - getChainSize(entry, entry.residentMip) + getChainSize(entry, residentMip);
+        entry.pTexture = pTexture;
+        entry.residentMip = residentMip;
+    }
+
+    void TextureStreamer::issueLoad(uint32_t entryIndex, uint32_t mip)
+    {
+        TextureEntry& entry = mTextures[entryIndex];
+        entry.loading = true;
+        entry.loadingMip = mip;
+        entry.pChain = std::make_shared<TextureMipChain>();
+
+        std::shared_ptr<TextureMipChain> pChain = entry.pChain;
+        Source source = entry.source;
+        entry.pendingLoad = ThreadPool::instance()->submit([source, pChain, mip]() { return source(mip, *pChain); });
+
+        mPendingBytes += getChainSize(entry, mip) - getChainSize(entry, entry.residentMip);
+        mPendingLoadCount++;
+    }
+
+    void TextureStreamer::completeLoads(bool wait)
+    {
+        for(auto& entry : mTextures)
+        {
+            if(entry.loading == false || entry.pUploadTexture)
+            {
+                continue;
+            }
+            if(wait == false && entry.pendingLoad.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                continue;
+            }
+
+            bool success = entry.pendingLoad.get();
+            const TextureMipChain& chain = *entry.pChain;
+            const uint32_t mipCount = entry.mipCount - entry.loadingMip;
+            Texture::SharedPtr pTexture;
+            if(success && chain.mipCount > 0 && chain.width == max(entry.width >> entry.loadingMip, 1U) && chain.height == max(entry.height >> entry.loadingMip, 1U) &&
+                getFormatBytesPerBlock(chain.format) == getFormatBytesPerBlock(entry.format) && isCompressedFormat(chain.format) == isCompressedFormat(entry.format))
+            {
+                // Use the entry's format, so that the sRGB flag the texture was created with is kept
+                if(chain.mipCount >= mipCount && mpCopyQueue)
+                {
+                    // Upload on the copy queue. The texture is bound once the copy completed, so rendering never waits for it.
+                    pTexture = Texture::create2D(chain.width, chain.height, entry.format, 1, mipCount, nullptr);
+                    if(pTexture)
+                    {
+                        entry.uploadTicket = mpCopyQueue->updateTexture(pTexture.get(), chain.data.data());
+                        entry.pUploadTexture = pTexture;
+                        entry.pChain = nullptr;
+                        continue;
+                    }
+                }
+                else if(chain.mipCount >= mipCount)
+                {
+                    pTexture = Texture::create2D(chain.width, chain.height, entry.format, 1, mipCount, chain.data.data());
+                }
+                else if(isCompressedFormat(entry.format) == false && (entry.width >> (entry.mipCount - 1)) <= 1 && (entry.height >> (entry.mipCount - 1)) <= 1)
+                {
+                    // The source doesn't have the full chain, but the texture does. Generate the rest on the GPU
+                    pTexture = Texture::create2D(chain.width, chain.height, entry.format, 1, Texture::kMaxPossible, chain.data.data());
+                }
+            }
+
+            finishLoad(entry, pTexture);
+        }
+
+        if(mpCopyQueue)
+        {
+            mpCopyQueue->submit();
+            for(auto& entry : mTextures)
+            {
+                if(entry.pUploadTexture)
+                {
+                    if(wait)
+                    {
+                        mpCopyQueue->waitCpu(entry.uploadTicket);
+                    }
+                    else if(mpCopyQueue->isComplete(entry.uploadTicket) == false)
+                    {
+                        continue;
+                    }
+                    finishLoad(entry, entry.pUploadTexture);
+                }
+            }
+        }
+    }
+
+    void TextureStreamer::finishLoad(TextureEntry& entry, const Texture::SharedPtr& pTexture)
+    {
+        entry.loading = false;
+        mPendingLoadCount--;
+        // Loading entries are never trimmed, so residentMip is the same as when the load was issued
+        mPendingBytes -= getChainSize(entry, entry.loadingMip) - getChainSize(entry, entry.residentMip);
+
+        if(pTexture)
+        {
+            mStats.loadedBytes += getChainSize(entry, entry.loadingMip);
+            bindTexture(entry, pTexture, entry.loadingMip);
+        }
+        else
+        {
+            logWarning("TextureStreamer - can't load mip-level " + std::to_string(entry.loadingMip) + " of texture '" + entry.pTexture->getSourceFilename() + "'. The texture will no longer be streamed.");
+            entry.streamable = false;
+        }
+        entry.pChain = nullptr;
+        entry.pUploadTexture = nullptr;
+    }
+
+    void TextureStreamer::trimEntry(TextureEntry& entry, uint32_t mip)
+    {
+        const uint32_t mipCount = entry.mipCount - mip;
+        Texture::SharedPtr pTexture = Texture::create2D(max(entry.width >> mip, 1U), max(entry.height >> mip, 1U), entry.format, 1, mipCount, nullptr);
+        if(pTexture == nullptr)
+        {
+            return;
+        }
+
+        RenderContext* pContext = gpDevice->getRenderContext().get();
+        for(uint32_t i = 0; i < mipCount; i++)
+        {
+            pContext->copySubresource(pTexture.get(), pTexture->getSubresourceIndex(0, i), entry.pTexture.get(), entry.pTexture->getSubresourceIndex(0, i + mip - entry.residentMip));
+        }
+        bindTexture(entry, pTexture, mip);
+        mStats.evictionCount++;
+    }
+
+    bool TextureStreamer::trim(uint64_t requiredBytes, uint32_t excludedEntry)
+    {
+        auto fits = [&]() { return mResidentBytes + mPendingBytes + requiredBytes <= mBudget; };
+        if(fits())
+        {
+            return true;
+        }
+
+        // Visible textures can only lose the levels they don't need this frame. The others are trimmed down to their tail
+        auto getFloorMip = [this](const TextureEntry& entry) { return (entry.lastUsedFrame == mFrameIndex) ? entry.wantedMip : entry.tailMip; };
+
+        std::vector<uint32_t> candidates;
+        for(uint32_t i = 0; i < (uint32_t)mTextures.size(); i++)
+        {
+            const TextureEntry& entry = mTextures[i];
+            if(i != excludedEntry && entry.streamable && entry.loading == false && entry.residentMip < getFloorMip(entry))
+            {
+                candidates.push_back(i);
+            }
+        }
+
+        // Least-recently-needed first. Between textures last needed in the same frame, free the larger ones first
+        std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b)
+        {
+            const TextureEntry& entryA = mTextures[a];
+            const TextureEntry& entryB = mTextures[b];
+            if(entryA.lastUsedFrame != entryB.lastUsedFrame)
+            {
+                return entryA.lastUsedFrame < entryB.lastUsedFrame;
+            }
+            return getChainSize(entryA, entryA.residentMip) > getChainSize(entryB, entryB.residentMip);
+        });
+
+        for(uint32_t index : candidates)
+        {
+            trimEntry(mTextures[index], getFloorMip(mTextures[index]));
+            if(fits())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void TextureStreamer::update()
+    {
+        mStats.loadedBytes = 0;
+        mStats.evictionCount = 0;
+        completeLoads(false);
+
+        // Collect the textures which are visible at a lower resolution than they need
+        std::vector<uint32_t> requests;
+        uint32_t visibleCount = 0;
+        uint32_t missCount = 0;
+        uint32_t streamableCount = 0;
+        for(uint32_t i = 0; i < (uint32_t)mTextures.size(); i++)
+        {
+            const TextureEntry& entry = mTextures[i];
+            streamableCount += entry.streamable ? 1 : 0;
+            if(entry.lastUsedFrame != mFrameIndex)
+            {
+                continue;
+            }
+
+            visibleCount++;
+            if(entry.wantedMip < entry.residentMip)
+            {
+                missCount++;
+                if(entry.streamable && entry.loading == false)
+                {
+                    requests.push_back(i);
+                }
+            }
+        }
+
+        // Largest shortfall first
+        std::sort(requests.begin(), requests.end(), [this](uint32_t a, uint32_t b)
+        {
+            return (mTextures[a].residentMip - mTextures[a].wantedMip) > (mTextures[b].residentMip - mTextures[b].wantedMip);
+        });
+
+        for(uint32_t index : requests)
+        {
+            if(mPendingLoadCount >= mMaxPendingLoads)
+            {
+                break;
+            }
+
+            // If the requested level doesn't fit, settle for a coarser one
+            const TextureEntry& entry = mTextures[index];
+            for(uint32_t mip = entry.wantedMip; mip < entry.residentMip; mip++)
+            {
+                if(trim(getChainSize(entry, mip) - getChainSize(entry, entry.residentMip), index))
+                {
+                    issueLoad(index, mip);
+                    break;
+                }
+            }
+        }
+
+        // Stay within the budget even when nothing was requested, e.g. after the budget was lowered
+        trim(0, kInvalidEntry);
+
+        mStats.residentBytes = mResidentBytes;
+        mStats.pendingBytes = mPendingBytes;
+        mStats.textureCount = (uint32_t)mTextures.size();
+        mStats.streamableCount = streamableCount;
+        mStats.visibleCount = visibleCount;
+        mStats.missCount = missCount;
+        mStats.pendingLoadCount = mPendingLoadCount;
+        mFrameIndex++;
+    }
+
+    void TextureStreamer::flush()
+    {
+        completeLoads(true);
+        mStats.residentBytes = mResidentBytes;
+        mStats.pendingBytes = mPendingBytes;
+        mStats.pendingLoadCount = mPendingLoadCount;
+    }
+
+    void TextureStreamer::renderUI(Gui* pGui, const char* uiGroup)
+    {
+        if((uiGroup == nullptr) || pGui->beginGroup(uiGroup))
+        {
+            const float kMB = 1024.0f * 1024.0f;
+            std::string msg = "Resident: " + std::to_string(mStats.residentBytes / kMB) + " MB\n";
+            msg += "Pending: " + std::to_string(mStats.pendingBytes / kMB) + " MB in " + std::to_string(mStats.pendingLoadCount) + " loads\n";
+            msg += "Loaded this frame: " + std::to_string(mStats.loadedBytes / kMB) + " MB\n";
+            msg += "Textures: " + std::to_string(mStats.visibleCount) + " visible, " + std::to_string(mStats.streamableCount) + "/" + std::to_string(mStats.textureCount) + " streamable\n";
+            msg += "Misses: " + std::to_string(mStats.missCount) + "\n";
+            msg += "Evictions: " + std::to_string(mStats.evictionCount);
+            pGui->addText(msg.c_str());
+
+            int32_t budgetMB = (int32_t)(mBudget / (1024 * 1024));
+            if(pGui->addIntVar("Budget (MB)", budgetMB, 1))
+            {
+                mBudget = (uint64_t)budgetMB * 1024 * 1024;
+            }
+            pGui->addIntVar("Mip Bias", mMipBias, -4, 8);
+
+            if(uiGroup)
+            {
+                pGui->endGroup();
+            }
+        }
+    }
+}
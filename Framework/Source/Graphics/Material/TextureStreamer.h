@@ -0,0 +1,200 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <future>
+#include "API/Texture.h"
+#include "Graphics/TextureHelper.h"
+#include "Graphics/Material/Material.h"
+#include "Utils/AABB.h"
+#include "API/AsyncCopyQueue.h"
+
+namespace Falcor
+{
+    class Scene;
+    class Camera;
+    class Gui;
+
+    /** Manages the GPU residency of material textures under a memory budget.
+        Each frame, the renderer reports which materials are visible and how large they appear on screen. The streamer converts that into the most detailed mip-level each texture needs, loads missing levels asynchronously on the global ThreadPool and swaps the material textures once the data arrives.
+        When the budget is exceeded, the least-recently-needed textures are trimmed to the coarsest mip-level they still need (or to a small resident tail if they aren't visible). Trimming is a GPU copy and doesn't touch the disk.
+        Textures are streamed from DDS files, from any other image file via the CPU mip-generator, or from a custom source registered with registerTextureSource() (used for images embedded in binary models).
+    */
+    class TextureStreamer
+    {
+    public:
+        using SharedPtr = std::shared_ptr<TextureStreamer>;
+        using SharedConstPtr = std::shared_ptr<const TextureStreamer>;
+
+        /** Reads mip-levels [firstMip, lastMip] of a texture into system memory. Called from worker threads, so it must be thread-safe.
+            The chain may stop early, as long as it contains firstMip. The missing levels will be generated on the GPU.
+        */
+        using Source = std::function<bool(uint32_t firstMip, TextureMipChain& chain)>;
+
+        /** Per-frame statistics
+        */
+        struct Stats
+        {
+            uint64_t residentBytes = 0;         ///< GPU memory used by the streamed textures
+            uint64_t pendingBytes = 0;          ///< GPU memory reserved by loads in flight
+            uint64_t loadedBytes = 0;           ///< Bytes uploaded during the last update
+            uint32_t textureCount = 0;          ///< Number of textures tracked
+            uint32_t streamableCount = 0;       ///< Number of textures which have a source and can change resolution
+            uint32_t visibleCount = 0;          ///< Number of textures requested during the last frame
+            uint32_t missCount = 0;             ///< Number of visible textures which were resident at a lower resolution than requested
+            uint32_t pendingLoadCount = 0;      ///< Number of loads in flight
+            uint32_t evictionCount = 0;         ///< Number of textures trimmed during the last update
+        };
+
+        /** Create a new object
+            \param[in] budgetInBytes The GPU memory budget for the streamed textures
+        */
+        static SharedPtr create(uint64_t budgetInBytes = 512ull * 1024 * 1024);
+        ~TextureStreamer();
+
+        /** Register the source of a texture which wasn't loaded from a file. The source is picked up when a material using the texture is added to a streamer.
+        */
+        static void registerTextureSource(const Texture::SharedPtr& pTexture, const Source& source);
+
+        /** Track all the textures used by a scene's models
+        */
+        void addScene(const Scene* pScene);
+
+        /** Track the textures of a material
+        */
+        void addMaterial(const Material::SharedPtr& pMaterial);
+
+        /** Stop tracking all textures. Textures are left at their current resolution.
+        */
+        void clear();
+
+        /** Report that a material is visible in the current frame. Call this for each visible mesh instance.
+            \param[in] pMaterial The material
+            \param[in] screenSize The projected size of the mesh instance, in pixels
+        */
+        void requestMaterial(const Material* pMaterial, float screenSize);
+
+        /** Estimate the projected size of a bounding box, in pixels
+            \param[in] box World-space bounding box
+            \param[in] pCamera The camera
+            \param[in] viewportHeight The viewport height in pixels
+        */
+        static float calculateScreenSize(const BoundingBox& box, const Camera* pCamera, uint32_t viewportHeight);
+
+        /** Process the requests of the last frame. Completed loads are bound to their materials, new loads are issued and textures are trimmed to stay within the budget.
+            Call this once per frame, before rendering.
+        */
+        void update();
+
+        /** Block until all the loads in flight are completed and bound
+        */
+        void flush();
+
+        /** Set the GPU memory budget
+        */
+        void setBudget(uint64_t budgetInBytes) { mBudget = budgetInBytes; }
+
+        /** Get the GPU memory budget
+        */
+        uint64_t getBudget() const { return mBudget; }
+
+        /** Set a bias added to the requested mip-levels. Positive values trade quality for memory.
+        */
+        void setMipBias(int32_t bias) { mMipBias = bias; }
+
+        /** Get the mip-level bias
+        */
+        int32_t getMipBias() const { return mMipBias; }
+
+        /** Set the maximum number of loads in flight
+        */
+        void setMaxPendingLoads(uint32_t count) { mMaxPendingLoads = count; }
+
+        /** Set the queue used to upload the loaded levels. By default the device's copy queue is used. Pass nullptr to upload on the render-context.
+        */
+        void setCopyQueue(const AsyncCopyQueue::SharedPtr& pQueue) { mpCopyQueue = pQueue; }
+
+        /** Render the statistics and settings
+        */
+        void renderUI(Gui* pGui, const char* uiGroup = nullptr);
+
+        /** Get the statistics of the last update
+        */
+        const Stats& getStats() const { return mStats; }
+
+    private:
+        TextureStreamer(uint64_t budgetInBytes);
+
+        struct TextureEntry
+        {
+            Texture::SharedPtr pTexture;                    ///< The texture currently bound to the materials
+            std::vector<Material::SharedPtr> materials;     ///< Materials referencing the texture
+            Source source;
+            uint32_t width = 0;                             ///< Mip 0 dimensions
+            uint32_t height = 0;
+            uint32_t mipCount = 0;                          ///< Length of the full mip-chain
+            ResourceFormat format = ResourceFormat::Unknown;
+            bool streamable = false;
+            uint32_t residentMip = 0;                       ///< Most detailed resident level, pTexture's mip 0
+            uint32_t tailMip = 0;                           ///< Coarsest level the texture is ever trimmed to
+            uint32_t wantedMip = 0;                         ///< Most detailed level requested in the current frame
+            uint64_t lastUsedFrame = 0;
+
+            bool loading = false;
+            uint32_t loadingMip = 0;
+            std::shared_ptr<TextureMipChain> pChain;
+            std::future<bool> pendingLoad;
+            Texture::SharedPtr pUploadTexture;              ///< The loaded texture, while it's uploaded on the copy queue
+            AsyncCopyQueue::Ticket uploadTicket = 0;
+        };
+
+        uint64_t getChainSize(const TextureEntry& entry, uint32_t firstMip) const;
+        void completeLoads(bool wait);
+        void finishLoad(TextureEntry& entry, const Texture::SharedPtr& pTexture);
+        void issueLoad(uint32_t entryIndex, uint32_t mip);
+        bool trim(uint64_t requiredBytes, uint32_t excludedEntry);
+        void trimEntry(TextureEntry& entry, uint32_t mip);
+        void bindTexture(TextureEntry& entry, const Texture::SharedPtr& pTexture, uint32_t residentMip);
+
+        std::vector<TextureEntry> mTextures;
+        std::unordered_map<const Texture*, uint32_t> mTextureIndex;                     ///< Currently bound texture to entry index
+        std::unordered_map<const Material*, std::vector<uint32_t>> mMaterialTextures;   ///< Material to entry indices
+
+        uint64_t mBudget;
+        uint64_t mResidentBytes = 0;
+        uint64_t mPendingBytes = 0;
+        uint64_t mFrameIndex = 1;
+        int32_t mMipBias = 0;
+        uint32_t mMaxPendingLoads = 16;
+        uint32_t mPendingLoadCount = 0;
+        Stats mStats;
+        AsyncCopyQueue::SharedPtr mpCopyQueue;
+    };
+}
@@ -0,0 +1,448 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "GeometryArena.h"
+#include <algorithm>
+#include "API/Buffer.h"
+#include "API/Device.h"
+#include "API/RenderContext.h"
+#include "API/VertexLayout.h"
+
+namespace Falcor
+{
+    static const uint32_t kIndexSize = sizeof(uint32_t);
+
+    static uint32_t getStride(const VertexLayout* pLayout, uint32_t bufferIndex)
+    {
+        const auto& pBufferLayout = pLayout->getBufferLayout(bufferIndex);
+        return pBufferLayout ? pBufferLayout->getStride() : 0;
+    }
+
+    void GeometryArena::RangeAllocator::reset(uint32_t capacity)
+    {
+        mFreeRanges.clear();
+        mCapacity = 0;
+        grow(capacity);
+    }
+
+    void GeometryArena::RangeAllocator::grow(uint32_t capacity)
+    {
+        assert(capacity >= mCapacity);
+        if(capacity > mCapacity)
+        {
+            release(mCapacity, capacity - mCapacity);
+            mCapacity = capacity;
+        }
+    }
+
+    bool GeometryArena::RangeAllocator::allocate(uint32_t count, uint32_t& offset)
+    {
+        for(auto it = mFreeRanges.begin(); it != mFreeRanges.end(); it++)
+        {
+            if(it->second >= count)
+            {
+                offset = it->first;
+                uint32_t remaining = it->second - count;
+                mFreeRanges.erase(it);
+                if(remaining)
+                {
+                    mFreeRanges[offset + count] = remaining;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void GeometryArena::RangeAllocator::release(uint32_t offset, uint32_t count)
+    {
+        if(count == 0)
+        {
+            return;
+        }
+
+        // Merge with the following range
+        auto next = mFreeRanges.find(offset + count);
+        if(next != mFreeRanges.end())
+        {
+            count += next->second;
+            mFreeRanges.erase(next);
+        }
+
+        // Merge with the preceding range
+        auto it = mFreeRanges.lower_bound(offset);
+        if(it != mFreeRanges.begin())
+        {
+            auto prev = std::prev(it);
+            if(prev->first + prev->second == offset)
+            {
+                prev->second += count;
+                return;
+            }
+        }
+        mFreeRanges[offset] = count;
+    }
+
+    void GeometryArena::RangeAllocator::defragment(std::vector<Move>& moves)
+    {
+        moves.clear();
+
+        // The allocated runs are the gaps between the free ranges, and the range's end closes the last one
+        uint32_t runStart = 0;
+        uint32_t packedCount = 0;
+        auto it = mFreeRanges.begin();
+        while(runStart < mCapacity)
+        {
+            uint32_t runEnd = (it == mFreeRanges.end()) ? mCapacity : it->first;
+            if(runEnd > runStart)
+            {
+                Move move;
+                move.srcOffset = runStart;
+                move.dstOffset = packedCount;
+                move.count = runEnd - runStart;
+                moves.push_back(move);
+                packedCount += move.count;
+            }
+
+            if(it == mFreeRanges.end())
+            {
+                break;
+            }
+            runStart = it->first + it->second;
+            it++;
+        }
+
+        mFreeRanges.clear();
+        if(packedCount < mCapacity)
+        {
+            mFreeRanges[packedCount] = mCapacity - packedCount;
+        }
+    }
+
+    uint32_t GeometryArena::RangeAllocator::remapOffset(const std::vector<Move>& moves, uint32_t offset)
+    {
+        // Find the last run which starts at or before the offset. Empty allocations can sit in a free range, and go to the end of the preceding run.
+        auto it = std::upper_bound(moves.begin(), moves.end(), offset, [](uint32_t value, const Move& move) { return value < move.srcOffset; });
+        if(it == moves.begin())
+        {
+            return 0;
+        }
+        const Move& move = *std::prev(it);
+        return move.dstOffset + std::min(offset - move.srcOffset, move.count);
+    }
+
+    GeometryArena::Allocation::~Allocation()
+    {
+        releaseAllocation(this);
+    }
+
+    const Vao::SharedPtr& GeometryArena::Allocation::getVao() const
+    {
+        return mpPool->pVao;
+    }
+
+    void GeometryArena::releaseAllocation(Allocation* pAllocation)
+    {
+        Pool* pPool = pAllocation->mpPool.get();
+        pPool->vertices.release(pAllocation->mBaseVertex, pAllocation->mVertexCount);
+        pPool->indices.release(pAllocation->mFirstIndex, pAllocation->mIndexCount);
+        pPool->allocations.erase(pAllocation);
+    }
+
+    GeometryArena::GeometryArena(uint32_t initialVertexCount, uint32_t initialIndexCount) : mInitialVertexCount(initialVertexCount), mInitialIndexCount(initialIndexCount)
+    {
+    }
+
+    GeometryArena::SharedPtr GeometryArena::create(uint32_t initialVertexCount, uint32_t initialIndexCount)
+    {
+        return SharedPtr(new GeometryArena(initialVertexCount, initialIndexCount));
+    }
+
+    const GeometryArena::SharedPtr& GeometryArena::getGlobalArena()
+    {
+        // The arena doesn't own the pools, so this doesn't keep GPU resources alive after the device is destroyed
+        static SharedPtr spArena = create();
+        return spArena;
+    }
+
+    void GeometryArena::createPoolBuffers(Pool* pPool, uint32_t vertexCapacity, uint32_t indexCapacity)
+    {
+        for(uint32_t i = 0; i < (uint32_t)pPool->vertexBuffers.size(); i++)
+        {
+            uint32_t stride = getStride(pPool->pLayout.get(), i);
+            pPool->vertexBuffers[i] = stride ? Buffer::create((size_t)stride * vertexCapacity, Resource::BindFlags::Vertex, Buffer::CpuAccess::None, nullptr) : nullptr;
+        }
+        pPool->pIndexBuffer = Buffer::create((size_t)kIndexSize * indexCapacity, Resource::BindFlags::Index, Buffer::CpuAccess::None, nullptr);
+        pPool->pVao = Vao::create(pPool->vertexBuffers, pPool->pLayout, pPool->pIndexBuffer, ResourceFormat::R32Uint, pPool->topology);
+    }
+
+    std::shared_ptr<GeometryArena::Pool> GeometryArena::createPool(const Vao* pVao, std::vector<uint32_t>&& signature, uint32_t vertexCapacity, uint32_t indexCapacity)
+    {
+        auto pPool = std::make_shared<Pool>();
+        pPool->signature = std::move(signature);
+        pPool->topology = pVao->getPrimitiveTopology();
+
+        // The mesh's layout is const, so the pool gets its own
+        const VertexLayout* pMeshLayout = pVao->getVertexLayout().get();
+        pPool->pLayout = VertexLayout::create();
+        for(uint32_t i = 0; i < (uint32_t)pMeshLayout->getBufferCount(); i++)
+        {
+            pPool->pLayout->addBufferLayout(i, pMeshLayout->getBufferLayout(i));
+        }
+        pPool->vertexBuffers.resize(pMeshLayout->getBufferCount());
+
+        createPoolBuffers(pPool.get(), vertexCapacity, indexCapacity);
+        pPool->vertices.reset(vertexCapacity);
+        pPool->indices.reset(indexCapacity);
+        mpPools.push_back(pPool);
+        return pPool;
+    }
+
+    void GeometryArena::growPool(Pool* pPool, uint32_t vertexCapacity, uint32_t indexCapacity)
+    {
+        Vao::BufferVec oldVertexBuffers = pPool->vertexBuffers;
+        Buffer::SharedPtr pOldIndexBuffer = pPool->pIndexBuffer;
+        createPoolBuffers(pPool, vertexCapacity, indexCapacity);
+
+        // Ranges keep their location, so the old contents are copied as a whole
+        RenderContext* pContext = gpDevice->getRenderContext().get();
+        for(uint32_t i = 0; i < (uint32_t)oldVertexBuffers.size(); i++)
+        {
+            if(oldVertexBuffers[i])
+            {
+                pContext->copyBufferRegion(pPool->vertexBuffers[i].get(), 0, oldVertexBuffers[i].get(), 0, oldVertexBuffers[i]->getSize());
+                pContext->resourceBarrier(pPool->vertexBuffers[i].get(), Resource::State::VertexBuffer);
+            }
+        }
+        pContext->copyBufferRegion(pPool->pIndexBuffer.get(), 0, pOldIndexBuffer.get(), 0, pOldIndexBuffer->getSize());
+        pContext->resourceBarrier(pPool->pIndexBuffer.get(), Resource::State::IndexBuffer);
+
+        pPool->vertices.grow(vertexCapacity);
+        pPool->indices.grow(indexCapacity);
+    }
+
+    GeometryArena::Allocation::SharedPtr GeometryArena::allocate(const Vao* pVao, uint32_t vertexCount, uint32_t indexCount)
+    {
+        const Buffer* pIndexBuffer = pVao->getIndexBuffer().get();
+        if((pIndexBuffer == nullptr) || (pVao->getIndexBufferFormat() != ResourceFormat::R32Uint))
+        {
+            logWarning("GeometryArena::allocate() - the arena only supports 32-bit indices");
+            return nullptr;
+        }
+
+        // Pools are matched by the layout's value, since every mesh has its own layout object
+        const VertexLayout* pLayout = pVao->getVertexLayout().get();
+        std::vector<uint32_t> signature;
+        signature.push_back((uint32_t)pVao->getPrimitiveTopology());
+        for(uint32_t i = 0; i < (uint32_t)pLayout->getBufferCount(); i++)
+        {
+            const auto& pBufferLayout = pLayout->getBufferLayout(i);
+            if(pBufferLayout == nullptr)
+            {
+                signature.push_back(uint32_t(-1));
+                continue;
+            }
+
+            const Buffer* pVB = (i < pVao->getVertexBuffersCount()) ? pVao->getVertexBuffer(i).get() : nullptr;
+            if(pBufferLayout->getInputClass() != VertexBufferLayout::InputClass::PerVertexData || (pVB == nullptr) || (pVB->getSize() < (size_t)pBufferLayout->getStride() * vertexCount))
+            {
+                logWarning("GeometryArena::allocate() - the arena only supports per-vertex streams which hold every vertex of the mesh");
+                return nullptr;
+            }
+
+            signature.push_back(pBufferLayout->getStride());
+            for(uint32_t e = 0; e < pBufferLayout->getElementCount(); e++)
+            {
+                signature.push_back(pBufferLayout->getElementOffset(e));
+                signature.push_back((uint32_t)pBufferLayout->getElementFormat(e));
+                signature.push_back(pBufferLayout->getElementArraySize(e));
+                signature.push_back(pBufferLayout->getElementShaderLocation(e));
+            }
+        }
+
+        std::shared_ptr<Pool> pPool;
+        for(auto it = mpPools.begin(); it != mpPools.end();)
+        {
+            auto pLive = it->lock();
+            if(pLive == nullptr)
+            {
+                it = mpPools.erase(it);
+                continue;
+            }
+            if(pLive->signature == signature)
+            {
+                pPool = pLive;
+            }
+            it++;
+        }
+
+        if(pPool == nullptr)
+        {
+            pPool = createPool(pVao, std::move(signature), std::max(mInitialVertexCount, vertexCount), std::max(mInitialIndexCount, indexCount));
+        }
+
+        Allocation::SharedPtr pAllocation = Allocation::SharedPtr(new Allocation);
+        bool hasVertices = pPool->vertices.allocate(vertexCount, pAllocation->mBaseVertex);
+        bool hasIndices = pPool->indices.allocate(indexCount, pAllocation->mFirstIndex);
+        if((hasVertices == false) || (hasIndices == false))
+        {
+            // Return what we got, grow the pool and try again
+            if(hasVertices)
+            {
+                pPool->vertices.release(pAllocation->mBaseVertex, vertexCount);
+            }
+            if(hasIndices)
+            {
+                pPool->indices.release(pAllocation->mFirstIndex, indexCount);
+            }
+
+            uint32_t vertexCapacity = pPool->vertices.getCapacity();
+            uint32_t indexCapacity = pPool->indices.getCapacity();
+            growPool(pPool.get(), hasVertices ? vertexCapacity : std::max(vertexCapacity * 2, vertexCapacity + vertexCount), hasIndices ? indexCapacity : std::max(indexCapacity * 2, indexCapacity + indexCount));
+
+            hasVertices = pPool->vertices.allocate(vertexCount, pAllocation->mBaseVertex);
+            hasIndices = pPool->indices.allocate(indexCount, pAllocation->mFirstIndex);
+            assert(hasVertices && hasIndices);
+        }
+
+        pAllocation->mpPool = pPool;
+        pAllocation->mVertexCount = vertexCount;
+        pAllocation->mIndexCount = indexCount;
+        pPool->allocations.insert(pAllocation.get());
+
+        // Copy the mesh's data into the pool
+        RenderContext* pContext = gpDevice->getRenderContext().get();
+        for(uint32_t i = 0; i < (uint32_t)pPool->vertexBuffers.size(); i++)
+        {
+            uint32_t stride = getStride(pPool->pLayout.get(), i);
+            if(stride)
+            {
+                pContext->copyBufferRegion(pPool->vertexBuffers[i].get(), (uint64_t)stride * pAllocation->mBaseVertex, pVao->getVertexBuffer(i).get(), 0, (uint64_t)stride * vertexCount);
+                pContext->resourceBarrier(pPool->vertexBuffers[i].get(), Resource::State::VertexBuffer);
+            }
+        }
+        pContext->copyBufferRegion(pPool->pIndexBuffer.get(), (uint64_t)kIndexSize * pAllocation->mFirstIndex, pIndexBuffer, 0, (uint64_t)kIndexSize * indexCount);
+        pContext->resourceBarrier(pPool->pIndexBuffer.get(), Resource::State::IndexBuffer);
+
+        return pAllocation;
+    }
+
+    void GeometryArena::defragment()
+    {
+        for(const auto& pWeakPool : mpPools)
+        {
+            auto pPool = pWeakPool.lock();
+            if((pPool == nullptr) || ((pPool->vertices.getFreeRangeCount() <= 1) && (pPool->indices.getFreeRangeCount() <= 1)))
+            {
+                continue;
+            }
+
+            RenderContext* pContext = gpDevice->getRenderContext().get();
+
+            // Keep the capacity, so that the next allocations don't have to grow the pool again
+            Vao::BufferVec oldVertexBuffers = pPool->vertexBuffers;
+            Buffer::SharedPtr pOldIndexBuffer = pPool->pIndexBuffer;
+            const uint32_t vertexCapacity = pPool->vertices.getCapacity();
+            const uint32_t indexCapacity = pPool->indices.getCapacity();
+            createPoolBuffers(pPool.get(), vertexCapacity, indexCapacity);
+
+            // Vertices and indices are packed separately, in the order of their old locations. Adjacent allocations move together, so there's one copy per run.
+            std::vector<RangeAllocator::Move> vertexMoves;
+            std::vector<RangeAllocator::Move> indexMoves;
+            pPool->vertices.defragment(vertexMoves);
+            pPool->indices.defragment(indexMoves);
+
+            for(const auto& move : vertexMoves)
+            {
+                for(uint32_t i = 0; i < (uint32_t)oldVertexBuffers.size(); i++)
+                {
+                    uint32_t stride = getStride(pPool->pLayout.get(), i);
+                    if(stride)
+                    {
+                        pContext->copyBufferRegion(pPool->vertexBuffers[i].get(), (uint64_t)stride * move.dstOffset, oldVertexBuffers[i].get(), (uint64_t)stride * move.srcOffset, (uint64_t)stride * move.count);
+                    }
+                }
+            }
+
+            for(const auto& move : indexMoves)
+            {
+                pContext->copyBufferRegion(pPool->pIndexBuffer.get(), (uint64_t)kIndexSize * move.dstOffset, pOldIndexBuffer.get(), (uint64_t)kIndexSize * move.srcOffset, (uint64_t)kIndexSize * move.count);
+            }
+
+            for(Allocation* pAllocation : pPool->allocations)
+            {
+                pAllocation->mBaseVertex = RangeAllocator::remapOffset(vertexMoves, pAllocation->mBaseVertex);
+                pAllocation->mFirstIndex = RangeAllocator::remapOffset(indexMoves, pAllocation->mFirstIndex);
+            }
+
+            for(const auto& pVB : pPool->vertexBuffers)
+            {
+                if(pVB)
+                {
+                    pContext->resourceBarrier(pVB.get(), Resource::State::VertexBuffer);
+                }
+            }
+            pContext->resourceBarrier(pPool->pIndexBuffer.get(), Resource::State::IndexBuffer);
+        }
+    }
+
+    GeometryArena::Stats GeometryArena::getStats() const
+    {
+        Stats stats;
+        for(const auto& pWeakPool : mpPools)
+        {
+            auto pPool = pWeakPool.lock();
+            if(pPool == nullptr)
+            {
+                continue;
+            }
+
+            uint64_t vertexSize = 0;
+            for(uint32_t i = 0; i < (uint32_t)pPool->vertexBuffers.size(); i++)
+            {
+                vertexSize += getStride(pPool->pLayout.get(), i);
+            }
+
+            stats.poolCount++;
+            stats.allocationCount += (uint32_t)pPool->allocations.size();
+            stats.allocatedBytes += vertexSize * pPool->vertices.getCapacity() + kIndexSize * pPool->indices.getCapacity();
+            for(const Allocation* pAllocation : pPool->allocations)
+            {
+                stats.usedBytes += vertexSize * pAllocation->mVertexCount + kIndexSize * pAllocation->mIndexCount;
+            }
+            stats.freeRangeCount += pPool->vertices.getFreeRangeCount() + pPool->indices.getFreeRangeCount();
+        }
+        return stats;
+    }
+
+    std::string GeometryArena::getStatsString() const
+    {
+        Stats stats = getStats();
+        return std::to_string(stats.allocationCount) + " meshes in " + std::to_string(stats.poolCount) + " pools, " + std::to_string(stats.usedBytes / 1024) + " of " + std::to_string(stats.allocatedBytes / 1024) + " KB used, " + std::to_string(stats.freeRangeCount) + " free ranges";
+    }
+}
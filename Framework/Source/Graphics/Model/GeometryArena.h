@@ -0,0 +1,202 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+#include "API/VAO.h"
+
+namespace Falcor
+{
+    /** Sub-allocates the vertex and index data of many meshes from a few large buffers.
+        Meshes with the same vertex layout and topology share a pool with one buffer per vertex stream, one 32-bit index buffer and one VAO. A mesh's range in the pool is described by its base vertex and first index, which are passed to the draw call, so the renderer doesn't need to rebind the VAO between meshes of the same pool.
+        Free ranges are tracked with a free-list, so releasing a mesh makes its range available to the next allocation. A pool grows by reallocating its buffers when it runs out of space, and defragment() packs the live ranges to the start of the buffers.
+        Pools are owned by their allocations, and are released together with the last mesh using them.
+    */
+    class GeometryArena : public std::enable_shared_from_this<GeometryArena>
+    {
+    public:
+        using SharedPtr = std::shared_ptr<GeometryArena>;
+
+        /** Arena statistics
+        */
+        struct Stats
+        {
+            uint32_t poolCount = 0;         ///< Live pools
+            uint32_t allocationCount = 0;   ///< Live allocations
+            uint64_t allocatedBytes = 0;    ///< Size of the pools' buffers
+            uint64_t usedBytes = 0;         ///< Bytes used by live allocations
+            uint32_t freeRangeCount = 0;    ///< Number of free vertex and index ranges. A large number means the pools are fragmented.
+        };
+
+        /** First-fit free-list over a range of elements. Adjacent free ranges are merged when released.
+            The arena uses one for the vertices and one for the indices of each pool.
+        */
+        class RangeAllocator
+        {
+        public:
+            /** Describes how defragment() moved a run of allocated elements
+            */
+            struct Move
+            {
+                uint32_t srcOffset;
+                uint32_t dstOffset;
+                uint32_t count;
+            };
+
+            /** Release everything and set the capacity
+            */
+            void reset(uint32_t capacity);
+
+            /** Increase the capacity. The new elements are added to the free-list.
+            */
+            void grow(uint32_t capacity);
+
+            /** Allocate a range from the first free range that is large enough
+                eturn false if there's no such range
+            */
+            bool allocate(uint32_t count, uint32_t& offset);
+
+            /** Return a range to the free-list, merging it with the adjacent free ranges
+            */
+            void release(uint32_t offset, uint32_t count);
+
+            /** Pack the allocated elements to the start of the range, keeping their order, so that a single free range is left at the end.
+                \param[out] moves The runs of allocated elements which were moved, in order. Pass them to remapOffset() to get the new offset of an allocation.
+            */
+            void defragment(std::vector<Move>& moves);
+
+            /** Get the offset of an allocation after defragment()
+                \param[in] moves The moves returned by defragment()
+                \param[in] offset The allocation's offset before defragment()
+            */
+            static uint32_t remapOffset(const std::vector<Move>& moves, uint32_t offset);
+
+            uint32_t getCapacity() const { return mCapacity; }
+            uint32_t getFreeRangeCount() const { return (uint32_t)mFreeRanges.size(); }
+        private:
+            std::map<uint32_t, uint32_t> mFreeRanges;   ///< Offset -> count
+            uint32_t mCapacity = 0;
+        };
+
+    private:
+        struct Pool;
+
+    public:
+        /** A mesh's range in the arena. Releasing the last reference returns the range to the free-list.
+        */
+        class Allocation
+        {
+        public:
+            using SharedPtr = std::shared_ptr<Allocation>;
+            ~Allocation();
+
+            /** Get the VAO of the pool the allocation belongs to. The VAO is recreated when the pool grows or is defragmented.
+            */
+            const Vao::SharedPtr& getVao() const;
+
+            /** Get the offset which should be added to the mesh's indices
+            */
+            uint32_t getBaseVertex() const { return mBaseVertex; }
+
+            /** Get the location of the mesh's first index in the pool's index buffer
+            */
+            uint32_t getFirstIndex() const { return mFirstIndex; }
+
+            uint32_t getVertexCount() const { return mVertexCount; }
+            uint32_t getIndexCount() const { return mIndexCount; }
+
+        private:
+            friend GeometryArena;
+            Allocation() = default;
+            std::shared_ptr<Pool> mpPool;
+            uint32_t mBaseVertex = 0;
+            uint32_t mFirstIndex = 0;
+            uint32_t mVertexCount = 0;
+            uint32_t mIndexCount = 0;
+        };
+
+        /** Create a new arena
+            \param[in] initialVertexCount Number of vertices a new pool has room for
+            \param[in] initialIndexCount Number of indices a new pool has room for
+        */
+        static SharedPtr create(uint32_t initialVertexCount = 1 << 18, uint32_t initialIndexCount = 1 << 20);
+
+        /** Get the arena used by models loaded with Model::UseGeometryArena
+        */
+        static const SharedPtr& getGlobalArena();
+
+        /** Allocate a range and copy a mesh's geometry into it. The copy is recorded into the device's render context.
+            \param[in] pVao The mesh's VAO. Every vertex stream must be per-vertex data, and the index buffer must use 32-bit indices.
+            \param[in] vertexCount Number of vertices to copy from each vertex buffer
+            \param[in] indexCount Number of indices to copy from the index buffer
+            \return The allocation, or nullptr if the VAO can't be placed in the arena
+        */
+        Allocation::SharedPtr allocate(const Vao* pVao, uint32_t vertexCount, uint32_t indexCount);
+
+        /** Move the live ranges of every pool to the start of the buffers, so that each pool has a single free range. The copies are recorded into the device's render context.
+            Meshes pick up the new base vertex and first index on their next draw. Pools which aren't fragmented are skipped.
+            Scene::deleteModel() and Model::deleteCulledMeshes() call this on the global arena.
+        */
+        void defragment();
+
+        /** Get the arena statistics
+        */
+        Stats getStats() const;
+
+        /** Get a one-line summary of the statistics, for the log
+        */
+        std::string getStatsString() const;
+
+    private:
+        GeometryArena(uint32_t initialVertexCount, uint32_t initialIndexCount);
+
+        struct Pool
+        {
+            std::vector<uint32_t> signature;
+            VertexLayout::SharedPtr pLayout;
+            Vao::Topology topology;
+            Vao::BufferVec vertexBuffers;
+            Buffer::SharedPtr pIndexBuffer;
+            Vao::SharedPtr pVao;
+            RangeAllocator vertices;
+            RangeAllocator indices;
+            std::set<Allocation*> allocations;
+        };
+
+        std::shared_ptr<Pool> createPool(const Vao* pVao, std::vector<uint32_t>&& signature, uint32_t vertexCapacity, uint32_t indexCapacity);
+        static void createPoolBuffers(Pool* pPool, uint32_t vertexCapacity, uint32_t indexCapacity);
+        static void growPool(Pool* pPool, uint32_t vertexCapacity, uint32_t indexCapacity);
+        static void releaseAllocation(Allocation* pAllocation);
+
+        std::vector<std::weak_ptr<Pool>> mpPools;
+        uint32_t mInitialVertexCount;
+        uint32_t mInitialIndexCount;
+    };
+}
@@ -0,0 +1,184 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Graphics/Model/InstanceTransformStore.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/Math/FalcorMath.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+namespace Falcor
+{
+    const InstanceTransformStore::SharedPtr& InstanceTransformStore::instance()
+    {
+        static SharedPtr spStore = SharedPtr(new InstanceTransformStore(kMaxChunkCount));
+        return spStore;
+    }
+
+    InstanceTransformStore::SharedPtr InstanceTransformStore::create(uint32_t maxSlotCount)
+    {
+        uint32_t maxChunkCount = (maxSlotCount + kChunkSize - 1) / kChunkSize;
+        if (maxChunkCount == 0 || maxChunkCount > kMaxChunkCount)
+        {
+            logError("InstanceTransformStore::create() - the capacity must be between 1 and " + std::to_string(kMaxChunkCount * kChunkSize) + " slots");
+            return nullptr;
+        }
+        return SharedPtr(new InstanceTransformStore(maxChunkCount));
+    }
+
+    InstanceTransformStore::~InstanceTransformStore() = default;
+
+    glm::mat4 InstanceTransformStore::calculateTransformMatrix(const glm::vec3& translation, const glm::vec3& target, const glm::vec3& up, const glm::vec3& scale)
+    {
+        glm::mat4 translationMtx = glm::translate(glm::mat4(), translation);
+        glm::mat4 rotationMtx = createMatrixFromLookAt(translation, target, up);
+        glm::mat4 scalingMtx = glm::scale(glm::mat4(), scale);
+
+        return translationMtx * rotationMtx * scalingMtx;
+    }
+
+    void InstanceTransformStore::Chunk::updateSlot(uint32_t index)
+    {
+        const uint8_t slotFlags = flags[index];
+        if ((slotFlags & (BaseDirty | MovableDirty)) == 0)
+        {
+            return;
+        }
+
+        if (slotFlags & BaseDirty)
+        {
+            baseMatrix[index] = calculateTransformMatrix(baseTranslation[index], baseTarget[index], baseUp[index], baseScale[index]);
+        }
+        if (slotFlags & MovableDirty)
+        {
+            movableMatrix[index] = calculateTransformMatrix(movableTranslation[index], movableTarget[index], movableUp[index], movableScale[index]);
+        }
+
+        worldMatrix[index] = movableMatrix[index] * baseMatrix[index];
+        if (pLocalBounds[index])
+        {
+            worldBounds[index] = pLocalBounds[index]->transform(worldMatrix[index]);
+        }
+        flags[index] = (uint8_t)(slotFlags & ~(BaseDirty | MovableDirty));
+    }
+
+    uint32_t InstanceTransformStore::allocate(const BoundingBox* pLocalBounds)
+    {
+        uint32_t slot;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mFreeSlots.empty() == false)
+            {
+                slot = mFreeSlots.back();
+                mFreeSlots.pop_back();
+            }
+            else
+            {
+                if (mChunkCount == mMaxChunkCount)
+                {
+                    logError("InstanceTransformStore::allocate() - the store is full, can't create more than " + std::to_string(mMaxChunkCount * kChunkSize) + " instances");
+                    return kInvalidSlot;
+                }
+
+                // Slots of a new chunk are handed out from the back, so the first one is used first
+                mChunks[mChunkCount].reset(new Chunk());
+                for (uint32_t i = kChunkSize; i > 0; i--)
+                {
+                    mFreeSlots.push_back(mChunkCount * kChunkSize + i - 1);
+                }
+                mChunkCount++;
+                slot = mFreeSlots.back();
+                mFreeSlots.pop_back();
+            }
+            mSlotCount++;
+        }
+
+        Chunk* pChunk = getChunk(slot);
+        uint32_t i = getChunkIndex(slot);
+        pChunk->baseTranslation[i] = glm::vec3(0.0f);
+        pChunk->baseTarget[i] = glm::vec3(0.0f, 0.0f, 1.0f);
+        pChunk->baseUp[i] = glm::vec3(0.0f, 1.0f, 0.0f);
+        pChunk->baseScale[i] = glm::vec3(1.0f);
+        pChunk->movableTranslation[i] = pChunk->baseTranslation[i];
+        pChunk->movableTarget[i] = pChunk->baseTarget[i];
+        pChunk->movableUp[i] = pChunk->baseUp[i];
+        pChunk->movableScale[i] = pChunk->baseScale[i];
+        pChunk->pLocalBounds[i] = pLocalBounds;
+        pChunk->flags[i] = Allocated;
+        pChunk->markDirty(i, BaseDirty | MovableDirty);
+        return slot;
+    }
+
+    void InstanceTransformStore::release(uint32_t slot)
+    {
+        if (slot == kInvalidSlot)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        Chunk* pChunk = getChunk(slot);
+        pChunk->flags[getChunkIndex(slot)] = 0;
+        pChunk->pLocalBounds[getChunkIndex(slot)] = nullptr;
+        mFreeSlots.push_back(slot);
+        mSlotCount--;
+    }
+
+    uint32_t InstanceTransformStore::update()
+    {
+        uint32_t chunkCount;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            chunkCount = mChunkCount;
+        }
+
+        std::atomic<uint32_t> updatedCount(0);
+        ThreadPool::instance()->parallelFor(chunkCount, 0, [&](uint32_t begin, uint32_t end)
+        {
+            uint32_t count = 0;
+            for (uint32_t c = begin; c < end; c++)
+            {
+                Chunk* pChunk = mChunks[c].get();
+                if (pChunk->isDirty.exchange(false, std::memory_order_relaxed) == false)
+                {
+                    continue;
+                }
+
+                for (uint32_t i = 0; i < kChunkSize; i++)
+                {
+                    if (pChunk->flags[i] & (BaseDirty | MovableDirty))
+                    {
+                        pChunk->updateSlot(i);
+                        count++;
+                    }
+                }
+            }
+            updatedCount += count;
+        });
+        return updatedCount;
+    }
+}
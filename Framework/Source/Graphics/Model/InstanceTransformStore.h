@@ -0,0 +1,149 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include "glm/vec3.hpp"
+#include "glm/mat4x4.hpp"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    /** Storage for the transforms of all ObjectInstances.
+        Transforms live in structure-of-arrays chunks of kChunkSize instances. Chunks are never moved or freed, so references to the stored values remain valid for the lifetime of the instance.
+        An instance's base and movable transforms are set from translation/target/up/scale and marked dirty. update() recomputes the world matrices and world bounds of all the dirty instances in parallel. Instances changed after update() are recomputed lazily by their getters, like before.
+        update() must not run concurrently with changes to the instances.
+    */
+    class InstanceTransformStore
+    {
+    public:
+        using SharedPtr = std::shared_ptr<InstanceTransformStore>;
+        using SharedConstPtr = std::shared_ptr<const InstanceTransformStore>;
+
+        static const uint32_t kChunkSize = 256;
+        static const uint32_t kInvalidSlot = (uint32_t)-1;
+
+        /** Slot flags
+        */
+        enum : uint8_t
+        {
+            Allocated = 1,
+            BaseDirty = 2,              ///< The base matrix needs to be recomputed from the base translation/target/up/scale
+            MovableDirty = 4,           ///< The movable matrix needs to be recomputed
+        };
+
+        /** A transform chunk
+        */
+        struct Chunk
+        {
+            glm::vec3 baseTranslation[kChunkSize];
+            glm::vec3 baseTarget[kChunkSize];
+            glm::vec3 baseUp[kChunkSize];
+            glm::vec3 baseScale[kChunkSize];
+            glm::vec3 movableTranslation[kChunkSize];
+            glm::vec3 movableTarget[kChunkSize];
+            glm::vec3 movableUp[kChunkSize];
+            glm::vec3 movableScale[kChunkSize];
+            glm::mat4 baseMatrix[kChunkSize];
+            glm::mat4 movableMatrix[kChunkSize];
+            glm::mat4 worldMatrix[kChunkSize];              ///< movableMatrix * baseMatrix
+            BoundingBox worldBounds[kChunkSize];            ///< The local bounds transformed by the world matrix
+            const BoundingBox* pLocalBounds[kChunkSize];    ///< The bounds of the instanced object, nullptr if the instance doesn't have an object
+            uint8_t flags[kChunkSize];
+            std::atomic<bool> isDirty;                      ///< Set if any slot might be dirty
+
+            /** Mark a slot dirty. Different slots can be marked from different threads.
+            */
+            void markDirty(uint32_t index, uint8_t dirtyFlags)
+            {
+                flags[index] |= dirtyFlags;
+                isDirty.store(true, std::memory_order_relaxed);
+            }
+
+            /** Recompute the dirty matrices and the world bounds of a slot
+            */
+            void updateSlot(uint32_t index);
+        };
+
+        /** Get the global store, which is used by all ObjectInstances
+        */
+        static const SharedPtr& instance();
+
+        /** Create a store which is separate from the global one
+            \param[in] maxSlotCount The capacity of the store. It is rounded up to a multiple of kChunkSize, and can't be larger than the capacity of the global store.
+        */
+        static SharedPtr create(uint32_t maxSlotCount);
+
+        ~InstanceTransformStore();
+
+        /** Allocate a slot. The transforms are reset to the identity and marked dirty. Thread-safe.
+            \param[in] pLocalBounds The bounds of the instanced object. The caller must keep the bounds alive while the slot is allocated.
+            \return The slot, or kInvalidSlot if the store is full
+        */
+        uint32_t allocate(const BoundingBox* pLocalBounds);
+
+        /** Release a slot. Thread-safe.
+        */
+        void release(uint32_t slot);
+
+        /** Get the chunk which holds a slot
+        */
+        Chunk* getChunk(uint32_t slot) const { return mChunks[slot / kChunkSize].get(); }
+
+        /** Get the index of a slot inside its chunk
+        */
+        static uint32_t getChunkIndex(uint32_t slot) { return slot % kChunkSize; }
+
+        /** Recompute the world matrices and bounds of all the dirty slots on the global thread pool
+            \return The number of slots which were recomputed
+        */
+        uint32_t update();
+
+        /** Get the number of allocated slots
+        */
+        uint32_t getSlotCount() const { return mSlotCount; }
+
+        /** Calculate a transform matrix from translation, look-at target, up vector and scale
+        */
+        static glm::mat4 calculateTransformMatrix(const glm::vec3& translation, const glm::vec3& target, const glm::vec3& up, const glm::vec3& scale);
+
+    private:
+        InstanceTransformStore(uint32_t maxChunkCount) : mMaxChunkCount(maxChunkCount) {}
+
+        static const uint32_t kMaxChunkCount = 16384;
+
+        std::unique_ptr<Chunk> mChunks[kMaxChunkCount];
+        uint32_t mChunkCount = 0;
+        uint32_t mMaxChunkCount;
+        std::vector<uint32_t> mFreeSlots;
+        uint32_t mSlotCount = 0;
+        std::mutex mMutex;
+    };
+}
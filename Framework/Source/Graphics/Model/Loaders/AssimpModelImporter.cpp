@@ -44,6 +44,10 @@
 #include "API/VertexLayout.h"
 #include "Data/VertexAttrib.h"
 #include "Utils/StringUtils.h"
+#include "Utils/ThreadPool.h"
+#include "../MeshOptimizer.h"
+#include "Utils/CpuTimer.h"
+#include "../VertexCompression.h"
 
 namespace Falcor
 {
@@ -76,6 +80,24 @@ namespace Falcor
         return indices;
     }
 
+    /** Get the mesh LODs of a chain whose indices follow the mesh's own indexCount indices in the index buffer
+    */
+    std::vector<Mesh::Lod> createMeshLods(uint32_t indexCount, const MeshSimplifier::LodChain& chain)
+    {
+        std::vector<Mesh::Lod> lods;
+        uint32_t firstIndex = indexCount;
+        for(size_t i = 0; i < chain.indexCounts.size(); i++)
+        {
+            Mesh::Lod lod;
+            lod.firstIndex = firstIndex;
+            lod.indexCount = chain.indexCounts[i];
+            lod.error = chain.errors[i];
+            lods.push_back(lod);
+            firstIndex += lod.indexCount;
+        }
+        return lods;
+    }
+
     void genTangentSpace(const aiMesh* pAiMesh)
     {
         if(pAiMesh->mFaces[0].mNumIndices == 3)
@@ -209,9 +231,17 @@ namespace Falcor
                 }
                 else
                 {
-                    // create a new texture
-                    std::string fullpath = folder + '\\' + s;
-                    pTex = createTextureFromFile(fullpath, true, isSrgbRequired(aiType, useSrgb));
+                    // Pick up the texture from the prefetched loads, or create it now
+                    const auto& load = mTextureLoads.find(s);
+                    if(load != mTextureLoads.end())
+                    {
+                        pTex = waitForTexture(load->second);
+                    }
+                    else
+                    {
+                        std::string fullpath = folder + '\\' + s;
+                        pTex = createTextureFromFile(fullpath, true, isSrgbRequired(aiType, useSrgb));
+                    }
                     if(pTex)
                     {
                         mTextureCache[s] = pTex;
@@ -311,6 +341,106 @@ namespace Falcor
         return pMaterial;
     }
 
+    template<typename T>
+    void remapAiArray(T* pArray, uint32_t count, const std::vector<uint32_t>& remap)
+    {
+        if(pArray)
+        {
+            MeshOptimizer::remapVertices(pArray, sizeof(T), count, remap);
+        }
+    }
+
+    void optimizeAiMesh(aiMesh* pAiMesh, MeshOptimizer::Stats& stats)
+    {
+        // Only pure triangle meshes. Morph targets share the vertex order with the mesh, so leave those alone.
+        if(pAiMesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE || pAiMesh->mNumAnimMeshes > 0)
+        {
+            return;
+        }
+
+        std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
+        const uint32_t vertexCount = pAiMesh->mNumVertices;
+        MeshOptimizer::optimizeTriangleList(indices.data(), (uint32_t)indices.size(), pAiMesh->mVertices, sizeof(aiVector3D), vertexCount, stats);
+
+        std::vector<uint32_t> remap;
+        MeshOptimizer::optimizeVertexFetch(indices.data(), (uint32_t)indices.size(), vertexCount, remap);
+        for(uint32_t i = 0; i < pAiMesh->mNumFaces; i++)
+        {
+            memcpy(pAiMesh->mFaces[i].mIndices, &indices[i * 3], sizeof(uint32_t) * 3);
+        }
+
+        remapAiArray(pAiMesh->mVertices, vertexCount, remap);
+        remapAiArray(pAiMesh->mNormals, vertexCount, remap);
+        remapAiArray(pAiMesh->mTangents, vertexCount, remap);
+        remapAiArray(pAiMesh->mBitangents, vertexCount, remap);
+        for(uint32_t i = 0; i < AI_MAX_NUMBER_OF_COLOR_SETS; i++)
+        {
+            remapAiArray(pAiMesh->mColors[i], vertexCount, remap);
+        }
+        for(uint32_t i = 0; i < AI_MAX_NUMBER_OF_TEXTURECOORDS; i++)
+        {
+            remapAiArray(pAiMesh->mTextureCoords[i], vertexCount, remap);
+        }
+        for(uint32_t i = 0; i < pAiMesh->mNumBones; i++)
+        {
+            const aiBone* pBone = pAiMesh->mBones[i];
+            for(uint32_t w = 0; w < pBone->mNumWeights; w++)
+            {
+                pBone->mWeights[w].mVertexId = remap[pBone->mWeights[w].mVertexId];
+            }
+        }
+    }
+
+    /** Optimize the meshes of the scene in place, in parallel
+    */
+    void optimizeMeshes(const aiScene* pScene, const std::string& filename)
+    {
+        std::vector<MeshOptimizer::Stats> meshStats(pScene->mNumMeshes);
+        ThreadPool::instance()->parallelFor(pScene->mNumMeshes, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for(uint32_t i = begin; i < end; i++)
+            {
+                optimizeAiMesh(pScene->mMeshes[i], meshStats[i]);
+            }
+        });
+
+        MeshOptimizer::Stats stats;
+        for(const auto& s : meshStats)
+        {
+            stats += s;
+        }
+        logInfo("Optimized meshes of " + filename + ": " + std::to_string(stats.triangleCount) + " triangles, ACMR " + std::to_string(stats.getAcmrBefore()) + " -> " + std::to_string(stats.getAcmrAfter()));
+    }
+
+    /** Generate the LOD chains of the scene's triangle meshes, in parallel
+    */
+    void generateLods(const aiScene* pScene, const std::string& filename, std::vector<MeshSimplifier::LodChain>& lodChains)
+    {
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        lodChains.resize(pScene->mNumMeshes);
+        ThreadPool::instance()->parallelFor(pScene->mNumMeshes, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for(uint32_t i = begin; i < end; i++)
+            {
+                // Morph targets would need their own LODs, so leave those alone
+                const aiMesh* pAiMesh = pScene->mMeshes[i];
+                if(pAiMesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE && pAiMesh->mNumAnimMeshes == 0)
+                {
+                    std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
+                    MeshSimplifier::generateLodChain(indices.data(), (uint32_t)indices.size(), pAiMesh->mVertices, sizeof(aiVector3D), pAiMesh->mNumVertices, lodChains[i]);
+                }
+            }
+        });
+
+        uint32_t lodCount = 0;
+        for(const auto& chain : lodChains)
+        {
+            lodCount += (uint32_t)chain.indexCounts.size();
+        }
+        float duration = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        logInfo("Generated LODs of " + filename + ": " + std::to_string(lodCount) + " LODs for " + std::to_string(pScene->mNumMeshes) + " meshes in " + std::to_string(duration) + " ms");
+    }
+
     bool verifyScene(const aiScene* pScene)
     {
         bool b = true;
@@ -329,6 +459,43 @@ namespace Falcor
         mpModel = Model::create();
     }
 
+    struct AssimpModelImporter::ParsedFile
+    {
+        Assimp::Importer importer;                                      ///< Owns the scene
+        const aiScene* pScene = nullptr;
+        std::string fullpath;
+        std::map<const std::string, TextureLoadHandle> textureLoads;    ///< Loads started by prefetchTextures()
+        std::vector<MeshSimplifier::LodChain> lodChains;                ///< Generated by generateLods()
+    };
+
+    void prefetchTextures(const aiScene* pScene, const std::string& folder, bool useSrgb, std::map<const std::string, TextureLoadHandle>& textureLoads)
+    {
+        // Start loading every texture of the model, so that the file I/O and decoding overlap instead of running one texture at a time
+        for(uint32_t i = 0; i < pScene->mNumMaterials; i++)
+        {
+            const aiMaterial* pAiMaterial = pScene->mMaterials[i];
+            for(int t = 0; t < AI_TEXTURE_TYPE_MAX; ++t)
+            {
+                aiTextureType aiType = (aiTextureType)t;
+                if(pAiMaterial->GetTextureCount(aiType) != 1)
+                {
+                    continue;
+                }
+
+                aiString path;
+                pAiMaterial->GetTexture(aiType, 0, &path);
+                std::string s(path.data);
+                if(s.empty() || textureLoads.find(s) != textureLoads.end())
+                {
+                    continue;
+                }
+
+                std::string fullpath = folder + '\\' + s;
+                textureLoads[s] = createTextureFromFileAsync(fullpath, true, isSrgbRequired(aiType, useSrgb));
+            }
+        }
+    }
+
     bool AssimpModelImporter::createAllMaterials(const aiScene* pScene, const std::string& modelFolder, bool isObjFile, bool useSrgb)
     {
         for(uint32_t i = 0; i < pScene->mNumMaterials; i++)
@@ -349,6 +516,13 @@ namespace Falcor
             mAiMaterialToFalcor[i] = pMaterial;
         }
 
+        // Don't leave loads behind if a material bailed out early
+        for(const auto& load : mTextureLoads)
+        {
+            waitForTexture(load.second);
+        }
+        mTextureLoads.clear();
+
         return true;
     }
 
@@ -374,7 +548,7 @@ namespace Falcor
                 if(aiToFalcorMesh.find(aiId) == aiToFalcorMesh.end())
                 {
                     // Cache mesh
-                    aiToFalcorMesh[aiId] = createMesh(pScene->mMeshes[aiId]);
+                    aiToFalcorMesh[aiId] = createMesh(pScene->mMeshes[aiId], mLodChains.empty() ? nullptr : &mLodChains[aiId]);
                 }
 
                 mpModel->addMeshInstance(aiToFalcorMesh[aiId], aiMatToGLM(transform));
@@ -398,9 +572,10 @@ namespace Falcor
         return parseAiSceneNode(pRoot, pScene, aiToFalcorMeshId);
     }
 
-    bool AssimpModelImporter::initModel(const std::string& filename)
+    std::shared_ptr<AssimpModelImporter::ParsedFile> AssimpModelImporter::parseFile(const std::string& filename, uint32_t flags)
     {
-        std::string fullpath;
+        auto pParsed = std::make_shared<ParsedFile>();
+        std::string& fullpath = pParsed->fullpath;
         if(findFileInDataDirectories(filename, fullpath) == false)
         {
             logError(std::string("Can't find model file ") + filename, true);
@@ -414,32 +589,59 @@ namespace Falcor
             0;
 
         // aiProcessPreset_TargetRealtime_MaxQuality enabled some optimizations the user might not want
-        if((mFlags & Model::FindDegeneratePrimitives) == 0)
+        if((flags & Model::FindDegeneratePrimitives) == 0)
         {
             AssimpFlags &= ~aiProcess_FindDegenerates;
         }
         // Avoid merging original meshes
-        if((mFlags & Model::DontMergeMeshes) != 0)
+        if((flags & Model::DontMergeMeshes) != 0)
         {
             AssimpFlags &= ~aiProcess_OptimizeGraph;
         }
         // Never use Assimp's tangent gen code
         AssimpFlags &= ~(aiProcess_CalcTangentSpace);
 
-        Assimp::Importer importer;
-        const aiScene* pScene = importer.ReadFile(fullpath, AssimpFlags);
+        const aiScene* pScene = pParsed->importer.ReadFile(fullpath, AssimpFlags);
 
         if((pScene == nullptr) || (verifyScene(pScene) == false))
         {
             std::string str("Can't open model file '");
-            str = str + std::string(filename) + "'\n" + importer.GetErrorString();
+            str = str + std::string(filename) + "'\n" + pParsed->importer.GetErrorString();
             logError(str, true);
-            return false;
+            return nullptr;
         }
+        pParsed->pScene = pScene;
 
-        // Extract the folder name
+        if(flags & Model::OptimizeMeshes)
+        {
+            optimizeMeshes(pScene, filename);
+        }
+
+        // After optimizing, so that the LODs keep the optimized triangle order
+        if(flags & Model::GenerateLods)
+        {
+            generateLods(pScene, filename, pParsed->lodChains);
+        }
+
+        // Start the texture loads here, so that they overlap with the parsing of other files
         auto last = fullpath.find_last_of("/\\");
         std::string modelFolder = fullpath.substr(0, last);
+        bool useSrgbTextures = (flags & Model::AssumeLinearSpaceTextures) == 0;
+        prefetchTextures(pScene, modelFolder, useSrgbTextures, pParsed->textureLoads);
+
+        return pParsed;
+    }
+
+    bool AssimpModelImporter::initModel(const std::string& filename, ParsedFile* pParsed)
+    {
+        const aiScene* pScene = pParsed->pScene;
+        // Copied, since the same parsed file can create several models
+        mTextureLoads = pParsed->textureLoads;
+        mLodChains = pParsed->lodChains;
+
+        // Extract the folder name
+        auto last = pParsed->fullpath.find_last_of("/\\");
+        std::string modelFolder = pParsed->fullpath.substr(0, last);
 
         // Order of initialization matters, materials, bones and animations need to loaded before mesh initialization
         bool isObjFile = hasSuffix(filename, ".obj", false);
@@ -456,6 +658,17 @@ namespace Falcor
             return false;
         }
 
+        if(mFlags & Model::CompactVertices)
+        {
+            const float toMB = 1.0f / (1024.0f * 1024.0f);
+            logInfo("Compact vertices of " + filename + ": " + std::to_string(mCompactVertexBytes * toMB) + " MB instead of " + std::to_string(mFullVertexBytes * toMB) + " MB");
+        }
+
+        if(mFlags & Model::DeduplicateGeometry)
+        {
+            logInfo("Deduplicated geometry of " + filename + ": " + mDeduplicator.getStatsString());
+        }
+
         mpModel->setFilename(filename);
 
         // filename can be a relative path
@@ -468,11 +681,17 @@ namespace Falcor
     }
 
     Model::SharedPtr AssimpModelImporter::createFromFile(const std::string& filename, uint32_t flags)
+    {
+        auto pParsed = parseFile(filename, flags);
+        return pParsed ? createFromParsedFile(filename, pParsed.get(), flags) : nullptr;
+    }
+
+    Model::SharedPtr AssimpModelImporter::createFromParsedFile(const std::string& filename, ParsedFile* pParsed, uint32_t flags)
     {
         AssimpModelImporter loader(flags);
 
         // Init the model
-        if(loader.initModel(filename) == false)
+        if(loader.initModel(filename, pParsed) == false)
         {
             loader.mpModel = nullptr;
         }
@@ -633,11 +852,11 @@ namespace Falcor
         return Animation::create(std::string(pAiAnim->mName.C_Str()), animationSets, duration, ticksPerSecond);
     }
 
-    Mesh::SharedPtr AssimpModelImporter::createMesh(const aiMesh* pAiMesh)
+    Mesh::SharedPtr AssimpModelImporter::createMesh(const aiMesh* pAiMesh, const MeshSimplifier::LodChain* pLodChain)
     {
         uint32_t vertexCount = pAiMesh->mNumVertices;
         uint32_t indexCount = pAiMesh->mNumFaces * pAiMesh->mFaces[0].mNumIndices;
-        auto pIB = createIndexBuffer(pAiMesh);
+        auto pIB = createIndexBuffer(pAiMesh, pLodChain);
         BoundingBox boundingBox;
 
         if(mFlags & Model::GenerateTangentSpace)
@@ -653,12 +872,21 @@ namespace Falcor
         }
 
         std::vector<Buffer::SharedPtr> pVBs(pLayout->getBufferCount());
+        VertexCompression::PositionQuantization quantization;
+        bool compact = (mFlags & Model::CompactVertices) != 0;
 
         // Create corresponding vertex buffers
-        for(uint32_t i = 0 ; i < pLayout->getBufferCount() ; i++)
+        if(compact)
         {
-            const VertexBufferLayout* pVbLayout = pLayout->getBufferLayout(i).get();
-            pVBs[i] = createVertexBuffer(pAiMesh, vertexCount, boundingBox, pVbLayout);
+            createCompactVertexBuffers(pAiMesh, pLayout.get(), pVBs, boundingBox, quantization);
+        }
+        else
+        {
+            for(uint32_t i = 0 ; i < pLayout->getBufferCount() ; i++)
+            {
+                const VertexBufferLayout* pVbLayout = pLayout->getBufferLayout(i).get();
+                pVBs[i] = createVertexBuffer(pAiMesh, vertexCount, boundingBox, pVbLayout);
+            }
         }
 
         Vao::Topology topology;
@@ -681,7 +909,35 @@ namespace Falcor
         auto pMaterial = mAiMaterialToFalcor[pAiMesh->mMaterialIndex];
         assert(pMaterial);
 
-        Mesh::SharedPtr pMesh = Mesh::create(pVBs, vertexCount, pIB, indexCount, pLayout, topology, pMaterial, boundingBox, pAiMesh->HasBones());
+        // Compact meshes aren't shared even if their buffers are, since equal quantized positions can decode to different positions
+        Mesh::SharedPtr pMesh;
+        if((mFlags & Model::DeduplicateGeometry) && (compact == false))
+        {
+            pMesh = mDeduplicator.createMesh(pVBs, vertexCount, pIB, indexCount, pLayout, topology, pMaterial, boundingBox, pAiMesh->HasBones());
+        }
+        else
+        {
+            pMesh = Mesh::create(pVBs, vertexCount, pIB, indexCount, pLayout, topology, pMaterial, boundingBox, pAiMesh->HasBones());
+        }
+
+        if(pLodChain && pLodChain->indexCounts.size())
+        {
+            pMesh->setLods(createMeshLods(indexCount, *pLodChain));
+        }
+
+        // Deduplicated meshes may already have a BVH
+        if((mFlags & Model::BuildBvh) && topology == Vao::Topology::TriangleList && pAiMesh->HasBones() == false && pMesh->mpBvh == nullptr)
+        {
+            std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
+            pMesh->mpBvh = TriangleBvh::create(indices.data(), indexCount, pAiMesh->mVertices, sizeof(aiVector3D), vertexCount);
+        }
+
+        if(compact)
+        {
+            pMesh->mHasCompactVertices = true;
+            pMesh->mPositionDequantScale = quantization.scale;
+            pMesh->mPositionDequantOffset = quantization.offset;
+        }
 
         if(mFlags & Model::GenerateTangentSpace)
         {
@@ -692,11 +948,25 @@ namespace Falcor
         return pMesh;
     }
 
-    Buffer::SharedPtr AssimpModelImporter::createIndexBuffer(const aiMesh* pAiMesh)
+    Buffer::SharedPtr AssimpModelImporter::createBuffer(size_t size, Resource::BindFlags bindFlags, const void* pData)
+    {
+        if(mFlags & Model::DeduplicateGeometry)
+        {
+            return mDeduplicator.createBuffer(size, bindFlags, pData);
+        }
+        return Buffer::create(size, bindFlags, Buffer::CpuAccess::None, pData);
+    }
+
+    Buffer::SharedPtr AssimpModelImporter::createIndexBuffer(const aiMesh* pAiMesh, const MeshSimplifier::LodChain* pLodChain)
     {
+        // The LODs are stored after the original indices
         std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
+        if(pLodChain)
+        {
+            indices.insert(indices.end(), pLodChain->indices.begin(), pLodChain->indices.end());
+        }
         const uint32_t size = (uint32_t)(sizeof(uint32_t) * indices.size());
-        return Buffer::create(size, Buffer::BindFlags::Index, Buffer::CpuAccess::None, indices.data());;
+        return createBuffer(size, Buffer::BindFlags::Index, indices.data());
     }
 
 
@@ -744,6 +1014,15 @@ namespace Falcor
             return nullptr;
         }
 
+        if(mFlags & Model::CompactVertices)
+        {
+            return VertexCompression::createLayout(isElementUsed(pAiMesh, VERTEX_NORMAL_LOC),
+                isElementUsed(pAiMesh, VERTEX_BITANGENT_LOC),
+                isElementUsed(pAiMesh, VERTEX_TEXCOORD_LOC),
+                isElementUsed(pAiMesh, VERTEX_DIFFUSE_COLOR_LOC),
+                pAiMesh->HasBones());
+        }
+
         VertexLayout::SharedPtr pLayout = VertexLayout::create();
 
         uint32_t bufferCount = 0;
@@ -831,7 +1110,103 @@ namespace Falcor
             loadBones(pAiMesh, initData.data(), vertexCount, vertexStride, boneOffset, weightOffset);
         }
 
-        return Buffer::create(vertexStride * vertexCount, Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, initData.data());;
+        return createBuffer(vertexStride * vertexCount, Buffer::BindFlags::Vertex, initData.data());
+    }
+
+    void AssimpModelImporter::createCompactVertexBuffers(const aiMesh* pAiMesh, const VertexLayout* pLayout, std::vector<Buffer::SharedPtr>& pVBs, BoundingBox& boundingBox, VertexCompression::PositionQuantization& quantization)
+    {
+        const uint32_t vertexCount = pAiMesh->mNumVertices;
+
+        // The quantization grid spans the mesh's bounding-box
+        glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+        for(uint32_t vertexID = 0; vertexID < vertexCount; vertexID++)
+        {
+            glm::vec3 xyz(pAiMesh->mVertices[vertexID].x, pAiMesh->mVertices[vertexID].y, pAiMesh->mVertices[vertexID].z);
+            boxMin = glm::min(boxMin, xyz);
+            boxMax = glm::max(boxMax, xyz);
+        }
+        boundingBox = BoundingBox::fromMinMax(boxMin, boxMax);
+        quantization = VertexCompression::PositionQuantization::fromBoundingBox(boundingBox);
+
+        // Positions stream
+        std::vector<uint16_t> positions(vertexCount * 4);
+        for(uint32_t vertexID = 0; vertexID < vertexCount; vertexID++)
+        {
+            const aiVector3D& p = pAiMesh->mVertices[vertexID];
+            quantization.encode(glm::vec3(p.x, p.y, p.z), &positions[vertexID * 4]);
+        }
+        const uint32_t positionBytes = (uint32_t)(positions.size() * sizeof(uint16_t));
+        pVBs[0] = createBuffer(positionBytes, Buffer::BindFlags::Vertex, positions.data());
+        mCompactVertexBytes += positionBytes;
+        mFullVertexBytes += vertexCount * getFormatBytesPerBlock(kLayoutData[VERTEX_POSITION_LOC].format);
+
+        if(pLayout->getBufferCount() < 2)
+        {
+            return;
+        }
+
+        // Interleaved attributes stream
+        const VertexBufferLayout* pVbLayout = pLayout->getBufferLayout(1).get();
+        const uint32_t vertexStride = pVbLayout->getStride();
+        std::vector<uint8_t> initData(vertexStride * vertexCount, 0);
+
+        uint32_t weightOffset = -1;
+        uint32_t boneOffset = -1;
+
+        for(uint32_t elementID = 0; elementID < pVbLayout->getElementCount(); elementID++)
+        {
+            const uint32_t offset = pVbLayout->getElementOffset(elementID);
+            const uint32_t location = pVbLayout->getElementShaderLocation(elementID);
+            mFullVertexBytes += vertexCount * getFormatBytesPerBlock(kLayoutData[location].format);
+
+            for(uint32_t vertexID = 0; vertexID < vertexCount; vertexID++)
+            {
+                uint32_t* pDst = (uint32_t*)(&initData[vertexStride * vertexID + offset]);
+                switch(location)
+                {
+                case VERTEX_NORMAL_LOC:
+                {
+                    const aiVector3D& n = pAiMesh->mNormals[vertexID];
+                    *pDst = VertexCompression::encodeDirection(glm::vec3(n.x, n.y, n.z));
+                    break;
+                }
+                case VERTEX_BITANGENT_LOC:
+                {
+                    const aiVector3D& b = pAiMesh->mBitangents[vertexID];
+                    *pDst = VertexCompression::encodeDirection(glm::vec3(b.x, b.y, b.z));
+                    break;
+                }
+                case VERTEX_TEXCOORD_LOC:
+                {
+                    const aiVector3D& t = pAiMesh->mTextureCoords[0][vertexID];
+                    *pDst = VertexCompression::encodeTexCrd(glm::vec2(t.x, t.y));
+                    break;
+                }
+                case VERTEX_DIFFUSE_COLOR_LOC:
+                {
+                    const aiColor4D& c = pAiMesh->mColors[0][vertexID];
+                    *pDst = VertexCompression::encodeColor(glm::vec4(c.r, c.g, c.b, c.a));
+                    break;
+                }
+                case VERTEX_BONE_WEIGHT_LOC:
+                    weightOffset = offset;
+                    break;
+                case VERTEX_BONE_ID_LOC:
+                    boneOffset = offset;
+                    break;
+                default:
+                    should_not_get_here();
+                }
+            }
+        }
+
+        if(pAiMesh->HasBones() && boneOffset != -1 && weightOffset != -1)
+        {
+            loadBones(pAiMesh, initData.data(), vertexCount, vertexStride, boneOffset, weightOffset);
+        }
+
+        pVBs[1] = createBuffer(vertexStride * vertexCount, Buffer::BindFlags::Vertex, initData.data());
+        mCompactVertexBytes += vertexStride * vertexCount;
     }
 
     void AssimpModelImporter::loadBones(const aiMesh* pAiMesh, uint8_t* pVertexData, uint32_t vertexCount, uint32_t vertexStride, uint32_t idOffset, uint32_t weightOffset)
@@ -32,6 +32,10 @@
 #include "../AnimationController.h"
 #include "../Mesh.h"
 #include "../Model.h"
+#include "Graphics/TextureHelper.h"
+#include "../VertexCompression.h"
+#include "../MeshDeduplicator.h"
+#include "../MeshSimplifier.h"
 
 struct aiScene;
 struct aiNode;
@@ -56,6 +60,25 @@ namespace Falcor
         */
         static Model::SharedPtr createFromFile(const std::string& filename, uint32_t flags);
 
+        /** The ASSIMP scene of a model file, and the texture loads it started
+        */
+        struct ParsedFile;
+
+        /** Read and post-process a model file. This is the CPU stage of createFromFile(): it doesn't create device resources, so it can run on any thread.
+            \param[in] filename Model's filename. Loader will look for it in the data directories.
+            \param[in] flags Flags controlling model creation
+            returns nullptr if the file can't be read
+        */
+        static std::shared_ptr<ParsedFile> parseFile(const std::string& filename, uint32_t flags);
+
+        /** Create a model from a file returned by parseFile(). Must be called from the thread which owns the device.
+            \param[in] filename The filename passed to parseFile()
+            \param[in] pParsed The parsed file. It isn't modified, so it can be used to create several models.
+            \param[in] flags The flags passed to parseFile()
+            returns nullptr if loading failed, otherwise a new Model object
+        */
+        static Model::SharedPtr createFromParsedFile(const std::string& filename, ParsedFile* pParsed, uint32_t flags);
+
     private:
 
         using IdToMesh = std::unordered_map<uint32_t, Mesh::SharedPtr>;
@@ -64,7 +87,7 @@ namespace Falcor
         AssimpModelImporter(const AssimpModelImporter&) = delete;
         void operator=(const AssimpModelImporter&) = delete;
 
-        bool initModel(const std::string& filename);
+        bool initModel(const std::string& filename, ParsedFile* pParsed);
         bool createDrawList(const aiScene* pScene);
         bool parseAiSceneNode(const aiNode* pCurrent, const aiScene* pScene, IdToMesh& aiToFalcorMesh);
         bool createAllMaterials(const aiScene* pScene, const std::string& modelFolder, bool isObjFile, bool useSrgb);
@@ -76,10 +99,12 @@ namespace Falcor
 
         Animation::UniquePtr createAnimation(const aiAnimation* pAiAnim);
 
-        Mesh::SharedPtr createMesh(const aiMesh* pAiMesh);
+        Mesh::SharedPtr createMesh(const aiMesh* pAiMesh, const MeshSimplifier::LodChain* pLodChain);
         VertexLayout::SharedPtr createVertexLayout(const aiMesh* pAiMesh);
-        Buffer::SharedPtr createIndexBuffer(const aiMesh* pAiMesh);
+        Buffer::SharedPtr createBuffer(size_t size, Resource::BindFlags bindFlags, const void* pData);
+        Buffer::SharedPtr createIndexBuffer(const aiMesh* pAiMesh, const MeshSimplifier::LodChain* pLodChain);
         Buffer::SharedPtr createVertexBuffer(const aiMesh* pAiMesh, uint32_t vertexCount, BoundingBox& boundingBox, const VertexBufferLayout* pLayout);
+        void createCompactVertexBuffers(const aiMesh* pAiMesh, const VertexLayout* pLayout, std::vector<Buffer::SharedPtr>& pVBs, BoundingBox& boundingBox, VertexCompression::PositionQuantization& quantization);
         void loadBones(const aiMesh* pAiMesh, uint8_t* pVertexData, uint32_t vertexCount, uint32_t vertexStride, uint32_t idOffset, uint32_t weightOffset);
         void loadTextures(const aiMaterial* pAiMaterial, const std::string& folder, BasicMaterial* pMaterial, bool isObjFile, bool useSrgb);
         Material::SharedPtr createMaterial(const aiMaterial* pAiMaterial, const std::string& folder, bool isObjFile, bool useSrgb);
@@ -92,5 +117,10 @@ namespace Falcor
         std::vector<Bone> mBones;
         uint32_t mFlags;
         std::map<const std::string, Texture::SharedPtr> mTextureCache;
+        std::map<const std::string, TextureLoadHandle> mTextureLoads;    ///< Loads started by parseFile()
+        uint64_t mCompactVertexBytes = 0;   ///< Vertex memory used with Model::CompactVertices
+        uint64_t mFullVertexBytes = 0;      ///< Vertex memory the same meshes need in the full precision format
+        MeshDeduplicator mDeduplicator;     ///< Used with Model::DeduplicateGeometry
+        std::vector<MeshSimplifier::LodChain> mLodChains;   ///< Indexed like aiScene::mMeshes. Only used with Model::GenerateLods.
     };
 }
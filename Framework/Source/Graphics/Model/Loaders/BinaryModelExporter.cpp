@@ -36,6 +36,7 @@
 #include "BinaryImage.hpp"
 #include "Data/VertexAttrib.h"
 #include "API/Device.h"
+#include "Graphics/TextureHelper.h"
 
 namespace Falcor
 {
@@ -154,9 +155,14 @@ namespace Falcor
         stream.write(str.c_str(), str.size());;
     }
 
-    void BinaryModelExporter::exportToFile(const std::string& filename, const Model* pModel)
+    void BinaryModelExporter::exportToFile(const std::string& filename, const Model* pModel, TextureBaker::Stats* pBakeStats)
     {
-        BinaryModelExporter(filename, pModel);
+        BinaryModelExporter(filename, pModel, pBakeStats);
+    }
+
+    std::string BinaryModelExporter::getBakedTextureFilename(const std::string& modelFilename, const std::string& textureName)
+    {
+        return getDirectoryFromFile(modelFilename) + '/' + Falcor::getBakedTextureFilename(getFilenameFromPath(textureName));
     }
 
     void BinaryModelExporter::error(const std::string& msg)
@@ -170,7 +176,7 @@ namespace Falcor
         logError("Warning when exporting model \"" + mFilename + "\".\n" + Msg);
     }
 
-    BinaryModelExporter::BinaryModelExporter(const std::string& filename, const Model* pModel) : mFilename(filename)
+    BinaryModelExporter::BinaryModelExporter(const std::string& filename, const Model* pModel, TextureBaker::Stats* pBakeStats) : mFilename(filename), mpBakeStats(pBakeStats)
     {
         mStream.open(filename.c_str(), BinaryFileStream::Mode::Write);
         mpModel = pModel;
@@ -192,6 +198,19 @@ namespace Falcor
         if(writeTextures()    == false) return;
         if(writeMeshes()      == false) return;
         if(writeInstances()   == false) return;
+
+        mStream.close();
+        bakeTextures();
+    }
+
+    void BinaryModelExporter::bakeTextures()
+    {
+        for(const auto& bake : mPendingBakes)
+        {
+            // Textures which can't be baked are only embedded in the binary file, so this isn't an error
+            TextureBaker::bakeImage(bake.data.data(), bake.width, bake.height, bake.format, bake.filename, TextureBaker::Quality::High, *mpBakeStats);
+        }
+        mPendingBakes.clear();
     }
 
     bool BinaryModelExporter::prepareSubmeshes()
@@ -207,6 +226,18 @@ namespace Falcor
                 continue;
             }
 
+            if(pMesh->hasCompactVertices())
+            {
+                warning("Binary format doesn't support compact vertices. Load the model without Model::CompactVertices to export it.");
+                continue;
+            }
+
+            if(pMesh->isInGeometryArena())
+            {
+                warning("Can't export meshes stored in a geometry arena. Load the model without Model::UseGeometryArena to export it.");
+                continue;
+            }
+
             const auto& pVao = pMesh->getVao();
             auto& submesh = mMeshes[pVao.get()];
             submesh.push_back(i);
@@ -224,7 +255,7 @@ namespace Falcor
     bool BinaryModelExporter::writeHeader()
     {
         mStream.write("BinScene", 8);
-        mStream << (int32_t)8 << (int32_t)mpModel->getTextureCount() << (int32_t)mMeshes.size() << (int32_t)mInstanceCount;
+        mStream << (int32_t)9 << (int32_t)mpModel->getTextureCount() << (int32_t)mMeshes.size() << (int32_t)mInstanceCount;
         return true;
     }
 
@@ -360,8 +391,17 @@ namespace Falcor
         
         auto pStaging = Buffer::create(pMesh->getVao()->getIndexBuffer()->getSize(), Buffer::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
         pMesh->getVao()->getIndexBuffer()->copy(pStaging.get());
-        const void* pIndices = pStaging->map(Buffer::MapType::Read);
+        const uint32_t* pIndices = (const uint32_t*)pStaging->map(Buffer::MapType::Read);
         mStream.write(pIndices, indexCount * sizeof(uint32_t));
+
+        // The LODs, excluding the original geometry
+        mStream << (int32_t)(pMesh->getLodCount() - 1);
+        for(uint32_t i = 1; i < pMesh->getLodCount(); i++)
+        {
+            const Mesh::Lod& lod = pMesh->getLod(i);
+            mStream << lod.error << (int32_t)(lod.indexCount / 3);
+            mStream.write(pIndices + lod.firstIndex, lod.indexCount * sizeof(uint32_t));
+        }
         pStaging->unmap();
 
         return true;
@@ -464,6 +504,17 @@ namespace Falcor
         // Write the data
         std::vector<uint8_t> data = gpDevice->getRenderContext()->readTextureSubresource(pTexture, 0);
         mStream.write(data.data(), dataSize);
+
+        if(mpBakeStats && pTexture->getSourceFilename().size())
+        {
+            PendingBake bake;
+            bake.width = width;
+            bake.height = height;
+            bake.format = format;
+            bake.filename = getBakedTextureFilename(mFilename, pTexture->getSourceFilename());
+            bake.data = std::move(data);
+            mPendingBakes.push_back(std::move(bake));
+        }
         return true;
     }
 }
\ No newline at end of file
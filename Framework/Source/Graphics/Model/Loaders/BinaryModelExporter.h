@@ -31,6 +31,7 @@
 #include <map>
 #include <vector>
 #include "Graphics/Model/Mesh.h"
+#include "Graphics/TextureBaker.h"
 
 namespace Falcor
 {
@@ -45,14 +46,35 @@ namespace Falcor
         /** Export a model into a binary file
             \param[in] filename Model's filename. Loader will look for it in the data directories.
             \param[in] pModel The model to export
+            \param[in,out] pBakeStats If not nullptr, the material textures are also baked into block-compressed DDS files next to the binary file, and the baking statistics are accumulated into it. See getBakedTextureFilename().
+            The textures are baked after the binary file is written, since the importer ignores baked files which are older than the model.
             returns nullptr if loading failed, otherwise a new Model object
         */
-        static void exportToFile(const std::string& filename, const Model* pModel);
+        static void exportToFile(const std::string& filename, const Model* pModel, TextureBaker::Stats* pBakeStats = nullptr);
+
+        /** Get the filename of a baked texture of a binary model. BinaryModelImporter loads the baked file instead of the embedded image if it exists.
+            \param[in] modelFilename The binary model's filename
+            \param[in] textureName The texture name stored in the binary file
+        */
+        static std::string getBakedTextureFilename(const std::string& modelFilename, const std::string& textureName);
 
     private:
-        BinaryModelExporter(const std::string& filename, const Model* pModel);
+        BinaryModelExporter(const std::string& filename, const Model* pModel, TextureBaker::Stats* pBakeStats);
         const Model* mpModel = nullptr;
+        TextureBaker::Stats* mpBakeStats = nullptr;
         BinaryFileStream mStream;
+
+        /** A texture which is baked once the binary file is written
+        */
+        struct PendingBake
+        {
+            std::vector<uint8_t> data;
+            uint32_t width;
+            uint32_t height;
+            ResourceFormat format;
+            std::string filename;
+        };
+        std::vector<PendingBake> mPendingBakes;
         const std::string& mFilename;
 
         bool writeHeader();
@@ -65,6 +87,7 @@ namespace Falcor
         bool writeMaterialTexture(uint32_t& texID, const Texture::SharedPtr& pTexture);
         
         bool exportBinaryImage(const Texture* pTexture);
+        void bakeTextures();
 
         void error(const std::string& Msg);
         void warning(const std::string& Msg);
@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "BinaryModelImporter.h"
 #include "BinaryModelSpec.h"
+#include "BinaryModelExporter.h"
 #include "../Model.h"
 #include "../Mesh.h"
 #include "Utils/OS.h"
@@ -39,6 +40,12 @@
 #include "API/Formats.h"
 #include "API/Texture.h"
 #include "Graphics/Material/Material.h"
+#include "Graphics/Material/TextureStreamer.h"
+#include "Graphics/TextureHelper.h"
+#include "../MeshOptimizer.h"
+#include "../MeshDeduplicator.h"
+#include "../MeshSimplifier.h"
+#include "Utils/ThreadPool.h"
 #include "glm/geometric.hpp"
 
 namespace Falcor
@@ -50,6 +57,8 @@ namespace Falcor
         ResourceFormat format = ResourceFormat::Unknown;
         std::vector<uint8_t> data;
         std::string name;
+        std::streamoff fileOffset = 0;  ///< Location of the image in the model file, used to stream it again later
+        std::string bakedFilename;      ///< The baked texture which replaces the embedded image. The embedded texels aren't read if it's set.
     };
 
     bool isSpecialFloat(float f)
@@ -353,7 +362,7 @@ namespace Falcor
         return std::string(charVec.data());
     }
 
-    bool loadBinaryTextureData(BinaryFileStream& stream, const std::string& modelName, TextureData& data)
+    bool loadBinaryTextureData(BinaryFileStream& stream, const std::string& modelName, TextureData& data, bool skipTexels = false)
     {
         // ImageHeader.
         char tag[9];
@@ -443,6 +452,12 @@ namespace Falcor
         if(bpp == 3)
             storageSize = 4 * texelCount;
 
+        if(skipTexels)
+        {
+            stream.skip(dataSize);
+            return true;
+        }
+
         data.data.resize(storageSize);
         stream.read(data.data.data(), dataSize);
 
@@ -461,6 +476,24 @@ namespace Falcor
         return true;
     }
 
+    /** Find the baked version of an embedded texture. Baked files which are older than the model are ignored, since they are left over from an earlier export.
+    */
+    static bool findBakedTexture(const std::string& modelName, const std::string& textureName, std::string& bakedFilename)
+    {
+        bakedFilename = BinaryModelExporter::getBakedTextureFilename(modelName, textureName);
+        if(doesFileExist(bakedFilename) == false)
+        {
+            return false;
+        }
+
+        if(getFileModifiedTime(modelName) > getFileModifiedTime(bakedFilename))
+        {
+            logWarning("Baked texture " + bakedFilename + " is older than " + modelName + ". Loading the embedded image.");
+            return false;
+        }
+        return true;
+    }
+
     bool importTextures(std::vector<TextureData>& textures, uint32_t textureCount, BinaryFileStream& stream, const std::string& modelName)
     {
         textures.assign(textureCount, TextureData());
@@ -468,7 +501,17 @@ namespace Falcor
         for(uint32_t i = 0; i < textureCount; i++)
         {
             textures[i].name = readString(stream);
-            if(loadBinaryTextureData(stream, modelName, textures[i]) == false)
+            textures[i].fileOffset = stream.getPosition();
+
+            // Prefer the baked texture if the model was exported with baking enabled
+            std::string bakedFilename;
+            bool useBaked = findBakedTexture(modelName, textures[i].name, bakedFilename);
+            if(useBaked)
+            {
+                textures[i].bakedFilename = bakedFilename;
+            }
+
+            if(loadBinaryTextureData(stream, modelName, textures[i], useBaked) == false)
             {
                 return false;
             }
@@ -477,6 +520,21 @@ namespace Falcor
         return true;
     }
 
+    TextureStreamer::Source createBinaryImageSource(const std::string& modelName, std::streamoff fileOffset)
+    {
+        return [modelName, fileOffset](uint32_t firstMip, TextureMipChain& chain)
+        {
+            BinaryFileStream stream(modelName, BinaryFileStream::Mode::Read);
+            stream.setPosition(fileOffset);
+            TextureData data;
+            if(loadBinaryTextureData(stream, modelName, data) == false)
+            {
+                return false;
+            }
+            return generateTextureMipChain(data.data.data(), data.width, data.height, data.format, firstMip, chain);
+        };
+    }
+
     BinaryModelImporter::BinaryModelImporter(const std::string& fullpath) : mModelName(fullpath), mStream(fullpath.c_str(), BinaryFileStream::Mode::Read)
     {
     }
@@ -507,7 +565,7 @@ namespace Falcor
     {
         if(std::string(formatID) == "BinScene")
         {
-            if(version < 6 || version > 8)
+            if(version < 6 || version > 9)
             {
                 std::string Msg = "Error when loading model " + modelName + ".\nUnsupported binary scene version " + std::to_string(version);
                 logError(Msg);
@@ -608,6 +666,7 @@ namespace Falcor
         case 6:     numTextureSlots = TextureType_Specular + 1; break;
         case 7:     numTextureSlots = TextureType_Glossiness + 1; break;
         case 8:     numTextureSlots = TextureType_Glossiness + 1; numAttributesType = AttribType_Max; break;
+        case 9:     numTextureSlots = TextureType_Glossiness + 1; numAttributesType = AttribType_Max; break;
         default:
             should_not_get_here();
             return nullptr;
@@ -647,6 +706,17 @@ namespace Falcor
         // create objects
         auto pModel = Model::create();
         bool shouldGenerateTangents = (flags & Model::GenerateTangentSpace) != 0;
+        bool shouldOptimizeMeshes = (flags & Model::OptimizeMeshes) != 0;
+        MeshOptimizer::Stats optimizerStats;
+        bool shouldDeduplicate = (flags & Model::DeduplicateGeometry) != 0;
+        MeshDeduplicator deduplicator;
+        bool shouldGenerateLods = (flags & Model::GenerateLods) != 0;
+        bool shouldBuildBvh = (flags & Model::BuildBvh) != 0;
+
+        auto createBuffer = [&](size_t size, Resource::BindFlags bindFlags, const void* pData)
+        {
+            return shouldDeduplicate ? deduplicator.createBuffer(size, bindFlags, pData) : Buffer::create(size, bindFlags, Buffer::CpuAccess::None, pData);
+        };
 
         std::vector<TextureData> texData;
 
@@ -664,15 +734,15 @@ namespace Falcor
         
         struct TexSignature
         {
-            const uint8_t* pData;
+            int32_t texID;
             ResourceFormat format;
             bool operator<(const TexSignature& other) const 
             { 
-                if(pData < other.pData) return true;
-                if(pData == other.pData) return format < other.format;
+                if(texID < other.texID) return true;
+                if(texID == other.texID) return format < other.format;
                 return false;
             }
-            bool operator==(const TexSignature& other) const { return pData == other.pData || format == other.format; }
+            bool operator==(const TexSignature& other) const { return texID == other.texID && format == other.format; }
         };
         std::map<TexSignature, Texture::SharedPtr> textures;
         bool loadTexAsSrgb = (flags & Model::AssumeLinearSpaceTextures) ? false : true;
@@ -822,7 +892,7 @@ namespace Falcor
             {
                 if(buffers[i].shouldSkip == false)
                 {
-                    pVBs[i] = Buffer::create(buffers[i].vec.size(), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffers[i].vec.data());
+                    pVBs[i] = createBuffer(buffers[i].vec.size(), Buffer::BindFlags::Vertex, buffers[i].vec.data());
                 }
             }
 
@@ -833,7 +903,18 @@ namespace Falcor
             }
 
             // Array of Submesh.
-            // Falcor doesn't have a concept of submeshes, just create a new mesh for each submesh
+            // The submeshes are read first, so that missing LODs can be generated for all of them in parallel
+            struct SubmeshData
+            {
+                Material::SharedPtr pMaterial;
+                std::vector<uint32_t> indices;
+                MeshSimplifier::LodChain lodChain;
+                bool hasLodChain = false;       ///< Set if the file stores the LOD chain, even an empty one
+                TriangleBvh::SharedPtr pBvh;
+            };
+            std::vector<SubmeshData> submeshes(numSubmeshes);
+            bool lodsMissing = false;
+
             for(int submesh = 0; submesh < numSubmeshes; submesh++)
             {
                 // create the material
@@ -881,7 +962,7 @@ namespace Falcor
                         // Load the texture
                         TexSignature texSig;
                         texSig.format = getFormatFromMapType(loadTexAsSrgb, texData[texID].format, falcorType);
-                        texSig.pData = texData[texID].data.data();
+                        texSig.texID = texID;
                         // Check if we already created a matching texture
                         auto existingTex = textures.find(texSig);
                         if(existingTex != textures.end())
@@ -890,7 +971,36 @@ namespace Falcor
                         }
                         else
                         {
-                            auto pTexture = Texture::create2D(texData[texID].width, texData[texID].height, texSig.format, 1, Texture::kMaxPossible, texSig.pData);
+                            // importTextures() already picked the baked texture if there's an up-to-date one
+                            Texture::SharedPtr pTexture;
+                            TextureData& tex = texData[texID];
+                            if(tex.bakedFilename.size())
+                            {
+                                std::string bakedFilename = tex.bakedFilename;
+                                pTexture = createTextureFromFile(bakedFilename, true, isSrgbFormat(texSig.format));
+                                if(pTexture)
+                                {
+                                    TextureStreamer::registerTextureSource(pTexture, [bakedFilename](uint32_t firstMip, TextureMipChain& chain) { return loadTextureMipChain(bakedFilename, firstMip, chain); });
+                                }
+                                else
+                                {
+                                    // The embedded texels were skipped, so read them now
+                                    logWarning("Can't load baked texture " + bakedFilename + ". Loading the embedded image.");
+                                    BinaryFileStream stream(mModelName, BinaryFileStream::Mode::Read);
+                                    stream.setPosition(tex.fileOffset);
+                                    if(loadBinaryTextureData(stream, mModelName, tex) == false)
+                                    {
+                                        return nullptr;
+                                    }
+                                    tex.bakedFilename.clear();
+                                }
+                            }
+
+                            if(pTexture == nullptr)
+                            {
+                                pTexture = Texture::create2D(tex.width, tex.height, texSig.format, 1, Texture::kMaxPossible, tex.data.data());
+                                TextureStreamer::registerTextureSource(pTexture, createBinaryImageSource(mModelName, tex.fileOffset));
+                            }
                             pTexture->setSourceFilename(texData[texID].name);
                             textures[texSig] = pTexture;
                             basicMaterial.pTextures[falcorType] = pTexture;
@@ -899,7 +1009,8 @@ namespace Falcor
                 }
 
                 // Create material and check if it already exists
-                auto pMaterial = checkForExistingMaterial(basicMaterial.convertToMaterial());
+                SubmeshData& data = submeshes[submesh];
+                data.pMaterial = checkForExistingMaterial(basicMaterial.convertToMaterial());
 
                 int32_t numTriangles;
                 mStream >> numTriangles;
@@ -910,13 +1021,90 @@ namespace Falcor
                     return nullptr;
                 }
 
-                // create the index buffer
                 uint32_t numIndices = numTriangles * 3;
-                std::vector<uint32_t> indices(numIndices);
-                uint32_t ibSize = 3 * numTriangles * sizeof(uint32_t);
-                mStream.read(&indices[0], ibSize);
+                data.indices.resize(numIndices);
+                mStream.read(data.indices.data(), numIndices * sizeof(uint32_t));
 
-                auto pIB = Buffer::create(ibSize, Buffer::BindFlags::Index, Buffer::CpuAccess::None, indices.data());
+                // Submeshes share the vertex buffers, which were already created, so only the triangles are reordered
+                if(shouldOptimizeMeshes)
+                {
+                    MeshOptimizer::optimizeTriangleList(data.indices.data(), numIndices, buffers[positionBufferIndex].vec.data(), pLayout->getBufferLayout(positionBufferIndex)->getStride(), numVertices, optimizerStats);
+                }
+
+                if(version >= 9)
+                {
+                    int32_t numLods;
+                    mStream >> numLods;
+                    if(numLods < 0)
+                    {
+                        logError("Error when loading model " + mModelName + ".\nMesh has negative number of LODs!");
+                        return nullptr;
+                    }
+
+                    for(int32_t lod = 0; lod < numLods; lod++)
+                    {
+                        float error;
+                        int32_t numLodTriangles;
+                        mStream >> error >> numLodTriangles;
+                        if(numLodTriangles < 0)
+                        {
+                            logError("Error when loading model " + mModelName + ".\nMesh LOD has negative number of triangles!");
+                            return nullptr;
+                        }
+
+                        size_t offset = data.lodChain.indices.size();
+                        data.lodChain.indices.resize(offset + numLodTriangles * 3);
+                        mStream.read(data.lodChain.indices.data() + offset, numLodTriangles * 3 * sizeof(uint32_t));
+                        data.lodChain.indexCounts.push_back(numLodTriangles * 3);
+                        data.lodChain.errors.push_back(error);
+                    }
+
+                    // An empty chain is valid, e.g. for meshes too small to simplify. Regenerating it would run the simplifier on every load.
+                    data.hasLodChain = true;
+                }
+                lodsMissing = lodsMissing || (data.hasLodChain == false);
+            }
+
+            const uint8_t* pPositions = buffers[positionBufferIndex].vec.data();
+            uint32_t positionStride = pLayout->getBufferLayout(positionBufferIndex)->getStride();
+            if(shouldGenerateLods && lodsMissing)
+            {
+                ThreadPool::instance()->parallelFor(numSubmeshes, 1, [&](uint32_t begin, uint32_t end)
+                {
+                    for(uint32_t i = begin; i < end; i++)
+                    {
+                        SubmeshData& data = submeshes[i];
+                        if(data.hasLodChain == false)
+                        {
+                            MeshSimplifier::generateLodChain(data.indices.data(), (uint32_t)data.indices.size(), pPositions, positionStride, numVertices, data.lodChain);
+                        }
+                    }
+                });
+            }
+
+            if(shouldBuildBvh)
+            {
+                ThreadPool::instance()->parallelFor(numSubmeshes, 1, [&](uint32_t begin, uint32_t end)
+                {
+                    for(uint32_t i = begin; i < end; i++)
+                    {
+                        SubmeshData& data = submeshes[i];
+                        data.pBvh = TriangleBvh::create(data.indices.data(), (uint32_t)data.indices.size(), pPositions, positionStride, numVertices);
+                    }
+                });
+            }
+
+            // Falcor doesn't have a concept of submeshes, just create a new mesh for each submesh
+            for(int submesh = 0; submesh < numSubmeshes; submesh++)
+            {
+                const SubmeshData& data = submeshes[submesh];
+                const std::vector<uint32_t>& indices = data.indices;
+                uint32_t numIndices = (uint32_t)indices.size();
+
+                // create the index buffer. The LODs are stored after the original indices.
+                std::vector<uint32_t> ibData = indices;
+                ibData.insert(ibData.end(), data.lodChain.indices.begin(), data.lodChain.indices.end());
+                auto pIB = createBuffer(ibData.size() * sizeof(uint32_t), Buffer::BindFlags::Index, ibData.data());
 
                 // Generate tangent space data if needed
                 if(genTangentForMesh)
@@ -944,7 +1132,7 @@ namespace Falcor
                         generateSubmeshTangentData<glm::vec4>(indices, (glm::vec4*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
                     }
 
-                    pVBs[bitangentBufferIndex] = Buffer::create(buffers[bitangentBufferIndex].vec.size(), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffers[bitangentBufferIndex].vec.data());
+                    pVBs[bitangentBufferIndex] = createBuffer(buffers[bitangentBufferIndex].vec.size(), Buffer::BindFlags::Vertex, buffers[bitangentBufferIndex].vec.data());
                 }
                 
 
@@ -964,8 +1152,33 @@ namespace Falcor
 
                 BoundingBox box = BoundingBox::fromMinMax(min, max);
 
-                // create the mesh
-                auto pMesh = Mesh::create(pVBs, numVertices, pIB, numIndices, pLayout, Vao::Topology::TriangleList, pMaterial, box, false);
+                // create the mesh. With deduplication, a submesh identical to an earlier one returns the earlier mesh and becomes one of its instances.
+                Mesh::SharedPtr pMesh;
+                if(shouldDeduplicate)
+                {
+                    pMesh = deduplicator.createMesh(pVBs, numVertices, pIB, numIndices, pLayout, Vao::Topology::TriangleList, data.pMaterial, box, false);
+                }
+                else
+                {
+                    pMesh = Mesh::create(pVBs, numVertices, pIB, numIndices, pLayout, Vao::Topology::TriangleList, data.pMaterial, box, false);
+                }
+
+                std::vector<Mesh::Lod> lods;
+                uint32_t firstIndex = numIndices;
+                for(size_t i = 0; i < data.lodChain.indexCounts.size(); i++)
+                {
+                    Mesh::Lod lod;
+                    lod.firstIndex = firstIndex;
+                    lod.indexCount = data.lodChain.indexCounts[i];
+                    lod.error = data.lodChain.errors[i];
+                    lods.push_back(lod);
+                    firstIndex += lod.indexCount;
+                }
+                pMesh->setLods(lods);
+                if(pMesh->mpBvh == nullptr)
+                {
+                    pMesh->mpBvh = data.pBvh;
+                }
 
                 if (version >= 6)
                 {
@@ -1001,6 +1214,16 @@ namespace Falcor
                 }
             }
         }
+
+        if(shouldOptimizeMeshes)
+        {
+            logInfo("Optimized meshes of " + mModelName + ": " + std::to_string(optimizerStats.triangleCount) + " triangles, ACMR " + std::to_string(optimizerStats.getAcmrBefore()) + " -> " + std::to_string(optimizerStats.getAcmrAfter()));
+        }
+
+        if(shouldDeduplicate)
+        {
+            logInfo("Deduplicated geometry of " + mModelName + ": " + deduplicator.getStatsString());
+        }
         
         return pModel;
     }
@@ -30,7 +30,7 @@
 //------------------------------------------------------------------------
 /*
 
-Binary scene file format v8
+Binary scene file format v9
 ---------------------------
 
 - The basic units of data are 32-bit little-endian ints and floats.
@@ -103,6 +103,14 @@ Submesh
 18      1       int     v5  specularTexture     (-1 if none)
 19      1       int     v1  numTriangles
 20      n*3     int     v1  indices             (numTriangles * 3)
+?       1       int     v9  numLods             (not counting the original geometry)
+?       n*?     array   v9  Lod                 (numLods)
+?
+
+Lod
+0       1       float   v9  error               (relative to the diagonal of the submesh's bounding-box)
+1       1       int     v9  numTriangles
+2       n*3     int     v9  indices             (numTriangles * 3)
 ?
 
 Instance
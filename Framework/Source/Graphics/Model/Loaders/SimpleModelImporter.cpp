@@ -38,13 +38,14 @@
 #include "API/Texture.h"
 #include "Graphics/Material/BasicMaterial.h"
 #include "glm/geometric.hpp"
+#include "../MeshOptimizer.h"
 
 namespace Falcor
 {
 
     Model::SharedPtr SimpleModelImporter::create( VertexFormat vertLayout, uint32_t vboSz, const void *vboData,
                                                   uint32_t idxBufSz, const uint32_t *idxBufData, Texture::SharedPtr diffuseTexture,
-                                                  Vao::Topology geomTopology )
+                                                  Vao::Topology geomTopology, uint32_t flags )
     {
         // Since SimpleModelImporter is all static, create an instance here to help track materials
         SimpleModelImporter modelImporter;
@@ -82,6 +83,26 @@ namespace Falcor
             vertexStride += size;
         }
 
+        // Reorder copies of the triangles and vertices
+        std::vector<uint32_t> optimizedIndices;
+        std::vector<uint8_t> optimizedVertices;
+        if ( (flags & Model::OptimizeMeshes) && geomTopology == Vao::Topology::TriangleList && vertexStride > 0 )
+        {
+            uint32_t vertexCount = vboSz / vertexStride;
+            optimizedIndices.assign( idxBufData, idxBufData + idxBufSz / sizeof( uint32_t ) );
+            optimizedVertices.assign( (const uint8_t*) vboData, (const uint8_t*) vboData + vboSz );
+
+            MeshOptimizer::Stats stats;
+            MeshOptimizer::optimizeTriangleList( optimizedIndices.data(), (uint32_t) optimizedIndices.size(), optimizedVertices.data() + positionOffset, vertexStride, vertexCount, stats );
+            std::vector<uint32_t> remap;
+            MeshOptimizer::optimizeVertexFetch( optimizedIndices.data(), (uint32_t) optimizedIndices.size(), vertexCount, remap );
+            MeshOptimizer::remapVertices( optimizedVertices.data(), vertexStride, vertexCount, remap );
+            logInfo( "Optimized mesh: " + std::to_string( stats.triangleCount ) + " triangles, ACMR " + std::to_string( stats.getAcmrBefore() ) + " -> " + std::to_string( stats.getAcmrAfter() ) );
+
+            vboData = optimizedVertices.data();
+            idxBufData = optimizedIndices.data();
+        }
+
         // Create vertex buffer and add to the model
         VertexLayout::SharedPtr pLayout = VertexLayout::create();
         pLayout->addBufferLayout(0, pVertexLayout);
@@ -121,6 +142,10 @@ namespace Falcor
 
         // create a mesh containing this index & vertex data.
         Mesh::SharedPtr pMesh = Mesh::create({ pBuffer }, numVertices, pIB, numIndicies, pLayout, geomTopology, pSimpleMaterial, box, false);
+        if ( (flags & Model::BuildBvh) && geomTopology == Vao::Topology::TriangleList )
+        {
+            pMesh->mpBvh = TriangleBvh::create( idxBufData, numIndicies, ((const uint8_t*) vboData) + positionOffset, vertexStride, numVertices );
+        }
         pModel->addMeshInstance(pMesh, glm::mat4()); // Add this mesh to the model
 
         // Do internal computations on model properties
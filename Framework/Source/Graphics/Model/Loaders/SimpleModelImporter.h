@@ -78,10 +78,12 @@ namespace Falcor
         };
 
         // Create a model made up of a number of triangles, layed out (in the index buffer) as GL_TRIANGLES
+        //     flags accepts Model::OptimizeMeshes, which reorders a copy of the index and vertex data before uploading it, and Model::BuildBvh
         static Model::SharedPtr create( VertexFormat vertLayout, uint32_t vboSz, const void *vboData, 
                                         uint32_t idxBufSz, const uint32_t *idxData, 
                                         Texture::SharedPtr diffuseTexture = nullptr,
-                                        Vao::Topology geomTopology = Vao::Topology::TriangleList );
+                                        Vao::Topology geomTopology = Vao::Topology::TriangleList,
+                                        uint32_t flags = Model::None );
 
     private:
         static ResourceFormat    getResourceFormat( AttribFormat format, uint32_t components );
@@ -89,9 +89,46 @@ namespace Falcor
 
         mPrimitiveCount = mIndexCount / VertsPerPrim;
 
+        Lod lod0;
+        lod0.indexCount = mIndexCount;
+        mLods.push_back(lod0);
+
         mpVao = Vao::create(vertexBuffers, pLayout, pIndexBuffer, ResourceFormat::R32Uint, topology);
     }
 
+    bool Mesh::moveToGeometryArena(GeometryArena* pArena)
+    {
+        if(mpArenaAllocation)
+        {
+            return true;
+        }
+
+        // The LODs follow the original indices
+        const Lod& lastLod = mLods.back();
+        mpArenaAllocation = pArena->allocate(mpVao.get(), mVertexCount, lastLod.firstIndex + lastLod.indexCount);
+        if(mpArenaAllocation == nullptr)
+        {
+            return false;
+        }
+        mpVao = nullptr;
+        return true;
+    }
+
+    void Mesh::setLods(const std::vector<Lod>& lods)
+    {
+        assert(mpArenaAllocation == nullptr);
+        mLods.resize(1);
+        for(const Lod& lod : lods)
+        {
+            if(mLods.size() == kMaxLodCount)
+            {
+                logWarning("Mesh::setLods() - too many LODs. Only the first " + std::to_string(kMaxLodCount) + " LODs are used.");
+                break;
+            }
+            mLods.push_back(lod);
+        }
+    }
+
     void Mesh::resetGlobalIdCounter()
     {
         sMeshCounter = 0;
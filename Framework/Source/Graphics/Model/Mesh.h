@@ -35,6 +35,8 @@
 #include "utils/AABB.h"
 #include "Graphics/Material/Material.h"
 #include "Graphics/Paths/MovableObject.h"
+#include "Graphics/Model/GeometryArena.h"
+#include "Utils/Picking/Bvh.h"
 
 namespace Falcor
 {
@@ -56,6 +58,17 @@ namespace Falcor
         using SharedPtr = std::shared_ptr<Mesh>;
         using SharedConstPtr = std::shared_ptr<const Mesh>;
 
+        static const uint32_t kMaxLodCount = 8;     ///< Max number of LODs, including the original geometry
+
+        /** A level of detail. All the LODs of a mesh use the same vertices and index buffer.
+        */
+        struct Lod
+        {
+            uint32_t firstIndex = 0;    ///< Location of the LOD's first index, relative to getFirstIndex()
+            uint32_t indexCount = 0;
+            float error = 0;            ///< Simplification error relative to the diagonal of the bounding-box. 0 for the original geometry.
+        };
+
         /** create a new mesh
             \param[in] VertexBuffers Vector of vertex buffer descriptors
             \param[in] VertexCount Number of vertices in the vertex buffer
@@ -92,10 +105,18 @@ namespace Falcor
         */
         uint32_t getPrimitiveCount() const { return mPrimitiveCount; }
 
-        /** Get the number of indices in the index buffer. Use this value when drawing the mesh.
+        /** Get the number of indices of the original geometry (LOD 0). Use this value when drawing the mesh.
         */
         uint32_t getIndexCount() const { return mIndexCount; }
 
+        /** Get the number of LODs, including the original geometry. The LODs are ordered from the most to the least detailed.
+        */
+        uint32_t getLodCount() const { return (uint32_t)mLods.size(); }
+
+        /** Get a LOD. LOD 0 is the original geometry.
+        */
+        const Lod& getLod(uint32_t lod) const { return mLods[lod]; }
+
         /** Get a pointer to the mesh's material
         */
         const Material::SharedPtr& getMaterial() const { return mpMaterial; }
@@ -108,14 +129,47 @@ namespace Falcor
         */
         void setMaterial(const Material::SharedPtr& pMaterial) { mpMaterial = pMaterial; }
 
-        /** Get the vertex array object matching the mesh
+        /** Get the vertex array object matching the mesh. If the mesh was moved into a geometry arena, this is the VAO shared by all meshes in the arena's pool.
+        */
+        const Vao::SharedPtr& getVao() const { return mpArenaAllocation ? mpArenaAllocation->getVao() : mpVao; }
+
+        /** Get the value which should be added to the indices when drawing. Use it as the draw call's base vertex location.
+        */
+        uint32_t getBaseVertex() const { return mpArenaAllocation ? mpArenaAllocation->getBaseVertex() : 0; }
+
+        /** Get the location of the first index in the index buffer. Use it as the draw call's start index location.
+        */
+        uint32_t getFirstIndex() const { return mpArenaAllocation ? mpArenaAllocation->getFirstIndex() : 0; }
+
+        /** Move the mesh's vertices and indices into a geometry arena and release the mesh's own buffers. Does nothing if the mesh is already in an arena.
+            \return false if the arena doesn't support the mesh's VAO, in which case the mesh keeps its buffers
         */
-        const Vao::SharedPtr& getVao() const { return mpVao; }
+        bool moveToGeometryArena(GeometryArena* pArena);
+
+        /** Check if the mesh's geometry is stored in a geometry arena
+        */
+        bool isInGeometryArena() const { return mpArenaAllocation != nullptr; }
+
+        /** Get the BVH of the original geometry (LOD 0), in object space. Only meshes loaded with Model::BuildBvh have one, otherwise this returns nullptr.
+        */
+        const TriangleBvh::SharedConstPtr& getBvh() const { return mpBvh; }
 
         /** Get global mesh ID
         */
         const uint32_t getId() const { return mId; }
 
+        /** Does the mesh use the compact vertex format? See VertexCompression.h
+        */
+        bool hasCompactVertices() const { return mHasCompactVertices; }
+
+        /** Get the scale that converts the mesh's quantized positions back to object space. Only meaningful if hasCompactVertices() returns true
+        */
+        const glm::vec3& getPositionDequantScale() const { return mPositionDequantScale; }
+
+        /** Get the offset that converts the mesh's quantized positions back to object space. Only meaningful if hasCompactVertices() returns true
+        */
+        const glm::vec3& getPositionDequantOffset() const { return mPositionDequantOffset; }
+
         /** Reset all global id counter of model, mesh and material
         */
         static void resetGlobalIdCounter();
@@ -139,13 +193,23 @@ namespace Falcor
 
         static uint32_t sMeshCounter;
 
+        /** Set the LODs following the original geometry. Their indices must be stored in the index buffer after the original indices.
+        */
+        void setLods(const std::vector<Lod>& lods);
+
         uint32_t mId;
         uint32_t mIndexCount = 0;
         uint32_t mVertexCount = 0;
         uint32_t mPrimitiveCount = 0;
         bool mHasBones = false;
+        bool mHasCompactVertices = false;
+        glm::vec3 mPositionDequantScale = glm::vec3(1);
+        glm::vec3 mPositionDequantOffset = glm::vec3(0);
         Material::SharedPtr mpMaterial;
         BoundingBox mBoundingBox;
+        std::vector<Lod> mLods;
         Vao::SharedPtr mpVao;
+        GeometryArena::Allocation::SharedPtr mpArenaAllocation;
+        TriangleBvh::SharedConstPtr mpBvh;
     };
 }
\ No newline at end of file
@@ -0,0 +1,135 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MeshDeduplicator.h"
+#include <cstring>
+#include <tuple>
+
+namespace Falcor
+{
+    // 64-bit FNV-1a
+    static uint64_t hashBytes(const void* pData, size_t size)
+    {
+        const uint8_t* pBytes = (const uint8_t*)pData;
+        uint64_t hash = 14695981039346656037ull;
+        for(size_t i = 0; i < size; i++)
+        {
+            hash ^= pBytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash ^ size;
+    }
+
+    Buffer::SharedPtr MeshDeduplicator::createBuffer(size_t size, Resource::BindFlags bindFlags, const void* pData)
+    {
+        mStats.bufferCount++;
+        uint64_t hash = hashBytes(pData, size);
+
+        // Compare the contents of every buffer with the same hash, so that a collision can't merge different geometry
+        auto range = mBuffers.equal_range(hash);
+        for(auto it = range.first; it != range.second; it++)
+        {
+            const BufferEntry& entry = it->second;
+            if(entry.bindFlags == bindFlags && entry.data.size() == size && memcmp(entry.data.data(), pData, size) == 0)
+            {
+                mStats.sharedBufferCount++;
+                mStats.savedBytes += size;
+                return entry.pBuffer;
+            }
+        }
+
+        BufferEntry entry;
+        entry.bindFlags = bindFlags;
+        entry.data.assign((const uint8_t*)pData, (const uint8_t*)pData + size);
+        entry.pBuffer = Buffer::create(size, bindFlags, Buffer::CpuAccess::None, pData);
+        Buffer::SharedPtr pBuffer = entry.pBuffer;
+        mBuffers.insert(std::make_pair(hash, std::move(entry)));
+        return pBuffer;
+    }
+
+    bool MeshDeduplicator::MeshKey::operator<(const MeshKey& other) const
+    {
+        return std::tie(vertexBuffers, pIndexBuffer, vertexCount, indexCount, layout, topology, pMaterial, hasBones) <
+            std::tie(other.vertexBuffers, other.pIndexBuffer, other.vertexCount, other.indexCount, other.layout, other.topology, other.pMaterial, other.hasBones);
+    }
+
+    Mesh::SharedPtr MeshDeduplicator::createMesh(const Vao::BufferVec& vertexBuffers, uint32_t vertexCount, const Buffer::SharedPtr& pIndexBuffer, uint32_t indexCount, const VertexLayout::SharedPtr& pLayout, Vao::Topology topology, const Material::SharedPtr& pMaterial, const BoundingBox& boundingBox, bool hasBones)
+    {
+        mStats.meshCount++;
+
+        MeshKey key;
+        for(const auto& pVB : vertexBuffers)
+        {
+            key.vertexBuffers.push_back(pVB.get());
+        }
+        key.pIndexBuffer = pIndexBuffer.get();
+        key.vertexCount = vertexCount;
+        key.indexCount = indexCount;
+        key.topology = topology;
+        key.pMaterial = pMaterial.get();
+        key.hasBones = hasBones;
+
+        // Each importer creates a layout object per mesh, so layouts are compared by value
+        for(uint32_t i = 0; i < pLayout->getBufferCount(); i++)
+        {
+            const auto& pVbLayout = pLayout->getBufferLayout(i);
+            if(pVbLayout == nullptr)
+            {
+                key.layout.push_back(uint32_t(-1));
+                continue;
+            }
+            key.layout.push_back(pVbLayout->getStride());
+            key.layout.push_back((uint32_t)pVbLayout->getInputClass());
+            for(uint32_t e = 0; e < pVbLayout->getElementCount(); e++)
+            {
+                key.layout.push_back(pVbLayout->getElementOffset(e));
+                key.layout.push_back((uint32_t)pVbLayout->getElementFormat(e));
+                key.layout.push_back(pVbLayout->getElementArraySize(e));
+                key.layout.push_back(pVbLayout->getElementShaderLocation(e));
+            }
+        }
+
+        auto it = mMeshes.find(key);
+        if(it != mMeshes.end())
+        {
+            mStats.sharedMeshCount++;
+            return it->second;
+        }
+
+        Mesh::SharedPtr pMesh = Mesh::create(vertexBuffers, vertexCount, pIndexBuffer, indexCount, pLayout, topology, pMaterial, boundingBox, hasBones);
+        mMeshes[key] = pMesh;
+        return pMesh;
+    }
+
+    std::string MeshDeduplicator::getStatsString() const
+    {
+        const float toMB = 1.0f / (1024.0f * 1024.0f);
+        return std::to_string(mStats.sharedMeshCount) + " of " + std::to_string(mStats.meshCount) + " meshes are instances, " +
+            std::to_string(mStats.sharedBufferCount) + " of " + std::to_string(mStats.bufferCount) + " buffers shared, saved " + std::to_string(mStats.savedBytes * toMB) + " MB";
+    }
+}
@@ -0,0 +1,94 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <map>
+#include <vector>
+#include "Mesh.h"
+
+namespace Falcor
+{
+    /** Collapses byte-identical geometry while a model is imported, used by the model importers when Model::DeduplicateGeometry is set.
+        Buffers are shared when their bind flags and contents match. Meshes are shared when they use the same buffers, layout, topology and material, so that a duplicate becomes another instance of the first mesh and is drawn in the same instanced batch.
+        The deduplicator keeps a CPU copy of every unique buffer to compare against, so it should only live as long as the import.
+    */
+    class MeshDeduplicator
+    {
+    public:
+        /** Deduplication statistics
+        */
+        struct Stats
+        {
+            uint32_t bufferCount = 0;       ///< Buffers requested
+            uint32_t sharedBufferCount = 0; ///< Buffers which reused an existing buffer
+            uint32_t meshCount = 0;         ///< Meshes requested
+            uint32_t sharedMeshCount = 0;   ///< Meshes which became instances of an existing mesh
+            uint64_t savedBytes = 0;        ///< Buffer memory which wasn't allocated
+        };
+
+        /** Create a buffer with CpuAccess::None, or return an existing buffer with the same bind flags and contents
+        */
+        Buffer::SharedPtr createBuffer(size_t size, Resource::BindFlags bindFlags, const void* pData);
+
+        /** Create a mesh, or return an existing mesh with the same geometry and material. Arguments are the same as Mesh::create().
+            Pass buffers returned by createBuffer(), otherwise identical geometry in different buffers won't be detected.
+        */
+        Mesh::SharedPtr createMesh(const Vao::BufferVec& vertexBuffers, uint32_t vertexCount, const Buffer::SharedPtr& pIndexBuffer, uint32_t indexCount, const VertexLayout::SharedPtr& pLayout, Vao::Topology topology, const Material::SharedPtr& pMaterial, const BoundingBox& boundingBox, bool hasBones);
+
+        const Stats& getStats() const { return mStats; }
+
+        /** Get a one-line summary of the statistics, for the log
+        */
+        std::string getStatsString() const;
+
+    private:
+        struct BufferEntry
+        {
+            Resource::BindFlags bindFlags;
+            std::vector<uint8_t> data;
+            Buffer::SharedPtr pBuffer;
+        };
+
+        struct MeshKey
+        {
+            std::vector<const Buffer*> vertexBuffers;
+            const Buffer* pIndexBuffer;
+            uint32_t vertexCount;
+            uint32_t indexCount;
+            std::vector<uint32_t> layout;   ///< Stride, class and elements of each buffer layout
+            Vao::Topology topology;
+            const Material* pMaterial;
+            bool hasBones;
+
+            bool operator<(const MeshKey& other) const;
+        };
+
+        std::multimap<uint64_t, BufferEntry> mBuffers;      ///< Keyed by a hash of the contents
+        std::map<MeshKey, Mesh::SharedPtr> mMeshes;
+        Stats mStats;
+    };
+}
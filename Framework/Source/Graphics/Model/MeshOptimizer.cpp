@@ -0,0 +1,390 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MeshOptimizer.h"
+#include "glm/geometric.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Falcor
+{
+    namespace MeshOptimizer
+    {
+        // Forsyth's scoring parameters
+        static const uint32_t kScoringCacheSize = 32;
+        static const float kLastTriangleScore = 0.75f;
+        static const float kCacheDecayPower = 1.5f;
+        static const float kValenceBoostScale = 2.0f;
+        static const float kValenceBoostPower = 0.5f;
+
+        static float getVertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+        {
+            if(remainingTriangles == 0)
+            {
+                return -1.0f;
+            }
+
+            float score = 0;
+            if(cachePosition >= 0)
+            {
+                if(cachePosition < 3)
+                {
+                    // The vertices of the last triangle get a fixed score, so that the next triangle doesn't just reuse 2 of them
+                    score = kLastTriangleScore;
+                }
+                else
+                {
+                    float scale = 1.0f / (float)(kScoringCacheSize - 3);
+                    score = powf(1.0f - (float)(cachePosition - 3) * scale, kCacheDecayPower);
+                }
+            }
+
+            // Boost vertices with few remaining triangles, to finish them off and avoid leaving single triangles behind
+            score += kValenceBoostScale * powf((float)remainingTriangles, -kValenceBoostPower);
+            return score;
+        }
+
+        uint32_t countCacheMisses(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+        {
+            // A vertex is in the cache if it was inserted less than cacheSize insertions ago
+            std::vector<uint32_t> timestamps(vertexCount, 0);
+            uint32_t time = cacheSize + 1;
+            uint32_t misses = 0;
+            for(uint32_t i = 0; i < indexCount; i++)
+            {
+                uint32_t v = pIndices[i];
+                if(time - timestamps[v] > cacheSize)
+                {
+                    timestamps[v] = time++;
+                    misses++;
+                }
+            }
+            return misses;
+        }
+
+        float calculateAcmr(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+        {
+            uint32_t triangleCount = indexCount / 3;
+            return triangleCount ? (float)countCacheMisses(pIndices, indexCount, vertexCount, cacheSize) / (float)triangleCount : 0;
+        }
+
+        void optimizeVertexCache(uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount)
+        {
+            const uint32_t triangleCount = indexCount / 3;
+            if(triangleCount == 0)
+            {
+                return;
+            }
+
+            // Vertex to triangle adjacency. The active triangles of vertex v are adjacency[offsets[v], offsets[v] + remaining[v])
+            std::vector<uint32_t> remaining(vertexCount, 0);
+            for(uint32_t i = 0; i < triangleCount * 3; i++)
+            {
+                remaining[pIndices[i]]++;
+            }
+
+            std::vector<uint32_t> offsets(vertexCount + 1, 0);
+            for(uint32_t v = 0; v < vertexCount; v++)
+            {
+                offsets[v + 1] = offsets[v] + remaining[v];
+            }
+
+            std::vector<uint32_t> adjacency(triangleCount * 3);
+            {
+                std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+                for(uint32_t i = 0; i < triangleCount * 3; i++)
+                {
+                    adjacency[cursor[pIndices[i]]++] = i / 3;
+                }
+            }
+
+            std::vector<int32_t> cachePosition(vertexCount, -1);
+            std::vector<float> vertexScore(vertexCount);
+            for(uint32_t v = 0; v < vertexCount; v++)
+            {
+                vertexScore[v] = getVertexScore(-1, remaining[v]);
+            }
+
+            auto getTriangleScore = [&](uint32_t t)
+            {
+                return vertexScore[pIndices[t * 3]] + vertexScore[pIndices[t * 3 + 1]] + vertexScore[pIndices[t * 3 + 2]];
+            };
+
+            std::vector<bool> emitted(triangleCount, false);
+            std::vector<uint32_t> output(triangleCount * 3);
+            std::vector<uint32_t> cache;
+            std::vector<uint32_t> newCache;
+            cache.reserve(kScoringCacheSize + 3);
+            newCache.reserve(kScoringCacheSize + 3);
+
+            // Start with the best triangle overall
+            int64_t bestTriangle = 0;
+            float bestScore = -FLT_MAX;
+            for(uint32_t t = 0; t < triangleCount; t++)
+            {
+                float score = getTriangleScore(t);
+                if(score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+
+            uint32_t scanCursor = 0;
+            for(uint32_t outTriangle = 0; outTriangle < triangleCount; outTriangle++)
+            {
+                // No candidates in the cache. Continue with the next triangle in the input order
+                if(bestTriangle < 0)
+                {
+                    while(emitted[scanCursor])
+                    {
+                        scanCursor++;
+                    }
+                    bestTriangle = scanCursor;
+                }
+
+                const uint32_t t = (uint32_t)bestTriangle;
+                const uint32_t* pTriangle = &pIndices[t * 3];
+                emitted[t] = true;
+                memcpy(&output[outTriangle * 3], pTriangle, sizeof(uint32_t) * 3);
+
+                // Remove the triangle from the adjacency lists
+                for(uint32_t i = 0; i < 3; i++)
+                {
+                    uint32_t v = pTriangle[i];
+                    uint32_t* pBegin = &adjacency[offsets[v]];
+                    uint32_t* pEnd = pBegin + remaining[v];
+                    uint32_t* pFound = std::find(pBegin, pEnd, t);
+                    assert(pFound != pEnd);
+                    *pFound = *(pEnd - 1);
+                    remaining[v]--;
+                }
+
+                // Move the triangle's vertices to the front of the LRU cache
+                newCache.clear();
+                for(uint32_t i = 0; i < 3; i++)
+                {
+                    if(std::find(newCache.begin(), newCache.end(), pTriangle[i]) == newCache.end())
+                    {
+                        newCache.push_back(pTriangle[i]);
+                    }
+                }
+                for(uint32_t v : cache)
+                {
+                    if(v != pTriangle[0] && v != pTriangle[1] && v != pTriangle[2])
+                    {
+                        newCache.push_back(v);
+                    }
+                }
+
+                // Update the scores of the vertices in the cache, including the ones which were just evicted
+                for(uint32_t i = 0; i < (uint32_t)newCache.size(); i++)
+                {
+                    uint32_t v = newCache[i];
+                    cachePosition[v] = (i < kScoringCacheSize) ? (int32_t)i : -1;
+                    vertexScore[v] = getVertexScore(cachePosition[v], remaining[v]);
+                }
+
+                // The next triangle is the best one which uses a cached vertex
+                bestTriangle = -1;
+                bestScore = -FLT_MAX;
+                const uint32_t cachedCount = std::min((uint32_t)newCache.size(), kScoringCacheSize);
+                for(uint32_t i = 0; i < cachedCount; i++)
+                {
+                    uint32_t v = newCache[i];
+                    for(uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+                    {
+                        float score = getTriangleScore(adjacency[a]);
+                        if(score > bestScore)
+                        {
+                            bestScore = score;
+                            bestTriangle = adjacency[a];
+                        }
+                    }
+                }
+
+                newCache.resize(cachedCount);
+                cache.swap(newCache);
+            }
+
+            memcpy(pIndices, output.data(), sizeof(uint32_t) * triangleCount * 3);
+        }
+
+        void optimizeOverdraw(uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount, float threshold)
+        {
+            const uint32_t triangleCount = indexCount / 3;
+            if(triangleCount == 0)
+            {
+                return;
+            }
+
+            const uint32_t inputMisses = countCacheMisses(pIndices, triangleCount * 3, vertexCount);
+            const float inputAcmr = (float)inputMisses / (float)triangleCount;
+
+            // Split into clusters. A cluster can end before a triangle whose vertices all miss the cache, if its own ACMR is within the threshold.
+            std::vector<uint32_t> clusterStarts;
+            {
+                std::vector<uint32_t> timestamps(vertexCount, 0);
+                uint32_t time = kDefaultCacheSize + 1;
+                uint32_t clusterMisses = 0;
+                uint32_t clusterStart = 0;
+                clusterStarts.push_back(0);
+                for(uint32_t t = 0; t < triangleCount; t++)
+                {
+                    uint32_t misses = 0;
+                    for(uint32_t i = 0; i < 3; i++)
+                    {
+                        uint32_t v = pIndices[t * 3 + i];
+                        if(time - timestamps[v] > kDefaultCacheSize)
+                        {
+                            timestamps[v] = time++;
+                            misses++;
+                        }
+                    }
+
+                    if(misses == 3 && t > clusterStart && (float)clusterMisses <= inputAcmr * threshold * (float)(t - clusterStart))
+                    {
+                        clusterStarts.push_back(t);
+                        clusterStart = t;
+                        clusterMisses = 0;
+                    }
+                    clusterMisses += misses;
+                }
+            }
+
+            if(clusterStarts.size() == 1)
+            {
+                return;
+            }
+
+            auto getPosition = [&](uint32_t v)
+            {
+                const float* p = (const float*)((const uint8_t*)pPositions + (size_t)v * positionStride);
+                return glm::vec3(p[0], p[1], p[2]);
+            };
+
+            // Area-weighted centroid and average normal of each cluster
+            const uint32_t clusterCount = (uint32_t)clusterStarts.size();
+            std::vector<glm::vec3> clusterCentroid(clusterCount, glm::vec3(0));
+            std::vector<glm::vec3> clusterNormal(clusterCount, glm::vec3(0));
+            glm::vec3 meshCentroid(0);
+            float meshArea = 0;
+            for(uint32_t c = 0; c < clusterCount; c++)
+            {
+                uint32_t end = (c + 1 < clusterCount) ? clusterStarts[c + 1] : triangleCount;
+                float clusterArea = 0;
+                for(uint32_t t = clusterStarts[c]; t < end; t++)
+                {
+                    glm::vec3 p0 = getPosition(pIndices[t * 3]);
+                    glm::vec3 p1 = getPosition(pIndices[t * 3 + 1]);
+                    glm::vec3 p2 = getPosition(pIndices[t * 3 + 2]);
+                    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                    float area = glm::length(normal);
+                    clusterCentroid[c] += (p0 + p1 + p2) * (area / 3.0f);
+                    clusterNormal[c] += normal;
+                    clusterArea += area;
+                }
+                meshCentroid += clusterCentroid[c];
+                meshArea += clusterArea;
+                clusterCentroid[c] = (clusterArea > 0) ? clusterCentroid[c] / clusterArea : getPosition(pIndices[clusterStarts[c] * 3]);
+            }
+            meshCentroid = (meshArea > 0) ? meshCentroid / meshArea : glm::vec3(0);
+
+            // Clusters which face away from the center are more likely to occlude the rest of the mesh, so they are drawn first
+            std::vector<float> sortKey(clusterCount);
+            for(uint32_t c = 0; c < clusterCount; c++)
+            {
+                float length = glm::length(clusterNormal[c]);
+                sortKey[c] = (length > 0) ? glm::dot(clusterCentroid[c] - meshCentroid, clusterNormal[c] / length) : 0;
+            }
+
+            std::vector<uint32_t> order(clusterCount);
+            for(uint32_t c = 0; c < clusterCount; c++)
+            {
+                order[c] = c;
+            }
+            std::stable_sort(order.begin(), order.end(), [&sortKey](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+            std::vector<uint32_t> output;
+            output.reserve(triangleCount * 3);
+            for(uint32_t c : order)
+            {
+                uint32_t end = (c + 1 < clusterCount) ? clusterStarts[c + 1] : triangleCount;
+                output.insert(output.end(), pIndices + clusterStarts[c] * 3, pIndices + end * 3);
+            }
+
+            if((float)countCacheMisses(output.data(), triangleCount * 3, vertexCount) <= (float)inputMisses * threshold)
+            {
+                memcpy(pIndices, output.data(), sizeof(uint32_t) * triangleCount * 3);
+            }
+        }
+
+        uint32_t optimizeVertexFetch(uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, std::vector<uint32_t>& remap)
+        {
+            remap.assign(vertexCount, UINT32_MAX);
+            uint32_t nextVertex = 0;
+            for(uint32_t i = 0; i < indexCount; i++)
+            {
+                uint32_t& index = pIndices[i];
+                if(remap[index] == UINT32_MAX)
+                {
+                    remap[index] = nextVertex++;
+                }
+                index = remap[index];
+            }
+
+            const uint32_t referencedCount = nextVertex;
+            for(uint32_t v = 0; v < vertexCount; v++)
+            {
+                if(remap[v] == UINT32_MAX)
+                {
+                    remap[v] = nextVertex++;
+                }
+            }
+            return referencedCount;
+        }
+
+        void remapVertices(void* pVertices, uint32_t stride, uint32_t vertexCount, const std::vector<uint32_t>& remap)
+        {
+            std::vector<uint8_t> source((uint8_t*)pVertices, (uint8_t*)pVertices + (size_t)stride * vertexCount);
+            for(uint32_t v = 0; v < vertexCount; v++)
+            {
+                memcpy((uint8_t*)pVertices + (size_t)remap[v] * stride, source.data() + (size_t)v * stride, stride);
+            }
+        }
+
+        void optimizeTriangleList(uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount, Stats& stats)
+        {
+            stats.triangleCount += indexCount / 3;
+            stats.missesBefore += countCacheMisses(pIndices, indexCount, vertexCount);
+            optimizeVertexCache(pIndices, indexCount, vertexCount);
+            optimizeOverdraw(pIndices, indexCount, pPositions, positionStride, vertexCount);
+            stats.missesAfter += countCacheMisses(pIndices, indexCount, vertexCount);
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+
+namespace Falcor
+{
+    /** Index and vertex reordering for triangle lists, used by the model importers when Model::OptimizeMeshes is set.
+        The usual order is optimizeVertexCache(), optimizeOverdraw() and then optimizeVertexFetch(). optimizeTriangleList() runs the first two.
+    */
+    namespace MeshOptimizer
+    {
+        static const uint32_t kDefaultCacheSize = 16;      ///< FIFO size used to measure the ACMR
+
+        /** Vertex cache statistics, accumulated over meshes
+        */
+        struct Stats
+        {
+            uint64_t triangleCount = 0;
+            uint64_t missesBefore = 0;      ///< Transformed vertices before optimizing
+            uint64_t missesAfter = 0;       ///< Transformed vertices after optimizing
+
+            float getAcmrBefore() const { return triangleCount ? (float)missesBefore / (float)triangleCount : 0; }
+            float getAcmrAfter() const { return triangleCount ? (float)missesAfter / (float)triangleCount : 0; }
+
+            Stats& operator+=(const Stats& other)
+            {
+                triangleCount += other.triangleCount;
+                missesBefore += other.missesBefore;
+                missesAfter += other.missesAfter;
+                return *this;
+            }
+        };
+
+        /** Count the vertices a FIFO post-transform cache has to transform when drawing a triangle list
+        */
+        uint32_t countCacheMisses(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = kDefaultCacheSize);
+
+        /** Get the average cache miss ratio (transformed vertices per triangle) of a triangle list. 0.5 is the best possible value on a regular grid, 3 is the worst.
+        */
+        float calculateAcmr(const uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = kDefaultCacheSize);
+
+        /** Reorder the triangles to reduce post-transform vertex cache misses, using Forsyth's linear-speed algorithm
+        */
+        void optimizeVertexCache(uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount);
+
+        /** Reorder clusters of triangles so that outward-facing clusters are drawn first, which reduces overdraw from any direction.
+            Clusters are split where the vertex cache is cold, so the input should be the output of optimizeVertexCache(). The new order is rejected if it raises the ACMR above threshold times the input ACMR.
+            \param[in] pPositions Vertex positions, 3 floats each
+            \param[in] positionStride The distance in bytes between two positions
+            \param[in] threshold The allowed ACMR increase
+        */
+        void optimizeOverdraw(uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount, float threshold = 1.05f);
+
+        /** Reorder the vertices in the order the index buffer references them, and rewrite the indices.
+            Unreferenced vertices are moved to the end, so the remap table is a permutation.
+            \param[out] remap Maps old vertex indices to new ones
+            \return The number of referenced vertices
+        */
+        uint32_t optimizeVertexFetch(uint32_t* pIndices, uint32_t indexCount, uint32_t vertexCount, std::vector<uint32_t>& remap);
+
+        /** Apply a remap table returned by optimizeVertexFetch() to a vertex stream
+            \param[in,out] pVertices The vertex stream
+            \param[in] stride The size of each vertex in bytes
+        */
+        void remapVertices(void* pVertices, uint32_t stride, uint32_t vertexCount, const std::vector<uint32_t>& remap);
+
+        /** Run optimizeVertexCache() and optimizeOverdraw() on a triangle list and update the statistics. Vertices are not touched.
+        */
+        void optimizeTriangleList(uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount, Stats& stats);
+    }
+}
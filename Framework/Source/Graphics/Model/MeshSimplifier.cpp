@@ -0,0 +1,359 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MeshSimplifier.h"
+#include "glm/geometric.hpp"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+namespace Falcor
+{
+    namespace MeshSimplifier
+    {
+        static const float kMinNormalCos = 0.25f;      ///< Collapses which rotate a triangle's normal further are rejected
+
+        /** Symmetric 4x4 matrix measuring the squared distance of a point from a set of planes
+        */
+        struct Quadric
+        {
+            double a2 = 0, ab = 0, ac = 0, ad = 0;
+            double b2 = 0, bc = 0, bd = 0;
+            double c2 = 0, cd = 0;
+            double d2 = 0;
+
+            static Quadric fromPlane(const glm::vec3& n, float d)
+            {
+                Quadric q;
+                q.a2 = n.x * n.x; q.ab = n.x * n.y; q.ac = n.x * n.z; q.ad = n.x * d;
+                q.b2 = n.y * n.y; q.bc = n.y * n.z; q.bd = n.y * d;
+                q.c2 = n.z * n.z; q.cd = n.z * d;
+                q.d2 = (double)d * d;
+                return q;
+            }
+
+            Quadric& operator+=(const Quadric& o)
+            {
+                a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+                b2 += o.b2; bc += o.bc; bd += o.bd;
+                c2 += o.c2; cd += o.cd;
+                d2 += o.d2;
+                return *this;
+            }
+
+            double evaluate(const glm::vec3& p) const
+            {
+                double x = p.x, y = p.y, z = p.z;
+                double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                    + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                    + c2 * z * z + 2 * cd * z
+                    + d2;
+                return std::max(e, 0.0);
+            }
+        };
+
+        /** Collapse candidate. Versions detect candidates which became stale after one of the vertices changed.
+        */
+        struct Collapse
+        {
+            double cost;
+            uint32_t from;
+            uint32_t to;
+            uint32_t fromVersion;
+            uint32_t toVersion;
+            bool operator>(const Collapse& o) const { return cost > o.cost; }
+        };
+
+        /** Edge-collapse state of one triangle list. collapseTo() can be called repeatedly with decreasing targets.
+        */
+        class Simplifier
+        {
+        public:
+            Simplifier(const uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount);
+            void collapseTo(uint32_t targetTriangleCount);
+            void getIndices(std::vector<uint32_t>& indices) const;
+            uint32_t getTriangleCount() const { return mTriangleCount; }
+            float getError() const { return (float)sqrt(mMaxCost); }
+            float getDiagonal() const { return mDiagonal; }
+
+        private:
+            glm::vec3 getNormal(const uint32_t* pTriangle, uint32_t replaced, const glm::vec3& replacement) const;
+            void pushCandidates(uint32_t v, uint32_t minNeighbor);
+            bool tryCollapse(const Collapse& c);
+
+            std::vector<glm::vec3> mPositions;
+            std::vector<uint32_t> mIndices;
+            std::vector<bool> mTriangleAlive;
+            std::vector<std::vector<uint32_t>> mVertexTriangles;
+            std::vector<Quadric> mQuadrics;
+            std::vector<bool> mLocked;
+            std::vector<uint32_t> mVersions;
+            std::vector<uint32_t> mNeighbors;  ///< Scratch space of pushCandidates()
+            std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> mCandidates;
+            uint32_t mTriangleCount = 0;
+            double mMaxCost = 0;
+            float mDiagonal = 0;
+        };
+
+        Simplifier::Simplifier(const uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount)
+            : mIndices(pIndices, pIndices + indexCount), mTriangleAlive(indexCount / 3, true), mVertexTriangles(vertexCount), mQuadrics(vertexCount), mLocked(vertexCount, false), mVersions(vertexCount, 0)
+        {
+            mTriangleCount = indexCount / 3;
+            mPositions.resize(vertexCount);
+            for(uint32_t i = 0; i < vertexCount; i++)
+            {
+                mPositions[i] = *(const glm::vec3*)((const uint8_t*)pPositions + (size_t)i * positionStride);
+            }
+
+            glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+            std::unordered_map<uint64_t, uint32_t> edgeUse;
+            for(uint32_t t = 0; t < mTriangleCount; t++)
+            {
+                const uint32_t* pTriangle = &mIndices[t * 3];
+                glm::vec3 n = getNormal(pTriangle, uint32_t(-1), glm::vec3());
+                float length = glm::length(n);
+                n = (length > 0) ? n / length : n;
+                Quadric q = Quadric::fromPlane(n, -glm::dot(n, mPositions[pTriangle[0]]));
+
+                for(uint32_t i = 0; i < 3; i++)
+                {
+                    uint32_t v = pTriangle[i];
+                    mQuadrics[v] += q;
+                    mVertexTriangles[v].push_back(t);
+                    boxMin = glm::min(boxMin, mPositions[v]);
+                    boxMax = glm::max(boxMax, mPositions[v]);
+
+                    uint32_t w = pTriangle[(i + 1) % 3];
+                    uint64_t key = ((uint64_t)std::min(v, w) << 32) | std::max(v, w);
+                    edgeUse[key]++;
+                }
+            }
+            mDiagonal = (mTriangleCount > 0) ? glm::length(boxMax - boxMin) : 0;
+
+            // Vertices on open or non-manifold edges stay in place
+            for(const auto& e : edgeUse)
+            {
+                if(e.second != 2)
+                {
+                    mLocked[e.first >> 32] = true;
+                    mLocked[e.first & 0xffffffff] = true;
+                }
+            }
+
+            // Push each edge once
+            for(uint32_t v = 0; v < vertexCount; v++)
+            {
+                pushCandidates(v, v + 1);
+            }
+        }
+
+        glm::vec3 Simplifier::getNormal(const uint32_t* pTriangle, uint32_t replaced, const glm::vec3& replacement) const
+        {
+            glm::vec3 p[3];
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                p[i] = (pTriangle[i] == replaced) ? replacement : mPositions[pTriangle[i]];
+            }
+            return glm::cross(p[1] - p[0], p[2] - p[0]);
+        }
+
+        void Simplifier::pushCandidates(uint32_t v, uint32_t minNeighbor)
+        {
+            // Drop the removed triangles while walking the neighbors
+            auto& triangles = mVertexTriangles[v];
+            triangles.erase(std::remove_if(triangles.begin(), triangles.end(), [this](uint32_t t) { return mTriangleAlive[t] == false; }), triangles.end());
+
+            // Most edges are shared by 2 triangles
+            mNeighbors.clear();
+            for(uint32_t t : triangles)
+            {
+                for(uint32_t i = 0; i < 3; i++)
+                {
+                    uint32_t w = mIndices[t * 3 + i];
+                    if((w != v) && (w >= minNeighbor))
+                    {
+                        mNeighbors.push_back(w);
+                    }
+                }
+            }
+            std::sort(mNeighbors.begin(), mNeighbors.end());
+            mNeighbors.erase(std::unique(mNeighbors.begin(), mNeighbors.end()), mNeighbors.end());
+
+            for(uint32_t w : mNeighbors)
+            {
+                Quadric q = mQuadrics[v];
+                q += mQuadrics[w];
+                if(mLocked[v] == false)
+                {
+                    mCandidates.push({q.evaluate(mPositions[w]), v, w, mVersions[v], mVersions[w]});
+                }
+                if(mLocked[w] == false)
+                {
+                    mCandidates.push({q.evaluate(mPositions[v]), w, v, mVersions[w], mVersions[v]});
+                }
+            }
+        }
+
+        bool Simplifier::tryCollapse(const Collapse& c)
+        {
+            if((mVersions[c.from] != c.fromVersion) || (mVersions[c.to] != c.toVersion))
+            {
+                return false;
+            }
+
+            // Reject collapses which flip or fold a remaining triangle. The normals are compared against a threshold, since many small rotations add up to a flip.
+            const glm::vec3& target = mPositions[c.to];
+            bool isNeighbor = false;
+            for(uint32_t t : mVertexTriangles[c.from])
+            {
+                if(mTriangleAlive[t] == false)
+                {
+                    continue;
+                }
+
+                const uint32_t* pTriangle = &mIndices[t * 3];
+                if(pTriangle[0] == c.to || pTriangle[1] == c.to || pTriangle[2] == c.to)
+                {
+                    isNeighbor = true;
+                    continue;
+                }
+
+                glm::vec3 before = getNormal(pTriangle, uint32_t(-1), glm::vec3());
+                glm::vec3 after = getNormal(pTriangle, c.from, target);
+                float lengths = glm::length(before) * glm::length(after);
+                if((lengths <= 0) || (glm::dot(before, after) < kMinNormalCos * lengths))
+                {
+                    return false;
+                }
+            }
+
+            if(isNeighbor == false)
+            {
+                return false;
+            }
+
+            // Remove the triangles on the edge and move the rest to the target vertex
+            for(uint32_t t : mVertexTriangles[c.from])
+            {
+                if(mTriangleAlive[t] == false)
+                {
+                    continue;
+                }
+
+                uint32_t* pTriangle = &mIndices[t * 3];
+                if(pTriangle[0] == c.to || pTriangle[1] == c.to || pTriangle[2] == c.to)
+                {
+                    mTriangleAlive[t] = false;
+                    mTriangleCount--;
+                }
+                else
+                {
+                    for(uint32_t i = 0; i < 3; i++)
+                    {
+                        pTriangle[i] = (pTriangle[i] == c.from) ? c.to : pTriangle[i];
+                    }
+                    mVertexTriangles[c.to].push_back(t);
+                }
+            }
+
+            mVertexTriangles[c.from].clear();
+            mQuadrics[c.to] += mQuadrics[c.from];
+            mVersions[c.from]++;
+            mVersions[c.to]++;
+            mMaxCost = std::max(mMaxCost, c.cost);
+            pushCandidates(c.to, 0);
+            return true;
+        }
+
+        void Simplifier::collapseTo(uint32_t targetTriangleCount)
+        {
+            while((mTriangleCount > targetTriangleCount) && (mCandidates.empty() == false))
+            {
+                Collapse c = mCandidates.top();
+                mCandidates.pop();
+                tryCollapse(c);
+            }
+        }
+
+        void Simplifier::getIndices(std::vector<uint32_t>& indices) const
+        {
+            // Keep the input order, which was optimized for the vertex cache
+            for(uint32_t t = 0; t < (uint32_t)mTriangleAlive.size(); t++)
+            {
+                if(mTriangleAlive[t])
+                {
+                    indices.insert(indices.end(), &mIndices[t * 3], &mIndices[t * 3] + 3);
+                }
+            }
+        }
+
+        float simplify(const uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount, uint32_t targetIndexCount, std::vector<uint32_t>& result)
+        {
+            Simplifier simplifier(pIndices, indexCount, pPositions, positionStride, vertexCount);
+            simplifier.collapseTo(targetIndexCount / 3);
+            result.clear();
+            simplifier.getIndices(result);
+            return simplifier.getError();
+        }
+
+        void generateLodChain(const uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount, LodChain& chain)
+        {
+            chain = LodChain();
+            if(indexCount / 3 < kMinLodTriangles)
+            {
+                return;
+            }
+
+            Simplifier simplifier(pIndices, indexCount, pPositions, positionStride, vertexCount);
+            if(simplifier.getDiagonal() <= 0)
+            {
+                return;
+            }
+
+            uint32_t triangleCount = indexCount / 3;
+            for(uint32_t lod = 0; lod < kMaxLodCount && triangleCount >= kMinLodTriangles; lod++)
+            {
+                simplifier.collapseTo(triangleCount / 2);
+
+                // Stop once the locked vertices keep most of the triangles alive
+                uint32_t newCount = simplifier.getTriangleCount();
+                if((newCount == 0) || (newCount > triangleCount * 3 / 4))
+                {
+                    break;
+                }
+
+                size_t first = chain.indices.size();
+                simplifier.getIndices(chain.indices);
+                chain.indexCounts.push_back((uint32_t)(chain.indices.size() - first));
+                chain.errors.push_back(simplifier.getError() / simplifier.getDiagonal());
+                triangleCount = newCount;
+            }
+        }
+    }
+}
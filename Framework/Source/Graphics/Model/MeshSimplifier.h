@@ -0,0 +1,65 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+
+namespace Falcor
+{
+    /** Quadric-error simplification of triangle lists, used by the model importers when Model::GenerateLods is set.
+        Triangles are removed with half-edge collapses, which move a vertex onto one of its neighbors, so every LOD indexes the mesh's original vertex buffer.
+        Vertices on open edges are never moved. This keeps UV seams and mesh borders intact, but meshes with many seams simplify less.
+    */
+    namespace MeshSimplifier
+    {
+        static const uint32_t kMaxLodCount = 4;         ///< Max number of LODs generateLodChain() creates, not counting the original geometry
+        static const uint32_t kMinLodTriangles = 32;    ///< generateLodChain() doesn't simplify meshes below this triangle count
+
+        /** The simplified LODs of a triangle list
+        */
+        struct LodChain
+        {
+            std::vector<uint32_t> indices;      ///< The indices of all the LODs, one LOD after the other
+            std::vector<uint32_t> indexCounts;  ///< Number of indices of each LOD
+            std::vector<float> errors;          ///< Simplification error of each LOD, relative to the diagonal of the mesh's bounding-box. Increases with the LOD.
+        };
+
+        /** Simplify a triangle list
+            \param[in] pPositions Vertex positions, 3 floats each
+            \param[in] positionStride The distance in bytes between two positions
+            \param[in] targetIndexCount Stop once the result has this many indices or less
+            \param[out] result The indices of the simplified triangle list
+            \return The simplification error, in object-space units
+        */
+        float simplify(const uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount, uint32_t targetIndexCount, std::vector<uint32_t>& result);
+
+        /** Generate up to kMaxLodCount LODs, each with about half the triangles of the previous one. The chain ends early once simplification stops making progress.
+            Each LOD continues from the previous one, so the errors are measured against the original geometry.
+        */
+        void generateLodChain(const uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount, LodChain& chain);
+    }
+}
@@ -41,6 +41,7 @@
 #include "Utils/StringUtils.h"
 #include "Graphics/Camera/Camera.h"
 #include "API/VAO.h"
+#include "Utils/ThreadPool.h"
 #include <set>
 
 namespace Falcor
@@ -79,25 +80,106 @@ namespace Falcor
 
         if(pModel)
         {
-            pModel->calculateModelProperties();
+            pModel->finalizeLoadedModel(flags);
         }
 
         return pModel;
     }
 
+    void Model::finalizeLoadedModel(uint32_t flags)
+    {
+        if(flags & UseGeometryArena)
+        {
+            moveToGeometryArena(GeometryArena::getGlobalArena().get());
+        }
+        calculateModelProperties();
+    }
+
+    struct Model::AsyncLoad
+    {
+        std::string filename;
+        uint32_t flags = 0;
+        bool isBinary = false;
+        std::future<std::shared_ptr<AssimpModelImporter::ParsedFile>> parsed;   ///< Valid until the parsing is done. Not used for binary models.
+        std::shared_ptr<AssimpModelImporter::ParsedFile> pParsed;               ///< Kept to create more models from the same file
+        bool isDone = false;
+        Model::SharedPtr pModel;
+    };
+
+    static std::shared_ptr<AssimpModelImporter::ParsedFile> waitForParsedFile(Model::AsyncLoad* pLoad)
+    {
+        if(pLoad->parsed.valid())
+        {
+            // Create the textures other loads already decoded while waiting for the file
+            while(pLoad->parsed.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready)
+            {
+                createPendingTextures();
+            }
+            pLoad->pParsed = pLoad->parsed.get();
+        }
+        return pLoad->pParsed;
+    }
+
+    Model::LoadHandle Model::createFromFileAsync(const std::string& filename, uint32_t flags)
+    {
+        LoadHandle pLoad = std::make_shared<AsyncLoad>();
+        pLoad->filename = filename;
+        pLoad->flags = flags;
+        pLoad->isBinary = hasSuffix(filename, ".bin", false);
+
+        if(pLoad->isBinary == false)
+        {
+            pLoad->parsed = ThreadPool::instance()->submit([filename, flags]() { return AssimpModelImporter::parseFile(filename, flags); });
+        }
+        return pLoad;
+    }
+
+    Model::SharedPtr Model::waitForModel(const LoadHandle& handle)
+    {
+        if(handle->isDone == false)
+        {
+            handle->pModel = createFromLoad(handle);
+            handle->isDone = true;
+        }
+        return handle->pModel;
+    }
+
+    Model::SharedPtr Model::createFromLoad(const LoadHandle& handle)
+    {
+        Model::SharedPtr pModel;
+        if(handle->isBinary)
+        {
+            pModel = BinaryModelImporter::createFromFile(handle->filename, handle->flags);
+        }
+        else
+        {
+            auto pParsed = waitForParsedFile(handle.get());
+            if(pParsed)
+            {
+                pModel = AssimpModelImporter::createFromParsedFile(handle->filename, pParsed.get(), handle->flags);
+            }
+        }
+
+        if(pModel)
+        {
+            pModel->finalizeLoadedModel(handle->flags);
+        }
+        return pModel;
+    }
+
     Model::SharedPtr Model::create()
     {
         return SharedPtr(new Model());
     }
 
-    void Model::exportToBinaryFile(const std::string& filename)
+    void Model::exportToBinaryFile(const std::string& filename, TextureBaker::Stats* pBakeStats)
     {
         if(hasSuffix(filename, ".bin", false) == false)
         {
             logWarning("Exporting model to binary file, but extension is not '.bin'. This will cause error when loading the file");
         }
 
-        BinaryModelExporter::exportToFile(filename, this);
+        BinaryModelExporter::exportToFile(filename, this, pBakeStats);
     }
 
     void Model::calculateModelProperties()
@@ -265,6 +347,12 @@ namespace Falcor
 
     void Model::addMeshInstance(const Mesh::SharedPtr& pMesh, const glm::mat4& baseTransform)
     {
+        MeshInstance::SharedPtr pInstance = MeshInstance::create(pMesh, baseTransform);
+        if (pInstance == nullptr)
+        {
+            return;
+        }
+
         int32_t meshID = -1;
 
         // Linear search from the end. Instances are usually added in order by mesh
@@ -284,7 +372,7 @@ namespace Falcor
             meshID = (int32_t)mMeshes.size() - 1;
         }
 
-        mMeshes[meshID].push_back(MeshInstance::create(pMesh, baseTransform));
+        mMeshes[meshID].push_back(pInstance);
     }
 
     void Model::sortMeshes()
@@ -313,7 +401,7 @@ namespace Falcor
             if (pCamera->isObjectCulled(instance->getBoundingBox()))
             {
                 // Remove mesh ptr reference
-                instance->mpObject = nullptr;
+                instance->resetObject();
             }
         }
 
@@ -353,6 +441,18 @@ namespace Falcor
         mMeshes.erase(meshesEnd, mMeshes.end());
 
         calculateModelProperties();
+
+        // Close the holes the deleted meshes left in the arena
+        GeometryArena::getGlobalArena()->defragment();
+    }
+
+    void Model::moveToGeometryArena(GeometryArena* pArena)
+    {
+        for(auto& meshInstances : mMeshes)
+        {
+            meshInstances[0]->getObject()->moveToGeometryArena(pArena);
+        }
+        logInfo("Moved " + mFilename + " into the geometry arena: " + pArena->getStatsString());
     }
 
     void Model::resetGlobalIdCounter()
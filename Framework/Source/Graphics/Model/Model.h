@@ -35,6 +35,7 @@
 #include "Graphics/Model/ObjectInstance.h"
 #include "API/Sampler.h"
 #include "Graphics/Model/AnimationController.h"
+#include "Graphics/TextureBaker.h"
 
 namespace Falcor
 {
@@ -64,12 +65,40 @@ namespace Falcor
             FindDegeneratePrimitives    = 2,    ///< Replace degenerate triangles/lines with lines/points. This can create a meshes with topology that wasn't present in the original model.
             AssumeLinearSpaceTextures   = 4,    ///< By default, textures representing colors (diffuse/specular) are interpreted as sRGB data. Use this flag to force linear space for color textures.
             DontMergeMeshes             = 8,   ///< Preserve the original list of meshes in the scene, don't merge meshes with the same material
+            OptimizeMeshes              = 16,   ///< Reorder triangles for the post-transform vertex cache and for overdraw, and vertices for fetch locality. The ACMR before and after is written to the log.
+            CompactVertices             = 32,   ///< Store vertices in the compact format (quantized positions, octahedral normals, half-float texture coordinates, 8-bit colors). See VertexCompression.h. Only supported by the ASSIMP importer.
+            DeduplicateGeometry         = 64,   ///< Share vertex/index buffers with identical contents, and turn meshes with identical geometry and material into instances of a single mesh. The memory saved is written to the log.
+            UseGeometryArena            = 128,  ///< Move the vertices and indices into the global geometry arena (see GeometryArena), so that meshes with the same vertex layout share buffers and a VAO. Models loaded with this flag can't be exported to the binary format.
+            GenerateLods                = 256,  ///< Generate simplified LODs of the triangle meshes at load time. SceneRenderer selects the LOD of each instance by its screen size. Ignored for binary models which store LODs (version 9 and later), even if a mesh's stored chain is empty.
+            BuildBvh                    = 512,  ///< Build a triangle BVH of each triangle mesh without bones, for ray casts on the CPU. See Mesh::getBvh() and RayPicker.
         };
 
         /** create a new model from file
         */
         static SharedPtr createFromFile(const std::string& filename, uint32_t flags);
 
+        /** State of a load started by createFromFileAsync()
+        */
+        struct AsyncLoad;
+        using LoadHandle = std::shared_ptr<AsyncLoad>;
+
+        /** Start loading a model from a file. Returns immediately.
+            Reading and post-processing the file, and decoding its textures, run on the global ThreadPool. The device resources are created by waitForModel().
+            Binary models don't have a separate CPU stage, they are loaded entirely by waitForModel().
+        */
+        static LoadHandle createFromFileAsync(const std::string& filename, uint32_t flags);
+
+        /** Finish a load started by createFromFileAsync(). Must be called from the thread which owns the device. Calling it again with the same handle returns the same model.
+            returns nullptr if loading failed
+        */
+        static SharedPtr waitForModel(const LoadHandle& handle);
+
+        /** Create a model from a load started by createFromFileAsync(). Must be called from the thread which owns the device.
+            Unlike waitForModel(), every call returns a new Model object. The file is only read and post-processed once, so this is how several models are created from the same file. Binary models are read again by every call.
+            returns nullptr if loading failed
+        */
+        static SharedPtr createFromLoad(const LoadHandle& handle);
+
         static SharedPtr create();
 
         static const char* kSupportedFileFormatsStr;
@@ -77,8 +106,10 @@ namespace Falcor
         ~Model();
 
         /** Export the model to a binary file
+            \param[in] filename The binary file to create
+            \param[in,out] pBakeStats If not nullptr, the material textures are also baked into block-compressed DDS files next to the binary file. See BinaryModelExporter::exportToFile().
         */
-        void exportToBinaryFile(const std::string& filename);
+        void exportToBinaryFile(const std::string& filename, TextureBaker::Stats* pBakeStats = nullptr);
 
         /** Get the model radius
         */
@@ -204,6 +235,10 @@ namespace Falcor
         */
         void deleteCulledMeshes(const Camera* pCamera);
 
+        /** Move the geometry of all meshes into a geometry arena. Meshes the arena doesn't support keep their own buffers.
+        */
+        void moveToGeometryArena(GeometryArena* pArena);
+
         /** Name the model
         */
         void setName(const std::string& Name) { mName = Name; }
@@ -259,5 +294,9 @@ namespace Falcor
         static uint32_t sModelCounter;
 
         void calculateModelProperties();
+
+        /** Post-import steps shared by createFromFile() and waitForModel()
+        */
+        void finalizeLoadedModel(uint32_t flags);
     };
 }
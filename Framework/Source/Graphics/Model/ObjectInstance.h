@@ -29,6 +29,7 @@
 #pragma once
 
 #include "Graphics/Paths/MovableObject.h"
+#include "Graphics/Model/InstanceTransformStore.h"
 #include "Utils/AABB.h"
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -40,6 +41,8 @@ namespace Falcor
     class SceneRenderer;
     class Model;
 
+    /** An instance of a model or a mesh. The transform is stored in the global InstanceTransformStore, the instance is a handle to its slot.
+    */
     template<typename ObjectType>
     class ObjectInstance : public IMovableObject, public inherit_shared_from_this<IMovableObject, ObjectInstance<ObjectType>>
     {
@@ -51,12 +54,12 @@ namespace Falcor
             \param[in] pObject Object to create an instance of
             \param[in] baseTransform Base transform matrix of the instance
             \param[in] name Name of the instance
-            \return A new instance of the object if pObject
+            \return A new instance of the object, or nullptr if the InstanceTransformStore is full
         */
         static SharedPtr create(const typename ObjectType::SharedPtr& pObject, const glm::mat4& baseTransform, const std::string& name = "")
         {
             assert(pObject);
-            return SharedPtr(new ObjectInstance<ObjectType>(pObject, baseTransform, name));
+            return checkSlot(SharedPtr(new ObjectInstance<ObjectType>(pObject, baseTransform, name)));
         }
 
         /** Constructs a object instance with a transform
@@ -66,11 +69,11 @@ namespace Falcor
             \param[in] up Base up vector of the instance
             \param[in] scale Base scale of the instance
             \param[in] name Name of the instance
-            \return A new instance of the object
+            \return A new instance of the object, or nullptr if the InstanceTransformStore is full
         */
         static SharedPtr create(const typename ObjectType::SharedPtr& pObject, const glm::vec3& translation, const glm::vec3& target, const glm::vec3& up, const glm::vec3& scale, const std::string& name = "")
         {
-             return SharedPtr(new ObjectInstance<ObjectType>(pObject, translation, target, up, scale, name));
+             return checkSlot(SharedPtr(new ObjectInstance<ObjectType>(pObject, translation, target, up, scale, name)));
         }
 
         /** Constructs a object instance with a transform
@@ -79,11 +82,11 @@ namespace Falcor
             \param[in] rotation Euler angle rotations of the instance
             \param[in] scale Base scale of the instance
             \param[in] name Name of the instance
-            \return A new instance of the object
+            \return A new instance of the object, or nullptr if the InstanceTransformStore is full
         */
         static SharedPtr create(const typename ObjectType::SharedPtr& pObject, const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale, const std::string& name = "")
         {
-            return SharedPtr(new ObjectInstance<ObjectType>(pObject, translation, rotation, scale, name));
+            return checkSlot(SharedPtr(new ObjectInstance<ObjectType>(pObject, translation, rotation, scale, name)));
         }
 
         /** Gets object for which this is an instance of
@@ -119,28 +122,28 @@ namespace Falcor
         {
             if (updateLookAt)
             {
-                glm::vec3 toLookAt = mBase.target - mBase.translation;
-                mBase.target = translation + toLookAt;
+                glm::vec3 toLookAt = mpTransforms->baseTarget[mIndex] - mpTransforms->baseTranslation[mIndex];
+                mpTransforms->baseTarget[mIndex] = translation + toLookAt;
             }
 
-            mBase.translation = translation;
-            mBase.matrixDirty = true;
+            mpTransforms->baseTranslation[mIndex] = translation;
+            mpTransforms->markDirty(mIndex, InstanceTransformStore::BaseDirty);
         };
 
         /** Gets the position/translation of the instance
             \return Translation of the instance
         */
-        const glm::vec3& getTranslation() const { return mBase.translation; };
+        const glm::vec3& getTranslation() const { return mpTransforms->baseTranslation[mIndex]; };
 
         /** Sets scale of the instance
             \param[in] scaling Instance scale
         */
-        void setScaling(const glm::vec3& scaling) { mBase.scale = scaling; mBase.matrixDirty = true; }
+        void setScaling(const glm::vec3& scaling) { mpTransforms->baseScale[mIndex] = scaling; mpTransforms->markDirty(mIndex, InstanceTransformStore::BaseDirty); }
 
         /** Gets scale of the instance
             \return Scale of the instance
         */
-        const glm::vec3& getScaling() const { return mBase.scale; }
+        const glm::vec3& getScaling() const { return mpTransforms->baseScale[mIndex]; }
 
         /** Sets orientation of the instance
             \param[in] rotation Euler angles of rotation
@@ -151,10 +154,10 @@ namespace Falcor
             const glm::mat3 rotMtx(glm::eulerAngleXYZ(rotation[0], rotation[1], rotation[2]));
 
             // Get look-at info
-            mBase.up = rotMtx[1];
-            mBase.target = mBase.translation + rotMtx[2]; // position + forward
+            mpTransforms->baseUp[mIndex] = rotMtx[1];
+            mpTransforms->baseTarget[mIndex] = mpTransforms->baseTranslation[mIndex] + rotMtx[2]; // position + forward
 
-            mBase.matrixDirty = true;
+            mpTransforms->markDirty(mIndex, InstanceTransformStore::BaseDirty);
         }
 
         /** Gets Euler angle rotations for the instance
@@ -164,34 +167,34 @@ namespace Falcor
         {
             glm::vec3 result;
 
-            glm::mat4 rotationMtx = createMatrixFromLookAt(mBase.translation, mBase.target, mBase.up);
+            glm::mat4 rotationMtx = createMatrixFromLookAt(getTranslation(), getTarget(), getUpVector());
             glm::extractEulerAngleXYZ(rotationMtx, result[0], result[1], result[2]);
 
             return result;
         }
 
 // #toodo comments
-        void setUpVector(const glm::vec3& up) { mBase.up = glm::normalize(up); mBase.matrixDirty = true; }
+        void setUpVector(const glm::vec3& up) { mpTransforms->baseUp[mIndex] = glm::normalize(up); mpTransforms->markDirty(mIndex, InstanceTransformStore::BaseDirty); }
 
-        void setTarget(const glm::vec3& target) { mBase.target = target; mBase.matrixDirty = true; }
+        void setTarget(const glm::vec3& target) { mpTransforms->baseTarget[mIndex] = target; mpTransforms->markDirty(mIndex, InstanceTransformStore::BaseDirty); }
 
         /** Gets the up vector of the instance
             \return Up vector
         */
-        const glm::vec3& getUpVector() const { return mBase.up; }
+        const glm::vec3& getUpVector() const { return mpTransforms->baseUp[mIndex]; }
 
         /** Gets look-at target of the instance's orientation
             \return Look-at target position
         */
-        const glm::vec3& getTarget() const { return mBase.target; }
+        const glm::vec3& getTarget() const { return mpTransforms->baseTarget[mIndex]; }
 
         /** Gets the transform matrix
             \return Transform matrix
         */
         const glm::mat4& getTransformMatrix() const
         {
-            updateInstanceProperties();
-            return mFinalTransformMatrix;
+            mpTransforms->updateSlot(mIndex);
+            return mpTransforms->worldMatrix[mIndex];
         }
 
         /** Gets the bounding box
@@ -199,89 +202,98 @@ namespace Falcor
         */
         const BoundingBox& getBoundingBox() const
         {
-            updateInstanceProperties();
-            return mBoundingBox;
+            mpTransforms->updateSlot(mIndex);
+            return mpTransforms->worldBounds[mIndex];
+        }
+
+        /** Gets the slot of the instance in the InstanceTransformStore
+        */
+        uint32_t getTransformSlot() const { return mSlot; }
+
+        ~ObjectInstance()
+        {
+            mpStore->release(mSlot);
         }
 
         /** IMovableObject interface
         */
         virtual void move(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up) override
         {
-            mMovable.translation = position;
-            mMovable.target = target;
-            mMovable.up = up;
-            mMovable.scale = glm::vec3(1.0f);
-            mMovable.matrixDirty = true;
+            mpTransforms->movableTranslation[mIndex] = position;
+            mpTransforms->movableTarget[mIndex] = target;
+            mpTransforms->movableUp[mIndex] = up;
+            mpTransforms->movableScale[mIndex] = glm::vec3(1.0f);
+            mpTransforms->markDirty(mIndex, InstanceTransformStore::MovableDirty);
         }
 
     private:
 
-        void updateInstanceProperties() const
+        ObjectInstance(const typename ObjectType::SharedPtr& pObject, const std::string& name)
+            : mpObject(pObject), mName(name), mpStore(InstanceTransformStore::instance())
         {
-            if (mBase.matrixDirty || mMovable.matrixDirty)
-            {
-                if (mBase.matrixDirty)
-                {
-                    mBase.matrix = calculateTransformMatrix(mBase.translation, mBase.target, mBase.up, mBase.scale);
-                    mBase.matrixDirty = false;
-                }
-
-                if (mMovable.matrixDirty)
-                {
-                    mMovable.matrix = calculateTransformMatrix(mMovable.translation, mMovable.target, mMovable.up, mMovable.scale);
-                    mMovable.matrixDirty = false;
-                }
-
-                mFinalTransformMatrix = mMovable.matrix * mBase.matrix;
-                mBoundingBox = mpObject->getBoundingBox().transform(mFinalTransformMatrix);
-            }
+            // The store logs an error if it's full. The instance is then left without transforms, and create() drops it.
+            mSlot = mpStore->allocate(pObject ? &pObject->getBoundingBox() : nullptr);
+            mpTransforms = (mSlot != InstanceTransformStore::kInvalidSlot) ? mpStore->getChunk(mSlot) : nullptr;
+            mIndex = InstanceTransformStore::getChunkIndex(mSlot);
         }
 
-        static glm::mat4 calculateTransformMatrix(const glm::vec3& translation, const glm::vec3& target, const glm::vec3& up, const glm::vec3& scale)
+        /** Drop an instance which didn't get a slot in the store
+        */
+        static SharedPtr checkSlot(const SharedPtr& pInstance)
         {
-            glm::mat4 translationMtx = glm::translate(glm::mat4(), translation);
-            glm::mat4 rotationMtx = createMatrixFromLookAt(translation, target, up);
-            glm::mat4 scalingMtx = glm::scale(glm::mat4(), scale);
-
-            return translationMtx * rotationMtx * scalingMtx;
+            return pInstance->mpTransforms ? pInstance : nullptr;
         }
 
-        static glm::mat4 calculateTransformMatrix(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale)
-        {
-            glm::mat4 translationMtx = glm::translate(glm::mat4(), translation);
-            glm::mat4 rotationMtx = glm::eulerAngleXYZ(rotation[0], rotation[1], rotation[2]);
-            glm::mat4 scalingMtx = glm::scale(glm::mat4(), scale);
+        ObjectInstance(const ObjectInstance&) = delete;
+        ObjectInstance& operator=(const ObjectInstance&) = delete;
 
-            return translationMtx * rotationMtx * scalingMtx;
+        /** Detach the instanced object. Used by Model when it drops instances.
+        */
+        void resetObject()
+        {
+            mpObject = nullptr;
+            mpTransforms->pLocalBounds[mIndex] = nullptr;
         }
 
-        ObjectInstance(const typename ObjectType::SharedPtr& pObject, const std::string& name)
-            : mpObject(pObject), mName(name) { }
-
         ObjectInstance(const typename ObjectType::SharedPtr& pObject, const glm::mat4& baseTransform, const std::string& name)
             : ObjectInstance(pObject, name)
         {
+            if (mpTransforms == nullptr)
+            {
+                return;
+            }
+
             // #TODO Decompose matrix
 
-            mBase.matrix = baseTransform;
-            mBase.matrixDirty = false;
+            mpTransforms->baseMatrix[mIndex] = baseTransform;
+            mpTransforms->flags[mIndex] = (uint8_t)(mpTransforms->flags[mIndex] & ~InstanceTransformStore::BaseDirty);
         }
 
         ObjectInstance(const typename ObjectType::SharedPtr& pObject, const glm::vec3& translation, const glm::vec3& target, const glm::vec3& up, const glm::vec3& scale, const std::string& name = "")
             : ObjectInstance(pObject, name)
         {
-            mBase.translation = translation;
-            mBase.target = target;
-            mBase.up = up;
-            mBase.scale = scale;
+            if (mpTransforms == nullptr)
+            {
+                return;
+            }
+
+            mpTransforms->baseTranslation[mIndex] = translation;
+            mpTransforms->baseTarget[mIndex] = target;
+            mpTransforms->baseUp[mIndex] = up;
+            mpTransforms->baseScale[mIndex] = scale;
         }
 
         ObjectInstance(const typename ObjectType::SharedPtr& pObject, const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale, const std::string& name = "")
             : ObjectInstance(pObject, name)
         {
-            mBase.translation = translation;
+            if (mpTransforms == nullptr)
+            {
+                return;
+            }
+
+            mpTransforms->baseTranslation[mIndex] = translation;
             setRotation(rotation);
-            mBase.scale = scale;
+            mpTransforms->baseScale[mIndex] = scale;
         }
 
         friend class Model;
@@ -291,22 +303,9 @@ namespace Falcor
 
         typename ObjectType::SharedPtr mpObject;
 
-        struct Transform
-        {
-            glm::vec3 translation;
-            glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-            glm::vec3 target = glm::vec3(0.0f, 0.0f, 1.0f);
-            glm::vec3 scale = glm::vec3(1.0f);
-
-            // Matrix containing the above transforms
-            glm::mat4 matrix;
-            bool matrixDirty = true;
-        };
-
-        mutable Transform mBase;
-        mutable Transform mMovable;
-
-        mutable glm::mat4 mFinalTransformMatrix;
-        mutable BoundingBox mBoundingBox;
+        InstanceTransformStore::SharedPtr mpStore;
+        uint32_t mSlot;
+        InstanceTransformStore::Chunk* mpTransforms;
+        uint32_t mIndex;
     };
 }
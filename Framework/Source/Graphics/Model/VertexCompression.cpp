@@ -0,0 +1,151 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "VertexCompression.h"
+#include "glm/packing.hpp"
+#include "glm/geometric.hpp"
+
+namespace Falcor
+{
+    namespace VertexCompression
+    {
+        static const float kUnorm16Max = 65535.0f;
+
+        PositionQuantization PositionQuantization::fromBoundingBox(const BoundingBox& box)
+        {
+            PositionQuantization q;
+            q.offset = box.getMinPos();
+            q.scale = box.getSize();
+            return q;
+        }
+
+        void PositionQuantization::encode(const glm::vec3& pos, uint16_t pDst[4]) const
+        {
+            for(int i = 0; i < 3; i++)
+            {
+                float n = (scale[i] > 0) ? (pos[i] - offset[i]) / scale[i] : 0.0f;
+                n = glm::clamp(n, 0.0f, 1.0f);
+                pDst[i] = (uint16_t)(n * kUnorm16Max + 0.5f);
+            }
+            pDst[3] = 0xffff;
+        }
+
+        glm::vec3 PositionQuantization::decode(const uint16_t pSrc[4]) const
+        {
+            glm::vec3 q(pSrc[0], pSrc[1], pSrc[2]);
+            return q / kUnorm16Max * scale + offset;
+        }
+
+        static glm::vec2 signNotZero(const glm::vec2& v)
+        {
+            return glm::vec2((v.x >= 0) ? 1.0f : -1.0f, (v.y >= 0) ? 1.0f : -1.0f);
+        }
+
+        glm::vec2 octEncode(const glm::vec3& v)
+        {
+            float l1 = glm::abs(v.x) + glm::abs(v.y) + glm::abs(v.z);
+            if(l1 == 0)
+            {
+                return glm::vec2(0);
+            }
+
+            glm::vec2 p = glm::vec2(v.x, v.y) / l1;
+            if(v.z < 0)
+            {
+                // Fold the lower hemisphere over the diagonals
+                p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero(p);
+            }
+            return p;
+        }
+
+        glm::vec3 octDecode(const glm::vec2& e)
+        {
+            glm::vec3 v(e.x, e.y, 1.0f - glm::abs(e.x) - glm::abs(e.y));
+            if(v.z < 0)
+            {
+                glm::vec2 p = (1.0f - glm::abs(glm::vec2(v.y, v.x))) * signNotZero(glm::vec2(v.x, v.y));
+                v.x = p.x;
+                v.y = p.y;
+            }
+            return glm::normalize(v);
+        }
+
+        uint32_t encodeDirection(const glm::vec3& v)
+        {
+            return glm::packSnorm2x16(octEncode(v));
+        }
+
+        glm::vec3 decodeDirection(uint32_t packed)
+        {
+            return octDecode(glm::unpackSnorm2x16(packed));
+        }
+
+        uint32_t encodeTexCrd(const glm::vec2& texC)
+        {
+            return glm::packHalf2x16(texC);
+        }
+
+        uint32_t encodeColor(const glm::vec4& color)
+        {
+            return glm::packUnorm4x8(color);
+        }
+
+        VertexLayout::SharedPtr createLayout(bool hasNormals, bool hasBitangents, bool hasTexCrd, bool hasColors, bool hasBones)
+        {
+            VertexLayout::SharedPtr pLayout = VertexLayout::create();
+
+            VertexBufferLayout::SharedPtr pPosLayout = VertexBufferLayout::create();
+            pPosLayout->addElement(VERTEX_POSITION_NAME, 0, kPositionFormat, 1, VERTEX_POSITION_LOC);
+            pLayout->addBufferLayout(0, pPosLayout);
+
+            VertexBufferLayout::SharedPtr pAttribLayout = VertexBufferLayout::create();
+            uint32_t offset = 0;
+            auto addElement = [&](const char* name, ResourceFormat format, uint32_t location)
+            {
+                pAttribLayout->addElement(name, offset, format, 1, location);
+                offset += getFormatBytesPerBlock(format);
+            };
+
+            if(hasNormals)      addElement(VERTEX_NORMAL_NAME, kDirectionFormat, VERTEX_NORMAL_LOC);
+            if(hasBitangents)   addElement(VERTEX_BITANGENT_NAME, kDirectionFormat, VERTEX_BITANGENT_LOC);
+            if(hasTexCrd)       addElement(VERTEX_TEXCOORD_NAME, kTexCrdFormat, VERTEX_TEXCOORD_LOC);
+            if(hasColors)       addElement(VERTEX_DIFFUSE_COLOR_NAME, kColorFormat, VERTEX_DIFFUSE_COLOR_LOC);
+            if(hasBones)
+            {
+                addElement(VERTEX_BONE_WEIGHT_NAME, ResourceFormat::RGBA32Float, VERTEX_BONE_WEIGHT_LOC);
+                addElement(VERTEX_BONE_ID_NAME, ResourceFormat::RGBA8Uint, VERTEX_BONE_ID_LOC);
+            }
+
+            if(offset > 0)
+            {
+                pLayout->addBufferLayout(1, pAttribLayout);
+            }
+            return pLayout;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "API/VertexLayout.h"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    /** Encoding of the compact vertex format, used by the model importers when Model::CompactVertices is set.
+        Positions live in their own stream as RGBA16Unorm, quantized to the mesh bounding-box. The rest of the attributes are interleaved into a second stream:
+        octahedral RG16Snorm normals and bitangents, RG16Float texture coordinates and RGBA8Unorm colors. Bone weights and IDs keep their full precision formats.
+        VertexLayout defines COMPACT_VERTICES for layouts with a quantized position, and the default vertex shader decodes the format (see VertexAttrib.h).
+    */
+    namespace VertexCompression
+    {
+        static const ResourceFormat kPositionFormat = ResourceFormat::RGBA16Unorm;
+        static const ResourceFormat kDirectionFormat = ResourceFormat::RG16Snorm;
+        static const ResourceFormat kTexCrdFormat = ResourceFormat::RG16Float;
+        static const ResourceFormat kColorFormat = ResourceFormat::RGBA8Unorm;
+
+        /** Quantization of a mesh's positions. A quantized position q in [0, 1] decodes to q * scale + offset.
+        */
+        struct PositionQuantization
+        {
+            glm::vec3 scale = glm::vec3(1);
+            glm::vec3 offset = glm::vec3(0);
+
+            /** Create a quantization covering the box
+            */
+            static PositionQuantization fromBoundingBox(const BoundingBox& box);
+
+            /** Quantize a position into 4 16-bit values, the last one is always 1
+            */
+            void encode(const glm::vec3& pos, uint16_t pDst[4]) const;
+
+            /** Reconstruct a position
+            */
+            glm::vec3 decode(const uint16_t pSrc[4]) const;
+        };
+
+        /** Map a unit vector to the [-1, 1] square using the octahedral mapping
+        */
+        glm::vec2 octEncode(const glm::vec3& v);
+
+        /** Map an octahedral-encoded vector back to a unit vector
+        */
+        glm::vec3 octDecode(const glm::vec2& e);
+
+        /** Encode a direction as RG16Snorm. The vector doesn't have to be normalized. Zero-length vectors decode to (0, 0, 1).
+        */
+        uint32_t encodeDirection(const glm::vec3& v);
+
+        /** Decode an RG16Snorm direction
+        */
+        glm::vec3 decodeDirection(uint32_t packed);
+
+        /** Encode texture coordinates as RG16Float
+        */
+        uint32_t encodeTexCrd(const glm::vec2& texC);
+
+        /** Encode a color as RGBA8Unorm
+        */
+        uint32_t encodeColor(const glm::vec4& color);
+
+        /** Create the two-stream compact layout. Buffer 0 holds the positions, buffer 1 the interleaved attributes.
+        */
+        VertexLayout::SharedPtr createLayout(bool hasNormals, bool hasBitangents, bool hasTexCrd, bool hasColors, bool hasBones);
+    }
+}
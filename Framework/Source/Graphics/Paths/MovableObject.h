@@ -26,10 +26,13 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <memory>
 #include "glm/vec3.hpp"
 
 namespace Falcor
 {
+    class ObjectPath;
+
     class IMovableObject : public std::enable_shared_from_this<IMovableObject>
     {
     public:
@@ -37,5 +40,13 @@ namespace Falcor
         using SharedConstPtr = std::shared_ptr<const IMovableObject>;
 
         virtual void move(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up) = 0;
+
+        /** Get the path the object is attached to, or nullptr if it isn't attached to a path
+        */
+        std::shared_ptr<ObjectPath> getAttachedPath() const { return mpAttachedPath.lock(); }
+
+    private:
+        friend class ObjectPath;
+        std::weak_ptr<ObjectPath> mpAttachedPath;   ///< Set by ObjectPath::attachObject(). An object is moved by one path at most.
     };
 }
\ No newline at end of file
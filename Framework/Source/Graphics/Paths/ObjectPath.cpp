@@ -220,11 +220,19 @@ namespace Falcor
 
     void ObjectPath::attachObject(const IMovableObject::SharedPtr& pObject)
     {
+        // Scene::update() animates the paths in parallel, so two paths must never move the same object
+        ObjectPath::SharedPtr pPrevPath = pObject->mpAttachedPath.lock();
+        if(pPrevPath && (pPrevPath.get() != this))
+        {
+            pPrevPath->detachObject(pObject);
+        }
+
         // Only attach the object if its not already found
         if(std::find(mpObjects.begin(), mpObjects.end(), pObject) == mpObjects.end())
         {
             mpObjects.push_back(pObject);
         }
+        pObject->mpAttachedPath = shared_from_this();
     }
 
     void ObjectPath::detachObject(const IMovableObject::SharedPtr& pObject)
@@ -234,6 +242,11 @@ namespace Falcor
         {
             mpObjects.erase(it);
         }
+
+        if(pObject->mpAttachedPath.lock().get() == this)
+        {
+            pObject->mpAttachedPath.reset();
+        }
     }
 
     void ObjectPath::removeKeyFrame(uint32_t frameID)
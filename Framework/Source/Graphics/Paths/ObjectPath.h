@@ -56,6 +56,8 @@ namespace Falcor
 
         void animate(double currentTime);
 
+        /** Attach an object to the path. An object can only follow one path, so it is detached from the path it was previously attached to.
+        */
         void attachObject(const IMovableObject::SharedPtr& pObject);
         void detachObject(const IMovableObject::SharedPtr& pObject);
 
@@ -478,6 +478,7 @@ namespace Falcor
         //
 
         mpScenePicker = Picking::create(mpScene, backBufferWidth, backBufferHeight);
+        mpSceneRayPicker = RayPicker::create(mpScene);
 
         //
         // Editor Scene and Picking
@@ -878,13 +879,18 @@ namespace Falcor
                     {
                         select(mpEditorPicker->getPickedModelInstance());
                     }
-                    else if (mpScenePicker->pick(pContext, mouseEvent.pos, mpEditorScene->getActiveCamera()))
-                    {
-                        select(mpScenePicker->getPickedModelInstance(), mpScenePicker->getPickedMeshInstance());
-                    }
                     else
                     {
-                        deselect();
+                        Scene::ModelInstance::SharedPtr pModelInstance;
+                        Model::MeshInstance::SharedPtr pMeshInstance;
+                        if (pickSceneObject(pContext, mouseEvent.pos, pModelInstance, pMeshInstance))
+                        {
+                            select(pModelInstance, pMeshInstance);
+                        }
+                        else
+                        {
+                            deselect();
+                        }
                     }
                 }
             }
@@ -1211,6 +1217,27 @@ namespace Falcor
         }
     }
 
+    bool SceneEditor::pickSceneObject(RenderContext* pContext, const glm::vec2& mousePos, Scene::ModelInstance::SharedPtr& pModelInstance, Model::MeshInstance::SharedPtr& pMeshInstance)
+    {
+        // The ray cast doesn't need a render pass or a GPU readback, but it can only be trusted if it sees every mesh
+        RayPicker::Result result;
+        bool hit = mpSceneRayPicker->pick(mousePos, mpEditorScene->getActiveCamera().get(), result);
+        if (mpSceneRayPicker->isComplete())
+        {
+            pModelInstance = result.pModelInstance;
+            pMeshInstance = result.pMeshInstance;
+            return hit;
+        }
+
+        if (mpScenePicker->pick(pContext, mousePos, mpEditorScene->getActiveCamera()))
+        {
+            pModelInstance = mpScenePicker->getPickedModelInstance();
+            pMeshInstance = mpScenePicker->getPickedMeshInstance();
+            return true;
+        }
+        return false;
+    }
+
     void SceneEditor::deselect()
     {
         if (mpSelectionScene)
@@ -32,6 +32,7 @@
 #include "Graphics/Material/MaterialEditor.h"
 #include "Utils/DebugDrawer.h"
 #include "Utils/Picking/Picking.h"
+#include "Utils/Picking/RayPicker.h"
 #include "Graphics/Scene/Editor/Gizmo.h"
 #include "Graphics/Scene/Editor/SceneEditorRenderer.h"
 #include "Graphics/Material/MaterialHistory.h"
@@ -191,6 +192,10 @@ namespace Falcor
         void select(const Scene::ModelInstance::SharedPtr& pModelInstance, const Model::MeshInstance::SharedPtr& pMeshInstance = nullptr);
         void deselect();
 
+        /** Pick an object of the master scene. Casts a ray on the CPU if every mesh has a BVH, otherwise renders the scene with the GPU picker.
+        */
+        bool pickSceneObject(RenderContext* pContext, const glm::vec2& mousePos, Scene::ModelInstance::SharedPtr& pModelInstance, Model::MeshInstance::SharedPtr& pMeshInstance);
+
         void setActiveModelInstance(const Scene::ModelInstance::SharedPtr& pModelInstance);
 
         // ID's in master scene
@@ -202,6 +207,7 @@ namespace Falcor
         uint32_t mSelectedMaterial = 0;
 
         Picking::UniquePtr mpScenePicker;
+        RayPicker::UniquePtr mpSceneRayPicker;
 
         std::set<Scene::ModelInstance*> mSelectedInstances;
         ObjectType mSelectedObjectType = ObjectType::None;
@@ -85,11 +85,11 @@ namespace Falcor
         {
             // Set camera for regular shader
             ConstantBuffer* pCB = mpProgramVars->getConstantBuffer(kPerFrameCbName).get();
-            currentData.pCamera->setIntoConstantBuffer(pCB, sCameraDataOffset);
+            currentData.pCamera->setIntoConstantBuffer(pCB, kCameraVarName);
 
             // Set camera for rotate gizmo shader
             pCB = mpRotGizmoProgramVars->getConstantBuffer(kPerFrameCbName).get();
-            currentData.pCamera->setIntoConstantBuffer(pCB, sCameraDataOffset);
+            currentData.pCamera->setIntoConstantBuffer(pCB, kCameraVarName);
         }
     }
 
@@ -0,0 +1,141 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "HzbCulling.h"
+#include "API/RenderContext.h"
+#include "Data/HostDeviceData.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    static const char* kShaderFilename = "Framework/Shaders/HzbCulling.cs.hlsl";
+    static const uint32_t kThreadGroupSize = 64;
+
+    HzbCulling::SharedPtr HzbCulling::create(uint32_t readbackLatency)
+    {
+        return SharedPtr(new HzbCulling(readbackLatency));
+    }
+
+    HzbCulling::HzbCulling(uint32_t readbackLatency)
+    {
+        mpProgram = ComputeProgram::createFromFile(kShaderFilename);
+        mpState = ComputeState::create();
+        mpState->setProgram(mpProgram);
+        mpVars = ComputeVars::create(mpProgram->getActiveVersion()->getReflector());
+        mParamsOffset = mpVars->getConstantBuffer("PerFrameCB")->getVariableOffset("gParams.viewProjMat");
+
+        mReadbacks.resize(readbackLatency + 1);
+    }
+
+    void HzbCulling::buildHzb(RenderContext* pContext, const Texture::SharedPtr& pDepth, const glm::mat4& viewProjMat)
+    {
+        if ((mpHzb == nullptr) || (mpHzb->getDepthWidth() != pDepth->getWidth()) || (mpHzb->getDepthHeight() != pDepth->getHeight()))
+        {
+            mpHzb = HierarchicalZ::create(pDepth->getWidth(), pDepth->getHeight());
+        }
+        mpHzb->build(pContext, pDepth);
+        mHzbViewProjMat = viewProjMat;
+    }
+
+    void HzbCulling::cull(RenderContext* pContext, const std::vector<BoundingBox>& boxes)
+    {
+        Readback& readback = mReadbacks[mCurrentReadback];
+        mCurrentReadback = (mCurrentReadback + 1) % (uint32_t)mReadbacks.size();
+
+        readback.boxCount = mpHzb ? (uint32_t)std::min(boxes.size(), (size_t)kMaxBoxCount) : 0;
+        readback.pFence = nullptr;
+        readback.pending = true;
+        if (readback.boxCount == 0)
+        {
+            return;
+        }
+
+        // Upload the boxes. The buffers grow geometrically.
+        mBoxData.resize(readback.boxCount * 2);
+        for (uint32_t i = 0; i < readback.boxCount; i++)
+        {
+            mBoxData[i * 2] = boxes[i].getMinPos();
+            mBoxData[i * 2 + 1] = boxes[i].getMaxPos();
+        }
+
+        const size_t boxBytes = mBoxData.size() * sizeof(glm::vec3);
+        if ((mpBoxBuffer == nullptr) || (mpBoxBuffer->getSize() < boxBytes))
+        {
+            size_t size = mpBoxBuffer ? std::max(boxBytes, mpBoxBuffer->getSize() * 2) : boxBytes;
+            mpBoxBuffer = Buffer::create(size, Resource::BindFlags::ShaderResource, Buffer::CpuAccess::None, nullptr);
+            mpVisibilityBuffer = Buffer::create(size / 6, Resource::BindFlags::ShaderResource | Resource::BindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr);
+        }
+        mpBoxBuffer->updateData(mBoxData.data(), 0, boxBytes);
+
+        HzbCullingParams params;
+        params.viewProjMat = mHzbViewProjMat;
+        params.boxCount = readback.boxCount;
+        params.levelCount = mpHzb->getLevelCount();
+        params.depthWidth = mpHzb->getDepthWidth();
+        params.depthHeight = mpHzb->getDepthHeight();
+        mpVars->getConstantBuffer("PerFrameCB")->setBlob(&params, mParamsOffset, sizeof(params));
+        mpVars->setTexture("gHzb", mpHzb->getTexture());
+        mpVars->setRawBuffer("gBoxes", mpBoxBuffer);
+        mpVars->setRawBuffer("gVisibility", mpVisibilityBuffer);
+
+        pContext->pushComputeState(mpState);
+        pContext->pushComputeVars(mpVars);
+        pContext->dispatch((readback.boxCount + kThreadGroupSize - 1) / kThreadGroupSize, 1, 1);
+        pContext->popComputeVars();
+        pContext->popComputeState();
+
+        // Copy the results into this entry's readback buffer, and submit without waiting. Every flush signals the context's fence.
+        if ((readback.pBuffer == nullptr) || (readback.pBuffer->getSize() != mpVisibilityBuffer->getSize()))
+        {
+            readback.pBuffer = Buffer::create(mpVisibilityBuffer->getSize(), Resource::BindFlags::None, Buffer::CpuAccess::Read, nullptr);
+        }
+        pContext->copyResource(readback.pBuffer.get(), mpVisibilityBuffer.get());
+        pContext->flush(false);
+        readback.pFence = pContext->getLowLevelData()->getFence();
+        readback.fenceValue = readback.pFence->getCpuValue();
+    }
+
+    const std::vector<uint32_t>& HzbCulling::readVisibility()
+    {
+        // The entry the next cull() call overwrites is the one issued readbackLatency calls before the last one
+        Readback& readback = mReadbacks[mCurrentReadback];
+        if (readback.pending)
+        {
+            mVisibility.resize(readback.boxCount);
+            if (readback.boxCount != 0)
+            {
+                readback.pFence->syncCpu(readback.fenceValue);
+                const uint32_t* pData = (const uint32_t*)readback.pBuffer->map(Buffer::MapType::Read);
+                std::copy(pData, pData + readback.boxCount, mVisibility.begin());
+                readback.pBuffer->unmap();
+            }
+            readback.pending = false;
+        }
+        return mVisibility;
+    }
+}
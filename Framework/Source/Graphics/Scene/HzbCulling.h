@@ -0,0 +1,119 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "Utils/AABB.h"
+#include "Utils/Math/HierarchicalZ.h"
+#include "Graphics/ComputeProgram.h"
+#include "Graphics/ComputeState.h"
+#include "API/ProgramVars.h"
+#include "API/Buffer.h"
+#include "API/LowLevel/GpuFence.h"
+
+namespace Falcor
+{
+    class RenderContext;
+
+    /** Hierarchical-Z occlusion culling on the GPU.
+        buildHzb() reduces a frame's depth buffer into a HierarchicalZ pyramid. cull() then tests bounding boxes against it in a compute pass, which writes one uint per box into the visibility buffer, and starts copying the buffer to the CPU.
+        readVisibility() returns the results of the cull() call issued 'readbackLatency' calls earlier than the last one, so with a latency of 1 or more the CPU reads results the GPU finished a while ago, instead of waiting for the current frame.
+        The test is the one of HzbReference, which is the CPU reference of the whole pass.
+    */
+    class HzbCulling
+    {
+    public:
+        using SharedPtr = std::shared_ptr<HzbCulling>;
+        using SharedConstPtr = std::shared_ptr<const HzbCulling>;
+
+        static const uint32_t kMaxBoxCount = 65535 * 64;   ///< One thread per box, in a single row of thread groups
+
+        /** Create a new object
+            \param[in] readbackLatency Number of cull() calls between the one whose results readVisibility() returns and the last one
+        */
+        static SharedPtr create(uint32_t readbackLatency = 1);
+
+        /** Build the pyramid from a depth buffer. The pyramid is re-created when the depth buffer's size changes.
+            \param[in] pDepth A single-sampled depth texture with the ShaderResource bind flag
+            \param[in] viewProjMat The view-projection matrix the depth buffer was rendered with
+        */
+        void buildHzb(RenderContext* pContext, const Texture::SharedPtr& pDepth, const glm::mat4& viewProjMat);
+
+        /** Test boxes against the last pyramid and start reading the results back. Does nothing on the GPU if buildHzb() wasn't called, and the results are then empty.
+            \param[in] boxes World-space boxes. Boxes past kMaxBoxCount are not tested.
+        */
+        void cull(RenderContext* pContext, const std::vector<BoundingBox>& boxes);
+
+        /** Get the results of the cull() call issued readbackLatency calls before the last one. Waits for the GPU if the copy isn't finished yet.
+            \return One entry per box passed to that cull() call, 1 if the box might be visible and 0 if it's hidden. Empty until enough calls were issued.
+        */
+        const std::vector<uint32_t>& readVisibility();
+
+        /** Get the visibility buffer of the last cull() call, for passes which consume it on the GPU
+        */
+        const Buffer::SharedPtr& getVisibilityBuffer() const { return mpVisibilityBuffer; }
+
+        /** Get the pyramid. Returns nullptr until buildHzb() is called.
+        */
+        const HierarchicalZ* getHzb() const { return mpHzb.get(); }
+
+        /** Get the view-projection matrix of the last pyramid
+        */
+        const glm::mat4& getHzbViewProjMatrix() const { return mHzbViewProjMat; }
+
+        uint32_t getReadbackLatency() const { return (uint32_t)mReadbacks.size() - 1; }
+
+    private:
+        HzbCulling(uint32_t readbackLatency);
+
+        struct Readback
+        {
+            Buffer::SharedPtr pBuffer;
+            GpuFence::SharedPtr pFence;
+            uint64_t fenceValue = 0;
+            uint32_t boxCount = 0;
+            bool pending = false;       ///< The copy was issued and wasn't read yet
+        };
+
+        HierarchicalZ::UniquePtr mpHzb;
+        glm::mat4 mHzbViewProjMat;
+
+        ComputeProgram::SharedPtr mpProgram;
+        ComputeState::SharedPtr mpState;
+        ComputeVars::SharedPtr mpVars;
+        size_t mParamsOffset;
+
+        std::vector<glm::vec3> mBoxData;            ///< Min and max corners
+        Buffer::SharedPtr mpBoxBuffer;
+        Buffer::SharedPtr mpVisibilityBuffer;
+
+        std::vector<Readback> mReadbacks;
+        uint32_t mCurrentReadback = 0;              ///< The entry the next cull() call writes, which is also the oldest one
+        std::vector<uint32_t> mVisibility;
+    };
+}
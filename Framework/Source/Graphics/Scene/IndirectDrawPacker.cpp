@@ -0,0 +1,99 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "IndirectDrawPacker.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    void IndirectDrawPacker::clear()
+    {
+        mInstances.clear();
+        mInstanceTransforms.clear();
+        mDrawArgs.clear();
+        mBatches.clear();
+        mTransforms.clear();
+    }
+
+    void IndirectDrawPacker::addInstance(uint32_t batchID, uint32_t geometryID, const Geometry& geometry, const glm::mat4& worldMat)
+    {
+        Instance instance;
+        instance.key = ((uint64_t)batchID << 32) | geometryID;
+        instance.order = (uint32_t)mInstances.size();
+        instance.geometry = geometry;
+        mInstances.push_back(instance);
+        mInstanceTransforms.push_back(worldMat);
+    }
+
+    void IndirectDrawPacker::pack()
+    {
+        mDrawArgs.clear();
+        mBatches.clear();
+        mTransforms.clear();
+        mTransforms.reserve(mInstances.size());
+
+        std::sort(mInstances.begin(), mInstances.end(), [](const Instance& a, const Instance& b)
+        {
+            return (a.key < b.key) || ((a.key == b.key) && (a.order < b.order));
+        });
+
+        for(size_t i = 0; i < mInstances.size(); i++)
+        {
+            const Instance& instance = mInstances[i];
+            const uint32_t batchID = (uint32_t)(instance.key >> 32);
+            const bool newBatch = mBatches.empty() || (mBatches.back().batchID != batchID);
+            const bool newDraw = newBatch || (mInstances[i - 1].key != instance.key);
+
+            if(newBatch)
+            {
+                Batch batch;
+                batch.batchID = batchID;
+                batch.firstDraw = (uint32_t)mDrawArgs.size();
+                batch.drawCount = 0;
+                batch.instanceCount = 0;
+                mBatches.push_back(batch);
+            }
+
+            if(newDraw)
+            {
+                DrawArguments args;
+                args.indexCount = instance.geometry.indexCount;
+                args.instanceCount = 0;
+                args.startIndexLocation = instance.geometry.startIndex;
+                args.baseVertexLocation = instance.geometry.baseVertex;
+                args.startInstanceLocation = (uint32_t)mTransforms.size();
+                mDrawArgs.push_back(args);
+                mBatches.back().drawCount++;
+            }
+
+            mDrawArgs.back().instanceCount++;
+            mBatches.back().instanceCount++;
+            mTransforms.push_back(mInstanceTransforms[instance.order]);
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "glm/mat4x4.hpp"
+
+namespace Falcor
+{
+    /** Packs visible mesh instances into the inputs of indirect draw calls. This is the CPU side of SceneRenderer's indirect draw mode, and doesn't touch the device.
+        Instances are grouped by batch (instances which share bindings, such as the VAO and material) and then by geometry. Each geometry of a batch becomes one instanced draw, and each batch is submitted with one RenderContext::drawIndexedIndirect() call.
+        The transforms are written in draw order, and each draw's startInstanceLocation points at its first transform.
+    */
+    class IndirectDrawPacker
+    {
+    public:
+        /** The layout of D3D12_DRAW_INDEXED_ARGUMENTS, which RenderContext::drawIndexedIndirect() reads
+        */
+        struct DrawArguments
+        {
+            uint32_t indexCount;
+            uint32_t instanceCount;
+            uint32_t startIndexLocation;
+            int32_t baseVertexLocation;
+            uint32_t startInstanceLocation;
+        };
+        static_assert(sizeof(DrawArguments) == 5 * sizeof(uint32_t), "DrawArguments must match D3D12_DRAW_INDEXED_ARGUMENTS");
+
+        /** The index range of a mesh in the bound index buffer
+        */
+        struct Geometry
+        {
+            uint32_t indexCount = 0;
+            uint32_t startIndex = 0;
+            int32_t baseVertex = 0;
+        };
+
+        /** A range of draws which share bindings
+        */
+        struct Batch
+        {
+            uint32_t batchID;
+            uint32_t firstDraw;
+            uint32_t drawCount;
+            uint32_t instanceCount;
+        };
+
+        /** Remove all instances and packed data. The memory is kept for the next frame.
+        */
+        void clear();
+
+        /** Add a visible instance
+            \param[in] batchID Identifies the bindings the instance is drawn with. Batches are packed in ascending ID order.
+            \param[in] geometryID Identifies the geometry inside the batch. Instances with the same batch and geometry ID must pass the same geometry.
+            \param[in] geometry The index range to draw
+            \param[in] worldMat The instance's world matrix
+        */
+        void addInstance(uint32_t batchID, uint32_t geometryID, const Geometry& geometry, const glm::mat4& worldMat);
+
+        /** Sort the instances and build the draw arguments, batches and transforms. Instances with equal IDs keep the order they were added in.
+        */
+        void pack();
+
+        uint32_t getInstanceCount() const { return (uint32_t)mInstances.size(); }
+        const std::vector<DrawArguments>& getDrawArguments() const { return mDrawArgs; }
+        const std::vector<Batch>& getBatches() const { return mBatches; }
+        const std::vector<glm::mat4>& getTransforms() const { return mTransforms; }
+
+    private:
+        struct Instance
+        {
+            uint64_t key;       ///< Batch ID in the high bits, geometry ID in the low bits
+            uint32_t order;     ///< Index in mInstances, keeps the sort stable
+            Geometry geometry;
+        };
+
+        std::vector<Instance> mInstances;
+        std::vector<glm::mat4> mInstanceTransforms;     ///< In the order instances were added
+
+        std::vector<DrawArguments> mDrawArgs;
+        std::vector<Batch> mBatches;
+        std::vector<glm::mat4> mTransforms;             ///< In draw order
+    };
+}
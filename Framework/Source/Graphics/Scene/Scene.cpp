@@ -28,6 +28,10 @@
 #include "Framework.h"
 #include "Scene.h"
 #include "SceneImporter.h"
+#include "SceneCache.h"
+#include "Graphics/Model/GeometryArena.h"
+#include "Utils/OS.h"
+#include "Utils/ThreadPool.h"
 #include "glm/gtx/euler_angles.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
@@ -41,6 +45,22 @@ namespace Falcor
 
     Scene::SharedPtr Scene::loadFromFile(const std::string& filename, const uint32_t& modelLoadFlags, uint32_t sceneLoadFlags)
     {
+        std::string fullpath;
+        if((sceneLoadFlags & UseSceneCache) && findFileInDataDirectories(filename, fullpath))
+        {
+            Scene::SharedPtr pScene = SceneCache::load(fullpath, modelLoadFlags, sceneLoadFlags);
+            if(pScene == nullptr)
+            {
+                std::vector<std::string> dependencies;
+                pScene = SceneImporter::loadScene(filename, modelLoadFlags, sceneLoadFlags, dependencies);
+                if(pScene)
+                {
+                    SceneCache::save(fullpath, pScene.get(), dependencies, modelLoadFlags, sceneLoadFlags);
+                }
+            }
+            return pScene;
+        }
+
         return SceneImporter::loadScene(filename, modelLoadFlags, sceneLoadFlags);
     }
 
@@ -117,9 +137,21 @@ namespace Falcor
 
     bool Scene::update(double currentTime, CameraController* cameraController)
     {
-        for (auto& path : mpPaths)
+        // Paths are independent, so they are animated in bulk on the thread pool. ObjectPath::attachObject() detaches an object from its previous path, so no object is moved by two paths.
+        ThreadPool::instance()->parallelFor((uint32_t)mpPaths.size(), 0, [this, currentTime](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                mpPaths[i]->animate(currentTime);
+            }
+        });
+
+        // Recompute the world matrices and bounds of the instances which moved
+        InstanceTransformStore::instance()->update();
+
+        if (mpSpatialIndex)
         {
-            path->animate(currentTime);
+            mpSpatialIndex->update();
         }
 
         // Ignore the elapsed time we got from the user. This will allow camera movement in cases where the time is frozen
@@ -142,6 +174,9 @@ namespace Falcor
 
         // Delete entire vector of instances
         mModels.erase(mModels.begin() + modelID);
+
+        // Close the holes the model's meshes left in the arena, if this was the last reference to them
+        GeometryArena::getGlobalArena()->defragment();
     }
 
     void Scene::deleteAllModels()
@@ -156,6 +191,12 @@ namespace Falcor
 
     void Scene::addModelInstance(const Model::SharedPtr& pModel, const std::string& instanceName, const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scaling)
     {
+        ModelInstance::SharedPtr pInstance = ModelInstance::create(pModel, translation, rotation, scaling, instanceName);
+        if (pInstance == nullptr)
+        {
+            return;
+        }
+
         int32_t modelID = -1;
 
         // Linear search from the end. Instances are usually added in order by model
@@ -175,11 +216,17 @@ namespace Falcor
             modelID = (int32_t)mModels.size() - 1;
         }
 
-        mModels[modelID].push_back(ModelInstance::create(pModel, translation, rotation, scaling, instanceName));
+        mModels[modelID].push_back(pInstance);
     }
 
     void Scene::addModelInstance(const ModelInstance::SharedPtr& pInstance)
     {
+        // ObjectInstance::create() returns nullptr if the transform store is full
+        if (pInstance == nullptr)
+        {
+            return;
+        }
+
         // Checking for existing instance list for model
         for (uint32_t modelID = 0; modelID < (uint32_t)mModels.size(); modelID++)
         {
@@ -307,6 +354,15 @@ namespace Falcor
         mActiveCameraID = camID;
     }
 
+    const SceneSpatialIndex::SharedPtr& Scene::getSpatialIndex()
+    {
+        if (mpSpatialIndex == nullptr)
+        {
+            mpSpatialIndex = SceneSpatialIndex::create(this);
+        }
+        return mpSpatialIndex;
+    }
+
     void Scene::merge(const Scene* pFrom)
     {
 #define merge(name_) name_.insert(name_.end(), pFrom->name_.begin(), pFrom->name_.end());
@@ -37,6 +37,7 @@
 #include "Graphics/Paths/ObjectPath.h"
 #include "Graphics/Model/ObjectInstance.h"
 #include "Graphics/Material/MaterialHistory.h"
+#include "Graphics/Scene/SceneSpatialIndex.h"
 
 namespace Falcor
 {
@@ -99,7 +100,8 @@ namespace Falcor
         {
             None,
             GenerateAreaLights = 1,    ///< Create area light(s) for meshes that have emissive material
-            LoadMaterialHistory = 2    ///< Load history of overridden mesh materials
+            LoadMaterialHistory = 2,   ///< Load history of overridden mesh materials
+            UseSceneCache = 4          ///< Load the scene from its compiled cache if it's up-to-date, otherwise import it and write the cache. See SceneCache. Ignored with LoadMaterialHistory.
         };
 
         static Scene::SharedPtr loadFromFile(const std::string& filename, const uint32_t& modelLoadFlags, uint32_t sceneLoadFlags = 0);
@@ -183,6 +185,10 @@ namespace Falcor
 
         void merge(const Scene* pFrom);
 
+        /** Get the spatial index of the scene's instances. The index is created on first use and update() keeps it up to date afterwards. Call SceneSpatialIndex::update() after moving, adding or removing instances outside of update().
+        */
+        const SceneSpatialIndex::SharedPtr& getSpatialIndex();
+
         /**
             This routine creates area light(s) in the scene. All meshes that
             have emissive material are treated as area lights.
@@ -209,6 +215,7 @@ namespace Falcor
         std::vector<ObjectPath::SharedPtr> mpPaths;
 
         MaterialHistory::SharedPtr mpMaterialHistory;
+        SceneSpatialIndex::SharedPtr mpSpatialIndex;
 
         glm::vec3 mAmbientIntensity;
         uint32_t mActiveCameraID = 0;
@@ -0,0 +1,677 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneCache.h"
+#include <set>
+#include "Utils/BinaryFileStream.h"
+#include "Utils/OS.h"
+#include "Utils/StringUtils.h"
+#include "API/VAO.h"
+#include "Graphics/TextureHelper.h"
+
+namespace Falcor
+{
+    static const char kCacheFormatID[] = "FscCache";
+
+    /** Kinds of objects a path can be attached to
+    */
+    enum class AttachedObjectType : uint32_t
+    {
+        ModelInstance,
+        Camera,
+        Light,
+    };
+
+    static void writeCacheString(BinaryFileStream& stream, const std::string& str)
+    {
+        stream << (uint32_t)str.size();
+        stream.write(str.c_str(), str.size());
+    }
+
+    static std::string readCacheString(BinaryFileStream& stream)
+    {
+        uint32_t size = 0;
+        stream >> size;
+        if(stream.isGood() == false || size > stream.getRemainingStreamSize())
+        {
+            return std::string();
+        }
+        std::string str(size, '\0');
+        stream.read(&str[0], size);
+        return str;
+    }
+
+    static void writeTextureFilename(BinaryFileStream& stream, const Texture::SharedPtr& pTexture)
+    {
+        writeCacheString(stream, pTexture ? pTexture->getSourceFilename() : std::string());
+    }
+
+    static Texture::SharedPtr readTexture(BinaryFileStream& stream, bool isSrgb)
+    {
+        std::string filename = readCacheString(stream);
+        return filename.empty() ? nullptr : createTextureFromFile(filename, true, isSrgb);
+    }
+
+    /** Check if a model can be written in the binary model format without losing data
+    */
+    static bool canExportToBinary(const Model* pModel)
+    {
+        if(pModel->hasBones() || pModel->hasAnimations() || hasSuffix(pModel->getFilename(), ".bin", false))
+        {
+            return false;
+        }
+
+        for(uint32_t i = 0; i < pModel->getMeshCount(); i++)
+        {
+            const auto& pMesh = pModel->getMesh(i);
+            if(pMesh->hasCompactVertices() || pMesh->isInGeometryArena() || pMesh->getVao()->getPrimitiveTopology() != Vao::Topology::TriangleList)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /** Add the source files of the textures a binary model embeds.
+        Texture source filenames are relative to a data directory, so they are resolved to full paths first, the same way the model files are.
+    */
+    static void addTextureDependencies(const Model* pModel, std::set<std::string>& dependencies)
+    {
+        auto addTexture = [&dependencies](const Texture::SharedPtr& pTexture)
+        {
+            std::string fullpath;
+            if(pTexture && pTexture->getSourceFilename().size() && findFileInDataDirectories(pTexture->getSourceFilename(), fullpath))
+            {
+                dependencies.insert(fullpath);
+            }
+        };
+
+        for(uint32_t i = 0; i < pModel->getMeshCount(); i++)
+        {
+            const auto& pMaterial = pModel->getMesh(i)->getMaterial();
+            for(uint32_t l = 0; l < pMaterial->getNumLayers(); l++)
+            {
+                addTexture(pMaterial->getLayer(l).pTexture);
+            }
+            addTexture(pMaterial->getNormalMap());
+            addTexture(pMaterial->getAlphaMap());
+            addTexture(pMaterial->getAmbientOcclusionMap());
+            addTexture(pMaterial->getHeightMap());
+        }
+    }
+
+    std::string SceneCache::getCacheFilename(const std::string& sceneFullpath)
+    {
+        return sceneFullpath + ".cache";
+    }
+
+    bool SceneCache::save(const std::string& sceneFullpath, const Scene* pScene, const std::vector<std::string>& dependencies, uint32_t modelLoadFlags, uint32_t sceneLoadFlags)
+    {
+        if(sceneLoadFlags & Scene::LoadMaterialHistory)
+        {
+            // The history references meshes by index, which the binary models don't preserve
+            return false;
+        }
+
+        const std::string cacheFile = getCacheFilename(sceneFullpath);
+
+        // Write the models first, the textures they embed are dependencies of the cache
+        std::set<std::string> allDependencies(dependencies.begin(), dependencies.end());
+        std::vector<std::string> binaryModels(pScene->getModelCount());
+        for(uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = pScene->getModel(modelID).get();
+            if(canExportToBinary(pModel))
+            {
+                std::string binaryFile = cacheFile + '.' + std::to_string(modelID) + ".bin";
+                Model::SharedPtr pMutableModel = pScene->getModel(modelID);
+                pMutableModel->exportToBinaryFile(binaryFile);
+
+                // The exporter deletes the file on error. Fall back to the source file in that case.
+                if(doesFileExist(binaryFile))
+                {
+                    binaryModels[modelID] = binaryFile;
+                    addTextureDependencies(pModel, allDependencies);
+                }
+            }
+        }
+
+        BinaryFileStream stream(cacheFile, BinaryFileStream::Mode::Write);
+        if(stream.isGood() == false)
+        {
+            logWarning("Can't write scene cache " + cacheFile);
+            return false;
+        }
+
+        // Header
+        stream.write(kCacheFormatID, 8);
+        stream << (uint32_t)kVersion << modelLoadFlags << sceneLoadFlags;
+        stream << (uint32_t)allDependencies.size();
+        for(const auto& file : allDependencies)
+        {
+            writeCacheString(stream, file);
+            stream << (int64_t)getFileModifiedTime(file);
+        }
+
+        // Global settings
+        stream << pScene->getVersion() << pScene->getAmbientIntensity() << pScene->getCameraSpeed() << pScene->getLightingScale();
+
+        // Materials
+        stream << pScene->getMaterialCount();
+        for(uint32_t i = 0; i < pScene->getMaterialCount(); i++)
+        {
+            const auto& pMaterial = pScene->getMaterial(i);
+            writeCacheString(stream, pMaterial->getName());
+            stream << pMaterial->getId() << pMaterial->isDoubleSided();
+            writeTextureFilename(stream, pMaterial->getAlphaMap());
+            writeTextureFilename(stream, pMaterial->getNormalMap());
+            writeTextureFilename(stream, pMaterial->getHeightMap());
+            writeTextureFilename(stream, pMaterial->getAmbientOcclusionMap());
+
+            stream << pMaterial->getNumLayers();
+            for(uint32_t l = 0; l < pMaterial->getNumLayers(); l++)
+            {
+                Material::Layer layer = pMaterial->getLayer(l);
+                stream << layer.type << layer.ndf << layer.blend << layer.albedo << layer.roughness << layer.extraParam;
+                writeTextureFilename(stream, layer.pTexture);
+            }
+        }
+
+        // Models and their instances
+        // Objects paths can be attached to, and their index in the cache. Model instances are numbered across all the models.
+        std::map<const IMovableObject*, std::pair<uint32_t, uint32_t>> attachableObjects;
+        uint32_t instanceIndex = 0;
+        stream << pScene->getModelCount();
+        for(uint32_t modelID = 0; modelID < pScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = pScene->getModel(modelID).get();
+            writeCacheString(stream, binaryModels[modelID]);
+            writeCacheString(stream, pModel->getFilename());
+            writeCacheString(stream, pModel->getName());
+            stream << pModel->hasAnimations() << (pModel->hasAnimations() ? pModel->getActiveAnimation() : 0);
+
+            stream << pScene->getModelInstanceCount(modelID);
+            for(uint32_t i = 0; i < pScene->getModelInstanceCount(modelID); i++)
+            {
+                const auto& pInstance = pScene->getModelInstance(modelID, i);
+                writeCacheString(stream, pInstance->getName());
+                stream << pInstance->getTranslation() << pInstance->getEulerRotation() << pInstance->getScaling();
+                attachableObjects[pInstance.get()] = std::make_pair((uint32_t)AttachedObjectType::ModelInstance, instanceIndex++);
+            }
+        }
+
+        // Lights. Area lights are derived from the models, so they are generated again on load.
+        std::vector<const Light*> lights;
+        for(uint32_t i = 0; i < pScene->getLightCount(); i++)
+        {
+            const Light* pLight = pScene->getLight(i).get();
+            if(pLight->getType() == LightPoint || pLight->getType() == LightDirectional)
+            {
+                attachableObjects[pLight] = std::make_pair((uint32_t)AttachedObjectType::Light, (uint32_t)lights.size());
+                lights.push_back(pLight);
+            }
+        }
+
+        stream << (uint32_t)lights.size();
+        for(const Light* pLight : lights)
+        {
+            stream << pLight->getType();
+            writeCacheString(stream, pLight->getName());
+            if(pLight->getType() == LightPoint)
+            {
+                const PointLight* pPoint = static_cast<const PointLight*>(pLight);
+                stream << pPoint->getIntensity() << pPoint->getWorldDirection() << pPoint->getWorldPosition() << pPoint->getOpeningAngle() << pPoint->getPenumbraAngle();
+            }
+            else
+            {
+                const DirectionalLight* pDir = static_cast<const DirectionalLight*>(pLight);
+                stream << pDir->getIntensity() << pDir->getWorldDirection();
+            }
+        }
+
+        // Cameras
+        stream << pScene->getCameraCount();
+        for(uint32_t i = 0; i < pScene->getCameraCount(); i++)
+        {
+            const auto& pCamera = pScene->getCamera(i);
+            writeCacheString(stream, pCamera->getName());
+            stream << pCamera->getPosition() << pCamera->getTarget() << pCamera->getUpVector();
+            stream << pCamera->getFovY() << pCamera->getNearPlane() << pCamera->getFarPlane() << pCamera->getAspectRatio();
+            attachableObjects[pCamera.get()] = std::make_pair((uint32_t)AttachedObjectType::Camera, i);
+        }
+        stream << pScene->getActiveCameraIndex();
+
+        // Paths
+        stream << pScene->getPathCount();
+        for(uint32_t pathID = 0; pathID < pScene->getPathCount(); pathID++)
+        {
+            const auto& pPath = pScene->getPath(pathID);
+            writeCacheString(stream, pPath->getName());
+            stream << pPath->isRepeatOn();
+
+            stream << pPath->getKeyFrameCount();
+            for(uint32_t f = 0; f < pPath->getKeyFrameCount(); f++)
+            {
+                const auto& frame = pPath->getKeyFrame(f);
+                stream << frame.time << frame.position << frame.target << frame.up;
+            }
+
+            std::vector<std::pair<uint32_t, uint32_t>> attached;
+            for(uint32_t i = 0; i < pPath->getAttachedObjectCount(); i++)
+            {
+                const auto& it = attachableObjects.find(pPath->getAttachedObject(i).get());
+                if(it != attachableObjects.end())
+                {
+                    attached.push_back(it->second);
+                }
+            }
+            stream << (uint32_t)attached.size();
+            for(const auto& a : attached)
+            {
+                stream << a.first << a.second;
+            }
+        }
+
+        // User variables
+        stream << pScene->getUserVariableCount();
+        for(uint32_t varID = 0; varID < pScene->getUserVariableCount(); varID++)
+        {
+            std::string name;
+            const auto& var = pScene->getUserVariable(varID, name);
+            writeCacheString(stream, name);
+            stream << var.type;
+            switch(var.type)
+            {
+            case Scene::UserVariable::Type::String:
+                writeCacheString(stream, var.str);
+                break;
+            case Scene::UserVariable::Type::Vec2:
+                stream << var.vec2;
+                break;
+            case Scene::UserVariable::Type::Vec3:
+                stream << var.vec3;
+                break;
+            case Scene::UserVariable::Type::Vec4:
+                stream << var.vec4;
+                break;
+            case Scene::UserVariable::Type::Vector:
+                stream << (uint32_t)var.vector.size();
+                stream.write(var.vector.data(), var.vector.size() * sizeof(float));
+                break;
+            default:
+                // The scalar types share the union
+                stream << var.u64;
+                break;
+            }
+        }
+
+        if(stream.isGood() == false)
+        {
+            logWarning("Failed writing scene cache " + cacheFile);
+            stream.remove();
+            return false;
+        }
+        return true;
+    }
+
+    struct CachedModel
+    {
+        struct Instance
+        {
+            std::string name;
+            glm::vec3 translation;
+            glm::vec3 rotation;
+            glm::vec3 scaling;
+        };
+
+        std::string binaryFile;
+        std::string filename;
+        std::string name;
+        bool hasAnimations = false;
+        uint32_t activeAnimation = 0;
+        std::vector<Instance> instances;
+    };
+
+    Scene::SharedPtr SceneCache::load(const std::string& sceneFullpath, uint32_t modelLoadFlags, uint32_t sceneLoadFlags)
+    {
+        const std::string cacheFile = getCacheFilename(sceneFullpath);
+        if((sceneLoadFlags & Scene::LoadMaterialHistory) || doesFileExist(cacheFile) == false)
+        {
+            return nullptr;
+        }
+
+        BinaryFileStream stream(cacheFile, BinaryFileStream::Mode::Read);
+
+        // Validate the header and the source files
+        char formatID[8];
+        stream.read(formatID, 8);
+        uint32_t version = 0, cachedModelFlags = 0, cachedSceneFlags = 0;
+        stream >> version >> cachedModelFlags >> cachedSceneFlags;
+        if(stream.isGood() == false || strncmp(formatID, kCacheFormatID, 8) != 0 || version != kVersion)
+        {
+            logInfo("Scene cache " + cacheFile + " has an unsupported version, it will be rebuilt");
+            return nullptr;
+        }
+        if(cachedModelFlags != modelLoadFlags || cachedSceneFlags != sceneLoadFlags)
+        {
+            logInfo("Scene cache " + cacheFile + " was created with different load flags, it will be rebuilt");
+            return nullptr;
+        }
+
+        uint32_t dependencyCount = 0;
+        stream >> dependencyCount;
+        for(uint32_t i = 0; i < dependencyCount; i++)
+        {
+            std::string file = readCacheString(stream);
+            int64_t modifiedTime = 0;
+            stream >> modifiedTime;
+            if(stream.isGood() == false || doesFileExist(file) == false || (int64_t)getFileModifiedTime(file) != modifiedTime)
+            {
+                logInfo("Scene cache " + cacheFile + " is out-of-date, it will be rebuilt");
+                return nullptr;
+            }
+        }
+
+        Scene::SharedPtr pScene = Scene::create();
+
+        // Global settings
+        uint32_t sceneVersion;
+        glm::vec3 ambientIntensity;
+        float cameraSpeed, lightingScale;
+        stream >> sceneVersion >> ambientIntensity >> cameraSpeed >> lightingScale;
+        pScene->setVersion(sceneVersion);
+        pScene->setAmbientIntensity(ambientIntensity);
+        pScene->setCameraSpeed(cameraSpeed);
+        pScene->setLightingScale(lightingScale);
+
+        // Materials
+        uint32_t materialCount = 0;
+        stream >> materialCount;
+        for(uint32_t i = 0; i < materialCount && stream.isGood(); i++)
+        {
+            auto pMaterial = Material::create(readCacheString(stream));
+            int32_t id;
+            bool doubleSided;
+            stream >> id >> doubleSided;
+            pMaterial->setID(id);
+            pMaterial->setDoubleSided(doubleSided);
+            pMaterial->setAlphaMap(readTexture(stream, false));
+            pMaterial->setNormalMap(readTexture(stream, false));
+            pMaterial->setHeightMap(readTexture(stream, false));
+            pMaterial->setAmbientOcclusionMap(readTexture(stream, true));
+
+            uint32_t layerCount = 0;
+            stream >> layerCount;
+            for(uint32_t l = 0; l < layerCount && stream.isGood(); l++)
+            {
+                Material::Layer layer;
+                stream >> layer.type >> layer.ndf >> layer.blend >> layer.albedo >> layer.roughness >> layer.extraParam;
+                layer.pTexture = readTexture(stream, true);
+                pMaterial->addLayer(layer);
+            }
+            pScene->addMaterial(pMaterial);
+        }
+
+        // Models. Start all the loads before waiting for any of them, like the importer does.
+        uint32_t modelCount = 0;
+        stream >> modelCount;
+        std::vector<CachedModel> models;
+        for(uint32_t modelID = 0; modelID < modelCount && stream.isGood(); modelID++)
+        {
+            CachedModel model;
+            model.binaryFile = readCacheString(stream);
+            model.filename = readCacheString(stream);
+            model.name = readCacheString(stream);
+            stream >> model.hasAnimations >> model.activeAnimation;
+
+            uint32_t instanceCount = 0;
+            stream >> instanceCount;
+            for(uint32_t i = 0; i < instanceCount && stream.isGood(); i++)
+            {
+                CachedModel::Instance instance;
+                instance.name = readCacheString(stream);
+                stream >> instance.translation >> instance.rotation >> instance.scaling;
+                model.instances.push_back(instance);
+            }
+            models.push_back(std::move(model));
+        }
+
+        if(stream.isGood() == false)
+        {
+            logWarning("Scene cache " + cacheFile + " is corrupted, it will be rebuilt");
+            return nullptr;
+        }
+
+        std::vector<Model::LoadHandle> modelLoads;
+        for(const auto& model : models)
+        {
+            modelLoads.push_back(Model::createFromFileAsync(model.binaryFile.size() ? model.binaryFile : model.filename, modelLoadFlags));
+        }
+
+        std::vector<Scene::ModelInstance::SharedPtr> instances;
+        for(uint32_t modelID = 0; modelID < (uint32_t)models.size(); modelID++)
+        {
+            const CachedModel& model = models[modelID];
+            Model::SharedPtr pModel = Model::waitForModel(modelLoads[modelID]);
+            if(pModel == nullptr)
+            {
+                logWarning("Scene cache " + cacheFile + " references a model which can't be loaded, the scene will be imported again");
+                return nullptr;
+            }
+
+            pModel->setFilename(model.filename);
+            pModel->setName(model.name);
+            if(model.hasAnimations && model.activeAnimation < pModel->getAnimationsCount())
+            {
+                pModel->setActiveAnimation(model.activeAnimation);
+            }
+
+            for(const auto& instance : model.instances)
+            {
+                auto pInstance = Scene::ModelInstance::create(pModel, instance.translation, instance.rotation, instance.scaling, instance.name);
+                if(pInstance == nullptr)
+                {
+                    return nullptr;
+                }
+                pScene->addModelInstance(pInstance);
+                instances.push_back(pInstance);
+            }
+        }
+
+        // Lights
+        uint32_t lightCount = 0;
+        stream >> lightCount;
+        std::vector<Light::SharedPtr> lights;
+        for(uint32_t i = 0; i < lightCount && stream.isGood(); i++)
+        {
+            uint32_t type;
+            stream >> type;
+            std::string name = readCacheString(stream);
+            glm::vec3 intensity, direction;
+            stream >> intensity >> direction;
+
+            Light::SharedPtr pLight;
+            if(type == LightPoint)
+            {
+                glm::vec3 position;
+                float openingAngle, penumbraAngle;
+                stream >> position >> openingAngle >> penumbraAngle;
+
+                auto pPoint = PointLight::create();
+                pPoint->setIntensity(intensity);
+                pPoint->setWorldDirection(direction);
+                pPoint->setWorldPosition(position);
+                // The penumbra is clamped to the opening angle, so set the opening angle first
+                pPoint->setOpeningAngle(openingAngle);
+                pPoint->setPenumbraAngle(penumbraAngle);
+                pLight = pPoint;
+            }
+            else
+            {
+                auto pDir = DirectionalLight::create();
+                pDir->setIntensity(intensity);
+                pDir->setWorldDirection(direction);
+                pLight = pDir;
+            }
+            pLight->setName(name);
+            pScene->addLight(pLight);
+            lights.push_back(pLight);
+        }
+
+        // Cameras. New scenes are created with a default camera, which was stored with the others if the scene file had no cameras.
+        uint32_t cameraCount = 0;
+        stream >> cameraCount;
+        if(cameraCount > 0)
+        {
+            pScene->deleteCamera(0);
+        }
+        for(uint32_t i = 0; i < cameraCount && stream.isGood(); i++)
+        {
+            auto pCamera = Camera::create();
+            pCamera->setName(readCacheString(stream));
+            glm::vec3 position, target, up;
+            float fovY, nearZ, farZ, aspectRatio;
+            stream >> position >> target >> up >> fovY >> nearZ >> farZ >> aspectRatio;
+            pCamera->setPosition(position);
+            pCamera->setTarget(target);
+            pCamera->setUpVector(up);
+            pCamera->setFovY(fovY);
+            pCamera->setDepthRange(nearZ, farZ);
+            pCamera->setAspectRatio(aspectRatio);
+            pScene->addCamera(pCamera);
+        }
+        uint32_t activeCamera = 0;
+        stream >> activeCamera;
+        if(activeCamera < pScene->getCameraCount())
+        {
+            pScene->setActiveCamera(activeCamera);
+        }
+
+        // Paths
+        uint32_t pathCount = 0;
+        stream >> pathCount;
+        for(uint32_t pathID = 0; pathID < pathCount && stream.isGood(); pathID++)
+        {
+            auto pPath = ObjectPath::create();
+            pPath->setName(readCacheString(stream));
+            bool repeat;
+            stream >> repeat;
+            pPath->setAnimationRepeat(repeat);
+
+            uint32_t frameCount = 0;
+            stream >> frameCount;
+            for(uint32_t f = 0; f < frameCount && stream.isGood(); f++)
+            {
+                ObjectPath::Frame frame;
+                stream >> frame.time >> frame.position >> frame.target >> frame.up;
+                pPath->addKeyFrame(frame.time, frame.position, frame.target, frame.up);
+            }
+
+            uint32_t attachedCount = 0;
+            stream >> attachedCount;
+            for(uint32_t i = 0; i < attachedCount && stream.isGood(); i++)
+            {
+                uint32_t type, index;
+                stream >> type >> index;
+                IMovableObject::SharedPtr pObject;
+                switch((AttachedObjectType)type)
+                {
+                case AttachedObjectType::ModelInstance:
+                    pObject = (index < instances.size()) ? instances[index] : nullptr;
+                    break;
+                case AttachedObjectType::Camera:
+                    pObject = (index < pScene->getCameraCount()) ? pScene->getCamera(index) : nullptr;
+                    break;
+                case AttachedObjectType::Light:
+                    pObject = (index < lights.size()) ? lights[index] : nullptr;
+                    break;
+                }
+
+                if(pObject)
+                {
+                    pPath->attachObject(pObject);
+                }
+            }
+            pScene->addPath(pPath);
+        }
+
+        // User variables
+        uint32_t varCount = 0;
+        stream >> varCount;
+        for(uint32_t varID = 0; varID < varCount && stream.isGood(); varID++)
+        {
+            std::string name = readCacheString(stream);
+            Scene::UserVariable var;
+            stream >> var.type;
+            switch(var.type)
+            {
+            case Scene::UserVariable::Type::String:
+                var.str = readCacheString(stream);
+                break;
+            case Scene::UserVariable::Type::Vec2:
+                stream >> var.vec2;
+                break;
+            case Scene::UserVariable::Type::Vec3:
+                stream >> var.vec3;
+                break;
+            case Scene::UserVariable::Type::Vec4:
+                stream >> var.vec4;
+                break;
+            case Scene::UserVariable::Type::Vector:
+            {
+                uint32_t size = 0;
+                stream >> size;
+                if(size * sizeof(float) > stream.getRemainingStreamSize())
+                {
+                    size = 0;
+                }
+                var.vector.resize(size);
+                stream.read(var.vector.data(), size * sizeof(float));
+                break;
+            }
+            default:
+                stream >> var.u64;
+                break;
+            }
+            pScene->addUserVariable(name, var);
+        }
+
+        if(stream.isFail())
+        {
+            logWarning("Scene cache " + cacheFile + " is corrupted, it will be rebuilt");
+            return nullptr;
+        }
+
+        if(sceneLoadFlags & Scene::GenerateAreaLights)
+        {
+            pScene->createAreaLights();
+        }
+
+        return pScene;
+    }
+}
@@ -0,0 +1,68 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include "Scene.h"
+
+namespace Falcor
+{
+    /** Compiled cache of a scene file.
+        The cache holds the resolved scene: global settings, materials, model instances, lights, cameras, paths and user variables. Models are stored as binary model files next to the cache, so later loads skip the JSON parsing, the includes and the model importers.
+        Models the binary format can't represent (bones, animations, compact vertices) are referenced by their source file and loaded again.
+        The cache is valid as long as the recorded source files (the scene, its includes, the model files and the textures embedded in the binary models) keep their modification time, and the load flags match.
+        Area lights are not stored. They are generated again when the scene is loaded with Scene::GenerateAreaLights.
+    */
+    class SceneCache
+    {
+    public:
+        static const uint32_t kVersion = 1;
+
+        /** Get the name of the cache file of a scene, which is '<scene fullpath>.cache'
+        */
+        static std::string getCacheFilename(const std::string& sceneFullpath);
+
+        /** Load a scene from its cache
+            \param[in] sceneFullpath Full path of the scene file
+            \param[in] modelLoadFlags Flags the scene is loaded with. Must match the flags the cache was written with.
+            \param[in] sceneLoadFlags Flags the scene is loaded with. Must match the flags the cache was written with.
+            \return The scene, or nullptr if the cache doesn't exist or is out-of-date
+        */
+        static Scene::SharedPtr load(const std::string& sceneFullpath, uint32_t modelLoadFlags, uint32_t sceneLoadFlags);
+
+        /** Write the cache of a scene
+            \param[in] sceneFullpath Full path of the scene file
+            \param[in] pScene The scene, as created by the importer
+            \param[in] dependencies The files the scene was created from. See SceneImporter::loadScene().
+            \param[in] modelLoadFlags Flags the scene was loaded with
+            \param[in] sceneLoadFlags Flags the scene was loaded with
+            \return true if the cache was written
+        */
+        static bool save(const std::string& sceneFullpath, const Scene* pScene, const std::vector<std::string>& dependencies, uint32_t modelLoadFlags, uint32_t sceneLoadFlags);
+    };
+}
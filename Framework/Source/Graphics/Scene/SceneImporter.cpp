@@ -95,6 +95,13 @@ namespace Falcor
         return importer.load(filename, modelLoadFlags, sceneLoadFlags);
     }
 
+    Scene::SharedPtr SceneImporter::loadScene(const std::string& filename, uint32_t modelLoadFlags, uint32_t sceneLoadFlags, std::vector<std::string>& dependencies)
+    {
+        SceneImporter importer;
+        importer.mpDependencies = &dependencies;
+        return importer.load(filename, modelLoadFlags, sceneLoadFlags);
+    }
+
     Scene* SceneImporter::error(const std::string& msg)
     {
         std::string err = "Error when parsing scene file \"" + mFilename + "\".\n" + msg;
@@ -175,6 +182,11 @@ namespace Falcor
             else
             {
                 auto pInstance = Scene::ModelInstance::create(pModel, translation, rotation, scaling, name);
+                if (pInstance == nullptr)
+                {
+                    error("Can't create model instance " + name + ".");
+                    return false;
+                }
                 mInstanceMap[pInstance->getName()] = pInstance;
                 mpScene->addModelInstance(pInstance);
             }
@@ -183,7 +195,7 @@ namespace Falcor
         return true;
     }
 
-    bool SceneImporter::createModel(const rapidjson::Value& jsonModel)
+    bool SceneImporter::getModelFilename(const rapidjson::Value& jsonModel, std::string& filename)
     {
         // Model must have at least a filename
         if(jsonModel.HasMember(SceneKeys::kFilename) == false)
@@ -197,15 +209,26 @@ namespace Falcor
             error("Model filename must be a string");
             return false;
         }
+        filename = modelFile.GetString();
+        return true;
+    }
 
-        // Load the model
-        auto pModel = Model::createFromFile(modelFile.GetString(), mModelLoadFlags);
+    bool SceneImporter::createModel(const rapidjson::Value& jsonModel, const Model::LoadHandle& modelLoad)
+    {
+        std::string filename;
+        if(getModelFilename(jsonModel, filename) == false)
+        {
+            return false;
+        }
+
+        // Finish loading the model. Entries which use the same file share the load, but each of them gets its own model, since the name, material overrides and instances are per entry.
+        auto pModel = Model::createFromLoad(modelLoad);
         if(pModel == nullptr)
         {
             return false;
         }
 
-        pModel->setFilename(modelFile.GetString());
+        pModel->setFilename(filename);
 
         bool instanceAdded = false;
 
@@ -338,10 +361,35 @@ namespace Falcor
             return false;
         }
 
-        // Loop over the array
+        // Start all the loads before creating any model, so that the files are parsed concurrently. Models which use the same file share a load, so the file is only read once.
+        std::vector<Model::LoadHandle> modelLoads(jsonVal.Size());
+        std::map<std::string, Model::LoadHandle> loadsByFilename;
         for(uint32_t i = 0; i < jsonVal.Size(); i++)
         {
-            if(createModel(jsonVal[i]) == false)
+            std::string filename;
+            if(getModelFilename(jsonVal[i], filename) == false)
+            {
+                return false;
+            }
+
+            Model::LoadHandle& pLoad = loadsByFilename[filename];
+            if(pLoad == nullptr)
+            {
+                pLoad = Model::createFromFileAsync(filename, mModelLoadFlags);
+
+                std::string fullpath;
+                if(mpDependencies && findFileInDataDirectories(filename, fullpath))
+                {
+                    mpDependencies->push_back(fullpath);
+                }
+            }
+            modelLoads[i] = pLoad;
+        }
+
+        // Instances, material overrides and animations are applied in file order, so the result doesn't depend on which file finished loading first
+        for(uint32_t i = 0; i < jsonVal.Size(); i++)
+        {
+            if(createModel(jsonVal[i], modelLoads[i]) == false)
             {
                 return false;
             }
@@ -1206,6 +1254,11 @@ namespace Falcor
 
         if(findFileInDataDirectories(filename, fullpath))
         {
+            if(mpDependencies)
+            {
+                mpDependencies->push_back(fullpath);
+            }
+
             // Load the file
             std::ifstream fileStream(fullpath);
             std::stringstream strStream;
@@ -1443,7 +1496,15 @@ namespace Falcor
             }
         }
 
-        Scene::SharedPtr pScene = SceneImporter::loadScene(fullpath, mModelLoadFlags, mSceneLoadFlags);
+        Scene::SharedPtr pScene;
+        if(mpDependencies)
+        {
+            pScene = SceneImporter::loadScene(fullpath, mModelLoadFlags, mSceneLoadFlags, *mpDependencies);
+        }
+        else
+        {
+            pScene = SceneImporter::loadScene(fullpath, mModelLoadFlags, mSceneLoadFlags);
+        }
         if(pScene == nullptr)
         {
             return false;
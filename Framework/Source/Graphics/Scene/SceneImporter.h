@@ -42,6 +42,11 @@ namespace Falcor
 
         static Scene::SharedPtr loadScene(const std::string& filename, uint32_t modelLoadFlags, uint32_t sceneLoadFlags);
 
+        /** Load a scene and report the files it was created from
+            \param[out] dependencies Receives the full paths of the scene file, its includes and its model files
+        */
+        static Scene::SharedPtr loadScene(const std::string& filename, uint32_t modelLoadFlags, uint32_t sceneLoadFlags, std::vector<std::string>& dependencies);
+
     private:
 
         SceneImporter() = default;
@@ -65,7 +70,8 @@ namespace Falcor
 
         bool loadIncludeFile(const std::string& Include);
 
-        bool createModel(const rapidjson::Value& jsonModel);
+        bool getModelFilename(const rapidjson::Value& jsonModel, std::string& filename);
+        bool createModel(const rapidjson::Value& jsonModel, const Model::LoadHandle& modelLoad);
         bool setMaterialOverrides(const rapidjson::Value& jsonVal, const Model::SharedPtr& pModel);
         bool createModelInstances(const rapidjson::Value& jsonVal, const Model::SharedPtr& pModel);
         bool createPointLight(const rapidjson::Value& jsonLight);
@@ -95,6 +101,7 @@ namespace Falcor
         std::string mDirectory;
         uint32_t mModelLoadFlags = 0;
         uint32_t mSceneLoadFlags = 0;
+        std::vector<std::string>* mpDependencies = nullptr;
 
         using ObjectMap = std::map<std::string, IMovableObject::SharedPtr>;
         bool isNameDuplicate(const std::string& name, const ObjectMap& objectMap, const std::string& objectType) const;
@@ -37,19 +37,23 @@
 #include "API/Device.h"
 #include "glm/matrix.hpp"
 #include "Graphics/Material/MaterialSystem.h"
+#include "Data/VertexAttrib.h"
+#include <algorithm>
 
 namespace Falcor
 {
     size_t SceneRenderer::sBonesOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sCameraDataOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sWorldMatOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sMeshIdOffset = ConstantBuffer::kInvalidOffset;
     size_t SceneRenderer::sDrawIDOffset = ConstantBuffer::kInvalidOffset;
+    size_t SceneRenderer::sPosDequantScaleOffset = ConstantBuffer::kInvalidOffset;
+    size_t SceneRenderer::sPosDequantOffsetOffset = ConstantBuffer::kInvalidOffset;
 
     const char* SceneRenderer::kPerMaterialCbName = "InternalPerMaterialCB";
     const char* SceneRenderer::kPerFrameCbName = "InternalPerFrameCB";
     const char* SceneRenderer::kPerStaticMeshCbName = "InternalPerStaticMeshCB";
     const char* SceneRenderer::kPerSkinnedMeshCbName = "InternalPerSkinnedMeshCB";
+    const std::string SceneRenderer::kCameraVarName = "gCam";
 
     SceneRenderer::UniquePtr SceneRenderer::create(const Scene::SharedPtr& pScene)
     {
@@ -72,16 +76,12 @@ namespace Falcor
                 sWorldMatOffset = pPerMeshCbData->getVariableData("gWorldMat[0]")->location;
                 sMeshIdOffset = pPerMeshCbData->getVariableData("gMeshId")->location;
                 sDrawIDOffset = pPerMeshCbData->getVariableData("gDrawId[0]")->location;
-            }
-        }
-
-        if (sCameraDataOffset == ConstantBuffer::kInvalidOffset)
-        {
-            const auto pPerFrameCbData = pReflector->getBufferDesc(kPerFrameCbName, ProgramReflection::BufferReflection::Type::Constant);
 
-            if (pPerFrameCbData != nullptr)
-            {
-                sCameraDataOffset = pPerFrameCbData->getVariableData("gCam.viewMat")->location;
+                // Only used by shaders compiled with COMPACT_VERTICES
+                const auto pScaleData = pPerMeshCbData->getVariableData("gPosDequantScale");
+                const auto pOffsetData = pPerMeshCbData->getVariableData("gPosDequantOffset");
+                sPosDequantScaleOffset = pScaleData ? pScaleData->location : ConstantBuffer::kInvalidOffset;
+                sPosDequantOffsetOffset = pOffsetData ? pOffsetData->location : ConstantBuffer::kInvalidOffset;
             }
         }
     }
@@ -94,7 +94,18 @@ namespace Falcor
             ConstantBuffer* pCB = pContext->getGraphicsVars()->getConstantBuffer(kPerFrameCbName).get();
             if (pCB)
             {
-                currentData.pCamera->setIntoConstantBuffer(pCB, sCameraDataOffset);
+                currentData.pCamera->setIntoConstantBuffer(pCB, kCameraVarName);
+            }
+
+            // Only programs which include LightClusters.hlsli use the clusters, skip the binning for the others
+            if (mpLightClusterer)
+            {
+                GraphicsVars* pVars = pContext->getGraphicsVars().get();
+                if (pVars->getReflection()->getBufferDesc(LightClusterer::kConstantBufferName, ProgramReflection::BufferReflection::Type::Constant))
+                {
+                    mpLightClusterer->build(currentData.pCamera, mpScene->getLights());
+                    mpLightClusterer->setIntoProgramVars(pVars);
+                }
             }
         }
     }
@@ -145,6 +156,12 @@ namespace Falcor
 
             // Set mesh id
             pCB->setVariable(sMeshIdOffset, pMesh->getId());
+
+            if (pMesh->hasCompactVertices() && (sPosDequantScaleOffset != ConstantBuffer::kInvalidOffset))
+            {
+                pCB->setVariable(sPosDequantScaleOffset, pMesh->getPositionDequantScale());
+                pCB->setVariable(sPosDequantOffsetOffset, pMesh->getPositionDequantOffset());
+            }
         }
 
         return true;
@@ -163,18 +180,18 @@ namespace Falcor
         return true;
     }
 
-    void SceneRenderer::flushDraw(RenderContext* pContext, const Mesh* pMesh, uint32_t instanceCount, CurrentWorkingData& currentData)
+    void SceneRenderer::setMaterial(RenderContext* pContext, const Material* pMaterial, CurrentWorkingData& currentData)
     {
-        currentData.pMaterial = pMesh->getMaterial().get();
+        currentData.pMaterial = pMaterial;
         // Bind material
-        if(mpLastMaterial != pMesh->getMaterial().get())
+        if(mpLastMaterial != pMaterial)
         {
             if(mUnloadTexturesOnMaterialChange && mpLastMaterial)
             {
                 mpLastMaterial->evictTextures();
             }
             setPerMaterialData(pContext, currentData);
-            mpLastMaterial = pMesh->getMaterial().get();
+            mpLastMaterial = pMaterial;
 
             if(mCompileMaterialWithProgram)
             {
@@ -183,10 +200,241 @@ namespace Falcor
 //                 pContext->setProgram(pPatchedProgram);
             }
         }
+    }
+
+    void SceneRenderer::flushDraw(RenderContext* pContext, const Mesh* pMesh, const Mesh::Lod& lod, uint32_t instanceCount, CurrentWorkingData& currentData)
+    {
+        setMaterial(pContext, pMesh->getMaterial().get(), currentData);
 
         // Draw
-        pContext->drawIndexedInstanced(pMesh->getIndexCount(), instanceCount, 0, 0, 0);
+        pContext->drawIndexedInstanced(lod.indexCount, instanceCount, pMesh->getFirstIndex() + lod.firstIndex, pMesh->getBaseVertex(), 0);
         postFlushDraw(pContext, currentData);
+
+        mLodStats.triangleCount += (lod.indexCount / 3) * instanceCount;
+    }
+
+    uint32_t SceneRenderer::selectLod(const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance, float screenSize)
+    {
+        const Mesh* pMesh = pMeshInstance->getObject().get();
+        if((mLodEnabled == false) || (pMesh->getLodCount() == 1))
+        {
+            return 0;
+        }
+
+        auto startTime = CpuTimer::getCurrentTimePoint();
+
+        // The LOD errors are relative to the bounding-box diagonal, and the screen size is the diagonal's projection
+        uint32_t strictLod = 0;
+        uint32_t looseLod = 0;
+        for(uint32_t i = 1; i < pMesh->getLodCount(); i++)
+        {
+            float pixelError = pMesh->getLod(i).error * screenSize;
+            if(pixelError * (1 + mLodHysteresis) <= mLodPixelError)
+            {
+                strictLod = i;
+            }
+            if(pixelError * (1 - mLodHysteresis) <= mLodPixelError)
+            {
+                looseLod = i;
+            }
+        }
+
+        // Keep the previous LOD while it's inside the hysteresis band
+        LodKey key = {pModelInstance, pMeshInstance};
+        auto it = mLodStates.find(key);
+        uint32_t lod = strictLod;
+        if(it == mLodStates.end())
+        {
+            mLodStates[key] = {lod, mFrameCount};
+        }
+        else
+        {
+            lod = std::min(std::max(it->second.lod, strictLod), looseLod);
+            it->second.lod = lod;
+            it->second.lastFrame = mFrameCount;
+        }
+
+        mLodStats.selectionTime += CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        return lod;
+    }
+
+    bool SceneRenderer::isHzbOccluded(const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance, const BoundingBox& box)
+    {
+        // Keep the box for this frame's test, and check the results of an earlier frame
+        LodKey key = {pModelInstance, pMeshInstance};
+        auto it = mHzbSlots.find(key);
+        uint32_t slot;
+        bool isNewSlot = (it == mHzbSlots.end());
+        if (isNewSlot)
+        {
+            if (mHzbFreeSlots.empty())
+            {
+                slot = (uint32_t)mHzbSlotData.size();
+                mHzbSlotData.push_back({0, 0, 0});
+            }
+            else
+            {
+                slot = mHzbFreeSlots.back();
+                mHzbFreeSlots.pop_back();
+            }
+            mHzbSlots[key] = slot;
+        }
+        else
+        {
+            slot = it->second;
+        }
+
+        HzbSlot& slotData = mHzbSlotData[slot];
+        if (isNewSlot || (slotData.lastFrame != mFrameCount))
+        {
+            slotData.lastFrame = mFrameCount;
+            slotData.boxIndex = (uint32_t)mHzbFrameBoxes.size();
+            mHzbFrameBoxes.push_back(box);
+            mHzbFrameEntries.push_back({slot, slotData.generation});
+        }
+        else
+        {
+            mHzbFrameBoxes[slotData.boxIndex] = box;
+        }
+
+        if ((slot < mHzbSlotVisible.size()) && (mHzbSlotVisible[slot] == 0))
+        {
+            mOcclusionStats.hzbOccludedInstanceCount++;
+            return true;
+        }
+        return false;
+    }
+
+    void SceneRenderer::readHzbVisibility()
+    {
+        mHzbFrameBoxes.clear();
+        mHzbFrameEntries.clear();
+        mHzbSlotVisible.assign(mHzbSlotData.size(), 1);
+        if ((mpHzbCulling == nullptr) || (mCullEnabled == false))
+        {
+            return;
+        }
+
+        // The results belong to the oldest pending cull() call. Entries whose slot was released since then belong to an instance which is gone.
+        const std::vector<uint32_t>& visibility = mpHzbCulling->readVisibility();
+        if (visibility.empty() || (mHzbSubmissions.size() <= mpHzbCulling->getReadbackLatency()))
+        {
+            return;
+        }
+
+        const std::vector<HzbEntry>& entries = mHzbSubmissions.front();
+        const size_t count = min(visibility.size(), entries.size());
+        for (size_t i = 0; i < count; i++)
+        {
+            const HzbEntry& entry = entries[i];
+            if ((visibility[i] == 0) && (mHzbSlotData[entry.slot].generation == entry.generation))
+            {
+                mHzbSlotVisible[entry.slot] = 0;
+            }
+        }
+    }
+
+    void SceneRenderer::releaseStaleHzbSlots(uint64_t lifetime)
+    {
+        for (auto it = mHzbSlots.begin(); it != mHzbSlots.end();)
+        {
+            HzbSlot& slotData = mHzbSlotData[it->second];
+            if (mFrameCount - slotData.lastFrame > lifetime)
+            {
+                slotData.generation++;
+                mHzbFreeSlots.push_back(it->second);
+                it = mHzbSlots.erase(it);
+            }
+            else
+            {
+                it++;
+            }
+        }
+    }
+
+    void SceneRenderer::updateHzbCulling(RenderContext* pContext, const Camera* pCamera)
+    {
+        const Fbo* pFbo = pContext->getGraphicsState()->getFbo().get();
+        Texture::SharedPtr pDepth = pFbo ? pFbo->getDepthStencilTexture() : nullptr;
+        if (pDepth && (pDepth->getSampleCount() == 1) && is_set(pDepth->getBindFlags(), Resource::BindFlags::ShaderResource))
+        {
+            mpHzbCulling->buildHzb(pContext, pDepth, pCamera->getViewProjMatrix());
+        }
+        mpHzbCulling->cull(pContext, mHzbFrameBoxes);
+
+        mHzbSubmissions.push_back(std::move(mHzbFrameEntries));
+        mHzbFrameEntries.clear();
+        while (mHzbSubmissions.size() > mpHzbCulling->getReadbackLatency() + 1)
+        {
+            mHzbSubmissions.pop_front();
+        }
+    }
+
+    bool SceneRenderer::isOccluded(const Scene::ModelInstance::SharedPtr& pModelInstance, const Model::MeshInstance::SharedPtr& pMeshInstance, const BoundingBox& box, const Camera* pCamera)
+    {
+        if (mCullEnabled == false)
+        {
+            return false;
+        }
+
+        if (mpHzbCulling && isHzbOccluded(pModelInstance.get(), pMeshInstance.get(), box))
+        {
+            return true;
+        }
+
+        if ((mOcclusionCullingEnabled == false) || (mpOcclusionBuffer == nullptr))
+        {
+            return false;
+        }
+
+        LodKey key = {pModelInstance.get(), pMeshInstance.get()};
+        if (mOccluderKeys.count(key) == 0)
+        {
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            bool visible = mpOcclusionBuffer->isVisible(box);
+            mOcclusionStats.testTime += (float)CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+            mOcclusionStats.testedInstanceCount++;
+            if (visible == false)
+            {
+                mOcclusionStats.occludedInstanceCount++;
+                return true;
+            }
+        }
+
+        // Visible instances can occlude the next frame
+        const Mesh* pMesh = pMeshInstance->getObject().get();
+        if (pMesh->getBvh() && (pMesh->hasBones() == false) && (pMesh->getBvh()->getTriangleCount() <= mMaxOccluderTriangleCount))
+        {
+            mOccluderCandidates.push_back({TextureStreamer::calculateScreenSize(box, pCamera, 1), pModelInstance, pMeshInstance});
+        }
+        return false;
+    }
+
+    void SceneRenderer::renderOccluders(const Camera* pCamera)
+    {
+        if (mpOcclusionBuffer == nullptr)
+        {
+            mpOcclusionBuffer = OcclusionBuffer::create();
+        }
+
+        mpOcclusionBuffer->clear(pCamera->getViewProjMatrix());
+        mOccluderKeys.clear();
+        for (const auto& occluder : mOccluders)
+        {
+            glm::mat4 worldMat = occluder.pModelInstance->getTransformMatrix() * occluder.pMeshInstance->getTransformMatrix();
+            mpOcclusionBuffer->addOccluder(worldMat, occluder.pMeshInstance->getObject()->getBvh().get());
+            mOccluderKeys.insert({occluder.pModelInstance.get(), occluder.pMeshInstance.get()});
+        }
+        mpOcclusionBuffer->rasterize();
+    }
+
+    void SceneRenderer::selectOccluders()
+    {
+        // Keep the instances covering the largest part of the screen
+        size_t count = std::min(mOccluderCandidates.size(), (size_t)mMaxOccluderCount);
+        std::partial_sort(mOccluderCandidates.begin(), mOccluderCandidates.begin() + count, mOccluderCandidates.end(), [](const Occluder& a, const Occluder& b) { return a.screenSize > b.screenSize; });
+        mOccluders.assign(mOccluderCandidates.begin(), mOccluderCandidates.begin() + count);
+        mOccluderCandidates.clear();
     }
 
     void SceneRenderer::postFlushDraw(RenderContext* pContext, const CurrentWorkingData& currentData)
@@ -201,11 +449,14 @@ namespace Falcor
 
         if (setPerMeshData(pContext, currentData))
         {
-            // Bind VAO and set topology
-            pContext->getGraphicsState()->setVao(pMesh->getVao());
-
-            uint32_t activeInstances = 0;
+            // Bind VAO and set topology. Meshes in a geometry arena share the VAO, and setting the same VAO again would still walk the state graph.
+            GraphicsState* pState = pContext->getGraphicsState().get();
+            if (pState->getVao() != pMesh->getVao())
+            {
+                pState->setVao(pMesh->getVao());
+            }
 
+            // Bucket the visible instances by LOD, so that each draw uses a single LOD
             const uint32_t instanceCount = pModel->getMeshInstanceCount(meshID);
             for (uint32_t instanceID = 0; instanceID < instanceCount; instanceID++)
             {
@@ -214,29 +465,214 @@ namespace Falcor
 
                 if ((mCullEnabled == false) || (pCamera->isObjectCulled(box) == false))
                 {
-                    if (meshInstance->isVisible())
+                    if (meshInstance->isVisible() && (isOccluded(pModelInstance, meshInstance, box, pCamera) == false))
+                    {
+                        float screenSize = (mpTextureStreamer || (pMesh->getLodCount() > 1)) ? TextureStreamer::calculateScreenSize(box, pCamera, currentData.viewportHeight) : 0;
+                        if (mpTextureStreamer)
+                        {
+                            mpTextureStreamer->requestMaterial(pMesh->getMaterial().get(), screenSize);
+                        }
+
+                        uint32_t lod = (currentData.viewportHeight != 0) ? selectLod(pModelInstance.get(), meshInstance.get(), screenSize) : 0;
+                        mLodInstances[lod].push_back(instanceID);
+                    }
+                }
+            }
+
+            for (uint32_t lod = 0; lod < pMesh->getLodCount(); lod++)
+            {
+                uint32_t activeInstances = 0;
+                for (uint32_t instanceID : mLodInstances[lod])
+                {
+                    auto& meshInstance = pModel->getMeshInstance(meshID, instanceID);
+                    if (setPerMeshInstanceData(pContext, pModelInstance, meshInstance, activeInstances, currentData))
                     {
-                        if (setPerMeshInstanceData(pContext, pModelInstance, meshInstance, activeInstances, currentData))
+                        currentData.drawID++;
+                        activeInstances++;
+                        mLodStats.instanceCount++;
+                        mLodStats.lodInstanceCount[lod]++;
+
+                        if (activeInstances == mMaxInstanceCount)
                         {
-                            currentData.drawID++;
-                            activeInstances++;
+                            // DISABLED_FOR_D3D12
+                            //pContext->setProgram(currentData.pProgram->getActiveProgramVersion());
+                            flushDraw(pContext, pMesh, pMesh->getLod(lod), activeInstances, currentData);
+                            activeInstances = 0;
+                        }
+                    }
+                }
+                if(activeInstances != 0)
+                {
+                    flushDraw(pContext, pMesh, pMesh->getLod(lod), activeInstances, currentData);
+                }
+                mLodInstances[lod].clear();
+            }
+        }
+    }
+
+    const Vao::SharedPtr& SceneRenderer::getIndirectVao(const Mesh* pMesh)
+    {
+        const Vao::SharedPtr& pMeshVao = pMesh->getVao();
+        IndirectVao& entry = mIndirectVaos[pMeshVao.get()];
+        if((entry.pVao == nullptr) || (entry.pMeshVao.lock() != pMeshVao))
+        {
+            // The mesh's buffers, followed by the per-instance world matrices
+            const VertexLayout* pMeshLayout = pMeshVao->getVertexLayout().get();
+            VertexLayout::SharedPtr pLayout = VertexLayout::create();
+            Vao::BufferVec pVBs;
+            for(uint32_t i = 0; i < (uint32_t)pMeshLayout->getBufferCount(); i++)
+            {
+                pLayout->addBufferLayout(i, pMeshLayout->getBufferLayout(i));
+                pVBs.push_back(i < pMeshVao->getVertexBuffersCount() ? pMeshVao->getVertexBuffer(i) : nullptr);
+            }
+
+            VertexBufferLayout::SharedPtr pInstanceLayout = VertexBufferLayout::create();
+            pInstanceLayout->addElement(VERTEX_INSTANCE_WORLD_MAT_NAME, 0, ResourceFormat::RGBA32Float, 4, VERTEX_INSTANCE_WORLD_MAT_LOC);
+            pInstanceLayout->setInputClass(VertexBufferLayout::InputClass::PerInstanceData, 1);
+            pLayout->addBufferLayout((uint32_t)pVBs.size(), pInstanceLayout);
+            pVBs.push_back(mpInstanceBuffer);
+
+            entry.pMeshVao = pMeshVao;
+            entry.pVao = Vao::create(pVBs, pLayout, pMeshVao->getIndexBuffer(), pMeshVao->getIndexBufferFormat(), pMeshVao->getPrimitiveTopology());
+        }
+        return entry.pVao;
+    }
+
+    void SceneRenderer::addIndirectInstances(const Scene::ModelInstance::SharedPtr& pModelInstance, Camera* pCamera, CurrentWorkingData& currentData)
+    {
+        const Model* pModel = currentData.pModel;
+        const glm::mat4& modelMat = pModelInstance->getTransformMatrix();
+
+        for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+        {
+            const Mesh* pMesh = pModel->getMesh(meshID).get();
+
+            // Meshes which share the VAO and the material are drawn by one batch, with a geometry per mesh and LOD. Meshes in a geometry arena share the VAO.
+            // Compact meshes have their own dequantization constants, so each of them is a batch.
+            const IndirectMesh* pIndirectMesh = nullptr;
+
+            const uint32_t instanceCount = pModel->getMeshInstanceCount(meshID);
+            for (uint32_t instanceID = 0; instanceID < instanceCount; instanceID++)
+            {
+                auto& meshInstance = pModel->getMeshInstance(meshID, instanceID);
+                BoundingBox box = meshInstance->getBoundingBox().transform(modelMat);
+
+                if ((mCullEnabled == false) || (pCamera->isObjectCulled(box) == false))
+                {
+                    if (meshInstance->isVisible() && (isOccluded(pModelInstance, meshInstance, box, pCamera) == false))
+                    {
+                        float screenSize = (mpTextureStreamer || (pMesh->getLodCount() > 1)) ? TextureStreamer::calculateScreenSize(box, pCamera, currentData.viewportHeight) : 0;
+                        if (mpTextureStreamer)
+                        {
+                            mpTextureStreamer->requestMaterial(pMesh->getMaterial().get(), screenSize);
+                        }
 
-                            if (activeInstances == mMaxInstanceCount)
+                        if (pIndirectMesh == nullptr)
+                        {
+                            auto meshIt = mIndirectMeshes.find(pMesh);
+                            if (meshIt == mIndirectMeshes.end())
                             {
-                                // DISABLED_FOR_D3D12
-                                //pContext->setProgram(currentData.pProgram->getActiveProgramVersion());
-                                flushDraw(pContext, pMesh, activeInstances, currentData);
-                                activeInstances = 0;
+                                IndirectBatchKey key = {pMesh->getVao().get(), pMesh->getMaterial().get(), pMesh->hasCompactVertices() ? pMesh : nullptr};
+                                auto batchIt = mIndirectBatchIDs.find(key);
+                                if (batchIt == mIndirectBatchIDs.end())
+                                {
+                                    batchIt = mIndirectBatchIDs.insert(std::make_pair(key, (uint32_t)mIndirectBatchMeshes.size())).first;
+                                    mIndirectBatchMeshes.push_back(pMesh);
+                                }
+
+                                IndirectMesh indirectMesh;
+                                indirectMesh.batchID = batchIt->second;
+                                indirectMesh.firstGeometryID = (uint32_t)mIndirectMeshes.size() * Mesh::kMaxLodCount;
+                                meshIt = mIndirectMeshes.insert(std::make_pair(pMesh, indirectMesh)).first;
                             }
+                            pIndirectMesh = &meshIt->second;
                         }
+
+                        uint32_t lod = (currentData.viewportHeight != 0) ? selectLod(pModelInstance.get(), meshInstance.get(), screenSize) : 0;
+                        const Mesh::Lod& meshLod = pMesh->getLod(lod);
+                        IndirectDrawPacker::Geometry geometry;
+                        geometry.indexCount = meshLod.indexCount;
+                        geometry.startIndex = pMesh->getFirstIndex() + meshLod.firstIndex;
+                        geometry.baseVertex = pMesh->getBaseVertex();
+
+                        mIndirectPacker.addInstance(pIndirectMesh->batchID, pIndirectMesh->firstGeometryID + lod, geometry, modelMat * meshInstance->getTransformMatrix());
+                        currentData.drawID++;
+                        mLodStats.instanceCount++;
+                        mLodStats.lodInstanceCount[lod]++;
+                        mLodStats.triangleCount += meshLod.indexCount / 3;
                     }
                 }
             }
-            if(activeInstances != 0)
+        }
+    }
+
+    void SceneRenderer::flushIndirectDraws(RenderContext* pContext, CurrentWorkingData& currentData)
+    {
+        if (mIndirectPacker.getInstanceCount() != 0)
+        {
+            mIndirectPacker.pack();
+            const auto& transforms = mIndirectPacker.getTransforms();
+            const auto& drawArgs = mIndirectPacker.getDrawArguments();
+
+            // Both buffers live on the upload heap. Each update allocates new memory, so draws recorded earlier in the frame keep their data.
+            const size_t instanceBytes = transforms.size() * sizeof(glm::mat4);
+            if ((mpInstanceBuffer == nullptr) || (mpInstanceBuffer->getSize() < instanceBytes))
+            {
+                size_t size = mpInstanceBuffer ? std::max(instanceBytes, mpInstanceBuffer->getSize() * 2) : instanceBytes;
+                mpInstanceBuffer = Buffer::create(size, Resource::BindFlags::Vertex, Buffer::CpuAccess::Write, nullptr);
+                // The cached VAOs reference the old buffer
+                mIndirectVaos.clear();
+            }
+            mpInstanceBuffer->updateData(transforms.data(), 0, instanceBytes);
+
+            const size_t argBytes = drawArgs.size() * sizeof(IndirectDrawPacker::DrawArguments);
+            if ((mpIndirectArgsBuffer == nullptr) || (mpIndirectArgsBuffer->getSize() < argBytes))
+            {
+                size_t size = mpIndirectArgsBuffer ? std::max(argBytes, mpIndirectArgsBuffer->getSize() * 2) : argBytes;
+                mpIndirectArgsBuffer = Buffer::create(size, Resource::BindFlags::None, Buffer::CpuAccess::Write, nullptr);
+            }
+            mpIndirectArgsBuffer->updateData(drawArgs.data(), 0, argBytes);
+
+            ConstantBuffer* pCB = pContext->getGraphicsVars()->getConstantBuffer(kPerStaticMeshCbName).get();
+            mpLastMaterial = nullptr;
+            currentData.pModel = nullptr;
+
+            for (const auto& batch : mIndirectPacker.getBatches())
             {
-                flushDraw(pContext, pMesh, activeInstances, currentData);
+                const Mesh* pMesh = mIndirectBatchMeshes[batch.batchID];
+                const Vao::SharedPtr& pVao = getIndirectVao(pMesh);
+                if (pContext->getGraphicsState()->getVao() != pVao)
+                {
+                    pContext->getGraphicsState()->setVao(pVao);
+                }
+
+                // A batch can draw several meshes. They share everything but the mesh ID, which is the one of the batch's first mesh.
+                if (pCB)
+                {
+                    pCB->setVariable(sMeshIdOffset, pMesh->getId());
+                    if (pMesh->hasCompactVertices() && (sPosDequantScaleOffset != ConstantBuffer::kInvalidOffset))
+                    {
+                        pCB->setVariable(sPosDequantScaleOffset, pMesh->getPositionDequantScale());
+                        pCB->setVariable(sPosDequantOffsetOffset, pMesh->getPositionDequantOffset());
+                    }
+                }
+
+                setMaterial(pContext, pMesh->getMaterial().get(), currentData);
+                pContext->drawIndexedIndirect(mpIndirectArgsBuffer.get(), batch.firstDraw * sizeof(IndirectDrawPacker::DrawArguments), batch.drawCount);
+                postFlushDraw(pContext, currentData);
             }
         }
+
+        mIndirectPacker.clear();
+        mIndirectBatchIDs.clear();
+        mIndirectBatchMeshes.clear();
+        mIndirectMeshes.clear();
+
+        // Drop the VAOs of meshes which were released
+        for (auto it = mIndirectVaos.begin(); it != mIndirectVaos.end();)
+        {
+            it = it->second.pMeshVao.expired() ? mIndirectVaos.erase(it) : std::next(it);
+        }
     }
 
     void SceneRenderer::renderModelInstance(RenderContext* pContext, const Scene::ModelInstance::SharedPtr& pModelInstance, Camera* pCamera, CurrentWorkingData& currentData)
@@ -271,6 +707,10 @@ namespace Falcor
 
     bool SceneRenderer::update(double currentTime)
     {
+        if (mpTextureStreamer)
+        {
+            mpTextureStreamer->update();
+        }
         return mpScene->update(currentTime, mpCameraController.get());
     }
 
@@ -304,13 +744,29 @@ namespace Falcor
         currentData.pMaterial = nullptr;
         currentData.pModel = nullptr;
         currentData.drawID = 0;
+        currentData.viewportHeight = pContext->getGraphicsState()->getFbo() ? pContext->getGraphicsState()->getFbo()->getHeight() : 0;
 
         setupVR();
         setPerFrameData(pContext, currentData);
 
+        mLodStats = LodStats();
+        mOcclusionStats = OcclusionStats();
+        mFrameCount++;
+
+        if (mOcclusionCullingEnabled && mCullEnabled)
+        {
+            renderOccluders(pCamera);
+        }
+        else
+        {
+            mOccluders.clear();
+        }
+        readHzbVisibility();
+
         for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
         {
             currentData.pModel = mpScene->getModel(modelID).get();
+            const bool indirect = mIndirectDrawEnabled && (currentData.pModel->hasBones() == false);
 
             for (uint32_t instanceID = 0; instanceID < mpScene->getModelInstanceCount(modelID); instanceID++)
             {
@@ -319,11 +775,44 @@ namespace Falcor
                 {
                     if (setPerModelInstanceData(pContext, pInstance, instanceID, currentData))
                     {
-                        renderModelInstance(pContext, pInstance, pCamera, currentData);
+                        if (indirect)
+                        {
+                            addIndirectInstances(pInstance, pCamera, currentData);
+                        }
+                        else
+                        {
+                            renderModelInstance(pContext, pInstance, pCamera, currentData);
+                        }
                     }
                 }
             }
         }
+
+        if (mIndirectDrawEnabled)
+        {
+            flushIndirectDraws(pContext, currentData);
+        }
+
+        if (mOcclusionCullingEnabled && mCullEnabled)
+        {
+            selectOccluders();
+        }
+
+        if (mpHzbCulling && mCullEnabled)
+        {
+            updateHzbCulling(pContext, pCamera);
+        }
+
+        // Drop the LOD state and the HZB slots of instances which weren't drawn for a while. Their pointers may have been reused by new instances.
+        const uint64_t kLodStateLifetime = 64;
+        if ((mFrameCount % kLodStateLifetime) == 0)
+        {
+            for (auto it = mLodStates.begin(); it != mLodStates.end();)
+            {
+                it = (mFrameCount - it->second.lastFrame > kLodStateLifetime) ? mLodStates.erase(it) : std::next(it);
+            }
+            releaseStaleHzbSlots(kLodStateLifetime);
+        }
     }
 
     void SceneRenderer::setCameraControllerType(CameraControllerType type)
@@ -27,12 +27,20 @@
 ***************************************************************************/
 #pragma once
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
 #include "Utils/Gui.h"
 #include "Graphics/Camera/CameraController.h"
 #include "Graphics/Scene/Scene.h"
 #include "utils/CpuTimer.h"
 #include "API/ConstantBuffer.h"
 #include "Utils/DebugDrawer.h"
+#include "Graphics/Material/TextureStreamer.h"
+#include "Graphics/Scene/IndirectDrawPacker.h"
+#include "Utils/OcclusionBuffer.h"
+#include "Graphics/Scene/HzbCulling.h"
+#include "Graphics/LightClusterer.h"
 
 namespace Falcor
 {
@@ -84,11 +92,113 @@ namespace Falcor
         */
         void setMaxInstanceCount(uint32_t instanceCount) { mMaxInstanceCount = instanceCount; }
 
+        /** Enable/disable indirect drawing. The transforms of all the visible instances are packed into one per-instance vertex stream and the draw arguments into one argument buffer, so the instance count isn't limited by setMaxInstanceCount(), and meshes which share the VAO and the material are drawn with a single multi-draw RenderContext::drawIndexedIndirect() call.\n
+            Skinned models are still drawn directly. Instances which are drawn indirectly don't go through setPerMeshInstanceData().
+        */
+        void setIndirectDrawEnabled(bool enable) { mIndirectDrawEnabled = enable; }
+
+        /** Check if indirect drawing is enabled
+        */
+        bool isIndirectDrawEnabled() const { return mIndirectDrawEnabled; }
+
+        /** Enable/disable LOD selection. When enabled, each mesh instance which passes culling is drawn with the coarsest LOD (see Mesh::getLod()) whose error projects to at most setLodPixelError() pixels. Models get LODs when they are loaded with Model::GenerateLods.
+        */
+        void setLodEnabled(bool enable) { mLodEnabled = enable; }
+
+        /** Check if LOD selection is enabled
+        */
+        bool isLodEnabled() const { return mLodEnabled; }
+
+        /** Set the maximal screen-space error, in pixels, of the selected LODs
+        */
+        void setLodPixelError(float pixels) { mLodPixelError = pixels; }
+
+        /** Set the relative hysteresis band around the LOD transitions. An instance only switches to a coarser LOD once its error is below the threshold by this fraction, and only switches back once it's above by the same fraction, so instances near a transition don't flicker between LODs.
+        */
+        void setLodHysteresis(float hysteresis) { mLodHysteresis = hysteresis; }
+
+        /** LOD statistics of the last renderScene() call
+        */
+        struct LodStats
+        {
+            uint32_t instanceCount = 0;                         ///< Number of mesh instances drawn
+            uint64_t triangleCount = 0;                         ///< Number of triangles drawn
+            uint32_t lodInstanceCount[Mesh::kMaxLodCount] = {}; ///< Number of mesh instances drawn with each LOD
+            float selectionTime = 0;                            ///< CPU time spent selecting LODs, in milliseconds
+        };
+
+        /** Get the LOD statistics of the last renderScene() call
+        */
+        const LodStats& getLodStats() const { return mLodStats; }
+
+        /** Enable/disable occlusion culling. Works together with object culling, see setObjectCullState().\n
+            At the beginning of renderScene(), the largest on-screen occluders of the previous frame are rasterized on the CPU into a low-resolution OcclusionBuffer, and mesh instances which pass frustum culling are tested against it before they are drawn.
+            Only meshes loaded with Model::BuildBvh can be occluders, since the BVH keeps a CPU copy of their triangles. Skinned meshes are never occluders.
+        */
+        void setOcclusionCullingEnabled(bool enable) { mOcclusionCullingEnabled = enable; }
+
+        /** Check if occlusion culling is enabled
+        */
+        bool isOcclusionCullingEnabled() const { return mOcclusionCullingEnabled; }
+
+        /** Set the maximal number of occluders rasterized each frame
+        */
+        void setMaxOccluderCount(uint32_t count) { mMaxOccluderCount = count; }
+
+        /** Set the maximal number of triangles of a mesh for it to be an occluder
+        */
+        void setMaxOccluderTriangleCount(uint32_t count) { mMaxOccluderTriangleCount = count; }
+
+        /** Get the occlusion buffer of the last renderScene() call. Returns nullptr if occlusion culling was never used.
+        */
+        const OcclusionBuffer::SharedPtr& getOcclusionBuffer() const { return mpOcclusionBuffer; }
+
+        /** Occlusion culling statistics of the last renderScene() call. See also getOcclusionBuffer()->getStats().
+        */
+        struct OcclusionStats
+        {
+            uint32_t testedInstanceCount = 0;       ///< Number of mesh instances which passed frustum culling and were tested against the occlusion buffer
+            uint32_t occludedInstanceCount = 0;     ///< Number of mesh instances which were hidden by the occluders
+            uint32_t hzbOccludedInstanceCount = 0;  ///< Number of mesh instances which were hidden according to the HZB culling results, see setHzbCulling()
+            float testTime = 0;                     ///< CPU time spent testing boxes, in milliseconds
+        };
+
+        /** Get the occlusion culling statistics of the last renderScene() call
+        */
+        const OcclusionStats& getOcclusionStats() const { return mOcclusionStats; }
+
+        /** Attach a hierarchical-Z culling pass. Works together with object culling, see setObjectCullState().\n
+            At the end of renderScene(), the depth buffer of the bound FBO is reduced into the pass's pyramid, and the boxes of the mesh instances which passed frustum culling are tested against it on the GPU. Once the results are read back, after the pass's readback latency, the mesh instances which were hidden are skipped.
+            Mesh instances are tested against the depth of an earlier frame, so they can pop in for a few frames when they are uncovered. Pass nullptr to detach.
+        */
+        void setHzbCulling(const HzbCulling::SharedPtr& pHzbCulling) { mpHzbCulling = pHzbCulling; mHzbSubmissions.clear(); }
+
+        /** Get the attached hierarchical-Z culling pass
+        */
+        const HzbCulling::SharedPtr& getHzbCulling() const { return mpHzbCulling; }
+
+        /** Attach a light clusterer for clustered forward shading. Every renderScene() call bins the scene's lights into the camera's clusters and binds the result to programs which include 'LightClusters.hlsli'. Other programs are not affected. Pass nullptr to detach.
+        */
+        void setLightClusterer(const LightClusterer::SharedPtr& pClusterer) { mpLightClusterer = pClusterer; }
+
+        /** Get the attached light clusterer
+        */
+        const LightClusterer::SharedPtr& getLightClusterer() const { return mpLightClusterer; }
+
         /** This setting controls whether to unload textures from GPU memory before binding a new material.\n
         Useful for rendering very large models with many textures that can't fit into GPU memory at once. Setting this to true usually results in performance loss.
         */
         void setUnloadTexturesOnMaterialChange(bool unload) { mUnloadTexturesOnMaterialChange = unload; }
 
+        /** Attach a texture streamer. The renderer reports the materials of the mesh instances which pass culling, together with their screen-space size, and update() lets the streamer process them.\n
+            This is a budgeted alternative to setUnloadTexturesOnMaterialChange(). Call TextureStreamer::addScene() to make the streamer track the scene's textures. Pass nullptr to detach.
+        */
+        void setTextureStreamer(const TextureStreamer::SharedPtr& pStreamer) { mpTextureStreamer = pStreamer; }
+
+        /** Get the attached texture streamer
+        */
+        const TextureStreamer::SharedPtr& getTextureStreamer() const { return mpTextureStreamer; }
+
         enum class CameraControllerType
         {
             FirstPerson,
@@ -114,6 +224,7 @@ namespace Falcor
             const Material* pMaterial;
 
             uint32_t drawID; // Zero-based mesh instance draw order/ID. Resets at the beginning of renderScene, and increments per mesh instance drawn.
+            uint32_t viewportHeight; // Height of the render target, used to estimate the screen-space size of mesh instances
         };
 
         SceneRenderer(const Scene::SharedPtr& pScene);
@@ -123,12 +234,14 @@ namespace Falcor
         static const char* kPerFrameCbName;
         static const char* kPerStaticMeshCbName;
         static const char* kPerSkinnedMeshCbName;
+        static const std::string kCameraVarName;
 
         static size_t sBonesOffset;
-        static size_t sCameraDataOffset;
         static size_t sWorldMatOffset;
         static size_t sMeshIdOffset;
         static size_t sDrawIDOffset;
+        static size_t sPosDequantScaleOffset;
+        static size_t sPosDequantOffsetOffset;
 
         static void updateVariableOffsets(const ProgramReflection* pReflector);
 
@@ -142,7 +255,21 @@ namespace Falcor
 
         void renderModelInstance(RenderContext* pContext, const Scene::ModelInstance::SharedPtr& pModelInstance, Camera* pCamera, CurrentWorkingData& currentData);
         void renderMeshInstances(RenderContext* pContext, uint32_t modelID, const Scene::ModelInstance::SharedPtr& pModelInstance, Camera* pCamera, CurrentWorkingData& currentData);
-        void flushDraw(RenderContext* pContext, const Mesh* pMesh, uint32_t instanceCount, CurrentWorkingData& currentData);
+        void flushDraw(RenderContext* pContext, const Mesh* pMesh, const Mesh::Lod& lod, uint32_t instanceCount, CurrentWorkingData& currentData);
+        void setMaterial(RenderContext* pContext, const Material* pMaterial, CurrentWorkingData& currentData);
+
+        uint32_t selectLod(const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance, float screenSize);
+        void addIndirectInstances(const Scene::ModelInstance::SharedPtr& pModelInstance, Camera* pCamera, CurrentWorkingData& currentData);
+        void flushIndirectDraws(RenderContext* pContext, CurrentWorkingData& currentData);
+        const Vao::SharedPtr& getIndirectVao(const Mesh* pMesh);
+
+        bool isOccluded(const Scene::ModelInstance::SharedPtr& pModelInstance, const Model::MeshInstance::SharedPtr& pMeshInstance, const BoundingBox& box, const Camera* pCamera);
+        void renderOccluders(const Camera* pCamera);
+        void selectOccluders();
+        bool isHzbOccluded(const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance, const BoundingBox& box);
+        void readHzbVisibility();
+        void updateHzbCulling(RenderContext* pContext, const Camera* pCamera);
+        void releaseStaleHzbSlots(uint64_t lifetime);
 
         void setupVR();
 
@@ -153,7 +280,108 @@ namespace Falcor
         const Material* mpLastMaterial = nullptr;
         bool mCullEnabled = true;
         bool mUnloadTexturesOnMaterialChange = false;
+        TextureStreamer::SharedPtr mpTextureStreamer;
         RenderMode mRenderMode = RenderMode::Mono;
         bool mCompileMaterialWithProgram = true;
+
+        struct IndirectVao
+        {
+            std::weak_ptr<const Vao> pMeshVao;      ///< Detects meshes which were released and had their VAO address reused
+            Vao::SharedPtr pVao;                    ///< The mesh's buffers and the instance stream
+        };
+
+        bool mIndirectDrawEnabled = false;
+        IndirectDrawPacker mIndirectPacker;
+        struct IndirectBatchKey
+        {
+            const Vao* pVao;
+            const Material* pMaterial;
+            const Mesh* pMesh;                  ///< Only set for meshes which can't share a batch with other meshes
+            bool operator==(const IndirectBatchKey& other) const { return (pVao == other.pVao) && (pMaterial == other.pMaterial) && (pMesh == other.pMesh); }
+        };
+
+        struct IndirectBatchKeyHash
+        {
+            size_t operator()(const IndirectBatchKey& key) const { return std::hash<const void*>()(key.pVao) ^ (std::hash<const void*>()(key.pMaterial) * 31) ^ (std::hash<const void*>()(key.pMesh) * 131); }
+        };
+
+        struct IndirectMesh
+        {
+            uint32_t batchID;
+            uint32_t firstGeometryID;           ///< The geometry ID of the mesh's first LOD in its batch
+        };
+
+        std::vector<const Mesh*> mIndirectBatchMeshes;                          ///< The mesh whose bindings each batch uses
+        std::unordered_map<IndirectBatchKey, uint32_t, IndirectBatchKeyHash> mIndirectBatchIDs;
+        std::unordered_map<const Mesh*, IndirectMesh> mIndirectMeshes;
+        std::unordered_map<const Vao*, IndirectVao> mIndirectVaos;
+        Buffer::SharedPtr mpInstanceBuffer;                                     ///< Per-instance world matrices
+        Buffer::SharedPtr mpIndirectArgsBuffer;
+
+        struct LodKey
+        {
+            const Scene::ModelInstance* pModelInstance;
+            const Model::MeshInstance* pMeshInstance;
+            bool operator==(const LodKey& other) const { return (pModelInstance == other.pModelInstance) && (pMeshInstance == other.pMeshInstance); }
+        };
+
+        struct LodKeyHash
+        {
+            size_t operator()(const LodKey& key) const { return std::hash<const void*>()(key.pModelInstance) ^ (std::hash<const void*>()(key.pMeshInstance) * 31); }
+        };
+
+        struct LodState
+        {
+            uint32_t lod;
+            uint64_t lastFrame;     ///< The last frame the instance was drawn in, used to drop the state of instances which are gone
+        };
+
+        bool mLodEnabled = true;
+        float mLodPixelError = 1.0f;
+        float mLodHysteresis = 0.2f;
+        uint64_t mFrameCount = 0;
+        LodStats mLodStats;
+        std::unordered_map<LodKey, LodState, LodKeyHash> mLodStates;
+        std::vector<uint32_t> mLodInstances[Mesh::kMaxLodCount];               ///< Scratch lists of the visible instances of a mesh, per LOD
+
+        struct Occluder
+        {
+            float screenSize;
+            Scene::ModelInstance::SharedPtr pModelInstance;
+            Model::MeshInstance::SharedPtr pMeshInstance;
+        };
+
+        bool mOcclusionCullingEnabled = false;
+        uint32_t mMaxOccluderCount = 32;
+        uint32_t mMaxOccluderTriangleCount = 4096;
+        OcclusionBuffer::SharedPtr mpOcclusionBuffer;
+        OcclusionStats mOcclusionStats;
+        std::vector<Occluder> mOccluders;                                   ///< The occluders rasterized this frame, selected in the previous frame
+        std::vector<Occluder> mOccluderCandidates;                          ///< The visible instances of this frame which can be occluders
+        std::unordered_set<LodKey, LodKeyHash> mOccluderKeys;               ///< The instances in mOccluders. Occluders are never culled, since their own box might be reported hidden behind their triangles due to rounding.
+
+        LightClusterer::SharedPtr mpLightClusterer;
+
+        struct HzbSlot
+        {
+            uint32_t generation;    ///< Incremented when the slot is released, so the pending results of its previous instance are ignored
+            uint64_t lastFrame;     ///< The last frame the instance passed frustum culling, used to release the slots of instances which are gone
+            uint32_t boxIndex;      ///< The index of the instance's box in mHzbFrameBoxes, if lastFrame is the current frame
+        };
+
+        struct HzbEntry
+        {
+            uint32_t slot;
+            uint32_t generation;
+        };
+
+        HzbCulling::SharedPtr mpHzbCulling;
+        std::unordered_map<LodKey, uint32_t, LodKeyHash> mHzbSlots;         ///< The slot of each mesh instance which passed frustum culling recently
+        std::vector<HzbSlot> mHzbSlotData;
+        std::vector<uint32_t> mHzbFreeSlots;
+        std::vector<BoundingBox> mHzbFrameBoxes;                            ///< The boxes tested by this frame's cull() call
+        std::vector<HzbEntry> mHzbFrameEntries;                             ///< The slot of each box in mHzbFrameBoxes
+        std::deque<std::vector<HzbEntry>> mHzbSubmissions;                  ///< The entries of the cull() calls whose results weren't read yet, oldest first
+        std::vector<uint8_t> mHzbSlotVisible;                               ///< Per slot, 0 if the results used by this frame hide the instance
     };
 }
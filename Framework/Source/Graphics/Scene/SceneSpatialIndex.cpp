@@ -0,0 +1,238 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Graphics/Scene/SceneSpatialIndex.h"
+#include "Graphics/Scene/Scene.h"
+#include "Graphics/Camera/Camera.h"
+#include "Utils/ThreadPool.h"
+
+namespace Falcor
+{
+    SceneSpatialIndex::SharedPtr SceneSpatialIndex::create(const Scene* pScene)
+    {
+        SharedPtr pIndex = SharedPtr(new SceneSpatialIndex(pScene));
+        pIndex->update();
+        return pIndex;
+    }
+
+    SceneSpatialIndex::SceneSpatialIndex(const Scene* pScene) : mpScene(pScene)
+    {
+        mpModelTree = DynamicAabbTree::create();
+        mpMeshTree = DynamicAabbTree::create();
+    }
+
+    uint32_t SceneSpatialIndex::allocateEntry(const ModelInstance::SharedPtr& pModelInstance, const Model::MeshInstance::SharedPtr& pMeshInstance)
+    {
+        uint32_t entryID;
+        if (mFreeEntries.empty())
+        {
+            entryID = (uint32_t)mEntries.size();
+            mEntries.emplace_back();
+        }
+        else
+        {
+            entryID = mFreeEntries.back();
+            mFreeEntries.pop_back();
+        }
+
+        mEntries[entryID].pModelInstance = pModelInstance;
+        mEntries[entryID].pMeshInstance = pMeshInstance;
+        return entryID;
+    }
+
+    void SceneSpatialIndex::freeEntry(uint32_t entryID)
+    {
+        Entry& entry = mEntries[entryID];
+        if (entry.proxyID != DynamicAabbTree::kInvalidProxy)
+        {
+            (entry.pMeshInstance ? mpMeshTree : mpModelTree)->destroyProxy(entry.proxyID);
+        }
+        entry = Entry();
+        mFreeEntries.push_back(entryID);
+    }
+
+    void SceneSpatialIndex::insertInstance(const ModelInstance::SharedPtr& pInstance)
+    {
+        InstanceRecord& record = mRecords[pInstance.get()];
+        record.modelEntry = allocateEntry(pInstance, nullptr);
+        record.updateID = mUpdateID;
+        updateInstance(record);
+    }
+
+    void SceneSpatialIndex::updateInstance(InstanceRecord& record)
+    {
+        Entry& modelEntry = mEntries[record.modelEntry];
+        const ModelInstance::SharedPtr pInstance = modelEntry.pModelInstance;
+        if (modelEntry.proxyID == DynamicAabbTree::kInvalidProxy)
+        {
+            modelEntry.proxyID = mpModelTree->createProxy(pInstance->getBoundingBox(), record.modelEntry);
+        }
+        else
+        {
+            mpModelTree->moveProxy(modelEntry.proxyID, pInstance->getBoundingBox());
+        }
+
+        // Recreate the mesh entries if mesh instances were added to the model
+        const Model* pModel = pInstance->getObject().get();
+        uint32_t meshInstanceCount = 0;
+        for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+        {
+            meshInstanceCount += pModel->getMeshInstanceCount(meshID);
+        }
+        if (meshInstanceCount != record.meshEntries.size())
+        {
+            for (uint32_t entryID : record.meshEntries)
+            {
+                freeEntry(entryID);
+            }
+            record.meshEntries.clear();
+            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                for (uint32_t i = 0; i < pModel->getMeshInstanceCount(meshID); i++)
+                {
+                    record.meshEntries.push_back(allocateEntry(pInstance, pModel->getMeshInstance(meshID, i)));
+                }
+            }
+        }
+
+        const glm::mat4& transform = pInstance->getTransformMatrix();
+        for (uint32_t entryID : record.meshEntries)
+        {
+            Entry& entry = mEntries[entryID];
+            if (entry.pMeshInstance->isVisible() == false)
+            {
+                if (entry.proxyID != DynamicAabbTree::kInvalidProxy)
+                {
+                    mpMeshTree->destroyProxy(entry.proxyID);
+                    entry.proxyID = DynamicAabbTree::kInvalidProxy;
+                }
+                continue;
+            }
+
+            BoundingBox box = entry.pMeshInstance->getBoundingBox().transform(transform);
+            if (entry.proxyID == DynamicAabbTree::kInvalidProxy)
+            {
+                entry.proxyID = mpMeshTree->createProxy(box, entryID);
+            }
+            else
+            {
+                mpMeshTree->moveProxy(entry.proxyID, box);
+            }
+        }
+    }
+
+    void SceneSpatialIndex::removeInstance(InstanceRecord& record)
+    {
+        freeEntry(record.modelEntry);
+        for (uint32_t entryID : record.meshEntries)
+        {
+            freeEntry(entryID);
+        }
+    }
+
+    void SceneSpatialIndex::update()
+    {
+        mUpdateID++;
+        for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+        {
+            for (uint32_t i = 0; i < mpScene->getModelInstanceCount(modelID); i++)
+            {
+                const ModelInstance::SharedPtr& pInstance = mpScene->getModelInstance(modelID, i);
+                if (pInstance->isVisible() == false)
+                {
+                    continue;
+                }
+
+                auto it = mRecords.find(pInstance.get());
+                if (it == mRecords.end())
+                {
+                    insertInstance(pInstance);
+                }
+                else
+                {
+                    it->second.updateID = mUpdateID;
+                    updateInstance(it->second);
+                }
+            }
+        }
+
+        // Remove the instances which were deleted or hidden. The entries hold a reference to their instance, so a new instance can't reuse a stale record's address.
+        for (auto it = mRecords.begin(); it != mRecords.end();)
+        {
+            if (it->second.updateID != mUpdateID)
+            {
+                removeInstance(it->second);
+                it = mRecords.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    SceneSpatialIndex::Result SceneSpatialIndex::getResult(const DynamicAabbTree::Hit& hit) const
+    {
+        const Entry& entry = mEntries[hit.userData];
+        Result result;
+        result.pModelInstance = entry.pModelInstance;
+        result.pMeshInstance = entry.pMeshInstance;
+        result.distance = hit.distance;
+        return result;
+    }
+
+    uint32_t SceneSpatialIndex::query(const Query& query, Level level, std::vector<Result>& results) const
+    {
+        std::vector<DynamicAabbTree::Hit> hits;
+        getTree(level)->query(query, hits);
+        results.reserve(results.size() + hits.size());
+        for (const auto& hit : hits)
+        {
+            results.push_back(getResult(hit));
+        }
+        return (uint32_t)hits.size();
+    }
+
+    void SceneSpatialIndex::queryBatch(const std::vector<Query>& queries, Level level, std::vector<std::vector<Result>>& results) const
+    {
+        results.resize(queries.size());
+        ThreadPool::instance()->parallelFor((uint32_t)queries.size(), 0, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                results[i].clear();
+                query(queries[i], level, results[i]);
+            }
+        });
+    }
+
+    uint32_t SceneSpatialIndex::queryCamera(const Camera* pCamera, Level level, std::vector<Result>& results) const
+    {
+        return query(Query::frustum(pCamera->getViewProjMatrix()), level, results);
+    }
+}
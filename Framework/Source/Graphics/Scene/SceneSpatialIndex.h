@@ -0,0 +1,147 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <unordered_map>
+#include "Graphics/Model/Model.h"
+#include "Graphics/Model/ObjectInstance.h"
+#include "Utils/DynamicAabbTree.h"
+
+namespace Falcor
+{
+    class Scene;
+    class Camera;
+
+    /** Spatial queries on the instances of a scene.
+        Keeps two DynamicAabbTrees over the world-space bounds of the visible instances, one with an entry per model instance and one with an entry per mesh instance of each model instance. update() follows the changes to the scene incrementally: new instances are inserted, deleted or hidden ones are removed and moved ones only touch the tree when they leave their fat box.
+        Queries are const and can run concurrently on any number of threads, but not concurrently with update(). Scene::update() updates the scene's index, see Scene::getSpatialIndex().
+    */
+    class SceneSpatialIndex
+    {
+    public:
+        using SharedPtr = std::shared_ptr<SceneSpatialIndex>;
+        using SharedConstPtr = std::shared_ptr<const SceneSpatialIndex>;
+        using Query = DynamicAabbTree::Query;
+        using ModelInstance = ObjectInstance<Model>;
+
+        /** Which instances a query returns
+        */
+        enum class Level
+        {
+            ModelInstances,         ///< Test the bounds of whole model instances
+            MeshInstances,          ///< Test the bounds of each mesh instance of the model instances
+        };
+
+        /** An instance found by a query
+        */
+        struct Result
+        {
+            ModelInstance::SharedPtr pModelInstance;
+            Model::MeshInstance::SharedPtr pMeshInstance;       ///< nullptr for Level::ModelInstances
+            float distance = 0;     ///< Ray queries: distance to the instance's bounds. Nearest-instance queries: distance to the bounds. Otherwise 0.
+        };
+
+        /** Create an index and insert the scene's instances
+            \param[in] pScene The scene. The index doesn't keep a reference to it, the scene must outlive the index.
+        */
+        static SharedPtr create(const Scene* pScene);
+
+        /** Insert, move and remove instances to match the scene
+        */
+        void update();
+
+        /** Run a query
+            \param[in] query The query. Create it with the DynamicAabbTree::Query functions.
+            \param[in] level Whether to return model instances or mesh instances
+            \param[out] results The results are appended to this vector. Ray hits are sorted by distance.
+            \return The number of results
+        */
+        uint32_t query(const Query& query, Level level, std::vector<Result>& results) const;
+
+        /** Run a batch of queries on the global thread pool
+            \param[in] queries The queries
+            \param[in] level Whether to return model instances or mesh instances
+            \param[out] results Receives the results of each query. Resized to the number of queries.
+        */
+        void queryBatch(const std::vector<Query>& queries, Level level, std::vector<std::vector<Result>>& results) const;
+
+        /** Find the instances overlapping a camera's frustum. The camera doesn't need to be the scene's active camera.
+        */
+        uint32_t queryCamera(const Camera* pCamera, Level level, std::vector<Result>& results) const;
+
+        /** Get the tree of a level, for statistics or direct queries. The hits' user data is an index for getResult().
+        */
+        const DynamicAabbTree* getTree(Level level) const { return (level == Level::ModelInstances) ? mpModelTree.get() : mpMeshTree.get(); }
+
+        /** Get the instance of a tree hit
+        */
+        Result getResult(const DynamicAabbTree::Hit& hit) const;
+
+        /** Get the number of model instances in the index
+        */
+        uint32_t getModelInstanceCount() const { return mpModelTree->getProxyCount(); }
+
+        /** Get the number of mesh instances in the index
+        */
+        uint32_t getMeshInstanceCount() const { return mpMeshTree->getProxyCount(); }
+
+    private:
+        SceneSpatialIndex(const Scene* pScene);
+
+        /** A proxy in one of the trees
+        */
+        struct Entry
+        {
+            ModelInstance::SharedPtr pModelInstance;
+            Model::MeshInstance::SharedPtr pMeshInstance;
+            uint32_t proxyID = DynamicAabbTree::kInvalidProxy;
+        };
+
+        /** The entries of a model instance. Mesh entries are in the model's order, invisible mesh instances don't have a proxy.
+        */
+        struct InstanceRecord
+        {
+            uint32_t modelEntry;
+            std::vector<uint32_t> meshEntries;
+            uint32_t updateID;
+        };
+
+        uint32_t allocateEntry(const ModelInstance::SharedPtr& pModelInstance, const Model::MeshInstance::SharedPtr& pMeshInstance);
+        void freeEntry(uint32_t entryID);
+        void insertInstance(const ModelInstance::SharedPtr& pInstance);
+        void updateInstance(InstanceRecord& record);
+        void removeInstance(InstanceRecord& record);
+
+        const Scene* mpScene;
+        DynamicAabbTree::SharedPtr mpModelTree;
+        DynamicAabbTree::SharedPtr mpMeshTree;
+        std::vector<Entry> mEntries;
+        std::vector<uint32_t> mFreeEntries;
+        std::unordered_map<const ModelInstance*, InstanceRecord> mRecords;
+        uint32_t mUpdateID = 0;
+    };
+}
@@ -0,0 +1,256 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureBaker.h"
+#include "TextureHelper.h"
+#include "Utils/Bitmap.h"
+#include "Utils/BlockCompression.h"
+#include "Utils/CpuTimer.h"
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace Falcor
+{
+    /** Expand an 8-bit image into RGBA8
+    */
+    static bool convertToRgba8(const uint8_t* pSrc, uint32_t texelCount, ResourceFormat format, std::vector<uint8_t>& rgba)
+    {
+        rgba.resize(texelCount * 4);
+        uint8_t* pDst = rgba.data();
+        switch(srgbToLinearFormat(format))
+        {
+        case ResourceFormat::RGBA8Unorm:
+        case ResourceFormat::RGBX8Unorm:
+            memcpy(pDst, pSrc, rgba.size());
+            break;
+        case ResourceFormat::BGRA8Unorm:
+        case ResourceFormat::BGRX8Unorm:
+            for(uint32_t i = 0; i < texelCount; i++)
+            {
+                pDst[i * 4 + 0] = pSrc[i * 4 + 2];
+                pDst[i * 4 + 1] = pSrc[i * 4 + 1];
+                pDst[i * 4 + 2] = pSrc[i * 4 + 0];
+                pDst[i * 4 + 3] = pSrc[i * 4 + 3];
+            }
+            break;
+        case ResourceFormat::RG8Unorm:
+            for(uint32_t i = 0; i < texelCount; i++)
+            {
+                pDst[i * 4 + 0] = pSrc[i * 2 + 0];
+                pDst[i * 4 + 1] = pSrc[i * 2 + 1];
+                pDst[i * 4 + 2] = 0;
+                pDst[i * 4 + 3] = 255;
+            }
+            break;
+        case ResourceFormat::R8Unorm:
+            for(uint32_t i = 0; i < texelCount; i++)
+            {
+                pDst[i * 4 + 0] = pDst[i * 4 + 1] = pDst[i * 4 + 2] = pSrc[i];
+                pDst[i * 4 + 3] = 255;
+            }
+            break;
+        default:
+            return false;
+        }
+
+        // The X channel of the padded formats is undefined
+        if(srgbToLinearFormat(format) == ResourceFormat::RGBX8Unorm || srgbToLinearFormat(format) == ResourceFormat::BGRX8Unorm)
+        {
+            for(uint32_t i = 0; i < texelCount; i++)
+            {
+                pDst[i * 4 + 3] = 255;
+            }
+        }
+        return true;
+    }
+
+    static ResourceFormat chooseFormat(const std::vector<uint8_t>& rgba, ResourceFormat srcFormat, TextureBaker::Quality quality)
+    {
+        switch(srgbToLinearFormat(srcFormat))
+        {
+        case ResourceFormat::R8Unorm:
+            return ResourceFormat::BC4Unorm;
+        case ResourceFormat::RG8Unorm:
+            return ResourceFormat::BC5Unorm;
+        default:
+            break;
+        }
+
+        if(quality == TextureBaker::Quality::High)
+        {
+            return ResourceFormat::BC7Unorm;
+        }
+
+        for(size_t i = 3; i < rgba.size(); i += 4)
+        {
+            if(rgba[i] != 255)
+            {
+                return ResourceFormat::BC3Unorm;
+            }
+        }
+        return ResourceFormat::BC1Unorm;
+    }
+
+    static uint32_t getCompressedChannelCount(ResourceFormat format)
+    {
+        switch(format)
+        {
+        case ResourceFormat::BC1Unorm:
+            return 3;
+        case ResourceFormat::BC4Unorm:
+            return 1;
+        case ResourceFormat::BC5Unorm:
+            return 2;
+        default:
+            return 4;
+        }
+    }
+
+    bool TextureBaker::bakeImage(const void* pData, uint32_t width, uint32_t height, ResourceFormat format, const std::string& dstFilename, Quality quality, Stats& stats, ResourceFormat dstFormat)
+    {
+        // D3D requires the dimensions of block-compressed textures to be a multiple of the block size
+        if((width % 4) || (height % 4))
+        {
+            logWarning("Can't bake " + dstFilename + ". The image size " + std::to_string(width) + "x" + std::to_string(height) + " is not a multiple of 4.");
+            stats.skippedCount++;
+            return false;
+        }
+
+        std::vector<uint8_t> rgba;
+        if(convertToRgba8((const uint8_t*)pData, width * height, format, rgba) == false)
+        {
+            logWarning("Can't bake " + dstFilename + ". Only 8-bit unorm images are supported.");
+            stats.skippedCount++;
+            return false;
+        }
+
+        if(dstFormat == ResourceFormat::Unknown)
+        {
+            dstFormat = chooseFormat(rgba, format, quality);
+        }
+        dstFormat = srgbToLinearFormat(dstFormat);
+        if(BlockCompression::isFormatSupported(dstFormat) == false)
+        {
+            logWarning("Can't bake " + dstFilename + ". The requested format is not supported by the encoder.");
+            stats.skippedCount++;
+            return false;
+        }
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        TextureMipChain mips;
+        generateTextureMipChain(rgba.data(), width, height, ResourceFormat::RGBA8Unorm, 0, mips);
+
+        TextureMipChain baked;
+        baked.width = width;
+        baked.height = height;
+        baked.mipCount = mips.mipCount;
+        baked.format = dstFormat;
+
+        uint32_t srcOffset = 0;
+        for(uint32_t mip = 0; mip < mips.mipCount; mip++)
+        {
+            uint32_t dstOffset = (uint32_t)baked.data.size();
+            baked.data.resize(dstOffset + getTextureMipSize(width, height, dstFormat, mip));
+            BlockCompression::compressImage(dstFormat, mips.data.data() + srcOffset, max(width >> mip, 1U), max(height >> mip, 1U), baked.data.data() + dstOffset);
+            srcOffset += getTextureMipSize(width, height, ResourceFormat::RGBA8Unorm, mip);
+        }
+        CpuTimer::TimePoint end = CpuTimer::getCurrentTimePoint();
+
+        if(saveTextureMipChainToDDS(dstFilename, baked) == false)
+        {
+            stats.skippedCount++;
+            return false;
+        }
+
+        // Measure the error of the most detailed level
+        std::vector<uint8_t> decoded(width * height * 4);
+        BlockCompression::decompressImage(dstFormat, baked.data.data(), width, height, decoded.data());
+        const uint32_t channelCount = getCompressedChannelCount(dstFormat);
+        for(uint32_t i = 0; i < width * height; i++)
+        {
+            for(uint32_t c = 0; c < channelCount; c++)
+            {
+                double diff = (double)rgba[i * 4 + c] - (double)decoded[i * 4 + c];
+                stats.squaredError += diff * diff;
+            }
+        }
+
+        stats.textureCount++;
+        stats.sampleCount += (uint64_t)width * height * channelCount;
+        stats.pixelCount += srcOffset / 4;
+        stats.inputBytes += srcOffset;
+        stats.outputBytes += baked.data.size();
+        stats.seconds += CpuTimer::calcDuration(start, end) * 1.0e-3;
+        return true;
+    }
+
+    bool TextureBaker::bakeFile(const std::string& filename, Quality quality, Stats& stats)
+    {
+        std::string fullpath;
+        if(findFileInDataDirectories(filename, fullpath) == false)
+        {
+            logWarning("Can't bake texture. File " + filename + " not found.");
+            stats.skippedCount++;
+            return false;
+        }
+
+        // DDS files store the rows top-down
+        Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(fullpath, true);
+        if(pBitmap == nullptr)
+        {
+            stats.skippedCount++;
+            return false;
+        }
+        return bakeImage(pBitmap->getData(), pBitmap->getWidth(), pBitmap->getHeight(), pBitmap->getFormat(), getBakedTextureFilename(fullpath), quality, stats);
+    }
+
+    double TextureBaker::Stats::getMegaPixelsPerSecond() const
+    {
+        return (seconds > 0) ? (double)pixelCount * 1.0e-6 / seconds : 0;
+    }
+
+    double TextureBaker::Stats::getPsnr() const
+    {
+        if(squaredError == 0)
+        {
+            return INFINITY;
+        }
+        double mse = squaredError / (double)sampleCount;
+        return 10.0 * log10(255.0 * 255.0 / mse);
+    }
+
+    std::string TextureBaker::Stats::toString() const
+    {
+        std::stringstream s;
+        s << std::fixed << std::setprecision(2);
+        s << "Baked " << textureCount << " textures (" << skippedCount << " skipped). " << (double)pixelCount * 1.0e-6 << " MPix in " << seconds << "s, " << getMegaPixelsPerSecond() << " MPix/s. ";
+        s << (double)inputBytes / (1024 * 1024) << " MB -> " << (double)outputBytes / (1024 * 1024) << " MB. PSNR " << getPsnr() << " dB";
+        return s.str();
+    }
+}
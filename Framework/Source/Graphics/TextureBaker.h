@@ -0,0 +1,95 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include "API/Formats.h"
+
+namespace Falcor
+{
+    /** Offline texture baking. Generates the mip-chain of an image on the CPU, block-compresses every level and writes the result into a DDS file.
+        The loaders in TextureHelper pick up the baked files automatically, see getBakedTextureFilename().
+    */
+    class TextureBaker
+    {
+    public:
+        /** Controls the format selection when no explicit format is requested
+        */
+        enum class Quality
+        {
+            Fast,   ///< BC1 for opaque images, BC3 for images with alpha. 4 or 8 bits per texel.
+            High,   ///< BC7. 8 bits per texel.
+        };
+
+        /** Statistics accumulated over bake calls
+        */
+        struct Stats
+        {
+            uint32_t textureCount = 0;      ///< Number of baked textures
+            uint32_t skippedCount = 0;      ///< Number of textures which couldn't be baked
+            uint64_t pixelCount = 0;        ///< Number of compressed texels, including the mips
+            uint64_t inputBytes = 0;        ///< Size of the uncompressed mip-chains
+            uint64_t outputBytes = 0;       ///< Size of the compressed mip-chains
+            double seconds = 0;             ///< Time spent generating mips and compressing
+            double squaredError = 0;        ///< Sum of the squared errors of the most detailed levels
+            uint64_t sampleCount = 0;       ///< Number of channel values the error was measured on
+
+            /** Get the compression throughput in megapixels per second
+            */
+            double getMegaPixelsPerSecond() const;
+
+            /** Get the peak signal-to-noise ratio of the most detailed levels, in dB
+            */
+            double getPsnr() const;
+
+            /** Get a one-line summary
+            */
+            std::string toString() const;
+        };
+
+        /** Bake an image in memory
+            \param[in] pData The mip 0 texels. The rows are expected in top-down order.
+            \param[in] width The image width. Must be a multiple of 4.
+            \param[in] height The image height. Must be a multiple of 4.
+            \param[in] format The image format. Supports 8-bit R, RG, RGBA, BGRA and BGRX formats.
+            \param[in] dstFilename The DDS file to create
+            \param[in] quality The quality level, used when dstFormat is Unknown
+            \param[in,out] stats Statistics to update
+            \param[in] dstFormat The block-compressed format to use, or Unknown to choose one based on the image content
+            \return true on success, otherwise false
+        */
+        static bool bakeImage(const void* pData, uint32_t width, uint32_t height, ResourceFormat format, const std::string& dstFilename, Quality quality, Stats& stats, ResourceFormat dstFormat = ResourceFormat::Unknown);
+
+        /** Bake an image file into getBakedTextureFilename(filename)
+            \param[in] filename The image file. Loader will look for it in the data directories.
+            \param[in] quality The quality level
+            \param[in,out] stats Statistics to update
+            \return true on success, otherwise false
+        */
+        static bool bakeFile(const std::string& filename, Quality quality, Stats& stats);
+    };
+}
@@ -0,0 +1,183 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Graphics/TextureCapture.h"
+#include "API/Texture.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/OS.h"
+
+namespace Falcor
+{
+    TextureCapture::SharedPtr TextureCapture::create(uint32_t maxPendingCaptures)
+    {
+        return SharedPtr(new TextureCapture(maxPendingCaptures));
+    }
+
+    TextureCapture* TextureCapture::instance()
+    {
+        // Create the pool first so that it outlives the global queue, which flushes on destruction
+        ThreadPool::instance();
+        static TextureCapture::SharedPtr spCapture = create();
+        return spCapture.get();
+    }
+
+    TextureCapture::TextureCapture(uint32_t maxPendingCaptures) : mMaxPendingCaptures(std::max(maxPendingCaptures, 1u))
+    {
+    }
+
+    TextureCapture::~TextureCapture()
+    {
+        flush();
+    }
+
+    void TextureCapture::captureToFile(CopyContext* pContext, const Texture* pTexture, uint32_t mipLevel, uint32_t arraySlice, const std::string& filename, Bitmap::FileFormat format, Bitmap::ExportFlags exportFlags, const Callback& callback)
+    {
+        // Bound the readback memory. Wait for the oldest capture rather than dropping the new one.
+        while(mCaptures.size() >= mMaxPendingCaptures)
+        {
+            Capture& oldest = mCaptures.front();
+            if(oldest.isEncoding == false)
+            {
+                oldest.pTask->wait();
+                startEncode(oldest);
+            }
+            oldest.encoded.wait();
+            update();
+        }
+
+        Capture capture;
+        capture.pTask = pContext->asyncReadTextureSubresource(pTexture, pTexture->getSubresourceIndex(arraySlice, mipLevel));
+        capture.filename = filename;
+        capture.width = pTexture->getWidth(mipLevel);
+        capture.height = pTexture->getHeight(mipLevel);
+        capture.resourceFormat = pTexture->getFormat();
+        capture.fileFormat = format;
+        capture.exportFlags = exportFlags;
+        capture.callback = callback;
+        mCaptures.push_back(std::move(capture));
+    }
+
+    void TextureCapture::startEncode(Capture& capture)
+    {
+        // The copy is done, so mapping the readback buffer doesn't block. The task itself is released on the owning thread, the job only borrows it.
+        CopyContext::ReadTextureTask* pTask = capture.pTask.get();
+        std::string filename = capture.filename;
+        uint32_t width = capture.width;
+        uint32_t height = capture.height;
+        ResourceFormat resourceFormat = capture.resourceFormat;
+        Bitmap::FileFormat fileFormat = capture.fileFormat;
+        Bitmap::ExportFlags exportFlags = capture.exportFlags;
+
+        capture.encoded = ThreadPool::instance()->submit([=]()
+        {
+            std::vector<uint8> data = pTask->getData();
+            return Bitmap::saveImage(filename, width, height, fileFormat, exportFlags, resourceFormat, true, data.data());
+        });
+        capture.isEncoding = true;
+    }
+
+    void TextureCapture::update()
+    {
+        // Captures complete in submission order on the GPU, but the encodes may finish out of order
+        for(auto it = mCaptures.begin(); it != mCaptures.end();)
+        {
+            if(it->isEncoding == false)
+            {
+                if(it->pTask->isReady() == false)
+                {
+                    ++it;
+                    continue;
+                }
+                startEncode(*it);
+            }
+
+            if(it->encoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++it;
+                continue;
+            }
+
+            bool success = it->encoded.get();
+            if(success == false)
+            {
+                logWarning("TextureCapture: failed to write '" + it->filename + "'");
+            }
+            Callback callback = std::move(it->callback);
+            std::string filename = std::move(it->filename);
+            it = mCaptures.erase(it);
+            if(callback)
+            {
+                callback(filename, success);
+            }
+        }
+    }
+
+    void TextureCapture::flush()
+    {
+        for(auto& capture : mCaptures)
+        {
+            if(capture.isEncoding == false)
+            {
+                capture.pTask->wait();
+                startEncode(capture);
+            }
+        }
+
+        while(mCaptures.empty() == false)
+        {
+            mCaptures.front().encoded.wait();
+            update();
+        }
+    }
+
+    bool TextureCapture::isPending(const std::string& filename) const
+    {
+        for(const auto& capture : mCaptures)
+        {
+            if(capture.filename == filename)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool TextureCapture::findAvailableFilename(const std::string& prefix, const std::string& directory, const std::string& extension, std::string& filename) const
+    {
+        for(uint32_t i = 0; i < UINT32_MAX; i++)
+        {
+            filename = directory + '\\' + prefix + '.' + std::to_string(i) + "." + extension;
+            if(doesFileExist(filename) == false && isPending(filename) == false)
+            {
+                return true;
+            }
+        }
+        filename = "";
+        return false;
+    }
+}
@@ -0,0 +1,118 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <list>
+#include <future>
+#include <functional>
+#include "API/CopyContext.h"
+#include "Utils/Bitmap.h"
+
+namespace Falcor
+{
+    class Texture;
+
+    /** Asynchronous texture capture.
+        captureToFile() records a copy into a readback buffer and returns immediately. update() polls the copies, and once the GPU is done the image is encoded and written on the global ThreadPool.
+        Completion callbacks are called from update() or flush(), so they run on the thread which owns the capture object (usually the render thread).
+        Use TextureCapture::instance() for the capture queue the Sample pumps every frame.
+    */
+    class TextureCapture
+    {
+    public:
+        using SharedPtr = std::shared_ptr<TextureCapture>;
+        using SharedConstPtr = std::shared_ptr<const TextureCapture>;
+
+        /** Called once the file was written.
+            \param[in] filename The name of the image file
+            \param[in] success false if the encode or the write failed
+        */
+        using Callback = std::function<void(const std::string& filename, bool success)>;
+
+        /** Create a new capture queue
+            \param[in] maxPendingCaptures The number of captures which can be in flight. When the limit is reached, captureToFile() waits for the oldest one.
+        */
+        static SharedPtr create(uint32_t maxPendingCaptures = 8);
+
+        /** Get the global capture queue. The queue is created on first use.
+        */
+        static TextureCapture* instance();
+
+        ~TextureCapture();
+
+        /** Queue a capture of a texture subresource. The function returns once the copy was submitted to the GPU.
+            \param[in] pContext The context used to record the copy
+            \param[in] pTexture The texture to capture
+            \param[in] mipLevel Requested mip-level
+            \param[in] arraySlice Requested array-slice
+            \param[in] filename Name of the image file
+            \param[in] format Destination image file format
+            \param[in] exportFlags Save flags, see Bitmap::ExportFlags
+            \param[in] callback Optional function to call once the file was written
+        */
+        void captureToFile(CopyContext* pContext, const Texture* pTexture, uint32_t mipLevel, uint32_t arraySlice, const std::string& filename, Bitmap::FileFormat format, Bitmap::ExportFlags exportFlags, const Callback& callback = nullptr);
+
+        /** Hand the finished readbacks to the encoder and call the callbacks of the written files. Call it once per frame.
+        */
+        void update();
+
+        /** Block until all the pending captures were written
+        */
+        void flush();
+
+        /** Get the number of captures which were not written yet
+        */
+        uint32_t getPendingCount() const { return (uint32_t)mCaptures.size(); }
+
+        /** Same as the global findAvailableFilename(), but also skips the files of pending captures, which don't exist on disk yet.
+        */
+        bool findAvailableFilename(const std::string& prefix, const std::string& directory, const std::string& extension, std::string& filename) const;
+
+    private:
+        TextureCapture(uint32_t maxPendingCaptures);
+
+        struct Capture
+        {
+            CopyContext::ReadTextureTask::SharedPtr pTask;
+            std::string filename;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            ResourceFormat resourceFormat = ResourceFormat::Unknown;
+            Bitmap::FileFormat fileFormat = Bitmap::FileFormat::PngFile;
+            Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None;
+            Callback callback;
+            std::future<bool> encoded;
+            bool isEncoding = false;
+        };
+
+        void startEncode(Capture& capture);
+        bool isPending(const std::string& filename) const;
+
+        std::list<Capture> mCaptures;
+        uint32_t mMaxPendingCaptures;
+    };
+}
@@ -32,6 +32,11 @@
 #include "Utils/DDSHeader.h"
 #include "Utils/BinaryFileStream.h"
 #include "Utils/StringUtils.h"
+#include "Utils/ThreadPool.h"
+#include <type_traits>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 
 #ifdef FALCOR_GL
 static const bool kTopDown = false;
@@ -114,8 +119,6 @@ namespace Falcor
 		case DXGI_FORMAT_BC6H_UF16:
 		case DXGI_FORMAT_BC6H_SF16:
 		case DXGI_FORMAT_BC7_TYPELESS:
-		case DXGI_FORMAT_BC7_UNORM:
-		case DXGI_FORMAT_BC7_UNORM_SRGB:
 			return ResourceFormat::Unknown;
 		case DXGI_FORMAT_R32G32B32A32_FLOAT:
 			return ResourceFormat::RGBA32Float;
@@ -245,6 +248,10 @@ namespace Falcor
 			return ResourceFormat::BC5Unorm;
 		case DXGI_FORMAT_BC5_SNORM:
 			return ResourceFormat::BC5Snorm;
+		case DXGI_FORMAT_BC7_UNORM:
+			return ResourceFormat::BC7Unorm;
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			return ResourceFormat::BC7UnormSrgb;
 		default:
 			return ResourceFormat::Unknown;
 		}
@@ -539,14 +546,14 @@ namespace Falcor
 		}
 	}
 
-	void loadDDSDataFromFile(const std::string filename, DdsData& ddsData)
+	bool loadDDSDataFromFile(const std::string filename, DdsData& ddsData)
 	{
         std::string fullpath;
 		if (findFileInDataDirectories(filename, fullpath) == false)
 		{
 			logError(std::string("Can't find texture file ") + filename);
 			//could not find file
-			return;
+			return false;
 		}
 
 		BinaryFileStream stream(fullpath, BinaryFileStream::Mode::Read);
@@ -558,7 +565,7 @@ namespace Falcor
 		{
 			//not valid dds file apparently
 			logError(std::string("The dds file ") + filename + std::string(" is not a valid dds file"));
-			return;
+			return false;
 		}
 
         stream >> ddsData.header;
@@ -576,123 +583,600 @@ namespace Falcor
         uint32_t dataSize = stream.getRemainingStreamSize();
         ddsData.data.resize(dataSize);
         stream.read(ddsData.data.data(), dataSize);
+        return true;
 	}
 
-    Texture::SharedPtr createTextureFromDx10Dds(DdsData& ddsData, const std::string& filename, ResourceFormat format, uint32_t mipLevels, Texture::BindFlags bindFlags)
+    /** Texture file contents, ready to be uploaded. Produced by the CPU stage of the loaders, which doesn't touch the device.
+    */
+    struct DecodedTexture
+    {
+        Texture::Type type = Texture::Type::Texture2D;
+        uint32_t width = 0;
+        uint32_t height = 1;
+        uint32_t depth = 1;
+        uint32_t arraySize = 1;
+        uint32_t mipLevels = 1;
+        ResourceFormat format = ResourceFormat::Unknown;
+        std::vector<uint8_t> data;
+        Bitmap::UniqueConstPtr pBitmap;     ///< Decoded images keep their bitmap, to avoid copying the texels
+        std::string filename;
+
+        const void* getData() const { return pBitmap ? pBitmap->getData() : data.data(); }
+    };
+
+    bool decodeDx10Dds(DdsData& ddsData, const std::string& filename, DecodedTexture& tex)
     {
-        uint32_t arraySize = ddsData.dx10Header.arraySize;
-        assert(arraySize > 0);
+        tex.arraySize = ddsData.dx10Header.arraySize;
+        assert(tex.arraySize > 0);
+        const uint32_t flipMips = (tex.mipLevels == Texture::kMaxPossible) ? 1 : tex.mipLevels;
 
         switch(ddsData.dx10Header.resourceDimension)
         {
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_TEXTURE1D:
-            return Texture::create1D(ddsData.header.width, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+            tex.type = Texture::Type::Texture1D;
+            return true;
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_TEXTURE2D:
             if(ddsData.dx10Header.miscFlag & DdsHeaderDX10::kCubeMapMask)
             {
-                flipData(ddsData, format, ddsData.header.width, ddsData.header.height, 6 * arraySize, mipLevels == Texture::kMaxPossible ? 1 : mipLevels, true);
-                return Texture::createCube(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+                flipData(ddsData, tex.format, tex.width, tex.height, 6 * tex.arraySize, flipMips, true);
+                tex.type = Texture::Type::TextureCube;
             }
             else
             {
-                flipData(ddsData, format, ddsData.header.width, ddsData.header.height, arraySize, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-                return Texture::create2D(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.data.data(), bindFlags);
+                flipData(ddsData, tex.format, tex.width, tex.height, tex.arraySize, flipMips);
+                tex.type = Texture::Type::Texture2D;
             }
+            return true;
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_TEXTURE3D:
-            flipData(ddsData, format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.data.data(), bindFlags);
+            flipData(ddsData, tex.format, tex.width, tex.height, tex.depth, flipMips);
+            tex.type = Texture::Type::Texture3D;
+            return true;
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_BUFFER:
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_UNKNOWN:
             //these file formats are not supported 
             logError(std::string("the resource dimension specified in ") + filename + std::string(" is not supported by Falcor"));
+            return false;
         default:
             should_not_get_here();
-            return nullptr;
+            return false;
         }
     }
 
-    Texture::SharedPtr createTextureFromLegacyDds(DdsData& ddsData, const std::string& filename, ResourceFormat format, uint32_t mipLevels, Texture::BindFlags bindFlags)
+    void decodeLegacyDds(DdsData& ddsData, DecodedTexture& tex)
     {
+        const uint32_t flipMips = (tex.mipLevels == Texture::kMaxPossible) ? 1 : tex.mipLevels;
+
         //load the volume or 3D texture
         if(ddsData.header.flags & DdsHeader::kDepthMask)
         {
-            flipData(ddsData, format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.data.data(), bindFlags);
+            flipData(ddsData, tex.format, tex.width, tex.height, tex.depth, flipMips);
+            tex.type = Texture::Type::Texture3D;
         }
         //load the cubemap texture
         else if(ddsData.header.caps[1] & DdsHeader::kCaps2CubeMapMask)
         {
-            return Texture::createCube(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.data.data(), bindFlags);
+            tex.type = Texture::Type::TextureCube;
         }
         //This is a 2D Texture
         else
         {
-            flipData(ddsData, format, ddsData.header.width, ddsData.header.height, 1, mipLevels == Texture::kMaxPossible ? 1 : mipLevels);
-            return Texture::create2D(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.data.data(), bindFlags);
+            flipData(ddsData, tex.format, tex.width, tex.height, 1, flipMips);
+            tex.type = Texture::Type::Texture2D;
         }
-
-        should_not_get_here();
-        return nullptr;
     }
 
-	Texture::SharedPtr createTextureFromDDSFile(const std::string filename, bool generateMips, Texture::BindFlags bindFlags)
+	bool decodeDDSFile(const std::string& filename, bool generateMips, DecodedTexture& tex)
 	{
 		DdsData ddsData;
-		loadDDSDataFromFile(filename, ddsData);
+		if(loadDDSDataFromFile(filename, ddsData) == false)
+		{
+			return false;
+		}
 		
-		ResourceFormat format = getDdsResourceFormat(ddsData);
-		assert(format != ResourceFormat::Unknown);
+		tex.format = getDdsResourceFormat(ddsData);
+		if(tex.format == ResourceFormat::Unknown)
+		{
+			logError(std::string("The dds file ") + filename + std::string(" has an unsupported format"));
+			return false;
+		}
 
-		uint32_t mipLevels;
 		if (generateMips)
 		{
-			mipLevels = Texture::kMaxPossible;
+			tex.mipLevels = Texture::kMaxPossible;
 		} 
 		else
 		{
-			mipLevels = (ddsData.header.flags & DdsHeader::kMipCountMask) ? max(ddsData.header.mipCount, 1U) : 1;
+			tex.mipLevels = (ddsData.header.flags & DdsHeader::kMipCountMask) ? max(ddsData.header.mipCount, 1U) : 1;
 		}
+
+		tex.width = ddsData.header.width;
+		tex.height = ddsData.header.height;
+		tex.depth = max(ddsData.header.depth, 1U);
 	
 		if (ddsData.hasDX10Header)
 		{
-            return createTextureFromDx10Dds(ddsData, filename, format, mipLevels, bindFlags);
+			if(decodeDx10Dds(ddsData, filename, tex) == false)
+			{
+				return false;
+			}
 		}
 		else
 		{
-            return createTextureFromLegacyDds(ddsData, filename, format, mipLevels, bindFlags);
+			decodeLegacyDds(ddsData, tex);
 		}
-		
-		return nullptr;
+
+		tex.data.swap(ddsData.data);
+		return true;
 	}
 
-	Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    static const std::string kBakedTextureSuffix = ".baked.dds";
+
+    std::string getBakedTextureFilename(const std::string& filename)
     {
-#define no_srgb()   \
-    if(loadAsSrgb)  \
-    {               \
-        logWarning("createTexture2DFromFile() warning. " + std::to_string(pBitmap->getBytesPerPixel()) + " channel images doesn't have a matching sRGB format. Loading in linear space.");  \
+        size_t extension = filename.find_last_of('.');
+        size_t separator = filename.find_last_of("/\\");
+        if(extension == std::string::npos || (separator != std::string::npos && extension < separator))
+        {
+            return filename + kBakedTextureSuffix;
+        }
+        return filename.substr(0, extension) + kBakedTextureSuffix;
     }
-			
+
+    /** Find the baked version of an image file. Baked files which are older than the image are ignored.
+    */
+    static bool findBakedTexture(const std::string& filename, std::string& bakedPath)
+    {
+        if(hasSuffix(filename, ".dds", false))
+        {
+            return false;
+        }
+
+        if(findFileInDataDirectories(getBakedTextureFilename(filename), bakedPath) == false)
+        {
+            return false;
+        }
+
+        std::string sourcePath;
+        if(findFileInDataDirectories(filename, sourcePath) && getFileModifiedTime(sourcePath) > getFileModifiedTime(bakedPath))
+        {
+            logWarning("Baked texture " + bakedPath + " is older than " + sourcePath + ". Loading the original image.");
+            return false;
+        }
+        return true;
+    }
+
+    bool decodeBakedFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, DecodedTexture& tex)
+    {
+        // Baked files already hold the full mip-chain
+        if(decodeDDSFile(filename, false, tex) == false)
+        {
+            return false;
+        }
+
+        tex.mipLevels = generateMipLevels ? tex.mipLevels : 1;
+        tex.format = loadAsSrgb ? linearToSrgbFormat(tex.format) : srgbToLinearFormat(tex.format);
+        return true;
+    }
+
+    bool decodeTextureFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, DecodedTexture& tex)
+    {
+        tex.filename = stripDataDirectories(filename);
+        if(hasSuffix(filename, kBakedTextureSuffix, false))
+        {
+            return decodeBakedFile(filename, generateMipLevels, loadAsSrgb, tex);
+        }
+
 		if (hasSuffix(filename, ".dds"))
 		{
-			return createTextureFromDDSFile(filename, generateMipLevels, bindFlags);
+			return decodeDDSFile(filename, generateMipLevels, tex);
 		}
 
-        Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(filename, kTopDown);
+        std::string bakedFilename;
+        if(findBakedTexture(filename, bakedFilename) && decodeBakedFile(bakedFilename, generateMipLevels, loadAsSrgb, tex))
+        {
+            return true;
+        }
+
+        tex.pBitmap = Bitmap::createFromFile(filename, kTopDown);
+        if(tex.pBitmap == nullptr)
+        {
+            return false;
+        }
+
+        tex.format = tex.pBitmap->getFormat();
+        if(loadAsSrgb)
+        {
+            tex.format = linearToSrgbFormat(tex.format);
+        }
+        tex.type = Texture::Type::Texture2D;
+        tex.width = tex.pBitmap->getWidth();
+        tex.height = tex.pBitmap->getHeight();
+        tex.mipLevels = generateMipLevels ? Texture::kMaxPossible : 1;
+        return true;
+    }
+
+    Texture::SharedPtr createTextureFromDecodedData(const DecodedTexture& tex, Texture::BindFlags bindFlags)
+    {
         Texture::SharedPtr pTex;
+        switch(tex.type)
+        {
+        case Texture::Type::Texture1D:
+            pTex = Texture::create1D(tex.width, tex.format, tex.arraySize, tex.mipLevels, tex.getData(), bindFlags);
+            break;
+        case Texture::Type::Texture2D:
+            pTex = Texture::create2D(tex.width, tex.height, tex.format, tex.arraySize, tex.mipLevels, tex.getData(), bindFlags);
+            break;
+        case Texture::Type::Texture3D:
+            pTex = Texture::create3D(tex.width, tex.height, tex.depth, tex.format, tex.mipLevels, tex.getData(), bindFlags);
+            break;
+        case Texture::Type::TextureCube:
+            pTex = Texture::createCube(tex.width, tex.height, tex.format, tex.arraySize, tex.mipLevels, tex.getData(), bindFlags);
+            break;
+        default:
+            should_not_get_here();
+        }
 
-        if(pBitmap)
+        if(pTex)
         {
-            ResourceFormat texFormat = pBitmap->getFormat();
-            if(loadAsSrgb)
+            pTex->setSourceFilename(tex.filename);
+        }
+        return pTex;
+    }
+
+	Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+        DecodedTexture tex;
+        if(decodeTextureFile(filename, generateMipLevels, loadAsSrgb, tex) == false)
+        {
+            return nullptr;
+        }
+        return createTextureFromDecodedData(tex, bindFlags);
+    }
+
+    /** A texture whose CPU stage is running or completed, waiting to be created by createPendingTextures()
+    */
+    struct PendingTexture
+    {
+        DecodedTexture decoded;
+        bool decodeSucceeded = false;
+        Texture::BindFlags bindFlags;
+        std::promise<Texture::SharedPtr> promise;
+    };
+
+    static std::mutex sPendingMutex;
+    static std::condition_variable sDecodedCondition;
+    static std::deque<std::shared_ptr<PendingTexture>> sDecodedTextures;   ///< Textures whose CPU stage is done, in completion order
+    static uint32_t sPendingCount = 0;                                      ///< Textures whose promise wasn't fulfilled yet
+
+    TextureLoadHandle createTextureFromFileAsync(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+        auto pPending = std::make_shared<PendingTexture>();
+        pPending->bindFlags = bindFlags;
+        TextureLoadHandle handle = pPending->promise.get_future().share();
+
+        {
+            std::lock_guard<std::mutex> lock(sPendingMutex);
+            sPendingCount++;
+        }
+
+        ThreadPool::instance()->submit([pPending, filename, generateMipLevels, loadAsSrgb]()
+        {
+            pPending->decodeSucceeded = decodeTextureFile(filename, generateMipLevels, loadAsSrgb, pPending->decoded);
+            std::lock_guard<std::mutex> lock(sPendingMutex);
+            sDecodedTextures.push_back(pPending);
+            sDecodedCondition.notify_all();
+        });
+        return handle;
+    }
+
+    uint32_t createPendingTextures(uint32_t maxCount)
+    {
+        std::vector<std::shared_ptr<PendingTexture>> batch;
+        {
+            std::lock_guard<std::mutex> lock(sPendingMutex);
+            while(sDecodedTextures.size() && (uint32_t)batch.size() < maxCount)
+            {
+                batch.push_back(sDecodedTextures.front());
+                sDecodedTextures.pop_front();
+            }
+        }
+
+        for(auto& pPending : batch)
+        {
+            Texture::SharedPtr pTex;
+            if(pPending->decodeSucceeded)
             {
-                texFormat = linearToSrgbFormat(texFormat);
+                pTex = createTextureFromDecodedData(pPending->decoded, pPending->bindFlags);
             }
+            // Release the texels before the handle becomes ready, the caller may start another batch right away
+            pPending->decoded = DecodedTexture();
+            pPending->promise.set_value(pTex);
+        }
 
-            pTex = Texture::create2D(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags);
-            pTex->setSourceFilename(stripDataDirectories(filename));
+        if(batch.size())
+        {
+            std::lock_guard<std::mutex> lock(sPendingMutex);
+            sPendingCount -= (uint32_t)batch.size();
         }
-        return pTex;
+        return (uint32_t)batch.size();
+    }
+
+    uint32_t getPendingTextureCount()
+    {
+        std::lock_guard<std::mutex> lock(sPendingMutex);
+        return sPendingCount;
+    }
+
+    Texture::SharedPtr waitForTexture(const TextureLoadHandle& handle)
+    {
+        while(handle.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            if(createPendingTextures() == 0)
+            {
+                std::unique_lock<std::mutex> lock(sPendingMutex);
+                // Another thread may be creating the texture we're waiting for, so don't block indefinitely
+                sDecodedCondition.wait_for(lock, std::chrono::milliseconds(1), []() { return sDecodedTextures.size() > 0; });
+            }
+        }
+        return handle.get();
+    }
+
+    void waitForPendingTextures()
+    {
+        while(getPendingTextureCount() > 0)
+        {
+            if(createPendingTextures() == 0)
+            {
+                std::unique_lock<std::mutex> lock(sPendingMutex);
+                sDecodedCondition.wait_for(lock, std::chrono::milliseconds(1), []() { return sDecodedTextures.size() > 0 || sPendingCount == 0; });
+            }
+        }
+    }
+
+    uint32_t getTextureMipSize(uint32_t width, uint32_t height, ResourceFormat format, uint32_t mipLevel)
+    {
+        uint32_t w = max(width >> mipLevel, 1U);
+        uint32_t h = max(height >> mipLevel, 1U);
+        uint32_t wRatio = getFormatWidthCompressionRatio(format);
+        uint32_t hRatio = getFormatHeightCompressionRatio(format);
+        return ((w + wRatio - 1) / wRatio) * ((h + hRatio - 1) / hRatio) * getFormatBytesPerBlock(format);
+    }
+
+    template<typename ChannelType>
+    void downsampleMipLevel(const ChannelType* pSrc, uint32_t srcWidth, uint32_t srcHeight, uint32_t channelCount, ChannelType* pDst)
+    {
+        uint32_t dstWidth = max(srcWidth >> 1, 1U);
+        uint32_t dstHeight = max(srcHeight >> 1, 1U);
+
+        for(uint32_t y = 0; y < dstHeight; y++)
+        {
+            uint32_t y0 = min(y * 2, srcHeight - 1);
+            uint32_t y1 = min(y * 2 + 1, srcHeight - 1);
+            for(uint32_t x = 0; x < dstWidth; x++)
+            {
+                uint32_t x0 = min(x * 2, srcWidth - 1);
+                uint32_t x1 = min(x * 2 + 1, srcWidth - 1);
+                for(uint32_t c = 0; c < channelCount; c++)
+                {
+                    float sum = (float)pSrc[(y0 * srcWidth + x0) * channelCount + c] + (float)pSrc[(y0 * srcWidth + x1) * channelCount + c] +
+                                (float)pSrc[(y1 * srcWidth + x0) * channelCount + c] + (float)pSrc[(y1 * srcWidth + x1) * channelCount + c];
+                    // Round to nearest for the 8-bit formats
+                    pDst[(y * dstWidth + x) * channelCount + c] = std::is_floating_point<ChannelType>::value ? (ChannelType)(sum * 0.25f) : (ChannelType)(sum * 0.25f + 0.5f);
+                }
+            }
+        }
+    }
+
+    bool generateTextureMipChain(const void* pData, uint32_t width, uint32_t height, ResourceFormat format, uint32_t firstMip, TextureMipChain& chain)
+    {
+        if(isCompressedFormat(format))
+        {
+            return false;
+        }
+
+        // sRGB data is filtered in gamma space. This is the same approximation the GPU mip-generation makes for 8-bit formats
+        const uint32_t channelCount = getFormatChannelCount(format);
+        const uint32_t bytesPerPixel = getFormatBytesPerBlock(format);
+        const FormatType type = getFormatType(format);
+        const bool is8Bit = (bytesPerPixel == channelCount) && (type == FormatType::Unorm || type == FormatType::UnormSrgb);
+        const bool isFloat = (bytesPerPixel == channelCount * sizeof(float)) && (type == FormatType::Float);
+        if(is8Bit == false && isFloat == false)
+        {
+            return false;
+        }
+
+        uint32_t mipCount = 1;
+        while((max(width, height) >> mipCount) > 0)
+        {
+            mipCount++;
+        }
+
+        if(firstMip >= mipCount)
+        {
+            return false;
+        }
+
+        chain.width = max(width >> firstMip, 1U);
+        chain.height = max(height >> firstMip, 1U);
+        chain.mipCount = mipCount - firstMip;
+        chain.format = format;
+        chain.data.clear();
+
+        std::vector<uint8_t> current((const uint8_t*)pData, (const uint8_t*)pData + getTextureMipSize(width, height, format, 0));
+        std::vector<uint8_t> next;
+        for(uint32_t mip = 0; mip < mipCount; mip++)
+        {
+            if(mip >= firstMip)
+            {
+                chain.data.insert(chain.data.end(), current.begin(), current.end());
+            }
+
+            if(mip + 1 < mipCount)
+            {
+                uint32_t srcWidth = max(width >> mip, 1U);
+                uint32_t srcHeight = max(height >> mip, 1U);
+                next.resize(getTextureMipSize(width, height, format, mip + 1));
+                if(is8Bit)
+                {
+                    downsampleMipLevel<uint8_t>(current.data(), srcWidth, srcHeight, channelCount, next.data());
+                }
+                else
+                {
+                    downsampleMipLevel<float>((const float*)current.data(), srcWidth, srcHeight, channelCount, (float*)next.data());
+                }
+                current.swap(next);
+            }
+        }
+        return true;
+    }
+
+    bool loadDDSMipChain(const std::string& filename, uint32_t firstMip, TextureMipChain& chain)
+    {
+        std::string fullpath;
+        if(findFileInDataDirectories(filename, fullpath) == false)
+        {
+            logError(std::string("Can't find texture file ") + filename);
+            return false;
+        }
+
+        BinaryFileStream stream(fullpath, BinaryFileStream::Mode::Read);
+        uint32_t ddsIdentifier;
+        stream >> ddsIdentifier;
+        if(ddsIdentifier != kDdsMagicNumber)
+        {
+            logError(std::string("The dds file ") + filename + std::string(" is not a valid dds file"));
+            return false;
+        }
+
+        DdsData ddsData;
+        stream >> ddsData.header;
+        ddsData.hasDX10Header = (ddsData.header.pixelFormat.flags & DdsHeader::PixelFormat::kFourCCFlag) && (makeFourCC("DX10") == ddsData.header.pixelFormat.fourCC);
+        if(ddsData.hasDX10Header)
+        {
+            stream >> ddsData.dx10Header;
+            if(ddsData.dx10Header.resourceDimension != D3D10_RESOURCE_DIMENSION_TEXTURE2D || ddsData.dx10Header.arraySize != 1 || (ddsData.dx10Header.miscFlag & DdsHeaderDX10::kCubeMapMask))
+            {
+                return false;
+            }
+        }
+        else if((ddsData.header.flags & DdsHeader::kDepthMask) || (ddsData.header.caps[1] & DdsHeader::kCaps2CubeMapMask))
+        {
+            return false;
+        }
+
+        const ResourceFormat format = getDdsResourceFormat(ddsData);
+        const uint32_t fileMipCount = (ddsData.header.flags & DdsHeader::kMipCountMask) ? max(ddsData.header.mipCount, 1U) : 1;
+        if(format == ResourceFormat::Unknown || firstMip >= fileMipCount)
+        {
+            return false;
+        }
+
+        const uint32_t width = ddsData.header.width;
+        const uint32_t height = ddsData.header.height;
+        uint32_t skipSize = 0;
+        for(uint32_t mip = 0; mip < firstMip; mip++)
+        {
+            skipSize += getTextureMipSize(width, height, format, mip);
+        }
+        uint32_t readSize = 0;
+        for(uint32_t mip = firstMip; mip < fileMipCount; mip++)
+        {
+            readSize += getTextureMipSize(width, height, format, mip);
+        }
+
+        stream.skip(skipSize);
+        ddsData.data.resize(readSize);
+        stream.read(ddsData.data.data(), readSize);
+        if(stream.isFail())
+        {
+            logError(std::string("The dds file ") + filename + std::string(" is truncated"));
+            return false;
+        }
+
+        chain.width = max(width >> firstMip, 1U);
+        chain.height = max(height >> firstMip, 1U);
+        chain.mipCount = fileMipCount - firstMip;
+        chain.format = format;
+        flipData(ddsData, format, chain.width, chain.height, 1, chain.mipCount);
+        chain.data.swap(ddsData.data);
+        return true;
+    }
+
+    bool loadTextureMipChain(const std::string& filename, uint32_t firstMip, TextureMipChain& chain)
+    {
+        if(hasSuffix(filename, ".dds"))
+        {
+            return loadDDSMipChain(filename, firstMip, chain);
+        }
+
+        std::string bakedFilename;
+        if(findBakedTexture(filename, bakedFilename) && loadDDSMipChain(bakedFilename, firstMip, chain))
+        {
+            return true;
+        }
+
+        Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(filename, kTopDown);
+        if(pBitmap == nullptr)
+        {
+            return false;
+        }
+        return generateTextureMipChain(pBitmap->getData(), pBitmap->getWidth(), pBitmap->getHeight(), pBitmap->getFormat(), firstMip, chain);
+    }
+
+    bool saveTextureMipChainToDDS(const std::string& filename, const TextureMipChain& chain)
+    {
+        // Find the DXGI format using the reverse mapping of the loader
+        DXGI_FORMAT dxgiFormat = DXGI_FORMAT_UNKNOWN;
+        for(uint32_t f = DXGI_FORMAT_R32G32B32A32_TYPELESS; f <= DXGI_FORMAT_B4G4R4A4_UNORM; f++)
+        {
+            if(falcorFormatFromDXGIFormat((DXGI_FORMAT)f) == chain.format)
+            {
+                dxgiFormat = (DXGI_FORMAT)f;
+                break;
+            }
+        }
+
+        if(dxgiFormat == DXGI_FORMAT_UNKNOWN || chain.mipCount == 0)
+        {
+            logError("Can't save texture " + filename + ". The format is not supported by the DDS writer.");
+            return false;
+        }
+
+        DdsHeader header = {};
+        header.headerSize = sizeof(DdsHeader);
+        header.flags = DdsHeader::kCapsMask | DdsHeader::kHeightMask | DdsHeader::kWidthMask | DdsHeader::kPixelFormatMask | DdsHeader::kMipCountMask;
+        header.width = chain.width;
+        header.height = chain.height;
+        header.mipCount = chain.mipCount;
+        header.pixelFormat.structSize = sizeof(DdsHeader::PixelFormat);
+        header.pixelFormat.flags = DdsHeader::PixelFormat::kFourCCFlag;
+        header.pixelFormat.fourCC = makeFourCC("DX10");
+        header.caps[0] = DdsHeader::kCapsTextureMask | ((chain.mipCount > 1) ? (DdsHeader::kCapsComplexMask | DdsHeader::kCapsMipMapMask) : 0);
+        if(isCompressedFormat(chain.format))
+        {
+            header.flags |= DdsHeader::kLinearSizeMask;
+            header.linearSize = getTextureMipSize(chain.width, chain.height, chain.format, 0);
+        }
+        else
+        {
+            header.flags |= DdsHeader::kPitchMask;
+            header.pitch = chain.width * getFormatBytesPerBlock(chain.format);
+        }
+
+        DdsHeaderDX10 dx10Header = {};
+        dx10Header.dxgiFormat = dxgiFormat;
+        dx10Header.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+        dx10Header.arraySize = 1;
+
+        BinaryFileStream stream(filename, BinaryFileStream::Mode::Write);
+        stream << kDdsMagicNumber << header << dx10Header;
+        stream.write(chain.data.data(), chain.data.size());
+        if(stream.isFail())
+        {
+            logError("Failed to write texture file " + filename);
+            stream.remove();
+            return false;
+        }
+        return true;
     }
-#undef no_srgb
 }
@@ -27,6 +27,8 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <vector>
+#include <future>
 #include "API/Texture.h"
 namespace Falcor
 {
@@ -42,6 +44,82 @@ namespace Falcor
         \param[in] bindFlags The bind flags to create the texture with
     */
 	Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+
+    /** Handle to a texture loaded by createTextureFromFileAsync(). The handle becomes ready once the texture was created by createPendingTextures(), and holds nullptr if loading failed.
+    */
+    using TextureLoadHandle = std::shared_future<Texture::SharedPtr>;
+
+    /** Start loading a texture from a file. Returns immediately.
+        File I/O, header parsing, row flipping and format conversion run on the global ThreadPool. The GPU texture is created later, on the thread which calls createPendingTextures() (usually the render thread).
+        The arguments are the same as createTextureFromFile(). Can be called from any thread.
+    */
+    TextureLoadHandle createTextureFromFileAsync(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+
+    /** Create the GPU textures of the asynchronous loads whose CPU stage is done, and make their handles ready. Call this once per frame, or in a loop while loading a scene.
+        \param[in] maxCount Maximum number of textures to create in this batch. Use it to limit the time spent per frame.
+        \return The number of textures processed
+    */
+    uint32_t createPendingTextures(uint32_t maxCount = UINT32_MAX);
+
+    /** Get the number of asynchronous loads which are not ready yet
+    */
+    uint32_t getPendingTextureCount();
+
+    /** Block until a texture is ready. Creates pending textures while waiting, so it's safe to call from the thread which owns the device.
+    */
+    Texture::SharedPtr waitForTexture(const TextureLoadHandle& handle);
+
+    /** Block until all the asynchronous loads are ready
+    */
+    void waitForPendingTextures();
+
+    /** CPU-side copy of a range of mip-levels of a 2D texture
+    */
+    struct TextureMipChain
+    {
+        uint32_t width = 0;                                 ///< Width of the first mip-level in the chain
+        uint32_t height = 0;                                ///< Height of the first mip-level in the chain
+        uint32_t mipCount = 0;                              ///< Number of mip-levels in the chain
+        ResourceFormat format = ResourceFormat::Unknown;    ///< Texel format
+        std::vector<uint8_t> data;                          ///< The mip-levels, tightly packed, most detailed level first
+    };
+
+    /** Read the mip-chain of a 2D texture file into system memory, starting at a given mip-level. No GPU resources are created, so this can be called from any thread.
+        DDS files are read from the requested level onwards. Other image files are decoded and the missing levels are generated on the CPU.
+        \param[in] filename Filename
+        \param[in] firstMip The most detailed mip-level to read
+        \param[out] chain The mip-levels [firstMip, lastMip] of the file
+        \return true on success, otherwise false
+    */
+    bool loadTextureMipChain(const std::string& filename, uint32_t firstMip, TextureMipChain& chain);
+
+    /** Generate mip-levels [firstMip, lastMip] from the most detailed level of an image using a box filter. Only uncompressed formats with 8-bit or 32-bit float channels are supported.
+        \param[in] pData The mip 0 texels
+        \param[in] width The image width
+        \param[in] height The image height
+        \param[in] format The image format
+        \param[in] firstMip The most detailed mip-level to output
+        \param[out] chain The generated mip-levels
+        \return true on success, false if the format is not supported
+    */
+    bool generateTextureMipChain(const void* pData, uint32_t width, uint32_t height, ResourceFormat format, uint32_t firstMip, TextureMipChain& chain);
+
+    /** Get the size in bytes of a single mip-level of a 2D texture
+    */
+    uint32_t getTextureMipSize(uint32_t width, uint32_t height, ResourceFormat format, uint32_t mipLevel);
+
+    /** Write a 2D mip-chain into a DDS file with a DX10 header. The rows are expected in top-down order.
+        \param[in] filename The output filename
+        \param[in] chain The mip-levels to write. The first level in the chain becomes the file's mip 0.
+        \return true on success, otherwise false
+    */
+    bool saveTextureMipChainToDDS(const std::string& filename, const TextureMipChain& chain);
+
+    /** Get the name of the baked version of an image file, which is '<name>.baked.dds'.
+        createTextureFromFile(), createTextureFromFileAsync() and loadTextureMipChain() load the baked file instead of the image if it exists and is not older than the image.
+        Baked files are block-compressed and hold the full mip-chain, so no mips are generated when loading them. The sRGB flag is taken from the loadAsSrgb argument and not from the file.
+    */
+    std::string getBakedTextureFilename(const std::string& filename);
     
     /*! @} */
 }
\ No newline at end of file
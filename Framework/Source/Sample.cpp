@@ -33,6 +33,7 @@
 #include "Graphics/Program.h"
 #include "Utils/OS.h"
 #include "API/FBO.h"
+#include "Graphics/TextureCapture.h"
 #include "VR\OpenVR\VRSystem.h"
 
 namespace Falcor
@@ -195,6 +196,8 @@ namespace Falcor
         onLoad();
         mpWindow->msgLoop();
 
+        // Write the screenshots which are still in flight while the device is alive
+        TextureCapture::instance()->flush();
         onShutdown();
         Logger::shutdown();
     }
@@ -313,6 +316,7 @@ namespace Falcor
         {
             captureScreen();
         }
+        TextureCapture::instance()->update();
         printProfileData();
         {
             PROFILE(present);
@@ -328,10 +332,10 @@ namespace Falcor
         std::string prefix = std::string(filename);
         std::string executableDir = getExecutableDirectory();
         std::string pngFile;
-        if(findAvailableFilename(prefix, executableDir, "png", pngFile))
+        if(TextureCapture::instance()->findAvailableFilename(prefix, executableDir, "png", pngFile))
         {
             Texture::SharedPtr pTexture = gpDevice->getSwapChainFbo()->getColorTexture(0);
-            pTexture->captureToFile(0, 0, pngFile);
+            pTexture->captureToFileAsync(0, 0, pngFile);
         }
         else
         {
@@ -413,6 +417,11 @@ namespace Falcor
         }
     }
 
+    // Number of frames a video frame readback has before the CPU needs it
+    static const uint32_t kVideoReadbackLatency = 3;
+    // Number of frames the encoder thread can lag behind
+    static const uint32_t kVideoEncoderQueueSize = 4;
+
     void Sample::startVideoCapture()
     {
         // create the capture object and frame buffer
@@ -427,10 +436,12 @@ namespace Falcor
         desc.bitrateMbps = mVideoCapture.pUI->getBitrate();
         desc.gopSize    = mVideoCapture.pUI->getGopSize();
 
-        mVideoCapture.pVideoCapture = VideoEncoder::create(desc);
+        mVideoCapture.pVideoCapture = AsyncVideoEncoder::create(desc, kVideoEncoderQueueSize, AsyncVideoEncoder::Backpressure::Wait);
 
         assert(mVideoCapture.pVideoCapture);
-        mVideoCapture.pFrame = new uint8_t[desc.width*desc.height * 4];
+        mVideoCapture.readbacks.assign(kVideoReadbackLatency, nullptr);
+        mVideoCapture.readbackIndex = 0;
+        mVideoCapture.readbackStalls = 0;
 
         mVideoCapture.timeDelta = 1 / (float)desc.fps;
 
@@ -452,19 +463,57 @@ namespace Falcor
     {
         if(mVideoCapture.pVideoCapture)
         {
+            // Encode the frames which are still in flight, oldest first
+            for(uint32_t i = 0; i < mVideoCapture.readbacks.size(); i++)
+            {
+                uint32_t index = (mVideoCapture.readbackIndex + i) % (uint32_t)mVideoCapture.readbacks.size();
+                if(mVideoCapture.readbacks[index])
+                {
+                    encodeVideoReadback(mVideoCapture.readbacks[index].get());
+                }
+            }
+
             mVideoCapture.pVideoCapture->endCapture();
+            logInfo(mVideoCapture.pVideoCapture->getStats().toString() + ", " + std::to_string(mVideoCapture.readbackStalls) + " readback stalls");
             mShowUI = true;
         }
         mVideoCapture.pUI = nullptr;
         mVideoCapture.pVideoCapture = nullptr;
-        safe_delete_array(mVideoCapture.pFrame);
+        mVideoCapture.readbacks.clear();
+    }
+
+    void Sample::encodeVideoReadback(CopyContext::ReadTextureTask* pReadback)
+    {
+        if(pReadback->isReady() == false)
+        {
+            mVideoCapture.readbackStalls++;
+        }
+
+        uint8_t* pFrame = mVideoCapture.pVideoCapture->beginFrame();
+        if(pFrame)
+        {
+            pReadback->readData(pFrame);
+            mVideoCapture.pVideoCapture->submitFrame();
+        }
     }
 
     void Sample::captureVideoFrame()
     {
         if(mVideoCapture.pVideoCapture)
         {
-            mVideoCapture.pVideoCapture->appendFrame(mpRenderContext->readTextureSubresource(mpDefaultFBO->getColorTexture(0).get(), 0).data());
+            // Encode the frame read kVideoReadbackLatency frames ago, and reuse its buffer for the current frame
+            const Texture* pTexture = mpDefaultFBO->getColorTexture(0).get();
+            auto& pReadback = mVideoCapture.readbacks[mVideoCapture.readbackIndex];
+            if(pReadback)
+            {
+                encodeVideoReadback(pReadback.get());
+                pReadback->reissue(mpRenderContext.get(), pTexture, 0);
+            }
+            else
+            {
+                pReadback = mpRenderContext->asyncReadTextureSubresource(pTexture, 0);
+            }
+            mVideoCapture.readbackIndex = (mVideoCapture.readbackIndex + 1) % (uint32_t)mVideoCapture.readbacks.size();
 
             if(mVideoCapture.pUI->useTimeRange())
             {
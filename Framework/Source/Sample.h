@@ -36,6 +36,7 @@
 #include "utils/TextRenderer.h"
 #include "API/RenderContext.h"
 #include "Utils/Video/VideoEncoderUI.h"
+#include "Utils/Video/AsyncVideoEncoder.h"
 #include "API/Device.h"
 #include "ArgList.h"
 
@@ -178,6 +179,7 @@ namespace Falcor
         void startVideoCapture();
         void endVideoCapture();
         void captureVideoFrame();
+        void encodeVideoReadback(CopyContext::ReadTextureTask* pReadback);
         void renderGUI();
 
         Window::SharedPtr mpWindow;
@@ -191,8 +193,10 @@ namespace Falcor
         struct VideoCaptureData
         {
             VideoEncoderUI::UniquePtr pUI;
-            VideoEncoder::UniquePtr pVideoCapture;
-            uint8_t* pFrame = nullptr;
+            AsyncVideoEncoder::UniquePtr pVideoCapture;
+            std::vector<CopyContext::ReadTextureTask::SharedPtr> readbacks;    // Ring of frame readbacks, consumed readbacks.size() frames after they were issued
+            uint32_t readbackIndex = 0;
+            uint64_t readbackStalls = 0;    // Number of frames the GPU didn't finish the readback in time
             float timeDelta;
         };
 
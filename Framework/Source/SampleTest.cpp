@@ -134,6 +134,8 @@ void SampleTest::runTestTask(const FrameRate& frameRate)
                 captureScreen();
                 break;
             case Task::Type::Shutdown:
+                // Screenshots are written in the background, make sure they are on disk before exiting
+                TextureCapture::instance()->flush();
                 outputXML();
                 exit(1);
                 break;
@@ -154,10 +156,10 @@ void SampleTest::captureScreen()
     std::string prefix = std::string(filename);
     std::string executableDir = getExecutableDirectory();
     std::string pngFile;
-    if (findAvailableFilename(prefix, executableDir, "png", pngFile))
+    if (TextureCapture::instance()->findAvailableFilename(prefix, executableDir, "png", pngFile))
     {
         Texture::SharedPtr pTexture = gpDevice->getSwapChainFbo()->getColorTexture(0);
-        pTexture->captureToFile(0, 0, pngFile);
+        pTexture->captureToFileAsync(0, 0, pngFile);
     }
     else
     {
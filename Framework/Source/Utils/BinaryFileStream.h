@@ -89,6 +89,10 @@ namespace Falcor
 			return (uint32_t)(length - currentPos); 
 		}
 
+        std::streamoff getPosition() { return mStream.tellg(); }
+
+        void setPosition(std::streamoff position) { mStream.seekg(position); }
+
         bool isGood() { return mStream.good(); }
         bool isBad()  { return mStream.bad(); }
         bool isFail() { return mStream.fail(); }
@@ -173,11 +173,12 @@ namespace Falcor
         return FIT_BITMAP;
     }
 
-    void Bitmap::saveImage(const std::string& filename, uint32_t width, uint32_t height, FileFormat fileFormat, ExportFlags exportFlags, ResourceFormat resourceFormat, bool isTopDown, void* pData)
+    bool Bitmap::saveImage(const std::string& filename, uint32_t width, uint32_t height, FileFormat fileFormat, ExportFlags exportFlags, ResourceFormat resourceFormat, bool isTopDown, void* pData)
     {
         if(pData == nullptr)
         {
             logError("Bitmap::saveImage provided no data to save.");
+            return false;
         }
         
         if(is_set(exportFlags, ExportFlags::Uncompressed) && is_set(exportFlags, ExportFlags::Lossy))
@@ -322,7 +323,8 @@ namespace Falcor
             }
         }
 
-        FreeImage_Save(toFreeImageFormat(fileFormat), pImage, filename.c_str(), flags);
+        BOOL saved = FreeImage_Save(toFreeImageFormat(fileFormat), pImage, filename.c_str(), flags);
         FreeImage_Unload(pImage);
+        return saved != FALSE;
     }
 }
\ No newline at end of file
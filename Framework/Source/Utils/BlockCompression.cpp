@@ -0,0 +1,700 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "BlockCompression.h"
+#include <emmintrin.h>
+#include <cfloat>
+#include <cmath>
+#include "Utils/ThreadPool.h"
+
+namespace Falcor
+{
+    namespace BlockCompression
+    {
+        static const uint32_t kBC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+        // Texels of a block, one row of 16 values per channel
+        using BlockTexels = float[4][16];
+
+        static void loadTexels(const uint8_t* pTexels, BlockTexels& texels)
+        {
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                for(uint32_t c = 0; c < 4; c++)
+                {
+                    texels[c][i] = (float)pTexels[i * 4 + c];
+                }
+            }
+        }
+
+        /** Find the closest palette entry to each texel, 4 texels at a time
+            \return The sum of the squared errors
+        */
+        static float selectIndices(const float (*texels)[16], uint32_t channelCount, const float (*palette)[4], uint32_t paletteSize, uint8_t indices[16])
+        {
+            float totalError = 0;
+            for(uint32_t group = 0; group < 4; group++)
+            {
+                __m128 t[4];
+                for(uint32_t c = 0; c < channelCount; c++)
+                {
+                    t[c] = _mm_loadu_ps(&texels[c][group * 4]);
+                }
+
+                __m128 bestError = _mm_set1_ps(FLT_MAX);
+                __m128i bestIndex = _mm_setzero_si128();
+                for(uint32_t p = 0; p < paletteSize; p++)
+                {
+                    __m128 error = _mm_setzero_ps();
+                    for(uint32_t c = 0; c < channelCount; c++)
+                    {
+                        __m128 d = _mm_sub_ps(t[c], _mm_set1_ps(palette[p][c]));
+                        error = _mm_add_ps(error, _mm_mul_ps(d, d));
+                    }
+                    __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+                    bestError = _mm_min_ps(error, bestError);
+                    bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+                }
+
+                int32_t index[4];
+                float error[4];
+                _mm_storeu_si128((__m128i*)index, bestIndex);
+                _mm_storeu_ps(error, bestError);
+                for(uint32_t i = 0; i < 4; i++)
+                {
+                    indices[group * 4 + i] = (uint8_t)index[i];
+                    totalError += error[i];
+                }
+            }
+            return totalError;
+        }
+
+        /** Fit a line through the texels. The endpoints are the extreme projections on the principal axis
+        */
+        static void fitPrincipalAxis(const BlockTexels& texels, uint32_t channelCount, float e0[4], float e1[4])
+        {
+            float mean[4] = { 0, 0, 0, 0 };
+            for(uint32_t c = 0; c < channelCount; c++)
+            {
+                for(uint32_t i = 0; i < 16; i++)
+                {
+                    mean[c] += texels[c][i];
+                }
+                mean[c] /= 16.0f;
+            }
+
+            float cov[4][4] = {};
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                for(uint32_t a = 0; a < channelCount; a++)
+                {
+                    for(uint32_t b = 0; b < channelCount; b++)
+                    {
+                        cov[a][b] += (texels[a][i] - mean[a]) * (texels[b][i] - mean[b]);
+                    }
+                }
+            }
+
+            // Power iteration, starting from the channel with the largest variance
+            float axis[4] = { 0, 0, 0, 0 };
+            uint32_t maxChannel = 0;
+            for(uint32_t c = 1; c < channelCount; c++)
+            {
+                maxChannel = (cov[c][c] > cov[maxChannel][maxChannel]) ? c : maxChannel;
+            }
+            axis[maxChannel] = 1;
+
+            for(uint32_t iteration = 0; iteration < 8; iteration++)
+            {
+                float next[4] = { 0, 0, 0, 0 };
+                float length = 0;
+                for(uint32_t a = 0; a < channelCount; a++)
+                {
+                    for(uint32_t b = 0; b < channelCount; b++)
+                    {
+                        next[a] += cov[a][b] * axis[b];
+                    }
+                    length += next[a] * next[a];
+                }
+                if(length < 1e-12f)
+                {
+                    break;
+                }
+                length = 1.0f / sqrtf(length);
+                for(uint32_t c = 0; c < channelCount; c++)
+                {
+                    axis[c] = next[c] * length;
+                }
+            }
+
+            float minT = FLT_MAX;
+            float maxT = -FLT_MAX;
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                float t = 0;
+                for(uint32_t c = 0; c < channelCount; c++)
+                {
+                    t += (texels[c][i] - mean[c]) * axis[c];
+                }
+                minT = min(minT, t);
+                maxT = max(maxT, t);
+            }
+
+            for(uint32_t c = 0; c < channelCount; c++)
+            {
+                e0[c] = clamp(mean[c] + minT * axis[c], 0.0f, 255.0f);
+                e1[c] = clamp(mean[c] + maxT * axis[c], 0.0f, 255.0f);
+            }
+        }
+
+        /** Least-squares endpoints for a fixed index assignment
+            \param[in] weights Interpolation weight of e1 for each index
+            \return false if the system is singular (all texels use the same weight)
+        */
+        static bool solveEndpoints(const BlockTexels& texels, uint32_t channelCount, const uint8_t indices[16], const float* weights, float e0[4], float e1[4])
+        {
+            float alpha2 = 0, beta2 = 0, alphaBeta = 0;
+            float alphaX[4] = { 0, 0, 0, 0 };
+            float betaX[4] = { 0, 0, 0, 0 };
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                float beta = weights[indices[i]];
+                float alpha = 1.0f - beta;
+                alpha2 += alpha * alpha;
+                beta2 += beta * beta;
+                alphaBeta += alpha * beta;
+                for(uint32_t c = 0; c < channelCount; c++)
+                {
+                    alphaX[c] += alpha * texels[c][i];
+                    betaX[c] += beta * texels[c][i];
+                }
+            }
+
+            float det = alpha2 * beta2 - alphaBeta * alphaBeta;
+            if(fabsf(det) < 1e-6f)
+            {
+                return false;
+            }
+
+            float invDet = 1.0f / det;
+            for(uint32_t c = 0; c < channelCount; c++)
+            {
+                e0[c] = clamp((alphaX[c] * beta2 - betaX[c] * alphaBeta) * invDet, 0.0f, 255.0f);
+                e1[c] = clamp((betaX[c] * alpha2 - alphaX[c] * alphaBeta) * invDet, 0.0f, 255.0f);
+            }
+            return true;
+        }
+
+        static void writeBits(uint8_t* pBlock, uint32_t& bitPos, uint32_t value, uint32_t bitCount)
+        {
+            for(uint32_t i = 0; i < bitCount; i++, bitPos++)
+            {
+                pBlock[bitPos >> 3] |= (uint8_t)(((value >> i) & 1) << (bitPos & 7));
+            }
+        }
+
+        static uint32_t readBits(const uint8_t* pBlock, uint32_t& bitPos, uint32_t bitCount)
+        {
+            uint32_t value = 0;
+            for(uint32_t i = 0; i < bitCount; i++, bitPos++)
+            {
+                value |= ((pBlock[bitPos >> 3] >> (bitPos & 7)) & 1) << i;
+            }
+            return value;
+        }
+
+        // BC1
+        static uint16_t packColor565(const float c[4])
+        {
+            uint32_t r = (uint32_t)clamp(c[0] * (31.0f / 255.0f) + 0.5f, 0.0f, 31.0f);
+            uint32_t g = (uint32_t)clamp(c[1] * (63.0f / 255.0f) + 0.5f, 0.0f, 63.0f);
+            uint32_t b = (uint32_t)clamp(c[2] * (31.0f / 255.0f) + 0.5f, 0.0f, 31.0f);
+            return (uint16_t)((r << 11) | (g << 5) | b);
+        }
+
+        static void unpackColor565(uint16_t v, uint32_t c[3])
+        {
+            uint32_t r = (v >> 11) & 0x1F;
+            uint32_t g = (v >> 5) & 0x3F;
+            uint32_t b = v & 0x1F;
+            c[0] = (r << 3) | (r >> 2);
+            c[1] = (g << 2) | (g >> 4);
+            c[2] = (b << 3) | (b >> 2);
+        }
+
+        static void getBC1Palette(uint16_t c0, uint16_t c1, bool forceFourColors, uint32_t palette[4][4])
+        {
+            unpackColor565(c0, palette[0]);
+            unpackColor565(c1, palette[1]);
+            palette[0][3] = palette[1][3] = 255;
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                if(c0 > c1 || forceFourColors)
+                {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+                else
+                {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                    palette[3][c] = 0;
+                }
+            }
+            palette[2][3] = 255;
+            palette[3][3] = (c0 > c1 || forceFourColors) ? 255 : 0;
+        }
+
+        static float tryBC1Endpoints(const BlockTexels& texels, const float e0[4], const float e1[4], uint16_t& c0, uint16_t& c1, uint8_t indices[16])
+        {
+            c0 = packColor565(e0);
+            c1 = packColor565(e1);
+            // Four-color mode requires c0 > c1
+            if(c0 < c1)
+            {
+                std::swap(c0, c1);
+            }
+
+            uint32_t intPalette[4][4];
+            getBC1Palette(c0, c1, true, intPalette);
+            float palette[4][4];
+            for(uint32_t p = 0; p < 4; p++)
+            {
+                for(uint32_t c = 0; c < 4; c++)
+                {
+                    palette[p][c] = (float)intPalette[p][c];
+                }
+            }
+            // Equal endpoints decode in three-color mode, where only index 0 is safe
+            return selectIndices(texels, 3, palette, (c0 == c1) ? 1 : 4, indices);
+        }
+
+        static void encodeBC1(const BlockTexels& texels, uint8_t* pBlock)
+        {
+            static const float kWeights[4] = { 0, 1, 1.0f / 3.0f, 2.0f / 3.0f };
+
+            float e0[4], e1[4];
+            fitPrincipalAxis(texels, 3, e0, e1);
+
+            uint16_t c0, c1;
+            uint8_t indices[16];
+            float error = tryBC1Endpoints(texels, e0, e1, c0, c1, indices);
+
+            // Refine the endpoints for the chosen indices
+            for(uint32_t iteration = 0; iteration < 2 && c0 != c1; iteration++)
+            {
+                if(solveEndpoints(texels, 3, indices, kWeights, e0, e1) == false)
+                {
+                    break;
+                }
+                uint16_t newC0, newC1;
+                uint8_t newIndices[16];
+                float newError = tryBC1Endpoints(texels, e0, e1, newC0, newC1, newIndices);
+                if(newError >= error)
+                {
+                    break;
+                }
+                error = newError;
+                c0 = newC0;
+                c1 = newC1;
+                memcpy(indices, newIndices, sizeof(indices));
+            }
+
+            uint32_t indexBits = 0;
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                indexBits |= (uint32_t)indices[i] << (i * 2);
+            }
+            memcpy(pBlock, &c0, 2);
+            memcpy(pBlock + 2, &c1, 2);
+            memcpy(pBlock + 4, &indexBits, 4);
+        }
+
+        static void decodeBC1(const uint8_t* pBlock, bool forceFourColors, uint8_t* pTexels)
+        {
+            uint16_t c0, c1;
+            uint32_t indexBits;
+            memcpy(&c0, pBlock, 2);
+            memcpy(&c1, pBlock + 2, 2);
+            memcpy(&indexBits, pBlock + 4, 4);
+
+            uint32_t palette[4][4];
+            getBC1Palette(c0, c1, forceFourColors, palette);
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                uint32_t index = (indexBits >> (i * 2)) & 3;
+                for(uint32_t c = 0; c < 4; c++)
+                {
+                    pTexels[i * 4 + c] = (uint8_t)palette[index][c];
+                }
+            }
+        }
+
+        // BC4
+        static void getBC4Palette(uint32_t e0, uint32_t e1, uint32_t palette[8])
+        {
+            palette[0] = e0;
+            palette[1] = e1;
+            if(e0 > e1)
+            {
+                for(uint32_t i = 2; i < 8; i++)
+                {
+                    palette[i] = ((8 - i) * e0 + (i - 1) * e1 + 3) / 7;
+                }
+            }
+            else
+            {
+                for(uint32_t i = 2; i < 6; i++)
+                {
+                    palette[i] = ((6 - i) * e0 + (i - 1) * e1 + 2) / 5;
+                }
+                palette[6] = 0;
+                palette[7] = 255;
+            }
+        }
+
+        static void encodeBC4(const BlockTexels& texels, uint32_t channel, uint8_t* pBlock)
+        {
+            float minValue = 255.0f;
+            float maxValue = 0;
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                minValue = min(minValue, texels[channel][i]);
+                maxValue = max(maxValue, texels[channel][i]);
+            }
+
+            // Eight-value mode requires e0 > e1
+            uint32_t e0 = (uint32_t)(maxValue + 0.5f);
+            uint32_t e1 = (uint32_t)(minValue + 0.5f);
+            uint8_t indices[16] = {};
+            if(e0 != e1)
+            {
+                uint32_t intPalette[8];
+                getBC4Palette(e0, e1, intPalette);
+                float palette[8][4];
+                for(uint32_t i = 0; i < 8; i++)
+                {
+                    palette[i][0] = (float)intPalette[i];
+                }
+                selectIndices(&texels[channel], 1, palette, 8, indices);
+            }
+
+            memset(pBlock, 0, 8);
+            pBlock[0] = (uint8_t)e0;
+            pBlock[1] = (uint8_t)e1;
+            uint32_t bitPos = 16;
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                writeBits(pBlock, bitPos, indices[i], 3);
+            }
+        }
+
+        static void decodeBC4(const uint8_t* pBlock, uint32_t channel, uint8_t* pTexels)
+        {
+            uint32_t palette[8];
+            getBC4Palette(pBlock[0], pBlock[1], palette);
+            uint32_t bitPos = 16;
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                pTexels[i * 4 + channel] = (uint8_t)palette[readBits(pBlock, bitPos, 3)];
+            }
+        }
+
+        // BC7 mode 6: one RGBA subset, 7-bit endpoints with a unique p-bit each, 4-bit indices
+        struct BC7Mode6
+        {
+            uint32_t q0[4];
+            uint32_t q1[4];
+            uint32_t p0;
+            uint32_t p1;
+            uint8_t indices[16];
+        };
+
+        static void getBC7Palette(const uint32_t q0[4], const uint32_t q1[4], uint32_t p0, uint32_t p1, float palette[16][4])
+        {
+            for(uint32_t c = 0; c < 4; c++)
+            {
+                uint32_t e0 = (q0[c] << 1) | p0;
+                uint32_t e1 = (q1[c] << 1) | p1;
+                for(uint32_t i = 0; i < 16; i++)
+                {
+                    palette[i][c] = (float)(((64 - kBC7Weights[i]) * e0 + kBC7Weights[i] * e1 + 32) >> 6);
+                }
+            }
+        }
+
+        static float tryBC7Endpoints(const BlockTexels& texels, const float e0[4], const float e1[4], BC7Mode6& mode)
+        {
+            float bestError = FLT_MAX;
+            BC7Mode6 candidate;
+            for(uint32_t p0 = 0; p0 < 2; p0++)
+            {
+                for(uint32_t p1 = 0; p1 < 2; p1++)
+                {
+                    candidate.p0 = p0;
+                    candidate.p1 = p1;
+                    for(uint32_t c = 0; c < 4; c++)
+                    {
+                        candidate.q0[c] = (uint32_t)clamp((e0[c] - (float)p0) * 0.5f + 0.5f, 0.0f, 127.0f);
+                        candidate.q1[c] = (uint32_t)clamp((e1[c] - (float)p1) * 0.5f + 0.5f, 0.0f, 127.0f);
+                    }
+
+                    float palette[16][4];
+                    getBC7Palette(candidate.q0, candidate.q1, p0, p1, palette);
+                    float error = selectIndices(texels, 4, palette, 16, candidate.indices);
+                    if(error < bestError)
+                    {
+                        bestError = error;
+                        mode = candidate;
+                    }
+                }
+            }
+            return bestError;
+        }
+
+        static void encodeBC7(const BlockTexels& texels, uint8_t* pBlock)
+        {
+            float weights[16];
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                weights[i] = (float)kBC7Weights[i] / 64.0f;
+            }
+
+            float e0[4], e1[4];
+            fitPrincipalAxis(texels, 4, e0, e1);
+            BC7Mode6 mode;
+            float error = tryBC7Endpoints(texels, e0, e1, mode);
+
+            for(uint32_t iteration = 0; iteration < 2; iteration++)
+            {
+                if(solveEndpoints(texels, 4, mode.indices, weights, e0, e1) == false)
+                {
+                    break;
+                }
+                BC7Mode6 refined;
+                float newError = tryBC7Endpoints(texels, e0, e1, refined);
+                if(newError >= error)
+                {
+                    break;
+                }
+                error = newError;
+                mode = refined;
+            }
+
+            // The MSB of the first index is implicit, so it must be 0
+            if(mode.indices[0] & 0x8)
+            {
+                for(uint32_t c = 0; c < 4; c++)
+                {
+                    std::swap(mode.q0[c], mode.q1[c]);
+                }
+                std::swap(mode.p0, mode.p1);
+                for(uint32_t i = 0; i < 16; i++)
+                {
+                    mode.indices[i] = 15 - mode.indices[i];
+                }
+            }
+
+            memset(pBlock, 0, 16);
+            uint32_t bitPos = 0;
+            writeBits(pBlock, bitPos, 1 << 6, 7);
+            for(uint32_t c = 0; c < 4; c++)
+            {
+                writeBits(pBlock, bitPos, mode.q0[c], 7);
+                writeBits(pBlock, bitPos, mode.q1[c], 7);
+            }
+            writeBits(pBlock, bitPos, mode.p0, 1);
+            writeBits(pBlock, bitPos, mode.p1, 1);
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                writeBits(pBlock, bitPos, mode.indices[i], (i == 0) ? 3 : 4);
+            }
+        }
+
+        static bool decodeBC7(const uint8_t* pBlock, uint8_t* pTexels)
+        {
+            if((pBlock[0] & 0x7F) != 0x40)
+            {
+                return false;
+            }
+
+            BC7Mode6 mode;
+            uint32_t bitPos = 7;
+            for(uint32_t c = 0; c < 4; c++)
+            {
+                mode.q0[c] = readBits(pBlock, bitPos, 7);
+                mode.q1[c] = readBits(pBlock, bitPos, 7);
+            }
+            mode.p0 = readBits(pBlock, bitPos, 1);
+            mode.p1 = readBits(pBlock, bitPos, 1);
+
+            float palette[16][4];
+            getBC7Palette(mode.q0, mode.q1, mode.p0, mode.p1, palette);
+            for(uint32_t i = 0; i < 16; i++)
+            {
+                uint32_t index = readBits(pBlock, bitPos, (i == 0) ? 3 : 4);
+                for(uint32_t c = 0; c < 4; c++)
+                {
+                    pTexels[i * 4 + c] = (uint8_t)palette[index][c];
+                }
+            }
+            return true;
+        }
+
+        bool isFormatSupported(ResourceFormat format)
+        {
+            switch(format)
+            {
+            case ResourceFormat::BC1Unorm:
+            case ResourceFormat::BC1UnormSrgb:
+            case ResourceFormat::BC3Unorm:
+            case ResourceFormat::BC3UnormSrgb:
+            case ResourceFormat::BC4Unorm:
+            case ResourceFormat::BC5Unorm:
+            case ResourceFormat::BC7Unorm:
+            case ResourceFormat::BC7UnormSrgb:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        void compressBlock(ResourceFormat format, const uint8_t* pTexels, uint8_t* pBlock)
+        {
+            BlockTexels texels;
+            loadTexels(pTexels, texels);
+
+            switch(srgbToLinearFormat(format))
+            {
+            case ResourceFormat::BC1Unorm:
+                encodeBC1(texels, pBlock);
+                break;
+            case ResourceFormat::BC3Unorm:
+                encodeBC4(texels, 3, pBlock);
+                encodeBC1(texels, pBlock + 8);
+                break;
+            case ResourceFormat::BC4Unorm:
+                encodeBC4(texels, 0, pBlock);
+                break;
+            case ResourceFormat::BC5Unorm:
+                encodeBC4(texels, 0, pBlock);
+                encodeBC4(texels, 1, pBlock + 8);
+                break;
+            case ResourceFormat::BC7Unorm:
+                encodeBC7(texels, pBlock);
+                break;
+            default:
+                should_not_get_here();
+            }
+        }
+
+        bool decompressBlock(ResourceFormat format, const uint8_t* pBlock, uint8_t* pTexels)
+        {
+            switch(srgbToLinearFormat(format))
+            {
+            case ResourceFormat::BC1Unorm:
+                decodeBC1(pBlock, false, pTexels);
+                return true;
+            case ResourceFormat::BC3Unorm:
+                decodeBC1(pBlock + 8, true, pTexels);
+                decodeBC4(pBlock, 3, pTexels);
+                return true;
+            case ResourceFormat::BC4Unorm:
+            case ResourceFormat::BC5Unorm:
+                for(uint32_t i = 0; i < 16; i++)
+                {
+                    pTexels[i * 4 + 1] = pTexels[i * 4 + 2] = 0;
+                    pTexels[i * 4 + 3] = 255;
+                }
+                decodeBC4(pBlock, 0, pTexels);
+                if(srgbToLinearFormat(format) == ResourceFormat::BC5Unorm)
+                {
+                    decodeBC4(pBlock + 8, 1, pTexels);
+                }
+                return true;
+            case ResourceFormat::BC7Unorm:
+                return decodeBC7(pBlock, pTexels);
+            default:
+                return false;
+            }
+        }
+
+        void compressImage(ResourceFormat format, const uint8_t* pTexels, uint32_t width, uint32_t height, uint8_t* pOut)
+        {
+            const uint32_t blocksX = (width + 3) / 4;
+            const uint32_t blocksY = (height + 3) / 4;
+            const uint32_t blockSize = getFormatBytesPerBlock(format);
+
+            ThreadPool::instance()->parallelFor(blocksY, 1, [&](uint32_t begin, uint32_t end)
+            {
+                uint8_t block[64];
+                for(uint32_t by = begin; by < end; by++)
+                {
+                    for(uint32_t bx = 0; bx < blocksX; bx++)
+                    {
+                        for(uint32_t i = 0; i < 16; i++)
+                        {
+                            uint32_t x = min(bx * 4 + (i & 3), width - 1);
+                            uint32_t y = min(by * 4 + (i >> 2), height - 1);
+                            memcpy(&block[i * 4], &pTexels[(y * width + x) * 4], 4);
+                        }
+                        compressBlock(format, block, pOut + (by * blocksX + bx) * blockSize);
+                    }
+                }
+            });
+        }
+
+        bool decompressImage(ResourceFormat format, const uint8_t* pBlocks, uint32_t width, uint32_t height, uint8_t* pTexels)
+        {
+            const uint32_t blocksX = (width + 3) / 4;
+            const uint32_t blocksY = (height + 3) / 4;
+            const uint32_t blockSize = getFormatBytesPerBlock(format);
+
+            uint8_t block[64];
+            for(uint32_t by = 0; by < blocksY; by++)
+            {
+                for(uint32_t bx = 0; bx < blocksX; bx++)
+                {
+                    if(decompressBlock(format, pBlocks + (by * blocksX + bx) * blockSize, block) == false)
+                    {
+                        return false;
+                    }
+                    for(uint32_t i = 0; i < 16; i++)
+                    {
+                        uint32_t x = bx * 4 + (i & 3);
+                        uint32_t y = by * 4 + (i >> 2);
+                        if(x < width && y < height)
+                        {
+                            memcpy(&pTexels[(y * width + x) * 4], &block[i * 4], 4);
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+    }
+}
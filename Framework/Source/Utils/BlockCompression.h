@@ -0,0 +1,71 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "API/Formats.h"
+
+namespace Falcor
+{
+    /** CPU encoders and decoders for block-compressed formats.
+        The encoders are meant for offline baking. BC1 and BC3 colors use a principal-axis fit refined with least squares, BC4/BC5 use a min/max fit, and BC7 uses mode 6 only (a single RGBA subset with 4-bit indices). Index selection uses SSE, 4 texels at a time.
+        sRGB formats are accepted and produce the same bits as their linear counterparts; the filtering space is decided when the texture is sampled.
+    */
+    namespace BlockCompression
+    {
+        /** Check if a format can be encoded
+        */
+        bool isFormatSupported(ResourceFormat format);
+
+        /** Compress a 4x4 block
+            \param[in] format BC1, BC3, BC4, BC5 or BC7
+            \param[in] pTexels 16 RGBA8 texels, row-major. BC4 reads the red channel, BC5 reads red and green.
+            \param[out] pBlock The compressed block, getFormatBytesPerBlock(format) bytes
+        */
+        void compressBlock(ResourceFormat format, const uint8_t* pTexels, uint8_t* pBlock);
+
+        /** Decompress a 4x4 block. BC7 blocks must use mode 6, which is the only mode the encoder produces.
+            \param[out] pTexels 16 RGBA8 texels, row-major. Missing channels are set to 0, missing alpha is set to 255.
+            \return false if the block can't be decoded
+        */
+        bool decompressBlock(ResourceFormat format, const uint8_t* pBlock, uint8_t* pTexels);
+
+        /** Compress an image. Blocks are encoded in parallel on the global ThreadPool.
+            \param[in] format The destination format
+            \param[in] pTexels RGBA8 texels, row-major, tightly packed
+            \param[in] width The image width. Doesn't need to be a multiple of 4, edge blocks replicate the last row and column.
+            \param[in] height The image height
+            \param[out] pOut The compressed blocks. Must be large enough to hold ceil(width/4)*ceil(height/4) blocks.
+        */
+        void compressImage(ResourceFormat format, const uint8_t* pTexels, uint32_t width, uint32_t height, uint8_t* pOut);
+
+        /** Decompress an image produced by compressImage()
+            \param[out] pTexels RGBA8 texels, width * height * 4 bytes
+            \return false if a block can't be decoded
+        */
+        bool decompressImage(ResourceFormat format, const uint8_t* pBlocks, uint32_t width, uint32_t height, uint8_t* pTexels);
+    }
+}
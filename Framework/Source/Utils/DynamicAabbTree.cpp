@@ -0,0 +1,752 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Utils/DynamicAabbTree.h"
+#include "Utils/ThreadPool.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Depth-first traversal stack. A traversal never holds more than one node per level plus one, so the stack lives on the thread's stack unless the tree is unusually deep.
+        */
+        template<typename T>
+        class TraversalStack
+        {
+        public:
+            TraversalStack(uint32_t treeHeight)
+            {
+                if (treeHeight + 2 > kInlineSize)
+                {
+                    mHeap.resize(treeHeight + 2);
+                    mpData = mHeap.data();
+                }
+            }
+
+            void push(const T& value) { mpData[mSize++] = value; }
+            T pop() { return mpData[--mSize]; }
+            bool empty() const { return mSize == 0; }
+
+        private:
+            static const uint32_t kInlineSize = 64;
+            T mInline[kInlineSize];
+            std::vector<T> mHeap;
+            T* mpData = mInline;
+            uint32_t mSize = 0;
+        };
+
+        float surfaceArea(const glm::vec3& boxMin, const glm::vec3& boxMax)
+        {
+            glm::vec3 d = boxMax - boxMin;
+            return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+        }
+
+        float unionArea(const glm::vec3& min0, const glm::vec3& max0, const glm::vec3& min1, const glm::vec3& max1)
+        {
+            return surfaceArea(glm::min(min0, min1), glm::max(max0, max1));
+        }
+
+        bool overlaps(const glm::vec3& min0, const glm::vec3& max0, const glm::vec3& min1, const glm::vec3& max1)
+        {
+            return (min0.x <= max1.x) && (min1.x <= max0.x) && (min0.y <= max1.y) && (min1.y <= max0.y) && (min0.z <= max1.z) && (min1.z <= max0.z);
+        }
+
+        bool contains(const glm::vec3& outerMin, const glm::vec3& outerMax, const glm::vec3& innerMin, const glm::vec3& innerMax)
+        {
+            return (outerMin.x <= innerMin.x) && (outerMin.y <= innerMin.y) && (outerMin.z <= innerMin.z) && (innerMax.x <= outerMax.x) && (innerMax.y <= outerMax.y) && (innerMax.z <= outerMax.z);
+        }
+
+        float distanceSquared(const glm::vec3& p, const glm::vec3& boxMin, const glm::vec3& boxMax)
+        {
+            glm::vec3 d = glm::max(glm::max(boxMin - p, p - boxMax), glm::vec3(0));
+            return glm::dot(d, d);
+        }
+
+        /** Slab test. Returns the entry distance, or FLT_MAX if the ray misses the box.
+        */
+        float intersectBox(const glm::vec3& origin, const glm::vec3& invDir, float maxDistance, const glm::vec3& boxMin, const glm::vec3& boxMax)
+        {
+            glm::vec3 t0 = (boxMin - origin) * invDir;
+            glm::vec3 t1 = (boxMax - origin) * invDir;
+            glm::vec3 tNear = glm::min(t0, t1);
+            glm::vec3 tFar = glm::max(t0, t1);
+            float tEnter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+            float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+            return (tEnter <= tExit) ? tEnter : FLT_MAX;
+        }
+
+        /** Classify a box against a plane. Returns -1 if the box is outside, 1 if it's inside and 0 if it straddles the plane.
+        */
+        int classifyBox(const glm::vec4& plane, const glm::vec3& boxMin, const glm::vec3& boxMax)
+        {
+            glm::vec3 n(plane);
+            glm::vec3 center = (boxMin + boxMax) * 0.5f;
+            glm::vec3 extent = (boxMax - boxMin) * 0.5f;
+            float d = glm::dot(n, center) + plane.w;
+            float r = glm::dot(glm::abs(n), extent);
+            if (d + r < 0)
+            {
+                return -1;
+            }
+            return (d - r >= 0) ? 1 : 0;
+        }
+    }
+
+    DynamicAabbTree::Query DynamicAabbTree::Query::box(const BoundingBox& box)
+    {
+        Query q;
+        q.type = Type::Box;
+        q.v0 = box.getMinPos();
+        q.v1 = box.getMaxPos();
+        return q;
+    }
+
+    DynamicAabbTree::Query DynamicAabbTree::Query::sphere(const glm::vec3& center, float radius)
+    {
+        Query q;
+        q.type = Type::Sphere;
+        q.v0 = center;
+        q.distance = radius;
+        return q;
+    }
+
+    DynamicAabbTree::Query DynamicAabbTree::Query::frustum(const glm::mat4& viewProjMat)
+    {
+        // See: https://fgiesen.wordpress.com/2012/08/31/frustum-planes-from-the-projection-matrix/
+        // With a [0, 1] depth range the near plane is the third row alone
+        Query q;
+        q.type = Type::Frustum;
+        glm::mat4 rows = glm::transpose(viewProjMat);
+        q.planes[0] = rows[3] + rows[0];
+        q.planes[1] = rows[3] - rows[0];
+        q.planes[2] = rows[3] + rows[1];
+        q.planes[3] = rows[3] - rows[1];
+        q.planes[4] = rows[2];
+        q.planes[5] = rows[3] - rows[2];
+
+        // The bounds of the frustum's corners reject the nodes the plane tests can't, such as large nodes next to the frustum's edges
+        glm::mat4 invViewProj = glm::inverse(viewProjMat);
+        q.v0 = glm::vec3(FLT_MAX);
+        q.v1 = glm::vec3(-FLT_MAX);
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            glm::vec4 corner = invViewProj * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : 0.0f, 1.0f);
+            glm::vec3 p = glm::vec3(corner) / corner.w;
+            q.v0 = glm::min(q.v0, p);
+            q.v1 = glm::max(q.v1, p);
+        }
+        glm::vec3 padding = (q.v1 - q.v0) * 1.0e-5f;
+        q.v0 -= padding;
+        q.v1 += padding;
+
+        // Infinite far planes don't have corners
+        if (glm::all(glm::lessThan(glm::abs(q.v0), glm::vec3(FLT_MAX))) == false || glm::all(glm::lessThan(glm::abs(q.v1), glm::vec3(FLT_MAX))) == false)
+        {
+            q.v0 = glm::vec3(-FLT_MAX);
+            q.v1 = glm::vec3(FLT_MAX);
+        }
+        return q;
+    }
+
+    DynamicAabbTree::Query DynamicAabbTree::Query::ray(const glm::vec3& origin, const glm::vec3& direction, float maxDistance)
+    {
+        Query q;
+        q.type = Type::Ray;
+        q.v0 = origin;
+        q.v1 = direction;
+        q.distance = maxDistance;
+        return q;
+    }
+
+    DynamicAabbTree::Query DynamicAabbTree::Query::nearest(const glm::vec3& point, float maxDistance)
+    {
+        Query q;
+        q.type = Type::Nearest;
+        q.v0 = point;
+        q.distance = maxDistance;
+        return q;
+    }
+
+    DynamicAabbTree::SharedPtr DynamicAabbTree::create(float margin)
+    {
+        return SharedPtr(new DynamicAabbTree(std::max(margin, 0.0f)));
+    }
+
+    uint32_t DynamicAabbTree::allocateNode()
+    {
+        uint32_t nodeID;
+        if (mFreeList != kInvalidProxy)
+        {
+            nodeID = mFreeList;
+            mFreeList = mNodes[nodeID].parent;
+        }
+        else
+        {
+            nodeID = (uint32_t)mNodes.size();
+            mNodes.emplace_back();
+        }
+
+        Node& node = mNodes[nodeID];
+        node.parent = kInvalidProxy;
+        node.child0 = kInvalidProxy;
+        node.child1 = kInvalidProxy;
+        node.height = 0;
+        return nodeID;
+    }
+
+    void DynamicAabbTree::freeNode(uint32_t nodeID)
+    {
+        mNodes[nodeID].parent = mFreeList;
+        mNodes[nodeID].height = -1;
+        mFreeList = nodeID;
+    }
+
+    void DynamicAabbTree::setFatBox(Node& leaf) const
+    {
+        glm::vec3 size = leaf.boxMax - leaf.boxMin;
+        glm::vec3 margin(mMargin * std::max(std::max(size.x, size.y), size.z));
+        leaf.fatMin = leaf.boxMin - margin;
+        leaf.fatMax = leaf.boxMax + margin;
+    }
+
+    uint32_t DynamicAabbTree::createProxy(const BoundingBox& box, uint32_t userData)
+    {
+        uint32_t leafID = allocateNode();
+        Node& leaf = mNodes[leafID];
+        leaf.boxMin = box.getMinPos();
+        leaf.boxMax = box.getMaxPos();
+        leaf.child1 = userData;
+        setFatBox(leaf);
+        insertLeaf(leafID);
+        mProxyCount++;
+        return leafID;
+    }
+
+    void DynamicAabbTree::destroyProxy(uint32_t proxyID)
+    {
+        assert(proxyID < mNodes.size() && mNodes[proxyID].isLeaf() && mNodes[proxyID].height == 0);
+        removeLeaf(proxyID);
+        freeNode(proxyID);
+        mProxyCount--;
+    }
+
+    bool DynamicAabbTree::moveProxy(uint32_t proxyID, const BoundingBox& box)
+    {
+        assert(proxyID < mNodes.size() && mNodes[proxyID].isLeaf() && mNodes[proxyID].height == 0);
+        Node& leaf = mNodes[proxyID];
+        leaf.boxMin = box.getMinPos();
+        leaf.boxMax = box.getMaxPos();
+        if (contains(leaf.fatMin, leaf.fatMax, leaf.boxMin, leaf.boxMax))
+        {
+            return false;
+        }
+
+        removeLeaf(proxyID);
+        setFatBox(mNodes[proxyID]);
+        insertLeaf(proxyID);
+        return true;
+    }
+
+    void DynamicAabbTree::clear()
+    {
+        mNodes.clear();
+        mRoot = kInvalidProxy;
+        mFreeList = kInvalidProxy;
+        mProxyCount = 0;
+    }
+
+    void DynamicAabbTree::refit(uint32_t nodeID)
+    {
+        Node& node = mNodes[nodeID];
+        const Node& c0 = mNodes[node.child0];
+        const Node& c1 = mNodes[node.child1];
+        node.fatMin = glm::min(c0.fatMin, c1.fatMin);
+        node.fatMax = glm::max(c0.fatMax, c1.fatMax);
+        node.height = 1 + std::max(c0.height, c1.height);
+    }
+
+    void DynamicAabbTree::insertLeaf(uint32_t leafID)
+    {
+        if (mRoot == kInvalidProxy)
+        {
+            mRoot = leafID;
+            mNodes[leafID].parent = kInvalidProxy;
+            return;
+        }
+
+        // Walk down to the sibling with the lowest cost. Creating a parent for a node costs the parent's area, and every ancestor grows by the area the leaf adds to it.
+        const glm::vec3 leafMin = mNodes[leafID].fatMin;
+        const glm::vec3 leafMax = mNodes[leafID].fatMax;
+        uint32_t index = mRoot;
+        while (mNodes[index].isLeaf() == false)
+        {
+            const Node& node = mNodes[index];
+            float area = surfaceArea(node.fatMin, node.fatMax);
+            float combinedArea = unionArea(node.fatMin, node.fatMax, leafMin, leafMax);
+            float cost = 2.0f * combinedArea;
+            float inheritanceCost = 2.0f * (combinedArea - area);
+
+            auto descendCost = [&](uint32_t childID)
+            {
+                const Node& child = mNodes[childID];
+                float childCost = unionArea(child.fatMin, child.fatMax, leafMin, leafMax);
+                if (child.isLeaf() == false)
+                {
+                    childCost -= surfaceArea(child.fatMin, child.fatMax);
+                }
+                return childCost + inheritanceCost;
+            };
+            float cost0 = descendCost(node.child0);
+            float cost1 = descendCost(node.child1);
+
+            if (cost < cost0 && cost < cost1)
+            {
+                break;
+            }
+            index = (cost0 < cost1) ? node.child0 : node.child1;
+        }
+
+        // Replace the sibling with a new parent of the sibling and the leaf
+        uint32_t siblingID = index;
+        uint32_t oldParentID = mNodes[siblingID].parent;
+        uint32_t newParentID = allocateNode();
+        Node& newParent = mNodes[newParentID];
+        newParent.parent = oldParentID;
+        newParent.child0 = siblingID;
+        newParent.child1 = leafID;
+        newParent.fatMin = glm::min(leafMin, mNodes[siblingID].fatMin);
+        newParent.fatMax = glm::max(leafMax, mNodes[siblingID].fatMax);
+        newParent.height = mNodes[siblingID].height + 1;
+        mNodes[siblingID].parent = newParentID;
+        mNodes[leafID].parent = newParentID;
+
+        if (oldParentID == kInvalidProxy)
+        {
+            mRoot = newParentID;
+        }
+        else if (mNodes[oldParentID].child0 == siblingID)
+        {
+            mNodes[oldParentID].child0 = newParentID;
+        }
+        else
+        {
+            mNodes[oldParentID].child1 = newParentID;
+        }
+
+        // Fix the ancestors
+        index = mNodes[leafID].parent;
+        while (index != kInvalidProxy)
+        {
+            index = balance(index);
+            refit(index);
+            index = mNodes[index].parent;
+        }
+    }
+
+    void DynamicAabbTree::removeLeaf(uint32_t leafID)
+    {
+        if (leafID == mRoot)
+        {
+            mRoot = kInvalidProxy;
+            return;
+        }
+
+        uint32_t parentID = mNodes[leafID].parent;
+        uint32_t grandParentID = mNodes[parentID].parent;
+        uint32_t siblingID = (mNodes[parentID].child0 == leafID) ? mNodes[parentID].child1 : mNodes[parentID].child0;
+
+        // The sibling takes the parent's place
+        mNodes[siblingID].parent = grandParentID;
+        freeNode(parentID);
+        if (grandParentID == kInvalidProxy)
+        {
+            mRoot = siblingID;
+            return;
+        }
+
+        Node& grandParent = mNodes[grandParentID];
+        if (grandParent.child0 == parentID)
+        {
+            grandParent.child0 = siblingID;
+        }
+        else
+        {
+            grandParent.child1 = siblingID;
+        }
+
+        uint32_t index = grandParentID;
+        while (index != kInvalidProxy)
+        {
+            index = balance(index);
+            refit(index);
+            index = mNodes[index].parent;
+        }
+    }
+
+    uint32_t DynamicAabbTree::balance(uint32_t nodeID)
+    {
+        // If one child of A is more than one level taller than the other, rotate that child (B or C) up.
+        // Its taller child stays attached to it, the shorter one moves under A.
+        Node& a = mNodes[nodeID];
+        if (a.isLeaf() || a.height < 2)
+        {
+            return nodeID;
+        }
+
+        int32_t diff = mNodes[a.child1].height - mNodes[a.child0].height;
+        if (diff >= -1 && diff <= 1)
+        {
+            return nodeID;
+        }
+
+        // 'up' is the taller child and 'other' the shorter one
+        const bool rotateChild1 = diff > 1;
+        uint32_t upID = rotateChild1 ? a.child1 : a.child0;
+        Node& up = mNodes[upID];
+        uint32_t tallID = up.child0;
+        uint32_t shortID = up.child1;
+        if (mNodes[tallID].height < mNodes[shortID].height)
+        {
+            std::swap(tallID, shortID);
+        }
+
+        // 'up' replaces A under A's parent
+        up.parent = a.parent;
+        a.parent = upID;
+        if (up.parent == kInvalidProxy)
+        {
+            mRoot = upID;
+        }
+        else if (mNodes[up.parent].child0 == nodeID)
+        {
+            mNodes[up.parent].child0 = upID;
+        }
+        else
+        {
+            mNodes[up.parent].child1 = upID;
+        }
+
+        // A adopts the shorter grandchild in place of 'up', and becomes a child of 'up'
+        if (rotateChild1)
+        {
+            a.child1 = shortID;
+        }
+        else
+        {
+            a.child0 = shortID;
+        }
+        mNodes[shortID].parent = nodeID;
+        up.child0 = nodeID;
+        up.child1 = tallID;
+
+        refit(nodeID);
+        refit(upID);
+        return upID;
+    }
+
+    uint32_t DynamicAabbTree::query(const Query& query, std::vector<Hit>& hits) const
+    {
+        size_t first = hits.size();
+        if (mRoot != kInvalidProxy)
+        {
+            switch (query.type)
+            {
+            case Query::Type::Box:
+                queryBox(query, hits);
+                break;
+            case Query::Type::Sphere:
+                querySphere(query, hits);
+                break;
+            case Query::Type::Frustum:
+                queryFrustum(query, hits);
+                break;
+            case Query::Type::Ray:
+                queryRay(query, hits);
+                break;
+            case Query::Type::Nearest:
+                queryNearest(query, hits);
+                break;
+            default:
+                should_not_get_here();
+            }
+        }
+        return (uint32_t)(hits.size() - first);
+    }
+
+    void DynamicAabbTree::queryBatch(const std::vector<Query>& queries, std::vector<std::vector<Hit>>& hits) const
+    {
+        hits.resize(queries.size());
+        ThreadPool::instance()->parallelFor((uint32_t)queries.size(), 0, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                hits[i].clear();
+                query(queries[i], hits[i]);
+            }
+        });
+    }
+
+    void DynamicAabbTree::queryBox(const Query& query, std::vector<Hit>& hits) const
+    {
+        TraversalStack<uint32_t> stack(getHeight());
+        stack.push(mRoot);
+        while (stack.empty() == false)
+        {
+            const Node& node = mNodes[stack.pop()];
+            if (overlaps(node.fatMin, node.fatMax, query.v0, query.v1) == false)
+            {
+                continue;
+            }
+
+            if (node.isLeaf())
+            {
+                if (overlaps(node.boxMin, node.boxMax, query.v0, query.v1))
+                {
+                    hits.push_back({ (uint32_t)(&node - mNodes.data()), node.child1, 0.0f });
+                }
+            }
+            else
+            {
+                stack.push(node.child0);
+                stack.push(node.child1);
+            }
+        }
+    }
+
+    void DynamicAabbTree::querySphere(const Query& query, std::vector<Hit>& hits) const
+    {
+        const float radiusSquared = query.distance * query.distance;
+        TraversalStack<uint32_t> stack(getHeight());
+        stack.push(mRoot);
+        while (stack.empty() == false)
+        {
+            const Node& node = mNodes[stack.pop()];
+            if (distanceSquared(query.v0, node.fatMin, node.fatMax) > radiusSquared)
+            {
+                continue;
+            }
+
+            if (node.isLeaf())
+            {
+                if (distanceSquared(query.v0, node.boxMin, node.boxMax) <= radiusSquared)
+                {
+                    hits.push_back({ (uint32_t)(&node - mNodes.data()), node.child1, 0.0f });
+                }
+            }
+            else
+            {
+                stack.push(node.child0);
+                stack.push(node.child1);
+            }
+        }
+    }
+
+    void DynamicAabbTree::queryFrustum(const Query& query, std::vector<Hit>& hits) const
+    {
+        // Each stack entry carries a mask of the planes its node is known to be fully inside of, so those planes aren't tested again further down
+        const uint32_t kAllPlanes = (1 << 6) - 1;
+        struct Entry
+        {
+            uint32_t nodeID;
+            uint32_t insideMask;
+        };
+        TraversalStack<Entry> stack(getHeight());
+        stack.push({ mRoot, 0 });
+        while (stack.empty() == false)
+        {
+            Entry entry = stack.pop();
+            const Node& node = mNodes[entry.nodeID];
+            const bool isLeaf = node.isLeaf();
+            const glm::vec3& boxMin = isLeaf ? node.boxMin : node.fatMin;
+            const glm::vec3& boxMax = isLeaf ? node.boxMax : node.fatMax;
+
+            bool outside = (entry.insideMask != kAllPlanes) && (overlaps(boxMin, boxMax, query.v0, query.v1) == false);
+            for (uint32_t p = 0; p < 6 && entry.insideMask != kAllPlanes && outside == false; p++)
+            {
+                if ((entry.insideMask & (1 << p)) == 0)
+                {
+                    int c = classifyBox(query.planes[p], boxMin, boxMax);
+                    if (c < 0)
+                    {
+                        outside = true;
+                        break;
+                    }
+                    entry.insideMask |= (c > 0) ? (1 << p) : 0;
+                }
+            }
+
+            if (outside)
+            {
+                continue;
+            }
+
+            if (isLeaf)
+            {
+                hits.push_back({ entry.nodeID, node.child1, 0.0f });
+            }
+            else
+            {
+                // Only the fat box is known to be inside, the children's leaves still need testing
+                stack.push({ node.child0, entry.insideMask });
+                stack.push({ node.child1, entry.insideMask });
+            }
+        }
+    }
+
+    void DynamicAabbTree::queryRay(const Query& query, std::vector<Hit>& hits) const
+    {
+        const size_t first = hits.size();
+        const glm::vec3 invDir = 1.0f / query.v1;
+        TraversalStack<uint32_t> stack(getHeight());
+        stack.push(mRoot);
+        while (stack.empty() == false)
+        {
+            const Node& node = mNodes[stack.pop()];
+            if (intersectBox(query.v0, invDir, query.distance, node.fatMin, node.fatMax) == FLT_MAX)
+            {
+                continue;
+            }
+
+            if (node.isLeaf())
+            {
+                float t = intersectBox(query.v0, invDir, query.distance, node.boxMin, node.boxMax);
+                if (t != FLT_MAX)
+                {
+                    hits.push_back({ (uint32_t)(&node - mNodes.data()), node.child1, t });
+                }
+            }
+            else
+            {
+                stack.push(node.child0);
+                stack.push(node.child1);
+            }
+        }
+
+        std::sort(hits.begin() + first, hits.end(), [](const Hit& a, const Hit& b) { return a.distance < b.distance; });
+    }
+
+    void DynamicAabbTree::queryNearest(const Query& query, std::vector<Hit>& hits) const
+    {
+        float bestDistSquared = (query.distance == FLT_MAX) ? FLT_MAX : query.distance * query.distance;
+        uint32_t bestID = kInvalidProxy;
+
+        struct Entry
+        {
+            uint32_t nodeID;
+            float distSquared;
+        };
+        TraversalStack<Entry> stack(getHeight());
+        stack.push({ mRoot, distanceSquared(query.v0, mNodes[mRoot].fatMin, mNodes[mRoot].fatMax) });
+        while (stack.empty() == false)
+        {
+            Entry entry = stack.pop();
+            if (entry.distSquared > bestDistSquared)
+            {
+                continue;
+            }
+
+            const Node& node = mNodes[entry.nodeID];
+            if (node.isLeaf())
+            {
+                float d = distanceSquared(query.v0, node.boxMin, node.boxMax);
+                if (d <= bestDistSquared)
+                {
+                    bestDistSquared = d;
+                    bestID = entry.nodeID;
+                }
+            }
+            else
+            {
+                // Visit the closer child first, it's the more likely to shrink the search radius
+                Entry e0 = { node.child0, distanceSquared(query.v0, mNodes[node.child0].fatMin, mNodes[node.child0].fatMax) };
+                Entry e1 = { node.child1, distanceSquared(query.v0, mNodes[node.child1].fatMin, mNodes[node.child1].fatMax) };
+                if (e0.distSquared < e1.distSquared)
+                {
+                    std::swap(e0, e1);
+                }
+                stack.push(e0);
+                stack.push(e1);
+            }
+        }
+
+        if (bestID != kInvalidProxy)
+        {
+            hits.push_back({ bestID, mNodes[bestID].child1, sqrtf(bestDistSquared) });
+        }
+    }
+
+    bool DynamicAabbTree::validate() const
+    {
+        if (mRoot == kInvalidProxy)
+        {
+            return mProxyCount == 0;
+        }
+        if (mNodes[mRoot].parent != kInvalidProxy)
+        {
+            return false;
+        }
+
+        uint32_t leafCount = 0;
+        std::vector<uint32_t> stack = { mRoot };
+        while (stack.empty() == false)
+        {
+            uint32_t nodeID = stack.back();
+            stack.pop_back();
+            const Node& node = mNodes[nodeID];
+
+            if (node.isLeaf())
+            {
+                if (node.height != 0 || contains(node.fatMin, node.fatMax, node.boxMin, node.boxMax) == false)
+                {
+                    return false;
+                }
+                leafCount++;
+                continue;
+            }
+
+            const Node& c0 = mNodes[node.child0];
+            const Node& c1 = mNodes[node.child1];
+            if (c0.parent != nodeID || c1.parent != nodeID)
+            {
+                return false;
+            }
+            if (node.height != 1 + std::max(c0.height, c1.height))
+            {
+                return false;
+            }
+            if (node.fatMin != glm::min(c0.fatMin, c1.fatMin) || node.fatMax != glm::max(c0.fatMax, c1.fatMax))
+            {
+                return false;
+            }
+            stack.push_back(node.child0);
+            stack.push_back(node.child1);
+        }
+        return leafCount == mProxyCount;
+    }
+}
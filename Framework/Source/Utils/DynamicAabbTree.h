@@ -0,0 +1,187 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <vector>
+#include <cfloat>
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+#include "glm/mat4x4.hpp"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    /** A bounding-volume tree over a dynamic set of boxes, used for spatial queries on the CPU.
+        Every box is stored in a leaf (a proxy) together with a slightly enlarged 'fat' box. Moving a proxy inside its fat box only updates the leaf, otherwise the leaf is reinserted. Insertion picks the sibling with the lowest surface-area cost and the tree is kept height-balanced with rotations, so the depth stays logarithmic in the number of proxies.
+        Queries don't modify the tree, so any number of threads can query it concurrently as long as no proxy is created, moved or destroyed at the same time.
+    */
+    class DynamicAabbTree
+    {
+    public:
+        using SharedPtr = std::shared_ptr<DynamicAabbTree>;
+        using SharedConstPtr = std::shared_ptr<const DynamicAabbTree>;
+
+        static const uint32_t kInvalidProxy = (uint32_t)-1;
+
+        /** A spatial query. Use the static functions to create one.
+        */
+        struct Query
+        {
+            enum class Type
+            {
+                Box,            ///< All proxies overlapping a box
+                Sphere,         ///< All proxies overlapping a sphere
+                Frustum,        ///< All proxies overlapping a frustum
+                Ray,            ///< All proxies hit by a ray, sorted by distance
+                Nearest,        ///< The proxy closest to a point
+            };
+
+            Type type = Type::Box;
+            glm::vec3 v0;               ///< Box minimum, sphere center, ray origin or point. Frustum bounds minimum.
+            glm::vec3 v1;               ///< Box maximum or ray direction. Frustum bounds maximum.
+            float distance = 0;         ///< Sphere radius, or maximum distance of rays and nearest-proxy queries
+            glm::vec4 planes[6];        ///< Frustum planes. Points inside the frustum have a non-negative distance to all planes.
+
+            static Query box(const BoundingBox& box);
+            static Query sphere(const glm::vec3& center, float radius);
+
+            /** Create a frustum query from a view-projection matrix with a [0, 1] depth range
+            */
+            static Query frustum(const glm::mat4& viewProjMat);
+
+            /** Create a ray query. The direction doesn't need to be normalized, distances are in units of its length.
+            */
+            static Query ray(const glm::vec3& origin, const glm::vec3& direction, float maxDistance = FLT_MAX);
+            static Query nearest(const glm::vec3& point, float maxDistance = FLT_MAX);
+        };
+
+        /** A proxy found by a query
+        */
+        struct Hit
+        {
+            uint32_t proxyID;
+            uint32_t userData;
+            float distance;             ///< Ray queries: distance to the entry point. Nearest-proxy queries: distance to the box. Otherwise 0.
+        };
+
+        /** Create an empty tree
+            \param[in] margin The fat boxes are enlarged by this fraction of the box's largest dimension on every side. Larger margins make moves cheaper and queries slower.
+        */
+        static SharedPtr create(float margin = 0.1f);
+
+        /** Add a box to the tree
+            \param[in] box The box
+            \param[in] userData Value returned with the proxy's query hits
+            \return The proxy ID. IDs of destroyed proxies are reused.
+        */
+        uint32_t createProxy(const BoundingBox& box, uint32_t userData);
+
+        /** Remove a box from the tree
+        */
+        void destroyProxy(uint32_t proxyID);
+
+        /** Update the box of a proxy
+            \return true if the proxy left its fat box and was reinserted
+        */
+        bool moveProxy(uint32_t proxyID, const BoundingBox& box);
+
+        /** Remove all the proxies
+        */
+        void clear();
+
+        uint32_t getUserData(uint32_t proxyID) const { return mNodes[proxyID].child1; }
+        BoundingBox getBoundingBox(uint32_t proxyID) const { return BoundingBox::fromMinMax(mNodes[proxyID].boxMin, mNodes[proxyID].boxMax); }
+        BoundingBox getFatBoundingBox(uint32_t proxyID) const { return BoundingBox::fromMinMax(mNodes[proxyID].fatMin, mNodes[proxyID].fatMax); }
+
+        uint32_t getProxyCount() const { return mProxyCount; }
+
+        /** Get the height of the tree. A tree with a single proxy has a height of 0.
+        */
+        uint32_t getHeight() const { return (mRoot == kInvalidProxy) ? 0 : (uint32_t)mNodes[mRoot].height; }
+
+        /** Get the memory used by the nodes, in bytes
+        */
+        size_t getMemorySize() const { return mNodes.capacity() * sizeof(Node); }
+
+        /** Run a query
+            \param[in] query The query
+            \param[out] hits The hits are appended to this vector
+            \return The number of hits
+        */
+        uint32_t query(const Query& query, std::vector<Hit>& hits) const;
+
+        /** Run a batch of queries on the global thread pool
+            \param[in] queries The queries
+            \param[out] hits Receives the hits of each query. Resized to the number of queries.
+        */
+        void queryBatch(const std::vector<Query>& queries, std::vector<std::vector<Hit>>& hits) const;
+
+        /** Check the tree's structure, bounds and heights. Slow, meant for debugging and tests.
+        */
+        bool validate() const;
+
+    private:
+        DynamicAabbTree(float margin) : mMargin(margin) {}
+
+        /** Tree node, 64 bytes. Leaves store the proxy's user data in child1 and have child0 set to kInvalidProxy. Free nodes store the next free node in parent and have a negative height.
+        */
+        struct Node
+        {
+            glm::vec3 fatMin;
+            uint32_t parent;
+            glm::vec3 fatMax;
+            uint32_t child0;
+            glm::vec3 boxMin;
+            uint32_t child1;
+            glm::vec3 boxMax;
+            int32_t height;
+
+            bool isLeaf() const { return child0 == kInvalidProxy; }
+        };
+
+        uint32_t allocateNode();
+        void freeNode(uint32_t nodeID);
+        void insertLeaf(uint32_t leafID);
+        void removeLeaf(uint32_t leafID);
+        uint32_t balance(uint32_t nodeID);
+        void refit(uint32_t nodeID);
+        void setFatBox(Node& leaf) const;
+
+        void queryBox(const Query& query, std::vector<Hit>& hits) const;
+        void querySphere(const Query& query, std::vector<Hit>& hits) const;
+        void queryFrustum(const Query& query, std::vector<Hit>& hits) const;
+        void queryRay(const Query& query, std::vector<Hit>& hits) const;
+        void queryNearest(const Query& query, std::vector<Hit>& hits) const;
+
+        std::vector<Node> mNodes;
+        uint32_t mRoot = kInvalidProxy;
+        uint32_t mFreeList = kInvalidProxy;
+        uint32_t mProxyCount = 0;
+        float mMargin;
+    };
+}
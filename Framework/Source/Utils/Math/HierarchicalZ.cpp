@@ -0,0 +1,89 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "HierarchicalZ.h"
+#include "Graphics/FboHelper.h"
+#include "API/RenderContext.h"
+
+namespace Falcor
+{
+    static const char* kReductionShader = "Framework/Shaders/ParallelReduction.fs";
+
+    HierarchicalZ::UniquePtr HierarchicalZ::create(uint32_t width, uint32_t height)
+    {
+        return UniquePtr(new HierarchicalZ(width, height));
+    }
+
+    HierarchicalZ::HierarchicalZ(uint32_t width, uint32_t height) : mDepthWidth(width), mDepthHeight(height)
+    {
+        Program::DefineList defines;
+        defines.add("_MAX_REDUCTION");
+        mpReductionPass = FullScreenPass::create(kReductionShader, defines);
+        mpVars = GraphicsVars::create(mpReductionPass->getProgram()->getActiveVersion()->getReflector());
+
+        // Halve the size until the level is 1x1. Rounding up makes the clamped 2x2 blocks cover every texel.
+        do
+        {
+            width = (width + 1) / 2;
+            height = (height + 1) / 2;
+
+            Fbo::Desc fboDesc;
+            fboDesc.setColorTarget(0, ResourceFormat::R32Float);
+            mpLevelFbo.push_back(FboHelper::create2D(width, height, fboDesc));
+        } while ((width > 1) || (height > 1));
+
+        const Texture* pLevel0 = mpLevelFbo[0]->getColorTexture(0).get();
+        mpHzbTexture = Texture::create2D(pLevel0->getWidth(), pLevel0->getHeight(), ResourceFormat::R32Float, 1, (uint32_t)mpLevelFbo.size(), nullptr, Resource::BindFlags::ShaderResource);
+    }
+
+    void HierarchicalZ::build(RenderContext* pRenderCtx, const Texture::SharedPtr& pDepth)
+    {
+        if ((pDepth->getWidth() != mDepthWidth) || (pDepth->getHeight() != mDepthHeight) || (pDepth->getSampleCount() > 1))
+        {
+            logError("HierarchicalZ::build() - the depth texture must be single-sampled and have the size the builder was created with");
+            return;
+        }
+
+        GraphicsState::SharedPtr pState = pRenderCtx->getGraphicsState();
+        pRenderCtx->pushGraphicsVars(mpVars);
+
+        const Texture* pInput = pDepth.get();
+        for (uint32_t level = 0; level < (uint32_t)mpLevelFbo.size(); level++)
+        {
+            mpVars->setSrv(0, pInput->getSRV(0, 1));
+            pState->pushFbo(mpLevelFbo[level]);
+            mpReductionPass->execute(pRenderCtx);
+            pState->popFbo();
+
+            pInput = mpLevelFbo[level]->getColorTexture(0).get();
+            pRenderCtx->copySubresource(mpHzbTexture.get(), mpHzbTexture->getSubresourceIndex(0, level), pInput, 0);
+        }
+
+        pRenderCtx->popGraphicsVars();
+    }
+}
@@ -0,0 +1,74 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Framework.h"
+#include "Graphics/FullScreenPass.h"
+#include "API/ProgramVars.h"
+#include "API/FBO.h"
+
+namespace Falcor
+{
+    class RenderContext;
+    class Texture;
+
+    /** Builds a hierarchical-Z pyramid from a depth buffer, with the reduction shader of ParallelReduction.
+        Level 0 is half the resolution of the depth buffer, rounded up, and every texel holds the farthest depth of the 2x2 texels below it. The pyramid is an R32Float texture with a mip-level per pyramid level.
+        HzbReference builds the same pyramid on the CPU.
+    */
+    class HierarchicalZ
+    {
+    public:
+        using UniquePtr = std::unique_ptr<HierarchicalZ>;
+
+        /** Create a builder for depth buffers of a given size
+        */
+        static UniquePtr create(uint32_t width, uint32_t height);
+
+        /** Build the pyramid
+            \param[in] pDepth A single-sampled depth texture, or an R32Float texture, with the size passed to create()
+        */
+        void build(RenderContext* pRenderCtx, const Texture::SharedPtr& pDepth);
+
+        /** Get the pyramid
+        */
+        const Texture::SharedPtr& getTexture() const { return mpHzbTexture; }
+
+        uint32_t getLevelCount() const { return (uint32_t)mpLevelFbo.size(); }
+        uint32_t getDepthWidth() const { return mDepthWidth; }
+        uint32_t getDepthHeight() const { return mDepthHeight; }
+
+    private:
+        HierarchicalZ(uint32_t width, uint32_t height);
+        FullScreenPass::UniquePtr mpReductionPass;
+        GraphicsVars::SharedPtr mpVars;
+        std::vector<Fbo::SharedPtr> mpLevelFbo;     ///< One render target per level. The levels are copied into mpHzbTexture, since a level can't be rendered while the previous one is read from the same texture.
+        Texture::SharedPtr mpHzbTexture;
+        uint32_t mDepthWidth;
+        uint32_t mDepthHeight;
+    };
+}
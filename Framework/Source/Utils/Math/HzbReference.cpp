@@ -0,0 +1,156 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "HzbReference.h"
+#include "Utils/ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+
+namespace Falcor
+{
+    namespace
+    {
+        const float kDepthBias = 1.0e-6f;    // Same as in 'HzbCulling.cs.hlsl'
+
+        /** Farthest depth of the 2x2 block of texels at (2x, 2y), clamped to the edge of the source
+        */
+        float reduceBlock(const float* pSrc, uint32_t width, uint32_t height, uint32_t x, uint32_t y)
+        {
+            uint32_t x0 = std::min(x * 2, width - 1);
+            uint32_t x1 = std::min(x * 2 + 1, width - 1);
+            uint32_t y0 = std::min(y * 2, height - 1);
+            uint32_t y1 = std::min(y * 2 + 1, height - 1);
+            return std::max(std::max(pSrc[y0 * width + x0], pSrc[y0 * width + x1]), std::max(pSrc[y1 * width + x0], pSrc[y1 * width + x1]));
+        }
+    }
+
+    uint32_t HzbReference::calculateLevelCount(uint32_t width, uint32_t height)
+    {
+        uint32_t count = 1;
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        while ((width > 1) || (height > 1))
+        {
+            width = (width + 1) / 2;
+            height = (height + 1) / 2;
+            count++;
+        }
+        return count;
+    }
+
+    void HzbReference::build(const float* pDepth, uint32_t width, uint32_t height)
+    {
+        mDepthWidth = width;
+        mDepthHeight = height;
+        mLevels.resize(calculateLevelCount(width, height));
+
+        const float* pSrc = pDepth;
+        uint32_t srcWidth = width;
+        uint32_t srcHeight = height;
+        for (auto& level : mLevels)
+        {
+            level.width = (srcWidth + 1) / 2;
+            level.height = (srcHeight + 1) / 2;
+            level.depth.resize(level.width * level.height);
+            for (uint32_t y = 0; y < level.height; y++)
+            {
+                for (uint32_t x = 0; x < level.width; x++)
+                {
+                    level.depth[y * level.width + x] = reduceBlock(pSrc, srcWidth, srcHeight, x, y);
+                }
+            }
+            pSrc = level.depth.data();
+            srcWidth = level.width;
+            srcHeight = level.height;
+        }
+    }
+
+    bool HzbReference::isVisible(const BoundingBox& box, const glm::mat4& viewProjMat) const
+    {
+        if (mLevels.empty())
+        {
+            return true;
+        }
+
+        const glm::vec3 boxMin = box.getMinPos();
+        const glm::vec3 boxMax = box.getMaxPos();
+        glm::vec2 minXY(FLT_MAX);
+        glm::vec2 maxXY(-FLT_MAX);
+        float minZ = FLT_MAX;
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            glm::vec3 corner((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+            glm::vec4 clip = viewProjMat * glm::vec4(corner, 1.0f);
+            if ((clip.w <= 1.0e-6f) || (clip.z < 0))
+            {
+                return true;
+            }
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            minXY = glm::min(minXY, glm::vec2(ndc));
+            maxXY = glm::max(maxXY, glm::vec2(ndc));
+            minZ = std::min(minZ, ndc.z);
+        }
+
+        // Boxes outside of the screen are left to frustum culling
+        if ((maxXY.x < -1) || (maxXY.y < -1) || (minXY.x > 1) || (minXY.y > 1))
+        {
+            return true;
+        }
+
+        // Depth pixels covered by the box. Texture rows go down, NDC y goes up.
+        glm::vec2 uv0 = glm::clamp(glm::vec2(minXY.x, -maxXY.y) * 0.5f + 0.5f, 0.0f, 1.0f);
+        glm::vec2 uv1 = glm::clamp(glm::vec2(maxXY.x, -minXY.y) * 0.5f + 0.5f, 0.0f, 1.0f);
+        const glm::uvec2 size(mDepthWidth, mDepthHeight);
+        glm::uvec2 p0 = glm::min(glm::uvec2(uv0 * glm::vec2(size)), size - 1u);
+        glm::uvec2 p1 = glm::min(glm::uvec2(uv1 * glm::vec2(size)), size - 1u);
+
+        // The finest level where the pixels fit in 2x2 texels. Pixel p is in texel p >> (level + 1).
+        uint32_t level = 0;
+        while ((level + 1 < (uint32_t)mLevels.size()) && ((((p1.x >> (level + 1)) - (p0.x >> (level + 1))) > 1) || (((p1.y >> (level + 1)) - (p0.y >> (level + 1))) > 1)))
+        {
+            level++;
+        }
+
+        glm::uvec2 t0(p0.x >> (level + 1), p0.y >> (level + 1));
+        glm::uvec2 t1(p1.x >> (level + 1), p1.y >> (level + 1));
+        float maxDepth = std::max(std::max(getDepth(level, t0.x, t0.y), getDepth(level, t1.x, t0.y)), std::max(getDepth(level, t0.x, t1.y), getDepth(level, t1.x, t1.y)));
+        return minZ - kDepthBias <= maxDepth;
+    }
+
+    void HzbReference::testVisibility(const std::vector<BoundingBox>& boxes, const glm::mat4& viewProjMat, std::vector<uint32_t>& visible) const
+    {
+        visible.resize(boxes.size());
+        ThreadPool::instance()->parallelFor((uint32_t)boxes.size(), 0, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                visible[i] = isVisible(boxes[i], viewProjMat) ? 1 : 0;
+            }
+        });
+    }
+}
@@ -0,0 +1,90 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    /** CPU reference of the hierarchical-Z pyramid built by HierarchicalZ and of the box test done by HzbCulling.
+        Level 0 is half the resolution of the depth buffer, rounded up, and every level holds the farthest depth of the 2x2 texels below it. Texels past the edge of odd-sized levels are clamped, so every depth sample is covered.
+        The box test projects the box, picks the finest level where the box's screen rectangle covers at most 2x2 texels, and reports the box hidden if its nearest depth is behind the farthest depth of these texels.
+        Both follow 'HzbCulling.cs.hlsl' operation by operation, so the results match the GPU up to floating-point rounding.
+    */
+    class HzbReference
+    {
+    public:
+        /** Build the pyramid
+            \param[in] pDepth Depth buffer, in the [0, 1] range with 1 at the far plane. Row 0 is the top of the screen.
+            \param[in] width Width of the depth buffer
+            \param[in] height Height of the depth buffer
+        */
+        void build(const float* pDepth, uint32_t width, uint32_t height);
+
+        /** Test if a box might be visible
+            \param[in] box World-space box
+            \param[in] viewProjMat The view-projection matrix the depth buffer was rendered with
+            \return false if the box is hidden. Boxes crossing the near plane or outside of the screen are visible.
+        */
+        bool isVisible(const BoundingBox& box, const glm::mat4& viewProjMat) const;
+
+        /** Test a batch of boxes on the global thread pool
+            \param[out] visible Receives 1 for boxes which might be visible and 0 for hidden ones, like the visibility buffer of HzbCulling. Resized to the number of boxes.
+        */
+        void testVisibility(const std::vector<BoundingBox>& boxes, const glm::mat4& viewProjMat, std::vector<uint32_t>& visible) const;
+
+        uint32_t getLevelCount() const { return (uint32_t)mLevels.size(); }
+        uint32_t getLevelWidth(uint32_t level) const { return mLevels[level].width; }
+        uint32_t getLevelHeight(uint32_t level) const { return mLevels[level].height; }
+
+        /** Get the farthest depth of a texel
+        */
+        float getDepth(uint32_t level, uint32_t x, uint32_t y) const { return mLevels[level].depth[y * mLevels[level].width + x]; }
+
+        /** Get the texels of a level, in rows
+        */
+        const std::vector<float>& getLevel(uint32_t level) const { return mLevels[level].depth; }
+
+        /** Get the number of levels of the pyramid of a depth buffer. The last level is 1x1.
+        */
+        static uint32_t calculateLevelCount(uint32_t width, uint32_t height);
+
+    private:
+        struct Level
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            std::vector<float> depth;
+        };
+
+        uint32_t mDepthWidth = 0;
+        uint32_t mDepthHeight = 0;
+        std::vector<Level> mLevels;
+    };
+}
@@ -0,0 +1,420 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Utils/OcclusionBuffer.h"
+#include "Utils/Picking/Bvh.h"
+#include "Utils/CpuTimer.h"
+#include "Utils/ThreadPool.h"
+#include <algorithm>
+#include <emmintrin.h>
+#include <cfloat>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Triangles are clipped against the near plane and a guard band around the screen, which keeps the edge functions' precision when vertices project far off-screen
+        const float kGuardBand = 4.0f;
+        const uint32_t kClipPlaneCount = 5;
+        const glm::vec4 kClipPlanes[kClipPlaneCount] =
+        {
+            glm::vec4(0, 0, 1, 0),                  // z >= 0
+            glm::vec4(-1, 0, 0, kGuardBand),        // x <= guard * w
+            glm::vec4(1, 0, 0, kGuardBand),         // x >= -guard * w
+            glm::vec4(0, -1, 0, kGuardBand),        // y <= guard * w
+            glm::vec4(0, 1, 0, kGuardBand),         // y >= -guard * w
+        };
+
+        /** Bit mask of the frustum planes a clip-space vertex is outside of
+        */
+        uint32_t getOutCode(const glm::vec4& v)
+        {
+            return ((v.x < -v.w) ? 1 : 0) | ((v.x > v.w) ? 2 : 0) | ((v.y < -v.w) ? 4 : 0) | ((v.y > v.w) ? 8 : 0) | ((v.z < 0) ? 16 : 0) | ((v.z > v.w) ? 32 : 0);
+        }
+
+        uint32_t getClipCode(const glm::vec4& v)
+        {
+            uint32_t code = 0;
+            for (uint32_t p = 0; p < kClipPlaneCount; p++)
+            {
+                code |= (glm::dot(kClipPlanes[p], v) < 0) ? (1 << p) : 0;
+            }
+            return code;
+        }
+    }
+
+    OcclusionBuffer::SharedPtr OcclusionBuffer::create(uint32_t width, uint32_t height)
+    {
+        return SharedPtr(new OcclusionBuffer(width, height));
+    }
+
+    OcclusionBuffer::OcclusionBuffer(uint32_t width, uint32_t height)
+    {
+        mTileCountX = std::max(1u, (width + kTileWidth - 1) / kTileWidth);
+        mTileCountY = std::max(1u, (height + kTileHeight - 1) / kTileHeight);
+        mWidth = mTileCountX * kTileWidth;
+        mHeight = mTileCountY * kTileHeight;
+        mDepth.resize(mWidth * mHeight, 1.0f);
+        mTileMaxDepth.resize(mTileCountX * mTileCountY, 1.0f);
+        mBins.resize(mTileCountX * mTileCountY);
+    }
+
+    void OcclusionBuffer::clear(const glm::mat4& viewProjMat)
+    {
+        mViewProjMat = viewProjMat;
+        std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+        std::fill(mTileMaxDepth.begin(), mTileMaxDepth.end(), 1.0f);
+        mTriangles.clear();
+        for (auto& bin : mBins)
+        {
+            bin.clear();
+        }
+        mStats = Stats();
+    }
+
+    void OcclusionBuffer::addOccluder(const glm::mat4& worldMat, const glm::vec3* pPositions, const uint32_t* pIndices, uint32_t count)
+    {
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        const glm::mat4 worldViewProj = mViewProjMat * worldMat;
+        const uint32_t triangleCount = count / 3;
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            glm::vec4 v[3];
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                uint32_t index = pIndices ? pIndices[t * 3 + i] : t * 3 + i;
+                v[i] = worldViewProj * glm::vec4(pPositions[index], 1.0f);
+            }
+            addClipTriangle(v);
+        }
+
+        mStats.occluderCount++;
+        mStats.triangleCount += triangleCount;
+        mStats.setupTime += (float)CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+    }
+
+    void OcclusionBuffer::addOccluder(const glm::mat4& worldMat, const TriangleBvh* pBvh)
+    {
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        const glm::mat4 worldViewProj = mViewProjMat * worldMat;
+        const uint32_t triangleCount = pBvh->getTriangleCount();
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            glm::vec3 p[3];
+            pBvh->getTriangle(t, p[0], p[1], p[2]);
+            glm::vec4 v[3] = { worldViewProj * glm::vec4(p[0], 1.0f), worldViewProj * glm::vec4(p[1], 1.0f), worldViewProj * glm::vec4(p[2], 1.0f) };
+            addClipTriangle(v);
+        }
+
+        mStats.occluderCount++;
+        mStats.triangleCount += triangleCount;
+        mStats.setupTime += (float)CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+    }
+
+    void OcclusionBuffer::addClipTriangle(const glm::vec4 v[3])
+    {
+        // Reject triangles which are fully outside one of the frustum planes
+        if (getOutCode(v[0]) & getOutCode(v[1]) & getOutCode(v[2]))
+        {
+            return;
+        }
+
+        if ((getClipCode(v[0]) | getClipCode(v[1]) | getClipCode(v[2])) == 0)
+        {
+            setupTriangle(v[0], v[1], v[2]);
+            return;
+        }
+
+        // Sutherland-Hodgman. Each plane adds at most one vertex.
+        glm::vec4 polygon[2][3 + kClipPlaneCount];
+        uint32_t vertexCount = 3;
+        std::copy(v, v + 3, polygon[0]);
+        uint32_t src = 0;
+        for (uint32_t p = 0; p < kClipPlaneCount && vertexCount >= 3; p++)
+        {
+            const glm::vec4& plane = kClipPlanes[p];
+            uint32_t dstCount = 0;
+            for (uint32_t i = 0; i < vertexCount; i++)
+            {
+                const glm::vec4& a = polygon[src][i];
+                const glm::vec4& b = polygon[src][(i + 1) % vertexCount];
+                float da = glm::dot(plane, a);
+                float db = glm::dot(plane, b);
+                if (da >= 0)
+                {
+                    polygon[1 - src][dstCount++] = a;
+                }
+                if ((da >= 0) != (db >= 0))
+                {
+                    polygon[1 - src][dstCount++] = a + (b - a) * (da / (da - db));
+                }
+            }
+            vertexCount = dstCount;
+            src = 1 - src;
+        }
+
+        for (uint32_t i = 1; i + 1 < vertexCount; i++)
+        {
+            setupTriangle(polygon[src][0], polygon[src][i], polygon[src][i + 1]);
+        }
+    }
+
+    void OcclusionBuffer::setupTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2)
+    {
+        const glm::vec4* v[3] = { &v0, &v1, &v2 };
+        float x[3], y[3], z[3];
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            if (v[i]->w <= 1.0e-6f)
+            {
+                return;
+            }
+            float invW = 1.0f / v[i]->w;
+            x[i] = (v[i]->x * invW * 0.5f + 0.5f) * (float)mWidth;
+            y[i] = (0.5f - v[i]->y * invW * 0.5f) * (float)mHeight;
+            z[i] = v[i]->z * invW;
+        }
+
+        // Make the winding consistent, occluders are two-sided
+        float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (std::abs(area) < 1.0e-8f)
+        {
+            return;
+        }
+        if (area < 0)
+        {
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+            std::swap(z[1], z[2]);
+            area = -area;
+        }
+
+        Triangle tri;
+        tri.minX = std::max(0, (int32_t)std::floor(std::min(std::min(x[0], x[1]), x[2])));
+        tri.maxX = std::min((int32_t)mWidth - 1, (int32_t)std::ceil(std::max(std::max(x[0], x[1]), x[2])));
+        tri.minY = std::max(0, (int32_t)std::floor(std::min(std::min(y[0], y[1]), y[2])));
+        tri.maxY = std::min((int32_t)mHeight - 1, (int32_t)std::ceil(std::max(std::max(y[0], y[1]), y[2])));
+        if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+        {
+            return;
+        }
+
+        // Edge i goes from vertex i to vertex i+1 and is positive on the side of the third vertex. Functions are evaluated at pixel centers, so the half-pixel offset is folded into the constant.
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            uint32_t j = (i + 1) % 3;
+            float a = y[i] - y[j];
+            float b = x[j] - x[i];
+            tri.edgeA[i] = a;
+            tri.edgeB[i] = b;
+            tri.edgeC[i] = -(a * x[i] + b * y[i]) + 0.5f * (a + b);
+        }
+
+        float invArea = 1.0f / area;
+        tri.depthA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) * invArea;
+        tri.depthB = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) * invArea;
+        tri.depthC = z[0] - tri.depthA * x[0] - tri.depthB * y[0] + 0.5f * (tri.depthA + tri.depthB);
+
+        uint32_t triangleID = (uint32_t)mTriangles.size();
+        mTriangles.push_back(tri);
+        mStats.rasterizedTriangleCount++;
+
+        for (int32_t ty = tri.minY / kTileHeight; ty <= tri.maxY / (int32_t)kTileHeight; ty++)
+        {
+            for (int32_t tx = tri.minX / kTileWidth; tx <= tri.maxX / (int32_t)kTileWidth; tx++)
+            {
+                mBins[ty * mTileCountX + tx].push_back(triangleID);
+            }
+        }
+    }
+
+    void OcclusionBuffer::rasterize()
+    {
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        ThreadPool::instance()->parallelFor(mTileCountX * mTileCountY, 1, [this](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t tileID = begin; tileID < end; tileID++)
+            {
+                rasterizeTile(tileID);
+            }
+        });
+        mStats.rasterTime += (float)CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+    }
+
+    void OcclusionBuffer::rasterizeTile(uint32_t tileID)
+    {
+        const int32_t tileX0 = (tileID % mTileCountX) * kTileWidth;
+        const int32_t tileY0 = (tileID / mTileCountX) * kTileHeight;
+        const int32_t tileX1 = tileX0 + kTileWidth - 1;
+        const int32_t tileY1 = tileY0 + kTileHeight - 1;
+        const __m128 laneOffsets = _mm_setr_ps(0, 1, 2, 3);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (uint32_t triangleID : mBins[tileID])
+        {
+            const Triangle& tri = mTriangles[triangleID];
+
+            // Process 4 pixels at a time. Tiles are a multiple of 4 pixels wide, so the groups never cross a tile.
+            const int32_t x0 = std::max(tri.minX, tileX0) & ~3;
+            const int32_t x1 = std::min(tri.maxX, tileX1);
+            const int32_t y0 = std::max(tri.minY, tileY0);
+            const int32_t y1 = std::min(tri.maxY, tileY1);
+
+            const __m128 a0 = _mm_set1_ps(tri.edgeA[0]);
+            const __m128 a1 = _mm_set1_ps(tri.edgeA[1]);
+            const __m128 a2 = _mm_set1_ps(tri.edgeA[2]);
+            const __m128 depthA = _mm_set1_ps(tri.depthA);
+
+            for (int32_t y = y0; y <= y1; y++)
+            {
+                float* pRow = mDepth.data() + y * mWidth;
+                const __m128 row0 = _mm_set1_ps(tri.edgeB[0] * y + tri.edgeC[0]);
+                const __m128 row1 = _mm_set1_ps(tri.edgeB[1] * y + tri.edgeC[1]);
+                const __m128 row2 = _mm_set1_ps(tri.edgeB[2] * y + tri.edgeC[2]);
+                const __m128 rowDepth = _mm_set1_ps(tri.depthB * y + tri.depthC);
+
+                for (int32_t x = x0; x <= x1; x += 4)
+                {
+                    __m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+                    __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), row0);
+                    __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), row1);
+                    __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), row2);
+                    __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                    if (_mm_movemask_ps(inside) == 0)
+                    {
+                        continue;
+                    }
+
+                    __m128 depth = _mm_add_ps(_mm_mul_ps(depthA, px), rowDepth);
+                    __m128 old = _mm_loadu_ps(pRow + x);
+                    __m128 result = _mm_or_ps(_mm_and_ps(inside, _mm_min_ps(old, depth)), _mm_andnot_ps(inside, old));
+                    _mm_storeu_ps(pRow + x, result);
+                }
+            }
+        }
+
+        // Keep the farthest depth of the tile for the coarse test in isVisible()
+        __m128 maxDepth = zero;
+        for (int32_t y = tileY0; y <= tileY1; y++)
+        {
+            const float* pRow = mDepth.data() + y * mWidth;
+            for (int32_t x = tileX0; x <= tileX1; x += 4)
+            {
+                maxDepth = _mm_max_ps(maxDepth, _mm_loadu_ps(pRow + x));
+            }
+        }
+        maxDepth = _mm_max_ps(maxDepth, _mm_shuffle_ps(maxDepth, maxDepth, _MM_SHUFFLE(1, 0, 3, 2)));
+        maxDepth = _mm_max_ps(maxDepth, _mm_shuffle_ps(maxDepth, maxDepth, _MM_SHUFFLE(2, 3, 0, 1)));
+        mTileMaxDepth[tileID] = _mm_cvtss_f32(maxDepth);
+    }
+
+    bool OcclusionBuffer::isVisible(const BoundingBox& box) const
+    {
+        const glm::vec3 boxMin = box.getMinPos();
+        const glm::vec3 boxMax = box.getMaxPos();
+        float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+        float maxX = -FLT_MAX, maxY = -FLT_MAX;
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            glm::vec3 corner((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+            glm::vec4 v = mViewProjMat * glm::vec4(corner, 1.0f);
+
+            // Boxes crossing the near plane are visible
+            if (v.w <= 1.0e-6f || v.z < 0)
+            {
+                return true;
+            }
+            float invW = 1.0f / v.w;
+            float x = (v.x * invW * 0.5f + 0.5f) * (float)mWidth;
+            float y = (0.5f - v.y * invW * 0.5f) * (float)mHeight;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+            minZ = std::min(minZ, v.z * invW);
+        }
+
+        // Boxes outside of the screen are left to frustum culling
+        if (maxX < 0 || maxY < 0 || minX >= (float)mWidth || minY >= (float)mHeight)
+        {
+            return true;
+        }
+
+        // All the pixels the box touches
+        const int32_t x0 = std::max(0, (int32_t)std::floor(minX));
+        const int32_t x1 = std::min((int32_t)mWidth - 1, (int32_t)std::floor(maxX));
+        const int32_t y0 = std::max(0, (int32_t)std::floor(minY));
+        const int32_t y1 = std::min((int32_t)mHeight - 1, (int32_t)std::floor(maxY));
+
+        const __m128 boxDepth = _mm_set1_ps(minZ);
+        const __m128 laneOffsets = _mm_setr_ps(0, 1, 2, 3);
+        const __m128 first = _mm_set1_ps((float)x0);
+        const __m128 last = _mm_set1_ps((float)x1);
+        for (int32_t ty = y0 / kTileHeight; ty <= y1 / (int32_t)kTileHeight; ty++)
+        {
+            for (int32_t tx = x0 / kTileWidth; tx <= x1 / (int32_t)kTileWidth; tx++)
+            {
+                // The box is in front of the whole tile
+                if (minZ <= mTileMaxDepth[ty * mTileCountX + tx])
+                {
+                    const int32_t tileX0 = std::max(x0, tx * (int32_t)kTileWidth) & ~3;
+                    const int32_t tileX1 = std::min(x1, (tx + 1) * (int32_t)kTileWidth - 1);
+                    const int32_t tileY0 = std::max(y0, ty * (int32_t)kTileHeight);
+                    const int32_t tileY1 = std::min(y1, (ty + 1) * (int32_t)kTileHeight - 1);
+                    for (int32_t y = tileY0; y <= tileY1; y++)
+                    {
+                        const float* pRow = mDepth.data() + y * mWidth;
+                        for (int32_t x = tileX0; x <= tileX1; x += 4)
+                        {
+                            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+                            __m128 inRect = _mm_and_ps(_mm_cmpge_ps(px, first), _mm_cmple_ps(px, last));
+                            __m128 visible = _mm_and_ps(inRect, _mm_cmple_ps(boxDepth, _mm_loadu_ps(pRow + x)));
+                            if (_mm_movemask_ps(visible))
+                            {
+                                return true;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    void OcclusionBuffer::testVisibility(const std::vector<BoundingBox>& boxes, std::vector<uint8_t>& visible) const
+    {
+        visible.resize(boxes.size());
+        ThreadPool::instance()->parallelFor((uint32_t)boxes.size(), 0, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                visible[i] = isVisible(boxes[i]) ? 1 : 0;
+            }
+        });
+    }
+}
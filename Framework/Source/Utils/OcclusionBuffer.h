@@ -0,0 +1,145 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <vector>
+#include "glm/vec3.hpp"
+#include "glm/mat4x4.hpp"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    class TriangleBvh;
+
+    /** A low-resolution depth buffer for occlusion culling on the CPU.
+        Each frame, clear() sets the view-projection matrix, addOccluder() transforms, clips and bins occluder triangles into screen tiles, and rasterize() rasterizes the tiles in parallel with SSE. isVisible() then tests world-space boxes against the buffer.
+        Depth uses the [0, 1] range of the projection, with 0 at the near plane. Occluders are rasterized two-sided at pixel centers, so a box can be reported occluded by an occluder which covers the center of every pixel the box touches.
+        isVisible() and testVisibility() are const and can run on several threads, after rasterize() returned.
+    */
+    class OcclusionBuffer
+    {
+    public:
+        using SharedPtr = std::shared_ptr<OcclusionBuffer>;
+        using SharedConstPtr = std::shared_ptr<const OcclusionBuffer>;
+
+        static const uint32_t kTileWidth = 32;
+        static const uint32_t kTileHeight = 32;
+
+        /** Statistics of the current frame
+        */
+        struct Stats
+        {
+            uint32_t occluderCount = 0;
+            uint32_t triangleCount = 0;             ///< Occluder triangles submitted
+            uint32_t rasterizedTriangleCount = 0;   ///< Triangles left after clipping, including the ones created by clipping
+            float setupTime = 0;                    ///< CPU time spent in addOccluder(), in milliseconds
+            float rasterTime = 0;                   ///< CPU time spent in rasterize(), in milliseconds
+        };
+
+        /** Create a buffer
+            \param[in] width Width in pixels. Rounded up to a multiple of kTileWidth.
+            \param[in] height Height in pixels. Rounded up to a multiple of kTileHeight.
+        */
+        static SharedPtr create(uint32_t width = 256, uint32_t height = 128);
+
+        /** Start a new frame. Clears the depth to the far plane and drops the binned triangles.
+            \param[in] viewProjMat The view-projection matrix of the camera the boxes will be tested for
+        */
+        void clear(const glm::mat4& viewProjMat);
+
+        /** Transform and bin the triangles of an occluder
+            \param[in] worldMat Object to world transform
+            \param[in] pPositions The vertex positions
+            \param[in] pIndices Triangle list indices. If nullptr, every three positions form a triangle.
+            \param[in] count Number of indices, or of positions if pIndices is nullptr
+        */
+        void addOccluder(const glm::mat4& worldMat, const glm::vec3* pPositions, const uint32_t* pIndices, uint32_t count);
+
+        /** Transform and bin the triangles of a mesh's BVH, see Mesh::getBvh()
+        */
+        void addOccluder(const glm::mat4& worldMat, const TriangleBvh* pBvh);
+
+        /** Rasterize the binned triangles. Tiles are processed in parallel on the global thread pool.
+        */
+        void rasterize();
+
+        /** Test if a box might be visible
+            \param[in] box World-space box
+            \return false if the box is hidden behind the occluders
+        */
+        bool isVisible(const BoundingBox& box) const;
+
+        /** Test a batch of boxes on the global thread pool
+            \param[in] boxes World-space boxes
+            \param[out] visible Receives 1 for boxes which might be visible and 0 for hidden ones. Resized to the number of boxes.
+        */
+        void testVisibility(const std::vector<BoundingBox>& boxes, std::vector<uint8_t>& visible) const;
+
+        uint32_t getWidth() const { return mWidth; }
+        uint32_t getHeight() const { return mHeight; }
+
+        /** Get the depth of a pixel. Row 0 is the top of the screen.
+        */
+        float getDepth(uint32_t x, uint32_t y) const { return mDepth[y * mWidth + x]; }
+
+        /** Get the statistics of the current frame
+        */
+        const Stats& getStats() const { return mStats; }
+
+    private:
+        OcclusionBuffer(uint32_t width, uint32_t height);
+
+        /** Screen-space triangle, ready for rasterization. Edge functions are positive inside the triangle.
+        */
+        struct Triangle
+        {
+            float edgeA[3];
+            float edgeB[3];
+            float edgeC[3];
+            float depthA;               ///< depth = depthA * x + depthB * y + depthC
+            float depthB;
+            float depthC;
+            int32_t minX, minY, maxX, maxY;     ///< Pixel bounds, inclusive
+        };
+
+        void addClipTriangle(const glm::vec4 v[3]);
+        void setupTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2);
+        void rasterizeTile(uint32_t tileID);
+
+        uint32_t mWidth;
+        uint32_t mHeight;
+        uint32_t mTileCountX;
+        uint32_t mTileCountY;
+        glm::mat4 mViewProjMat;
+        std::vector<float> mDepth;
+        std::vector<float> mTileMaxDepth;               ///< The farthest depth of each tile
+        std::vector<Triangle> mTriangles;
+        std::vector<std::vector<uint32_t>> mBins;       ///< Indices of the triangles overlapping each tile
+        Stats mStats;
+    };
+}
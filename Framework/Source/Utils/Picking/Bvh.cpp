@@ -0,0 +1,431 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Bvh.h"
+#include <algorithm>
+#include <cmath>
+#include "glm/geometric.hpp"
+#include "glm/matrix.hpp"
+
+namespace Falcor
+{
+    static const uint32_t kBinCount = 16;
+    // SAH splits deeper than this fall back to median splits, which bounds the depth of the traversal stack
+    static const uint32_t kMaxSahDepth = 64;
+    static const uint32_t kStackSize = 128;
+
+    struct BuildRef
+    {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        glm::vec3 centroid;
+        uint32_t primitive;
+    };
+
+    static float getHalfArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+    {
+        glm::vec3 e = boundsMax - boundsMin;
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+
+    /** Build a tree over a list of primitives with a binned surface area heuristic. On return, the primitives are sorted in leaf order.
+    */
+    static void buildTree(std::vector<BuildRef>& refs, uint32_t maxLeafSize, std::vector<BvhNode>& nodes)
+    {
+        struct Task
+        {
+            uint32_t node;
+            uint32_t begin;
+            uint32_t end;
+            uint32_t depth;
+        };
+
+        struct Bin
+        {
+            glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+            glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+            uint32_t count = 0;
+        };
+
+        nodes.clear();
+        nodes.reserve(refs.size() * 2 / maxLeafSize + 1);
+        nodes.push_back(BvhNode());
+        std::vector<Task> tasks;
+        tasks.push_back({ 0, 0, (uint32_t)refs.size(), 0 });
+
+        while(tasks.size())
+        {
+            Task task = tasks.back();
+            tasks.pop_back();
+
+            glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+            glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+            for(uint32_t i = task.begin; i < task.end; i++)
+            {
+                boundsMin = glm::min(boundsMin, refs[i].boundsMin);
+                boundsMax = glm::max(boundsMax, refs[i].boundsMax);
+                centroidMin = glm::min(centroidMin, refs[i].centroid);
+                centroidMax = glm::max(centroidMax, refs[i].centroid);
+            }
+            nodes[task.node].boundsMin = boundsMin;
+            nodes[task.node].boundsMax = boundsMax;
+
+            const uint32_t count = task.end - task.begin;
+            if(count <= maxLeafSize)
+            {
+                nodes[task.node].offset = task.begin;
+                nodes[task.node].count = count;
+                continue;
+            }
+
+            // Evaluate the splits between the bins of every axis
+            const glm::vec3 centroidExtent = centroidMax - centroidMin;
+            float bestCost = FLT_MAX;
+            int32_t bestAxis = -1;
+            uint32_t bestSplit = 0;
+            for(int32_t axis = 0; (axis < 3) && (task.depth < kMaxSahDepth); axis++)
+            {
+                if(centroidExtent[axis] <= 0)
+                {
+                    continue;
+                }
+
+                const float scale = (float)kBinCount / centroidExtent[axis];
+                Bin bins[kBinCount];
+                for(uint32_t i = task.begin; i < task.end; i++)
+                {
+                    uint32_t b = std::min((uint32_t)((refs[i].centroid[axis] - centroidMin[axis]) * scale), kBinCount - 1);
+                    bins[b].boundsMin = glm::min(bins[b].boundsMin, refs[i].boundsMin);
+                    bins[b].boundsMax = glm::max(bins[b].boundsMax, refs[i].boundsMax);
+                    bins[b].count++;
+                }
+
+                // Split s puts bins [0, s] on the left
+                float rightCost[kBinCount - 1];
+                Bin right;
+                for(uint32_t s = kBinCount - 1; s > 0; s--)
+                {
+                    right.boundsMin = glm::min(right.boundsMin, bins[s].boundsMin);
+                    right.boundsMax = glm::max(right.boundsMax, bins[s].boundsMax);
+                    right.count += bins[s].count;
+                    rightCost[s - 1] = right.count ? right.count * getHalfArea(right.boundsMin, right.boundsMax) : FLT_MAX;
+                }
+
+                Bin left;
+                for(uint32_t s = 0; s < kBinCount - 1; s++)
+                {
+                    left.boundsMin = glm::min(left.boundsMin, bins[s].boundsMin);
+                    left.boundsMax = glm::max(left.boundsMax, bins[s].boundsMax);
+                    left.count += bins[s].count;
+                    if(left.count == 0 || rightCost[s] == FLT_MAX)
+                    {
+                        continue;
+                    }
+                    float cost = left.count * getHalfArea(left.boundsMin, left.boundsMax) + rightCost[s];
+                    if(cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = s;
+                    }
+                }
+            }
+
+            uint32_t mid = task.begin;
+            if(bestAxis >= 0)
+            {
+                const float scale = (float)kBinCount / centroidExtent[bestAxis];
+                auto it = std::partition(refs.begin() + task.begin, refs.begin() + task.end, [&](const BuildRef& ref)
+                {
+                    return std::min((uint32_t)((ref.centroid[bestAxis] - centroidMin[bestAxis]) * scale), kBinCount - 1) <= bestSplit;
+                });
+                mid = (uint32_t)(it - refs.begin());
+            }
+
+            // All the centroids are at the same place, or the tree is too deep. Split at the median of the widest axis.
+            if(mid == task.begin || mid == task.end)
+            {
+                int32_t axis = (centroidExtent.x >= centroidExtent.y && centroidExtent.x >= centroidExtent.z) ? 0 : ((centroidExtent.y >= centroidExtent.z) ? 1 : 2);
+                mid = task.begin + count / 2;
+                std::nth_element(refs.begin() + task.begin, refs.begin() + mid, refs.begin() + task.end, [axis](const BuildRef& a, const BuildRef& b) { return a.centroid[axis] < b.centroid[axis]; });
+            }
+
+            const uint32_t firstChild = (uint32_t)nodes.size();
+            nodes[task.node].offset = firstChild;
+            nodes[task.node].count = 0;
+            nodes.push_back(BvhNode());
+            nodes.push_back(BvhNode());
+            tasks.push_back({ firstChild + 1, mid, task.end, task.depth + 1 });
+            tasks.push_back({ firstChild, task.begin, mid, task.depth + 1 });
+        }
+    }
+
+    static glm::vec3 getInverseDirection(const glm::vec3& direction)
+    {
+        // Zero components would create infinities, and NaNs when multiplied by 0 in the slab test
+        glm::vec3 inv;
+        for(int32_t i = 0; i < 3; i++)
+        {
+            float d = (std::abs(direction[i]) > 1e-20f) ? direction[i] : std::copysign(1e-20f, direction[i]);
+            inv[i] = 1.0f / d;
+        }
+        return inv;
+    }
+
+    /** Slab test
+        \return The entry distance, or FLT_MAX if the ray misses the box
+    */
+    static inline float intersectBox(const BvhNode& node, const glm::vec3& origin, const glm::vec3& invDirection, float maxDistance)
+    {
+        glm::vec3 t0 = (node.boundsMin - origin) * invDirection;
+        glm::vec3 t1 = (node.boundsMax - origin) * invDirection;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+        return (entry <= exit) ? entry : FLT_MAX;
+    }
+
+    /** Visit the leaves a ray enters, nearest child first. The leaf function shortens maxDistance when it finds a hit, which culls the nodes behind it.
+    */
+    template<typename LeafFunc>
+    static void traverse(const std::vector<BvhNode>& nodes, const glm::vec3& origin, const glm::vec3& direction, float& maxDistance, LeafFunc leafFunc)
+    {
+        if(nodes.empty())
+        {
+            return;
+        }
+
+        const glm::vec3 invDirection = getInverseDirection(direction);
+        if(intersectBox(nodes[0], origin, invDirection, maxDistance) == FLT_MAX)
+        {
+            return;
+        }
+
+        uint32_t stack[kStackSize];
+        float stackDistance[kStackSize];
+        uint32_t stackSize = 0;
+        uint32_t current = 0;
+        while(true)
+        {
+            const BvhNode& node = nodes[current];
+            if(node.count)
+            {
+                leafFunc(node.offset, node.count);
+            }
+            else
+            {
+                uint32_t nearChild = node.offset;
+                uint32_t farChild = node.offset + 1;
+                float nearDistance = intersectBox(nodes[nearChild], origin, invDirection, maxDistance);
+                float farDistance = intersectBox(nodes[farChild], origin, invDirection, maxDistance);
+                if(farDistance < nearDistance)
+                {
+                    std::swap(nearChild, farChild);
+                    std::swap(nearDistance, farDistance);
+                }
+
+                if(nearDistance != FLT_MAX)
+                {
+                    if(farDistance != FLT_MAX)
+                    {
+                        stack[stackSize] = farChild;
+                        stackDistance[stackSize] = farDistance;
+                        stackSize++;
+                    }
+                    current = nearChild;
+                    continue;
+                }
+            }
+
+            // Pop the next node, skipping the ones behind the closest hit
+            do
+            {
+                if(stackSize == 0)
+                {
+                    return;
+                }
+                stackSize--;
+            } while(stackDistance[stackSize] > maxDistance);
+            current = stack[stackSize];
+        }
+    }
+
+    TriangleBvh::SharedPtr TriangleBvh::create(const uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount)
+    {
+        const uint32_t triangleCount = indexCount / 3;
+        if(triangleCount == 0)
+        {
+            return nullptr;
+        }
+
+        auto getPosition = [&](uint32_t vertex)
+        {
+            const float* p = (const float*)((const uint8_t*)pPositions + (size_t)vertex * positionStride);
+            return glm::vec3(p[0], p[1], p[2]);
+        };
+
+        SharedPtr pBvh = SharedPtr(new TriangleBvh());
+        std::vector<Triangle> triangles(triangleCount);
+        std::vector<BuildRef> refs(triangleCount);
+        for(uint32_t t = 0; t < triangleCount; t++)
+        {
+            const uint32_t* pTriangle = pIndices + t * 3;
+            if(pTriangle[0] >= vertexCount || pTriangle[1] >= vertexCount || pTriangle[2] >= vertexCount)
+            {
+                logError("TriangleBvh::create() - index out of range in triangle " + std::to_string(t));
+                return nullptr;
+            }
+
+            glm::vec3 v0 = getPosition(pTriangle[0]);
+            glm::vec3 v1 = getPosition(pTriangle[1]);
+            glm::vec3 v2 = getPosition(pTriangle[2]);
+            triangles[t] = { v0, v1 - v0, v2 - v0, t };
+            refs[t].boundsMin = glm::min(v0, glm::min(v1, v2));
+            refs[t].boundsMax = glm::max(v0, glm::max(v1, v2));
+            refs[t].centroid = (refs[t].boundsMin + refs[t].boundsMax) * 0.5f;
+            refs[t].primitive = t;
+        }
+
+        buildTree(refs, kMaxLeafSize, pBvh->mNodes);
+
+        pBvh->mTriangles.resize(triangleCount);
+        for(uint32_t i = 0; i < triangleCount; i++)
+        {
+            pBvh->mTriangles[i] = triangles[refs[i].primitive];
+        }
+        return pBvh;
+    }
+
+    bool TriangleBvh::intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& hit) const
+    {
+        bool found = false;
+        traverse(mNodes, origin, direction, maxDistance, [&](uint32_t first, uint32_t count)
+        {
+            // Moller-Trumbore, without backface culling
+            for(uint32_t i = first; i < first + count; i++)
+            {
+                const Triangle& tri = mTriangles[i];
+                glm::vec3 p = glm::cross(direction, tri.edge2);
+                float det = glm::dot(tri.edge1, p);
+                if(det == 0.0f)
+                {
+                    continue;
+                }
+                float invDet = 1.0f / det;
+                glm::vec3 s = origin - tri.v0;
+                float u = glm::dot(s, p) * invDet;
+                if(u < 0.0f || u > 1.0f)
+                {
+                    continue;
+                }
+                glm::vec3 q = glm::cross(s, tri.edge1);
+                float v = glm::dot(direction, q) * invDet;
+                if(v < 0.0f || u + v > 1.0f)
+                {
+                    continue;
+                }
+                float t = glm::dot(tri.edge2, q) * invDet;
+                if(t >= 0.0f && t < maxDistance)
+                {
+                    maxDistance = t;
+                    hit.triangle = tri.index;
+                    hit.barycentrics = glm::vec2(u, v);
+                    hit.distance = t;
+                    found = true;
+                }
+            }
+        });
+        return found;
+    }
+
+    InstanceBvh::SharedPtr InstanceBvh::create(const std::vector<Instance>& instances)
+    {
+        SharedPtr pBvh = SharedPtr(new InstanceBvh());
+        std::vector<BuildRef> refs;
+        refs.reserve(instances.size());
+        for(uint32_t i = 0; i < (uint32_t)instances.size(); i++)
+        {
+            const Instance& instance = instances[i];
+            if(instance.pBvh == nullptr || glm::determinant(instance.transform) == 0.0f)
+            {
+                continue;
+            }
+
+            BoundingBox box = instance.pBvh->getBoundingBox().transform(instance.transform);
+            BuildRef ref;
+            ref.boundsMin = box.getMinPos();
+            ref.boundsMax = box.getMaxPos();
+            ref.centroid = box.center;
+            ref.primitive = (uint32_t)pBvh->mInstances.size();
+            refs.push_back(ref);
+            pBvh->mInstances.push_back({ glm::inverse(instance.transform), instance.pBvh.get(), i });
+            pBvh->mBvhs.push_back(instance.pBvh);
+        }
+
+        if(refs.empty())
+        {
+            return pBvh;
+        }
+
+        buildTree(refs, 1, pBvh->mNodes);
+        std::vector<InstanceData> sorted(refs.size());
+        for(size_t i = 0; i < refs.size(); i++)
+        {
+            sorted[i] = pBvh->mInstances[refs[i].primitive];
+        }
+        pBvh->mInstances.swap(sorted);
+        return pBvh;
+    }
+
+    bool InstanceBvh::intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& hit) const
+    {
+        bool found = false;
+        traverse(mNodes, origin, direction, maxDistance, [&](uint32_t first, uint32_t count)
+        {
+            for(uint32_t i = first; i < first + count; i++)
+            {
+                // Distances along the ray don't change with the transform, since the direction is transformed without normalizing it
+                const InstanceData& instance = mInstances[i];
+                glm::vec3 localOrigin = glm::vec3(instance.invTransform * glm::vec4(origin, 1.0f));
+                glm::vec3 localDirection = glm::vec3(instance.invTransform * glm::vec4(direction, 0.0f));
+                TriangleBvh::Hit triangleHit;
+                if(instance.pBvh->intersect(localOrigin, localDirection, maxDistance, triangleHit))
+                {
+                    maxDistance = triangleHit.distance;
+                    hit.instance = instance.index;
+                    hit.triangle = triangleHit.triangle;
+                    hit.barycentrics = triangleHit.barycentrics;
+                    hit.distance = triangleHit.distance;
+                    found = true;
+                }
+            }
+        });
+        return found;
+    }
+}
@@ -0,0 +1,178 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <vector>
+#include <cfloat>
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+#include "glm/mat4x4.hpp"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    /** Node of a TriangleBvh or InstanceBvh. 32 bytes, so that two nodes share a cache line.
+    */
+    struct BvhNode
+    {
+        glm::vec3 boundsMin;
+        uint32_t offset;        ///< Leaves: index of the first primitive. Interior nodes: index of the first child, the second child follows it.
+        glm::vec3 boundsMax;
+        uint32_t count;         ///< Number of primitives in a leaf, 0 for interior nodes
+    };
+
+    /** Bounding volume hierarchy over the triangles of a mesh, used for ray casts on the CPU.
+        The tree is built with a binned surface area heuristic. Triangles are stored in leaf order as a vertex and two edges, so traversal doesn't touch the mesh's vertices. Triangles are two-sided.
+    */
+    class TriangleBvh
+    {
+    public:
+        using SharedPtr = std::shared_ptr<TriangleBvh>;
+        using SharedConstPtr = std::shared_ptr<const TriangleBvh>;
+
+        static const uint32_t kMaxLeafSize = 4;
+
+        /** Closest hit of a ray
+        */
+        struct Hit
+        {
+            uint32_t triangle = 0;          ///< Index of the triangle in the mesh, which is the location of its first index divided by 3
+            glm::vec2 barycentrics;         ///< Weights of the triangle's second and third vertices
+            float distance = FLT_MAX;       ///< Distance along the ray, in units of the ray direction's length
+        };
+
+        /** Build the BVH of an indexed triangle list
+            \param[in] pIndices The triangle list's indices
+            \param[in] indexCount The number of indices
+            \param[in] pPositions The first vertex position. Positions are 3 floats.
+            \param[in] positionStride The distance in bytes between positions
+            \param[in] vertexCount The number of vertices
+            \return A new object, or nullptr if the mesh doesn't have triangles or an index is out of range
+        */
+        static SharedPtr create(const uint32_t* pIndices, uint32_t indexCount, const void* pPositions, uint32_t positionStride, uint32_t vertexCount);
+
+        /** Find the closest hit of a ray
+            \param[in] origin The ray origin
+            \param[in] direction The ray direction. Doesn't need to be normalized.
+            \param[in] maxDistance Hits further than this distance are ignored
+            \param[out] hit The closest hit. Only written if the ray hits the mesh.
+            \return true if the ray hit a triangle
+        */
+        bool intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& hit) const;
+
+        /** Get the bounding-box of the triangles
+        */
+        BoundingBox getBoundingBox() const { return BoundingBox::fromMinMax(mNodes[0].boundsMin, mNodes[0].boundsMax); }
+
+        uint32_t getTriangleCount() const { return (uint32_t)mTriangles.size(); }
+
+        /** Get the vertices of a triangle. Triangles are in the BVH's leaf order, not in the mesh's order.
+        */
+        void getTriangle(uint32_t i, glm::vec3& v0, glm::vec3& v1, glm::vec3& v2) const
+        {
+            const Triangle& t = mTriangles[i];
+            v0 = t.v0;
+            v1 = t.v0 + t.edge1;
+            v2 = t.v0 + t.edge2;
+        }
+        uint32_t getNodeCount() const { return (uint32_t)mNodes.size(); }
+
+        /** Get the size of the tree and of the triangles in bytes
+        */
+        size_t getMemorySize() const { return mNodes.size() * sizeof(BvhNode) + mTriangles.size() * sizeof(Triangle); }
+
+    private:
+        TriangleBvh() = default;
+
+        struct Triangle
+        {
+            glm::vec3 v0;
+            glm::vec3 edge1;
+            glm::vec3 edge2;
+            uint32_t index;
+        };
+
+        std::vector<BvhNode> mNodes;
+        std::vector<Triangle> mTriangles;
+    };
+
+    /** Two-level BVH: a tree over transformed instances of TriangleBvh objects.
+        Rebuilding the tree only touches the instances, so it's cheap enough to do when the instances move.
+    */
+    class InstanceBvh
+    {
+    public:
+        using SharedPtr = std::shared_ptr<InstanceBvh>;
+        using SharedConstPtr = std::shared_ptr<const InstanceBvh>;
+
+        struct Instance
+        {
+            glm::mat4 transform;                    ///< Object to world transform
+            TriangleBvh::SharedConstPtr pBvh;
+        };
+
+        /** Closest hit of a ray
+        */
+        struct Hit
+        {
+            uint32_t instance = 0;          ///< Index of the instance in the list the tree was built from
+            uint32_t triangle = 0;          ///< Triangle index in the instance's mesh
+            glm::vec2 barycentrics;         ///< Weights of the triangle's second and third vertices
+            float distance = FLT_MAX;       ///< Distance along the ray, in units of the ray direction's length
+        };
+
+        /** Build the tree. Instances without a BVH, or with a singular transform, are ignored.
+        */
+        static SharedPtr create(const std::vector<Instance>& instances);
+
+        /** Find the closest hit of a ray in world space
+            \param[in] origin The ray origin
+            \param[in] direction The ray direction. Doesn't need to be normalized.
+            \param[in] maxDistance Hits further than this distance are ignored
+            \param[out] hit The closest hit. Only written if the ray hits an instance.
+            \return true if the ray hit a triangle
+        */
+        bool intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Hit& hit) const;
+
+        uint32_t getInstanceCount() const { return (uint32_t)mInstances.size(); }
+
+    private:
+        InstanceBvh() = default;
+
+        struct InstanceData
+        {
+            glm::mat4 invTransform;
+            const TriangleBvh* pBvh;
+            uint32_t index;
+        };
+
+        std::vector<BvhNode> mNodes;
+        std::vector<InstanceData> mInstances;
+        std::vector<TriangleBvh::SharedConstPtr> mBvhs;
+    };
+}
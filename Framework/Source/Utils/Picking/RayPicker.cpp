@@ -0,0 +1,115 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Utils/Picking/RayPicker.h"
+
+namespace Falcor
+{
+    RayPicker::UniquePtr RayPicker::create(const Scene::SharedPtr& pScene)
+    {
+        UniquePtr pPicker = UniquePtr(new RayPicker(pScene));
+        pPicker->update();
+        return pPicker;
+    }
+
+    void RayPicker::update()
+    {
+        std::vector<InstanceBvh::Instance> bvhInstances;
+        mInstances.clear();
+        mMissingBvhCount = 0;
+
+        for(uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+        {
+            for(uint32_t instanceID = 0; instanceID < mpScene->getModelInstanceCount(modelID); instanceID++)
+            {
+                const Scene::ModelInstance::SharedPtr& pModelInstance = mpScene->getModelInstance(modelID, instanceID);
+                if(pModelInstance->isVisible() == false)
+                {
+                    continue;
+                }
+
+                const Model* pModel = pModelInstance->getObject().get();
+                for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    for(uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                    {
+                        const Model::MeshInstance::SharedPtr& pMeshInstance = pModel->getMeshInstance(meshID, meshInstanceID);
+                        if(pMeshInstance->isVisible() == false)
+                        {
+                            continue;
+                        }
+
+                        const TriangleBvh::SharedConstPtr& pMeshBvh = pMeshInstance->getObject()->getBvh();
+                        if(pMeshBvh == nullptr)
+                        {
+                            mMissingBvhCount++;
+                            continue;
+                        }
+
+                        bvhInstances.push_back({ pModelInstance->getTransformMatrix() * pMeshInstance->getTransformMatrix(), pMeshBvh });
+                        mInstances.push_back({ pModelInstance, pMeshInstance });
+                    }
+                }
+            }
+        }
+
+        mpBvh = InstanceBvh::create(bvhInstances);
+    }
+
+    bool RayPicker::pick(const glm::vec2& mousePos, const Camera* pCamera, Result& result)
+    {
+        update();
+
+        // Unproject the mouse position on the near and far planes
+        glm::vec2 ndc = glm::vec2(mousePos.x * 2.0f - 1.0f, 1.0f - mousePos.y * 2.0f);
+        const glm::mat4& invViewProj = pCamera->getInvViewProjMatrix();
+        glm::vec4 nearPoint = invViewProj * glm::vec4(ndc, 0.0f, 1.0f);
+        glm::vec4 farPoint = invViewProj * glm::vec4(ndc, 1.0f, 1.0f);
+        glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+        glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+        return castRay(origin, direction, result);
+    }
+
+    bool RayPicker::castRay(const glm::vec3& origin, const glm::vec3& direction, Result& result) const
+    {
+        InstanceBvh::Hit hit;
+        if(mpBvh == nullptr || mpBvh->intersect(origin, direction, FLT_MAX, hit) == false)
+        {
+            return false;
+        }
+
+        const Instance& instance = mInstances[hit.instance];
+        result.pModelInstance = instance.pModelInstance;
+        result.pMeshInstance = instance.pMeshInstance;
+        result.triangle = hit.triangle;
+        result.barycentrics = hit.barycentrics;
+        result.distance = hit.distance;
+        result.position = origin + direction * hit.distance;
+        return true;
+    }
+}
@@ -0,0 +1,100 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Graphics/Scene/Scene.h"
+#include "Graphics/Camera/Camera.h"
+#include "Utils/Picking/Bvh.h"
+
+namespace Falcor
+{
+    /** Picks scene objects by casting rays on the CPU.
+        Unlike Picking, this doesn't render the scene or wait for the GPU, and it works without a render context. Rays are tested against the meshes' BVHs (see Mesh::getBvh()), so the models need to be loaded with Model::BuildBvh. Mesh instances without a BVH can't be hit, see isComplete().
+        The tree over the instances is rebuilt by update(), which pick() calls, so the picker follows changes to the scene.
+    */
+    class RayPicker
+    {
+    public:
+        using UniquePtr = std::unique_ptr<RayPicker>;
+        using UniqueConstPtr = std::unique_ptr<const RayPicker>;
+
+        /** The closest hit of a ray
+        */
+        struct Result
+        {
+            Scene::ModelInstance::SharedPtr pModelInstance;
+            Model::MeshInstance::SharedPtr pMeshInstance;
+            uint32_t triangle = 0;          ///< Index of the triangle in the mesh's original geometry (LOD 0)
+            glm::vec2 barycentrics;         ///< Weights of the triangle's second and third vertices
+            float distance = 0;             ///< Distance along the ray, in units of the ray direction's length
+            glm::vec3 position;             ///< The hit position in world space
+        };
+
+        /** Create a picker
+            \param[in] pScene Scene to pick
+        */
+        static UniquePtr create(const Scene::SharedPtr& pScene);
+
+        /** Rebuild the tree over the visible mesh instances. Call it after instances moved, or were added or removed.
+        */
+        void update();
+
+        /** Update the tree and pick the object under the mouse
+            \param[in] mousePos Mouse position in the range [0,1] with (0,0) being the top left corner. Same coordinate space as in MouseEvent.
+            \param[in] pCamera The camera to pick from
+            \param[out] result The closest hit. Only written if an object was hit.
+            \return Whether an object was hit
+        */
+        bool pick(const glm::vec2& mousePos, const Camera* pCamera, Result& result);
+
+        /** Find the closest hit of a world-space ray. Uses the tree built by the last update().
+            \param[in] origin The ray origin
+            \param[in] direction The ray direction. Doesn't need to be normalized.
+            \param[out] result The closest hit. Only written if an object was hit.
+            \return Whether an object was hit
+        */
+        bool castRay(const glm::vec3& origin, const glm::vec3& direction, Result& result) const;
+
+        /** Check if every visible mesh instance had a BVH in the last update(). If not, pick() can miss objects.
+        */
+        bool isComplete() const { return mMissingBvhCount == 0; }
+
+    private:
+        RayPicker(const Scene::SharedPtr& pScene) : mpScene(pScene) {}
+
+        struct Instance
+        {
+            Scene::ModelInstance::SharedPtr pModelInstance;
+            Model::MeshInstance::SharedPtr pMeshInstance;
+        };
+
+        Scene::SharedPtr mpScene;
+        InstanceBvh::SharedPtr mpBvh;
+        std::vector<Instance> mInstances;
+        uint32_t mMissingBvhCount = 0;
+    };
+}
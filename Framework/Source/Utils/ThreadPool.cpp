@@ -0,0 +1,178 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Utils/ThreadPool.h"
+
+namespace Falcor
+{
+    ThreadPool::SharedPtr ThreadPool::create(uint32_t threadCount)
+    {
+        if (threadCount == 0)
+        {
+            uint32_t hwThreads = std::thread::hardware_concurrency();
+            threadCount = (hwThreads > 1) ? hwThreads - 1 : 1;
+        }
+        return SharedPtr(new ThreadPool(threadCount));
+    }
+
+    ThreadPool* ThreadPool::instance()
+    {
+        static ThreadPool::SharedPtr spPool = create();
+        return spPool.get();
+    }
+
+    ThreadPool::ThreadPool(uint32_t threadCount)
+    {
+        mWorkers.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTerminate = true;
+        }
+        mCondition.notify_all();
+
+        for (auto& t : mWorkers)
+        {
+            t.join();
+        }
+    }
+
+    void ThreadPool::enqueue(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mJobs.push(std::move(job));
+        }
+        mCondition.notify_one();
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this]() { return mTerminate || mJobs.empty() == false; });
+                if (mTerminate && mJobs.empty())
+                {
+                    return;
+                }
+                job = std::move(mJobs.front());
+                mJobs.pop();
+            }
+            job();
+        }
+    }
+
+    bool ThreadPool::isWorkerThread() const
+    {
+        std::thread::id id = std::this_thread::get_id();
+        for (const auto& t : mWorkers)
+        {
+            if (t.get_id() == id)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ThreadPool::parallelFor(uint32_t count, uint32_t grainSize, const RangeFunc& func)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        if (grainSize == 0)
+        {
+            // Aim for a few chunks per thread to balance uneven work
+            uint32_t threads = getThreadCount() + 1;
+            grainSize = max(1u, count / (threads * 4));
+        }
+
+        const uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+        if (chunkCount == 1 || mWorkers.empty())
+        {
+            func(0, count);
+            return;
+        }
+
+        // The state is shared with the helper jobs, which might start after this function returned
+        struct SharedState
+        {
+            std::atomic<uint32_t> nextChunk;
+            uint32_t completedChunks = 0;
+            std::mutex mutex;
+            std::condition_variable done;
+        };
+        auto pState = std::make_shared<SharedState>();
+        pState->nextChunk = 0;
+
+        auto runChunks = [pState, chunkCount, grainSize, count, &func]()
+        {
+            while (true)
+            {
+                uint32_t chunk = pState->nextChunk.fetch_add(1);
+                if (chunk >= chunkCount)
+                {
+                    return;
+                }
+                uint32_t begin = chunk * grainSize;
+                uint32_t end = min(begin + grainSize, count);
+                func(begin, end);
+
+                std::lock_guard<std::mutex> lock(pState->mutex);
+                if (++pState->completedChunks == chunkCount)
+                {
+                    pState->done.notify_all();
+                }
+            }
+        };
+
+        // Helpers only touch 'func' after claiming a chunk, which can't happen once all chunks completed, so capturing it by reference is safe
+        uint32_t helperCount = min(chunkCount - 1, getThreadCount());
+        for (uint32_t i = 0; i < helperCount; i++)
+        {
+            enqueue(runChunks);
+        }
+
+        runChunks();
+
+        std::unique_lock<std::mutex> lock(pState->mutex);
+        pState->done.wait(lock, [&]() { return pState->completedChunks == chunkCount; });
+    }
+}
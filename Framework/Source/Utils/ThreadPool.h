@@ -0,0 +1,105 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <memory>
+
+namespace Falcor
+{
+    /** A fixed-size pool of worker threads.
+        Jobs are executed in FIFO order. The pool is shared by the framework's CPU-side subsystems (light clustering, asset loading, etc.). Use ThreadPool::instance() to get the global pool, or create a private one if you need isolation.
+    */
+    class ThreadPool
+    {
+    public:
+        using SharedPtr = std::shared_ptr<ThreadPool>;
+        using SharedConstPtr = std::shared_ptr<const ThreadPool>;
+
+        /** Function called by parallelFor(). Processes the elements in the range [begin, end).
+        */
+        using RangeFunc = std::function<void(uint32_t begin, uint32_t end)>;
+
+        /** Create a new thread pool
+            \param[in] threadCount Number of worker threads. 0 means one thread per hardware thread, minus one for the calling thread.
+        */
+        static SharedPtr create(uint32_t threadCount = 0);
+
+        /** Get the global thread pool. The pool is created on first use.
+        */
+        static ThreadPool* instance();
+
+        ~ThreadPool();
+
+        /** Get the number of worker threads
+        */
+        uint32_t getThreadCount() const { return (uint32_t)mWorkers.size(); }
+
+        /** Queue a job for asynchronous execution
+            \return A future which will hold the result of the job
+        */
+        template<typename Func>
+        auto submit(Func func) -> std::future<decltype(func())>
+        {
+            using ResultType = decltype(func());
+            auto pTask = std::make_shared<std::packaged_task<ResultType()>>(std::move(func));
+            std::future<ResultType> result = pTask->get_future();
+            enqueue([pTask]() { (*pTask)(); });
+            return result;
+        }
+
+        /** Split [0, count) into chunks of grainSize elements and process them on the pool.
+            The calling thread participates in the work, so it's safe to call this function from inside a job. The function returns once all the elements were processed.
+            \param[in] count Number of elements
+            \param[in] grainSize Number of elements per chunk. 0 means the pool will choose a size.
+            \param[in] func The function to call for each chunk
+        */
+        void parallelFor(uint32_t count, uint32_t grainSize, const RangeFunc& func);
+
+        /** Check if the calling thread is one of this pool's workers
+        */
+        bool isWorkerThread() const;
+
+    private:
+        ThreadPool(uint32_t threadCount);
+        void enqueue(std::function<void()> job);
+        void workerLoop();
+
+        std::vector<std::thread> mWorkers;
+        std::queue<std::function<void()>> mJobs;
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        bool mTerminate = false;
+    };
+}
@@ -0,0 +1,229 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "AsyncVideoEncoder.h"
+#include "Utils/CpuTimer.h"
+
+namespace Falcor
+{
+    std::string AsyncVideoEncoder::Stats::toString() const
+    {
+        std::string s = "Video capture: " + std::to_string(encodedFrames) + " frames encoded (" + std::to_string(getEncodeFps()) + " fps on the encoder thread)";
+        s += ", " + std::to_string(droppedFrames) + " dropped";
+        s += ", " + std::to_string(stalledFrames) + " stalled for " + std::to_string(stallSeconds * 1000) + " ms";
+        return s;
+    }
+
+    AsyncVideoEncoder::UniquePtr AsyncVideoEncoder::create(const VideoEncoder::Desc& desc, uint32_t queueSize, Backpressure backpressure)
+    {
+        UniquePtr pEncoder = UniquePtr(new AsyncVideoEncoder(backpressure));
+        pEncoder->mpEncoder = VideoEncoder::create(desc);
+        if(pEncoder->mpEncoder == nullptr)
+        {
+            return nullptr;
+        }
+
+        queueSize = std::max(queueSize, 1u);
+        pEncoder->mFrames.resize(queueSize);
+        for(uint32_t i = 0; i < queueSize; i++)
+        {
+            pEncoder->mFrames[i].resize(pEncoder->mpEncoder->getFrameSize());
+            pEncoder->mFreeFrames.push_back(i);
+        }
+
+        pEncoder->mThread = std::thread(&AsyncVideoEncoder::encoderLoop, pEncoder.get());
+        return pEncoder;
+    }
+
+    AsyncVideoEncoder::~AsyncVideoEncoder()
+    {
+        endCapture();
+    }
+
+    uint8_t* AsyncVideoEncoder::beginFrame()
+    {
+        assert(mCurrentFrame == kInvalidFrame);
+        std::unique_lock<std::mutex> lock(mMutex);
+        if(mStopping)
+        {
+            return nullptr;
+        }
+
+        if(mFreeFrames.empty())
+        {
+            if(mBackpressure == Backpressure::DropFrames)
+            {
+                mStats.droppedFrames++;
+                return nullptr;
+            }
+
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            mFrameFreed.wait(lock, [this]() { return mFreeFrames.empty() == false; });
+            mStats.stalledFrames++;
+            mStats.stallSeconds += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) * 1.0e-3;
+        }
+
+        mCurrentFrame = mFreeFrames.front();
+        mFreeFrames.pop_front();
+        return mFrames[mCurrentFrame].data();
+    }
+
+    void AsyncVideoEncoder::submitFrame()
+    {
+        if(mCurrentFrame == kInvalidFrame)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQueuedFrames.push_back(mCurrentFrame);
+            mStats.submittedFrames++;
+        }
+        mCurrentFrame = kInvalidFrame;
+        mFrameQueued.notify_one();
+    }
+
+    bool AsyncVideoEncoder::appendFrame(const void* pData, uint32_t rowPitch)
+    {
+        uint8_t* pDst = beginFrame();
+        if(pDst == nullptr)
+        {
+            return false;
+        }
+
+        const uint32_t dstPitch = mpEncoder->getRowPitch();
+        rowPitch = rowPitch ? rowPitch : dstPitch;
+        if(rowPitch == dstPitch)
+        {
+            memcpy(pDst, pData, mpEncoder->getFrameSize());
+        }
+        else
+        {
+            const uint32_t rowCount = mpEncoder->getFrameSize() / dstPitch;
+            for(uint32_t y = 0; y < rowCount; y++)
+            {
+                memcpy(pDst + y * dstPitch, (const uint8_t*)pData + y * rowPitch, dstPitch);
+            }
+        }
+
+        submitFrame();
+        return true;
+    }
+
+    void AsyncVideoEncoder::encoderLoop()
+    {
+        while(true)
+        {
+            uint32_t frame;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mFrameQueued.wait(lock, [this]() { return mStopping || (mQueuedFrames.empty() == false); });
+                if(mQueuedFrames.empty())
+                {
+                    // Stopping, and all the frames were encoded
+                    return;
+                }
+                frame = mQueuedFrames.front();
+                mQueuedFrames.pop_front();
+            }
+
+            CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+            mpEncoder->appendFrame(mFrames[frame].data());
+            double seconds = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) * 1.0e-3;
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mFreeFrames.push_back(frame);
+                mStats.encodedFrames++;
+                mStats.encodeSeconds += seconds;
+            }
+            mFrameFreed.notify_one();
+        }
+    }
+
+    void AsyncVideoEncoder::endCapture()
+    {
+        if(mThread.joinable() == false)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mFrameQueued.notify_one();
+        mThread.join();
+        mpEncoder->endCapture();
+    }
+
+    AsyncVideoEncoder::Stats AsyncVideoEncoder::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+    AsyncVideoEncoder::Stats AsyncVideoEncoder::benchmark(const VideoEncoder::Desc& desc, uint32_t frameCount, uint32_t queueSize, Backpressure backpressure)
+    {
+        UniquePtr pEncoder = create(desc, queueSize, backpressure);
+        if(pEncoder == nullptr)
+        {
+            return Stats();
+        }
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        for(uint32_t f = 0; f < frameCount; f++)
+        {
+            // A moving gradient, so the codec can't skip identical frames
+            uint32_t* pPixels = (uint32_t*)pEncoder->beginFrame();
+            if(pPixels == nullptr)
+            {
+                continue;
+            }
+
+            for(uint32_t y = 0; y < desc.height; y++)
+            {
+                for(uint32_t x = 0; x < desc.width; x++)
+                {
+                    uint8_t r = (uint8_t)(x + f);
+                    uint8_t g = (uint8_t)(y + 2 * f);
+                    uint8_t b = (uint8_t)(x ^ y);
+                    pPixels[y * desc.width + x] = r | (g << 8) | (b << 16) | 0xff000000;
+                }
+            }
+            pEncoder->submitFrame();
+        }
+        pEncoder->endCapture();
+        double seconds = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) * 1.0e-3;
+
+        Stats stats = pEncoder->getStats();
+        logInfo("Video encoder benchmark: " + std::to_string(frameCount) + " frames of " + std::to_string(desc.width) + "x" + std::to_string(desc.height) + " in " + std::to_string(seconds) + " seconds. " + stats.toString());
+        return stats;
+    }
+}
@@ -0,0 +1,133 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "VideoEncoder.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+namespace Falcor
+{
+    /** Runs a VideoEncoder on a dedicated thread.
+        The caller fills frames from a fixed pool, and the encoder thread does the flip, color conversion and encoding. When all the frames in the pool are queued, the Backpressure policy decides whether the caller waits or the frame is dropped.
+    */
+    class AsyncVideoEncoder
+    {
+    public:
+        using UniquePtr = std::unique_ptr<AsyncVideoEncoder>;
+        using UniqueConstPtr = std::unique_ptr<const AsyncVideoEncoder>;
+
+        enum class Backpressure
+        {
+            Wait,           ///< Block the caller until the encoder frees a frame. The video has all the frames.
+            DropFrames,     ///< Drop the frame. The caller never blocks on the encoder.
+        };
+
+        struct Stats
+        {
+            uint64_t submittedFrames = 0;   ///< Frames queued for encoding
+            uint64_t encodedFrames = 0;     ///< Frames the encoder thread finished
+            uint64_t droppedFrames = 0;     ///< Frames dropped because the queue was full
+            uint64_t stalledFrames = 0;     ///< Frames the caller had to wait for a free buffer
+            double stallSeconds = 0;        ///< Time the caller spent waiting for free buffers
+            double encodeSeconds = 0;       ///< Time the encoder thread spent converting and encoding
+
+            /** Get the encoder thread throughput
+            */
+            double getEncodeFps() const { return encodeSeconds > 0 ? encodedFrames / encodeSeconds : 0; }
+
+            std::string toString() const;
+        };
+
+        /** Create an encoder
+            \param[in] desc The video description, see VideoEncoder
+            \param[in] queueSize Number of frame buffers in the pool
+            \param[in] backpressure What to do when all the frame buffers are in use
+            \return A new object, or nullptr if the VideoEncoder creation failed
+        */
+        static UniquePtr create(const VideoEncoder::Desc& desc, uint32_t queueSize = 4, Backpressure backpressure = Backpressure::Wait);
+        ~AsyncVideoEncoder();
+
+        /** Get a tightly packed frame buffer to fill. Each call must be followed by submitFrame().
+            \return The buffer, or nullptr if the frame was dropped
+        */
+        uint8_t* beginFrame();
+
+        /** Queue the frame returned by beginFrame() for encoding
+        */
+        void submitFrame();
+
+        /** Copy a frame and queue it. Returns false if the frame was dropped.
+            \param[in] rowPitch The distance in bytes between rows in pData. 0 means tightly packed rows.
+        */
+        bool appendFrame(const void* pData, uint32_t rowPitch = 0);
+
+        /** Encode the queued frames, stop the encoder thread and close the file
+        */
+        void endCapture();
+
+        /** Get the frame size in bytes
+        */
+        uint32_t getFrameSize() const { return mpEncoder ? mpEncoder->getFrameSize() : 0; }
+
+        /** Get a snapshot of the statistics
+        */
+        Stats getStats() const;
+
+        /** Measure the encoder throughput with synthetic frames. No GPU is involved.
+            \param[in] desc The video description. The file is written to desc.filename.
+            \param[in] frameCount Number of frames to encode
+            \param[in] queueSize Number of frame buffers in the pool
+            \param[in] backpressure What to do when all the frame buffers are in use. With DropFrames, the benchmark shows how many frames a caller which never waits would lose.
+            \return The statistics of the capture. They are all 0 if the encoder couldn't be created.
+        */
+        static Stats benchmark(const VideoEncoder::Desc& desc, uint32_t frameCount, uint32_t queueSize = 4, Backpressure backpressure = Backpressure::Wait);
+
+    private:
+        AsyncVideoEncoder(Backpressure backpressure) : mBackpressure(backpressure) {}
+        void encoderLoop();
+
+        VideoEncoder::UniquePtr mpEncoder;
+        Backpressure mBackpressure;
+
+        std::vector<std::vector<uint8_t>> mFrames;
+        std::deque<uint32_t> mFreeFrames;
+        std::deque<uint32_t> mQueuedFrames;
+        uint32_t mCurrentFrame = kInvalidFrame;
+        static const uint32_t kInvalidFrame = uint32_t(-1);
+
+        std::thread mThread;
+        mutable std::mutex mMutex;
+        std::condition_variable mFrameQueued;
+        std::condition_variable mFrameFreed;
+        bool mStopping = false;
+        Stats mStats;
+    };
+}
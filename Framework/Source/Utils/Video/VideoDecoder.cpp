@@ -27,8 +27,9 @@
 ***************************************************************************/
 #include "Framework.h"
 #include "VideoDecoder.h"
+#include "API/Device.h"
+#include "Utils/CpuTimer.h"
 #include "Utils/OS.h"
-#include "Utils/BinaryFileStream.h"
 extern "C"
 {
 #include "libavcodec/avcodec.h"
@@ -36,20 +37,24 @@ extern "C"
 #include "libswscale/swscale.h"
 }
 
-#include <cstdio>
-
 namespace Falcor
 {
-#if 0
+    std::string VideoDecoder::Stats::toString() const
+    {
+        std::string s = "Video decoder: " + std::to_string(decodedFrames) + " frames decoded (" + std::to_string(getDecodeFps()) + " fps on the decoder thread)";
+        s += ", " + std::to_string(skippedFrames) + " skipped, " + std::to_string(underruns) + " underruns";
+        return s;
+    }
+
     float VideoDecoder::rationalToFloat(const AVRational& r)
     {
-        return ((float)r.num / (float)r.den);
+        return r.den ? ((float)r.num / (float)r.den) : 0.0f;
     }
 
-    VideoDecoder::UniquePtr VideoDecoder::create(const std::string& filename, uint32_t bufferedFrames, bool async)
+    VideoDecoder::UniquePtr VideoDecoder::create(const std::string& filename, const Desc& desc)
     {
-        auto pVideo = UniquePtr(new VideoDecoder());
-        if(pVideo->load(filename, bufferedFrames, async) == false)
+        auto pVideo = UniquePtr(new VideoDecoder(desc));
+        if(pVideo->open(filename) == false)
         {
             pVideo = nullptr;
         }
@@ -57,282 +62,375 @@ namespace Falcor
         return pVideo;
     }
 
-    VideoDecoder::VideoDecoder()
+    static bool error(const std::string& filename, const std::string& msg)
     {
+        logError("Error when opening video file " + filename + ".\n" + msg);
+        return false;
     }
 
-    bool VideoDecoder::load(const std::string& filename, uint32_t bufferedFrames, bool async)
+    bool VideoDecoder::open(const std::string& filename)
     {
         mFilename = filename;
-        mVidBufferCount = bufferedFrames;
 
-        if(async)
+        // Register the codecs
+        av_register_all();
+
+        if(avformat_open_input(&mpFormatCtx, mFilename.c_str(), nullptr, nullptr) != 0)
         {
-            mAsyncDecoding = std::make_shared<std::future<void>>(std::async(std::launch::async, &VideoDecoder::bufferFrames, this));
+            return error(mFilename, "Can't open file.");
         }
-        else
-            bufferFrames();
-
-        return true;
-    }
 
-    VideoDecoder::~VideoDecoder()
-    {
-        // Flush the async operation
-        if(mAsyncDecoding)
+        if(avformat_find_stream_info(mpFormatCtx, nullptr) < 0)
         {
-            mAsyncDecoding->get();
+            return error(mFilename, "Couldn't find stream information.");
         }
 
-        av_free(mpFrame);
-
-        // Close the codec
-        avcodec_close(mpCodecCtx);
-        // Close the video file
-        avformat_close_input(&mpFormatCtx);
-
-        for(auto& tex : (*mFrameTextures))
-            if(tex) tex->evict(nullptr);
-    }
-
-    void FlipRGBFrame(AVFrame* pFrame, int H)
-    {
-        uint8_t* templine = new uint8_t[pFrame->linesize[0]];
-
-        int hby2 = H / 2;
-
-        for(int line = 0; line < hby2; line++)
+        AVCodec* pCodec = nullptr;
+        mVideoStream = av_find_best_stream(mpFormatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, &pCodec, 0);
+        if(mVideoStream < 0 || pCodec == nullptr)
         {
-            auto* line1 = pFrame->data[0] + (line)* pFrame->linesize[0];
-            auto* line2 = pFrame->data[0] + (H - 1 - line) * pFrame->linesize[0];
+            return error(mFilename, "Can't find a video stream with a supported codec.");
+        }
 
-            memcpy(templine, line1, pFrame->linesize[0]);
-            memcpy(line1, line2, pFrame->linesize[0]);
-            memcpy(line2, templine, pFrame->linesize[0]);
+        const AVStream* pStream = mpFormatCtx->streams[mVideoStream];
+        mpCodecCtx = avcodec_alloc_context3(pCodec);
+        if(avcodec_parameters_to_context(mpCodecCtx, pStream->codecpar) < 0)
+        {
+            return error(mFilename, "Couldn't copy the codec parameters.");
         }
 
-        delete[] templine;
-    }
+        // Let the codec decode in parallel. This replaces pinning the decoder thread to specific cores.
+        mpCodecCtx->thread_count = mDesc.workerCount;
+        mpCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
 
-    void VideoDecoder::bufferFrames()
-    {
-        if(mAsyncDecoding)
+        if(avcodec_open2(mpCodecCtx, pCodec, nullptr) < 0)
         {
-            setThreadPriority(getCurrentThread(), ThreadPriorityType::Low);
-            setThreadAffinity(getCurrentThread(), (1<<5)|(1<<6)|(1<<7)|(1<<8));
+            return error(mFilename, "Can't open the video codec.");
         }
 
-        if(mpFrame)
+        mFPS = rationalToFloat(pStream->avg_frame_rate);
+        if(mFPS <= 0)
+        {
+            mFPS = rationalToFloat(pStream->r_frame_rate);
+        }
+        if(mFPS <= 0)
         {
-            av_free(mpFrame);
-            mpFrame = nullptr;
+            mFPS = 30;
         }
 
-        // Close the codec
-        if(mpCodecCtx)
+        if(pStream->duration != AV_NOPTS_VALUE)
         {
-            avcodec_close(mpCodecCtx);
-            mpCodecCtx = nullptr;
+            mDuration = (float)(pStream->duration * av_q2d(pStream->time_base));
         }
-        // Close the video file
-        if(mpFormatCtx)
+        else if(mpFormatCtx->duration != AV_NOPTS_VALUE)
         {
-            avformat_close_input(&mpFormatCtx);
-            mpFormatCtx = nullptr;
+            mDuration = (float)mpFormatCtx->duration / AV_TIME_BASE;
         }
+        mFrameCount = pStream->nb_frames;
 
-        // Register the codecs
-        avcodec_register_all();
-        av_register_all();
-
-        if(avformat_open_input(&mpFormatCtx, mFilename.c_str(), NULL, NULL) != 0)
+        mWidth = mpCodecCtx->width;
+        mHeight = mpCodecCtx->height;
+        mpSwsCtx = sws_getContext(mWidth, mHeight, mpCodecCtx->pix_fmt, mWidth, mHeight, AV_PIX_FMT_RGBA, SWS_BILINEAR, nullptr, nullptr, nullptr);
+        mpFrame = av_frame_alloc();
+        if(mpSwsCtx == nullptr || mpFrame == nullptr)
         {
-            printf("Cannot open file\n");
-            return;
+            return error(mFilename, "Can't allocate the conversion context.");
         }
 
-        if(avformat_find_stream_info(mpFormatCtx, NULL) < 0)
+        // Allocate the frame pool
+        mFrames.resize(std::max(mDesc.bufferedFrames, 2u));
+        for(uint32_t i = 0; i < mFrames.size(); i++)
         {
-            printf("Couldn't find stream information.\n");
-            return;
+            mFrames[i].data.resize(mWidth * mHeight * 4);
+            mFreeFrames.push_back(i);
         }
 
-        for(uint32_t i = 0; i < mpFormatCtx->nb_streams; i++)
+        mThread = std::thread(&VideoDecoder::decoderLoop, this);
+        return true;
+    }
+
+    void VideoDecoder::close()
+    {
+        if(mThread.joinable())
         {
-            auto& stream = mpFormatCtx->streams[i];
-            if(stream->codec->codec_type == AVMEDIA_TYPE_VIDEO)
             {
-                mVideoStream = i;
-                break;
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStopping = true;
             }
+            mFrameFreed.notify_one();
+            mThread.join();
         }
 
-        if(mVideoStream == -1)
+        av_frame_free(&mpFrame);
+        avcodec_free_context(&mpCodecCtx);
+        sws_freeContext(mpSwsCtx);
+        mpSwsCtx = nullptr;
+        if(mpFormatCtx)
         {
-            return;
+            avformat_close_input(&mpFormatCtx);
         }
+    }
 
-        auto& stream = mpFormatCtx->streams[mVideoStream];
-
-        // Get a pointer to the codec context for the video stream
-        mpCodecCtxOrig = stream->codec;
+    VideoDecoder::~VideoDecoder()
+    {
+        close();
+    }
 
-        mFPS = rationalToFloat(stream->avg_frame_rate);
+    bool VideoDecoder::decodeNextFrame(int64_t& frameNumber)
+    {
+        const AVStream* pStream = mpFormatCtx->streams[mVideoStream];
+        while(true)
+        {
+            int r = avcodec_receive_frame(mpCodecCtx, mpFrame);
+            if(r == 0)
+            {
+                int64_t pts = av_frame_get_best_effort_timestamp(mpFrame);
+                int64_t start = (pStream->start_time != AV_NOPTS_VALUE) ? pStream->start_time : 0;
+                frameNumber = (pts == AV_NOPTS_VALUE) ? frameNumber + 1 : (int64_t)(((pts - start) * av_q2d(pStream->time_base)) * mFPS + 0.5);
+                return true;
+            }
+            else if(r != AVERROR(EAGAIN))
+            {
+                // End of the stream, or a decoding error
+                return false;
+            }
 
-        // Find the decoder for the video stream
-        mpCodec = avcodec_find_decoder(mpCodecCtxOrig->codec_id);
+            // The decoder needs more data
+            AVPacket packet;
+            av_init_packet(&packet);
+            packet.data = nullptr;
+            packet.size = 0;
+            if(av_read_frame(mpFormatCtx, &packet) < 0)
+            {
+                // Drain the frames the codec still holds
+                avcodec_send_packet(mpCodecCtx, nullptr);
+                continue;
+            }
 
-        if(mpCodec == NULL)
-        {
-            printf("Unsupported codec!\n");
-            return; // Codec not found
+            if(packet.stream_index == mVideoStream)
+            {
+                avcodec_send_packet(mpCodecCtx, &packet);
+            }
+            av_packet_unref(&packet);
         }
+    }
 
-        // Copy context
-        mpCodecCtx = avcodec_alloc_context3(mpCodec);
-        if(avcodec_copy_context(mpCodecCtx, mpCodecCtxOrig) != 0)
-        {
-            printf("Couldn't copy codec context\n");
-            return; // Error copying codec context
-        }
+    void VideoDecoder::decoderLoop()
+    {
+        setThreadPriority(getCurrentThread(), ThreadPriorityType::Low);
 
-        // Open codec
-        if(avcodec_open2(mpCodecCtx, mpCodec, nullptr) < 0)
+        const AVStream* pStream = mpFormatCtx->streams[mVideoStream];
+        auto rewind = [&](int64_t frame)
         {
-            return; // Could not open codec
-        }
+            int64_t start = (pStream->start_time != AV_NOPTS_VALUE) ? pStream->start_time : 0;
+            int64_t timestamp = start + (int64_t)((frame / mFPS) / av_q2d(pStream->time_base));
+            av_seek_frame(mpFormatCtx, mVideoStream, timestamp, AVSEEK_FLAG_BACKWARD);
+            avcodec_flush_buffers(mpCodecCtx);
+        };
 
-        // Allocate video frame
-        mpFrame = av_frame_alloc();
+        int64_t frameNumber = -1;   // Frame index in the file
+        int64_t skipUntil = 0;      // Frames before a seek target are decoded and discarded
+        uint64_t seekGeneration = 0;
 
+        while(true)
+        {
+            uint32_t slot = 0;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mFrameFreed.wait(lock, [this]() { return mStopping || (mSeekFrame >= 0) || ((mEndOfStream == false) && (mFreeFrames.empty() == false)); });
+                if(mStopping)
+                {
+                    return;
+                }
 
-        mFrames.clear();
-        mFrames.reserve(mVidBufferCount);
-
-        const bool async = mAsyncDecoding != nullptr;
+                if(mSeekFrame >= 0)
+                {
+                    // Map the playback frame to a frame in the file
+                    int64_t target = mSeekFrame;
+                    mLoopCount = (mFrameCount > 0) ? target / mFrameCount : 0;
+                    skipUntil = (mFrameCount > 0) ? target % mFrameCount : target;
+                    mSeekFrame = -1;
+                    mEndOfStream = false;
+                    seekGeneration = mSeekGeneration;
+                    lock.unlock();
+
+                    rewind(skipUntil);
+                    continue;
+                }
 
-        //printf("Buffering frames...\n");
-        uint32_t frameIdx = 0;
+                slot = mFreeFrames.front();
+                mFreeFrames.pop_front();
+            }
 
-        SwsContext *sws_ctx = sws_getContext(
-            mpCodecCtx->width, mpCodecCtx->height, mpCodecCtx->pix_fmt,
-            mpCodecCtx->width, mpCodecCtx->height, PIX_FMT_RGBA, SWS_BILINEAR, NULL, NULL, NULL);
+            CpuTimer::TimePoint startTime = CpuTimer::getCurrentTimePoint();
+            bool decoded;
+            do
+            {
+                decoded = decodeNextFrame(frameNumber);
+            } while(decoded && frameNumber < skipUntil);
 
-        AVPacket packet;
-        while(av_read_frame(mpFormatCtx, &packet) >= 0 && (frameIdx < mVidBufferCount))
-        {
-            if(packet.stream_index == mVideoStream)
+            if(decoded == false)
             {
-                int32_t isFrameDone;
-                avcodec_decode_video2(mpCodecCtx, mpFrame, &isFrameDone, &packet);
-                if(isFrameDone)
+                bool restart = false;
                 {
-                    // Create either a single frame, or all frames one-by-one on CPU
-                    if(async || mFrames.empty())
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    mFreeFrames.push_front(slot);
+                    if(mFrameCount == 0)
                     {
-                        // Inplace construction to avoid releasing of arrays
-                        mFrames.push_back(Frame());
-                        new(&mFrames.back()) Frame(mpCodecCtx);
+                        mFrameCount = frameNumber + 1;
                     }
-                    Frame& frame = mFrames.back();
 
-                    // Convert the image from its native format to RGB
-                    sws_scale(sws_ctx, (uint8_t const * const *)mpFrame->data, mpFrame->linesize, 0, mpCodecCtx->height, frame.mpFrameRGB->data, frame.mpFrameRGB->linesize);
-                    FlipRGBFrame(frame.mpFrameRGB, mpCodecCtx->height);
-                    if(!async)
-                        uploadToGPU(frameIdx);
+                    restart = mDesc.loop && (mFrameCount > 0) && (frameNumber >= 0);
+                    if(restart)
+                    {
+                        mLoopCount++;
+                    }
+                    else
+                    {
+                        mEndOfStream = true;
+                    }
+                }
 
-                    frameIdx++;
+                if(restart)
+                {
+                    skipUntil = 0;
+                    frameNumber = -1;
+                    rewind(0);
+                }
+                else
+                {
+                    mFrameReady.notify_one();
                 }
+                continue;
             }
-            av_free_packet(&packet);
-        }
-        //printf("Done reading %d frames\n", frameIdx);
+            skipUntil = 0;
+
+            // Convert the image from its native format to RGBA. The rows are written bottom->top.
+            Frame& frame = mFrames[slot];
+            const int32_t rowPitch = mWidth * 4;
+            uint8_t* dst[4] = { frame.data.data() + (mHeight - 1) * rowPitch, nullptr, nullptr, nullptr };
+            int32_t dstPitch[4] = { -rowPitch, 0, 0, 0 };
+            sws_scale(mpSwsCtx, mpFrame->data, mpFrame->linesize, 0, mHeight, dst, dstPitch);
+            double seconds = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) * 1.0e-3;
 
-        mRealFrameCount = frameIdx;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStats.decodedFrames++;
+                mStats.decodeSeconds += seconds;
+                if(seekGeneration != mSeekGeneration)
+                {
+                    // A seek was requested while decoding, this frame is stale
+                    mFreeFrames.push_back(slot);
+                    continue;
+                }
+                frame.frameNumber = mLoopCount * mFrameCount + frameNumber;
+                mReadyFrames.push_back(slot);
+            }
+            mFrameReady.notify_one();
+        }
     }
 
-    void VideoDecoder::uploadToGPU(int frameStart)
+    void VideoDecoder::requestSeek(int64_t frameNumber)
     {
-        if(!mFrameTextures)
-            mFrameTextures = std::make_shared<TexturePool>();
-        for(size_t i=0;i<mFrames.size();++i)
         {
-            auto& frame = mFrames[i];
-            if(frameStart + i >= mFrameTextures->size())
+            std::lock_guard<std::mutex> lock(mMutex);
+            for(uint32_t slot : mReadyFrames)
             {
-                mFrameTextures->push_back(Texture::create2D(mpCodecCtx->width, mpCodecCtx->height, ResourceFormat::RGBA8UnormSrgb, 1, 1, frame.mpFrameRGB->data[0]));
-                mFrameTextures->back()->makeResident(nullptr);
-            }
-            else
-            {
-                (*mFrameTextures)[frameStart + i]->uploadSubresourceData(frame.mpFrameRGB->data[0], frame.mFrameSize);
+                mFreeFrames.push_back(slot);
             }
+            mReadyFrames.clear();
+            mSeekFrame = std::max(frameNumber, (int64_t)0);
+            mSeekGeneration++;
         }
-        mFrames.clear();
+        mCurrentFrame = frameNumber - 1;
+        mFrameFreed.notify_one();
+    }
+
+    void VideoDecoder::seek(float time)
+    {
+        requestSeek((int64_t)floor(time * mFPS));
     }
 
     Texture::SharedPtr VideoDecoder::getTextureForNextFrame(float curTime)
     {
-        // Flush the async operation, upload everything to video memory
-        if(mAsyncDecoding)
+        int64_t target = std::max((int64_t)floor(curTime * mFPS), (int64_t)0);
+
+        // Going back in time, or far ahead of what's buffered, needs a seek
+        bool farAhead = (target > std::max(mCurrentFrame, (int64_t)0) + (int64_t)mFrames.size() + (int64_t)mFPS) && (mDesc.loop || curTime < mDuration);
+        if((target < mCurrentFrame) || farAhead)
         {
-            mAsyncDecoding->get();
-            mAsyncDecoding.reset();
-            uploadToGPU();
+            requestSeek(target);
         }
-        int curFrame = ((int)floor(curTime * mFPS)) % mRealFrameCount;
-        //SetBufferToTexture(m_VidBuffers[curFrame]);
-        //printf("time, frame: %f, %d\n", curTime, curFrame);
-        return (*mFrameTextures)[curFrame];
-    }
 
-    float VideoDecoder::getDuration()
-    {
-        // Flush the async operation, upload everything to video memory
-        if(mAsyncDecoding)
+        int32_t slot = -1;
         {
-            mAsyncDecoding->get();
-            mAsyncDecoding.reset();
-            uploadToGPU();
+            std::unique_lock<std::mutex> lock(mMutex);
+            if(mpCurrentTexture == nullptr)
+            {
+                // Nothing to display yet, wait for the first frame
+                mFrameReady.wait(lock, [this]() { return mReadyFrames.empty() == false || mEndOfStream; });
+            }
+
+            // Take the latest frame which is due, and recycle the frames playback passed
+            while((mReadyFrames.empty() == false) && (mFrames[mReadyFrames.front()].frameNumber <= target))
+            {
+                if(slot >= 0)
+                {
+                    mFreeFrames.push_back(slot);
+                    mStats.skippedFrames++;
+                }
+                slot = mReadyFrames.front();
+                mReadyFrames.pop_front();
+            }
+
+            if(slot < 0 && (mCurrentFrame < target) && (mEndOfStream == false))
+            {
+                mStats.underruns++;
+            }
         }
 
-        return ((float)mRealFrameCount) / mFPS;
-    }
+        if(slot >= 0)
+        {
+            // Upload into the next texture of the pool
+            TexturePool& pool = *getTexturePool();
+            mpCurrentTexture = pool[mNextTexture];
+            mNextTexture = (mNextTexture + 1) % (uint32_t)pool.size();
+            gpDevice->getRenderContext()->updateTexture(mpCurrentTexture.get(), mFrames[slot].data.data());
+            mCurrentFrame = mFrames[slot].frameNumber;
 
-    VideoDecoder::TexturePoolPtr VideoDecoder::getTexturePool()
-    {
-        return mFrameTextures;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mFreeFrames.push_back(slot);
+            }
+            mFrameFreed.notify_one();
+        }
+
+        return mpCurrentTexture;
     }
 
-    void VideoDecoder::setTexturePool(TexturePoolPtr& texturePool)
+    VideoDecoder::Stats VideoDecoder::getStats() const
     {
-        mFrameTextures = texturePool;
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
     }
 
-    VideoDecoder::Frame::Frame(AVCodecContext* codec)
+    VideoDecoder::TexturePoolPtr VideoDecoder::getTexturePool()
     {
-        mFrameSize = avpicture_get_size(PIX_FMT_RGBA, codec->width, codec->height);
-
-        // Allocate an AVFrame structure
-        mpFrameRGB = av_frame_alloc();
-        if(mpFrameRGB == NULL)
+        if(mFrameTextures == nullptr)
         {
-            printf("Cannot allocate frame. Possibly out of CPU memory!\n");
-            return;
+            mFrameTextures = std::make_shared<TexturePool>();
         }
-        mCpuVidBuffer = (uint8_t*)av_malloc(mFrameSize*sizeof(uint8_t));
 
-        avpicture_fill((AVPicture *)mpFrameRGB, mCpuVidBuffer, PIX_FMT_RGBA, codec->width, codec->height);
-        //printf("frame size is %d Mbytes\n", mFrameSize / (1024 * 1024));
+        while(mFrameTextures->size() < kTextureCount)
+        {
+            mFrameTextures->push_back(Texture::create2D(mWidth, mHeight, ResourceFormat::RGBA8UnormSrgb, 1, 1, nullptr));
+        }
+        return mFrameTextures;
     }
 
-    VideoDecoder::Frame::~Frame()
+    void VideoDecoder::setTexturePool(TexturePoolPtr& texturePool)
     {
-        if(mCpuVidBuffer)
-            av_free(mCpuVidBuffer);
-        if(mpFrameRGB)
-            av_free(mpFrameRGB);
+        mFrameTextures = texturePool;
+        mNextTexture = 0;
     }
-#endif
-}
\ No newline at end of file
+}
@@ -27,23 +27,22 @@
 ***************************************************************************/
 #pragma once
 #include <string>
-#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 #include "API/Texture.h"
 
 struct AVFormatContext;
-struct AVStream;
 struct AVFrame;
-struct AVPicture;
 struct SwsContext;
 struct AVCodecContext;
-struct AVCodec;
 struct AVRational;
 
 namespace Falcor
 {        
-    /** Simple video decoder for high-framerate and high-resolution
-    playback of rendered videos. Currently decodes the first N frames
-    as textures before playing.
+    /** Streaming video decoder for playback of rendered videos.
+        A decoder thread fills a fixed pool of CPU frame buffers ahead of playback. The frame matching the playback time is uploaded into a small pool of reusable textures, so memory usage doesn't depend on the video length.
     */
     class VideoDecoder
     {
@@ -54,73 +53,124 @@ namespace Falcor
         typedef std::vector<Texture::SharedPtr> TexturePool;
         typedef std::shared_ptr<TexturePool> TexturePoolPtr;
 
-        /** create a new videoplay object
+        struct Desc
+        {
+            uint32_t bufferedFrames = 8;    ///< Number of decoded frames the decoder thread can run ahead of playback
+            uint32_t workerCount = 0;       ///< Number of codec worker threads. 0 lets FFmpeg choose based on the core count.
+            bool loop = true;               ///< Restart from the first frame when reaching the end of the video
+        };
+
+        struct Stats
+        {
+            uint64_t decodedFrames = 0;     ///< Frames decoded and converted to RGBA
+            uint64_t skippedFrames = 0;     ///< Decoded frames which playback passed before they were displayed
+            uint64_t underruns = 0;         ///< Times playback needed a frame which wasn't decoded yet
+            double decodeSeconds = 0;       ///< Time the decoder thread spent decoding and converting
+
+            /** Get the decoder thread throughput
+            */
+            double getDecodeFps() const { return decodeSeconds > 0 ? decodedFrames / decodeSeconds : 0; }
+
+            std::string toString() const;
+        };
+
+        /** Create a new decoder. Decoding starts right away.
             \param[in] filename Input video file (with path)
-            \param[in] bufferFrames The maximum number of input frames to buffer as Texture objects. Default is 300.
+            \param[in] desc Decoder settings
+            \return A new object, or nullptr if the file can't be opened or decoded
         */
-        static UniquePtr create(const std::string& filename, uint32_t bufferedFrames = 300, bool async = false);
+        static UniquePtr create(const std::string& filename, const Desc& desc);
         ~VideoDecoder();
 
-        /** Get a texture object for the frame at current time
+        /** Get a texture object for the frame at the requested time.
+            If the frame isn't decoded yet, the last displayed frame is returned and an underrun is counted. Going back in time seeks.
             \param[in] curTime Time for which frame is sought
-            \return Texture pointer to texture object
+            \return Texture pointer to texture object. The texture is reused by later calls, once the pool wraps around.
         */
         Texture::SharedPtr getTextureForNextFrame(float curTime);
 
-        /** Return duration of video loaded (in seconds).
-            This uses the actual number of frames. Only makes sense
-            for videos shorter than the requested frame count.
+        /** Restart decoding at the frame containing the time
+        */
+        void seek(float time);
+
+        /** Return duration of the video (in seconds)
         */
-        float getDuration();
+        float getDuration() const { return mDuration; }
+
+        /** Return the frame rate of the video
+        */
+        float getFps() const { return mFPS; }
+
+        uint32_t getWidth() const { return mWidth; }
+        uint32_t getHeight() const { return mHeight; }
+
+        /** Get a snapshot of the decoding statistics
+        */
+        Stats getStats() const;
 
         /** Returns reusable shared texture pool
         */
         TexturePoolPtr getTexturePool();
 
-        /** Sets reusable shared texture pool
+        /** Sets reusable shared texture pool. The textures must match the video dimensions.
         */
         void setTexturePool(TexturePoolPtr& texturePool);
 
-        bool load(const std::string& filename, uint32_t bufferedFrames, bool async);
-
     private:
-        /** Holds a single video frame on CPU
+        /** Holds a single decoded video frame on CPU
         */
         struct Frame
         {
-            Frame() {}
-            Frame(AVCodecContext* codec);
-            ~Frame();
-            AVFrame*    mpFrameRGB = nullptr;
-            uint8_t*    mCpuVidBuffer = nullptr;
-            int         mFrameSize = 0;
+            std::vector<uint8_t> data;
+            int64_t frameNumber = 0;    ///< Frame index since the start of playback, counting loops
         };
 
-        VideoDecoder();
-
-        void uploadToGPU(int frameStart = 0);
+        VideoDecoder(const Desc& desc) : mDesc(desc) {}
+        bool open(const std::string& filename);
+        void close();
+        void decoderLoop();
+        bool decodeNextFrame(int64_t& frameNumber);
+        void requestSeek(int64_t frameNumber);
 
+        Desc mDesc;
         std::string mFilename;
 
-        AVFormatContext*                        mpFormatCtx       = nullptr;
-        AVCodecContext*                         mpCodecCtxOrig    = nullptr;
-        AVCodecContext*                         mpCodecCtx        = nullptr;
-        AVCodec*                                mpCodec           = nullptr;
-        AVFrame*                                mpFrame           = nullptr;
-        std::vector<Frame>                      mFrames;
-
-        float                                   mFPS              = 30;
-        bool                                    mFlipY            = true;
-        unsigned                                mVideoStream      = -1;
-        uint32_t                                mVidBufferCount   = 300;
-        uint32_t                                mRealFrameCount = 0;
-
-        std::shared_ptr<std::future<void>>        mAsyncDecoding = nullptr;
-
-        TexturePoolPtr                          mFrameTextures;
+        AVFormatContext*    mpFormatCtx = nullptr;
+        AVCodecContext*     mpCodecCtx  = nullptr;
+        AVFrame*            mpFrame     = nullptr;
+        SwsContext*         mpSwsCtx    = nullptr;
+        int32_t             mVideoStream = -1;
+
+        float       mFPS = 30;
+        float       mDuration = 0;
+        int64_t     mFrameCount = 0;    ///< Frames in the video. Found when the decoder first reaches the end of the file if the container doesn't store it.
+        uint32_t    mWidth = 0;
+        uint32_t    mHeight = 0;
+
+        // Decoder thread state, protected by mMutex
+        std::vector<Frame> mFrames;
+        std::deque<uint32_t> mFreeFrames;
+        std::deque<uint32_t> mReadyFrames;
+        int64_t mSeekFrame = -1;        ///< Pending seek request
+        uint64_t mSeekGeneration = 0;   ///< Incremented by every seek request, so the decoder thread can drop stale frames
+        int64_t mLoopCount = 0;
+        bool mEndOfStream = false;
+        bool mStopping = false;
+        Stats mStats;
+        std::thread mThread;
+        mutable std::mutex mMutex;
+        std::condition_variable mFrameReady;
+        std::condition_variable mFrameFreed;
+
+        // Playback state, only used by the calling thread
+        TexturePoolPtr mFrameTextures;
+        uint32_t mNextTexture = 0;
+        Texture::SharedPtr mpCurrentTexture;
+        int64_t mCurrentFrame = -1;
+
+        static const uint32_t kTextureCount = 2;
 
         // helper routines
-        void  bufferFrames();
         float rationalToFloat(const AVRational& r);
     };
-}
\ No newline at end of file
+}
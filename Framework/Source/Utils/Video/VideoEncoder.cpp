@@ -292,10 +292,8 @@ namespace Falcor
 
         mForamt = desc.format;
         mRowPitch = getInputFormatBytesPerPixel(desc.format) * desc.width;
-        if(desc.flipY)
-        {
-            mpFlippedImage = new uint8_t[desc.height * mRowPitch];
-        }
+        mHeight = desc.height;
+        mFlipY = desc.flipY;
 
         mpSwsContext = sws_getContext(desc.width, desc.height, getPictureFormatFromFalcorFormat(desc.format), desc.width, desc.height, mpCodecContext->pix_fmt, SWS_POINT, nullptr, nullptr, nullptr);
         if(mpSwsContext == nullptr)
@@ -356,31 +354,26 @@ namespace Falcor
             mpOutputContext = nullptr;
             mpOutputStream = nullptr;
         }
-        safe_delete(mpFlippedImage)
     }
 
-    void VideoEncoder::appendFrame(const void* pData)
+    void VideoEncoder::appendFrame(const void* pData, uint32_t rowPitch)
     {
-        if(mpFlippedImage)
-        {
-            // Flip the image
-            for(int32_t h = 0; h < mpCodecContext->height; h++)
-            {
-                const uint8_t* pSrc = (uint8_t*)pData + h * mRowPitch;
-                uint8_t* pDst = mpFlippedImage + (mpCodecContext->height - 1 - h) * mRowPitch;
-                memcpy(pDst, pSrc, mRowPitch);
-            }
-
-            pData = mpFlippedImage;
-        }
+        rowPitch = rowPitch ? rowPitch : mRowPitch;
 
         uint8_t* src[AV_NUM_DATA_POINTERS] = {0};
-        int32_t rowPitch[AV_NUM_DATA_POINTERS] = {0};
+        int32_t srcPitch[AV_NUM_DATA_POINTERS] = {0};
         src[0] = (uint8_t*)pData;
-        rowPitch[0] = (int32_t)mRowPitch;
+        srcPitch[0] = (int32_t)rowPitch;
+
+        if(mFlipY)
+        {
+            // Start at the last row and walk up
+            src[0] += (mHeight - 1) * rowPitch;
+            srcPitch[0] = -srcPitch[0];
+        }
 
         // Scale and convert the image
-        sws_scale(mpSwsContext, src, rowPitch, 0, mpCodecContext->height, mpFrame->data, mpFrame->linesize);
+        sws_scale(mpSwsContext, src, srcPitch, 0, mpCodecContext->height, mpFrame->data, mpFrame->linesize);
 
         // Encode the frame
         int r = avcodec_send_frame(mpCodecContext, mpFrame);
@@ -72,9 +72,22 @@ namespace Falcor
         ~VideoEncoder();
 
         static UniquePtr create(const Desc& desc);
-        void appendFrame(const void* pData);
+
+        /** Convert and encode a frame
+            \param[in] pData The image, in the Desc::format format
+            \param[in] rowPitch The distance in bytes between rows. 0 means tightly packed rows.
+        */
+        void appendFrame(const void* pData, uint32_t rowPitch = 0);
         void endCapture();
 
+        /** Get the size in bytes of a tightly packed input frame
+        */
+        uint32_t getFrameSize() const { return mRowPitch * mHeight; }
+
+        /** Get the size in bytes of a tightly packed input row
+        */
+        uint32_t getRowPitch() const { return mRowPitch; }
+
         static const std::string getSupportedContainerForCodec(CodecID codec);
     private:
         VideoEncoder(const std::string& filename);
@@ -89,6 +102,7 @@ namespace Falcor
         const std::string mFilename;
         InputFormat mForamt;
         uint32_t mRowPitch = 0;
-        uint8_t* mpFlippedImage = nullptr; // Used in case the image memory layout if bottom->top
+        uint32_t mHeight = 0;
+        bool mFlipY = false;    // The image memory layout is bottom->top. swscale reads it with a negative stride, so no copy is needed
     };
 }
\ No newline at end of file
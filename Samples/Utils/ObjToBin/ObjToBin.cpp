@@ -27,9 +27,10 @@
 ***************************************************************************/
 #include "ObjToBin.h"
 
-ObjToBin::ObjToBin(std::vector<std::string> objFiles)
+ObjToBin::ObjToBin(std::vector<std::string> objFiles, bool bakeTextures)
 {
     mObjFiles = objFiles;
+    mBakeTextures = bakeTextures;
 }
 
 void ObjToBin::convertObjToBin(const std::string& objFile)
@@ -51,7 +52,7 @@ void ObjToBin::convertObjToBin(const std::string& objFile)
         if (!Falcor::doesFileExist(binFilename))
         {
             printf("    Writing %s ...\n", binFilename.c_str());
-            pModel->exportToBinaryFile(binFilename);
+            pModel->exportToBinaryFile(binFilename, mBakeTextures ? &mBakeStats : nullptr);
         }
         else
         {
@@ -70,6 +71,11 @@ void ObjToBin::onLoad()
     {
         convertObjToBin(objFile);
     }
+
+    if (mBakeTextures)
+    {
+        printf("%s\n", mBakeStats.toString().c_str());
+    }
     shutdownApp();
 }
 
@@ -84,13 +90,21 @@ int main(int argc, char* argv[])
     if (argc >= 2)
     {
         std::vector<std::string> objFiles;
+        bool bakeTextures = false;
 
         for (int argi = 1; argi < argc; ++argi)
         {
-            objFiles.push_back(std::string(argv[argi]));
+            if (std::string(argv[argi]) == "-bake")
+            {
+                bakeTextures = true;
+            }
+            else
+            {
+                objFiles.push_back(std::string(argv[argi]));
+            }
         }
 
-        ObjToBin ObjToBin(objFiles);
+        ObjToBin ObjToBin(objFiles, bakeTextures);
         SampleConfig config;
         config.windowDesc.width = 256;
         config.windowDesc.height = 256;
@@ -99,6 +113,7 @@ int main(int argc, char* argv[])
     }
     else
     {
-        printf("Syntax: ObjToBin <list of obj files>\n");
+        printf("Syntax: ObjToBin [-bake] <list of obj files>\n");
+        printf("    -bake   Also bake the textures into block-compressed DDS files with precomputed mips\n");
     }
 }
\ No newline at end of file
@@ -36,10 +36,12 @@ public:
     void onLoad() override;
     void onShutdown() override;
 
-    ObjToBin(std::vector<std::string> objFiles);
+    ObjToBin(std::vector<std::string> objFiles, bool bakeTextures);
     void convertObjToBin(const std::string& objFile);
 private:
     inline void shutdown() {}
 
     std::vector<std::string> mObjFiles;
+    bool mBakeTextures = false;
+    TextureBaker::Stats mBakeStats;
 };
\ No newline at end of file
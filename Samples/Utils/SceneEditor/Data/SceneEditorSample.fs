@@ -29,12 +29,17 @@
 #include "Shading.h"
 #define _COMPILE_DEFAULT_VS
 #include "VertexAttrib.h"
+#ifdef _LIGHT_CLUSTERS
+#include "Framework/Shaders/LightClusters.hlsli"
+#endif
 
 cbuffer PerFrameCB
 {
+#ifndef _LIGHT_CLUSTERS
 #foreach p in _LIGHT_SOURCES
     LightData $(p);
 #endforeach
+#endif
 
     float3 gAmbient;
 };
@@ -48,9 +53,13 @@ vec4 main(VS_OUT vOut) : SV_TARGET
     result.finalValue = 0;
     float4 finalColor = 0;
 
+#ifdef _LIGHT_CLUSTERS
+    evalClusteredLights(shAttr, gCam.viewProjMat, result);
+#else
 #foreach p in _LIGHT_SOURCES
     evalMaterial(shAttr, $(p), result, $(_valIndex) == 0);
 #endforeach
+#endif
 
     finalColor = vec4(result.finalValue, 1.f);
 
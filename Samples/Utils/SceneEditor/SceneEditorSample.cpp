@@ -28,6 +28,9 @@
 #include "SceneEditorSample.h"
 #include "Graphics\Scene\SceneImporter.h"
 
+// BVHs let the editor pick objects on the CPU instead of through the GPU picker
+static const uint32_t kModelLoadFlags = Model::GenerateTangentSpace | Model::BuildBvh;
+
 void SceneEditorSample::onGuiRender()
 {
     mpGui->addSeparator();
@@ -40,6 +43,15 @@ void SceneEditorSample::onGuiRender()
     {
         loadScene();
     }
+    if(mpScene && mpGui->addCheckBox("Clustered Lighting", mUseLightClusters))
+    {
+        updateLightClusterer();
+        initShader();
+    }
+    if(mpLightClusterer && mUseLightClusters)
+    {
+        mpLightClusterer->renderUI(mpGui.get(), "Light Clusters");
+    }
     if(mpEditor)
     {
         mpEditor->renderGui(mpGui.get());
@@ -70,18 +82,32 @@ void SceneEditorSample::initNewScene()
     if(mpScene)
     {
         mpRenderer = SceneRenderer::create(mpScene);
-        mpEditor = SceneEditor::create(mpScene, Model::GenerateTangentSpace);
+        updateLightClusterer();
+        mpEditor = SceneEditor::create(mpScene, kModelLoadFlags);
 
         initShader();
     }
 }
 
+void SceneEditorSample::updateLightClusterer()
+{
+    if(mUseLightClusters && (mpLightClusterer == nullptr))
+    {
+        mpLightClusterer = LightClusterer::create();
+    }
+    mpRenderer->setLightClusterer(mUseLightClusters ? mpLightClusterer : nullptr);
+}
+
 void SceneEditorSample::initShader()
 {
     mpProgram = GraphicsProgram::createFromFile("", "SceneEditorSample.fs");
     std::string lights;
     getSceneLightString(mpScene.get(), lights);
     mpProgram->addDefine("_LIGHT_SOURCES", lights);
+    if(mUseLightClusters)
+    {
+        mpProgram->addDefine("_LIGHT_CLUSTERS");
+    }
     mpVars = GraphicsVars::create(mpProgram->getActiveVersion()->getReflector());
 }
 
@@ -92,7 +118,7 @@ void SceneEditorSample::loadScene()
     {
         reset();
 
-        mpScene = SceneImporter::loadScene(Filename, Model::GenerateTangentSpace, Scene::LoadMaterialHistory);
+        mpScene = SceneImporter::loadScene(Filename, kModelLoadFlags, Scene::LoadMaterialHistory);
         initNewScene();
     }
 }
@@ -128,7 +154,15 @@ void SceneEditorSample::onFrameRender()
 
         mpDefaultPipelineState->setBlendState(nullptr);
         mpDefaultPipelineState->setDepthStencilState(nullptr);
-        setSceneLightsIntoConstantBuffer(mpScene.get(), mpVars["PerFrameCB"].get());
+        if(mUseLightClusters)
+        {
+            // The renderer binds the lights through the clusters
+            mpVars["PerFrameCB"]["gAmbient"] = mpScene->getAmbientIntensity();
+        }
+        else
+        {
+            setSceneLightsIntoConstantBuffer(mpScene.get(), mpVars["PerFrameCB"].get());
+        }
         mpRenderContext->setGraphicsVars(mpVars);
         mpDefaultPipelineState->setProgram(mpProgram);
 
@@ -47,8 +47,10 @@ private:
     void reset();
     void initNewScene();
     void initShader();
+    void updateLightClusterer();
 
     bool mCameraLiveViewMode = false;
+    bool mUseLightClusters = false;
 
     uint32_t mScenePrevLightCount = 0;
 
@@ -57,4 +59,5 @@ private:
     SceneRenderer::UniquePtr mpRenderer = nullptr;
     SceneEditor::UniquePtr mpEditor = nullptr;
     GraphicsVars::SharedPtr mpVars = nullptr;
+    LightClusterer::SharedPtr mpLightClusterer = nullptr;
 };
@@ -0,0 +1,102 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "AsyncVideoEncoderTest.h"
+#include "Utils/Video/AsyncVideoEncoder.h"
+#include "Utils/OS.h"
+#include <cstdio>
+
+void AsyncVideoEncoderTest::addTests()
+{
+    addTestToList<TestBenchmarkWait>();
+    addTestToList<TestBenchmarkDropFrames>();
+}
+
+static const uint32_t kFrameCount = 120;
+
+/** Raw video, so the test doesn't depend on the codecs the FFmpeg build has
+*/
+static VideoEncoder::Desc createDesc(uint32_t width, uint32_t height)
+{
+    VideoEncoder::Desc desc;
+    desc.width = width;
+    desc.height = height;
+    desc.codec = VideoEncoder::CodecID::RawVideo;
+    desc.filename = getExecutableDirectory() + "\\AsyncVideoEncoderTest.avi";
+    return desc;
+}
+
+testing_func(AsyncVideoEncoderTest, TestBenchmarkWait)
+{
+    VideoEncoder::Desc desc = createDesc(1280, 720);
+    AsyncVideoEncoder::Stats stats = AsyncVideoEncoder::benchmark(desc, kFrameCount, 4, AsyncVideoEncoder::Backpressure::Wait);
+    std::remove(desc.filename.c_str());
+
+    if (stats.submittedFrames == 0)
+    {
+        return test_fail("Can't create the encoder");
+    }
+
+    // The caller waits for free buffers, so every frame is encoded
+    if (stats.submittedFrames != kFrameCount || stats.encodedFrames != kFrameCount || stats.droppedFrames != 0)
+    {
+        return test_fail("Frames were lost with the Wait policy");
+    }
+    return test_pass();
+}
+
+testing_func(AsyncVideoEncoderTest, TestBenchmarkDropFrames)
+{
+    // A single buffer, so the caller fills frames faster than the encoder frees them
+    VideoEncoder::Desc desc = createDesc(640, 360);
+    AsyncVideoEncoder::Stats stats = AsyncVideoEncoder::benchmark(desc, kFrameCount, 1, AsyncVideoEncoder::Backpressure::DropFrames);
+    std::remove(desc.filename.c_str());
+
+    if (stats.submittedFrames == 0)
+    {
+        return test_fail("Can't create the encoder");
+    }
+
+    // Every frame is either encoded or dropped, and the caller never stalls
+    if (stats.submittedFrames + stats.droppedFrames != kFrameCount || stats.encodedFrames != stats.submittedFrames)
+    {
+        return test_fail("Frames were neither encoded nor dropped");
+    }
+    if (stats.stalledFrames != 0)
+    {
+        return test_fail("The caller waited with the DropFrames policy");
+    }
+    return test_pass();
+}
+
+int main()
+{
+    AsyncVideoEncoderTest avet;
+    avet.init();
+    avet.run();
+    return 0;
+}
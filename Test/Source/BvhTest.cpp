@@ -0,0 +1,317 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "BvhTest.h"
+#include <random>
+
+void BvhTest::addTests()
+{
+    addTestToList<TestEmpty>();
+    addTestToList<TestTriangleHits>();
+    addTestToList<TestInstanceHits>();
+    addTestToList<TestRayCastPerformance>();
+}
+
+struct TestMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+
+    TriangleBvh::SharedPtr createBvh() const
+    {
+        return TriangleBvh::create(indices.data(), (uint32_t)indices.size(), positions.data(), sizeof(glm::vec3), (uint32_t)positions.size());
+    }
+};
+
+/** Random triangles of various sizes in the unit cube
+*/
+static TestMesh createTriangleSoup(uint32_t triangleCount, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> size(0.01f, 0.2f);
+    TestMesh mesh;
+    for (uint32_t t = 0; t < triangleCount; t++)
+    {
+        glm::vec3 center(position(rng), position(rng), position(rng));
+        float s = size(rng);
+        for (uint32_t v = 0; v < 3; v++)
+        {
+            mesh.indices.push_back((uint32_t)mesh.positions.size());
+            mesh.positions.push_back(center + s * glm::vec3(position(rng), position(rng), position(rng)));
+        }
+    }
+    return mesh;
+}
+
+/** A UV-sphere of radius 1
+*/
+static TestMesh createSphere(uint32_t rings, uint32_t segments)
+{
+    TestMesh mesh;
+    for (uint32_t r = 0; r <= rings; r++)
+    {
+        float theta = glm::pi<float>() * r / rings;
+        for (uint32_t s = 0; s <= segments; s++)
+        {
+            float phi = 2 * glm::pi<float>() * s / segments;
+            mesh.positions.push_back(glm::vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi)));
+        }
+    }
+    for (uint32_t r = 0; r < rings; r++)
+    {
+        for (uint32_t s = 0; s < segments; s++)
+        {
+            uint32_t i0 = r * (segments + 1) + s;
+            uint32_t i1 = i0 + segments + 1;
+            mesh.indices.insert(mesh.indices.end(), { i0, i1, i0 + 1, i0 + 1, i1, i1 + 1 });
+        }
+    }
+    return mesh;
+}
+
+/** Test every triangle. Same intersection test as TriangleBvh.
+*/
+static bool intersectBruteForce(const TestMesh& mesh, const glm::mat4& transform, const glm::vec3& origin, const glm::vec3& direction, TriangleBvh::Hit& hit)
+{
+    bool found = false;
+    for (uint32_t t = 0; t < mesh.indices.size() / 3; t++)
+    {
+        glm::vec3 v0 = glm::vec3(transform * glm::vec4(mesh.positions[mesh.indices[t * 3 + 0]], 1));
+        glm::vec3 e1 = glm::vec3(transform * glm::vec4(mesh.positions[mesh.indices[t * 3 + 1]], 1)) - v0;
+        glm::vec3 e2 = glm::vec3(transform * glm::vec4(mesh.positions[mesh.indices[t * 3 + 2]], 1)) - v0;
+        glm::vec3 p = glm::cross(direction, e2);
+        float det = glm::dot(e1, p);
+        if (det == 0)
+        {
+            continue;
+        }
+        glm::vec3 s = origin - v0;
+        float u = glm::dot(s, p) / det;
+        glm::vec3 q = glm::cross(s, e1);
+        float v = glm::dot(direction, q) / det;
+        float d = glm::dot(e2, q) / det;
+        if (u >= 0 && v >= 0 && u + v <= 1 && d >= 0 && d < hit.distance)
+        {
+            hit.triangle = t;
+            hit.barycentrics = glm::vec2(u, v);
+            hit.distance = d;
+            found = true;
+        }
+    }
+    return found;
+}
+
+static void createRandomRay(std::mt19937& rng, glm::vec3& origin, glm::vec3& direction)
+{
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    origin = glm::vec3(dist(rng), dist(rng), dist(rng)) * 3.0f;
+    glm::vec3 target = glm::vec3(dist(rng), dist(rng), dist(rng));
+    direction = target - origin;
+}
+
+static bool compareHits(bool found, bool expectedFound, float distance, float expectedDistance)
+{
+    // The BVH and the reference compute in different spaces, so the distances can differ by rounding
+    return (found == expectedFound) && (found == false || std::abs(distance - expectedDistance) <= 1e-4f * std::max(1.0f, expectedDistance));
+}
+
+testing_func(BvhTest, TestEmpty)
+{
+    if (TriangleBvh::create(nullptr, 0, nullptr, sizeof(glm::vec3), 0) != nullptr)
+    {
+        return test_fail("A BVH was created for a mesh without triangles");
+    }
+
+    // An out-of-range index must be rejected
+    const glm::vec3 positions[3] = {};
+    const uint32_t indices[3] = { 0, 1, 3 };
+    if (TriangleBvh::create(indices, 3, positions, sizeof(glm::vec3), 3) != nullptr)
+    {
+        return test_fail("A BVH was created for a mesh with an invalid index");
+    }
+
+    InstanceBvh::SharedPtr pInstances = InstanceBvh::create({});
+    InstanceBvh::Hit hit;
+    if (pInstances == nullptr || pInstances->intersect(glm::vec3(0), glm::vec3(0, 0, 1), FLT_MAX, hit))
+    {
+        return test_fail("An empty instance BVH reported a hit");
+    }
+
+    return test_pass();
+}
+
+testing_func(BvhTest, TestTriangleHits)
+{
+    std::mt19937 rng(1);
+    TestMesh mesh = createTriangleSoup(2000, rng);
+    TriangleBvh::SharedPtr pBvh = mesh.createBvh();
+    if (pBvh == nullptr || pBvh->getTriangleCount() != 2000)
+    {
+        return test_fail("Failed to create the BVH");
+    }
+
+    uint32_t hitCount = 0;
+    for (uint32_t i = 0; i < 2000; i++)
+    {
+        glm::vec3 origin, direction;
+        createRandomRay(rng, origin, direction);
+        TriangleBvh::Hit expected, hit;
+        bool expectedFound = intersectBruteForce(mesh, glm::mat4(), origin, direction, expected);
+        bool found = pBvh->intersect(origin, direction, FLT_MAX, hit);
+        if (compareHits(found, expectedFound, hit.distance, expected.distance) == false)
+        {
+            return test_fail("Ray " + std::to_string(i) + " doesn't match the brute-force result");
+        }
+        if (found && hit.triangle == expected.triangle && glm::length(hit.barycentrics - expected.barycentrics) > 1e-3f)
+        {
+            return test_fail("Ray " + std::to_string(i) + " has wrong barycentrics");
+        }
+        hitCount += found ? 1 : 0;
+
+        // A max distance in front of the closest hit hides it
+        if (found && pBvh->intersect(origin, direction, expected.distance * 0.5f, hit) && hit.distance < expected.distance * 0.99f)
+        {
+            return test_fail("Ray " + std::to_string(i) + " found a hit closer than the closest hit");
+        }
+    }
+
+    if (hitCount == 0)
+    {
+        return test_fail("No ray hit the mesh");
+    }
+    return test_pass();
+}
+
+testing_func(BvhTest, TestInstanceHits)
+{
+    std::mt19937 rng(2);
+    TestMesh mesh = createTriangleSoup(500, rng);
+    TriangleBvh::SharedPtr pBvh = mesh.createBvh();
+
+    std::vector<InstanceBvh::Instance> instances;
+    for (uint32_t i = 0; i < 20; i++)
+    {
+        glm::mat4 transform = glm::translate(glm::mat4(), glm::vec3((float)i - 10.0f, 0.0f, 0.0f) * 0.5f);
+        transform = glm::rotate(transform, (float)i, glm::normalize(glm::vec3(1, 2, 3)));
+        transform = glm::scale(transform, glm::vec3(0.5f + 0.05f * i));
+        instances.push_back({ transform, pBvh });
+    }
+    // Instances without a BVH or with a singular transform are skipped
+    instances.push_back({ glm::mat4(), nullptr });
+    instances.push_back({ glm::scale(glm::mat4(), glm::vec3(0)), pBvh });
+
+    InstanceBvh::SharedPtr pInstances = InstanceBvh::create(instances);
+    if (pInstances->getInstanceCount() != 20)
+    {
+        return test_fail("Wrong number of instances");
+    }
+
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        glm::vec3 origin, direction;
+        createRandomRay(rng, origin, direction);
+        origin.x *= 3.0f;
+
+        TriangleBvh::Hit expected;
+        uint32_t expectedInstance = 0;
+        bool expectedFound = false;
+        for (uint32_t j = 0; j < 20; j++)
+        {
+            if (intersectBruteForce(mesh, instances[j].transform, origin, direction, expected))
+            {
+                expectedInstance = j;
+                expectedFound = true;
+            }
+        }
+
+        InstanceBvh::Hit hit;
+        bool found = pInstances->intersect(origin, direction, FLT_MAX, hit);
+        if (compareHits(found, expectedFound, hit.distance, expected.distance) == false)
+        {
+            return test_fail("Ray " + std::to_string(i) + " doesn't match the brute-force result");
+        }
+        if (found && (hit.instance != expectedInstance || hit.triangle != expected.triangle) && std::abs(hit.distance - expected.distance) > 1e-4f)
+        {
+            return test_fail("Ray " + std::to_string(i) + " hit the wrong triangle");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(BvhTest, TestRayCastPerformance)
+{
+    const uint32_t kRayCount = 1000000;
+    TestMesh mesh = createSphere(256, 512);
+
+    auto start = CpuTimer::getCurrentTimePoint();
+    TriangleBvh::SharedPtr pBvh = mesh.createBvh();
+    double buildMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    // A grid of spheres, with rays shot across it
+    std::vector<InstanceBvh::Instance> instances;
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        instances.push_back({ glm::translate(glm::mat4(), glm::vec3((float)(i % 8), (float)(i / 8), 0.0f) * 2.5f), pBvh });
+    }
+    InstanceBvh::SharedPtr pInstances = InstanceBvh::create(instances);
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> dist(0.0f, 20.0f);
+    std::vector<glm::vec3> origins(kRayCount);
+    std::vector<glm::vec3> directions(kRayCount);
+    for (uint32_t i = 0; i < kRayCount; i++)
+    {
+        origins[i] = glm::vec3(dist(rng), dist(rng), -10.0f);
+        directions[i] = glm::vec3(dist(rng), dist(rng), 10.0f) - origins[i];
+    }
+
+    uint32_t hitCount = 0;
+    start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < kRayCount; i++)
+    {
+        InstanceBvh::Hit hit;
+        hitCount += pInstances->intersect(origins[i], directions[i], FLT_MAX, hit) ? 1 : 0;
+    }
+    double castMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    if (hitCount == 0)
+    {
+        return test_fail("No ray hit the scene");
+    }
+
+    logInfo("Bvh: " + std::to_string(pBvh->getTriangleCount()) + " triangles built in " + std::to_string(buildMs) + " ms, " + std::to_string(pBvh->getMemorySize() / 1024) + " KB. " +
+        std::to_string(kRayCount / (castMs * 1.0e-3) * 1.0e-6) + " Mrays/s on " + std::to_string(instances.size()) + " instances, " + std::to_string(hitCount) + " hits");
+    return test_pass();
+}
+
+int main()
+{
+    BvhTest bvht;
+    bvht.init();
+    bvht.run();
+    return 0;
+}
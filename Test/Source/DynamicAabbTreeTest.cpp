@@ -0,0 +1,411 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "DynamicAabbTreeTest.h"
+#include <random>
+
+void DynamicAabbTreeTest::addTests()
+{
+    addTestToList<TestEmpty>();
+    addTestToList<TestQueries>();
+    addTestToList<TestIncrementalUpdates>();
+    addTestToList<TestQueryThroughput>();
+}
+
+using Query = DynamicAabbTree::Query;
+using Hit = DynamicAabbTree::Hit;
+
+static BoundingBox createRandomBox(std::mt19937& rng, float worldSize, float maxSize)
+{
+    std::uniform_real_distribution<float> position(0.0f, worldSize);
+    std::uniform_real_distribution<float> size(0.0f, maxSize);
+    glm::vec3 center(position(rng), position(rng), position(rng));
+    glm::vec3 extent(size(rng), size(rng), size(rng));
+    return BoundingBox::fromMinMax(center - extent, center + extent);
+}
+
+static std::vector<Query> createRandomQueries(std::mt19937& rng, uint32_t count, float worldSize)
+{
+    std::uniform_real_distribution<float> position(0.0f, worldSize);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<Query> queries;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        glm::vec3 p(position(rng), position(rng), position(rng));
+        switch (i % 5)
+        {
+        case 0:
+            queries.push_back(Query::box(createRandomBox(rng, worldSize, worldSize * 0.02f)));
+            break;
+        case 1:
+            queries.push_back(Query::sphere(p, worldSize * 0.02f));
+            break;
+        case 2:
+        {
+            glm::vec3 target(position(rng), position(rng), position(rng));
+            glm::mat4 view = glm::lookAt(p, target, glm::vec3(0, 1, 0));
+            glm::mat4 proj = perspectiveMatrix(glm::radians(30.0f), 1.5f, worldSize * 0.001f, worldSize * 0.05f);
+            queries.push_back(Query::frustum(proj * view));
+            break;
+        }
+        case 3:
+            queries.push_back(Query::ray(p, glm::vec3(unit(rng), unit(rng), unit(rng)), (i & 8) ? FLT_MAX : 1.0f));
+            break;
+        default:
+            queries.push_back(Query::nearest(p, (i & 8) ? FLT_MAX : worldSize * 0.02f));
+            break;
+        }
+    }
+    return queries;
+}
+
+/** Run a query against every box. Uses the same tests as the tree.
+*/
+static std::vector<Hit> bruteForceQuery(const Query& query, const std::vector<std::pair<uint32_t, BoundingBox>>& boxes)
+{
+    std::vector<Hit> hits;
+    Hit nearest = { DynamicAabbTree::kInvalidProxy, 0, FLT_MAX };
+    float nearestLimit = (query.distance == FLT_MAX) ? FLT_MAX : query.distance * query.distance;
+    for (const auto& b : boxes)
+    {
+        glm::vec3 boxMin = b.second.getMinPos();
+        glm::vec3 boxMax = b.second.getMaxPos();
+        glm::vec3 d = glm::max(glm::max(boxMin - query.v0, query.v0 - boxMax), glm::vec3(0));
+        switch (query.type)
+        {
+        case Query::Type::Box:
+            if (glm::all(glm::lessThanEqual(boxMin, query.v1)) && glm::all(glm::lessThanEqual(query.v0, boxMax)))
+            {
+                hits.push_back({ b.first, 0, 0 });
+            }
+            break;
+        case Query::Type::Sphere:
+            if (glm::dot(d, d) <= query.distance * query.distance)
+            {
+                hits.push_back({ b.first, 0, 0 });
+            }
+            break;
+        case Query::Type::Frustum:
+        {
+            bool inside = glm::all(glm::lessThanEqual(boxMin, query.v1)) && glm::all(glm::lessThanEqual(query.v0, boxMax));
+            for (uint32_t p = 0; p < 6; p++)
+            {
+                glm::vec3 n(query.planes[p]);
+                inside = inside && (glm::dot(n, b.second.center) + query.planes[p].w + glm::dot(glm::abs(n), b.second.extent) >= 0);
+            }
+            if (inside)
+            {
+                hits.push_back({ b.first, 0, 0 });
+            }
+            break;
+        }
+        case Query::Type::Ray:
+        {
+            glm::vec3 invDir = 1.0f / query.v1;
+            glm::vec3 t0 = (boxMin - query.v0) * invDir;
+            glm::vec3 t1 = (boxMax - query.v0) * invDir;
+            glm::vec3 tNear = glm::min(t0, t1);
+            glm::vec3 tFar = glm::max(t0, t1);
+            float tEnter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+            float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, query.distance));
+            if (tEnter <= tExit)
+            {
+                hits.push_back({ b.first, 0, tEnter });
+            }
+            break;
+        }
+        case Query::Type::Nearest:
+            if (glm::dot(d, d) <= nearestLimit && glm::dot(d, d) < nearest.distance)
+            {
+                nearest = { b.first, 0, glm::dot(d, d) };
+            }
+            break;
+        }
+    }
+    if (nearest.proxyID != DynamicAabbTree::kInvalidProxy)
+    {
+        nearest.distance = sqrtf(nearest.distance);
+        hits.push_back(nearest);
+    }
+    return hits;
+}
+
+/** Compare the tree's hits with the brute-force hits. Nearest-proxy queries only compare the distance, since several boxes can be equally close.
+*/
+static bool compareHits(const Query& query, std::vector<Hit> hits, std::vector<Hit> expected)
+{
+    if (hits.size() != expected.size())
+    {
+        return false;
+    }
+    if (query.type == Query::Type::Nearest)
+    {
+        return hits.empty() || hits[0].distance == expected[0].distance;
+    }
+    if (query.type == Query::Type::Ray)
+    {
+        for (size_t i = 1; i < hits.size(); i++)
+        {
+            if (hits[i].distance < hits[i - 1].distance)
+            {
+                return false;
+            }
+        }
+    }
+
+    auto byID = [](const Hit& a, const Hit& b) { return a.proxyID < b.proxyID; };
+    std::sort(hits.begin(), hits.end(), byID);
+    std::sort(expected.begin(), expected.end(), byID);
+    for (size_t i = 0; i < hits.size(); i++)
+    {
+        if (hits[i].proxyID != expected[i].proxyID || hits[i].distance != expected[i].distance)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool checkQueries(const DynamicAabbTree* pTree, const std::vector<std::pair<uint32_t, BoundingBox>>& boxes, const std::vector<Query>& queries, std::string& error)
+{
+    for (size_t i = 0; i < queries.size(); i++)
+    {
+        std::vector<Hit> hits;
+        pTree->query(queries[i], hits);
+        if (compareHits(queries[i], hits, bruteForceQuery(queries[i], boxes)) == false)
+        {
+            error = "Query " + std::to_string(i) + " of type " + std::to_string((uint32_t)queries[i].type) + " doesn't match the brute-force result";
+            return false;
+        }
+    }
+    return true;
+}
+
+testing_func(DynamicAabbTreeTest, TestEmpty)
+{
+    DynamicAabbTree::SharedPtr pTree = DynamicAabbTree::create();
+    std::mt19937 rng(1);
+    for (const Query& q : createRandomQueries(rng, 10, 10.0f))
+    {
+        std::vector<Hit> hits;
+        if (pTree->query(q, hits) != 0 || hits.empty() == false)
+        {
+            return test_fail("Query on an empty tree returned hits");
+        }
+    }
+
+    uint32_t proxy = pTree->createProxy(BoundingBox::fromMinMax(glm::vec3(0), glm::vec3(1)), 7);
+    pTree->destroyProxy(proxy);
+    if (pTree->getProxyCount() != 0 || pTree->validate() == false)
+    {
+        return test_fail("Tree isn't empty after destroying its only proxy");
+    }
+    return test_pass();
+}
+
+testing_func(DynamicAabbTreeTest, TestQueries)
+{
+    const float kWorldSize = 100.0f;
+    std::mt19937 rng(2);
+    DynamicAabbTree::SharedPtr pTree = DynamicAabbTree::create();
+    std::vector<std::pair<uint32_t, BoundingBox>> boxes;
+    for (uint32_t i = 0; i < 5000; i++)
+    {
+        BoundingBox box = createRandomBox(rng, kWorldSize, (i % 100 == 0) ? 20.0f : 1.0f);
+        boxes.push_back({ pTree->createProxy(box, i), box });
+    }
+
+    if (pTree->validate() == false)
+    {
+        return test_fail("Tree structure is invalid");
+    }
+    for (uint32_t i = 0; i < boxes.size(); i++)
+    {
+        if (pTree->getUserData(boxes[i].first) != i)
+        {
+            return test_fail("Wrong user data");
+        }
+    }
+
+    std::vector<Query> queries = createRandomQueries(rng, 1000, kWorldSize);
+    std::string error;
+    if (checkQueries(pTree.get(), boxes, queries, error) == false)
+    {
+        return test_fail(error);
+    }
+
+    // The batched queries must return the same hits as the serial ones
+    std::vector<std::vector<Hit>> batchHits;
+    pTree->queryBatch(queries, batchHits);
+    for (size_t i = 0; i < queries.size(); i++)
+    {
+        std::vector<Hit> hits;
+        pTree->query(queries[i], hits);
+        if (batchHits[i].size() != hits.size() || std::equal(hits.begin(), hits.end(), batchHits[i].begin(), [](const Hit& a, const Hit& b) { return a.proxyID == b.proxyID; }) == false)
+        {
+            return test_fail("Batched query " + std::to_string(i) + " doesn't match the serial query");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(DynamicAabbTreeTest, TestIncrementalUpdates)
+{
+    const float kWorldSize = 100.0f;
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+    DynamicAabbTree::SharedPtr pTree = DynamicAabbTree::create();
+    std::vector<std::pair<uint32_t, BoundingBox>> boxes;
+
+    for (uint32_t round = 0; round < 20; round++)
+    {
+        // Add a few boxes, remove some, nudge most of them and teleport a few
+        for (uint32_t i = 0; i < 300; i++)
+        {
+            BoundingBox box = createRandomBox(rng, kWorldSize, 1.0f);
+            boxes.push_back({ pTree->createProxy(box, 0), box });
+        }
+        for (uint32_t i = 0; i < 100; i++)
+        {
+            size_t victim = rng() % boxes.size();
+            pTree->destroyProxy(boxes[victim].first);
+            boxes[victim] = boxes.back();
+            boxes.pop_back();
+        }
+        for (auto& b : boxes)
+        {
+            if (rng() % 50 == 0)
+            {
+                b.second = createRandomBox(rng, kWorldSize, 1.0f);
+            }
+            else
+            {
+                b.second.center += glm::vec3(jitter(rng), jitter(rng), jitter(rng));
+            }
+            pTree->moveProxy(b.first, b.second);
+        }
+
+        if (pTree->validate() == false || pTree->getProxyCount() != boxes.size())
+        {
+            return test_fail("Tree structure is invalid after round " + std::to_string(round));
+        }
+        for (const auto& b : boxes)
+        {
+            if (glm::any(glm::greaterThan(glm::abs(pTree->getBoundingBox(b.first).center - b.second.center), glm::vec3(1.0e-4f))))
+            {
+                return test_fail("Proxy box wasn't updated");
+            }
+        }
+
+        std::string error;
+        if (checkQueries(pTree.get(), boxes, createRandomQueries(rng, 100, kWorldSize), error) == false)
+        {
+            return test_fail(error + " after round " + std::to_string(round));
+        }
+    }
+
+    // A height-balanced tree
+    uint32_t height = pTree->getHeight();
+    if (height > 3 * (uint32_t)std::log2((float)boxes.size()))
+    {
+        return test_fail("Tree is unbalanced, height " + std::to_string(height) + " for " + std::to_string(boxes.size()) + " proxies");
+    }
+    return test_pass();
+}
+
+testing_func(DynamicAabbTreeTest, TestQueryThroughput)
+{
+    // A synthetic scene of a million instances with a few large ones, in a 10km cube
+    const uint32_t kInstanceCount = 1000000;
+    const uint32_t kQueryCount = 100000;
+    const float kWorldSize = 10000.0f;
+    std::mt19937 rng(4);
+    std::vector<BoundingBox> boxes(kInstanceCount);
+    for (uint32_t i = 0; i < kInstanceCount; i++)
+    {
+        boxes[i] = createRandomBox(rng, kWorldSize, (i % 1000 == 0) ? 200.0f : 5.0f);
+    }
+
+    DynamicAabbTree::SharedPtr pTree = DynamicAabbTree::create();
+    std::vector<uint32_t> proxies(kInstanceCount);
+    auto start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < kInstanceCount; i++)
+    {
+        proxies[i] = pTree->createProxy(boxes[i], i);
+    }
+    double buildMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    // Animate 10% of the instances by a small step, as an update would in a frame
+    std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+    uint32_t reinsertCount = 0;
+    start = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < kInstanceCount; i += 10)
+    {
+        boxes[i].center += glm::vec3(step(rng), step(rng), step(rng));
+        reinsertCount += pTree->moveProxy(proxies[i], boxes[i]) ? 1 : 0;
+    }
+    double updateMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::vector<Query> queries = createRandomQueries(rng, kQueryCount, kWorldSize);
+    uint64_t serialHits = 0;
+    start = CpuTimer::getCurrentTimePoint();
+    std::vector<Hit> hits;
+    for (const Query& q : queries)
+    {
+        hits.clear();
+        serialHits += pTree->query(q, hits);
+    }
+    double serialMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    std::vector<std::vector<Hit>> batchHits;
+    start = CpuTimer::getCurrentTimePoint();
+    pTree->queryBatch(queries, batchHits);
+    double batchMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+    uint64_t batchHitCount = 0;
+    for (const auto& h : batchHits)
+    {
+        batchHitCount += h.size();
+    }
+    if (batchHitCount != serialHits || serialHits == 0)
+    {
+        return test_fail("Batched queries returned " + std::to_string(batchHitCount) + " hits, serial queries " + std::to_string(serialHits));
+    }
+
+    logInfo("DynamicAabbTree: " + std::to_string(kInstanceCount) + " proxies inserted in " + std::to_string(buildMs) + " ms, height " + std::to_string(pTree->getHeight()) + ", " + std::to_string(pTree->getMemorySize() >> 20) + " MB. " +
+        std::to_string(kInstanceCount / 10) + " moves in " + std::to_string(updateMs) + " ms (" + std::to_string(reinsertCount) + " reinserted). " +
+        std::to_string(kQueryCount / (serialMs * 1.0e-3) * 1.0e-6) + " Mqueries/s serial, " + std::to_string(kQueryCount / (batchMs * 1.0e-3) * 1.0e-6) + " Mqueries/s batched, " + std::to_string(serialHits) + " hits");
+    return test_pass();
+}
+
+int main()
+{
+    DynamicAabbTreeTest datt;
+    datt.init();
+    datt.run();
+    return 0;
+}
@@ -0,0 +1,230 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "GeometryArenaTest.h"
+
+using RangeAllocator = GeometryArena::RangeAllocator;
+
+void GeometryArenaTest::addTests()
+{
+    addTestToList<TestAllocate>();
+    addTestToList<TestReleaseCoalescing>();
+    addTestToList<TestGrow>();
+    addTestToList<TestDefragment>();
+}
+
+testing_func(GeometryArenaTest, TestAllocate)
+{
+    RangeAllocator allocator;
+    allocator.reset(100);
+
+    // Allocations are first-fit, so they are placed back to back
+    uint32_t offsets[3];
+    const uint32_t counts[] = { 10, 30, 60 };
+    for (uint32_t i = 0; i < arraysize(counts); i++)
+    {
+        if (allocator.allocate(counts[i], offsets[i]) == false)
+        {
+            return test_fail("Allocation failed with enough free space");
+        }
+    }
+    if (offsets[0] != 0 || offsets[1] != 10 || offsets[2] != 40)
+    {
+        return test_fail("Allocations weren't placed back to back");
+    }
+    if (allocator.getFreeRangeCount() != 0)
+    {
+        return test_fail("A full allocator has free ranges");
+    }
+
+    uint32_t offset;
+    if (allocator.allocate(1, offset))
+    {
+        return test_fail("Allocation succeeded in a full allocator");
+    }
+
+    return test_pass();
+}
+
+testing_func(GeometryArenaTest, TestReleaseCoalescing)
+{
+    RangeAllocator allocator;
+    allocator.reset(100);
+
+    uint32_t offsets[5];
+    for (uint32_t i = 0; i < arraysize(offsets); i++)
+    {
+        allocator.allocate(20, offsets[i]);
+    }
+
+    // Releasing non-adjacent ranges leaves separate holes
+    allocator.release(offsets[1], 20);
+    allocator.release(offsets[3], 20);
+    if (allocator.getFreeRangeCount() != 2)
+    {
+        return test_fail("Non-adjacent ranges were merged");
+    }
+
+    // A hole is reused by an allocation which fits, and the remainder stays free
+    uint32_t offset;
+    if (allocator.allocate(15, offset) == false || offset != offsets[1])
+    {
+        return test_fail("Allocation didn't reuse the first hole");
+    }
+    allocator.release(offset, 15);
+
+    // Releasing the range between the holes merges all three
+    allocator.release(offsets[2], 20);
+    if (allocator.getFreeRangeCount() != 1)
+    {
+        return test_fail("Adjacent ranges weren't merged");
+    }
+    if (allocator.allocate(60, offset) == false || offset != offsets[1])
+    {
+        return test_fail("Merged range can't hold an allocation of its full size");
+    }
+    allocator.release(offset, 60);
+
+    // Releasing everything leaves a single range
+    allocator.release(offsets[0], 20);
+    allocator.release(offsets[4], 20);
+    if (allocator.getFreeRangeCount() != 1 || allocator.allocate(100, offset) == false || offset != 0)
+    {
+        return test_fail("Releasing every range didn't restore the full capacity");
+    }
+
+    return test_pass();
+}
+
+testing_func(GeometryArenaTest, TestGrow)
+{
+    RangeAllocator allocator;
+    allocator.reset(50);
+
+    uint32_t first, second;
+    allocator.allocate(30, first);
+    if (allocator.allocate(30, second))
+    {
+        return test_fail("Allocation succeeded without enough space");
+    }
+
+    // The free range at the end is extended, so the allocation fits right after the first one
+    allocator.grow(100);
+    if (allocator.getCapacity() != 100 || allocator.getFreeRangeCount() != 1)
+    {
+        return test_fail("Growing didn't extend the last free range");
+    }
+    if (allocator.allocate(30, second) == false || second != 30)
+    {
+        return test_fail("Allocation didn't use the grown space");
+    }
+
+    return test_pass();
+}
+
+testing_func(GeometryArenaTest, TestDefragment)
+{
+    RangeAllocator allocator;
+    allocator.reset(100);
+
+    struct Range
+    {
+        uint32_t offset;
+        uint32_t count;
+        bool live;
+    };
+    Range ranges[] = { { 0, 10, false }, { 0, 5, true }, { 0, 20, true }, { 0, 15, false }, { 0, 10, true }, { 0, 20, false }, { 0, 5, true } };
+    uint32_t liveCount = 0;
+    for (auto& range : ranges)
+    {
+        allocator.allocate(range.count, range.offset);
+        liveCount += range.live ? range.count : 0;
+    }
+    for (const auto& range : ranges)
+    {
+        if (range.live == false)
+        {
+            allocator.release(range.offset, range.count);
+        }
+    }
+
+    // An empty allocation sits at the start of a free range
+    uint32_t emptyOffset;
+    allocator.allocate(0, emptyOffset);
+
+    std::vector<RangeAllocator::Move> moves;
+    allocator.defragment(moves);
+
+    // The adjacent live ranges move as one run
+    if (moves.size() != 3)
+    {
+        return test_fail("Defragmenting produced the wrong number of moves");
+    }
+
+    // The live ranges are packed in their original order
+    uint32_t expectedOffset = 0;
+    for (const auto& range : ranges)
+    {
+        if (range.live)
+        {
+            if (RangeAllocator::remapOffset(moves, range.offset) != expectedOffset)
+            {
+                return test_fail("A live range wasn't packed in order");
+            }
+            expectedOffset += range.count;
+        }
+    }
+    if (RangeAllocator::remapOffset(moves, emptyOffset) > liveCount)
+    {
+        return test_fail("An empty allocation was remapped outside of the packed range");
+    }
+
+    // A single free range is left after the live data
+    uint32_t offset;
+    if (allocator.getFreeRangeCount() != 1 || allocator.allocate(100 - liveCount, offset) == false || offset != liveCount)
+    {
+        return test_fail("Defragmenting didn't leave a single free range at the end");
+    }
+
+    // Defragmenting a packed allocator moves nothing
+    allocator.release(offset, 100 - liveCount);
+    allocator.defragment(moves);
+    if (moves.size() != 1 || moves[0].srcOffset != 0 || moves[0].dstOffset != 0 || moves[0].count != liveCount)
+    {
+        return test_fail("Defragmenting a packed allocator moved data");
+    }
+
+    return test_pass();
+}
+
+int main()
+{
+    GeometryArenaTest gat;
+    gat.init();
+    gat.run();
+    return 0;
+}
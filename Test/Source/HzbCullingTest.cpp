@@ -0,0 +1,332 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "HzbCullingTest.h"
+#include <random>
+
+void HzbCullingTest::addTests()
+{
+    addTestToList<TestReferencePyramid>();
+    addTestToList<TestReferenceCulling>();
+    addTestToList<TestGpuPyramid>();
+    addTestToList<TestGpuCulling>();
+}
+
+static const uint32_t kDepthWidth = 317;
+static const uint32_t kDepthHeight = 155;
+
+/** Camera at (0, 0, 5), looking down -Z
+*/
+static glm::mat4 createViewProjMatrix()
+{
+    glm::mat4 view = glm::lookAt(glm::vec3(0, 0, 5), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+    glm::mat4 proj = perspectiveMatrix(glm::radians(60.0f), (float)kDepthWidth / (float)kDepthHeight, 0.1f, 1000.0f);
+    return proj * view;
+}
+
+/** Depth buffer of a wall at z = 0, covering [-2, 2] x [-1, 1]. The wall faces the camera, so its depth is constant.
+*/
+static std::vector<float> createWallDepth(const glm::mat4& viewProj)
+{
+    glm::vec4 minCorner = viewProj * glm::vec4(-2, -1, 0, 1);
+    glm::vec4 maxCorner = viewProj * glm::vec4(2, 1, 0, 1);
+    glm::vec3 minNdc = glm::vec3(minCorner) / minCorner.w;
+    glm::vec3 maxNdc = glm::vec3(maxCorner) / maxCorner.w;
+
+    std::vector<float> depth(kDepthWidth * kDepthHeight, 1.0f);
+    for (uint32_t y = 0; y < kDepthHeight; y++)
+    {
+        for (uint32_t x = 0; x < kDepthWidth; x++)
+        {
+            float ndcX = ((x + 0.5f) / kDepthWidth) * 2 - 1;
+            float ndcY = 1 - ((y + 0.5f) / kDepthHeight) * 2;
+            if ((ndcX >= minNdc.x) && (ndcX <= maxNdc.x) && (ndcY >= minNdc.y) && (ndcY <= maxNdc.y))
+            {
+                depth[y * kDepthWidth + x] = minNdc.z;
+            }
+        }
+    }
+    return depth;
+}
+
+/** Random depth, with a few far-plane pixels
+*/
+static std::vector<float> createRandomDepth(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<float> depth(kDepthWidth * kDepthHeight);
+    for (auto& d : depth)
+    {
+        d = (unit(rng) < 0.05f) ? 1.0f : 0.9f + 0.1f * unit(rng);
+    }
+    return depth;
+}
+
+static std::vector<BoundingBox> createRandomBoxes(std::mt19937& rng, uint32_t count)
+{
+    std::uniform_real_distribution<float> position(-6.0f, 6.0f);
+    std::uniform_real_distribution<float> depth(-30.0f, 6.0f);
+    std::uniform_real_distribution<float> size(0.01f, 1.5f);
+    std::vector<BoundingBox> boxes(count);
+    for (auto& box : boxes)
+    {
+        glm::vec3 minPos(position(rng), position(rng) * 0.5f, depth(rng));
+        box = BoundingBox::fromMinMax(minPos, minPos + glm::vec3(size(rng), size(rng), size(rng)));
+    }
+    return boxes;
+}
+
+/** Test a box against every depth pixel it covers
+    \return false if the box is behind all of them
+*/
+static bool isVisibleBruteForce(const std::vector<float>& depth, const BoundingBox& box, const glm::mat4& viewProj)
+{
+    glm::vec3 boxMin = box.getMinPos();
+    glm::vec3 boxMax = box.getMaxPos();
+    glm::vec2 minXY(FLT_MAX);
+    glm::vec2 maxXY(-FLT_MAX);
+    float minZ = FLT_MAX;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        glm::vec4 clip = viewProj * glm::vec4((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z, 1.0f);
+        if ((clip.w <= 1.0e-6f) || (clip.z < 0))
+        {
+            return true;
+        }
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        minXY = glm::min(minXY, glm::vec2(ndc));
+        maxXY = glm::max(maxXY, glm::vec2(ndc));
+        minZ = std::min(minZ, ndc.z);
+    }
+    if ((maxXY.x < -1) || (maxXY.y < -1) || (minXY.x > 1) || (minXY.y > 1))
+    {
+        return true;
+    }
+
+    uint32_t x0 = std::min((uint32_t)(glm::clamp(minXY.x * 0.5f + 0.5f, 0.0f, 1.0f) * kDepthWidth), kDepthWidth - 1);
+    uint32_t x1 = std::min((uint32_t)(glm::clamp(maxXY.x * 0.5f + 0.5f, 0.0f, 1.0f) * kDepthWidth), kDepthWidth - 1);
+    uint32_t y0 = std::min((uint32_t)(glm::clamp(-maxXY.y * 0.5f + 0.5f, 0.0f, 1.0f) * kDepthHeight), kDepthHeight - 1);
+    uint32_t y1 = std::min((uint32_t)(glm::clamp(-minXY.y * 0.5f + 0.5f, 0.0f, 1.0f) * kDepthHeight), kDepthHeight - 1);
+    for (uint32_t y = y0; y <= y1; y++)
+    {
+        for (uint32_t x = x0; x <= x1; x++)
+        {
+            if (minZ <= depth[y * kDepthWidth + x])
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+testing_func(HzbCullingTest, TestReferencePyramid)
+{
+    std::mt19937 rng(1);
+    std::vector<float> depth = createRandomDepth(rng);
+    HzbReference hzb;
+    hzb.build(depth.data(), kDepthWidth, kDepthHeight);
+
+    if ((hzb.getLevelCount() != HzbReference::calculateLevelCount(kDepthWidth, kDepthHeight)) || (hzb.getLevelWidth(0) != (kDepthWidth + 1) / 2) || (hzb.getLevelHeight(0) != (kDepthHeight + 1) / 2))
+    {
+        return test_fail("Wrong pyramid size");
+    }
+    const uint32_t lastLevel = hzb.getLevelCount() - 1;
+    if ((hzb.getLevelWidth(lastLevel) != 1) || (hzb.getLevelHeight(lastLevel) != 1))
+    {
+        return test_fail("The last level isn't 1x1");
+    }
+
+    // Every texel is the farthest depth of the pixels under it
+    for (uint32_t level = 0; level < hzb.getLevelCount(); level++)
+    {
+        const uint32_t footprint = 2 << level;
+        for (uint32_t y = 0; y < hzb.getLevelHeight(level); y++)
+        {
+            for (uint32_t x = 0; x < hzb.getLevelWidth(level); x++)
+            {
+                float maxDepth = 0;
+                for (uint32_t py = y * footprint; py < std::min((y + 1) * footprint, kDepthHeight); py++)
+                {
+                    for (uint32_t px = x * footprint; px < std::min((x + 1) * footprint, kDepthWidth); px++)
+                    {
+                        maxDepth = std::max(maxDepth, depth[py * kDepthWidth + px]);
+                    }
+                }
+                if (hzb.getDepth(level, x, y) != maxDepth)
+                {
+                    return test_fail("Wrong depth at level " + std::to_string(level) + ", texel (" + std::to_string(x) + ", " + std::to_string(y) + ")");
+                }
+            }
+        }
+    }
+    return test_pass();
+}
+
+testing_func(HzbCullingTest, TestReferenceCulling)
+{
+    const glm::mat4 viewProj = createViewProjMatrix();
+    std::vector<float> depth = createWallDepth(viewProj);
+    HzbReference hzb;
+    hzb.build(depth.data(), kDepthWidth, kDepthHeight);
+
+    struct Case
+    {
+        BoundingBox box;
+        bool visible;
+        const char* description;
+    };
+    const Case cases[] =
+    {
+        { BoundingBox::fromMinMax(glm::vec3(-1, -0.5f, -3), glm::vec3(1, 0.5f, -1)), false, "box behind the wall" },
+        { BoundingBox::fromMinMax(glm::vec3(-0.1f, -0.1f, -2), glm::vec3(0.1f, 0.1f, -1)), false, "small box behind the wall" },
+        { BoundingBox::fromMinMax(glm::vec3(-1, -0.5f, 1), glm::vec3(1, 0.5f, 2)), true, "box in front of the wall" },
+        { BoundingBox::fromMinMax(glm::vec3(1, -0.5f, -3), glm::vec3(4, 0.5f, -2)), true, "box partially behind the wall" },
+        { BoundingBox::fromMinMax(glm::vec3(-1, -1, 4), glm::vec3(1, 1, 6)), true, "box crossing the near plane" },
+        { BoundingBox::fromMinMax(glm::vec3(-1, -0.5f, -2000), glm::vec3(1, 0.5f, -1500)), false, "box beyond the far plane" },
+        { BoundingBox::fromMinMax(glm::vec3(100, -0.5f, -3), glm::vec3(101, 0.5f, -2)), true, "box outside of the screen" },
+    };
+    for (const auto& c : cases)
+    {
+        if (hzb.isVisible(c.box, viewProj) != c.visible)
+        {
+            return test_fail(std::string("Wrong visibility for the ") + c.description);
+        }
+    }
+
+    // The pyramid is conservative: boxes it hides are hidden behind every pixel they cover
+    std::mt19937 rng(2);
+    const uint32_t kBoxCount = 100000;
+    std::vector<BoundingBox> boxes = createRandomBoxes(rng, kBoxCount);
+    auto startTime = CpuTimer::getCurrentTimePoint();
+    std::vector<uint32_t> visible;
+    hzb.testVisibility(boxes, viewProj, visible);
+    double testMs = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+    uint32_t hiddenCount = 0;
+    uint32_t bruteForceHiddenCount = 0;
+    for (uint32_t i = 0; i < kBoxCount; i++)
+    {
+        bool bruteForceVisible = isVisibleBruteForce(depth, boxes[i], viewProj);
+        if ((visible[i] == 0) && bruteForceVisible)
+        {
+            return test_fail("A visible box was hidden");
+        }
+        hiddenCount += (visible[i] == 0) ? 1 : 0;
+        bruteForceHiddenCount += bruteForceVisible ? 0 : 1;
+    }
+    if (hiddenCount == 0)
+    {
+        return test_fail("No box was hidden");
+    }
+
+    logInfo("HzbReference: " + std::to_string(kBoxCount) + " boxes tested in " + std::to_string(testMs) + " ms, " + std::to_string(hiddenCount) + " hidden, " + std::to_string(bruteForceHiddenCount) + " hidden per pixel");
+    return test_pass();
+}
+
+testing_func(HzbCullingTest, TestGpuPyramid)
+{
+    std::mt19937 rng(3);
+    std::vector<float> depth = createRandomDepth(rng);
+    HzbReference reference;
+    reference.build(depth.data(), kDepthWidth, kDepthHeight);
+
+    RenderContext* pContext = gpDevice->getRenderContext().get();
+    Texture::SharedPtr pDepth = Texture::create2D(kDepthWidth, kDepthHeight, ResourceFormat::R32Float, 1, 1, depth.data(), Resource::BindFlags::ShaderResource);
+    HierarchicalZ::UniquePtr pHzb = HierarchicalZ::create(kDepthWidth, kDepthHeight);
+    pHzb->build(pContext, pDepth);
+
+    if (pHzb->getLevelCount() != reference.getLevelCount())
+    {
+        return test_fail("Wrong number of levels");
+    }
+
+    // The reduction only selects values, so the levels match exactly
+    const Texture* pTexture = pHzb->getTexture().get();
+    for (uint32_t level = 0; level < pHzb->getLevelCount(); level++)
+    {
+        std::vector<uint8> data = pContext->readTextureSubresource(pTexture, pTexture->getSubresourceIndex(0, level));
+        const std::vector<float>& expected = reference.getLevel(level);
+        if ((data.size() != expected.size() * sizeof(float)) || (memcmp(data.data(), expected.data(), data.size()) != 0))
+        {
+            return test_fail("Level " + std::to_string(level) + " doesn't match the reference");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(HzbCullingTest, TestGpuCulling)
+{
+    const glm::mat4 viewProj = createViewProjMatrix();
+    std::mt19937 rng(4);
+    std::vector<float> depth = createWallDepth(viewProj);
+    std::vector<BoundingBox> boxes = createRandomBoxes(rng, 10000);
+
+    HzbReference reference;
+    reference.build(depth.data(), kDepthWidth, kDepthHeight);
+    std::vector<uint32_t> expected;
+    reference.testVisibility(boxes, viewProj, expected);
+
+    // With a latency of 2, the results of the first call are returned after the third one
+    RenderContext* pContext = gpDevice->getRenderContext().get();
+    Texture::SharedPtr pDepth = Texture::create2D(kDepthWidth, kDepthHeight, ResourceFormat::R32Float, 1, 1, depth.data(), Resource::BindFlags::ShaderResource);
+    HzbCulling::SharedPtr pCulling = HzbCulling::create(2);
+    pCulling->buildHzb(pContext, pDepth, viewProj);
+    pCulling->cull(pContext, boxes);
+    if (pCulling->readVisibility().empty() == false)
+    {
+        return test_fail("Results were returned before the readback latency");
+    }
+    pCulling->cull(pContext, std::vector<BoundingBox>(boxes.begin(), boxes.begin() + 10));
+    pCulling->readVisibility();
+    pCulling->cull(pContext, std::vector<BoundingBox>(boxes.begin(), boxes.begin() + 20));
+    const std::vector<uint32_t>& visible = pCulling->readVisibility();
+    if (visible.size() != boxes.size())
+    {
+        return test_fail("Wrong number of results");
+    }
+
+    // Corners which project exactly on a pixel edge can round differently on the GPU
+    uint32_t mismatchCount = 0;
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        mismatchCount += (visible[i] != expected[i]) ? 1 : 0;
+    }
+    if (mismatchCount > boxes.size() / 1000)
+    {
+        return test_fail(std::to_string(mismatchCount) + " boxes don't match the reference");
+    }
+    return test_pass();
+}
+
+int main()
+{
+    HzbCullingTest hct;
+    hct.init(true);
+    hct.run();
+    return 0;
+}
@@ -0,0 +1,196 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "IndirectDrawPackerTest.h"
+
+void IndirectDrawPackerTest::addTests()
+{
+    addTestToList<TestEmpty>();
+    addTestToList<TestBatching>();
+    addTestToList<TestArguments>();
+    addTestToList<TestPackingPerformance>();
+}
+
+static glm::mat4 makeTransform(uint32_t id)
+{
+    glm::mat4 m;
+    m[3][0] = (float)id;
+    return m;
+}
+
+static uint32_t getTransformID(const glm::mat4& m)
+{
+    return (uint32_t)m[3][0];
+}
+
+testing_func(IndirectDrawPackerTest, TestEmpty)
+{
+    IndirectDrawPacker packer;
+    packer.pack();
+    if (packer.getDrawArguments().size() != 0 || packer.getBatches().size() != 0 || packer.getTransforms().size() != 0)
+    {
+        return test_fail("Packing no instances produced draws");
+    }
+
+    return test_pass();
+}
+
+testing_func(IndirectDrawPackerTest, TestBatching)
+{
+    IndirectDrawPacker packer;
+    IndirectDrawPacker::Geometry geometry;
+    geometry.indexCount = 3;
+
+    // Interleave 2 batches with 2 geometries each. The transform ID is the order the instance was added in.
+    const uint32_t batchIDs[] = { 1, 0, 1, 0, 1, 1, 0 };
+    const uint32_t geometryIDs[] = { 5, 2, 4, 2, 5, 4, 3 };
+    for (uint32_t i = 0; i < arraysize(batchIDs); i++)
+    {
+        packer.addInstance(batchIDs[i], geometryIDs[i], geometry, makeTransform(i));
+    }
+    packer.pack();
+
+    const auto& batches = packer.getBatches();
+    const auto& draws = packer.getDrawArguments();
+    const auto& transforms = packer.getTransforms();
+    if (batches.size() != 2 || draws.size() != 4 || transforms.size() != arraysize(batchIDs))
+    {
+        return test_fail("Wrong number of batches, draws or transforms");
+    }
+
+    if (batches[0].batchID != 0 || batches[0].firstDraw != 0 || batches[0].drawCount != 2 || batches[0].instanceCount != 3 ||
+        batches[1].batchID != 1 || batches[1].firstDraw != 2 || batches[1].drawCount != 2 || batches[1].instanceCount != 4)
+    {
+        return test_fail("Batches don't match the instances");
+    }
+
+    // Batch 0: geometry 2 (instances 1, 3), geometry 3 (instance 6). Batch 1: geometry 4 (instances 2, 5), geometry 5 (instances 0, 4).
+    const uint32_t expectedInstanceCounts[] = { 2, 1, 2, 2 };
+    const uint32_t expectedTransforms[] = { 1, 3, 6, 2, 5, 0, 4 };
+    uint32_t startInstance = 0;
+    for (uint32_t i = 0; i < draws.size(); i++)
+    {
+        if (draws[i].instanceCount != expectedInstanceCounts[i] || draws[i].startInstanceLocation != startInstance)
+        {
+            return test_fail("Draw " + std::to_string(i) + " has the wrong instance range");
+        }
+        startInstance += draws[i].instanceCount;
+    }
+
+    for (uint32_t i = 0; i < transforms.size(); i++)
+    {
+        if (getTransformID(transforms[i]) != expectedTransforms[i])
+        {
+            return test_fail("Transforms are not in draw order");
+        }
+    }
+
+    // Clearing keeps nothing for the next frame
+    packer.clear();
+    packer.pack();
+    if (packer.getInstanceCount() != 0 || packer.getDrawArguments().size() != 0)
+    {
+        return test_fail("clear() didn't remove the instances");
+    }
+
+    return test_pass();
+}
+
+testing_func(IndirectDrawPackerTest, TestArguments)
+{
+    IndirectDrawPacker packer;
+    IndirectDrawPacker::Geometry geometry;
+    geometry.indexCount = 36;
+    geometry.startIndex = 120;
+    geometry.baseVertex = -8;
+
+    packer.addInstance(0, 0, geometry, makeTransform(0));
+    packer.addInstance(0, 0, geometry, makeTransform(1));
+    packer.pack();
+
+    const auto& draws = packer.getDrawArguments();
+    if (draws.size() != 1)
+    {
+        return test_fail("Instances of the same geometry weren't merged into one draw");
+    }
+
+    const IndirectDrawPacker::DrawArguments& args = draws[0];
+    if (args.indexCount != 36 || args.instanceCount != 2 || args.startIndexLocation != 120 || args.baseVertexLocation != -8 || args.startInstanceLocation != 0)
+    {
+        return test_fail("Draw arguments don't match the geometry");
+    }
+
+    return test_pass();
+}
+
+testing_func(IndirectDrawPackerTest, TestPackingPerformance)
+{
+    const uint32_t kBatchCount = 1000;
+    const uint32_t kGeometriesPerBatch = 4;
+    const uint32_t kInstanceCount = 100000;
+    const uint32_t kFrameCount = 10;
+
+    IndirectDrawPacker packer;
+    IndirectDrawPacker::Geometry geometry;
+    geometry.indexCount = 3;
+
+    // Pack the same scene for a few frames, like SceneRenderer does, and report the average cost
+    float totalMs = 0;
+    for (uint32_t frame = 0; frame < kFrameCount; frame++)
+    {
+        packer.clear();
+        auto start = CpuTimer::getCurrentTimePoint();
+        for (uint32_t i = 0; i < kInstanceCount; i++)
+        {
+            uint32_t hash = i * 2654435761u;
+            packer.addInstance(hash % kBatchCount, (hash / kBatchCount) % kGeometriesPerBatch, geometry, makeTransform(i));
+        }
+        packer.pack();
+        totalMs += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+    }
+
+    uint32_t instanceCount = 0;
+    for (const auto& batch : packer.getBatches())
+    {
+        instanceCount += batch.instanceCount;
+    }
+    if (instanceCount != kInstanceCount || packer.getBatches().size() != kBatchCount || packer.getDrawArguments().size() > kBatchCount * kGeometriesPerBatch)
+    {
+        return test_fail("Packing lost instances");
+    }
+
+    logInfo("IndirectDrawPacker: " + std::to_string(kInstanceCount) + " instances in " + std::to_string(totalMs / kFrameCount) + " ms per frame");
+    return test_pass();
+}
+
+int main()
+{
+    IndirectDrawPackerTest idpt;
+    idpt.init();
+    idpt.run();
+    return 0;
+}
@@ -0,0 +1,120 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "InstanceTransformStoreTest.h"
+#include "Graphics/Model/InstanceTransformStore.h"
+#include <set>
+
+void InstanceTransformStoreTest::addTests()
+{
+    addTestToList<TestFillStore>();
+    addTestToList<TestCapacity>();
+}
+
+testing_func(InstanceTransformStoreTest, TestFillStore)
+{
+    const uint32_t capacity = 2 * InstanceTransformStore::kChunkSize;
+    InstanceTransformStore::SharedPtr pStore = InstanceTransformStore::create(capacity);
+    if (pStore == nullptr)
+    {
+        return test_fail("Can't create the store");
+    }
+
+    std::set<uint32_t> slots;
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        uint32_t slot = pStore->allocate(nullptr);
+        if (slot == InstanceTransformStore::kInvalidSlot || slot >= capacity)
+        {
+            return test_fail("Allocation failed before the store was full");
+        }
+        slots.insert(slot);
+    }
+    if (slots.size() != capacity || pStore->getSlotCount() != capacity)
+    {
+        return test_fail("A slot was handed out twice");
+    }
+
+    // A full store reports the failure instead of handing out a slot past its chunks
+    if (pStore->allocate(nullptr) != InstanceTransformStore::kInvalidSlot)
+    {
+        return test_fail("Allocation succeeded in a full store");
+    }
+    if (pStore->getSlotCount() != capacity)
+    {
+        return test_fail("A failed allocation changed the slot count");
+    }
+
+    // Releasing the invalid slot, like the destructor of an instance which didn't get a slot, does nothing
+    pStore->release(InstanceTransformStore::kInvalidSlot);
+    if (pStore->getSlotCount() != capacity)
+    {
+        return test_fail("Releasing the invalid slot changed the slot count");
+    }
+
+    // A released slot can be allocated again
+    const uint32_t released = capacity / 3;
+    pStore->release(released);
+    if (pStore->allocate(nullptr) != released)
+    {
+        return test_fail("The released slot wasn't reused");
+    }
+
+    return test_pass();
+}
+
+testing_func(InstanceTransformStoreTest, TestCapacity)
+{
+    if (InstanceTransformStore::create(0) != nullptr)
+    {
+        return test_fail("Created a store without slots");
+    }
+
+    // The capacity is rounded up to whole chunks
+    InstanceTransformStore::SharedPtr pStore = InstanceTransformStore::create(1);
+    for (uint32_t i = 0; i < InstanceTransformStore::kChunkSize; i++)
+    {
+        if (pStore->allocate(nullptr) == InstanceTransformStore::kInvalidSlot)
+        {
+            return test_fail("The capacity wasn't rounded up to a chunk");
+        }
+    }
+    if (pStore->allocate(nullptr) != InstanceTransformStore::kInvalidSlot)
+    {
+        return test_fail("Allocation succeeded past the capacity");
+    }
+
+    return test_pass();
+}
+
+int main()
+{
+    InstanceTransformStoreTest itst;
+    itst.init();
+    itst.run();
+    return 0;
+}
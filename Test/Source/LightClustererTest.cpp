@@ -0,0 +1,258 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LightClustererTest.h"
+#include "Graphics/LightClusterer.h"
+#include <random>
+
+void LightClustererTest::addTests()
+{
+    addTestToList<TestSimdMatchesScalar>();
+    addTestToList<TestLightPlacement>();
+    addTestToList<TestDroppedIndices>();
+    addTestToList<TestBinningThroughput>();
+}
+
+static const float kNearZ = 0.1f;
+static const float kFarZ = 200.0f;
+
+static glm::mat4 createProjMatrix()
+{
+    return perspectiveMatrix(glm::radians(60.0f), 16.0f / 9.0f, kNearZ, kFarZ);
+}
+
+/** Random lights in front of the camera. Some of them cross the near plane or the side planes of the frustum.
+*/
+static std::vector<LightClusterer::LightBounds> createRandomLights(std::mt19937& rng, uint32_t count, float maxRadius)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<LightClusterer::LightBounds> lights(count);
+    for (auto& light : lights)
+    {
+        float depth = 150.0f * unit(rng);
+        light.center = glm::vec3((unit(rng) * 2 - 1) * depth, (unit(rng) * 2 - 1) * depth * 0.6f, -depth);
+        light.radius = maxRadius * unit(rng);
+    }
+    return lights;
+}
+
+/** Squared distance from a sphere center to a cluster box, computed the way the SIMD test computes it
+*/
+static float calcDistance2(const LightClusterer::LightBounds& light, const glm::vec3& minPos, const glm::vec3& maxPos)
+{
+    float dx = max(max(minPos.x - light.center.x, light.center.x - maxPos.x), 0.0f);
+    float dy = max(max(minPos.y - light.center.y, light.center.y - maxPos.y), 0.0f);
+    float dz = max(max(minPos.z - light.center.z, light.center.z - maxPos.z), 0.0f);
+    return (dx * dx + dy * dy) + dz * dz;
+}
+
+/** Scalar reference of the binning. Fills the list of lights of each cluster, in light order.
+*/
+static void binLightsScalar(const LightClusterer* pClusterer, const std::vector<LightClusterer::LightBounds>& lights, std::vector<std::vector<uint32_t>>& clusterLights)
+{
+    clusterLights.resize(pClusterer->getClusterCount());
+    for (uint32_t c = 0; c < pClusterer->getClusterCount(); c++)
+    {
+        glm::vec3 minPos, maxPos;
+        pClusterer->getClusterBounds(c, minPos, maxPos);
+        clusterLights[c].clear();
+        for (uint32_t l = 0; l < (uint32_t)lights.size(); l++)
+        {
+            const auto& light = lights[l];
+            if ((light.radius > 0) && (calcDistance2(light, minPos, maxPos) <= light.radius * light.radius))
+            {
+                clusterLights[c].push_back(l);
+            }
+        }
+    }
+}
+
+testing_func(LightClustererTest, TestSimdMatchesScalar)
+{
+    std::mt19937 rng(1);
+    std::vector<LightClusterer::LightBounds> lights = createRandomLights(rng, 2000, 10.0f);
+    lights[0].radius = 0;   // Not binned
+
+    // Large clusters, so nothing is dropped
+    LightClusterer::SharedPtr pClusterer = LightClusterer::create(16, 8, 24, 2048);
+    pClusterer->binLights(createProjMatrix(), kNearZ, kFarZ, lights);
+    if (pClusterer->getStats().droppedIndexCount != 0)
+    {
+        return test_fail("Light indices were dropped");
+    }
+
+    std::vector<std::vector<uint32_t>> expected;
+    binLightsScalar(pClusterer.get(), lights, expected);
+
+    uint32_t expectedIndexCount = 0;
+    for (uint32_t c = 0; c < pClusterer->getClusterCount(); c++)
+    {
+        uint32_t count;
+        const uint32_t* pLights = pClusterer->getClusterLights(c, count);
+        expectedIndexCount += (uint32_t)expected[c].size();
+
+        // The lists are built in light order. A light which touches a cluster within rounding can be found by one test and not by the other.
+        glm::vec3 minPos, maxPos;
+        pClusterer->getClusterBounds(c, minPos, maxPos);
+        size_t e = 0;
+        for (uint32_t i = 0; (i < count) || (e < expected[c].size());)
+        {
+            uint32_t simdLight = (i < count) ? pLights[i] : UINT32_MAX;
+            uint32_t scalarLight = (e < expected[c].size()) ? expected[c][e] : UINT32_MAX;
+            if (simdLight == scalarLight)
+            {
+                i++;
+                e++;
+                continue;
+            }
+
+            uint32_t l = min(simdLight, scalarLight);
+            float r2 = lights[l].radius * lights[l].radius;
+            if (std::abs(calcDistance2(lights[l], minPos, maxPos) - r2) > r2 * 1e-5f)
+            {
+                return test_fail("Cluster " + std::to_string(c) + " doesn't match the scalar reference for light " + std::to_string(l));
+            }
+            (l == simdLight) ? i++ : e++;
+        }
+    }
+
+    if (pClusterer->getStats().indexCount == 0 || pClusterer->getStats().binnedLightCount >= (uint32_t)lights.size())
+    {
+        return test_fail("Wrong statistics");
+    }
+    logInfo("LightClusterer: " + std::to_string(pClusterer->getStats().indexCount) + " light indices, " + std::to_string(expectedIndexCount) + " in the scalar reference");
+    return test_pass();
+}
+
+testing_func(LightClustererTest, TestLightPlacement)
+{
+    LightClusterer::SharedPtr pClusterer = LightClusterer::create(16, 8, 24, 64);
+
+    // A small light in the middle of a cluster is found in that cluster. The cluster boxes bound frustum-shaped cells, so they overlap their direct neighbors, but no other cluster.
+    std::vector<LightClusterer::LightBounds> lights(1);
+    pClusterer->binLights(createProjMatrix(), kNearZ, kFarZ, lights);
+    const uint32_t cluster = pClusterer->getClusterIndex(11, 2, 17);
+    glm::vec3 minPos, maxPos;
+    pClusterer->getClusterBounds(cluster, minPos, maxPos);
+    lights[0].center = (minPos + maxPos) * 0.5f;
+    lights[0].radius = 0.01f;
+    pClusterer->binLights(createProjMatrix(), kNearZ, kFarZ, lights);
+
+    uint32_t count;
+    pClusterer->getClusterLights(cluster, count);
+    if (count != 1)
+    {
+        return test_fail("The light wasn't binned into its cluster");
+    }
+    for (uint32_t z = 0; z < 24; z++)
+    {
+        for (uint32_t y = 0; y < 8; y++)
+        {
+            for (uint32_t x = 0; x < 16; x++)
+            {
+                bool isNeighbor = (abs(int(x) - 11) <= 1) && (abs(int(y) - 2) <= 1) && (abs(int(z) - 17) <= 1);
+                pClusterer->getClusterLights(pClusterer->getClusterIndex(x, y, z), count);
+                if ((count != 0) && (isNeighbor == false))
+                {
+                    return test_fail("The light was binned into cluster (" + std::to_string(x) + ", " + std::to_string(y) + ", " + std::to_string(z) + ")");
+                }
+            }
+        }
+    }
+
+    // The clusters tile the frustum. Neighbors share their faces.
+    glm::vec3 nextMin, nextMax;
+    pClusterer->getClusterBounds(pClusterer->getClusterIndex(11, 2, 18), nextMin, nextMax);
+    if (nextMax.z != minPos.z)
+    {
+        return test_fail("Depth slices don't share their boundaries");
+    }
+    return test_pass();
+}
+
+testing_func(LightClustererTest, TestDroppedIndices)
+{
+    // Many lights covering the same area overflow the clusters
+    std::vector<LightClusterer::LightBounds> lights(100);
+    for (auto& light : lights)
+    {
+        light.center = glm::vec3(0, 0, -20);
+        light.radius = 5.0f;
+    }
+
+    LightClusterer::SharedPtr pLarge = LightClusterer::create(16, 8, 24, 128);
+    pLarge->binLights(createProjMatrix(), kNearZ, kFarZ, lights);
+    LightClusterer::SharedPtr pSmall = LightClusterer::create(16, 8, 24, 8);
+    pSmall->binLights(createProjMatrix(), kNearZ, kFarZ, lights);
+
+    const auto& stats = pSmall->getStats();
+    if ((stats.droppedIndexCount == 0) || (stats.maxLightsPerCluster != 8))
+    {
+        return test_fail("The cluster capacity wasn't enforced");
+    }
+    if (stats.indexCount + stats.droppedIndexCount != pLarge->getStats().indexCount)
+    {
+        return test_fail("Dropped indices weren't counted");
+    }
+    return test_pass();
+}
+
+testing_func(LightClustererTest, TestBinningThroughput)
+{
+    const uint32_t kIterationCount = 20;
+    LightClusterer::SharedPtr pClusterer = LightClusterer::create(16, 8, 24, 256);
+    const glm::mat4 projMat = createProjMatrix();
+
+    for (uint32_t lightCount : {256u, 1024u, 4096u})
+    {
+        std::mt19937 rng(lightCount);
+        std::vector<LightClusterer::LightBounds> lights = createRandomLights(rng, lightCount, 5.0f);
+
+        double binMs = 0;
+        for (uint32_t i = 0; i < kIterationCount; i++)
+        {
+            pClusterer->binLights(projMat, kNearZ, kFarZ, lights);
+            binMs += pClusterer->getStats().binningTime;
+        }
+
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        std::vector<std::vector<uint32_t>> clusterLights;
+        binLightsScalar(pClusterer.get(), lights, clusterLights);
+        double scalarMs = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+        logInfo("LightClusterer: " + std::to_string(lightCount) + " lights binned in " + std::to_string(binMs / kIterationCount) + " ms (" + std::to_string(pClusterer->getStats().indexCount) + " indices), scalar single-threaded reference " + std::to_string(scalarMs) + " ms");
+    }
+    return test_pass();
+}
+
+int main()
+{
+    LightClustererTest lct;
+    lct.init();
+    lct.run();
+    return 0;
+}
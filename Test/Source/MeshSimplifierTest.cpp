@@ -0,0 +1,326 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "MeshSimplifierTest.h"
+#include "Graphics/Model/MeshSimplifier.h"
+#include "Utils/OS.h"
+#include <cstdio>
+#include <fstream>
+
+void MeshSimplifierTest::addTests()
+{
+    addTestToList<TestLodChain>();
+    addTestToList<TestSmallMesh>();
+    addTestToList<TestBinaryRoundTrip>();
+    addTestToList<TestStoredEmptyLodChain>();
+}
+
+struct TestMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+};
+
+/** A sphere of radius 1 which shares the vertices at the poles and along the seam, so it has no open edges and every vertex can be collapsed
+*/
+static TestMesh createClosedSphere(uint32_t rings, uint32_t segments)
+{
+    TestMesh mesh;
+    mesh.positions.push_back(glm::vec3(0, 1, 0));
+    for (uint32_t r = 1; r < rings; r++)
+    {
+        float theta = glm::pi<float>() * r / rings;
+        for (uint32_t s = 0; s < segments; s++)
+        {
+            float phi = 2 * glm::pi<float>() * s / segments;
+            mesh.positions.push_back(glm::vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi)));
+        }
+    }
+    mesh.positions.push_back(glm::vec3(0, -1, 0));
+
+    const uint32_t bottom = (uint32_t)mesh.positions.size() - 1;
+    auto ringVertex = [segments](uint32_t r, uint32_t s) { return 1 + (r - 1) * segments + (s % segments); };
+    for (uint32_t s = 0; s < segments; s++)
+    {
+        mesh.indices.insert(mesh.indices.end(), { 0, ringVertex(1, s + 1), ringVertex(1, s) });
+        mesh.indices.insert(mesh.indices.end(), { bottom, ringVertex(rings - 1, s), ringVertex(rings - 1, s + 1) });
+    }
+    for (uint32_t r = 1; r < rings - 1; r++)
+    {
+        for (uint32_t s = 0; s < segments; s++)
+        {
+            uint32_t i0 = ringVertex(r, s);
+            uint32_t i1 = ringVertex(r, s + 1);
+            uint32_t i2 = ringVertex(r + 1, s);
+            uint32_t i3 = ringVertex(r + 1, s + 1);
+            mesh.indices.insert(mesh.indices.end(), { i0, i1, i2, i1, i3, i2 });
+        }
+    }
+    return mesh;
+}
+
+/** Check that every LOD has fewer triangles and no smaller error than the previous one, and only references the mesh's vertices
+*/
+static bool checkLodChain(const MeshSimplifier::LodChain& chain, uint32_t indexCount, uint32_t vertexCount, std::string& error)
+{
+    if (chain.indexCounts.size() != chain.errors.size() || chain.indexCounts.size() > MeshSimplifier::kMaxLodCount)
+    {
+        error = "The chain has " + std::to_string(chain.indexCounts.size()) + " index counts and " + std::to_string(chain.errors.size()) + " errors";
+        return false;
+    }
+
+    uint32_t prevIndexCount = indexCount;
+    float prevError = 0;
+    uint32_t first = 0;
+    for (uint32_t lod = 0; lod < chain.indexCounts.size(); lod++)
+    {
+        uint32_t count = chain.indexCounts[lod];
+        if (count == 0 || count % 3 != 0 || count >= prevIndexCount)
+        {
+            error = "LOD " + std::to_string(lod) + " has " + std::to_string(count) + " indices, the previous one has " + std::to_string(prevIndexCount);
+            return false;
+        }
+        if (chain.errors[lod] < prevError)
+        {
+            error = "The error of LOD " + std::to_string(lod) + " is smaller than the error of the previous one";
+            return false;
+        }
+        if (first + count > chain.indices.size())
+        {
+            error = "LOD " + std::to_string(lod) + " is outside the chain's indices";
+            return false;
+        }
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            if (chain.indices[i] >= vertexCount)
+            {
+                error = "LOD " + std::to_string(lod) + " has an out-of-range index";
+                return false;
+            }
+        }
+        prevIndexCount = count;
+        prevError = chain.errors[lod];
+        first += count;
+    }
+
+    if (first != chain.indices.size())
+    {
+        error = "The index counts don't add up to the chain's indices";
+        return false;
+    }
+    return true;
+}
+
+testing_func(MeshSimplifierTest, TestLodChain)
+{
+    TestMesh mesh = createClosedSphere(64, 128);
+    MeshSimplifier::LodChain chain;
+    MeshSimplifier::generateLodChain(mesh.indices.data(), (uint32_t)mesh.indices.size(), mesh.positions.data(), sizeof(glm::vec3), (uint32_t)mesh.positions.size(), chain);
+
+    if (chain.indexCounts.size() < 2)
+    {
+        return test_fail("The sphere was simplified into " + std::to_string(chain.indexCounts.size()) + " LODs");
+    }
+
+    std::string error;
+    if (checkLodChain(chain, (uint32_t)mesh.indices.size(), (uint32_t)mesh.positions.size(), error) == false)
+    {
+        return test_fail(error);
+    }
+
+    // A sphere can't be simplified without moving its surface
+    if (chain.errors.back() <= 0)
+    {
+        return test_fail("The coarsest LOD has no error");
+    }
+
+    // simplify() stops at the target
+    const uint32_t target = (uint32_t)mesh.indices.size() / 4;
+    std::vector<uint32_t> result;
+    float simplifyError = MeshSimplifier::simplify(mesh.indices.data(), (uint32_t)mesh.indices.size(), mesh.positions.data(), sizeof(glm::vec3), (uint32_t)mesh.positions.size(), target, result);
+    if (result.empty() || result.size() > target || result.size() % 3 != 0 || simplifyError < 0)
+    {
+        return test_fail("simplify() returned " + std::to_string(result.size()) + " indices for a target of " + std::to_string(target));
+    }
+    return test_pass();
+}
+
+testing_func(MeshSimplifierTest, TestSmallMesh)
+{
+    // Below kMinLodTriangles the chain stays empty
+    TestMesh mesh = createClosedSphere(4, 4);
+    if (mesh.indices.size() / 3 >= MeshSimplifier::kMinLodTriangles)
+    {
+        return test_fail("The mesh is too large for the test");
+    }
+
+    MeshSimplifier::LodChain chain;
+    MeshSimplifier::generateLodChain(mesh.indices.data(), (uint32_t)mesh.indices.size(), mesh.positions.data(), sizeof(glm::vec3), (uint32_t)mesh.positions.size(), chain);
+    if (chain.indexCounts.empty() == false || chain.indices.empty() == false || chain.errors.empty() == false)
+    {
+        return test_fail("A mesh below the minimal triangle count was simplified");
+    }
+    return test_pass();
+}
+
+/** Write a sphere into an OBJ file in the executable's directory
+    \return The full path of the file
+*/
+static std::string createSphereObj(const std::string& name)
+{
+    const std::string filename = getExecutableDirectory() + '\\' + name;
+    TestMesh mesh = createClosedSphere(32, 64);
+    std::ofstream obj(filename);
+    for (const glm::vec3& p : mesh.positions)
+    {
+        obj << "v " << p.x << ' ' << p.y << ' ' << p.z << '\n';
+    }
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+        obj << "f " << mesh.indices[i] + 1 << ' ' << mesh.indices[i + 1] + 1 << ' ' << mesh.indices[i + 2] + 1 << '\n';
+    }
+    obj.close();
+    return filename;
+}
+
+/** Compare the LODs of every mesh of two models
+*/
+static bool compareLods(const Model* pExpected, const Model* pModel, std::string& error)
+{
+    if (pModel->getMeshCount() != pExpected->getMeshCount())
+    {
+        error = "The models have a different number of meshes";
+        return false;
+    }
+    for (uint32_t m = 0; m < pModel->getMeshCount(); m++)
+    {
+        const Mesh* pExpectedMesh = pExpected->getMesh(m).get();
+        const Mesh* pMesh = pModel->getMesh(m).get();
+        if (pMesh->getLodCount() != pExpectedMesh->getLodCount())
+        {
+            error = "Mesh " + std::to_string(m) + " has " + std::to_string(pMesh->getLodCount()) + " LODs instead of " + std::to_string(pExpectedMesh->getLodCount());
+            return false;
+        }
+        for (uint32_t lod = 0; lod < pMesh->getLodCount(); lod++)
+        {
+            const Mesh::Lod& expected = pExpectedMesh->getLod(lod);
+            const Mesh::Lod& actual = pMesh->getLod(lod);
+            if (actual.firstIndex != expected.firstIndex || actual.indexCount != expected.indexCount || actual.error != expected.error)
+            {
+                error = "LOD " + std::to_string(lod) + " of mesh " + std::to_string(m) + " doesn't match";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+testing_func(MeshSimplifierTest, TestBinaryRoundTrip)
+{
+    const std::string objFilename = createSphereObj("MeshSimplifierTest.obj");
+    const std::string binFilename = getExecutableDirectory() + "\\MeshSimplifierTest.bin";
+
+    Model::SharedPtr pModel = Model::createFromFile(objFilename, Model::GenerateLods);
+    if (pModel == nullptr || pModel->getMeshCount() == 0)
+    {
+        return test_fail("Failed to load the OBJ file");
+    }
+    if (pModel->getMesh(0)->getLodCount() < 2)
+    {
+        return test_fail("No LODs were generated");
+    }
+
+    // The LODs follow each other in the mesh's index buffer, each one smaller and coarser than the previous one
+    const Mesh* pMesh = pModel->getMesh(0).get();
+    for (uint32_t lod = 1; lod < pMesh->getLodCount(); lod++)
+    {
+        const Mesh::Lod& prev = pMesh->getLod(lod - 1);
+        const Mesh::Lod& cur = pMesh->getLod(lod);
+        if (cur.indexCount >= prev.indexCount || cur.error < prev.error || cur.firstIndex != prev.firstIndex + prev.indexCount)
+        {
+            return test_fail("LOD " + std::to_string(lod) + " doesn't follow the previous one");
+        }
+    }
+    const Mesh::Lod& lastLod = pMesh->getLod(pMesh->getLodCount() - 1);
+    if ((lastLod.firstIndex + lastLod.indexCount) * sizeof(uint32_t) > pMesh->getVao()->getIndexBuffer()->getSize())
+    {
+        return test_fail("The LODs are outside the index buffer");
+    }
+
+    pModel->exportToBinaryFile(binFilename);
+    Model::SharedPtr pImported = Model::createFromFile(binFilename, 0);
+    std::remove(objFilename.c_str());
+    std::remove(binFilename.c_str());
+    if (pImported == nullptr)
+    {
+        return test_fail("Failed to load the binary file");
+    }
+
+    std::string error;
+    if (compareLods(pModel.get(), pImported.get(), error) == false)
+    {
+        return test_fail(error);
+    }
+    return test_pass();
+}
+
+testing_func(MeshSimplifierTest, TestStoredEmptyLodChain)
+{
+    // A model exported without LODs stores empty chains, which the importer must keep even when asked to generate LODs
+    const std::string objFilename = createSphereObj("MeshSimplifierTestEmpty.obj");
+    const std::string binFilename = getExecutableDirectory() + "\\MeshSimplifierTestEmpty.bin";
+
+    Model::SharedPtr pModel = Model::createFromFile(objFilename, 0);
+    if (pModel == nullptr || pModel->getMeshCount() == 0 || pModel->getMesh(0)->getLodCount() != 1)
+    {
+        return test_fail("Failed to load the OBJ file");
+    }
+
+    pModel->exportToBinaryFile(binFilename);
+    Model::SharedPtr pImported = Model::createFromFile(binFilename, Model::GenerateLods);
+    std::remove(objFilename.c_str());
+    std::remove(binFilename.c_str());
+    if (pImported == nullptr)
+    {
+        return test_fail("Failed to load the binary file");
+    }
+
+    std::string error;
+    if (compareLods(pModel.get(), pImported.get(), error) == false)
+    {
+        return test_fail(error);
+    }
+    return test_pass();
+}
+
+int main()
+{
+    MeshSimplifierTest mst;
+    mst.init(true);
+    mst.run();
+    return 0;
+}
@@ -0,0 +1,267 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "OcclusionBufferTest.h"
+#include "Utils/OcclusionBuffer.h"
+#include <random>
+
+void OcclusionBufferTest::addTests()
+{
+    addTestToList<TestEmpty>();
+    addTestToList<TestOccluders>();
+    addTestToList<TestClipping>();
+    addTestToList<TestThroughput>();
+}
+
+/** Camera at (0, 0, 5), looking down -Z
+*/
+static glm::mat4 createViewProjMatrix()
+{
+    glm::mat4 view = glm::lookAt(glm::vec3(0, 0, 5), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+    glm::mat4 proj = perspectiveMatrix(glm::radians(60.0f), 2.0f, 0.1f, 1000.0f);
+    return proj * view;
+}
+
+static BoundingBox createBox(const glm::vec3& minPos, const glm::vec3& maxPos)
+{
+    return BoundingBox::fromMinMax(minPos, maxPos);
+}
+
+/** Append the 12 triangles of a box
+*/
+static void addBoxTriangles(const BoundingBox& box, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+{
+    static const uint32_t kBoxIndices[36] = { 0,1,3, 0,3,2, 4,6,7, 4,7,5, 0,4,5, 0,5,1, 2,3,7, 2,7,6, 0,2,6, 0,6,4, 1,5,7, 1,7,3 };
+    glm::vec3 minPos = box.getMinPos();
+    glm::vec3 maxPos = box.getMaxPos();
+    uint32_t base = (uint32_t)positions.size();
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        positions.push_back(glm::vec3((i & 4) ? maxPos.x : minPos.x, (i & 2) ? maxPos.y : minPos.y, (i & 1) ? maxPos.z : minPos.z));
+    }
+    for (uint32_t i : kBoxIndices)
+    {
+        indices.push_back(base + i);
+    }
+}
+
+testing_func(OcclusionBufferTest, TestEmpty)
+{
+    OcclusionBuffer::SharedPtr pBuffer = OcclusionBuffer::create(100, 50);
+    if ((pBuffer->getWidth() != 128) || (pBuffer->getHeight() != 64))
+    {
+        return test_fail("The buffer size wasn't rounded up to whole tiles");
+    }
+
+    pBuffer->clear(createViewProjMatrix());
+    pBuffer->rasterize();
+    if (pBuffer->isVisible(createBox(glm::vec3(-1, -1, -100), glm::vec3(1, 1, -99))) == false)
+    {
+        return test_fail("A box was hidden by an empty buffer");
+    }
+    return test_pass();
+}
+
+testing_func(OcclusionBufferTest, TestOccluders)
+{
+    OcclusionBuffer::SharedPtr pBuffer = OcclusionBuffer::create(256, 128);
+    const glm::mat4 viewProj = createViewProjMatrix();
+    pBuffer->clear(viewProj);
+
+    // A wall at z = 0, drawn as a non-indexed quad, and a box at z = -10 with a translation
+    const glm::vec3 wall[6] = { glm::vec3(-2, -1, 0), glm::vec3(2, -1, 0), glm::vec3(2, 1, 0), glm::vec3(-2, -1, 0), glm::vec3(2, 1, 0), glm::vec3(-2, 1, 0) };
+    pBuffer->addOccluder(glm::mat4(), wall, nullptr, 6);
+
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    addBoxTriangles(createBox(glm::vec3(-1), glm::vec3(1)), positions, indices);
+    pBuffer->addOccluder(glm::translate(glm::mat4(), glm::vec3(6, 0, -10)), positions.data(), indices.data(), (uint32_t)indices.size());
+    pBuffer->rasterize();
+
+    const OcclusionBuffer::Stats& stats = pBuffer->getStats();
+    if ((stats.occluderCount != 2) || (stats.triangleCount != 14))
+    {
+        return test_fail("Wrong occluder statistics");
+    }
+
+    // The depth at the center of the screen is the wall's
+    glm::vec4 center = viewProj * glm::vec4(0, 0, 0, 1);
+    float depth = pBuffer->getDepth(pBuffer->getWidth() / 2, pBuffer->getHeight() / 2);
+    if (std::abs(depth - center.z / center.w) > 1.0e-4f)
+    {
+        return test_fail("Wrong depth at the center of the wall");
+    }
+    if (pBuffer->getDepth(0, 0) != 1.0f)
+    {
+        return test_fail("A pixel outside of the occluders was written");
+    }
+
+    struct Case
+    {
+        BoundingBox box;
+        bool visible;
+        const char* description;
+    };
+    const Case cases[] =
+    {
+        { createBox(glm::vec3(-1, -0.5f, -3), glm::vec3(1, 0.5f, -1)), false, "box behind the wall" },
+        { createBox(glm::vec3(-1, -0.5f, 1), glm::vec3(1, 0.5f, 2)), true, "box in front of the wall" },
+        { createBox(glm::vec3(-1, -0.5f, -0.5f), glm::vec3(1, 0.5f, 0.5f)), true, "box crossing the wall" },
+        { createBox(glm::vec3(1, -0.5f, -3), glm::vec3(4, 0.5f, -2)), true, "box partially behind the wall" },
+        { createBox(glm::vec3(5.5f, -0.5f, -20), glm::vec3(6.5f, 0.5f, -15)), false, "box behind the translated box" },
+        { createBox(glm::vec3(-1, -1, 4), glm::vec3(1, 1, 6)), true, "box crossing the near plane" },
+        { createBox(glm::vec3(-1, -0.5f, -2000), glm::vec3(1, 0.5f, -1500)), false, "box beyond the far plane, behind the wall" },
+        { createBox(glm::vec3(100, -0.5f, -3), glm::vec3(101, 0.5f, -2)), true, "box outside of the screen" },
+    };
+
+    std::vector<BoundingBox> boxes;
+    for (const auto& c : cases)
+    {
+        if (pBuffer->isVisible(c.box) != c.visible)
+        {
+            return test_fail(std::string("Wrong visibility for the ") + c.description);
+        }
+        boxes.push_back(c.box);
+    }
+
+    std::vector<uint8_t> visible;
+    pBuffer->testVisibility(boxes, visible);
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        if ((visible[i] != 0) != cases[i].visible)
+        {
+            return test_fail("testVisibility() and isVisible() disagree");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(OcclusionBufferTest, TestClipping)
+{
+    OcclusionBuffer::SharedPtr pBuffer = OcclusionBuffer::create(256, 128);
+    pBuffer->clear(createViewProjMatrix());
+
+    // A floor which extends behind the camera and far outside of the screen, so it's clipped by the near plane and the guard band
+    const glm::vec3 floor[4] = { glm::vec3(-1000, -1, -1000), glm::vec3(1000, -1, -1000), glm::vec3(1000, -1, 1000), glm::vec3(-1000, -1, 1000) };
+    const uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+    pBuffer->addOccluder(glm::mat4(), floor, indices, 6);
+    pBuffer->rasterize();
+
+    if (pBuffer->getStats().rasterizedTriangleCount <= 2)
+    {
+        return test_fail("The floor wasn't clipped");
+    }
+
+    // The bottom row is covered by the floor, which is closest at the bottom of the screen
+    const uint32_t bottom = pBuffer->getHeight() - 1;
+    const uint32_t middle = pBuffer->getWidth() / 2;
+    if ((pBuffer->getDepth(0, bottom) == 1.0f) || (pBuffer->getDepth(pBuffer->getWidth() - 1, bottom) == 1.0f) || (pBuffer->getDepth(middle, bottom) >= pBuffer->getDepth(middle, pBuffer->getHeight() / 2 + 1)))
+    {
+        return test_fail("Wrong depth for the floor");
+    }
+    if (pBuffer->getDepth(middle, 0) != 1.0f)
+    {
+        return test_fail("The floor was rasterized above the horizon");
+    }
+
+    if (pBuffer->isVisible(createBox(glm::vec3(-2, -5, -20), glm::vec3(2, -3, -10))))
+    {
+        return test_fail("A box under the floor is visible");
+    }
+    if (pBuffer->isVisible(createBox(glm::vec3(-2, -0.5f, -20), glm::vec3(2, 0.5f, -10))) == false)
+    {
+        return test_fail("A box above the floor is hidden");
+    }
+    return test_pass();
+}
+
+testing_func(OcclusionBufferTest, TestThroughput)
+{
+    // A city: a grid of buildings as occluders, with small objects scattered between and behind them
+    const uint32_t kBuildingCount = 256;
+    const uint32_t kBoxCount = 100000;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    for (uint32_t i = 0; i < kBuildingCount; i++)
+    {
+        glm::vec3 minPos(-80 + (i % 16) * 10.0f, -1, -10 - (i / 16) * 10.0f);
+        addBoxTriangles(createBox(minPos, minPos + glm::vec3(6, 5 + 20 * unit(rng), 6)), positions, indices);
+    }
+
+    std::vector<BoundingBox> boxes(kBoxCount);
+    for (auto& box : boxes)
+    {
+        glm::vec3 minPos(-80 + 160 * unit(rng), -1, -10 - 160 * unit(rng));
+        box = createBox(minPos, minPos + glm::vec3(1));
+    }
+
+    OcclusionBuffer::SharedPtr pBuffer = OcclusionBuffer::create(256, 128);
+    const uint32_t kFrameCount = 10;
+    double rasterMs = 0;
+    double testMs = 0;
+    std::vector<uint8_t> visible;
+    for (uint32_t frame = 0; frame < kFrameCount; frame++)
+    {
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        pBuffer->clear(createViewProjMatrix());
+        pBuffer->addOccluder(glm::mat4(), positions.data(), indices.data(), (uint32_t)indices.size());
+        pBuffer->rasterize();
+        auto rasterTime = CpuTimer::getCurrentTimePoint();
+        pBuffer->testVisibility(boxes, visible);
+        rasterMs += CpuTimer::calcDuration(startTime, rasterTime);
+        testMs += CpuTimer::calcDuration(rasterTime, CpuTimer::getCurrentTimePoint());
+    }
+
+    uint32_t visibleCount = 0;
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        visibleCount += visible[i];
+        if ((visible[i] != 0) != pBuffer->isVisible(boxes[i]))
+        {
+            return test_fail("testVisibility() and isVisible() disagree");
+        }
+    }
+    if ((visibleCount == 0) || (visibleCount == kBoxCount))
+    {
+        return test_fail("The buildings didn't occlude part of the boxes");
+    }
+
+    logInfo("OcclusionBuffer: " + std::to_string(indices.size() / 3) + " occluder triangles rasterized in " + std::to_string(rasterMs / kFrameCount) + " ms, " +
+        std::to_string(kBoxCount) + " boxes tested in " + std::to_string(testMs / kFrameCount) + " ms, " + std::to_string(kBoxCount - visibleCount) + " occluded.");
+    return test_pass();
+}
+
+int main()
+{
+    OcclusionBufferTest obt;
+    obt.init();
+    obt.run();
+    return 0;
+}
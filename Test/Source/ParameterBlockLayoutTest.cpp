@@ -0,0 +1,368 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ParameterBlockLayoutTest.h"
+#include "API/ParameterBlockLayout.h"
+#include "Data/HostDeviceData.h"
+#include "Utils/CpuTimer.h"
+#include <cstring>
+
+void ParameterBlockLayoutTest::addTests()
+{
+    addTestToList<TestHostDeviceLayouts>();
+    addTestToList<TestMismatches>();
+    addTestToList<TestArrayStride>();
+    addTestToList<TestValidationCache>();
+    addTestToList<TestThroughput>();
+}
+
+using Variable = ProgramReflection::Variable;
+using BufferReflection = ProgramReflection::BufferReflection;
+
+static size_t alignTo16(size_t offset)
+{
+    return (offset + 15) & ~size_t(15);
+}
+
+static bool isMatrix(Variable::Type type)
+{
+    return (type >= Variable::Type::Float2x2) && (type <= Variable::Type::Float4x4);
+}
+
+/** Size of a scalar, vector or matrix in a constant buffer. Matrices take a 16-byte register per column.
+*/
+static size_t getShaderTypeSize(Variable::Type type)
+{
+    switch (type)
+    {
+    case Variable::Type::Bool:
+    case Variable::Type::Int:
+    case Variable::Type::Uint:
+    case Variable::Type::Float:
+        return 4;
+    case Variable::Type::Bool2:
+    case Variable::Type::Int2:
+    case Variable::Type::Uint2:
+    case Variable::Type::Float2:
+        return 8;
+    case Variable::Type::Bool3:
+    case Variable::Type::Int3:
+    case Variable::Type::Uint3:
+    case Variable::Type::Float3:
+        return 12;
+    case Variable::Type::Bool4:
+    case Variable::Type::Int4:
+    case Variable::Type::Uint4:
+    case Variable::Type::Float4:
+        return 16;
+    case Variable::Type::Float2x2:
+    case Variable::Type::Float3x2:
+    case Variable::Type::Float4x2:
+        return 32;
+    case Variable::Type::Float2x3:
+    case Variable::Type::Float3x3:
+    case Variable::Type::Float4x3:
+        return 48;
+    case Variable::Type::Float2x4:
+    case Variable::Type::Float3x4:
+    case Variable::Type::Float4x4:
+        return 64;
+    default:
+        should_not_get_here();
+        return 0;
+    }
+}
+
+/** Lay out the fields of a struct with the HLSL constant buffer packing rules, and return the variables the shader reflection would report.
+    Fields are packed into 16-byte registers and can't straddle a register boundary. Matrices, arrays and structs start on a new register, and every array element takes whole registers.
+    A field starts a new struct when its parent path (everything before the last '.') differs from the previous field's.
+*/
+static ProgramReflection::VariableMap packConstantBuffer(const ParameterBlockLayout& layout, const std::string& varName, size_t baseOffset, size_t& endOffset)
+{
+    ProgramReflection::VariableMap varMap;
+    size_t offset = baseOffset;
+    std::string parent;
+    for (const auto& field : layout.getFields())
+    {
+        size_t size = getShaderTypeSize(field.type);
+        std::string fieldParent = field.name.substr(0, field.name.find_last_of('.') + 1);
+        bool newRegister = (fieldParent != parent) || isMatrix(field.type) || (field.arraySize > 0);
+        newRegister = newRegister || ((offset % 16) + size > 16);
+        if (newRegister)
+        {
+            offset = alignTo16(offset);
+        }
+        parent = fieldParent;
+
+        Variable var;
+        var.location = offset;
+        var.type = field.type;
+        var.arraySize = field.arraySize;
+        varMap[varName + "." + field.name] = var;
+
+        offset += (field.arraySize > 0) ? (alignTo16(size) * (field.arraySize - 1) + size) : size;
+    }
+    endOffset = offset;
+    return varMap;
+}
+
+static BufferReflection::SharedPtr createConstantBuffer(const ProgramReflection::VariableMap& varMap, size_t size)
+{
+    return BufferReflection::create("PerFrameCB", 0, 0, BufferReflection::Type::Constant, alignTo16(size), varMap, ProgramReflection::ResourceMap(), ProgramReflection::ShaderAccess::Read);
+}
+
+/** Check that a struct from HostDeviceData.h matches the HLSL packing of the same struct, both at the start of the buffer and after another variable
+*/
+template<typename DataType>
+static bool checkHostDeviceLayout(const std::string& varName, std::string& error)
+{
+    const ParameterBlockLayout& layout = ParameterBlockTraits<DataType>::getLayout();
+    for (size_t baseOffset : { size_t(0), size_t(32) })
+    {
+        size_t endOffset;
+        ProgramReflection::VariableMap varMap = packConstantBuffer(layout, varName, baseOffset, endOffset);
+        BufferReflection::SharedPtr pBuffer = createConstantBuffer(varMap, endOffset);
+
+        size_t offset;
+        std::string log;
+        if (layout.validate(pBuffer.get(), varName, offset, log) == false)
+        {
+            error = varName + " doesn't match the HLSL packing rules.\n" + log;
+            return false;
+        }
+        if (offset != baseOffset)
+        {
+            error = varName + " was found at offset " + std::to_string(offset) + ", expected " + std::to_string(baseOffset);
+            return false;
+        }
+    }
+
+    if (layout.getSize() > sizeof(DataType))
+    {
+        error = varName + " layout is larger than the C++ struct";
+        return false;
+    }
+    return true;
+}
+
+testing_func(ParameterBlockLayoutTest, TestHostDeviceLayouts)
+{
+    std::string error;
+    if (checkHostDeviceLayout<CameraData>("gCam", error) == false)
+    {
+        return test_fail(error);
+    }
+    if (checkHostDeviceLayout<MaterialData>("gMaterial", error) == false)
+    {
+        return test_fail(error);
+    }
+    if (checkHostDeviceLayout<LightData>("gLight", error) == false)
+    {
+        return test_fail(error);
+    }
+
+    // The writes copy everything the shaders read, and nothing past it
+    if (ParameterBlockTraits<CameraData>::getLayout().getSize() != sizeof(CameraData))
+    {
+        return test_fail("Camera layout doesn't cover the whole struct");
+    }
+    if (ParameterBlockTraits<MaterialData>::getLayout().getSize() != sizeof(MaterialDesc) + sizeof(MaterialValues))
+    {
+        return test_fail("Material layout must cover the desc and the values");
+    }
+    if (ParameterBlockTraits<LightData>::getLayout().getSize() != offsetof(LightData, material))
+    {
+        return test_fail("Light layout must end at the material");
+    }
+    return test_pass();
+}
+
+testing_func(ParameterBlockLayoutTest, TestMismatches)
+{
+    const ParameterBlockLayout& layout = ParameterBlockTraits<CameraData>::getLayout();
+    size_t endOffset;
+    const ProgramReflection::VariableMap varMap = packConstantBuffer(layout, "gCam", 0, endOffset);
+    size_t offset;
+    std::string log;
+
+    // Field at a different offset
+    ProgramReflection::VariableMap shifted = varMap;
+    shifted["gCam.farZ"].location += 4;
+    if (layout.validate(createConstantBuffer(shifted, endOffset).get(), "gCam", offset, log) || offset != ParameterBlockLayout::kInvalidOffset)
+    {
+        return test_fail("Offset mismatch wasn't detected");
+    }
+
+    // Field with a different type
+    ProgramReflection::VariableMap retyped = varMap;
+    retyped["gCam.nearZ"].type = Variable::Type::Uint;
+    if (layout.validate(createConstantBuffer(retyped, endOffset).get(), "gCam", offset, log))
+    {
+        return test_fail("Type mismatch wasn't detected");
+    }
+
+    // Field missing from the shader
+    ProgramReflection::VariableMap missing = varMap;
+    missing.erase("gCam.rightEyeProjMat");
+    if (layout.validate(createConstantBuffer(missing, endOffset).get(), "gCam", offset, log))
+    {
+        return test_fail("Missing field wasn't detected");
+    }
+
+    // Buffer too small for the struct
+    if (layout.validate(createConstantBuffer(varMap, endOffset - 16).get(), "gCam", offset, log))
+    {
+        return test_fail("Buffer overflow wasn't detected");
+    }
+
+    // Unknown variable
+    if (layout.validate(createConstantBuffer(varMap, endOffset).get(), "gCamera", offset, log))
+    {
+        return test_fail("Unknown variable was accepted");
+    }
+    return test_pass();
+}
+
+testing_func(ParameterBlockLayoutTest, TestArrayStride)
+{
+    // A float[4] is 16 bytes in C++, but 52 bytes in a constant buffer, where every element takes a register
+    ParameterBlockLayout floatArray;
+    floatArray.addField<float[4]>("weights", 0);
+    ParameterBlockLayout vecArray;
+    vecArray.addField<glm::vec4[4]>("weights", 0);
+
+    for (const ParameterBlockLayout* pLayout : { &floatArray, &vecArray })
+    {
+        Variable var;
+        var.location = 0;
+        var.type = pLayout->getFields()[0].type;
+        var.arraySize = 4;
+        ProgramReflection::VariableMap varMap;
+        varMap["gData.weights"] = var;
+
+        size_t offset;
+        std::string log;
+        bool isVecArray = (pLayout == &vecArray);
+        BufferReflection::SharedPtr pConstant = createConstantBuffer(varMap, 64);
+        if (pLayout->validate(pConstant.get(), "gData", offset, log) != isVecArray)
+        {
+            return test_fail("Constant buffer array stride check failed");
+        }
+
+        // Structured buffers are tightly packed
+        BufferReflection::SharedPtr pStructured = BufferReflection::create("gBuffer", 0, 0, BufferReflection::Type::Structured, 64, varMap, ProgramReflection::ResourceMap(), ProgramReflection::ShaderAccess::Read);
+        if (pLayout->validate(pStructured.get(), "gData", offset, log) == false)
+        {
+            return test_fail("Structured buffer array was rejected");
+        }
+    }
+    return test_pass();
+}
+
+testing_func(ParameterBlockLayoutTest, TestValidationCache)
+{
+    const ParameterBlockLayout& layout = ParameterBlockTraits<CameraData>::getLayout();
+    size_t endOffset;
+    ProgramReflection::VariableMap varMap = packConstantBuffer(layout, "gCam", 64, endOffset);
+    BufferReflection::SharedConstPtr pBuffer = createConstantBuffer(varMap, endOffset);
+
+    if (layout.getOffset(pBuffer, "gCam") != 64 || layout.getOffset(pBuffer, "gCam") != 64)
+    {
+        return test_fail("Wrong offset");
+    }
+    if (layout.getOffset(pBuffer, "gOtherCam") != ParameterBlockLayout::kInvalidOffset)
+    {
+        return test_fail("Missing variable returned a valid offset");
+    }
+    if (layout.getOffset(nullptr, "gCam") != ParameterBlockLayout::kInvalidOffset)
+    {
+        return test_fail("Null reflection returned a valid offset");
+    }
+
+    // Relinking creates a new reflection object, which must be validated again
+    pBuffer = nullptr;
+    varMap = packConstantBuffer(layout, "gCam", 128, endOffset);
+    pBuffer = createConstantBuffer(varMap, endOffset);
+    if (layout.getOffset(pBuffer, "gCam") != 128)
+    {
+        return test_fail("A new reflection object wasn't validated again");
+    }
+    return test_pass();
+}
+
+testing_func(ParameterBlockLayoutTest, TestThroughput)
+{
+    const ParameterBlockLayout& layout = ParameterBlockTraits<CameraData>::getLayout();
+    size_t endOffset;
+    ProgramReflection::VariableMap varMap = packConstantBuffer(layout, "gCam", 0, endOffset);
+    BufferReflection::SharedConstPtr pBuffer = createConstantBuffer(varMap, endOffset);
+    std::vector<uint8_t> data(pBuffer->getRequiredSize());
+    CameraData camera;
+    const std::string varName = "gCam";
+    const uint32_t kIterations = 100000;
+
+    // Typed write, as done by ConstantBuffer::setParameterBlock()
+    auto startTime = CpuTimer::getCurrentTimePoint();
+    for (uint32_t i = 0; i < kIterations; i++)
+    {
+        camera.jitterX = (float)i;
+        size_t offset = layout.getOffset(pBuffer, varName);
+        memcpy(data.data() + offset, &camera, layout.getSize());
+    }
+    auto typedTime = CpuTimer::getCurrentTimePoint();
+
+    // Name lookup of a single field, as done before
+    size_t checksum = 0;
+    for (uint32_t i = 0; i < kIterations; i++)
+    {
+        size_t offset;
+        pBuffer->getVariableData(varName + ".viewMat", offset, true);
+        checksum += offset;
+    }
+    auto nameTime = CpuTimer::getCurrentTimePoint();
+
+    float typedMs = CpuTimer::calcDuration(startTime, typedTime);
+    float nameMs = CpuTimer::calcDuration(typedTime, nameTime);
+    logInfo("ParameterBlockLayout: " + std::to_string(kIterations) + " typed camera writes in " + std::to_string(typedMs) + " ms, " +
+        std::to_string(kIterations) + " name lookups in " + std::to_string(nameMs) + " ms (" + std::to_string(checksum) + ")");
+
+    float jitterX;
+    memcpy(&jitterX, data.data() + offsetof(CameraData, jitterX), sizeof(float));
+    if (jitterX != (float)(kIterations - 1))
+    {
+        return test_fail("Typed write didn't update the buffer");
+    }
+    return test_pass();
+}
+
+int main()
+{
+    ParameterBlockLayoutTest pblt;
+    pblt.init();
+    pblt.run();
+    return 0;
+}
@@ -0,0 +1,402 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ProgramReflectionTest.h"
+
+void ProgramReflectionTest::addTests()
+{
+    addTestToList<TestRoundTrip>();
+    addTestToList<TestEmptyReflection>();
+    addTestToList<TestInternedNames>();
+    addTestToList<TestCorruptBlob>();
+}
+
+using Variable = ProgramReflection::Variable;
+using Resource = ProgramReflection::Resource;
+using BufferReflection = ProgramReflection::BufferReflection;
+
+static Variable createVariable(size_t location, Variable::Type type, uint32_t arraySize = 0, uint32_t arrayStride = 0, bool isRowMajor = false)
+{
+    Variable var;
+    var.location = location;
+    var.type = type;
+    var.arraySize = arraySize;
+    var.arrayStride = arrayStride;
+    var.isRowMajor = isRowMajor;
+    return var;
+}
+
+static Resource createResource(Resource::ResourceType type, Resource::Dimensions dims, Resource::ReturnType retType, ProgramReflection::ShaderAccess access, uint32_t regIndex, uint32_t arraySize, uint32_t shaderMask)
+{
+    Resource res(dims, retType, type, access);
+    res.regIndex = regIndex;
+    res.arraySize = arraySize;
+    res.shaderMask = shaderMask;
+    return res;
+}
+
+static void addBuffer(ProgramReflection::BufferData& bufferData, const std::string& name, uint32_t regIndex, BufferReflection::Type type, size_t size, const ProgramReflection::VariableMap& varMap, const ProgramReflection::ResourceMap& resourceMap, ProgramReflection::ShaderAccess access, uint32_t shaderMask)
+{
+    ProgramReflection::BindLocation bindLocation(regIndex, access);
+    BufferReflection::SharedPtr pBuffer = BufferReflection::create(name, regIndex, 0, type, size, varMap, resourceMap, access);
+    pBuffer->setShaderMask(shaderMask);
+    bufferData.nameMap[name] = bindLocation;
+    bufferData.descMap[bindLocation] = pBuffer;
+}
+
+/** A program with two constant buffers, a read-only and a read-write structured buffer, vertex attributes, fragment outputs and global resources
+*/
+static ProgramReflection::SharedPtr createReflection()
+{
+    using Type = Variable::Type;
+    using Access = ProgramReflection::ShaderAccess;
+    ProgramReflection::BufferData buffers[BufferReflection::kTypeCount];
+
+    ProgramReflection::VariableMap perFrame;
+    perFrame["gCam.viewMat"] = createVariable(0, Type::Float4x4, 0, 0, true);
+    perFrame["gCam.projMat"] = createVariable(64, Type::Float4x4);
+    perFrame["gCam.position"] = createVariable(128, Type::Float3);
+    perFrame["gLights"] = createVariable(144, Type::Float4, 16, 16);
+    perFrame["gLightCount"] = createVariable(400, Type::Uint);
+    perFrame["gEnabled"] = createVariable(404, Type::Bool);
+    perFrame["gFrameID"] = createVariable(408, Type::Uint64);
+    addBuffer(buffers[(uint32_t)BufferReflection::Type::Constant], "PerFrameCB", 0, BufferReflection::Type::Constant, 416, perFrame, ProgramReflection::ResourceMap(), Access::Read, 0x11);
+
+    ProgramReflection::VariableMap perMaterial;
+    perMaterial["gMaterial.diffuse"] = createVariable(0, Type::Float4);
+    perMaterial["gMaterial.roughness"] = createVariable(16, Type::Float);
+    ProgramReflection::ResourceMap materialResources;
+    materialResources["gMaterial.albedoMap"] = createResource(Resource::ResourceType::Texture, Resource::Dimensions::Texture2D, Resource::ReturnType::Float, Access::Read, 3, 0, 0x10);
+    addBuffer(buffers[(uint32_t)BufferReflection::Type::Constant], "PerMaterialCB", 1, BufferReflection::Type::Constant, 32, perMaterial, materialResources, Access::Read, 0x10);
+
+    ProgramReflection::VariableMap instance;
+    instance["worldMat"] = createVariable(0, Type::Float4x3);
+    instance["id"] = createVariable(48, Type::Int);
+    addBuffer(buffers[(uint32_t)BufferReflection::Type::Structured], "gInstances", 2, BufferReflection::Type::Structured, 52, instance, ProgramReflection::ResourceMap(), Access::Read, 0x1);
+
+    ProgramReflection::VariableMap counter;
+    counter["count"] = createVariable(0, Type::Uint);
+    addBuffer(buffers[(uint32_t)BufferReflection::Type::Structured], "gCounters", 0, BufferReflection::Type::Structured, 4, counter, ProgramReflection::ResourceMap(), Access::ReadWrite, 0x20);
+
+    ProgramReflection::VariableMap vertAttr;
+    vertAttr["POSITION"] = createVariable(0, Type::Float3);
+    vertAttr["NORMAL"] = createVariable(1, Type::Float3);
+    vertAttr["TEXCOORD"] = createVariable(2, Type::Float2);
+
+    ProgramReflection::VariableMap fragOut;
+    fragOut["SV_TARGET0"] = createVariable(0, Type::Float4);
+    fragOut["SV_TARGET1"] = createVariable(1, Type::Uint2);
+
+    ProgramReflection::ResourceMap resources;
+    resources["gShadowMaps"] = createResource(Resource::ResourceType::Texture, Resource::Dimensions::Texture2DArray, Resource::ReturnType::Float, Access::Read, 4, 4, 0x10);
+    resources["gOutput"] = createResource(Resource::ResourceType::Texture, Resource::Dimensions::Texture2D, Resource::ReturnType::Uint, Access::ReadWrite, 1, 0, 0x20);
+    resources["gIndices"] = createResource(Resource::ResourceType::RawBuffer, Resource::Dimensions::Buffer, Resource::ReturnType::Unknown, Access::Read, 8, 0, 0x1);
+    resources["gSampler"] = createResource(Resource::ResourceType::Sampler, Resource::Dimensions::Unknown, Resource::ReturnType::Unknown, Access::Undefined, 0, 0, 0x10);
+
+    return ProgramReflection::create(buffers, vertAttr, fragOut, resources);
+}
+
+static bool compareVariables(const ProgramReflection::VariableMap& a, const ProgramReflection::VariableMap& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (const auto& it : a)
+    {
+        const auto& other = b.find(it.first);
+        if (other == b.end())
+        {
+            return false;
+        }
+        const Variable& va = it.second;
+        const Variable& vb = other->second;
+        if (va.location != vb.location || va.arraySize != vb.arraySize || va.arrayStride != vb.arrayStride || va.isRowMajor != vb.isRowMajor || va.type != vb.type)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool compareResources(const ProgramReflection::ResourceMap& a, const ProgramReflection::ResourceMap& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (const auto& it : a)
+    {
+        const auto& other = b.find(it.first);
+        if (other == b.end())
+        {
+            return false;
+        }
+        const Resource& ra = it.second;
+        const Resource& rb = other->second;
+        bool equal = (ra.shaderAccess == rb.shaderAccess) && (ra.type == rb.type) && (ra.dims == rb.dims) && (ra.retType == rb.retType);
+        equal = equal && (ra.regIndex == rb.regIndex) && (ra.arraySize == rb.arraySize) && (ra.shaderMask == rb.shaderMask) && (ra.registerSpace == rb.registerSpace);
+        if (equal == false)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool compareBuffers(const BufferReflection* pA, const BufferReflection* pB)
+{
+    bool equal = (pA->getName() == pB->getName()) && (pA->getType() == pB->getType()) && (pA->getRequiredSize() == pB->getRequiredSize());
+    equal = equal && (pA->getRegisterIndex() == pB->getRegisterIndex()) && (pA->getRegisterSpace() == pB->getRegisterSpace());
+    equal = equal && (pA->getShaderAccess() == pB->getShaderAccess()) && (pA->getShaderMask() == pB->getShaderMask());
+    if (equal == false)
+    {
+        return false;
+    }
+
+    ProgramReflection::VariableMap varA(pA->varBegin(), pA->varEnd());
+    ProgramReflection::VariableMap varB(pB->varBegin(), pB->varEnd());
+    ProgramReflection::ResourceMap resA(pA->resourceBegin(), pA->resourceEnd());
+    ProgramReflection::ResourceMap resB(pB->resourceBegin(), pB->resourceEnd());
+    return compareVariables(varA, varB) && compareResources(resA, resB);
+}
+
+static bool compareReflection(const ProgramReflection* pA, const ProgramReflection* pB, std::string& error)
+{
+    for (uint32_t i = 0; i < BufferReflection::kTypeCount; i++)
+    {
+        BufferReflection::Type type = (BufferReflection::Type)i;
+        const auto& mapA = pA->getBufferMap(type);
+        const auto& mapB = pB->getBufferMap(type);
+        if (mapA.size() != mapB.size())
+        {
+            error = to_string(type) + " buffer count mismatch";
+            return false;
+        }
+        for (const auto& it : mapA)
+        {
+            const BufferReflection* pBufferA = it.second.get();
+            BufferReflection::SharedConstPtr pBufferB = pB->getBufferDesc(pBufferA->getName(), type);
+            if (pBufferB == nullptr || compareBuffers(pBufferA, pBufferB.get()) == false)
+            {
+                error = "Buffer '" + pBufferA->getName() + "' mismatch";
+                return false;
+            }
+            if (pB->getBufferDesc(it.first.regIndex, it.first.shaderAccess, type) != pBufferB)
+            {
+                error = "Buffer '" + pBufferA->getName() + "' has a different bind location";
+                return false;
+            }
+        }
+    }
+
+    if (compareVariables(pA->getVertexAttributeMap(), pB->getVertexAttributeMap()) == false)
+    {
+        error = "Vertex attributes mismatch";
+        return false;
+    }
+    if (compareVariables(pA->getFragmentOutputMap(), pB->getFragmentOutputMap()) == false)
+    {
+        error = "Fragment outputs mismatch";
+        return false;
+    }
+    if (compareResources(pA->getResourceMap(), pB->getResourceMap()) == false)
+    {
+        error = "Global resources mismatch";
+        return false;
+    }
+    return true;
+}
+
+testing_func(ProgramReflectionTest, TestRoundTrip)
+{
+    ProgramReflection::SharedPtr pReflection = createReflection();
+    std::vector<uint8_t> blob;
+    pReflection->serialize(blob);
+
+    ProgramReflection::SharedPtr pLoaded = ProgramReflection::createFromBlob(blob.data(), blob.size());
+    if (pLoaded == nullptr)
+    {
+        return test_fail("Failed to create reflection from blob");
+    }
+
+    std::string error;
+    if (compareReflection(pReflection.get(), pLoaded.get(), error) == false)
+    {
+        return test_fail(error);
+    }
+
+    // The serialization is deterministic, so a second round must produce the same blob
+    std::vector<uint8_t> secondBlob;
+    pLoaded->serialize(secondBlob);
+    if (secondBlob != blob)
+    {
+        return test_fail("Serializing the loaded reflection produced a different blob");
+    }
+
+    // The blob must not depend on its alignment, so it can be read from anywhere in a mapped file
+    std::vector<uint8_t> unaligned(blob.size() + 1);
+    memcpy(unaligned.data() + 1, blob.data(), blob.size());
+    ProgramReflection::SharedPtr pUnaligned = ProgramReflection::createFromBlob(unaligned.data() + 1, blob.size());
+    if (pUnaligned == nullptr || compareReflection(pReflection.get(), pUnaligned.get(), error) == false)
+    {
+        return test_fail("Failed to read an unaligned blob");
+    }
+
+    size_t offset;
+    const Variable* pVar = pLoaded->getBufferDesc("PerFrameCB", BufferReflection::Type::Constant)->getVariableData("gLights[3]", offset);
+    if (pVar == nullptr || offset != 144 + 3 * 16)
+    {
+        return test_fail("Array variable lookup failed after loading");
+    }
+    return test_pass();
+}
+
+testing_func(ProgramReflectionTest, TestEmptyReflection)
+{
+    ProgramReflection::BufferData buffers[BufferReflection::kTypeCount];
+    ProgramReflection::SharedPtr pReflection = ProgramReflection::create(buffers, ProgramReflection::VariableMap(), ProgramReflection::VariableMap(), ProgramReflection::ResourceMap());
+    std::vector<uint8_t> blob;
+    pReflection->serialize(blob);
+
+    ProgramReflection::SharedPtr pLoaded = ProgramReflection::createFromBlob(blob.data(), blob.size());
+    std::string error;
+    if (pLoaded == nullptr || compareReflection(pReflection.get(), pLoaded.get(), error) == false)
+    {
+        return test_fail("Empty reflection didn't round-trip");
+    }
+    return test_pass();
+}
+
+static uint32_t countOccurrences(const std::vector<uint8_t>& blob, const std::string& str)
+{
+    uint32_t count = 0;
+    auto it = blob.begin();
+    while (true)
+    {
+        it = std::search(it, blob.end(), str.begin(), str.end());
+        if (it == blob.end())
+        {
+            return count;
+        }
+        count++;
+        it++;
+    }
+}
+
+testing_func(ProgramReflectionTest, TestInternedNames)
+{
+    using Access = ProgramReflection::ShaderAccess;
+    ProgramReflection::BufferData buffers[BufferReflection::kTypeCount];
+
+    // Two buffers with identical member names, and a global resource sharing one of the names
+    ProgramReflection::VariableMap varMap;
+    varMap["gSharedParams.scale"] = createVariable(0, Variable::Type::Float4);
+    varMap["gSharedParams.bias"] = createVariable(16, Variable::Type::Float4);
+    addBuffer(buffers[(uint32_t)BufferReflection::Type::Constant], "FirstCB", 0, BufferReflection::Type::Constant, 32, varMap, ProgramReflection::ResourceMap(), Access::Read, 0x1);
+    addBuffer(buffers[(uint32_t)BufferReflection::Type::Constant], "SecondCB", 1, BufferReflection::Type::Constant, 32, varMap, ProgramReflection::ResourceMap(), Access::Read, 0x10);
+
+    ProgramReflection::ResourceMap resources;
+    resources["gSharedParams.scale"] = createResource(Resource::ResourceType::Texture, Resource::Dimensions::Texture2D, Resource::ReturnType::Float, Access::Read, 0, 0, 0x10);
+
+    ProgramReflection::SharedPtr pReflection = ProgramReflection::create(buffers, ProgramReflection::VariableMap(), ProgramReflection::VariableMap(), resources);
+    std::vector<uint8_t> blob;
+    pReflection->serialize(blob);
+
+    if (countOccurrences(blob, "gSharedParams.scale") != 1 || countOccurrences(blob, "gSharedParams.bias") != 1)
+    {
+        return test_fail("Names are not interned");
+    }
+
+    ProgramReflection::SharedPtr pLoaded = ProgramReflection::createFromBlob(blob.data(), blob.size());
+    std::string error;
+    if (pLoaded == nullptr || compareReflection(pReflection.get(), pLoaded.get(), error) == false)
+    {
+        return test_fail("Reflection with interned names didn't round-trip");
+    }
+    return test_pass();
+}
+
+testing_func(ProgramReflectionTest, TestCorruptBlob)
+{
+    ProgramReflection::SharedPtr pReflection = createReflection();
+    std::vector<uint8_t> blob;
+    pReflection->serialize(blob);
+
+    if (ProgramReflection::createFromBlob(nullptr, 0) != nullptr)
+    {
+        return test_fail("Null blob was accepted");
+    }
+
+    // Every truncation must be rejected
+    for (size_t size = 0; size < blob.size(); size++)
+    {
+        if (ProgramReflection::createFromBlob(blob.data(), size) != nullptr)
+        {
+            return test_fail("Truncated blob of " + std::to_string(size) + " bytes was accepted");
+        }
+    }
+
+    // Bad format ID and version. The version directly follows the 4 byte format ID.
+    std::vector<uint8_t> corrupt = blob;
+    corrupt[0] ^= 0xFF;
+    if (ProgramReflection::createFromBlob(corrupt.data(), corrupt.size()) != nullptr)
+    {
+        return test_fail("Blob with a bad format ID was accepted");
+    }
+    corrupt = blob;
+    corrupt[4] ^= 0xFF;
+    if (ProgramReflection::createFromBlob(corrupt.data(), corrupt.size()) != nullptr)
+    {
+        return test_fail("Blob with a different version was accepted");
+    }
+
+    // Removing the final null terminator of the string table must be caught
+    corrupt = blob;
+    corrupt.back() = 'x';
+    if (ProgramReflection::createFromBlob(corrupt.data(), corrupt.size()) != nullptr)
+    {
+        return test_fail("Blob with an unterminated string table was accepted");
+    }
+
+    // Flipping any single byte may produce valid data, but must never crash
+    for (size_t i = 0; i < blob.size(); i++)
+    {
+        corrupt = blob;
+        corrupt[i] ^= 0xA5;
+        ProgramReflection::createFromBlob(corrupt.data(), corrupt.size());
+    }
+    return test_pass();
+}
+
+int main()
+{
+    ProgramReflectionTest prt;
+    prt.init();
+    prt.run();
+    return 0;
+}
@@ -0,0 +1,190 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "SceneCacheTest.h"
+#include "Graphics/Scene/SceneCache.h"
+#include "Utils/OS.h"
+#include <cstdio>
+#include <fstream>
+
+void SceneCacheTest::addTests()
+{
+    addTestToList<TestTexturedSceneCache>();
+    addTestToList<TestMissingTextureInvalidates>();
+    addTestToList<TestSharedModelFile>();
+}
+
+static const std::string kSceneName = "SceneCacheTest.fscene";
+static const std::string kTextureName = "SceneCacheTest.png";
+static const std::string kSharedSceneName = "SceneCacheTestShared.fscene";
+
+/** Write a textured quad scene into a new data directory.
+    The directory is not the working directory, so the texture can only be found through the data directories.
+    \return The full path of the scene file
+*/
+static std::string createTexturedScene()
+{
+    const std::string dir = getExecutableDirectory() + "\\SceneCacheTestData";
+    if(isDirectoryExists(dir) == false)
+    {
+        createDirectory(dir);
+    }
+    addDataDirectory(dir);
+
+    std::vector<uint32_t> texels(16 * 16);
+    for(uint32_t i = 0; i < texels.size(); i++)
+    {
+        texels[i] = (((i / 16) ^ i) & 1) ? 0xFFFFFFFF : 0xFF000000;
+    }
+    Bitmap::saveImage(dir + '\\' + kTextureName, 16, 16, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::None, ResourceFormat::RGBA8Unorm, true, texels.data());
+
+    std::ofstream mtl(dir + "\\SceneCacheTest.mtl");
+    mtl << "newmtl Checker\nKd 1 1 1\nmap_Kd " << kTextureName << "\n";
+    mtl.close();
+
+    std::ofstream obj(dir + "\\SceneCacheTest.obj");
+    obj << "mtllib SceneCacheTest.mtl\n"
+        << "v -1 -1 0\nv 1 -1 0\nv 1 1 0\nv -1 1 0\n"
+        << "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+        << "vn 0 0 1\n"
+        << "usemtl Checker\n"
+        << "f 1/1/1 2/2/1 3/3/1\nf 1/1/1 3/3/1 4/4/1\n";
+    obj.close();
+
+    std::ofstream scene(dir + '\\' + kSceneName);
+    scene << "{\n"
+        << "    \"version\": 0,\n"
+        << "    \"models\": [ { \"file\": \"SceneCacheTest.obj\", \"name\": \"quad\" } ]\n"
+        << "}\n";
+    scene.close();
+
+    // Remove the cache of a previous run, so the first load imports the scene
+    const std::string fullpath = dir + '\\' + kSceneName;
+    std::remove(SceneCache::getCacheFilename(fullpath).c_str());
+    return fullpath;
+}
+
+testing_func(SceneCacheTest, TestTexturedSceneCache)
+{
+    const std::string fullpath = createTexturedScene();
+    Scene::SharedPtr pScene = Scene::loadFromFile(kSceneName, 0, Scene::UseSceneCache);
+    if(pScene == nullptr || pScene->getModelCount() != 1)
+    {
+        return test_fail("Can't import the scene");
+    }
+    if(doesFileExist(SceneCache::getCacheFilename(fullpath)) == false)
+    {
+        return test_fail("The cache wasn't written");
+    }
+
+    // The texture is a dependency of the cache. It must be found again, otherwise the cache is rejected on every load.
+    Scene::SharedPtr pCached = SceneCache::load(fullpath, 0, Scene::UseSceneCache);
+    if(pCached == nullptr)
+    {
+        return test_fail("The cache was rejected right after it was written");
+    }
+    const Material* pMaterial = (pCached->getModelCount() == 1) ? pCached->getModel(0)->getMesh(0)->getMaterial().get() : nullptr;
+    if(pMaterial == nullptr || pMaterial->getNumLayers() == 0 || pMaterial->getLayer(0).pTexture == nullptr)
+    {
+        return test_fail("The cached scene doesn't match the source scene");
+    }
+    return test_pass();
+}
+
+testing_func(SceneCacheTest, TestMissingTextureInvalidates)
+{
+    const std::string fullpath = createTexturedScene();
+    if(Scene::loadFromFile(kSceneName, 0, Scene::UseSceneCache) == nullptr)
+    {
+        return test_fail("Can't import the scene");
+    }
+
+    std::string texturePath;
+    if(findFileInDataDirectories(kTextureName, texturePath) == false || std::remove(texturePath.c_str()) != 0)
+    {
+        return test_fail("Can't remove the texture");
+    }
+    if(SceneCache::load(fullpath, 0, Scene::UseSceneCache) != nullptr)
+    {
+        return test_fail("The cache was accepted without its texture");
+    }
+    return test_pass();
+}
+
+testing_func(SceneCacheTest, TestSharedModelFile)
+{
+    // Two entries use the same file, with different names and material overrides
+    const std::string fullpath = createTexturedScene();
+    const std::string dir = fullpath.substr(0, fullpath.find_last_of('\\'));
+
+    std::ofstream scene(dir + '\\' + kSharedSceneName);
+    scene << "{\n"
+        << "    \"version\": 0,\n"
+        << "    \"materials\": [ { \"name\": \"Override\", \"id\": 0 } ],\n"
+        << "    \"models\": [\n"
+        << "        { \"file\": \"SceneCacheTest.obj\", \"name\": \"first\" },\n"
+        << "        { \"file\": \"SceneCacheTest.obj\", \"name\": \"second\", \"material_overrides\": [ { \"mesh_id\": 0, \"material_id\": 0 } ] }\n"
+        << "    ]\n"
+        << "}\n";
+    scene.close();
+
+    Scene::SharedPtr pScene = Scene::loadFromFile(kSharedSceneName, 0, Scene::LoadMaterialHistory);
+    if(pScene == nullptr || pScene->getModelCount() != 2)
+    {
+        return test_fail("Each entry should create a model");
+    }
+
+    const Model::SharedPtr& pFirst = pScene->getModel(0);
+    const Model::SharedPtr& pSecond = pScene->getModel(1);
+    if(pFirst == pSecond)
+    {
+        return test_fail("Entries which use the same file share a model");
+    }
+    if(pFirst->getName() != "first" || pSecond->getName() != "second")
+    {
+        return test_fail("An entry's name was applied to the other entry's model");
+    }
+    if(pScene->getModelInstanceCount(0) != 1 || pScene->getModelInstanceCount(1) != 1)
+    {
+        return test_fail("The instances of the entries were merged");
+    }
+
+    const Material* pOverride = pScene->getMaterial(0).get();
+    if(pFirst->getMesh(0)->getMaterial().get() == pOverride || pSecond->getMesh(0)->getMaterial().get() != pOverride)
+    {
+        return test_fail("A material override was applied to the wrong model");
+    }
+    return test_pass();
+}
+
+int main()
+{
+    SceneCacheTest sct;
+    sct.init(true);
+    sct.run();
+    return 0;
+}
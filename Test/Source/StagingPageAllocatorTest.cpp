@@ -0,0 +1,284 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "StagingPageAllocatorTest.h"
+
+void StagingPageAllocatorTest::addTests()
+{
+    addTestToList<TestSuballocation>();
+    addTestToList<TestPageRecycling>();
+    addTestToList<TestActivePageReuse>();
+    addTestToList<TestDedicatedPages>();
+    addTestToList<TestMaxFreePages>();
+}
+
+static const uint64_t kPageSize = 1024;
+
+/** Stands in for a GpuFence and the page resources. The test decides when the "GPU" finishes a batch.
+*/
+struct FakeUploadQueue
+{
+    uint64_t cpuValue = 0;
+    uint64_t gpuValue = 0;
+    std::vector<uint64_t> pageSizes;    // 0 for pages which don't exist
+    uint32_t createCount = 0;
+    uint32_t releaseCount = 0;
+
+    StagingPageAllocator::SharedPtr createAllocator(uint32_t maxFreePages)
+    {
+        auto createPage = [this](uint32_t pageID, uint64_t size)
+        {
+            if (pageID >= pageSizes.size())
+            {
+                pageSizes.resize(pageID + 1, 0);
+            }
+            pageSizes[pageID] = size;
+            createCount++;
+        };
+        auto releasePage = [this](uint32_t pageID)
+        {
+            pageSizes[pageID] = 0;
+            releaseCount++;
+        };
+        return StagingPageAllocator::create(kPageSize, maxFreePages, createPage, releasePage);
+    }
+
+    // Like CopyContext::flush(), which signals the fence and submits the batch with the new value
+    uint64_t flush(StagingPageAllocator* pAllocator)
+    {
+        cpuValue++;
+        pAllocator->submit(cpuValue);
+        return cpuValue;
+    }
+
+    void complete(StagingPageAllocator* pAllocator, uint64_t value)
+    {
+        gpuValue = value;
+        pAllocator->retire(gpuValue);
+    }
+};
+
+testing_func(StagingPageAllocatorTest, TestSuballocation)
+{
+    FakeUploadQueue queue;
+    auto pAllocator = queue.createAllocator(4);
+
+    // Odd sizes with alignment, all in the same batch
+    struct Range { uint32_t pageID; uint64_t begin; uint64_t end; };
+    std::vector<Range> ranges;
+    for (uint32_t i = 0; i < 40; i++)
+    {
+        uint64_t size = 13 + (i * 7) % 50;
+        uint64_t alignment = (i % 3 == 0) ? 16 : 4;
+        auto allocation = pAllocator->allocate(size, alignment);
+        if (allocation.offset % alignment != 0)
+        {
+            return test_fail("Allocation isn't aligned");
+        }
+        if (allocation.pageID >= queue.pageSizes.size() || allocation.offset + size > queue.pageSizes[allocation.pageID])
+        {
+            return test_fail("Allocation is out of its page");
+        }
+        ranges.push_back({ allocation.pageID, allocation.offset, allocation.offset + size });
+    }
+
+    for (size_t i = 0; i < ranges.size(); i++)
+    {
+        for (size_t j = i + 1; j < ranges.size(); j++)
+        {
+            if (ranges[i].pageID == ranges[j].pageID && ranges[i].begin < ranges[j].end && ranges[j].begin < ranges[i].end)
+            {
+                return test_fail("Allocations overlap");
+            }
+        }
+    }
+
+    // About 1.5KB of data, which needs 2 pages
+    if (queue.createCount != 2)
+    {
+        return test_fail("Small allocations weren't packed into pages");
+    }
+
+    return test_pass();
+}
+
+testing_func(StagingPageAllocatorTest, TestPageRecycling)
+{
+    FakeUploadQueue queue;
+    auto pAllocator = queue.createAllocator(4);
+
+    // Batch 1 fills page A. Batch 2 starts page B.
+    auto a = pAllocator->allocate(kPageSize);
+    uint64_t fence1 = queue.flush(pAllocator.get());
+    auto b = pAllocator->allocate(kPageSize / 2);
+    if (a.pageID == b.pageID || queue.createCount != 2)
+    {
+        return test_fail("A full page was reused");
+    }
+    uint64_t fence2 = queue.flush(pAllocator.get());
+
+    // The GPU didn't finish batch 1, so page A can't be reused
+    queue.complete(pAllocator.get(), 0);
+    auto c = pAllocator->allocate(kPageSize);
+    if (c.pageID == a.pageID || queue.createCount != 3)
+    {
+        return test_fail("A page was reused before the GPU finished with it");
+    }
+    uint64_t fence3 = queue.flush(pAllocator.get());
+
+    // Batch 1 done. Page A is free, page B is still pending.
+    queue.complete(pAllocator.get(), fence1);
+    if (pAllocator->getStats().freePageCount != 1)
+    {
+        return test_fail("The page of a completed batch wasn't recycled");
+    }
+    auto d = pAllocator->allocate(kPageSize);
+    if (d.pageID != a.pageID || d.offset != 0 || queue.createCount != 3)
+    {
+        return test_fail("A recycled page wasn't reused");
+    }
+    queue.flush(pAllocator.get());
+
+    // Retiring everything recycles the rest without creating or releasing pages
+    queue.complete(pAllocator.get(), queue.cpuValue);
+    auto stats = pAllocator->getStats();
+    if (stats.pendingPageCount != 0 || stats.pageCount != 3 || queue.releaseCount != 0 || fence2 >= fence3)
+    {
+        return test_fail("Pages weren't retired");
+    }
+
+    return test_pass();
+}
+
+testing_func(StagingPageAllocatorTest, TestActivePageReuse)
+{
+    FakeUploadQueue queue;
+    auto pAllocator = queue.createAllocator(4);
+
+    // A steady stream of small uploads, with the GPU one frame behind, never needs more than 2 pages
+    for (uint32_t frame = 0; frame < 100; frame++)
+    {
+        for (uint32_t i = 0; i < 5; i++)
+        {
+            pAllocator->allocate(64, 16);
+        }
+        uint64_t fence = queue.flush(pAllocator.get());
+        queue.complete(pAllocator.get(), fence - 1);
+    }
+
+    if (queue.createCount > 2)
+    {
+        return test_fail("Steady uploads created " + std::to_string(queue.createCount) + " pages");
+    }
+
+    // Once the GPU is idle, the active page is filled from the start
+    queue.complete(pAllocator.get(), queue.cpuValue);
+    auto allocation = pAllocator->allocate(16);
+    if (allocation.offset != 0)
+    {
+        return test_fail("The idle active page wasn't reset");
+    }
+
+    return test_pass();
+}
+
+testing_func(StagingPageAllocatorTest, TestDedicatedPages)
+{
+    FakeUploadQueue queue;
+    auto pAllocator = queue.createAllocator(4);
+
+    auto small = pAllocator->allocate(100);
+    auto large = pAllocator->allocate(kPageSize * 3);
+    if (large.pageID == small.pageID || large.offset != 0 || queue.pageSizes[large.pageID] != kPageSize * 3)
+    {
+        return test_fail("A large allocation didn't get a dedicated page");
+    }
+
+    // The dedicated page doesn't replace the active page
+    auto small2 = pAllocator->allocate(100);
+    if (small2.pageID != small.pageID)
+    {
+        return test_fail("A dedicated page interrupted suballocation");
+    }
+
+    if (pAllocator->getBatchSize() != kPageSize * 3 + 200)
+    {
+        return test_fail("Wrong batch size");
+    }
+
+    uint64_t fence = queue.flush(pAllocator.get());
+    if (pAllocator->getBatchSize() != 0)
+    {
+        return test_fail("Submitting didn't start a new batch");
+    }
+
+    queue.complete(pAllocator.get(), fence);
+    if (queue.releaseCount != 1 || queue.pageSizes[large.pageID] != 0)
+    {
+        return test_fail("The dedicated page wasn't released");
+    }
+
+    // The released page ID is reused
+    auto large2 = pAllocator->allocate(kPageSize * 2);
+    if (large2.pageID != large.pageID)
+    {
+        return test_fail("A released page ID wasn't reused");
+    }
+
+    return test_pass();
+}
+
+testing_func(StagingPageAllocatorTest, TestMaxFreePages)
+{
+    FakeUploadQueue queue;
+    auto pAllocator = queue.createAllocator(2);
+
+    // A burst of 6 full pages in a single batch
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        pAllocator->allocate(kPageSize);
+    }
+    uint64_t fence = queue.flush(pAllocator.get());
+    queue.complete(pAllocator.get(), fence);
+
+    // The active page stays, 2 pages are kept for reuse and the rest are released
+    auto stats = pAllocator->getStats();
+    if (stats.freePageCount != 2 || stats.pageCount != 3 || queue.releaseCount != 3)
+    {
+        return test_fail("Idle pages weren't trimmed");
+    }
+
+    return test_pass();
+}
+
+int main()
+{
+    StagingPageAllocatorTest spat;
+    spat.init();
+    spat.run();
+    return 0;
+}